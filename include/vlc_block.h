@@ -231,6 +231,46 @@ static inline block_t *block_Duplicate( const block_t *p_block )
     return p_dup;
 }
 
+/**
+ * Makes the payload of a block shareable.
+ *
+ * Converts a block into a block with a reference-counted payload, so that
+ * block_Share() can duplicate it without copying the data.
+ *
+ * @param block block to convert (not a chain)
+ * @return the shareable block, or @c block itself if it is already
+ * shareable or on memory error (this function cannot fail)
+ */
+VLC_API block_t *block_Shareable(block_t *block) VLC_USED;
+
+/**
+ * Duplicates a block, sharing its payload.
+ *
+ * If the block is shareable (see block_Shareable()), only the block header is
+ * allocated, and both blocks refer to the same data. Otherwise, the payload is
+ * copied as with block_Duplicate().
+ *
+ * The data of a shared block must not be modified in place. block_Realloc()
+ * and block_TryRealloc() copy the data before growing it, and block_Unshare()
+ * copies the data before other modifications. Moving block_t.p_buffer or
+ * reducing block_t.i_buffer is always allowed.
+ *
+ * @return the duplicate on success, NULL on error.
+ */
+VLC_API block_t *block_Share(const block_t *block) VLC_USED VLC_MALLOC;
+
+/**
+ * Makes the payload of a block writable.
+ *
+ * Copies the data of the block if other blocks share it.
+ *
+ * @param block block to make writable (not a chain)
+ * @return a block with the same data that can be modified in place
+ * (possibly @c block itself), or NULL on error.
+ * @note On error, the block is discarded.
+ */
+VLC_API block_t *block_Unshare(block_t *block) VLC_USED;
+
 /**
  * Wraps heap in a block.
  *
@@ -43,6 +43,19 @@
 
 typedef struct decoder_cc_desc_t decoder_cc_desc_t;
 
+/**
+ * Decoding steps a video decoder should skip, as requested by the owner when
+ * the video output cannot keep up. Each level includes the previous ones.
+ */
+enum decoder_skip_level
+{
+    DECODER_SKIP_NONE,          /**< decode everything */
+    DECODER_SKIP_LOOP_FILTER,   /**< skip the in-loop (deblocking) filters */
+    DECODER_SKIP_NONREF,        /**< skip the non-reference frames */
+    DECODER_SKIP_BIDIR,         /**< skip all bidirectional frames */
+    DECODER_SKIP_NONKEY,        /**< only decode the key frames */
+};
+
 struct decoder_owner_callbacks
 {
     union
@@ -65,6 +78,9 @@ struct decoder_owner_callbacks
             /* Display rate
              * cf. decoder_GetDisplayRate */
             float       (*get_display_rate)( decoder_t * );
+            /* Skip level
+             * cf. decoder_GetSkipLevel */
+            enum decoder_skip_level (*get_skip_level)( decoder_t * );
         } video;
         struct
         {
@@ -298,6 +314,38 @@ VLC_API picture_t *decoder_NewPicture( decoder_t *dec );
  */
 VLC_API void decoder_AbortPictures( decoder_t *dec, bool b_abort );
 
+/**
+ * Decoding threads granted to a decoder, cf. decoder_RequestThreads()
+ */
+typedef struct decoder_threads_t decoder_threads_t;
+
+/**
+ * Request threads from the decoding threads budget of the instance.
+ *
+ * The "dec-threads" budget is shared by all the decoders of the instance, in
+ * proportion to their weight: the number of pixels of their pictures times
+ * their "dec-threads-priority". The grant is capped to the share of the
+ * decoder among the open ones. Threads cannot be taken back from a running
+ * decoder: the ones that got more than their share before do not reduce the
+ * grant, and their threads come back to the budget when they are closed.
+ *
+ * \param wanted number of threads the decoder would use on its own
+ * \param count [OUT] number of threads granted, at least one
+ * \return the grant, to be given back with decoder_ReleaseThreads(), or
+ * NULL on error (a single thread is then granted, outside of the budget)
+ */
+VLC_API decoder_threads_t *decoder_RequestThreads( decoder_t *dec,
+                                                   unsigned wanted,
+                                                   unsigned *count );
+
+/**
+ * Give back the threads granted by decoder_RequestThreads().
+ *
+ * \param threads the grant, or NULL
+ */
+VLC_API void decoder_ReleaseThreads( decoder_t *dec,
+                                     decoder_threads_t *threads );
+
 /**
  * Initialize a decoder structure before creating the decoder.
  *
@@ -474,6 +522,25 @@ static inline float decoder_GetDisplayRate( decoder_t *dec )
     return dec->cbs->video.get_display_rate( dec );
 }
 
+/**
+ * This function returns the decoding steps the decoder should skip, because
+ * the video output is displaying its pictures late.
+ *
+ * The level is raised one step at a time while the pictures are late or
+ * dropped, and lowered back after a while without any. Decoders should only
+ * honor it if b_frame_drop_allowed is set.
+ */
+VLC_USED
+static inline enum decoder_skip_level decoder_GetSkipLevel( decoder_t *dec )
+{
+    vlc_assert( dec->fmt_in.i_cat == VIDEO_ES && dec->cbs != NULL );
+
+    if( !dec->cbs->video.get_skip_level )
+        return DECODER_SKIP_NONE;
+
+    return dec->cbs->video.get_skip_level( dec );
+}
+
 /** @} */
 
 /**
@@ -201,4 +201,47 @@ VLC_API unsigned vlc_CPU(void);
 
 # endif
 
+/**
+ * Checks whether the CPU can run a set of SIMD kernels.
+ *
+ * \param name instruction set of the kernels: "avx", "sse2" or "neon"
+ * \return whether the CPU supports it; true for any other name, such as
+ * "c" for the portable kernels
+ */
+VLC_USED
+static inline bool vlc_CPU_CheckKernels(const char *name)
+{
+# if defined (__i386__) || defined (__x86_64__)
+    if (!strcmp(name, "avx"))
+        return vlc_CPU_AVX();
+    if (!strcmp(name, "sse2"))
+        return vlc_CPU_SSE2();
+# elif defined (__arm__) || defined (__aarch64__)
+    if (!strcmp(name, "neon"))
+        return vlc_CPU_ARM_NEON();
+# endif
+    return true;
+}
+
+/**
+ * Allocates a zeroed array of floats for SIMD kernels.
+ *
+ * The size is rounded up to a multiple of the alignment, so that kernels
+ * can load whole vectors up to the end of the array.
+ *
+ * \param count number of floats
+ * \param align alignment in bytes (a power of two)
+ * \return the array, to release with free(), or NULL on error
+ */
+VLC_USED VLC_MALLOC
+static inline float *vlc_CPU_AllocFloats(size_t count, size_t align)
+{
+    size_t size = (count * sizeof (float) + align - 1) & ~(align - 1);
+    float *p = aligned_alloc(align, size ? size : align);
+
+    if (p != NULL)
+        memset(p, 0, size);
+    return p;
+}
+
 #endif /* !VLC_CPU_H */
@@ -0,0 +1,70 @@
+/*****************************************************************************
+ * vlc_fft.h: fast Fourier transform of real signals
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_FFT_H
+#define VLC_FFT_H 1
+
+/**
+ * \defgroup fft Fast Fourier transform
+ * \ingroup misc
+ *
+ * FFT of real signals, computed as a complex FFT of half the size, with
+ * radix-4 butterflies vectorized when possible.
+ *
+ * @{
+ * \file
+ */
+
+typedef struct vlc_fft vlc_fft_t;
+
+/**
+ * Creates a FFT.
+ *
+ * \param size number of real input samples, a power of two, at least 2
+ * \return the FFT, or NULL on error
+ */
+VLC_API vlc_fft_t *vlc_fft_New(unsigned size) VLC_USED;
+
+VLC_API void vlc_fft_Delete(vlc_fft_t *);
+
+/**
+ * Computes the FFT of size real samples.
+ *
+ * \param re real parts of the size / 2 + 1 first frequencies [OUT]
+ * \param im imaginary parts of the size / 2 + 1 first frequencies [OUT]
+ */
+VLC_API void vlc_fft_Real(vlc_fft_t *, const float *in, float *re, float *im);
+
+/**
+ * Computes the inverse FFT of the spectrum of size real samples.
+ *
+ * This is the exact inverse of vlc_fft_Real(): the output is scaled by
+ * 1 / size.
+ *
+ * \param re real parts of the size / 2 + 1 first frequencies
+ * \param im imaginary parts of the size / 2 + 1 first frequencies
+ * \param out size real samples [OUT]
+ */
+VLC_API void vlc_fft_RealInverse(vlc_fft_t *, const float *re,
+                                 const float *im, float *out);
+
+/** @} */
+
+#endif
@@ -26,6 +26,7 @@
 #define VLC_FILTER_H 1
 
 #include <vlc_es.h>
+#include <vlc_picture.h>
 
 /**
  * \defgroup filter Filters
@@ -279,6 +280,69 @@ VLC_API int filter_Blend( filter_t *, picture_t *p_dst, int i_dst_x, int i_dst_y
  */
 VLC_API void filter_DeleteBlend( filter_t * );
 
+/**
+ * Horizontal band of a picture, see filter_RunSlices().
+ *
+ * Rows are counted on the first plane of the picture.
+ */
+typedef struct
+{
+    unsigned index; /**< Index of the band, from 0 to count - 1 */
+    unsigned count; /**< Number of bands of the picture */
+    unsigned y_start; /**< First row to write */
+    unsigned y_end; /**< Row after the last row to write */
+    unsigned y_read_start; /**< First row to read, overlap included */
+    unsigned y_read_end; /**< Row after the last row to read, overlap included */
+} filter_slice_t;
+
+/** Maximum number of bands of a picture, so that callbacks can keep data
+ * for each band index */
+#define FILTER_SLICES_MAX 33
+
+typedef void (*filter_slice_cb)(filter_t *, const filter_slice_t *, void *);
+
+/**
+ * It runs a callback over horizontal bands of a picture, in parallel.
+ *
+ * The bands are processed by a worker pool shared by all the filters and
+ * by the calling thread, and the function returns once all of them are
+ * done. The callback must only write the rows of its band, and should
+ * only read the rows of its band and its overlap.
+ *
+ * \param height number of rows of the first plane
+ * \param align multiple of the band heights, 2 for vertically subsampled
+ *              chromas or to keep the field parity
+ * \param overlap rows around a band the callback needs to read
+ */
+VLC_API void filter_RunSlices( filter_t *, unsigned height, unsigned align,
+                               unsigned overlap, filter_slice_cb, void *opaque );
+
+/**
+ * It initializes a view of the rows of a band of a picture.
+ *
+ * This allows filter_RunSlices() callbacks to reuse code processing whole
+ * pictures. The view shares the pixels of the picture and must neither be
+ * held nor released. The rows are counted on the first plane, and scaled
+ * for the subsampled planes.
+ */
+static inline void filter_SliceView( picture_t *view, const picture_t *pic,
+                                     unsigned y_start, unsigned y_end )
+{
+    const unsigned lines = pic->p[0].i_visible_lines;
+
+    memcpy( (void *)view, pic, sizeof(*view) );
+    for( int i = 0; i < pic->i_planes; i++ )
+    {
+        plane_t *p = &view->p[i];
+        const unsigned visible = p->i_visible_lines;
+        const unsigned start = y_start * visible / lines;
+        const unsigned end = y_end >= lines ? visible : y_end * visible / lines;
+
+        p->p_pixels += start * p->i_pitch;
+        p->i_lines = p->i_visible_lines = end - start;
+    }
+}
+
 /**
  * Create a picture_t *(*)( filter_t *, picture_t * ) compatible wrapper
  * using a void (*)( filter_t *, picture_t *, picture_t * ) function
@@ -420,11 +484,44 @@ VLC_API const es_format_t *filter_chain_GetFmtOut(const filter_chain_t *chain);
 VLC_API picture_t *filter_chain_VideoFilter(filter_chain_t *chain,
                                             picture_t *pic);
 
+/**
+ * Get the next picture out of a video filter chain, waiting for the
+ * pictures being filtered by a pipelined chain.
+ *
+ * This is the same as filter_chain_VideoFilter() with a NULL picture if
+ * the chain is not pipelined.
+ *
+ * \param chain pointer to filter chain
+ * \return filtered picture, or NULL if the chain is drained
+ */
+VLC_API picture_t *filter_chain_VideoDrain(filter_chain_t *chain);
+
 /**
  * Flush a video filter chain.
  */
 VLC_API void filter_chain_VideoFlush( filter_chain_t * );
 
+/**
+ * Run the filters of a video filter chain on separate threads.
+ *
+ * Every filter but the last one then runs on its own thread, with a
+ * bounded queue of input pictures. filter_chain_VideoFilter() only returns
+ * the pictures already filtered, and filter_chain_VideoDrain() waits for
+ * the remaining ones, at the end of the stream. The pictures being filtered are dropped when the
+ * filters of the chain are changed.
+ *
+ * Chains of hardware surfaces are not pipelined.
+ *
+ * \param chain pointer to video filter chain
+ * \param depth maximum number of pictures queued before each filter,
+ *              0 to filter the pictures synchronously
+ * \param wake callback, from the filter threads, when filtered pictures
+ *             are ready, or NULL
+ * \param opaque data for the callback
+ */
+VLC_API void filter_chain_SetPipelined(filter_chain_t *chain, unsigned depth,
+                                       void (*wake)(void *), void *opaque);
+
 /**
  * Generate subpictures from a chain of subpicture source "filters".
  *
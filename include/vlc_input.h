@@ -389,6 +389,9 @@ typedef enum input_event_type_e
 
     /* Thumbnail generation */
     INPUT_EVENT_THUMBNAIL_READY,
+
+    /* Loudness scan of an audio track done */
+    INPUT_EVENT_LOUDNESS,
 } input_event_type_e;
 
 #define VLC_INPUT_CAPABILITIES_SEEKABLE (1<<0)
@@ -477,6 +480,12 @@ struct vlc_input_event_vout
     vout_thread_t *vout;
 };
 
+struct vlc_input_event_loudness
+{
+    double integrated; /**< integrated loudness, in LUFS */
+    float peak; /**< sample peak, 1 being the full scale */
+};
+
 struct vlc_input_event
 {
     input_event_type_e type;
@@ -524,6 +533,8 @@ struct vlc_input_event
         float subs_fps;
         /* INPUT_EVENT_THUMBNAIL_READY */
         picture_t *thumbnail;
+        /* INPUT_EVENT_LOUDNESS */
+        struct vlc_input_event_loudness loudness;
     };
 };
 
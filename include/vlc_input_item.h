@@ -377,7 +377,11 @@ typedef enum input_item_meta_request_option_t
     META_REQUEST_OPTION_SCOPE_LOCAL   = 0x01,
     META_REQUEST_OPTION_SCOPE_NETWORK = 0x02,
     META_REQUEST_OPTION_SCOPE_ANY     = 0x03,
-    META_REQUEST_OPTION_DO_INTERACT   = 0x04
+    META_REQUEST_OPTION_DO_INTERACT   = 0x04,
+    /* Decode the audio of local files to measure their loudness, and store
+     * the ReplayGain track gain and peak in the meta, if not present. The
+     * files are measured after the preparsing ended, without timeout. */
+    META_REQUEST_OPTION_SCAN_LOUDNESS = 0x08
 } input_item_meta_request_option_t;
 
 /* status of the on_preparse_ended() callback */
@@ -429,6 +433,8 @@ struct input_stats_t
     /* Decoders */
     int64_t i_decoded_audio;
     int64_t i_decoded_video;
+    vlc_tick_t i_audio_cpu_time; /* CPU time used by the decoder threads */
+    vlc_tick_t i_video_cpu_time;
 
     /* Vout */
     int64_t i_displayed_pictures;
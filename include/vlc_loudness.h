@@ -0,0 +1,100 @@
+/*****************************************************************************
+ * vlc_loudness.h: EBU R128 loudness measurement
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_LOUDNESS_H
+#define VLC_LOUDNESS_H 1
+
+#include <vlc_es.h>
+
+/**
+ * \defgroup loudness Loudness measurement
+ * \ingroup audio
+ *
+ * Loudness of audio signals, as specified by ITU-R BS.1770 and EBU R128:
+ * the channels are K-weighted, their mean squares are summed with the
+ * surround channels weighted by 1.41 and the LFE channel left out, and the
+ * integrated loudness is the mean of the 400 ms blocks, with 75% overlap,
+ * above the absolute gate of -70 LUFS and the relative gate of -10 LU.
+ *
+ * The gated blocks are kept in a histogram of 0.1 LU bins, so that the
+ * memory used does not depend on the duration; the relative gate is applied
+ * to the nearest bin.
+ *
+ * @{
+ * \file
+ */
+
+/** Reference level of ReplayGain 2.0, in LUFS */
+#define VLC_LOUDNESS_REPLAY_GAIN_REFERENCE (-18.)
+
+typedef struct vlc_loudness vlc_loudness_t;
+
+/**
+ * Creates a loudness meter.
+ *
+ * \param fmt format of the samples: VLC_CODEC_FL32, VLC_CODEC_FL64,
+ * VLC_CODEC_S32N, VLC_CODEC_S16N or VLC_CODEC_U8, interleaved in the VLC
+ * order of the physical channels, or with no physical channels to weight
+ * them all equally
+ * \return the meter, or NULL on error or if the format is not supported
+ */
+VLC_API vlc_loudness_t *vlc_loudness_New(const audio_sample_format_t *fmt)
+VLC_USED;
+
+VLC_API void vlc_loudness_Delete(vlc_loudness_t *);
+
+/** Measures frames of interleaved samples */
+VLC_API void vlc_loudness_Process(vlc_loudness_t *, const void *samples,
+                                  size_t frames);
+
+/** Forgets all the measurements */
+VLC_API void vlc_loudness_Reset(vlc_loudness_t *);
+
+/**
+ * Gets the gated loudness of all the measured frames.
+ *
+ * \return the integrated loudness in LUFS, or -INFINITY if no block was
+ * above the absolute gate
+ */
+VLC_API double vlc_loudness_GetIntegrated(const vlc_loudness_t *);
+
+/**
+ * Gets the loudness of the last 400 ms.
+ *
+ * \return the momentary loudness in LUFS, or -INFINITY if less than 400 ms
+ * were measured, or if they are silent
+ */
+VLC_API double vlc_loudness_GetMomentary(const vlc_loudness_t *);
+
+/**
+ * Gets the loudness of the last 3 s, or of all the frames measured if less
+ * (by steps of 100 ms).
+ *
+ * \return the short-term loudness in LUFS, or -INFINITY if less than 100 ms
+ * were measured, or if they are silent
+ */
+VLC_API double vlc_loudness_GetShortTerm(const vlc_loudness_t *);
+
+/** Gets the highest absolute sample value, 1 being the full scale */
+VLC_API float vlc_loudness_GetPeak(const vlc_loudness_t *);
+
+/** @} */
+
+#endif
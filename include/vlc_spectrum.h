@@ -0,0 +1,100 @@
+/*****************************************************************************
+ * vlc_spectrum.h: shared spectrum analysis of audio blocks
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_SPECTRUM_H
+#define VLC_SPECTRUM_H 1
+
+/**
+ * \defgroup spectrum Spectrum analysis
+ * \ingroup audio
+ *
+ * Windowed power spectrum of the first channel of audio blocks.
+ *
+ * The analyses with the same owner and configuration are shared: the
+ * spectrum of a block is computed once, by the first user asking for it, and
+ * the other users, such as the effects of the visualizations of an audio
+ * output, get the cached result.
+ *
+ * @{
+ * \file
+ */
+
+/** Windows, in the order of the effect-fft-window choices */
+enum vlc_spectrum_window
+{
+    VLC_SPECTRUM_WINDOW_NONE,
+    VLC_SPECTRUM_WINDOW_HANN,
+    VLC_SPECTRUM_WINDOW_FLATTOP,
+    VLC_SPECTRUM_WINDOW_BLACKMANHARRIS,
+    VLC_SPECTRUM_WINDOW_KAISER,
+};
+
+struct vlc_spectrum_cfg
+{
+    unsigned size; /**< samples per analysis, a power of two */
+    enum vlc_spectrum_window window;
+    float kaiser_alpha; /**< Kaiser window parameter */
+};
+
+typedef struct vlc_spectrum vlc_spectrum_t;
+
+/**
+ * Gets the configuration from the effect-fft-window and effect-kaiser-param
+ * variables, if defined, or no window otherwise.
+ */
+VLC_API void vlc_spectrum_GetConfig(vlc_object_t *obj, unsigned size,
+                                    struct vlc_spectrum_cfg *cfg);
+
+/**
+ * Gets the shared analysis for an owner and a configuration, creating it if
+ * needed.
+ *
+ * \param owner object the analysis is shared within. Its users must analyse
+ * the same samples: the visualizations, at the end of the filter chain, use
+ * their parent, that is the audio output, whereas an audio filter, which sees
+ * the samples of its position in the chain, uses itself.
+ * \return the analysis, or NULL on error
+ */
+VLC_API vlc_spectrum_t *vlc_spectrum_Hold(vlc_object_t *owner,
+                                          const struct vlc_spectrum_cfg *cfg)
+VLC_USED;
+
+VLC_API void vlc_spectrum_Release(vlc_spectrum_t *);
+
+/**
+ * Gets the power spectrum of an audio block.
+ *
+ * The size samples of the first channel are analysed, the block samples
+ * being repeated if there are fewer, and scaled by the window. The power of
+ * the constant and highest frequency terms is divided by 4. A block is
+ * identified by its timestamp: the spectrum of a block without timestamp is
+ * not cached.
+ *
+ * \param block interleaved VLC_CODEC_FL32 samples
+ * \param channels number of interleaved channels
+ * \param power power of the size / 2 + 1 first frequencies [OUT]
+ * \return VLC_SUCCESS, or VLC_EGENERIC if the block is empty
+ */
+VLC_API int vlc_spectrum_Compute(vlc_spectrum_t *, const block_t *block,
+                                 unsigned channels, float *power);
+
+/** @} */
+
+#endif
@@ -969,6 +969,17 @@ static ssize_t writeSegment( sout_access_out_t *p_access )
                 memcpy( output->p_buffer, p_sys->stuffing_bytes, p_sys->stuffing_size );
                 p_sys->stuffing_size = 0;
             }
+            else
+            {
+                /* The muxer may pass on the shared blocks of the input */
+                block_t *p_next = output->p_next;
+                output = block_Unshare( output );
+                if( unlikely(!output) )
+                {
+                    block_ChainRelease( p_next );
+                    return VLC_ENOMEM;
+                }
+            }
             size_t original = output->i_buffer;
             size_t padded = (output->i_buffer + 15 ) & ~15;
             size_t pad = padded - original;
@@ -32,6 +32,7 @@
 #include <vlc_plugin.h>
 #include <vlc_aout.h>
 #include <vlc_filter.h>
+#include <vlc_spectrum.h>
 
 #include <math.h>
 
@@ -55,9 +56,15 @@
 #define REPETITION_TIME_TEXT N_("Time between two alarm messages in ms" )
 #define REPETITION_TIME_LONGTEXT N_("Time between two alarm messages in ms. "\
                 "This value is used to avoid alarm saturation (default 2000)." )
+#define SPECTRUM_TEXT N_("Number of spectrum bands to send")
+#define SPECTRUM_LONGTEXT N_("Sends the level of this number of frequency bands "\
+                "with the barGraph information, 0 to disable (default 0)." )
 
 #define CFG_PREFIX "audiobargraph_a-"
 
+#define SPECTRUM_SIZE 512
+#define SPECTRUM_MAX_BANDS 32
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -80,6 +87,7 @@ vlc_module_begin ()
     add_integer( CFG_PREFIX "time_window", 5000, TIME_WINDOW_TEXT, TIME_WINDOW_LONGTEXT, false )
     add_float( CFG_PREFIX "alarm_threshold", 0.02, ALARM_THRESHOLD_TEXT, ALARM_THRESHOLD_LONGTEXT, false )
     add_integer( CFG_PREFIX "repetition_time", 2000, REPETITION_TIME_TEXT, REPETITION_TIME_LONGTEXT, false )
+    add_integer_with_range( CFG_PREFIX "spectrum", 0, 0, SPECTRUM_MAX_BANDS, SPECTRUM_TEXT, SPECTRUM_LONGTEXT, false )
     add_obsolete_integer( CFG_PREFIX "connection_reset" )
 
     set_callbacks( Open, Close )
@@ -104,6 +112,9 @@ typedef struct
     ValueDate_t*    last;
     int             started;
     vlc_tick_t      lastAlarm;
+    vlc_spectrum_t *spectrum;
+    unsigned        bands;
+    unsigned        band_start[SPECTRUM_MAX_BANDS + 1];
 } filter_sys_t;
 
 /*****************************************************************************
@@ -118,7 +129,7 @@ static int Open( vlc_object_t *p_this )
 
     static const char *const options[] = {
         "bargraph", "bargraph_repetition", "silence", "time_window",
-        "alarm_threshold", "repetition_time", NULL
+        "alarm_threshold", "repetition_time", "spectrum", NULL
     };
     config_ChainParse(p_filter, CFG_PREFIX, options, p_filter->p_cfg);
 
@@ -133,6 +144,34 @@ static int Open( vlc_object_t *p_this )
     p_sys->last = NULL;
     p_sys->started = 0;
     p_sys->lastAlarm = 0;
+    p_sys->spectrum = NULL;
+    p_sys->bands = var_CreateGetInteger(p_filter, CFG_PREFIX "spectrum");
+    if (p_sys->bands > SPECTRUM_MAX_BANDS)
+        p_sys->bands = SPECTRUM_MAX_BANDS;
+
+    if (p_sys->bargraph && p_sys->bands > 0) {
+        /* Not shared with the visualizations: they run after the other
+         * filters, such as the equalizer, and see other samples */
+        struct vlc_spectrum_cfg cfg;
+        vlc_spectrum_GetConfig(VLC_OBJECT(p_filter), SPECTRUM_SIZE, &cfg);
+        p_sys->spectrum = vlc_spectrum_Hold(VLC_OBJECT(p_filter), &cfg);
+        if (p_sys->spectrum == NULL) {
+            free(p_sys);
+            return VLC_ENOMEM;
+        }
+
+        /* Logarithmic bands, from the first frequency above 0 to the
+         * highest one, at least one frequency wide */
+        const float last = SPECTRUM_SIZE / 2 + 1;
+        p_sys->band_start[0] = 1;
+        for (unsigned i = 1; i <= p_sys->bands; i++) {
+            unsigned start = lroundf(powf(last, (float)i / p_sys->bands));
+            if (start <= p_sys->band_start[i - 1])
+                start = p_sys->band_start[i - 1] + 1;
+            p_sys->band_start[i] = start;
+        }
+        p_sys->band_start[p_sys->bands] = last;
+    }
 
     p_filter->fmt_in.audio.i_format = VLC_CODEC_FL32;
     aout_FormatPrepare(&p_filter->fmt_in.audio);
@@ -143,24 +182,50 @@ static int Open( vlc_object_t *p_this )
 
     var_Create(vlc, "audiobargraph_v-alarm", VLC_VAR_BOOL);
     var_Create(vlc, "audiobargraph_v-i_values", VLC_VAR_STRING);
+    if (p_sys->spectrum != NULL)
+        var_Create(vlc, "audiobargraph_v-spectrum", VLC_VAR_STRING);
 
     return VLC_SUCCESS;
 }
 
-static void SendValues(filter_t *p_filter, float *value, int nbChannels)
+static void SendValues(filter_t *p_filter, const char *name,
+                       const float *value, int count)
 {
-    char msg[256];
+    char msg[16 * SPECTRUM_MAX_BANDS];
     size_t len = 0;
 
-    for (int i = 0; i < nbChannels; i++) {
+    for (int i = 0; i < count; i++) {
         if (len >= sizeof (msg))
             break;
         len += snprintf(msg + len, sizeof (msg) - len, "%f:", value[i]);
     }
 
     //msg_Dbg(p_filter, "values: %s", msg);
-    var_SetString(vlc_object_instance(p_filter), "audiobargraph_v-i_values",
-                  msg);
+    var_SetString(vlc_object_instance(p_filter), name, msg);
+}
+
+/* Sends the amplitude of the loudest frequency of each band, 1 for a full
+ * scale sine without window */
+static void SendSpectrum(filter_t *p_filter, const block_t *p_in_buf,
+                         int nbChannels)
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    float power[SPECTRUM_SIZE / 2 + 1];
+    float value[SPECTRUM_MAX_BANDS];
+
+    if (vlc_spectrum_Compute(p_sys->spectrum, p_in_buf, nbChannels,
+                             power) != VLC_SUCCESS)
+        return;
+
+    for (unsigned i = 0; i < p_sys->bands; i++) {
+        float max = 0.f;
+        for (unsigned j = p_sys->band_start[i]; j < p_sys->band_start[i + 1]; j++)
+            if (power[j] > max)
+                max = power[j];
+        value[i] = sqrtf(max) / (SPECTRUM_SIZE / 2);
+    }
+
+    SendValues(p_filter, "audiobargraph_v-spectrum", value, p_sys->bands);
 }
 
 /*****************************************************************************
@@ -235,7 +300,9 @@ static block_t *DoWork( filter_t *p_filter, block_t *p_in_buf )
     }
 
     if (p_sys->bargraph && nbChannels > 0 && p_sys->counter++ > p_sys->bargraph_repetition) {
-        SendValues(p_filter, i_value, nbChannels);
+        SendValues(p_filter, "audiobargraph_v-i_values", i_value, nbChannels);
+        if (p_sys->spectrum != NULL)
+            SendSpectrum(p_filter, p_in_buf, nbChannels);
         p_sys->counter = 0;
     }
 
@@ -253,6 +320,10 @@ static void Close( vlc_object_t *p_this )
 
     var_Destroy(vlc, "audiobargraph_v-i_values");
     var_Destroy(vlc, "audiobargraph_v-alarm");
+    if (p_sys->spectrum != NULL) {
+        var_Destroy(vlc, "audiobargraph_v-spectrum");
+        vlc_spectrum_Release(p_sys->spectrum);
+    }
 
     while (p_sys->first != NULL) {
         ValueDate_t *current = p_sys->first;
@@ -0,0 +1,422 @@
+/*****************************************************************************
+ * biquad.c : vectorized biquad filters banks
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef BIQUAD_TEST
+# undef NDEBUG
+#endif
+
+#include <assert.h>
+#include <math.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+
+#include "biquad.h"
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+#endif
+#ifdef __ARM_NEON
+# include <arm_neon.h>
+#endif
+
+#define BIQUAD_WIDTH_MAX 8   /* floats in the widest vector */
+#define BIQUAD_ALIGN     32
+#define BIQUAD_CHUNK     64  /* frames deinterleaved at once */
+
+/* The filters state is flushed to zero below this level (about -600 dB),
+ * as the decay of the filters would otherwise end up in denormals, which are
+ * very slow to process, after a period of silence. */
+#define BIQUAD_DENORMAL  1e-30f
+
+typedef void (*biquad_kernel_t)( biquad_bank_t *, float *, unsigned );
+
+struct biquad_bank
+{
+    unsigned channels;
+    unsigned stages;
+    unsigned lanes; /* channels, rounded up to the kernel width */
+    biquad_kernel_t kernel;
+    const char *kernel_name;
+
+    /* Coefficients and gains are repeated in each lane */
+    float *coeffs; /* [stages][5][BIQUAD_WIDTH_MAX] */
+    float *gains;  /* [stages][BIQUAD_WIDTH_MAX] */
+    float *dry;    /* [BIQUAD_WIDTH_MAX] */
+    float *state;  /* [stages][x1, x2, y1, y2][lanes] */
+    float *buf;    /* [BIQUAD_CHUNK][lanes] */
+    float *mix;    /* [BIQUAD_CHUNK][lanes], output of a parallel bank */
+};
+
+/* C */
+#define BQ_NAME  C
+#define BQ_WIDTH 1
+#define BQ_ATTR
+#define BQ_VEC   float
+#define BQ_ADD(a, b) ((a) + (b))
+#define BQ_SUB(a, b) ((a) - (b))
+#define BQ_MUL(a, b) ((a) * (b))
+#define BQ_LOAD(p) (*(p))
+#define BQ_STORE(p, v) (*(p) = (v))
+#include "biquad_simd.h"
+
+#ifdef HAVE_SSE2_INTRINSICS
+# define BQ_NAME  SSE2
+# define BQ_WIDTH 4
+# define BQ_ATTR  __attribute__ ((__target__ ("sse2")))
+# define BQ_VEC   __m128
+# define BQ_ADD   _mm_add_ps
+# define BQ_SUB   _mm_sub_ps
+# define BQ_MUL   _mm_mul_ps
+# define BQ_LOAD  _mm_load_ps
+# define BQ_STORE _mm_store_ps
+# include "biquad_simd.h"
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+# define BQ_NAME  AVX
+# define BQ_WIDTH 8
+# define BQ_ATTR  __attribute__ ((__target__ ("avx")))
+# define BQ_VEC   __m256
+# define BQ_ADD   _mm256_add_ps
+# define BQ_SUB   _mm256_sub_ps
+# define BQ_MUL   _mm256_mul_ps
+# define BQ_LOAD  _mm256_load_ps
+# define BQ_STORE _mm256_store_ps
+# include "biquad_simd.h"
+#endif
+
+#ifdef __ARM_NEON
+# define BQ_NAME  NEON
+# define BQ_WIDTH 4
+# define BQ_ATTR
+# define BQ_VEC   float32x4_t
+# define BQ_ADD   vaddq_f32
+# define BQ_SUB   vsubq_f32
+# define BQ_MUL   vmulq_f32
+# define BQ_LOAD  vld1q_f32
+# define BQ_STORE vst1q_f32
+# include "biquad_simd.h"
+#endif
+
+static const struct
+{
+    const char *name;
+    unsigned width;
+    biquad_kernel_t cascade, parallel;
+} kernels[] = {
+#ifdef HAVE_AVX2_INTRINSICS
+    { "avx", 8, AVX_Cascade, AVX_Parallel },
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+    { "sse2", 4, SSE2_Cascade, SSE2_Parallel },
+#endif
+#ifdef __ARM_NEON
+    { "neon", 4, NEON_Cascade, NEON_Parallel },
+#endif
+    { "c", 1, C_Cascade, C_Parallel },
+};
+
+biquad_bank_t *biquad_bank_New( unsigned channels, unsigned stages,
+                                bool parallel, const char *kernel )
+{
+    const bool any = !strcmp( kernel, "any" );
+    size_t k;
+
+    assert( channels > 0 );
+    for( k = 0; k < ARRAY_SIZE(kernels); k++ )
+    {
+        if( !any && strcmp( kernel, kernels[k].name ) )
+            continue;
+        if( !vlc_CPU_CheckKernels( kernels[k].name ) )
+            continue;
+        /* Wider vectors are only worth it if they are filled */
+        if( any && kernels[k].width > 4 && channels <= 4 )
+            continue;
+        break;
+    }
+    if( k == ARRAY_SIZE(kernels) )
+        return NULL;
+
+    biquad_bank_t *bank = malloc( sizeof(*bank) );
+    if( unlikely(bank == NULL) )
+        return NULL;
+
+    bank->channels = channels;
+    bank->stages = stages;
+    bank->lanes = (channels + kernels[k].width - 1) / kernels[k].width
+                * kernels[k].width;
+    bank->kernel = parallel ? kernels[k].parallel : kernels[k].cascade;
+    bank->kernel_name = kernels[k].name;
+    bank->coeffs = vlc_CPU_AllocFloats( stages * 5 * BIQUAD_WIDTH_MAX,
+                                        BIQUAD_ALIGN );
+    bank->gains = vlc_CPU_AllocFloats( stages * BIQUAD_WIDTH_MAX,
+                                       BIQUAD_ALIGN );
+    bank->dry = vlc_CPU_AllocFloats( BIQUAD_WIDTH_MAX, BIQUAD_ALIGN );
+    bank->state = vlc_CPU_AllocFloats( stages * 4 * bank->lanes,
+                                       BIQUAD_ALIGN );
+    bank->buf = vlc_CPU_AllocFloats( BIQUAD_CHUNK * bank->lanes,
+                                     BIQUAD_ALIGN );
+    bank->mix = parallel ? vlc_CPU_AllocFloats( BIQUAD_CHUNK * bank->lanes,
+                                                BIQUAD_ALIGN ) : NULL;
+    if( unlikely(bank->coeffs == NULL || bank->gains == NULL
+              || bank->dry == NULL || bank->state == NULL || bank->buf == NULL
+              || (parallel && bank->mix == NULL)) )
+    {
+        biquad_bank_Delete( bank );
+        return NULL;
+    }
+    return bank;
+}
+
+void biquad_bank_Delete( biquad_bank_t *bank )
+{
+    aligned_free( bank->mix );
+    aligned_free( bank->buf );
+    aligned_free( bank->state );
+    aligned_free( bank->dry );
+    aligned_free( bank->gains );
+    aligned_free( bank->coeffs );
+    free( bank );
+}
+
+const char *biquad_bank_Kernel( const biquad_bank_t *bank )
+{
+    return bank->kernel_name;
+}
+
+void biquad_bank_SetCoeffs( biquad_bank_t *bank, unsigned stage,
+                            const biquad_coeffs_t *coeffs )
+{
+    const float values[5] = {
+        coeffs->b0, coeffs->b1, coeffs->b2, coeffs->a1, coeffs->a2,
+    };
+    float *c = &bank->coeffs[stage * 5 * BIQUAD_WIDTH_MAX];
+
+    assert( stage < bank->stages );
+    for( unsigned j = 0; j < 5; j++ )
+        for( unsigned i = 0; i < BIQUAD_WIDTH_MAX; i++ )
+            c[j * BIQUAD_WIDTH_MAX + i] = values[j];
+}
+
+void biquad_bank_SetGains( biquad_bank_t *bank, float dry, const float *gains )
+{
+    for( unsigned i = 0; i < BIQUAD_WIDTH_MAX; i++ )
+        bank->dry[i] = dry;
+    for( unsigned s = 0; s < bank->stages; s++ )
+        for( unsigned i = 0; i < BIQUAD_WIDTH_MAX; i++ )
+            bank->gains[s * BIQUAD_WIDTH_MAX + i] = gains[s];
+}
+
+void biquad_bank_Reset( biquad_bank_t *bank )
+{
+    memset( bank->state, 0, bank->stages * 4 * bank->lanes * sizeof(float) );
+}
+
+void biquad_bank_Process( biquad_bank_t *bank, float *out, const float *in,
+                          unsigned frames )
+{
+    const unsigned channels = bank->channels;
+    const unsigned lanes = bank->lanes;
+
+    while( frames > 0 )
+    {
+        const unsigned count = __MIN( frames, BIQUAD_CHUNK );
+
+        /* The padding lanes stay zero, and so does their state */
+        for( unsigned i = 0; i < count; i++ )
+            memcpy( &bank->buf[i * lanes], &in[i * channels],
+                    channels * sizeof(float) );
+
+        bank->kernel( bank, bank->buf, count );
+
+        for( unsigned i = 0; i < count; i++ )
+            memcpy( &out[i * channels], &bank->buf[i * lanes],
+                    channels * sizeof(float) );
+
+        in += count * channels;
+        out += count * channels;
+        frames -= count;
+    }
+
+    for( unsigned i = 0; i < bank->stages * 4 * lanes; i++ )
+        if( fabsf( bank->state[i] ) < BIQUAD_DENORMAL )
+            bank->state[i] = 0.f;
+}
+
+#ifdef BIQUAD_TEST
+#include <stdio.h>
+#include <unistd.h>
+
+static void Fill( float *p, size_t count, unsigned seed )
+{
+    for( size_t i = 0; i < count; i++ )
+    {
+        seed = seed * 1103515245 + 12345;
+        p[i] = (float)((seed >> 8) & 0xffff) / 32768.f - 1.f;
+    }
+}
+
+static void SetupBank( biquad_bank_t *bank, unsigned stages, bool parallel )
+{
+    float gains[16];
+
+    for( unsigned s = 0; s < stages; s++ )
+    {
+        /* Some peaking filters, from the RBJ audio EQ cookbook */
+        const float w0 = 2.f * (float)M_PI * (60.f * (s + 1) * (s + 1))
+                       / 48000.f;
+        const float alpha = sinf( w0 ) / (2.f * 1.4f);
+        const float A = powf( 10.f, (s & 1 ? 6.f : -4.f) / 40.f );
+        const float a0 = 1.f + alpha / A;
+        const biquad_coeffs_t c = {
+            .b0 = (1.f + alpha * A) / a0,
+            .b1 = -2.f * cosf( w0 ) / a0,
+            .b2 = (1.f - alpha * A) / a0,
+            .a1 = -2.f * cosf( w0 ) / a0,
+            .a2 = (1.f - alpha / A) / a0,
+        };
+        biquad_bank_SetCoeffs( bank, s, &c );
+        gains[s] = 0.1f * (s + 1);
+    }
+    if( parallel )
+        biquad_bank_SetGains( bank, 0.25f, gains );
+}
+
+#ifndef BIQUAD_BENCH
+static void Test( const char *kernel, unsigned channels, unsigned stages,
+                  bool parallel )
+{
+    const unsigned frames = 4800;
+    biquad_bank_t *ref = biquad_bank_New( channels, stages, parallel, "c" );
+    biquad_bank_t *bank = biquad_bank_New( channels, stages, parallel,
+                                           kernel );
+    float *in = malloc( frames * channels * sizeof(float) );
+    float *out_ref = malloc( frames * channels * sizeof(float) );
+    float *out = malloc( frames * channels * sizeof(float) );
+
+    assert( ref != NULL && bank != NULL );
+    assert( in != NULL && out_ref != NULL && out != NULL );
+    SetupBank( ref, stages, parallel );
+    SetupBank( bank, stages, parallel );
+    Fill( in, frames * channels, channels );
+
+    /* Odd block sizes, to cross the chunks */
+    for( unsigned done = 0, count = 1; done < frames; count = count * 3 + 7 )
+    {
+        count = __MIN( count, frames - done );
+        biquad_bank_Process( ref, &out_ref[done * channels],
+                             &in[done * channels], count );
+        biquad_bank_Process( bank, &out[done * channels],
+                             &in[done * channels], count );
+        done += count;
+    }
+
+    for( unsigned i = 0; i < frames * channels; i++ )
+        assert( fabsf( out[i] - out_ref[i] )
+                <= 1e-4f * __MAX( 1.f, fabsf( out_ref[i] ) ) );
+
+    /* Silence must flush the history */
+    memset( in, 0, frames * channels * sizeof(float) );
+    for( unsigned i = 0; i < 200; i++ )
+        biquad_bank_Process( bank, out, in, frames );
+    for( unsigned i = 0; i < frames * channels; i++ )
+        assert( out[i] == 0.f );
+
+    free( out );
+    free( out_ref );
+    free( in );
+    biquad_bank_Delete( bank );
+    biquad_bank_Delete( ref );
+}
+#else
+static void Bench( const char *kernel, unsigned channels, unsigned rate,
+                   unsigned stages, bool parallel )
+{
+    const unsigned frames = rate / 100; /* 10 ms blocks */
+    const unsigned loops = 2000;
+    biquad_bank_t *bank = biquad_bank_New( channels, stages, parallel,
+                                           kernel );
+    float *buf = malloc( frames * channels * sizeof(float) );
+
+    assert( bank != NULL && buf != NULL );
+    SetupBank( bank, stages, parallel );
+    Fill( buf, frames * channels, 1 );
+
+    vlc_tick_t time = vlc_tick_now();
+    for( unsigned i = 0; i < loops; i++ )
+        biquad_bank_Process( bank, buf, buf, frames );
+    time = vlc_tick_now() - time;
+
+    printf( "%-4s %s %2u stages %u ch %3u kHz: %6.1f Msamples/s\n",
+            kernel, parallel ? "parallel" : "cascade ", stages, channels,
+            rate / 1000, (double)frames * channels * loops / 1e6
+            / secf_from_vlc_tick( __MAX(time, 1) ) );
+
+    free( buf );
+    biquad_bank_Delete( bank );
+}
+#endif
+
+int main( void )
+{
+    static const unsigned channels[] = { 1, 2, 5, 6, 8, 9 };
+
+#ifndef BIQUAD_BENCH
+    alarm( 30 );
+#endif
+
+    for( size_t k = 0; k < ARRAY_SIZE(kernels); k++ )
+    {
+        if( !vlc_CPU_CheckKernels( kernels[k].name ) )
+        {
+            fprintf( stderr, "WARNING: could not test %s\n",
+                     kernels[k].name );
+            continue;
+        }
+
+#ifndef BIQUAD_BENCH
+        for( size_t i = 0; i < ARRAY_SIZE(channels); i++ )
+        {
+            /* The param_eq and the equalizer layouts */
+            Test( kernels[k].name, channels[i], 5, false );
+            Test( kernels[k].name, channels[i], 10, true );
+        }
+#else
+        static const unsigned bench_channels[] = { 2, 6, 8 };
+        for( size_t i = 0; i < ARRAY_SIZE(bench_channels); i++ )
+            for( unsigned rate = 48000; rate <= 96000; rate *= 2 )
+            {
+                Bench( kernels[k].name, bench_channels[i], rate, 5, false );
+                Bench( kernels[k].name, bench_channels[i], rate, 10, true );
+            }
+        (void) channels;
+#endif
+    }
+    return 0;
+}
+#endif
@@ -0,0 +1,71 @@
+/*****************************************************************************
+ * biquad.h : vectorized biquad filters banks
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_AUDIO_FILTER_BIQUAD_H
+#define VLC_AUDIO_FILTER_BIQUAD_H
+
+/**
+ * Direct form I biquad coefficients, normalized by a0:
+ * y[n] = b0 x[n] + b1 x[n-1] + b2 x[n-2] - a1 y[n-1] - a2 y[n-2]
+ */
+typedef struct
+{
+    float b0, b1, b2;
+    float a1, a2;
+} biquad_coeffs_t;
+
+/**
+ * A bank of biquad stages, applied to every channel of interleaved float
+ * samples. The channels are processed in the lanes of the SIMD vectors.
+ *
+ * The stages are either cascaded, each one filtering the output of the
+ * previous one, or parallel, all filtering the input, in which case the
+ * output is the input times the dry gain, plus the output of each stage times
+ * its gain.
+ */
+typedef struct biquad_bank biquad_bank_t;
+
+/**
+ * Creates a bank with all its coefficients and gains set to zero.
+ *
+ * \param kernel "any" for the fastest kernel available, or the name of a
+ * specific one ("c", "sse2", "avx", "neon")
+ * \return the bank, or NULL on error or if the kernel is not available
+ */
+biquad_bank_t *biquad_bank_New( unsigned channels, unsigned stages,
+                                bool parallel, const char *kernel );
+void biquad_bank_Delete( biquad_bank_t * );
+
+/** Returns the name of the kernel used by the bank */
+const char *biquad_bank_Kernel( const biquad_bank_t * );
+
+void biquad_bank_SetCoeffs( biquad_bank_t *, unsigned stage,
+                            const biquad_coeffs_t * );
+/** Sets the gains of a parallel bank, gains has one value per stage */
+void biquad_bank_SetGains( biquad_bank_t *, float dry, const float *gains );
+
+/** Clears the filters history */
+void biquad_bank_Reset( biquad_bank_t * );
+
+/** Filters frames of interleaved samples, out can be equal to in */
+void biquad_bank_Process( biquad_bank_t *, float *out, const float *in,
+                          unsigned frames );
+
+#endif
@@ -0,0 +1,197 @@
+/*****************************************************************************
+ * biquad_simd.h : biquad filters bank kernels
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* This file is included by biquad.c once per instruction set, with BQ_NAME,
+ * BQ_WIDTH, BQ_ATTR, the BQ_VEC type and its operations defined. Each vector
+ * holds BQ_WIDTH channels of one frame, the chunks of frames being
+ * deinterleaved with the channels padded to a multiple of BQ_WIDTH. The
+ * operations are done in the same order by all the kernels, without fused
+ * multiply-adds. */
+
+#define BQ_CAT_(a, b) a##b
+#define BQ_CAT(a, b) BQ_CAT_(a, b)
+
+/* Runs one stage over the frames of one group of channels, with its state
+ * in registers. The y[n-1] term comes last, as it is the only one on the
+ * critical path from one frame to the next. */
+BQ_ATTR
+static inline void BQ_CAT(BQ_NAME, _Stage)(const float *restrict c,
+                                           float *restrict state,
+                                           const float *in, float *out,
+                                           const float *gain, unsigned lanes,
+                                           unsigned frames)
+{
+    const BQ_VEC b0 = BQ_LOAD(&c[0 * BIQUAD_WIDTH_MAX]);
+    const BQ_VEC b1 = BQ_LOAD(&c[1 * BIQUAD_WIDTH_MAX]);
+    const BQ_VEC b2 = BQ_LOAD(&c[2 * BIQUAD_WIDTH_MAX]);
+    const BQ_VEC a1 = BQ_LOAD(&c[3 * BIQUAD_WIDTH_MAX]);
+    const BQ_VEC a2 = BQ_LOAD(&c[4 * BIQUAD_WIDTH_MAX]);
+    BQ_VEC x1 = BQ_LOAD(&state[0 * lanes]);
+    BQ_VEC x2 = BQ_LOAD(&state[1 * lanes]);
+    BQ_VEC y1 = BQ_LOAD(&state[2 * lanes]);
+    BQ_VEC y2 = BQ_LOAD(&state[3 * lanes]);
+
+    for (unsigned i = 0; i < frames; i++)
+    {
+        const BQ_VEC x = BQ_LOAD(&in[i * lanes]);
+        BQ_VEC y;
+
+        y = BQ_MUL(x, b0);
+        y = BQ_ADD(y, BQ_MUL(x1, b1));
+        y = BQ_ADD(y, BQ_MUL(x2, b2));
+        y = BQ_SUB(y, BQ_MUL(y2, a2));
+        y = BQ_SUB(y, BQ_MUL(y1, a1));
+
+        if (gain != NULL) /* parallel: mix the output */
+            BQ_STORE(&out[i * lanes], BQ_ADD(BQ_LOAD(&out[i * lanes]),
+                                             BQ_MUL(y, BQ_LOAD(gain))));
+        else
+            BQ_STORE(&out[i * lanes], y);
+
+        x2 = x1;
+        x1 = x;
+        y2 = y1;
+        y1 = y;
+    }
+
+    BQ_STORE(&state[0 * lanes], x1);
+    BQ_STORE(&state[1 * lanes], x2);
+    BQ_STORE(&state[2 * lanes], y1);
+    BQ_STORE(&state[3 * lanes], y2);
+}
+
+/* Runs two stages of a parallel bank together and mixes their outputs: the
+ * two recursions are independent, so that their latencies overlap. */
+BQ_ATTR
+static inline void BQ_CAT(BQ_NAME, _Stage2)(const float *restrict c,
+                                            float *restrict state,
+                                            const float *in, float *out,
+                                            const float *gain, unsigned lanes,
+                                            unsigned frames)
+{
+    const float *restrict d = c + 5 * BIQUAD_WIDTH_MAX;
+    float *restrict dstate = state + 4 * lanes;
+    const BQ_VEC g0 = BQ_LOAD(&gain[0]);
+    const BQ_VEC g1 = BQ_LOAD(&gain[BIQUAD_WIDTH_MAX]);
+    BQ_VEC x1 = BQ_LOAD(&state[0 * lanes]);
+    BQ_VEC x2 = BQ_LOAD(&state[1 * lanes]);
+    BQ_VEC y1 = BQ_LOAD(&state[2 * lanes]);
+    BQ_VEC y2 = BQ_LOAD(&state[3 * lanes]);
+    BQ_VEC v1 = BQ_LOAD(&dstate[2 * lanes]);
+    BQ_VEC v2 = BQ_LOAD(&dstate[3 * lanes]);
+
+    /* Both stages share the same input history */
+    for (unsigned i = 0; i < frames; i++)
+    {
+        const BQ_VEC x = BQ_LOAD(&in[i * lanes]);
+        BQ_VEC y, v;
+
+        y = BQ_MUL(x, BQ_LOAD(&c[0 * BIQUAD_WIDTH_MAX]));
+        v = BQ_MUL(x, BQ_LOAD(&d[0 * BIQUAD_WIDTH_MAX]));
+        y = BQ_ADD(y, BQ_MUL(x1, BQ_LOAD(&c[1 * BIQUAD_WIDTH_MAX])));
+        v = BQ_ADD(v, BQ_MUL(x1, BQ_LOAD(&d[1 * BIQUAD_WIDTH_MAX])));
+        y = BQ_ADD(y, BQ_MUL(x2, BQ_LOAD(&c[2 * BIQUAD_WIDTH_MAX])));
+        v = BQ_ADD(v, BQ_MUL(x2, BQ_LOAD(&d[2 * BIQUAD_WIDTH_MAX])));
+        y = BQ_SUB(y, BQ_MUL(y2, BQ_LOAD(&c[4 * BIQUAD_WIDTH_MAX])));
+        v = BQ_SUB(v, BQ_MUL(v2, BQ_LOAD(&d[4 * BIQUAD_WIDTH_MAX])));
+        y = BQ_SUB(y, BQ_MUL(y1, BQ_LOAD(&c[3 * BIQUAD_WIDTH_MAX])));
+        v = BQ_SUB(v, BQ_MUL(v1, BQ_LOAD(&d[3 * BIQUAD_WIDTH_MAX])));
+
+        BQ_STORE(&out[i * lanes],
+                 BQ_ADD(BQ_ADD(BQ_LOAD(&out[i * lanes]), BQ_MUL(y, g0)),
+                        BQ_MUL(v, g1)));
+
+        x2 = x1;
+        x1 = x;
+        y2 = y1;
+        y1 = y;
+        v2 = v1;
+        v1 = v;
+    }
+
+    BQ_STORE(&state[0 * lanes], x1);
+    BQ_STORE(&state[1 * lanes], x2);
+    BQ_STORE(&state[2 * lanes], y1);
+    BQ_STORE(&state[3 * lanes], y2);
+    BQ_STORE(&dstate[0 * lanes], x1);
+    BQ_STORE(&dstate[1 * lanes], x2);
+    BQ_STORE(&dstate[2 * lanes], v1);
+    BQ_STORE(&dstate[3 * lanes], v2);
+}
+
+BQ_ATTR
+static void BQ_CAT(BQ_NAME, _Cascade)(biquad_bank_t *bank, float *buf,
+                                      unsigned frames)
+{
+    const unsigned lanes = bank->lanes;
+
+    /* Each stage filters the whole chunk in place, one after the other */
+    for (unsigned g = 0; g < lanes; g += BQ_WIDTH)
+        for (unsigned s = 0; s < bank->stages; s++)
+            BQ_CAT(BQ_NAME, _Stage)(&bank->coeffs[s * 5 * BIQUAD_WIDTH_MAX],
+                                    &bank->state[s * 4 * lanes + g],
+                                    &buf[g], &buf[g], NULL, lanes, frames);
+}
+
+BQ_ATTR
+static void BQ_CAT(BQ_NAME, _Parallel)(biquad_bank_t *bank, float *buf,
+                                       unsigned frames)
+{
+    const unsigned lanes = bank->lanes;
+    float *mix = bank->mix;
+
+    for (unsigned g = 0; g < lanes; g += BQ_WIDTH)
+    {
+        const BQ_VEC dry = BQ_LOAD(bank->dry);
+
+        for (unsigned i = 0; i < frames; i++)
+            BQ_STORE(&mix[i * lanes + g], BQ_MUL(BQ_LOAD(&buf[i * lanes + g]),
+                                                 dry));
+
+        unsigned s = 0;
+        for (; s + 1 < bank->stages; s += 2)
+            BQ_CAT(BQ_NAME, _Stage2)(&bank->coeffs[s * 5 * BIQUAD_WIDTH_MAX],
+                                     &bank->state[s * 4 * lanes + g],
+                                     &buf[g], &mix[g],
+                                     &bank->gains[s * BIQUAD_WIDTH_MAX],
+                                     lanes, frames);
+        if (s < bank->stages)
+            BQ_CAT(BQ_NAME, _Stage)(&bank->coeffs[s * 5 * BIQUAD_WIDTH_MAX],
+                                    &bank->state[s * 4 * lanes + g],
+                                    &buf[g], &mix[g],
+                                    &bank->gains[s * BIQUAD_WIDTH_MAX],
+                                    lanes, frames);
+
+        for (unsigned i = 0; i < frames; i++)
+            BQ_STORE(&buf[i * lanes + g], BQ_LOAD(&mix[i * lanes + g]));
+    }
+}
+
+#undef BQ_CAT
+#undef BQ_CAT_
+#undef BQ_STORE
+#undef BQ_LOAD
+#undef BQ_MUL
+#undef BQ_SUB
+#undef BQ_ADD
+#undef BQ_VEC
+#undef BQ_ATTR
+#undef BQ_WIDTH
+#undef BQ_NAME
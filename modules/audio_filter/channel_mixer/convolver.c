@@ -0,0 +1,518 @@
+/*****************************************************************************
+ * convolver.c : uniformly partitioned FFT convolution
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef CONVOLVER_TEST
+# undef NDEBUG
+#endif
+
+#include <assert.h>
+#include <math.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+#include <vlc_fft.h>
+
+#include "convolver.h"
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+#endif
+#ifdef __ARM_NEON
+# include <arm_neon.h>
+#endif
+
+#define CONVOLVER_ALIGN 32
+
+/* Complex multiply-accumulate of count bins, in split format */
+typedef void (*convolver_mac_t)( float *restrict acc_re,
+                                 float *restrict acc_im,
+                                 const float *x_re, const float *x_im,
+                                 const float *h_re, const float *h_im,
+                                 unsigned count );
+
+struct convolver
+{
+    unsigned inputs;
+    unsigned outputs;
+    unsigned block;      /* partition size, B */
+    unsigned partitions; /* P */
+    unsigned stride;     /* bins per spectrum, B + 1 rounded up */
+    unsigned head;       /* most recent input spectrum */
+
+    vlc_fft_t *fft;      /* of 2 B samples */
+    convolver_mac_t mac;
+    const char *kernel_name;
+
+    float *filters;  /* [input][output][P][re, im][stride] */
+    float *spectra;  /* [input][P][re, im][stride], delay line */
+    float *history;  /* [input][B], previous input block */
+    float *frame;    /* [2 B] */
+    float *acc;      /* [re, im][stride] */
+};
+
+static void MacC( float *restrict acc_re, float *restrict acc_im,
+                  const float *x_re, const float *x_im,
+                  const float *h_re, const float *h_im, unsigned count )
+{
+    for( unsigned i = 0; i < count; i++ )
+    {
+        acc_re[i] += x_re[i] * h_re[i] - x_im[i] * h_im[i];
+        acc_im[i] += x_re[i] * h_im[i] + x_im[i] * h_re[i];
+    }
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+__attribute__ ((__target__ ("sse2")))
+static void MacSSE2( float *restrict acc_re, float *restrict acc_im,
+                     const float *x_re, const float *x_im,
+                     const float *h_re, const float *h_im, unsigned count )
+{
+    for( unsigned i = 0; i < count; i += 4 )
+    {
+        const __m128 xr = _mm_load_ps( &x_re[i] ), xi = _mm_load_ps( &x_im[i] );
+        const __m128 hr = _mm_load_ps( &h_re[i] ), hi = _mm_load_ps( &h_im[i] );
+
+        _mm_store_ps( &acc_re[i], _mm_add_ps( _mm_load_ps( &acc_re[i] ),
+                      _mm_sub_ps( _mm_mul_ps( xr, hr ), _mm_mul_ps( xi, hi ) ) ) );
+        _mm_store_ps( &acc_im[i], _mm_add_ps( _mm_load_ps( &acc_im[i] ),
+                      _mm_add_ps( _mm_mul_ps( xr, hi ), _mm_mul_ps( xi, hr ) ) ) );
+    }
+}
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+__attribute__ ((__target__ ("avx")))
+static void MacAVX( float *restrict acc_re, float *restrict acc_im,
+                    const float *x_re, const float *x_im,
+                    const float *h_re, const float *h_im, unsigned count )
+{
+    for( unsigned i = 0; i < count; i += 8 )
+    {
+        const __m256 xr = _mm256_load_ps( &x_re[i] );
+        const __m256 xi = _mm256_load_ps( &x_im[i] );
+        const __m256 hr = _mm256_load_ps( &h_re[i] );
+        const __m256 hi = _mm256_load_ps( &h_im[i] );
+
+        _mm256_store_ps( &acc_re[i],
+                         _mm256_add_ps( _mm256_load_ps( &acc_re[i] ),
+                                        _mm256_sub_ps( _mm256_mul_ps( xr, hr ),
+                                                   _mm256_mul_ps( xi, hi ) ) ) );
+        _mm256_store_ps( &acc_im[i],
+                         _mm256_add_ps( _mm256_load_ps( &acc_im[i] ),
+                                        _mm256_add_ps( _mm256_mul_ps( xr, hi ),
+                                                   _mm256_mul_ps( xi, hr ) ) ) );
+    }
+}
+#endif
+
+#ifdef __ARM_NEON
+static void MacNEON( float *restrict acc_re, float *restrict acc_im,
+                     const float *x_re, const float *x_im,
+                     const float *h_re, const float *h_im, unsigned count )
+{
+    for( unsigned i = 0; i < count; i += 4 )
+    {
+        const float32x4_t xr = vld1q_f32( &x_re[i] );
+        const float32x4_t xi = vld1q_f32( &x_im[i] );
+        const float32x4_t hr = vld1q_f32( &h_re[i] );
+        const float32x4_t hi = vld1q_f32( &h_im[i] );
+
+        vst1q_f32( &acc_re[i], vmlsq_f32( vmlaq_f32( vld1q_f32( &acc_re[i] ),
+                                                     xr, hr ), xi, hi ) );
+        vst1q_f32( &acc_im[i], vmlaq_f32( vmlaq_f32( vld1q_f32( &acc_im[i] ),
+                                                     xr, hi ), xi, hr ) );
+    }
+}
+#endif
+
+static const struct
+{
+    const char *name;
+    convolver_mac_t mac;
+} kernels[] = {
+#ifdef HAVE_AVX2_INTRINSICS
+    { "avx", MacAVX },
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+    { "sse2", MacSSE2 },
+#endif
+#ifdef __ARM_NEON
+    { "neon", MacNEON },
+#endif
+    { "c", MacC },
+};
+
+static float *Filter( convolver_t *c, unsigned input, unsigned output,
+                      unsigned p )
+{
+    return &c->filters[(((size_t)input * c->outputs + output)
+                        * c->partitions + p) * 2 * c->stride];
+}
+
+static float *Spectrum( convolver_t *c, unsigned input, unsigned slot )
+{
+    return &c->spectra[((size_t)input * c->partitions + slot)
+                       * 2 * c->stride];
+}
+
+convolver_t *convolver_New( unsigned inputs, unsigned outputs,
+                            unsigned partition, unsigned taps,
+                            const char *kernel )
+{
+    const bool any = !strcmp( kernel, "any" );
+    size_t k;
+
+    if( inputs == 0 || outputs == 0 || taps == 0
+     || partition < 2 || (partition & (partition - 1)) )
+        return NULL;
+
+    for( k = 0; k < ARRAY_SIZE(kernels); k++ )
+        if( (any || !strcmp( kernel, kernels[k].name ))
+         && vlc_CPU_CheckKernels( kernels[k].name ) )
+            break;
+    if( k == ARRAY_SIZE(kernels) )
+        return NULL;
+
+    convolver_t *c = calloc( 1, sizeof(*c) );
+    if( unlikely(c == NULL) )
+        return NULL;
+
+    c->inputs = inputs;
+    c->outputs = outputs;
+    c->block = partition;
+    c->partitions = (taps + partition - 1) / partition;
+    /* The padding bins stay zero in all the spectra */
+    c->stride = (partition + 1 + 7) & ~7u;
+    c->mac = kernels[k].mac;
+    c->kernel_name = kernels[k].name;
+
+    const size_t spectrum = 2 * c->stride;
+    c->fft = vlc_fft_New( 2 * partition );
+    c->filters = vlc_CPU_AllocFloats( (size_t)inputs * outputs * c->partitions
+                                      * spectrum, CONVOLVER_ALIGN );
+    c->spectra = vlc_CPU_AllocFloats( (size_t)inputs * c->partitions
+                                      * spectrum, CONVOLVER_ALIGN );
+    c->history = vlc_CPU_AllocFloats( (size_t)inputs * partition,
+                                      CONVOLVER_ALIGN );
+    c->frame = vlc_CPU_AllocFloats( 2 * partition, CONVOLVER_ALIGN );
+    c->acc = vlc_CPU_AllocFloats( spectrum, CONVOLVER_ALIGN );
+    if( c->fft == NULL || c->filters == NULL || c->spectra == NULL
+     || c->history == NULL || c->frame == NULL || c->acc == NULL )
+    {
+        convolver_Delete( c );
+        return NULL;
+    }
+    return c;
+}
+
+void convolver_Delete( convolver_t *c )
+{
+    aligned_free( c->acc );
+    aligned_free( c->frame );
+    aligned_free( c->history );
+    aligned_free( c->spectra );
+    aligned_free( c->filters );
+    if( c->fft != NULL )
+        vlc_fft_Delete( c->fft );
+    free( c );
+}
+
+const char *convolver_Kernel( const convolver_t *c )
+{
+    return c->kernel_name;
+}
+
+void convolver_SetFilter( convolver_t *c, unsigned input, unsigned output,
+                          const float *h, unsigned taps )
+{
+    const unsigned b = c->block;
+
+    assert( input < c->inputs && output < c->outputs );
+    assert( taps <= c->partitions * b );
+
+    /* Overlap-save: each partition is padded with as many zeros, so that
+     * its circular convolution with two input blocks is exact on the
+     * second one */
+    for( unsigned p = 0; p < c->partitions; p++ )
+    {
+        const unsigned offset = p * b;
+        const unsigned count = taps > offset ? __MIN( taps - offset, b ) : 0;
+        float *spectrum = Filter( c, input, output, p );
+
+        memset( c->frame, 0, 2 * b * sizeof(float) );
+        if( count > 0 )
+            memcpy( c->frame, &h[offset], count * sizeof(float) );
+        vlc_fft_Real( c->fft, c->frame, spectrum, spectrum + c->stride );
+    }
+}
+
+void convolver_Reset( convolver_t *c )
+{
+    memset( c->spectra, 0, (size_t)c->inputs * c->partitions * 2 * c->stride
+                           * sizeof(float) );
+    memset( c->history, 0, (size_t)c->inputs * c->block * sizeof(float) );
+    c->head = 0;
+}
+
+void convolver_Process( convolver_t *c, float *const *out,
+                        const float *const *in, unsigned frames )
+{
+    const unsigned b = c->block, parts = c->partitions, n = c->stride;
+
+    assert( frames % b == 0 );
+
+    for( unsigned offset = 0; offset < frames; offset += b )
+    {
+        c->head = (c->head + 1) % parts;
+
+        /* Transform the last two blocks of each input */
+        for( unsigned i = 0; i < c->inputs; i++ )
+        {
+            float *history = &c->history[(size_t)i * b];
+            float *spectrum = Spectrum( c, i, c->head );
+
+            memcpy( c->frame, history, b * sizeof(float) );
+            memcpy( &c->frame[b], &in[i][offset], b * sizeof(float) );
+            memcpy( history, &in[i][offset], b * sizeof(float) );
+            vlc_fft_Real( c->fft, c->frame, spectrum, spectrum + n );
+        }
+
+        /* Sum the products of the input spectra, from the most recent, with
+         * the filter partitions, from the first */
+        for( unsigned o = 0; o < c->outputs; o++ )
+        {
+            memset( c->acc, 0, 2 * n * sizeof(float) );
+
+            for( unsigned i = 0; i < c->inputs; i++ )
+                for( unsigned p = 0; p < parts; p++ )
+                {
+                    const float *x = Spectrum( c, i,
+                                               (c->head + parts - p) % parts );
+                    const float *h = Filter( c, i, o, p );
+
+                    c->mac( c->acc, c->acc + n, x, x + n, h, h + n, n );
+                }
+
+            /* The first half is aliased by the circular convolution */
+            vlc_fft_RealInverse( c->fft, c->acc, c->acc + n, c->frame );
+            memcpy( &out[o][offset], &c->frame[b], b * sizeof(float) );
+        }
+    }
+}
+
+#ifdef CONVOLVER_TEST
+#include <stdio.h>
+#include <unistd.h>
+
+static void Fill( float *p, size_t count, unsigned seed )
+{
+    for( size_t i = 0; i < count; i++ )
+    {
+        seed = seed * 1103515245 + 12345;
+        p[i] = (float)((seed >> 8) & 0xffff) / 32768.f - 1.f;
+    }
+}
+
+/* Decaying noise, as a crude head related impulse response */
+static void FillFilter( float *h, unsigned taps, unsigned seed )
+{
+    Fill( h, taps, seed );
+    for( unsigned i = 0; i < taps; i++ )
+        h[i] *= expf( -4.f * i / taps );
+}
+
+#ifndef CONVOLVER_BENCH
+/* Compares with a direct convolution in double precision, processing
+ * several blocks at once or one at a time */
+static void Test( const char *kernel, unsigned inputs, unsigned outputs,
+                  unsigned partition, unsigned taps )
+{
+    const unsigned frames = 8 * partition + 4 * taps;
+    convolver_t *c = convolver_New( inputs, outputs, partition, taps,
+                                    kernel );
+    float *in[inputs], *out[outputs], *h[inputs][outputs];
+
+    assert( c != NULL );
+    for( unsigned i = 0; i < inputs; i++ )
+    {
+        in[i] = malloc( (frames + partition) * sizeof(float) );
+        assert( in[i] != NULL );
+        Fill( in[i], frames + partition, i + 1 );
+        for( unsigned o = 0; o < outputs; o++ )
+        {
+            /* Shorter filters for some pairs, and a null one */
+            const unsigned len = (i + o) % 3 == 1 ? (taps + 1) / 2 : taps;
+
+            h[i][o] = calloc( taps, sizeof(float) );
+            assert( h[i][o] != NULL );
+            if( i != 0 || o != outputs - 1 || inputs == 1 )
+                FillFilter( h[i][o], len, 100 * i + o );
+            convolver_SetFilter( c, i, o, h[i][o], len );
+        }
+    }
+    for( unsigned o = 0; o < outputs; o++ )
+    {
+        out[o] = malloc( (frames + partition) * sizeof(float) );
+        assert( out[o] != NULL );
+    }
+
+    const unsigned first = frames / 2 / partition * partition;
+    convolver_Process( c, out, (const float *const *)in, first );
+    for( unsigned done = first; done < frames; done += partition )
+    {
+        float *o_ptrs[outputs];
+        const float *i_ptrs[inputs];
+
+        for( unsigned o = 0; o < outputs; o++ )
+            o_ptrs[o] = out[o] + done;
+        for( unsigned i = 0; i < inputs; i++ )
+            i_ptrs[i] = in[i] + done;
+        convolver_Process( c, o_ptrs, i_ptrs, partition );
+    }
+
+    for( unsigned o = 0; o < outputs; o++ )
+    {
+        double err = 0., energy = 0.;
+
+        for( unsigned n = 0; n < frames; n++ )
+        {
+            double ref = 0.;
+
+            for( unsigned i = 0; i < inputs; i++ )
+                for( unsigned t = 0; t < taps && t <= n; t++ )
+                    ref += (double)h[i][o][t] * in[i][n - t];
+            err += (out[o][n] - ref) * (out[o][n] - ref);
+            energy += ref * ref;
+        }
+        assert( sqrt( err / energy ) < 1e-5 );
+    }
+
+    /* Reset clears the history */
+    convolver_Reset( c );
+    for( unsigned i = 0; i < inputs; i++ )
+        memset( in[i], 0, partition * sizeof(float) );
+    convolver_Process( c, out, (const float *const *)in, partition );
+    for( unsigned o = 0; o < outputs; o++ )
+        for( unsigned n = 0; n < partition; n++ )
+            assert( out[o][n] == 0.f );
+
+    for( unsigned o = 0; o < outputs; o++ )
+        free( out[o] );
+    for( unsigned i = 0; i < inputs; i++ )
+    {
+        for( unsigned o = 0; o < outputs; o++ )
+            free( h[i][o] );
+        free( in[i] );
+    }
+    convolver_Delete( c );
+}
+#else
+/* Binaural rendering of ambisonics, at 48 kHz, in blocks of 1024 frames */
+static void Bench( const char *kernel, unsigned order, unsigned partition,
+                   unsigned taps )
+{
+    const unsigned rate = 48000, block = 1024, loops = 200;
+    const unsigned inputs = (order + 1) * (order + 1), outputs = 2;
+    convolver_t *c = convolver_New( inputs, outputs, partition, taps,
+                                    kernel );
+    float *in[inputs], *out[outputs];
+    float *h = malloc( taps * sizeof(float) );
+
+    assert( c != NULL && h != NULL );
+    for( unsigned i = 0; i < inputs; i++ )
+    {
+        in[i] = malloc( block * sizeof(float) );
+        assert( in[i] != NULL );
+        Fill( in[i], block, i + 1 );
+        for( unsigned o = 0; o < outputs; o++ )
+        {
+            FillFilter( h, taps, 100 * i + o );
+            convolver_SetFilter( c, i, o, h, taps );
+        }
+    }
+    for( unsigned o = 0; o < outputs; o++ )
+    {
+        out[o] = malloc( block * sizeof(float) );
+        assert( out[o] != NULL );
+    }
+
+    vlc_tick_t time = vlc_tick_now();
+    for( unsigned l = 0; l < loops; l++ )
+        convolver_Process( c, out, (const float *const *)in, block );
+    time = vlc_tick_now() - time;
+
+    /* The latency of the convolution itself: the spatialaudio filter adds
+     * its block, and another one if threaded */
+    printf( "%-4s order %u, %4u taps, partition %4u: %6.3f%% of a CPU, "
+            "latency %5.2f ms\n", kernel, order, taps, partition,
+            100. * secf_from_vlc_tick( time ) * rate / ((double)block * loops),
+            1000. * partition / rate );
+
+    for( unsigned o = 0; o < outputs; o++ )
+        free( out[o] );
+    for( unsigned i = 0; i < inputs; i++ )
+        free( in[i] );
+    free( h );
+    convolver_Delete( c );
+}
+#endif
+
+int main( void )
+{
+#ifndef CONVOLVER_BENCH
+    alarm( 60 );
+#endif
+
+    for( size_t k = 0; k < ARRAY_SIZE(kernels); k++ )
+    {
+        if( !vlc_CPU_CheckKernels( kernels[k].name ) )
+        {
+            fprintf( stderr, "WARNING: could not test %s\n",
+                     kernels[k].name );
+            continue;
+        }
+
+#ifndef CONVOLVER_BENCH
+        static const unsigned taps[] = { 1, 63, 64, 65, 200, 512 };
+        for( size_t t = 0; t < ARRAY_SIZE(taps); t++ )
+        {
+            Test( kernels[k].name, 1, 1, 64, taps[t] );
+            Test( kernels[k].name, 4, 2, 64, taps[t] );
+            Test( kernels[k].name, 9, 2, 128, taps[t] );
+        }
+        Test( kernels[k].name, 16, 2, 256, 1000 );
+#else
+        for( unsigned order = 1; order <= 3; order++ )
+            for( unsigned taps = 256; taps <= 2048; taps *= 8 )
+                for( unsigned partition = 128; partition <= 1024;
+                     partition *= 2 )
+                    Bench( kernels[k].name, order, partition, taps );
+#endif
+    }
+    return 0;
+}
+#endif
@@ -0,0 +1,79 @@
+/*****************************************************************************
+ * convolver.h : uniformly partitioned FFT convolution
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_AUDIO_FILTER_CONVOLVER_H
+#define VLC_AUDIO_FILTER_CONVOLVER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Convolution of several planar input channels with a filter per input and
+ * output channel, each output being the sum of its filtered inputs.
+ *
+ * The filters are cut in partitions of the block size, and the convolution
+ * is computed by overlap-save in the frequency domain: each input block is
+ * transformed once, the products with all the partitions are summed per
+ * output in the frequency domain, and each output is transformed back once.
+ * Long filters thus cost a product per partition instead of a longer FFT,
+ * and the latency is the block size whatever the filter length.
+ */
+typedef struct convolver convolver_t;
+
+/**
+ * \param partition frames per block, a power of two
+ * \param taps maximum filter length
+ * \param kernel "any" for the fastest kernel available, or the name of a
+ * specific one ("c", "sse2", "avx", "neon")
+ * \return the convolver, with null filters, or NULL on error
+ */
+convolver_t *convolver_New( unsigned inputs, unsigned outputs,
+                            unsigned partition, unsigned taps,
+                            const char *kernel );
+void convolver_Delete( convolver_t * );
+
+/** Returns the name of the kernel used by the convolver */
+const char *convolver_Kernel( const convolver_t * );
+
+/**
+ * Sets the filter from an input to an output.
+ *
+ * \param taps filter length, at most the maximum given to convolver_New()
+ */
+void convolver_SetFilter( convolver_t *, unsigned input, unsigned output,
+                          const float *h, unsigned taps );
+
+/**
+ * Convolves planar samples.
+ *
+ * \param frames number of frames, a multiple of the partition size
+ */
+void convolver_Process( convolver_t *, float *const *out,
+                        const float *const *in, unsigned frames );
+
+/** Clears the history */
+void convolver_Reset( convolver_t * );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
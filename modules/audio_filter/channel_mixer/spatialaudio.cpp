@@ -43,6 +43,8 @@
 #include <spatialaudio/Ambisonics.h>
 #include <spatialaudio/SpeakersBinauralizer.h>
 
+#include "convolver.h"
+
 #define CFG_PREFIX "spatialaudio-"
 
 #define DEFAULT_HRTF_PATH "hrtfs" DIR_SEP "dodeca_and_7channel_3DSL_HRTF.sofa"
@@ -55,6 +57,11 @@
 #define HEADPHONES_LONGTEXT N_("If the output is stereo, render ambisonics " \
                                "with the binaural decoder.")
 
+#define THREADED_TEXT N_("Render in a separate thread")
+#define THREADED_LONGTEXT N_("Render the audio in a worker thread, in " \
+    "parallel with the audio output, at the cost of one more block of " \
+    "latency.")
+
 static int OpenBinauralizer(vlc_object_t *p_this);
 static int Open( vlc_object_t * );
 static void Close( vlc_object_t * );
@@ -69,6 +76,8 @@ vlc_module_begin()
     set_callbacks(Open, Close)
     add_bool(CFG_PREFIX "headphones", false,
              HEADPHONES_TEXT, HEADPHONES_LONGTEXT, true)
+    add_bool(CFG_PREFIX "threaded", false,
+             THREADED_TEXT, THREADED_LONGTEXT, true)
     add_loadfile("hrtf-file", NULL, HRTF_FILE_TEXT, HRTF_FILE_LONGTEXT)
     add_shortcut("ambisonics")
 
@@ -83,6 +92,26 @@ vlc_module_end()
 
 #define AMB_MAX_ORDER 3
 
+/* Bounds of the partition size of the HRTF convolution */
+#define AMB_MIN_PARTITION 64
+#define AMB_MAX_PARTITION AMB_BLOCK_TIME_LEN
+
+struct filter_spatialaudio_vp
+{
+    float f_teta;
+    float f_phi;
+    float f_roll;
+    float f_zoom;
+};
+
+static void freeBuffers(float **bufs, unsigned count)
+{
+    if (bufs != NULL)
+        for (unsigned i = 0; i < count; ++i)
+            free(bufs[i]);
+    free(bufs);
+}
+
 struct filter_spatialaudio
 {
     filter_spatialaudio()
@@ -91,19 +120,21 @@ struct filter_spatialaudio
         , i_last_input_pts(0)
         , inBuf(NULL)
         , outBuf(NULL)
+        , convolver(NULL)
+        , b_vp_applied(false)
+        , b_threaded(false)
+        , stageBuf(NULL)
+        , jobOut(NULL)
     {}
     ~filter_spatialaudio()
     {
         delete[] speakers;
-        if (inBuf != NULL)
-            for (unsigned i = 0; i < i_inputNb; ++i)
-                free(inBuf[i]);
-        free(inBuf);
-
-        if (outBuf != NULL)
-            for (unsigned i = 0; i < i_outputNb; ++i)
-                free(outBuf[i]);
-        free(outBuf);
+        freeBuffers(inBuf, i_inputNb);
+        freeBuffers(outBuf, i_outputNb);
+        freeBuffers(stageBuf, i_inputNb);
+        free(jobOut);
+        if (convolver != NULL)
+            convolver_Delete(convolver);
     }
 
     enum
@@ -120,6 +151,7 @@ struct filter_spatialaudio
     CAmbisonicZoomer zoomer;
 
     CAmbisonicSpeaker *speakers;
+    CBFormat bformat;
 
     std::vector<float> inputSamples;
     vlc_tick_t i_inputPTS;
@@ -133,11 +165,26 @@ struct filter_spatialaudio
     unsigned i_inputNb;
     unsigned i_outputNb;
 
-    /* View point. */
-    float f_teta;
-    float f_phi;
-    float f_roll;
-    float f_zoom;
+    /* HRTF stage, replacing the one of the library if not NULL */
+    convolver_t *convolver;
+
+    /* View point, as set and as applied to the processor and the zoomer */
+    filter_spatialaudio_vp vp;
+    filter_spatialaudio_vp vp_applied;
+    bool b_vp_applied;
+
+    /* Worker thread: it renders inBuf into jobOut, with the view point
+     * vp_job, while the next block is gathered in stageBuf. */
+    bool b_threaded;
+    vlc_thread_t thread;
+    vlc_mutex_t lock;
+    vlc_cond_t wait;
+    bool b_busy; /* the worker is rendering */
+    bool b_pending; /* jobOut or the rendering is not output yet */
+    bool b_quit;
+    float** stageBuf;
+    float* jobOut;
+    filter_spatialaudio_vp vp_job;
 };
 
 static std::string getHRTFPath(filter_t *p_filter)
@@ -164,6 +211,127 @@ static std::string getHRTFPath(filter_t *p_filter)
     return HRTFPath;
 }
 
+/* Runs the HRTF stage of the library on one block */
+static void LibraryHRTF(filter_spatialaudio *p_sys, float **in, float **out)
+{
+    if (p_sys->mode == filter_spatialaudio::BINAURALIZER)
+        p_sys->binauralizer.Process(in, out);
+    else
+    {
+        assert(p_sys->mode == filter_spatialaudio::AMBISONICS_BINAURAL_DECODER);
+        for (unsigned i = 0; i < p_sys->i_inputNb - p_sys->i_nondiegetic; ++i)
+            p_sys->bformat.InsertStream(in[i], i, AMB_BLOCK_TIME_LEN);
+        p_sys->binauralDecoder.Process(&p_sys->bformat, out);
+    }
+}
+
+/* Renders inBuf into AMB_BLOCK_TIME_LEN interleaved frames */
+static void Compute(filter_spatialaudio *p_sys,
+                    const filter_spatialaudio_vp *vp, float *p_dest)
+{
+    switch (p_sys->mode)
+    {
+        case filter_spatialaudio::BINAURALIZER:
+            if (p_sys->convolver != NULL)
+                convolver_Process(p_sys->convolver, p_sys->outBuf,
+                                  p_sys->inBuf, AMB_BLOCK_TIME_LEN);
+            else
+                LibraryHRTF(p_sys, p_sys->inBuf, p_sys->outBuf);
+            break;
+        case filter_spatialaudio::AMBISONICS_DECODER:
+        case filter_spatialaudio::AMBISONICS_BINAURAL_DECODER:
+        {
+            CBFormat *inData = &p_sys->bformat;
+            const unsigned i_diegetic = p_sys->i_inputNb - p_sys->i_nondiegetic;
+
+            for (unsigned i = 0; i < i_diegetic; ++i)
+                inData->InsertStream(p_sys->inBuf[i], i, AMB_BLOCK_TIME_LEN);
+
+            /* The rotation and the zoom apply to the sound field, before
+             * the decoding: only their matrices depend on the view point */
+            if (!p_sys->b_vp_applied
+             || memcmp(vp, &p_sys->vp_applied, sizeof (*vp)))
+            {
+                Orientation ori(vp->f_teta, vp->f_phi, vp->f_roll);
+                p_sys->processor.SetOrientation(ori);
+                p_sys->processor.Refresh();
+                p_sys->zoomer.SetZoom(vp->f_zoom);
+                p_sys->zoomer.Refresh();
+                p_sys->vp_applied = *vp;
+                p_sys->b_vp_applied = true;
+            }
+            p_sys->processor.Process(inData, inData->GetSampleCount());
+            p_sys->zoomer.Process(inData, inData->GetSampleCount());
+
+            if (p_sys->mode == filter_spatialaudio::AMBISONICS_DECODER)
+                p_sys->speakerDecoder.Process(inData, inData->GetSampleCount(), p_sys->outBuf);
+            else if (p_sys->convolver != NULL)
+            {
+                /* The diegetic inputs are not needed anymore */
+                for (unsigned i = 0; i < i_diegetic; ++i)
+                    inData->ExtractStream(p_sys->inBuf[i], i, AMB_BLOCK_TIME_LEN);
+                convolver_Process(p_sys->convolver, p_sys->outBuf,
+                                  p_sys->inBuf, AMB_BLOCK_TIME_LEN);
+            }
+            else
+                p_sys->binauralDecoder.Process(inData, p_sys->outBuf);
+            break;
+        }
+        default:
+            vlc_assert_unreachable();
+    }
+
+    // Interleave the results.
+    for (unsigned i = 0; i < p_sys->i_outputNb; ++i)
+        for (unsigned j = 0; j < AMB_BLOCK_TIME_LEN; ++j)
+            p_dest[j * p_sys->i_outputNb + i] = p_sys->outBuf[i][j];
+
+    if (p_sys->i_nondiegetic == 2)
+    {
+        for (unsigned i = 0; i < p_sys->i_lr_channels * 2; i += 2)
+            for (unsigned j = 0; j < AMB_BLOCK_TIME_LEN; ++j)
+            {
+                p_dest[j * p_sys->i_outputNb + i] =
+                        p_dest[j * p_sys->i_outputNb + i]  / 2.f
+                        + p_sys->inBuf[p_sys->i_inputNb - 2][j] / 2.f; //left
+                p_dest[j * p_sys->i_outputNb + i + 1] =
+                        p_dest[j * p_sys->i_outputNb + i + 1]  / 2.f
+                        + p_sys->inBuf[p_sys->i_inputNb - 1][j] / 2.f; //right
+            }
+    }
+}
+
+static void *Worker(void *data)
+{
+    filter_spatialaudio *p_sys = reinterpret_cast<filter_spatialaudio *>(data);
+
+    vlc_mutex_lock(&p_sys->lock);
+    for (;;)
+    {
+        while (!p_sys->b_busy && !p_sys->b_quit)
+            vlc_cond_wait(&p_sys->wait, &p_sys->lock);
+        if (p_sys->b_quit)
+            break;
+        vlc_mutex_unlock(&p_sys->lock);
+
+        Compute(p_sys, &p_sys->vp_job, p_sys->jobOut);
+
+        vlc_mutex_lock(&p_sys->lock);
+        p_sys->b_busy = false;
+        vlc_cond_broadcast(&p_sys->wait);
+    }
+    vlc_mutex_unlock(&p_sys->lock);
+    return NULL;
+}
+
+static void WaitWorker(filter_spatialaudio *p_sys)
+{
+    vlc_mutex_lock(&p_sys->lock);
+    while (p_sys->b_busy)
+        vlc_cond_wait(&p_sys->wait, &p_sys->lock);
+    vlc_mutex_unlock(&p_sys->lock);
+}
+
 static block_t *Mix( filter_t *p_filter, block_t *p_buf )
 {
     filter_spatialaudio *p_sys = reinterpret_cast<filter_spatialaudio *>(p_filter->p_sys);
@@ -190,82 +358,58 @@ static block_t *Mix( filter_t *p_filter, block_t *p_buf )
         return NULL;
     }
 
-    p_out_buf->i_nb_samples = i_nbBlocks * AMB_BLOCK_TIME_LEN;
     if (p_sys->i_inputPTS == 0)
-        p_out_buf->i_pts = p_buf->i_pts;
-    else
-        p_out_buf->i_pts = p_sys->i_inputPTS;
-    p_out_buf->i_dts = p_out_buf->i_pts;
-    p_out_buf->i_length = vlc_tick_from_samples(p_out_buf->i_nb_samples, p_filter->fmt_in.audio.i_rate);
+        p_sys->i_inputPTS = p_buf->i_pts;
 
     float *p_dest = (float *)p_out_buf->p_buffer;
     const float *p_src = (float *)p_sys->inputSamples.data();
+    size_t i_outBlocks = 0;
 
     for (unsigned b = 0; b < i_nbBlocks; ++b)
     {
+        float **inBuf = p_sys->b_threaded ? p_sys->stageBuf : p_sys->inBuf;
+
         for (unsigned i = 0; i < p_sys->i_inputNb; ++i)
         {
             for (unsigned j = 0; j < AMB_BLOCK_TIME_LEN; ++j)
             {
                 float val = p_src[(b * AMB_BLOCK_TIME_LEN + j) * p_sys->i_inputNb + i];
-                p_sys->inBuf[i][j] = val;
+                inBuf[i][j] = val;
             }
         }
 
-        // Compute
-        switch (p_sys->mode)
+        float *p_block = p_dest + i_outBlocks * AMB_BLOCK_TIME_LEN * p_sys->i_outputNb;
+        if (!p_sys->b_threaded)
         {
-            case filter_spatialaudio::BINAURALIZER:
-                p_sys->binauralizer.Process(p_sys->inBuf, p_sys->outBuf);
-                break;
-            case filter_spatialaudio::AMBISONICS_DECODER:
-            case filter_spatialaudio::AMBISONICS_BINAURAL_DECODER:
-            {
-                CBFormat inData;
-                inData.Configure(p_sys->i_order, true, AMB_BLOCK_TIME_LEN);
-
-                for (unsigned i = 0; i < p_sys->i_inputNb - p_sys->i_nondiegetic; ++i)
-                    inData.InsertStream(p_sys->inBuf[i], i, AMB_BLOCK_TIME_LEN);
-
-                Orientation ori(p_sys->f_teta, p_sys->f_phi, p_sys->f_roll);
-                p_sys->processor.SetOrientation(ori);
-                p_sys->processor.Refresh();
-                p_sys->processor.Process(&inData, inData.GetSampleCount());
-
-                p_sys->zoomer.SetZoom(p_sys->f_zoom);
-                p_sys->zoomer.Refresh();
-                p_sys->zoomer.Process(&inData, inData.GetSampleCount());
-
-                if (p_sys->mode == filter_spatialaudio::AMBISONICS_DECODER)
-                    p_sys->speakerDecoder.Process(&inData, inData.GetSampleCount(), p_sys->outBuf);
-                else
-                    p_sys->binauralDecoder.Process(&inData, p_sys->outBuf);
-                break;
-            }
-            default:
-                vlc_assert_unreachable();
+            Compute(p_sys, &p_sys->vp, p_block);
+            i_outBlocks++;
+            continue;
         }
 
-        // Interleave the results.
-        for (unsigned i = 0; i < p_sys->i_outputNb; ++i)
-            for (unsigned j = 0; j < AMB_BLOCK_TIME_LEN; ++j)
-                p_dest[(b * AMB_BLOCK_TIME_LEN + j) * p_sys->i_outputNb + i] = p_sys->outBuf[i][j];
-
-        if (p_sys->i_nondiegetic == 2)
+        /* Output the previous block, and hand this one to the worker */
+        WaitWorker(p_sys);
+        if (p_sys->b_pending)
         {
-            for (unsigned i = 0; i < p_sys->i_lr_channels * 2; i += 2)
-                for (unsigned j = 0; j < AMB_BLOCK_TIME_LEN; ++j)
-                {
-                    p_dest[(b * AMB_BLOCK_TIME_LEN + j) * p_sys->i_outputNb + i] =
-                            p_dest[(b * AMB_BLOCK_TIME_LEN + j) * p_sys->i_outputNb + i]  / 2.f
-                            + p_sys->inBuf[p_sys->i_inputNb - 2][j] / 2.f; //left
-                    p_dest[(b * AMB_BLOCK_TIME_LEN + j) * p_sys->i_outputNb + i + 1] =
-                            p_dest[(b * AMB_BLOCK_TIME_LEN + j) * p_sys->i_outputNb + i + 1]  / 2.f
-                            + p_sys->inBuf[p_sys->i_inputNb - 1][j] / 2.f; //right
-                }
+            memcpy(p_block, p_sys->jobOut, i_outputBlockSize);
+            i_outBlocks++;
         }
+        p_sys->stageBuf = p_sys->inBuf;
+        p_sys->inBuf = inBuf;
+        p_sys->vp_job = p_sys->vp;
+        p_sys->b_pending = true;
+
+        vlc_mutex_lock(&p_sys->lock);
+        p_sys->b_busy = true;
+        vlc_cond_broadcast(&p_sys->wait);
+        vlc_mutex_unlock(&p_sys->lock);
     }
 
+    p_out_buf->i_buffer = i_outputBlockSize * i_outBlocks;
+    p_out_buf->i_nb_samples = i_outBlocks * AMB_BLOCK_TIME_LEN;
+    p_out_buf->i_pts = p_sys->i_inputPTS;
+    p_out_buf->i_dts = p_out_buf->i_pts;
+    p_out_buf->i_length = vlc_tick_from_samples(p_out_buf->i_nb_samples, p_filter->fmt_in.audio.i_rate);
+
     p_sys->inputSamples.erase(p_sys->inputSamples.begin(),
                               p_sys->inputSamples.begin() + i_inputBlockSize * i_nbBlocks / sizeof(float));
 
@@ -280,6 +424,13 @@ static block_t *Mix( filter_t *p_filter, block_t *p_buf )
 static void Flush( filter_t *p_filter )
 {
     filter_spatialaudio *p_sys = reinterpret_cast<filter_spatialaudio *>(p_filter->p_sys);
+    if (p_sys->b_threaded)
+    {
+        WaitWorker(p_sys);
+        p_sys->b_pending = false;
+    }
+    if (p_sys->convolver != NULL)
+        convolver_Reset(p_sys->convolver);
     p_sys->inputSamples.clear();
     p_sys->i_last_input_pts = p_sys->i_inputPTS = 0;
 }
@@ -289,14 +440,14 @@ static void ChangeViewpoint( filter_t *p_filter, const vlc_viewpoint_t *p_vp)
     filter_spatialaudio *p_sys = reinterpret_cast<filter_spatialaudio *>(p_filter->p_sys);
 
 #define RAD(d) ((float) ((d) * M_PI / 180.f))
-    p_sys->f_teta = -RAD(p_vp->yaw);
-    p_sys->f_phi = RAD(p_vp->pitch);
-    p_sys->f_roll = RAD(p_vp->roll);
+    p_sys->vp.f_teta = -RAD(p_vp->yaw);
+    p_sys->vp.f_phi = RAD(p_vp->pitch);
+    p_sys->vp.f_roll = RAD(p_vp->roll);
 
     if (p_vp->fov >= FIELD_OF_VIEW_DEGREES_DEFAULT)
-        p_sys->f_zoom = 0.f; // no unzoom as it does not really make sense.
+        p_sys->vp.f_zoom = 0.f; // no unzoom as it does not really make sense.
     else
-        p_sys->f_zoom = (FIELD_OF_VIEW_DEGREES_DEFAULT - p_vp->fov) / (FIELD_OF_VIEW_DEGREES_DEFAULT - FIELD_OF_VIEW_DEGREES_MIN);
+        p_sys->vp.f_zoom = (FIELD_OF_VIEW_DEGREES_DEFAULT - p_vp->fov) / (FIELD_OF_VIEW_DEGREES_DEFAULT - FIELD_OF_VIEW_DEGREES_MIN);
 #undef RAD
 }
 
@@ -327,6 +478,122 @@ static int allocateBuffers(filter_spatialaudio *p_sys)
     return VLC_SUCCESS;
 }
 
+/**
+ * Replaces the HRTF stage of the library by a partitioned convolution.
+ *
+ * The stage of the library convolves each input with its own FFT of the
+ * block and filter length. Its filters are measured, as the responses of
+ * each input to an impulse, and the convolver transforms each input once
+ * and each ear once, whatever the number of inputs.
+ */
+static convolver_t *createConvolver(filter_t *p_filter,
+                                    filter_spatialaudio *p_sys,
+                                    unsigned i_inputs, unsigned i_tailLength)
+{
+    const unsigned i_blocks = i_tailLength / AMB_BLOCK_TIME_LEN + 1;
+    const unsigned i_length = i_blocks * AMB_BLOCK_TIME_LEN;
+    std::vector<float> ir;
+
+    assert(p_sys->i_outputNb == 2);
+    try
+    {
+        ir.resize(i_inputs * 2 * i_length);
+    }
+    catch (const std::bad_alloc &)
+    {
+        return NULL;
+    }
+
+    unsigned i_taps = 0;
+    for (unsigned i = 0; i < i_inputs; ++i)
+    {
+        if (p_sys->mode == filter_spatialaudio::BINAURALIZER)
+            p_sys->binauralizer.Reset();
+        else
+            p_sys->binauralDecoder.Reset();
+
+        for (unsigned b = 0; b < i_blocks; ++b)
+        {
+            for (unsigned j = 0; j < i_inputs; ++j)
+                memset(p_sys->inBuf[j], 0, AMB_BLOCK_TIME_LEN * sizeof(float));
+            if (b == 0)
+                p_sys->inBuf[i][0] = 1.f;
+
+            LibraryHRTF(p_sys, p_sys->inBuf, p_sys->outBuf);
+
+            for (unsigned o = 0; o < 2; ++o)
+            {
+                float *h = &ir[(i * 2 + o) * i_length + b * AMB_BLOCK_TIME_LEN];
+
+                memcpy(h, p_sys->outBuf[o], AMB_BLOCK_TIME_LEN * sizeof(float));
+                for (unsigned j = 0; j < AMB_BLOCK_TIME_LEN; ++j)
+                    if (h[j] != 0.f)
+                        i_taps = __MAX(i_taps, b * AMB_BLOCK_TIME_LEN + j + 1);
+            }
+        }
+    }
+
+    if (p_sys->mode == filter_spatialaudio::BINAURALIZER)
+        p_sys->binauralizer.Reset();
+    else
+        p_sys->binauralDecoder.Reset();
+    if (i_taps == 0)
+        return NULL;
+
+    /* A partition of the filter length, or of the block if shorter, costs
+     * the least */
+    unsigned i_partition = AMB_MIN_PARTITION;
+    while (i_partition < i_taps && i_partition < AMB_MAX_PARTITION)
+        i_partition *= 2;
+
+    convolver_t *convolver = convolver_New(i_inputs, 2, i_partition, i_taps,
+                                           "any");
+    if (convolver == NULL)
+        return NULL;
+
+    for (unsigned i = 0; i < i_inputs; ++i)
+        for (unsigned o = 0; o < 2; ++o)
+            convolver_SetFilter(convolver, i, o, &ir[(i * 2 + o) * i_length],
+                                i_taps);
+
+    msg_Dbg(p_filter, "HRTF convolution of %u taps, %u frames partitions, "
+            "%s kernel", i_taps, i_partition, convolver_Kernel(convolver));
+    return convolver;
+}
+
+static void startWorker(filter_t *p_filter, filter_spatialaudio *p_sys)
+{
+    if (!var_InheritBool(p_filter, CFG_PREFIX "threaded"))
+        return;
+
+    p_sys->stageBuf = (float**)calloc(p_sys->i_inputNb, sizeof(float*));
+    p_sys->jobOut = (float *)vlc_alloc(AMB_BLOCK_TIME_LEN * p_sys->i_outputNb,
+                                       sizeof(float));
+    if (p_sys->stageBuf == NULL || p_sys->jobOut == NULL)
+        return;
+
+    for (unsigned i = 0; i < p_sys->i_inputNb; ++i)
+    {
+        p_sys->stageBuf[i] = (float *)vlc_alloc(AMB_BLOCK_TIME_LEN, sizeof(float));
+        if (p_sys->stageBuf[i] == NULL)
+            return;
+    }
+
+    vlc_mutex_init(&p_sys->lock);
+    vlc_cond_init(&p_sys->wait);
+    p_sys->b_busy = p_sys->b_pending = p_sys->b_quit = false;
+
+    if (vlc_clone(&p_sys->thread, Worker, p_sys, VLC_THREAD_PRIORITY_AUDIO))
+    {
+        msg_Warn(p_filter, "cannot start the rendering thread");
+        vlc_cond_destroy(&p_sys->wait);
+        vlc_mutex_destroy(&p_sys->lock);
+        return;
+    }
+    p_sys->b_threaded = true;
+    msg_Dbg(p_filter, "rendering in a separate thread");
+}
+
 static int OpenBinauralizer(vlc_object_t *p_this)
 {
     filter_t *p_filter = (filter_t *)p_this;
@@ -341,6 +608,7 @@ static int OpenBinauralizer(vlc_object_t *p_this)
     p_sys->i_inputNb = p_filter->fmt_in.audio.i_channels;
     p_sys->i_outputNb = 2;
     p_sys->i_lr_channels = 1;
+    p_sys->i_nondiegetic = 0;
 
     if (allocateBuffers(p_sys) != VLC_SUCCESS)
     {
@@ -393,6 +661,10 @@ static int OpenBinauralizer(vlc_object_t *p_this)
     }
     p_sys->binauralizer.Reset();
 
+    p_sys->convolver = createConvolver(p_filter, p_sys, infmt->i_channels,
+                                       i_tailLength);
+    startWorker(p_filter, p_sys);
+
     outfmt->i_format = infmt->i_format = VLC_CODEC_FL32;
     outfmt->i_rate = infmt->i_rate;
     outfmt->i_physical_channels = AOUT_CHANS_STEREO;
@@ -432,10 +704,10 @@ static int Open(vlc_object_t *p_this)
     if (p_sys == NULL)
         return VLC_ENOMEM;
 
-    p_sys->f_teta = 0.f;
-    p_sys->f_phi = 0.f;
-    p_sys->f_roll = 0.f;
-    p_sys->f_zoom = 0.f;
+    p_sys->vp.f_teta = 0.f;
+    p_sys->vp.f_phi = 0.f;
+    p_sys->vp.f_roll = 0.f;
+    p_sys->vp.f_zoom = 0.f;
     p_sys->i_inputNb = p_filter->fmt_in.audio.i_channels;
     p_sys->i_outputNb = p_filter->fmt_out.audio.i_channels;
 
@@ -463,9 +735,11 @@ static int Open(vlc_object_t *p_this)
 
     msg_Dbg(p_filter, "Order: %d %d %d", p_sys->i_order, p_sys->i_nondiegetic, infmt->i_channels);
 
-    static const char *const options[] = { "headphones", NULL };
+    static const char *const options[] = { "headphones", "threaded", NULL };
     config_ChainParse(p_filter, CFG_PREFIX, options, p_filter->p_cfg);
 
+    p_sys->bformat.Configure(p_sys->i_order, true, AMB_BLOCK_TIME_LEN);
+
     unsigned i_tailLength = 0;
     if (p_filter->fmt_out.audio.i_channels == 2
      && var_InheritBool(p_filter, CFG_PREFIX "headphones"))
@@ -484,6 +758,10 @@ static int Open(vlc_object_t *p_this)
             return VLC_EGENERIC;
         }
         p_sys->binauralDecoder.Reset();
+
+        p_sys->convolver = createConvolver(p_filter, p_sys,
+                                           infmt->i_channels - p_sys->i_nondiegetic,
+                                           i_tailLength);
     }
     else
     {
@@ -549,6 +827,8 @@ static int Open(vlc_object_t *p_this)
         return VLC_EGENERIC;
     }
 
+    startWorker(p_filter, p_sys);
+
     p_filter->p_sys = p_sys;
     p_filter->pf_audio_filter = Mix;
     p_filter->pf_flush = Flush;
@@ -562,5 +842,16 @@ static void Close(vlc_object_t *p_this)
     filter_t *p_filter = (filter_t *)p_this;
 
     filter_spatialaudio *p_sys = reinterpret_cast<filter_spatialaudio *>(p_filter->p_sys);
+    if (p_sys->b_threaded)
+    {
+        vlc_mutex_lock(&p_sys->lock);
+        p_sys->b_quit = true;
+        vlc_cond_broadcast(&p_sys->wait);
+        vlc_mutex_unlock(&p_sys->lock);
+
+        vlc_join(p_sys->thread, NULL);
+        vlc_cond_destroy(&p_sys->wait);
+        vlc_mutex_destroy(&p_sys->lock);
+    }
     delete p_sys;
 }
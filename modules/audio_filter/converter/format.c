@@ -39,6 +39,8 @@
 #include <vlc_block.h>
 #include <vlc_filter.h>
 
+#include "pcm_kernels.h"
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -75,9 +77,13 @@ static int Open(vlc_object_t *object)
     if (filter->pf_audio_filter == NULL)
         return VLC_EGENERIC;
 
-    msg_Dbg(filter, "%4.4s->%4.4s, bits per sample: %i->%i",
+    const pcm_kernels_t *kernels = pcm_kernels_Get("any");
+    filter->p_sys = (void *)kernels;
+
+    msg_Dbg(filter, "%4.4s->%4.4s, bits per sample: %i->%i, %s kernels",
             (char *)&src->i_codec, (char *)&dst->i_codec,
-            src->audio.i_bitspersample, dst->audio.i_bitspersample);
+            src->audio.i_bitspersample, dst->audio.i_bitspersample,
+            kernels->name);
     return VLC_SUCCESS;
 }
 
@@ -172,24 +178,12 @@ static block_t *S16toFl32(filter_t *filter, block_t *bsrc)
         goto out;
 
     block_CopyProperties(bdst, bsrc);
-    int16_t *src = (int16_t *)bsrc->p_buffer;
-    float   *dst = (float *)bdst->p_buffer;
-    for (size_t i = bsrc->i_buffer / 2; i--;)
-#if 0
-        /* Slow version */
-        *dst++ = (float)*src++ / 32768.f;
-#else
-    {   /* This is Walken's trick based on IEEE float format. On my PIII
-         * this takes 16 seconds to perform one billion conversions, instead
-         * of 19 seconds for the above division. */
-        union { float f; int32_t i; } u;
-        u.i = *src++ + 0x43c00000;
-        *dst++ = u.f - 384.f;
-    }
-#endif
+    const pcm_kernels_t *kernels = filter->p_sys;
+    kernels->s16_to_fl32((float *)bdst->p_buffer,
+                         (const int16_t *)bsrc->p_buffer,
+                         bsrc->i_buffer / 2, 1.f);
 out:
     block_Release(bsrc);
-    VLC_UNUSED(filter);
     return bdst;
 }
 
@@ -218,7 +212,7 @@ static block_t *S16toFl64(filter_t *filter, block_t *bsrc)
 
     block_CopyProperties(bdst, bsrc);
     int16_t *src = (int16_t *)bsrc->p_buffer;
-    float   *dst = (float *)bdst->p_buffer;
+    double  *dst = (double *)bdst->p_buffer;
     for (size_t i = bsrc->i_buffer / 2; i--;)
         *dst++ = (double)*src++ / 32768.;
 out:
@@ -251,48 +245,18 @@ static block_t *Fl32toU8(filter_t *filter, block_t *b)
 
 static block_t *Fl32toS16(filter_t *filter, block_t *b)
 {
-    VLC_UNUSED(filter);
-    float   *src = (float *)b->p_buffer;
-    int16_t *dst = (int16_t *)src;
-    for (int i = b->i_buffer / 4; i--;) {
-#if 0
-        /* Slow version. */
-        if (*src >= 1.0) *dst = 32767;
-        else if (*src < -1.0) *dst = -32768;
-        else *dst = lroundf(*src * 32768.f);
-        src++; dst++;
-#else
-        /* This is Walken's trick based on IEEE float format. */
-        union { float f; int32_t i; } u;
-        u.f = *src++ + 384.f;
-        if (u.i > 0x43c07fff)
-            *dst++ = 32767;
-        else if (u.i < 0x43bf8000)
-            *dst++ = -32768;
-        else
-            *dst++ = u.i - 0x43c00000;
-#endif
-    }
+    const pcm_kernels_t *kernels = filter->p_sys;
+    kernels->fl32_to_s16((int16_t *)b->p_buffer, (const float *)b->p_buffer,
+                         b->i_buffer / 4, 1.f);
     b->i_buffer /= 2;
     return b;
 }
 
 static block_t *Fl32toS32(filter_t *filter, block_t *b)
 {
-    float   *src = (float *)b->p_buffer;
-    int32_t *dst = (int32_t *)src;
-    for (size_t i = b->i_buffer / 4; i--;)
-    {
-        float s = *(src++) * 2147483648.f;
-        if (s >= 2147483647.f)
-            *(dst++) = 2147483647;
-        else
-        if (s <= -2147483648.f)
-            *(dst++) = -2147483648;
-        else
-            *(dst++) = lroundf(s);
-    }
-    VLC_UNUSED(filter);
+    const pcm_kernels_t *kernels = filter->p_sys;
+    kernels->fl32_to_s32((int32_t *)b->p_buffer, (const float *)b->p_buffer,
+                         b->i_buffer / 4, 1.f);
     return b;
 }
 
@@ -303,13 +267,12 @@ static block_t *Fl32toFl64(filter_t *filter, block_t *bsrc)
         goto out;
 
     block_CopyProperties(bdst, bsrc);
-    float  *src = (float *)bsrc->p_buffer;
-    double *dst = (double *)bdst->p_buffer;
-    for (size_t i = bsrc->i_buffer / 4; i--;)
-        *(dst++) = *(src++);
+    const pcm_kernels_t *kernels = filter->p_sys;
+    kernels->fl32_to_fl64((double *)bdst->p_buffer,
+                          (const float *)bsrc->p_buffer,
+                          bsrc->i_buffer / 4, 1.f);
 out:
     block_Release(bsrc);
-    VLC_UNUSED(filter);
     return bdst;
 }
 
@@ -341,11 +304,9 @@ static block_t *S32toS16(filter_t *filter, block_t *b)
 
 static block_t *S32toFl32(filter_t *filter, block_t *b)
 {
-    VLC_UNUSED(filter);
-    int32_t *src = (int32_t*)b->p_buffer;
-    float   *dst = (float *)src;
-    for (int i = b->i_buffer / 4; i--;)
-        *dst++ = (float)(*src++) / 2147483648.f;
+    const pcm_kernels_t *kernels = filter->p_sys;
+    kernels->s32_to_fl32((float *)b->p_buffer, (const int32_t *)b->p_buffer,
+                         b->i_buffer / 4, 1.f);
     return b;
 }
 
@@ -409,12 +370,10 @@ static block_t *Fl64toS16(filter_t *filter, block_t *b)
 
 static block_t *Fl64toFl32(filter_t *filter, block_t *b)
 {
-    double *src = (double *)b->p_buffer;
-    float  *dst = (float *)src;
-    for (size_t i = b->i_buffer / 8; i--;)
-        *(dst++) = *(src++);
-
-    VLC_UNUSED(filter);
+    const pcm_kernels_t *kernels = filter->p_sys;
+    kernels->fl64_to_fl32((float *)b->p_buffer, (const double *)b->p_buffer,
+                          b->i_buffer / 8, 1.f);
+    b->i_buffer /= 2;
     return b;
 }
 
@@ -433,6 +392,7 @@ static block_t *Fl64toS32(filter_t *filter, block_t *b)
         else
             *(dst++) = lround(s);
     }
+    b->i_buffer /= 2;
     VLC_UNUSED(filter);
     return b;
 }
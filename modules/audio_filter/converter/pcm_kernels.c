@@ -0,0 +1,832 @@
+/*****************************************************************************
+ * pcm_kernels.c : vectorized PCM conversion and gain kernels
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef PCM_KERNELS_TEST
+# undef NDEBUG
+#endif
+
+#include <assert.h>
+#include <math.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+
+#include "pcm_kernels.h"
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+#endif
+#ifdef __ARM_NEON
+# include <arm_neon.h>
+#endif
+
+/* The SIMD kernels handle the trailing samples with the C ones, and round to
+ * nearest like lrintf(), so that all the sets give the same results. */
+
+static inline int16_t SatS16( float v )
+{
+    if( v > 32767.f )
+        return INT16_MAX;
+    if( v < -32768.f )
+        return INT16_MIN;
+    return lrintf( v );
+}
+
+static inline int32_t SatS32( float v )
+{
+    if( v >= 2147483648.f )
+        return INT32_MAX;
+    if( v <= -2147483648.f )
+        return INT32_MIN;
+    return lrintf( v );
+}
+
+static void S16toFl32C( float *dst, const int16_t *src, size_t count,
+                        float gain )
+{
+    const float k = gain * 0x1p-15f;
+
+    for( size_t i = 0; i < count; i++ )
+        dst[i] = (float)src[i] * k;
+}
+
+static void S32toFl32C( float *dst, const int32_t *src, size_t count,
+                        float gain )
+{
+    const float k = gain * 0x1p-31f;
+
+    for( size_t i = 0; i < count; i++ )
+        dst[i] = (float)src[i] * k;
+}
+
+static void Fl64toFl32C( float *dst, const double *src, size_t count,
+                         float gain )
+{
+    for( size_t i = 0; i < count; i++ )
+        dst[i] = src[i] * (double)gain;
+}
+
+static void Fl32toS16C( int16_t *dst, const float *src, size_t count,
+                        float gain )
+{
+    const float k = gain * 32768.f;
+
+    for( size_t i = 0; i < count; i++ )
+        dst[i] = SatS16( src[i] * k );
+}
+
+static void Fl32toS32C( int32_t *dst, const float *src, size_t count,
+                        float gain )
+{
+    const float k = gain * 2147483648.f;
+
+    for( size_t i = 0; i < count; i++ )
+        dst[i] = SatS32( src[i] * k );
+}
+
+static void Fl32toFl64C( double *dst, const float *src, size_t count,
+                         float gain )
+{
+    for( size_t i = 0; i < count; i++ )
+        dst[i] = (double)src[i] * gain;
+}
+
+static void AmplifyS16C( int16_t *dst, const int16_t *src, size_t count,
+                         float gain )
+{
+    for( size_t i = 0; i < count; i++ )
+        dst[i] = SatS16( (float)src[i] * gain );
+}
+
+static void AmplifyFl32C( float *dst, const float *src, size_t count,
+                          float gain )
+{
+    for( size_t i = 0; i < count; i++ )
+        dst[i] = src[i] * gain;
+}
+
+static void AmplifyFl64C( double *dst, const double *src, size_t count,
+                          double gain )
+{
+    for( size_t i = 0; i < count; i++ )
+        dst[i] = src[i] * gain;
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+/* Sign extends 8 samples to 2 x 4 floats */
+__attribute__ ((__target__ ("sse2")))
+static inline void S16x8toFl32SSE2( __m128i x, __m128 *lo, __m128 *hi )
+{
+    *lo = _mm_cvtepi32_ps( _mm_srai_epi32( _mm_unpacklo_epi16( x, x ), 16 ) );
+    *hi = _mm_cvtepi32_ps( _mm_srai_epi32( _mm_unpackhi_epi16( x, x ), 16 ) );
+}
+
+/* Rounds and saturates 2 x 4 floats to 8 samples */
+__attribute__ ((__target__ ("sse2")))
+static inline __m128i Fl32x8toS16SSE2( __m128 lo, __m128 hi )
+{
+    const __m128 max = _mm_set1_ps( 32767.f ), min = _mm_set1_ps( -32768.f );
+
+    lo = _mm_max_ps( _mm_min_ps( lo, max ), min );
+    hi = _mm_max_ps( _mm_min_ps( hi, max ), min );
+    return _mm_packs_epi32( _mm_cvtps_epi32( lo ), _mm_cvtps_epi32( hi ) );
+}
+
+__attribute__ ((__target__ ("sse2")))
+static void S16toFl32SSE2( float *dst, const int16_t *src, size_t count,
+                           float gain )
+{
+    const __m128 k = _mm_set1_ps( gain * 0x1p-15f );
+    size_t i = 0;
+
+    for( ; i + 8 <= count; i += 8 )
+    {
+        __m128 lo, hi;
+
+        S16x8toFl32SSE2( _mm_loadu_si128( (const __m128i *)&src[i] ),
+                         &lo, &hi );
+        _mm_storeu_ps( &dst[i], _mm_mul_ps( lo, k ) );
+        _mm_storeu_ps( &dst[i + 4], _mm_mul_ps( hi, k ) );
+    }
+    S16toFl32C( &dst[i], &src[i], count - i, gain );
+}
+
+__attribute__ ((__target__ ("sse2")))
+static void S32toFl32SSE2( float *dst, const int32_t *src, size_t count,
+                           float gain )
+{
+    const __m128 k = _mm_set1_ps( gain * 0x1p-31f );
+    size_t i = 0;
+
+    for( ; i + 4 <= count; i += 4 )
+    {
+        const __m128i x = _mm_loadu_si128( (const __m128i *)&src[i] );
+        _mm_storeu_ps( &dst[i], _mm_mul_ps( _mm_cvtepi32_ps( x ), k ) );
+    }
+    S32toFl32C( &dst[i], &src[i], count - i, gain );
+}
+
+__attribute__ ((__target__ ("sse2")))
+static void Fl64toFl32SSE2( float *dst, const double *src, size_t count,
+                            float gain )
+{
+    const __m128d k = _mm_set1_pd( gain );
+    size_t i = 0;
+
+    for( ; i + 4 <= count; i += 4 )
+    {
+        const __m128 lo = _mm_cvtpd_ps( _mm_mul_pd( _mm_loadu_pd( &src[i] ),
+                                                    k ) );
+        const __m128 hi = _mm_cvtpd_ps( _mm_mul_pd( _mm_loadu_pd( &src[i + 2] ),
+                                                    k ) );
+        _mm_storeu_ps( &dst[i], _mm_movelh_ps( lo, hi ) );
+    }
+    Fl64toFl32C( &dst[i], &src[i], count - i, gain );
+}
+
+__attribute__ ((__target__ ("sse2")))
+static void Fl32toS16SSE2( int16_t *dst, const float *src, size_t count,
+                           float gain )
+{
+    const __m128 k = _mm_set1_ps( gain * 32768.f );
+    size_t i = 0;
+
+    for( ; i + 8 <= count; i += 8 )
+    {
+        const __m128 lo = _mm_mul_ps( _mm_loadu_ps( &src[i] ), k );
+        const __m128 hi = _mm_mul_ps( _mm_loadu_ps( &src[i + 4] ), k );
+        _mm_storeu_si128( (__m128i *)&dst[i], Fl32x8toS16SSE2( lo, hi ) );
+    }
+    Fl32toS16C( &dst[i], &src[i], count - i, gain );
+}
+
+__attribute__ ((__target__ ("sse2")))
+static void Fl32toS32SSE2( int32_t *dst, const float *src, size_t count,
+                           float gain )
+{
+    const __m128 k = _mm_set1_ps( gain * 2147483648.f );
+    const __m128 max = _mm_set1_ps( 2147483648.f );
+    size_t i = 0;
+
+    for( ; i + 4 <= count; i += 4 )
+    {
+        const __m128 v = _mm_mul_ps( _mm_loadu_ps( &src[i] ), k );
+        /* Overflows convert to INT32_MIN: flip the positive ones */
+        const __m128i r = _mm_xor_si128( _mm_cvtps_epi32( v ),
+                                 _mm_castps_si128( _mm_cmpge_ps( v, max ) ) );
+        _mm_storeu_si128( (__m128i *)&dst[i], r );
+    }
+    Fl32toS32C( &dst[i], &src[i], count - i, gain );
+}
+
+__attribute__ ((__target__ ("sse2")))
+static void Fl32toFl64SSE2( double *dst, const float *src, size_t count,
+                            float gain )
+{
+    const __m128d k = _mm_set1_pd( gain );
+    size_t i = 0;
+
+    for( ; i + 4 <= count; i += 4 )
+    {
+        const __m128 x = _mm_loadu_ps( &src[i] );
+        _mm_storeu_pd( &dst[i], _mm_mul_pd( _mm_cvtps_pd( x ), k ) );
+        _mm_storeu_pd( &dst[i + 2],
+                       _mm_mul_pd( _mm_cvtps_pd( _mm_movehl_ps( x, x ) ), k ) );
+    }
+    Fl32toFl64C( &dst[i], &src[i], count - i, gain );
+}
+
+__attribute__ ((__target__ ("sse2")))
+static void AmplifyS16SSE2( int16_t *dst, const int16_t *src, size_t count,
+                            float gain )
+{
+    const __m128 k = _mm_set1_ps( gain );
+    size_t i = 0;
+
+    for( ; i + 8 <= count; i += 8 )
+    {
+        __m128 lo, hi;
+
+        S16x8toFl32SSE2( _mm_loadu_si128( (const __m128i *)&src[i] ),
+                         &lo, &hi );
+        _mm_storeu_si128( (__m128i *)&dst[i],
+                          Fl32x8toS16SSE2( _mm_mul_ps( lo, k ),
+                                           _mm_mul_ps( hi, k ) ) );
+    }
+    AmplifyS16C( &dst[i], &src[i], count - i, gain );
+}
+
+__attribute__ ((__target__ ("sse2")))
+static void AmplifyFl32SSE2( float *dst, const float *src, size_t count,
+                             float gain )
+{
+    const __m128 k = _mm_set1_ps( gain );
+    size_t i = 0;
+
+    for( ; i + 8 <= count; i += 8 )
+    {
+        const __m128 a = _mm_mul_ps( _mm_loadu_ps( &src[i] ), k );
+        const __m128 b = _mm_mul_ps( _mm_loadu_ps( &src[i + 4] ), k );
+        _mm_storeu_ps( &dst[i], a );
+        _mm_storeu_ps( &dst[i + 4], b );
+    }
+    AmplifyFl32C( &dst[i], &src[i], count - i, gain );
+}
+
+__attribute__ ((__target__ ("sse2")))
+static void AmplifyFl64SSE2( double *dst, const double *src, size_t count,
+                             double gain )
+{
+    const __m128d k = _mm_set1_pd( gain );
+    size_t i = 0;
+
+    for( ; i + 4 <= count; i += 4 )
+    {
+        const __m128d a = _mm_mul_pd( _mm_loadu_pd( &src[i] ), k );
+        const __m128d b = _mm_mul_pd( _mm_loadu_pd( &src[i + 2] ), k );
+        _mm_storeu_pd( &dst[i], a );
+        _mm_storeu_pd( &dst[i + 2], b );
+    }
+    AmplifyFl64C( &dst[i], &src[i], count - i, gain );
+}
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+/* AVX lacks 256-bits integer operations: the samples are widened and packed
+ * with SSE2 operations, and converted with AVX ones. */
+__attribute__ ((__target__ ("avx")))
+static inline __m256 S16x8toFl32AVX( __m128i x )
+{
+    const __m128i lo = _mm_srai_epi32( _mm_unpacklo_epi16( x, x ), 16 );
+    const __m128i hi = _mm_srai_epi32( _mm_unpackhi_epi16( x, x ), 16 );
+
+    return _mm256_cvtepi32_ps( _mm256_insertf128_si256(
+                                   _mm256_castsi128_si256( lo ), hi, 1 ) );
+}
+
+__attribute__ ((__target__ ("avx")))
+static inline __m128i Fl32x8toS16AVX( __m256 v )
+{
+    v = _mm256_max_ps( _mm256_min_ps( v, _mm256_set1_ps( 32767.f ) ),
+                       _mm256_set1_ps( -32768.f ) );
+
+    const __m256i r = _mm256_cvtps_epi32( v );
+    return _mm_packs_epi32( _mm256_castsi256_si128( r ),
+                            _mm256_extractf128_si256( r, 1 ) );
+}
+
+__attribute__ ((__target__ ("avx")))
+static void S16toFl32AVX( float *dst, const int16_t *src, size_t count,
+                          float gain )
+{
+    const __m256 k = _mm256_set1_ps( gain * 0x1p-15f );
+    size_t i = 0;
+
+    for( ; i + 8 <= count; i += 8 )
+    {
+        const __m256 v = S16x8toFl32AVX(
+                             _mm_loadu_si128( (const __m128i *)&src[i] ) );
+        _mm256_storeu_ps( &dst[i], _mm256_mul_ps( v, k ) );
+    }
+    S16toFl32C( &dst[i], &src[i], count - i, gain );
+}
+
+__attribute__ ((__target__ ("avx")))
+static void S32toFl32AVX( float *dst, const int32_t *src, size_t count,
+                          float gain )
+{
+    const __m256 k = _mm256_set1_ps( gain * 0x1p-31f );
+    size_t i = 0;
+
+    for( ; i + 8 <= count; i += 8 )
+    {
+        const __m256i x = _mm256_loadu_si256( (const __m256i *)&src[i] );
+        _mm256_storeu_ps( &dst[i], _mm256_mul_ps( _mm256_cvtepi32_ps( x ),
+                                                  k ) );
+    }
+    S32toFl32C( &dst[i], &src[i], count - i, gain );
+}
+
+__attribute__ ((__target__ ("avx")))
+static void Fl64toFl32AVX( float *dst, const double *src, size_t count,
+                           float gain )
+{
+    const __m256d k = _mm256_set1_pd( gain );
+    size_t i = 0;
+
+    for( ; i + 8 <= count; i += 8 )
+    {
+        const __m128 lo = _mm256_cvtpd_ps(
+                              _mm256_mul_pd( _mm256_loadu_pd( &src[i] ), k ) );
+        const __m128 hi = _mm256_cvtpd_ps(
+                          _mm256_mul_pd( _mm256_loadu_pd( &src[i + 4] ), k ) );
+        _mm_storeu_ps( &dst[i], lo );
+        _mm_storeu_ps( &dst[i + 4], hi );
+    }
+    Fl64toFl32C( &dst[i], &src[i], count - i, gain );
+}
+
+__attribute__ ((__target__ ("avx")))
+static void Fl32toS16AVX( int16_t *dst, const float *src, size_t count,
+                          float gain )
+{
+    const __m256 k = _mm256_set1_ps( gain * 32768.f );
+    size_t i = 0;
+
+    for( ; i + 16 <= count; i += 16 )
+    {
+        const __m256 a = _mm256_mul_ps( _mm256_loadu_ps( &src[i] ), k );
+        const __m256 b = _mm256_mul_ps( _mm256_loadu_ps( &src[i + 8] ), k );
+        _mm_storeu_si128( (__m128i *)&dst[i], Fl32x8toS16AVX( a ) );
+        _mm_storeu_si128( (__m128i *)&dst[i + 8], Fl32x8toS16AVX( b ) );
+    }
+    Fl32toS16C( &dst[i], &src[i], count - i, gain );
+}
+
+__attribute__ ((__target__ ("avx")))
+static void Fl32toS32AVX( int32_t *dst, const float *src, size_t count,
+                          float gain )
+{
+    const __m256 k = _mm256_set1_ps( gain * 2147483648.f );
+    const __m256 max = _mm256_set1_ps( 2147483648.f );
+    size_t i = 0;
+
+    for( ; i + 8 <= count; i += 8 )
+    {
+        const __m256 v = _mm256_mul_ps( _mm256_loadu_ps( &src[i] ), k );
+        const __m256 r = _mm256_xor_ps(
+                             _mm256_castsi256_ps( _mm256_cvtps_epi32( v ) ),
+                             _mm256_cmp_ps( v, max, _CMP_GE_OQ ) );
+        _mm256_storeu_si256( (__m256i *)&dst[i], _mm256_castps_si256( r ) );
+    }
+    Fl32toS32C( &dst[i], &src[i], count - i, gain );
+}
+
+__attribute__ ((__target__ ("avx")))
+static void Fl32toFl64AVX( double *dst, const float *src, size_t count,
+                           float gain )
+{
+    const __m256d k = _mm256_set1_pd( gain );
+    size_t i = 0;
+
+    for( ; i + 4 <= count; i += 4 )
+    {
+        const __m256d v = _mm256_cvtps_pd( _mm_loadu_ps( &src[i] ) );
+        _mm256_storeu_pd( &dst[i], _mm256_mul_pd( v, k ) );
+    }
+    Fl32toFl64C( &dst[i], &src[i], count - i, gain );
+}
+
+__attribute__ ((__target__ ("avx")))
+static void AmplifyS16AVX( int16_t *dst, const int16_t *src, size_t count,
+                           float gain )
+{
+    const __m256 k = _mm256_set1_ps( gain );
+    size_t i = 0;
+
+    for( ; i + 8 <= count; i += 8 )
+    {
+        const __m256 v = S16x8toFl32AVX(
+                             _mm_loadu_si128( (const __m128i *)&src[i] ) );
+        _mm_storeu_si128( (__m128i *)&dst[i],
+                          Fl32x8toS16AVX( _mm256_mul_ps( v, k ) ) );
+    }
+    AmplifyS16C( &dst[i], &src[i], count - i, gain );
+}
+
+__attribute__ ((__target__ ("avx")))
+static void AmplifyFl32AVX( float *dst, const float *src, size_t count,
+                            float gain )
+{
+    const __m256 k = _mm256_set1_ps( gain );
+    size_t i = 0;
+
+    for( ; i + 16 <= count; i += 16 )
+    {
+        const __m256 a = _mm256_mul_ps( _mm256_loadu_ps( &src[i] ), k );
+        const __m256 b = _mm256_mul_ps( _mm256_loadu_ps( &src[i + 8] ), k );
+        _mm256_storeu_ps( &dst[i], a );
+        _mm256_storeu_ps( &dst[i + 8], b );
+    }
+    AmplifyFl32C( &dst[i], &src[i], count - i, gain );
+}
+
+__attribute__ ((__target__ ("avx")))
+static void AmplifyFl64AVX( double *dst, const double *src, size_t count,
+                            double gain )
+{
+    const __m256d k = _mm256_set1_pd( gain );
+    size_t i = 0;
+
+    for( ; i + 8 <= count; i += 8 )
+    {
+        const __m256d a = _mm256_mul_pd( _mm256_loadu_pd( &src[i] ), k );
+        const __m256d b = _mm256_mul_pd( _mm256_loadu_pd( &src[i + 4] ), k );
+        _mm256_storeu_pd( &dst[i], a );
+        _mm256_storeu_pd( &dst[i + 4], b );
+    }
+    AmplifyFl64C( &dst[i], &src[i], count - i, gain );
+}
+#endif
+
+#ifdef __ARM_NEON
+static void S16toFl32NEON( float *dst, const int16_t *src, size_t count,
+                           float gain )
+{
+    const float k = gain * 0x1p-15f;
+    size_t i = 0;
+
+    for( ; i + 8 <= count; i += 8 )
+    {
+        const int16x8_t x = vld1q_s16( &src[i] );
+        const float32x4_t lo = vcvtq_f32_s32( vmovl_s16( vget_low_s16( x ) ) );
+        const float32x4_t hi = vcvtq_f32_s32( vmovl_s16( vget_high_s16( x ) ) );
+        vst1q_f32( &dst[i], vmulq_n_f32( lo, k ) );
+        vst1q_f32( &dst[i + 4], vmulq_n_f32( hi, k ) );
+    }
+    S16toFl32C( &dst[i], &src[i], count - i, gain );
+}
+
+static void S32toFl32NEON( float *dst, const int32_t *src, size_t count,
+                           float gain )
+{
+    const float k = gain * 0x1p-31f;
+    size_t i = 0;
+
+    for( ; i + 4 <= count; i += 4 )
+        vst1q_f32( &dst[i], vmulq_n_f32( vcvtq_f32_s32( vld1q_s32( &src[i] ) ),
+                                         k ) );
+    S32toFl32C( &dst[i], &src[i], count - i, gain );
+}
+
+static void AmplifyFl32NEON( float *dst, const float *src, size_t count,
+                             float gain )
+{
+    size_t i = 0;
+
+    for( ; i + 8 <= count; i += 8 )
+    {
+        const float32x4_t a = vmulq_n_f32( vld1q_f32( &src[i] ), gain );
+        const float32x4_t b = vmulq_n_f32( vld1q_f32( &src[i + 4] ), gain );
+        vst1q_f32( &dst[i], a );
+        vst1q_f32( &dst[i + 4], b );
+    }
+    AmplifyFl32C( &dst[i], &src[i], count - i, gain );
+}
+
+# ifdef __aarch64__
+/* Only AArch64 converts to integers with rounding to nearest */
+static inline int16x8_t Fl32x8toS16NEON( float32x4_t lo, float32x4_t hi )
+{
+    const float32x4_t max = vdupq_n_f32( 32767.f );
+    const float32x4_t min = vdupq_n_f32( -32768.f );
+
+    lo = vmaxq_f32( vminq_f32( lo, max ), min );
+    hi = vmaxq_f32( vminq_f32( hi, max ), min );
+    return vcombine_s16( vqmovn_s32( vcvtnq_s32_f32( lo ) ),
+                         vqmovn_s32( vcvtnq_s32_f32( hi ) ) );
+}
+
+static void Fl32toS16NEON( int16_t *dst, const float *src, size_t count,
+                           float gain )
+{
+    const float k = gain * 32768.f;
+    size_t i = 0;
+
+    for( ; i + 8 <= count; i += 8 )
+    {
+        const float32x4_t lo = vmulq_n_f32( vld1q_f32( &src[i] ), k );
+        const float32x4_t hi = vmulq_n_f32( vld1q_f32( &src[i + 4] ), k );
+        vst1q_s16( &dst[i], Fl32x8toS16NEON( lo, hi ) );
+    }
+    Fl32toS16C( &dst[i], &src[i], count - i, gain );
+}
+
+static void Fl32toS32NEON( int32_t *dst, const float *src, size_t count,
+                           float gain )
+{
+    const float k = gain * 2147483648.f;
+    size_t i = 0;
+
+    /* The conversion saturates */
+    for( ; i + 4 <= count; i += 4 )
+        vst1q_s32( &dst[i],
+                   vcvtnq_s32_f32( vmulq_n_f32( vld1q_f32( &src[i] ), k ) ) );
+    Fl32toS32C( &dst[i], &src[i], count - i, gain );
+}
+
+static void AmplifyS16NEON( int16_t *dst, const int16_t *src, size_t count,
+                            float gain )
+{
+    size_t i = 0;
+
+    for( ; i + 8 <= count; i += 8 )
+    {
+        const int16x8_t x = vld1q_s16( &src[i] );
+        const float32x4_t lo = vcvtq_f32_s32( vmovl_s16( vget_low_s16( x ) ) );
+        const float32x4_t hi = vcvtq_f32_s32( vmovl_s16( vget_high_s16( x ) ) );
+        vst1q_s16( &dst[i], Fl32x8toS16NEON( vmulq_n_f32( lo, gain ),
+                                             vmulq_n_f32( hi, gain ) ) );
+    }
+    AmplifyS16C( &dst[i], &src[i], count - i, gain );
+}
+# else
+#  define Fl32toS16NEON Fl32toS16C
+#  define Fl32toS32NEON Fl32toS32C
+#  define AmplifyS16NEON AmplifyS16C
+# endif
+#endif
+
+static const pcm_kernels_t kernels[] = {
+#ifdef HAVE_AVX2_INTRINSICS
+    { "avx", S16toFl32AVX, S32toFl32AVX, Fl64toFl32AVX, Fl32toS16AVX,
+      Fl32toS32AVX, Fl32toFl64AVX, AmplifyS16AVX, AmplifyFl32AVX,
+      AmplifyFl64AVX },
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+    { "sse2", S16toFl32SSE2, S32toFl32SSE2, Fl64toFl32SSE2, Fl32toS16SSE2,
+      Fl32toS32SSE2, Fl32toFl64SSE2, AmplifyS16SSE2, AmplifyFl32SSE2,
+      AmplifyFl64SSE2 },
+#endif
+#ifdef __ARM_NEON
+    /* The double precision formats are left to the C kernels */
+    { "neon", S16toFl32NEON, S32toFl32NEON, Fl64toFl32C, Fl32toS16NEON,
+      Fl32toS32NEON, Fl32toFl64C, AmplifyS16NEON, AmplifyFl32NEON,
+      AmplifyFl64C },
+#endif
+    { "c", S16toFl32C, S32toFl32C, Fl64toFl32C, Fl32toS16C, Fl32toS32C,
+      Fl32toFl64C, AmplifyS16C, AmplifyFl32C, AmplifyFl64C },
+};
+
+const pcm_kernels_t *pcm_kernels_Get( const char *name )
+{
+    const bool any = !strcmp( name, "any" );
+
+    for( size_t k = 0; k < ARRAY_SIZE(kernels); k++ )
+        if( (any || !strcmp( name, kernels[k].name ))
+         && vlc_CPU_CheckKernels( kernels[k].name ) )
+            return &kernels[k];
+    return NULL;
+}
+
+#ifdef PCM_KERNELS_TEST
+#include <stdio.h>
+#include <unistd.h>
+
+static uint32_t Random( uint32_t *seed )
+{
+    *seed = *seed * 1103515245 + 12345;
+    return *seed >> 8;
+}
+
+/* Mostly in [-1, 1), some beyond to saturate, some exact halves to round */
+static void Fill( float *p, size_t count, uint32_t seed )
+{
+    for( size_t i = 0; i < count; i++ )
+    {
+        uint32_t r = Random( &seed );
+
+        switch( r % 8 )
+        {
+            case 0:
+                p[i] = ((int)(r >> 8) % 65536 - 32768 + .5f) / 32768.f;
+                break;
+            case 1:
+                p[i] = ((int)(r >> 8) % 4096 - 2048) / 1024.f;
+                break;
+            default:
+                p[i] = (float)(r & 0xffff) / 32768.f - 1.f;
+        }
+    }
+}
+
+#ifndef PCM_KERNELS_BENCH
+#define TEST_SAMPLES 67 /* not a multiple of any vector size */
+
+/* Checks the kernel against the C one, out of place and unaligned, and in
+ * place if not widening */
+#define CHECK(func, dst_t, src_t, in_place, gain) \
+    do { \
+        dst_t ref[TEST_SAMPLES], out[TEST_SAMPLES + 1]; \
+        union { src_t s[TEST_SAMPLES]; dst_t d[TEST_SAMPLES]; } io; \
+        for( size_t n = 0; n <= TEST_SAMPLES; n++ ) \
+        { \
+            c->func( ref, src, n, gain ); \
+            k->func( out + 1, src, n, gain ); \
+            assert( !memcmp( ref, out + 1, n * sizeof(dst_t) ) ); \
+            if( in_place ) \
+            { \
+                memcpy( io.s, src, n * sizeof(src_t) ); \
+                k->func( io.d, io.s, n, gain ); \
+                assert( !memcmp( ref, io.d, n * sizeof(dst_t) ) ); \
+            } \
+        } \
+    } while( 0 )
+
+static void Test( const pcm_kernels_t *k, float gain, uint32_t seed )
+{
+    const pcm_kernels_t *c = pcm_kernels_Get( "c" );
+    float f32[TEST_SAMPLES];
+    double f64[TEST_SAMPLES];
+    int16_t s16[TEST_SAMPLES];
+    int32_t s32[TEST_SAMPLES];
+
+    Fill( f32, TEST_SAMPLES, seed );
+    for( size_t i = 0; i < TEST_SAMPLES; i++ )
+    {
+        f64[i] = f32[i] + 0x1p-30 * i;
+        s16[i] = SatS16( f32[i] * 32768.f );
+        s32[i] = SatS32( f32[i] * 2147483648.f ) ^ (i & 0xff);
+    }
+
+    {
+        const int16_t *src = s16;
+        CHECK( s16_to_fl32, float, int16_t, false, gain );
+        CHECK( amplify_s16, int16_t, int16_t, true, gain );
+    }
+    {
+        const int32_t *src = s32;
+        CHECK( s32_to_fl32, float, int32_t, true, gain );
+    }
+    {
+        const double *src = f64;
+        CHECK( fl64_to_fl32, float, double, true, gain );
+        CHECK( amplify_fl64, double, double, true, gain );
+    }
+    {
+        const float *src = f32;
+        CHECK( fl32_to_s16, int16_t, float, true, gain );
+        CHECK( fl32_to_s32, int32_t, float, true, gain );
+        CHECK( fl32_to_fl64, double, float, false, gain );
+        CHECK( amplify_fl32, float, float, true, gain );
+    }
+}
+
+/* Checks the scaling, rounding and saturation of the C kernels */
+static void TestReference( void )
+{
+    const pcm_kernels_t *c = pcm_kernels_Get( "c" );
+    const int16_t s16[] = { INT16_MIN, -1, 0, 1, INT16_MAX };
+    const int32_t s32[] = { INT32_MIN, 1 << 30 };
+    const float f32[] = { -2.f, -1.f, .5f / 32768.f, 1.5f / 32768.f,
+                          2.5f / 32768.f, 1.f, 2.f };
+    float f[ARRAY_SIZE(f32)];
+    int16_t i16[ARRAY_SIZE(f32)];
+    int32_t i32[ARRAY_SIZE(f32)];
+
+    c->s16_to_fl32( f, s16, ARRAY_SIZE(s16), 1.f );
+    assert( f[0] == -1.f && f[1] == -1.f / 32768.f && f[2] == 0.f );
+    assert( f[4] == 32767.f / 32768.f );
+    c->s16_to_fl32( f, s16, ARRAY_SIZE(s16), .5f );
+    assert( f[0] == -.5f );
+
+    c->s32_to_fl32( f, s32, ARRAY_SIZE(s32), 1.f );
+    assert( f[0] == -1.f && f[1] == .5f );
+
+    c->fl32_to_s16( i16, f32, ARRAY_SIZE(f32), 1.f );
+    assert( i16[0] == INT16_MIN && i16[1] == INT16_MIN );
+    assert( i16[2] == 0 && i16[3] == 2 && i16[4] == 2 ); /* to even */
+    assert( i16[5] == INT16_MAX && i16[6] == INT16_MAX );
+
+    c->fl32_to_s32( i32, f32, ARRAY_SIZE(f32), 1.f );
+    assert( i32[0] == INT32_MIN && i32[1] == INT32_MIN );
+    assert( i32[2] == 1 << 15 );
+    assert( i32[5] == INT32_MAX && i32[6] == INT32_MAX );
+
+    c->amplify_s16( i16, s16, ARRAY_SIZE(s16), 2.f );
+    assert( i16[0] == INT16_MIN && i16[1] == -2 && i16[3] == 2 );
+    assert( i16[4] == INT16_MAX );
+}
+#else
+static void Bench( const pcm_kernels_t *k )
+{
+    const size_t count = 2 * 48000 / 100; /* 10 ms stereo blocks */
+    const unsigned loops = 100000;
+    int16_t *s16 = malloc( count * sizeof(*s16) );
+    float *f32 = malloc( count * sizeof(*f32) );
+    vlc_tick_t time;
+
+    assert( s16 != NULL && f32 != NULL );
+    Fill( f32, count, 42 );
+    k->fl32_to_s16( s16, f32, count, 1.f );
+
+#define BENCH(what, code) \
+    do { \
+        time = vlc_tick_now(); \
+        for( unsigned i = 0; i < loops; i++ ) \
+            code; \
+        time = vlc_tick_now() - time; \
+        printf( "%-4s %-26s: %7.1f Msamples/s\n", k->name, what, \
+                (double)count * loops / 1e6 \
+                / secf_from_vlc_tick( __MAX(time, 1) ) ); \
+    } while( 0 )
+
+    BENCH( "S16 to FL32, then gain", {
+        k->s16_to_fl32( f32, s16, count, 1.f );
+        k->amplify_fl32( f32, f32, count, .5f );
+    } );
+    BENCH( "S16 to FL32 with gain", k->s16_to_fl32( f32, s16, count, .5f ) );
+    BENCH( "FL32 gain", k->amplify_fl32( f32, f32, count, 1.f ) );
+    BENCH( "S16 gain", k->amplify_s16( s16, s16, count, 1.f ) );
+    BENCH( "FL32 to S16", k->fl32_to_s16( s16, f32, count, 1.f ) );
+#undef BENCH
+
+    free( f32 );
+    free( s16 );
+}
+#endif
+
+int main( void )
+{
+#ifndef PCM_KERNELS_BENCH
+    alarm( 30 );
+    TestReference();
+#endif
+
+    for( size_t i = 0; i < ARRAY_SIZE(kernels); i++ )
+    {
+        const pcm_kernels_t *k = pcm_kernels_Get( kernels[i].name );
+
+        if( k == NULL )
+        {
+            fprintf( stderr, "WARNING: could not test %s\n",
+                     kernels[i].name );
+            continue;
+        }
+
+#ifndef PCM_KERNELS_BENCH
+        static const float gains[] = { 1.f, 0.f, .5f, .316f, 1.4f, 3.f };
+        for( size_t g = 0; g < ARRAY_SIZE(gains); g++ )
+            for( uint32_t seed = 1; seed <= 20; seed++ )
+                Test( k, gains[g], seed );
+#else
+        Bench( k );
+#endif
+    }
+    return 0;
+}
+#endif
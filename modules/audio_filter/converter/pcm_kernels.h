@@ -0,0 +1,69 @@
+/*****************************************************************************
+ * pcm_kernels.h : vectorized PCM conversion and gain kernels
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_AUDIO_FILTER_PCM_KERNELS_H
+#define VLC_AUDIO_FILTER_PCM_KERNELS_H
+
+/**
+ * Sample format conversion kernels, with a gain applied on the way.
+ *
+ * Every kernel converts count samples and scales them by gain in a single
+ * pass, so that the volume costs nothing more than the conversion. A gain of
+ * 1 gives the plain conversion. Integers are scaled to and from [-1, 1),
+ * rounded to nearest and saturated.
+ *
+ * The destination may be the source (in place conversion), unless the
+ * destination samples are wider than the source ones. All the kernels of a
+ * set give the same results, bit for bit.
+ */
+typedef struct
+{
+    const char *name;
+
+    void (*s16_to_fl32)( float *dst, const int16_t *src, size_t count,
+                         float gain );
+    void (*s32_to_fl32)( float *dst, const int32_t *src, size_t count,
+                         float gain );
+    void (*fl64_to_fl32)( float *dst, const double *src, size_t count,
+                          float gain );
+    void (*fl32_to_s16)( int16_t *dst, const float *src, size_t count,
+                         float gain );
+    void (*fl32_to_s32)( int32_t *dst, const float *src, size_t count,
+                         float gain );
+    void (*fl32_to_fl64)( double *dst, const float *src, size_t count,
+                          float gain );
+
+    /* Same format in and out */
+    void (*amplify_s16)( int16_t *dst, const int16_t *src, size_t count,
+                         float gain );
+    void (*amplify_fl32)( float *dst, const float *src, size_t count,
+                          float gain );
+    void (*amplify_fl64)( double *dst, const double *src, size_t count,
+                          double gain );
+} pcm_kernels_t;
+
+/**
+ * \param name "any" for the fastest kernels available, or the name of a
+ * specific set ("c", "sse2", "avx", "neon")
+ * \return the kernels, or NULL if not available
+ */
+const pcm_kernels_t *pcm_kernels_Get( const char *name );
+
+#endif
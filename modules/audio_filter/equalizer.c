@@ -38,9 +38,9 @@
 #include <vlc_filter.h>
 
 #include "equalizer_presets.h"
+#include "biquad.h"
 
 /* TODO:
- *  - optimize a bit (you can hardly do slower ;)
  *  - add tables for more bands (15 and 32 would be cool), maybe with auto coeffs
  *    computation (not too hard once the Q is found).
  *  - support for external preset
@@ -113,13 +113,10 @@ typedef struct
     float f_gamp;   /* Global preamp */
     bool b_2eqz;
 
-    /* Filter state */
-    float x[32][2];
-    float y[32][128][2];
-
-    /* Second filter state */
-    float x2[32][2];
-    float y2[32][128][2];
+    /* Filters, with their state */
+    biquad_bank_t *p_bank;
+    biquad_bank_t *p_bank2; /* second pass */
+    float *f_gains;
 
     vlc_mutex_t lock;
 } filter_sys_t;
@@ -280,7 +277,7 @@ static int EqzInit( filter_t *p_filter, int i_rate )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
     eqz_config_t cfg;
-    int i, ch;
+    int i;
     vlc_value_t val1, val2, val3;
     vlc_object_t *p_aout = vlc_object_parent(p_filter);
     int i_ret = VLC_ENOMEM;
@@ -288,6 +285,9 @@ static int EqzInit( filter_t *p_filter, int i_rate )
     bool b_vlcFreqs = var_InheritBool( p_aout, "equalizer-vlcfreqs" );
     EqzCoeffs( i_rate, 1.0f, b_vlcFreqs, &cfg );
 
+    p_sys->p_bank = p_sys->p_bank2 = NULL;
+    p_sys->f_gains = NULL;
+
     /* Create the static filter config */
     p_sys->i_band = cfg.i_band;
     p_sys->f_alpha = vlc_alloc( p_sys->i_band, sizeof(float) );
@@ -315,21 +315,26 @@ static int EqzInit( filter_t *p_filter, int i_rate )
         p_sys->f_amp[i] = 0.0f;
     }
 
-    /* Filter state */
-    for( ch = 0; ch < 32; ch++ )
+    /* Filters: each band is a band-pass biquad, whose outputs are mixed with
+     * the input */
+    unsigned i_channels = aout_FormatNbChannels( &p_filter->fmt_in.audio );
+    p_sys->p_bank = biquad_bank_New( i_channels, p_sys->i_band, true, "any" );
+    p_sys->p_bank2 = biquad_bank_New( i_channels, p_sys->i_band, true, "any" );
+    p_sys->f_gains = vlc_alloc( p_sys->i_band, sizeof(float) );
+    if( !p_sys->p_bank || !p_sys->p_bank2 || !p_sys->f_gains )
     {
-        p_sys->x[ch][0]  =
-        p_sys->x[ch][1]  =
-        p_sys->x2[ch][0] =
-        p_sys->x2[ch][1] = 0.0f;
+        free( p_sys->f_amp );
+        goto error;
+    }
 
-        for( i = 0; i < p_sys->i_band; i++ )
-        {
-            p_sys->y[ch][i][0]  =
-            p_sys->y[ch][i][1]  =
-            p_sys->y2[ch][i][0] =
-            p_sys->y2[ch][i][1] = 0.0f;
-        }
+    for( i = 0; i < p_sys->i_band; i++ )
+    {
+        const biquad_coeffs_t coeffs = {
+            .b0 = p_sys->f_alpha[i], .b1 = 0.0f, .b2 = -p_sys->f_alpha[i],
+            .a1 = -p_sys->f_gamma[i], .a2 = p_sys->f_beta[i],
+        };
+        biquad_bank_SetCoeffs( p_sys->p_bank, i, &coeffs );
+        biquad_bank_SetCoeffs( p_sys->p_bank2, i, &coeffs );
     }
 
     var_Create( p_aout, "equalizer-bands", VLC_VAR_STRING | VLC_VAR_DOINHERIT );
@@ -368,8 +373,9 @@ static int EqzInit( filter_t *p_filter, int i_rate )
     var_AddCallback( p_aout, "equalizer-preamp", PreampCallback, p_sys );
     var_AddCallback( p_aout, "equalizer-2pass", TwoPassCallback, p_sys );
 
-    msg_Dbg( p_filter, "equalizer loaded for %d Hz with %d bands %d pass",
-                        i_rate, p_sys->i_band, p_sys->b_2eqz ? 2 : 1 );
+    msg_Dbg( p_filter, "equalizer loaded for %d Hz with %d bands %d pass "
+             "(%s)", i_rate, p_sys->i_band, p_sys->b_2eqz ? 2 : 1,
+             biquad_bank_Kernel( p_sys->p_bank ) );
     for( i = 0; i < p_sys->i_band; i++ )
     {
         msg_Dbg( p_filter, "   %.2f Hz -> factor:%f alpha:%f beta:%f gamma:%f",
@@ -379,71 +385,45 @@ static int EqzInit( filter_t *p_filter, int i_rate )
     return VLC_SUCCESS;
 
 error:
+    if( p_sys->p_bank )
+        biquad_bank_Delete( p_sys->p_bank );
+    if( p_sys->p_bank2 )
+        biquad_bank_Delete( p_sys->p_bank2 );
+    free( p_sys->f_gains );
     free( p_sys->f_alpha );
     free( p_sys->f_beta );
     free( p_sys->f_gamma );
     return i_ret;
 }
 
+static void EqzSetGains( filter_sys_t *p_sys, biquad_bank_t *p_bank,
+                         float f_gain )
+{
+    for( int i = 0; i < p_sys->i_band; i++ )
+        p_sys->f_gains[i] = f_gain * p_sys->f_amp[i];
+    biquad_bank_SetGains( p_bank, f_gain * EQZ_IN_FACTOR, p_sys->f_gains );
+}
+
 static void EqzFilter( filter_t *p_filter, float *out, float *in,
                        int i_samples, int i_channels )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
-    int i, ch, j;
+    VLC_UNUSED( i_channels );
 
     vlc_mutex_lock( &p_sys->lock );
-    for( i = 0; i < i_samples; i++ )
+    /* We add source PCM + filtered PCM */
+    if( p_sys->b_2eqz )
     {
-        for( ch = 0; ch < i_channels; ch++ )
-        {
-            const float x = in[ch];
-            float o = 0.0f;
-
-            for( j = 0; j < p_sys->i_band; j++ )
-            {
-                float y = p_sys->f_alpha[j] * ( x - p_sys->x[ch][1] ) +
-                          p_sys->f_gamma[j] * p_sys->y[ch][j][0] -
-                          p_sys->f_beta[j]  * p_sys->y[ch][j][1];
-
-                p_sys->y[ch][j][1] = p_sys->y[ch][j][0];
-                p_sys->y[ch][j][0] = y;
-
-                o += y * p_sys->f_amp[j];
-            }
-            p_sys->x[ch][1] = p_sys->x[ch][0];
-            p_sys->x[ch][0] = x;
-
-            /* Second filter */
-            if( p_sys->b_2eqz )
-            {
-                const float x2 = EQZ_IN_FACTOR * x + o;
-                o = 0.0f;
-                for( j = 0; j < p_sys->i_band; j++ )
-                {
-                    float y = p_sys->f_alpha[j] * ( x2 - p_sys->x2[ch][1] ) +
-                              p_sys->f_gamma[j] * p_sys->y2[ch][j][0] -
-                              p_sys->f_beta[j]  * p_sys->y2[ch][j][1];
-
-                    p_sys->y2[ch][j][1] = p_sys->y2[ch][j][0];
-                    p_sys->y2[ch][j][0] = y;
-
-                    o += y * p_sys->f_amp[j];
-                }
-                p_sys->x2[ch][1] = p_sys->x2[ch][0];
-                p_sys->x2[ch][0] = x2;
-
-                /* We add source PCM + filtered PCM */
-                out[ch] = p_sys->f_gamp * p_sys->f_gamp *( EQZ_IN_FACTOR * x2 + o );
-            }
-            else
-            {
-                /* We add source PCM + filtered PCM */
-                out[ch] = p_sys->f_gamp *( EQZ_IN_FACTOR * x + o );
-            }
-        }
-
-        in  += i_channels;
-        out += i_channels;
+        /* The second filter takes the unscaled output of the first one */
+        EqzSetGains( p_sys, p_sys->p_bank, 1.0f );
+        EqzSetGains( p_sys, p_sys->p_bank2, p_sys->f_gamp * p_sys->f_gamp );
+        biquad_bank_Process( p_sys->p_bank, out, in, i_samples );
+        biquad_bank_Process( p_sys->p_bank2, out, out, i_samples );
+    }
+    else
+    {
+        EqzSetGains( p_sys, p_sys->p_bank, p_sys->f_gamp );
+        biquad_bank_Process( p_sys->p_bank, out, in, i_samples );
     }
     vlc_mutex_unlock( &p_sys->lock );
 }
@@ -458,6 +438,10 @@ static void EqzClean( filter_t *p_filter )
     var_DelCallback( p_aout, "equalizer-preamp", PreampCallback, p_sys );
     var_DelCallback( p_aout, "equalizer-2pass", TwoPassCallback, p_sys );
 
+    biquad_bank_Delete( p_sys->p_bank );
+    biquad_bank_Delete( p_sys->p_bank2 );
+    free( p_sys->f_gains );
+
     free( p_sys->f_alpha );
     free( p_sys->f_beta );
     free( p_sys->f_gamma );
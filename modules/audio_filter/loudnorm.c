@@ -0,0 +1,155 @@
+/*****************************************************************************
+ * loudnorm.c : EBU R128 loudness normalizer
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <math.h>
+
+#include <vlc_common.h>
+#include <vlc_aout.h>
+#include <vlc_filter.h>
+#include <vlc_loudness.h>
+#include <vlc_plugin.h>
+
+#include "converter/pcm_kernels.h"
+
+#define TARGET_TEXT N_("Target loudness")
+#define TARGET_LONGTEXT N_("Loudness the audio is normalized to, in LUFS: " \
+    "-23 for EBU R128, -18 for ReplayGain 2.0.")
+
+#define MAX_GAIN_TEXT N_("Maximum gain")
+#define MAX_GAIN_LONGTEXT N_("Highest amplification of quiet audio, in dB.")
+
+static int Open(vlc_object_t *);
+static void Close(vlc_object_t *);
+
+vlc_module_begin ()
+    set_shortname (N_("Loudness normalizer"))
+    set_description (N_("EBU R128 loudness normalizer"))
+    set_category (CAT_AUDIO)
+    set_subcategory (SUBCAT_AUDIO_AFILTER)
+    add_float_with_range ("loudnorm-target", VLC_LOUDNESS_REPLAY_GAIN_REFERENCE,
+                          -40., -5., TARGET_TEXT, TARGET_LONGTEXT, false)
+    add_float_with_range ("loudnorm-max-gain", 12., 0., 40.,
+                          MAX_GAIN_TEXT, MAX_GAIN_LONGTEXT, true)
+    set_capability ("audio filter", 0)
+    set_callbacks (Open, Close)
+vlc_module_end ()
+
+/* The gain follows the integrated loudness of what was played so far, which
+ * settles down after a few seconds. It is ramped over each block, and kept
+ * below the level that would clip the highest peak measured. */
+typedef struct
+{
+    vlc_loudness_t *meter;
+    const pcm_kernels_t *kernels;
+    float target;   /* LUFS */
+    float max_gain; /* dB */
+    float gain;     /* linear, applied at the end of the last block */
+} filter_sys_t;
+
+static block_t *Process(filter_t *, block_t *);
+
+static int Open(vlc_object_t *obj)
+{
+    filter_t *filter = (filter_t *)obj;
+
+    filter->fmt_in.audio.i_format = VLC_CODEC_FL32;
+    aout_FormatPrepare(&filter->fmt_in.audio);
+    filter->fmt_out.audio = filter->fmt_in.audio;
+
+    filter_sys_t *sys = malloc(sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return VLC_ENOMEM;
+
+    sys->meter = vlc_loudness_New(&filter->fmt_in.audio);
+    if (sys->meter == NULL)
+    {
+        free(sys);
+        return VLC_EGENERIC;
+    }
+    sys->kernels = pcm_kernels_Get("any");
+    sys->target = var_InheritFloat(obj, "loudnorm-target");
+    sys->max_gain = var_InheritFloat(obj, "loudnorm-max-gain");
+    sys->gain = 1.f;
+
+    msg_Dbg(obj, "normalizing to %.1f LUFS, up to %+.1f dB, %s kernels",
+            sys->target, sys->max_gain, sys->kernels->name);
+
+    filter->p_sys = sys;
+    filter->pf_audio_filter = Process;
+    return VLC_SUCCESS;
+}
+
+static void Close(vlc_object_t *obj)
+{
+    filter_t *filter = (filter_t *)obj;
+    filter_sys_t *sys = filter->p_sys;
+
+    vlc_loudness_Delete(sys->meter);
+    free(sys);
+}
+
+static float GetGain(filter_sys_t *sys)
+{
+    /* Keep the gain until a first block passes the gates */
+    const double loudness = vlc_loudness_GetIntegrated(sys->meter);
+    if (!isfinite(loudness))
+        return sys->gain;
+
+    float db = sys->target - loudness;
+    if (db > sys->max_gain)
+        db = sys->max_gain;
+
+    const float peak = vlc_loudness_GetPeak(sys->meter);
+    if (peak > 0.f && db > -20.f * log10f(peak))
+        db = -20.f * log10f(peak);
+    return powf(10.f, db / 20.f);
+}
+
+static block_t *Process(filter_t *filter, block_t *block)
+{
+    filter_sys_t *sys = filter->p_sys;
+    const unsigned channels = filter->fmt_in.audio.i_channels;
+    const size_t frames = block->i_nb_samples;
+    float *buf = (float *)block->p_buffer;
+
+    vlc_loudness_Process(sys->meter, buf, frames);
+
+    const float gain = GetGain(sys);
+    if (fabsf(gain - sys->gain) < 1e-4f * gain)
+        sys->kernels->amplify_fl32(buf, buf, frames * channels, gain);
+    else
+    {
+        const float step = (gain - sys->gain) / frames;
+        float g = sys->gain;
+
+        for (size_t i = 0; i < frames; i++)
+        {
+            g += step;
+            for (unsigned c = 0; c < channels; c++)
+                buf[i * channels + c] *= g;
+        }
+    }
+    sys->gain = gain;
+    return block;
+}
@@ -0,0 +1,200 @@
+/*****************************************************************************
+ * polyphase.c : vectorized polyphase resampler
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_aout.h>
+#include <vlc_filter.h>
+#include <vlc_plugin.h>
+
+#include "polyphase_filter.h"
+
+#define QUALITY_TEXT N_("Resampling quality")
+#define QUALITY_LONGTEXT N_("Resampling quality, from fastest to best. " \
+    "Better quality uses longer filters, which need more CPU time.")
+
+static const int quality_values[] = {
+    POLYPHASE_FAST, POLYPHASE_MEDIUM, POLYPHASE_HIGH,
+};
+static const char *const quality_texts[] = {
+    N_("Fast"), N_("Medium"), N_("High"),
+};
+
+static int OpenConverter(vlc_object_t *);
+static int OpenResampler(vlc_object_t *);
+static void Close(vlc_object_t *);
+
+vlc_module_begin ()
+    set_shortname (N_("Polyphase resampler"))
+    set_description (N_("Polyphase windowed sinc resampler"))
+    set_category (CAT_AUDIO)
+    set_subcategory (SUBCAT_AUDIO_RESAMPLER)
+    add_integer ("polyphase-resampler-quality", POLYPHASE_MEDIUM,
+                 QUALITY_TEXT, QUALITY_LONGTEXT, true)
+        change_integer_list (quality_values, quality_texts)
+    set_capability ("audio converter", 40)
+    set_callbacks (OpenConverter, Close)
+
+    add_submodule ()
+    set_capability ("audio resampler", 40)
+    set_callbacks (OpenResampler, Close)
+    add_shortcut ("polyphase")
+vlc_module_end ()
+
+typedef struct
+{
+    polyphase_filter_t *pf;
+    date_t end_date;
+} filter_sys_t;
+
+static block_t *Resample(filter_t *, block_t *);
+static block_t *Drain(filter_t *);
+static void Flush(filter_t *);
+
+static int OpenResampler(vlc_object_t *obj)
+{
+    filter_t *filter = (filter_t *)obj;
+
+    /* Cannot convert format */
+    if (filter->fmt_in.audio.i_format != VLC_CODEC_FL32
+     || filter->fmt_out.audio.i_format != VLC_CODEC_FL32
+    /* Cannot remix */
+     || filter->fmt_in.audio.i_channels != filter->fmt_out.audio.i_channels
+     || filter->fmt_in.audio.i_channels == 0)
+        return VLC_EGENERIC;
+
+    filter_sys_t *sys = malloc(sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return VLC_ENOMEM;
+
+    unsigned q = var_InheritInteger(obj, "polyphase-resampler-quality");
+    if (unlikely(q > POLYPHASE_QUALITY_MAX))
+        q = POLYPHASE_MEDIUM;
+
+    sys->pf = polyphase_filter_New(filter->fmt_in.audio.i_channels,
+                                   filter->fmt_in.audio.i_rate,
+                                   filter->fmt_out.audio.i_rate, q, "any");
+    if (sys->pf == NULL)
+    {
+        msg_Err(obj, "cannot resample from %u to %u Hz",
+                filter->fmt_in.audio.i_rate, filter->fmt_out.audio.i_rate);
+        free(sys);
+        return VLC_EGENERIC;
+    }
+    date_Init(&sys->end_date, filter->fmt_out.audio.i_rate, 1);
+
+    msg_Dbg(obj, "%u to %u Hz, %s quality, %s kernel",
+            filter->fmt_in.audio.i_rate, filter->fmt_out.audio.i_rate,
+            quality_texts[q], polyphase_filter_Kernel(sys->pf));
+
+    filter->p_sys = sys;
+    filter->pf_audio_filter = Resample;
+    filter->pf_audio_drain = Drain;
+    filter->pf_flush = Flush;
+    return VLC_SUCCESS;
+}
+
+static int OpenConverter(vlc_object_t *obj)
+{
+    filter_t *filter = (filter_t *)obj;
+
+    /* Will change rate */
+    if (filter->fmt_in.audio.i_rate == filter->fmt_out.audio.i_rate)
+        return VLC_EGENERIC;
+    return OpenResampler(obj);
+}
+
+static void Close(vlc_object_t *obj)
+{
+    filter_t *filter = (filter_t *)obj;
+    filter_sys_t *sys = filter->p_sys;
+
+    polyphase_filter_Delete(sys->pf);
+    free(sys);
+}
+
+/**
+ * Resamples frames, or silence if in is NULL, at the current input rate,
+ * which follows the clock drift adjustments.
+ */
+static block_t *Process(filter_t *filter, const float *in, size_t frames)
+{
+    filter_sys_t *sys = filter->p_sys;
+    const unsigned irate = filter->fmt_in.audio.i_rate;
+    const size_t framesize = filter->fmt_out.audio.i_bytes_per_frame;
+    const size_t max = polyphase_filter_GetMaxOutput(sys->pf, irate, frames);
+
+    block_t *out = block_Alloc(max * framesize);
+    if (unlikely(out == NULL))
+        return NULL;
+
+    const size_t olen = polyphase_filter_Process(sys->pf, irate,
+                                                 (float *)out->p_buffer,
+                                                 in, frames);
+    out->i_buffer = olen * framesize;
+    out->i_nb_samples = olen;
+    out->i_dts = out->i_pts = date_Get(&sys->end_date);
+    out->i_length = date_Increment(&sys->end_date, olen) - out->i_pts;
+    return out;
+}
+
+static block_t *Resample(filter_t *filter, block_t *in)
+{
+    filter_sys_t *sys = filter->p_sys;
+
+    if (in->i_flags & BLOCK_FLAG_DISCONTINUITY)
+        polyphase_filter_Reset(sys->pf);
+    /* The first output sample is at the time of the first input sample */
+    if ((in->i_flags & BLOCK_FLAG_DISCONTINUITY)
+     || date_Get(&sys->end_date) == VLC_TICK_INVALID)
+        date_Set(&sys->end_date, in->i_pts);
+
+    block_t *out = Process(filter, (const float *)in->p_buffer,
+                           in->i_nb_samples);
+    if (out != NULL)
+        out->i_flags = in->i_flags;
+    block_Release(in);
+    return out;
+}
+
+static block_t *Drain(filter_t *filter)
+{
+    filter_sys_t *sys = filter->p_sys;
+
+    if (date_Get(&sys->end_date) == VLC_TICK_INVALID)
+        return NULL;
+
+    /* Push silence through the filter, up to the last input sample */
+    block_t *out = Process(filter, NULL,
+                           polyphase_filter_GetLatency(sys->pf));
+    Flush(filter);
+    return out;
+}
+
+static void Flush(filter_t *filter)
+{
+    filter_sys_t *sys = filter->p_sys;
+
+    polyphase_filter_Reset(sys->pf);
+    date_Set(&sys->end_date, VLC_TICK_INVALID);
+}
@@ -0,0 +1,762 @@
+/*****************************************************************************
+ * polyphase_filter.c : vectorized polyphase resampling filter
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef POLYPHASE_TEST
+# undef NDEBUG
+#endif
+
+#include <assert.h>
+#include <math.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+
+#include "polyphase_filter.h"
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+#endif
+#ifdef __ARM_NEON
+# include <arm_neon.h>
+#endif
+
+#define POLYPHASE_ALIGN 32
+#define POLYPHASE_CHUNK 1024 /* input frames deinterleaved at once */
+
+static const struct
+{
+    unsigned taps;   /* filter length at the input rate, a multiple of 8 */
+    unsigned phases; /* tabulated fractional positions */
+    double cutoff;   /* relative to the lowest Nyquist frequency */
+    double beta;     /* Kaiser window parameter */
+} presets[] = {
+    [POLYPHASE_FAST]   = { 16, 128, 0.85, 6.0 },
+    [POLYPHASE_MEDIUM] = { 32, 256, 0.90, 8.0 },
+    [POLYPHASE_HIGH]   = { 64, 1024, 0.94, 10.5 },
+};
+
+typedef void (*polyphase_interp_t)( float *, const float *, const float *,
+                                    float, unsigned );
+typedef float (*polyphase_dot_t)( const float *, const float *, unsigned );
+
+struct polyphase_filter
+{
+    unsigned channels;
+    unsigned out_rate;
+    unsigned design_rate; /* input rate of the filter design */
+    unsigned quality;
+    unsigned taps;
+    unsigned phases;
+    polyphase_interp_t interp;
+    polyphase_dot_t dot;
+    const char *kernel_name;
+
+    float *coeffs; /* [phases + 1][taps] */
+    float *h;      /* [taps], interpolated phase */
+
+    /* Input history, one plane per channel */
+    float *buf;    /* [channels][size] */
+    size_t size;
+    size_t avail;  /* frames in each plane */
+    size_t pos;    /* integer position of the next output */
+    unsigned frac; /* fractional position, in units of 1 / out_rate */
+};
+
+/*****************************************************************************
+ * Kernels: linear interpolation of two phases, and dot product of a phase,
+ * which is aligned, with the input
+ *****************************************************************************/
+static void InterpC( float *h, const float *h0, const float *h1, float w,
+                     unsigned n )
+{
+    for( unsigned i = 0; i < n; i++ )
+        h[i] = h0[i] + w * (h1[i] - h0[i]);
+}
+
+static float DotC( const float *h, const float *x, unsigned n )
+{
+    float s0 = 0.f, s1 = 0.f, s2 = 0.f, s3 = 0.f;
+
+    for( unsigned i = 0; i < n; i += 4 )
+    {
+        s0 += h[i] * x[i];
+        s1 += h[i + 1] * x[i + 1];
+        s2 += h[i + 2] * x[i + 2];
+        s3 += h[i + 3] * x[i + 3];
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+__attribute__ ((__target__ ("sse2")))
+static void InterpSSE2( float *h, const float *h0, const float *h1, float w,
+                        unsigned n )
+{
+    const __m128 vw = _mm_set1_ps( w );
+
+    for( unsigned i = 0; i < n; i += 4 )
+    {
+        const __m128 a = _mm_load_ps( &h0[i] );
+        const __m128 d = _mm_sub_ps( _mm_load_ps( &h1[i] ), a );
+        _mm_store_ps( &h[i], _mm_add_ps( a, _mm_mul_ps( vw, d ) ) );
+    }
+}
+
+__attribute__ ((__target__ ("sse2")))
+static float DotSSE2( const float *h, const float *x, unsigned n )
+{
+    __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+
+    /* Two independent sums, to hide the latency of the additions */
+    for( unsigned i = 0; i < n; i += 8 )
+    {
+        s0 = _mm_add_ps( s0, _mm_mul_ps( _mm_load_ps( &h[i] ),
+                                         _mm_loadu_ps( &x[i] ) ) );
+        s1 = _mm_add_ps( s1, _mm_mul_ps( _mm_load_ps( &h[i + 4] ),
+                                         _mm_loadu_ps( &x[i + 4] ) ) );
+    }
+    s0 = _mm_add_ps( s0, s1 );
+    s0 = _mm_add_ps( s0, _mm_movehl_ps( s0, s0 ) );
+    s0 = _mm_add_ss( s0, _mm_shuffle_ps( s0, s0, 1 ) );
+    return _mm_cvtss_f32( s0 );
+}
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+__attribute__ ((__target__ ("avx")))
+static void InterpAVX( float *h, const float *h0, const float *h1, float w,
+                       unsigned n )
+{
+    const __m256 vw = _mm256_set1_ps( w );
+
+    for( unsigned i = 0; i < n; i += 8 )
+    {
+        const __m256 a = _mm256_load_ps( &h0[i] );
+        const __m256 d = _mm256_sub_ps( _mm256_load_ps( &h1[i] ), a );
+        _mm256_store_ps( &h[i], _mm256_add_ps( a, _mm256_mul_ps( vw, d ) ) );
+    }
+}
+
+__attribute__ ((__target__ ("avx")))
+static float DotAVX( const float *h, const float *x, unsigned n )
+{
+    __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+    unsigned i = 0;
+
+    for( ; i + 16 <= n; i += 16 )
+    {
+        s0 = _mm256_add_ps( s0, _mm256_mul_ps( _mm256_load_ps( &h[i] ),
+                                               _mm256_loadu_ps( &x[i] ) ) );
+        s1 = _mm256_add_ps( s1, _mm256_mul_ps( _mm256_load_ps( &h[i + 8] ),
+                                               _mm256_loadu_ps( &x[i + 8] ) ) );
+    }
+    if( i < n )
+        s0 = _mm256_add_ps( s0, _mm256_mul_ps( _mm256_load_ps( &h[i] ),
+                                               _mm256_loadu_ps( &x[i] ) ) );
+    s0 = _mm256_add_ps( s0, s1 );
+
+    __m128 s = _mm_add_ps( _mm256_castps256_ps128( s0 ),
+                           _mm256_extractf128_ps( s0, 1 ) );
+    s = _mm_add_ps( s, _mm_movehl_ps( s, s ) );
+    s = _mm_add_ss( s, _mm_shuffle_ps( s, s, 1 ) );
+    return _mm_cvtss_f32( s );
+}
+#endif
+
+#ifdef __ARM_NEON
+static void InterpNEON( float *h, const float *h0, const float *h1, float w,
+                        unsigned n )
+{
+    for( unsigned i = 0; i < n; i += 4 )
+    {
+        const float32x4_t a = vld1q_f32( &h0[i] );
+        const float32x4_t d = vsubq_f32( vld1q_f32( &h1[i] ), a );
+        vst1q_f32( &h[i], vmlaq_n_f32( a, d, w ) );
+    }
+}
+
+static float DotNEON( const float *h, const float *x, unsigned n )
+{
+    float32x4_t s0 = vdupq_n_f32( 0.f ), s1 = vdupq_n_f32( 0.f );
+
+    for( unsigned i = 0; i < n; i += 8 )
+    {
+        s0 = vmlaq_f32( s0, vld1q_f32( &h[i] ), vld1q_f32( &x[i] ) );
+        s1 = vmlaq_f32( s1, vld1q_f32( &h[i + 4] ), vld1q_f32( &x[i + 4] ) );
+    }
+    s0 = vaddq_f32( s0, s1 );
+
+    float32x2_t s = vadd_f32( vget_low_f32( s0 ), vget_high_f32( s0 ) );
+    return vget_lane_f32( vpadd_f32( s, s ), 0 );
+}
+#endif
+
+static const struct
+{
+    const char *name;
+    polyphase_interp_t interp;
+    polyphase_dot_t dot;
+} kernels[] = {
+#ifdef HAVE_AVX2_INTRINSICS
+    { "avx", InterpAVX, DotAVX },
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+    { "sse2", InterpSSE2, DotSSE2 },
+#endif
+#ifdef __ARM_NEON
+    { "neon", InterpNEON, DotNEON },
+#endif
+    { "c", InterpC, DotC },
+};
+
+/*****************************************************************************
+ * Filter design
+ *****************************************************************************/
+/* Modified Bessel function of the first kind and order 0 */
+static double BesselI0( double x )
+{
+    double sum = 1., term = 1.;
+
+    x = x * x / 4.;
+    for( unsigned k = 1; term > sum * 1e-12; k++ )
+    {
+        term *= x / ((double)k * k);
+        sum += term;
+    }
+    return sum;
+}
+
+/* Tabulates the phases of the low-pass filter. Phase p is the filter for an
+ * output sample p / phases of an input sample after the input sample of tap
+ * taps / 2 - 1. The last phase is one sample after the first one, so that
+ * each phase has a next one to interpolate with. */
+static void Design( polyphase_filter_t *f, unsigned in_rate )
+{
+    const unsigned taps = f->taps, half = taps / 2;
+    const double ratio = (double)f->out_rate / in_rate;
+    const double fc = presets[f->quality].cutoff * (ratio < 1. ? ratio : 1.);
+    const double beta = presets[f->quality].beta;
+    const double i0_beta = BesselI0( beta );
+
+    for( unsigned p = 0; p <= f->phases; p++ )
+    {
+        float *h = &f->coeffs[(size_t)p * taps];
+        double sum = 0.;
+
+        for( unsigned k = 0; k < taps; k++ )
+        {
+            /* Distance from the output sample to the input sample of tap k */
+            const double d = (double)p / f->phases + (half - 1.) - k;
+            const double r = d / half;
+            double v = fc;
+
+            if( d != 0. )
+                v = sin( M_PI * fc * d ) / (M_PI * d);
+            v *= r * r < 1. ? BesselI0( beta * sqrt( 1. - r * r ) ) / i0_beta
+                            : 0.;
+            h[k] = v;
+            sum += v;
+        }
+        /* Unity gain at DC for every phase */
+        for( unsigned k = 0; k < taps; k++ )
+            h[k] /= sum;
+    }
+    f->design_rate = in_rate;
+}
+
+/*****************************************************************************
+ * Filter
+ *****************************************************************************/
+polyphase_filter_t *polyphase_filter_New( unsigned channels, unsigned in_rate,
+                                          unsigned out_rate, unsigned quality,
+                                          const char *kernel )
+{
+    const bool any = !strcmp( kernel, "any" );
+    size_t k;
+
+    assert( channels > 0 && in_rate > 0 && out_rate > 0 );
+    assert( quality <= POLYPHASE_QUALITY_MAX );
+    if( in_rate / out_rate >= POLYPHASE_RATIO_MAX )
+        return NULL;
+
+    for( k = 0; k < ARRAY_SIZE(kernels); k++ )
+        if( (any || !strcmp( kernel, kernels[k].name ))
+         && vlc_CPU_CheckKernels( kernels[k].name ) )
+            break;
+    if( k == ARRAY_SIZE(kernels) )
+        return NULL;
+
+    polyphase_filter_t *f = calloc( 1, sizeof(*f) );
+    if( unlikely(f == NULL) )
+        return NULL;
+
+    f->channels = channels;
+    f->out_rate = out_rate;
+    f->quality = quality;
+    f->phases = presets[quality].phases;
+    f->interp = kernels[k].interp;
+    f->dot = kernels[k].dot;
+    f->kernel_name = kernels[k].name;
+
+    /* Downsampling lowers the cutoff: lengthen the filter to keep the same
+     * transition band, relative to the cutoff */
+    f->taps = presets[quality].taps;
+    if( in_rate > out_rate )
+        f->taps = ((uint64_t)f->taps * in_rate / out_rate + 7) & ~7u;
+
+    f->size = f->taps + POLYPHASE_CHUNK;
+    f->coeffs = vlc_CPU_AllocFloats( (size_t)(f->phases + 1) * f->taps,
+                                     POLYPHASE_ALIGN );
+    f->h = vlc_CPU_AllocFloats( f->taps, POLYPHASE_ALIGN );
+    f->buf = vlc_alloc( f->size * channels, sizeof(float) );
+    if( f->coeffs == NULL || f->h == NULL || f->buf == NULL )
+    {
+        polyphase_filter_Delete( f );
+        return NULL;
+    }
+
+    Design( f, in_rate );
+    polyphase_filter_Reset( f );
+    return f;
+}
+
+void polyphase_filter_Delete( polyphase_filter_t *f )
+{
+    free( f->buf );
+    aligned_free( f->h );
+    aligned_free( f->coeffs );
+    free( f );
+}
+
+const char *polyphase_filter_Kernel( const polyphase_filter_t *f )
+{
+    return f->kernel_name;
+}
+
+unsigned polyphase_filter_GetLatency( const polyphase_filter_t *f )
+{
+    return f->taps / 2;
+}
+
+size_t polyphase_filter_GetMaxOutput( const polyphase_filter_t *f,
+                                      unsigned in_rate, size_t frames )
+{
+    /* Including the frames already held back */
+    return (frames + f->taps) * (uint64_t)f->out_rate / in_rate + 2;
+}
+
+void polyphase_filter_Reset( polyphase_filter_t *f )
+{
+    /* Silence before the first input sample, which is the first output */
+    f->avail = f->taps / 2 - 1;
+    f->pos = f->avail;
+    f->frac = 0;
+    for( unsigned c = 0; c < f->channels; c++ )
+        memset( &f->buf[c * f->size], 0, f->avail * sizeof(float) );
+}
+
+static const float *GetPhase( polyphase_filter_t *f )
+{
+    const uint64_t t = (uint64_t)f->frac * f->phases;
+    const unsigned p = t / f->out_rate, rem = t % f->out_rate;
+    const float *h0 = &f->coeffs[(size_t)p * f->taps];
+
+    if( rem == 0 )
+        return h0;
+    f->interp( f->h, h0, h0 + f->taps, (float)rem / f->out_rate, f->taps );
+    return f->h;
+}
+
+size_t polyphase_filter_Process( polyphase_filter_t *f, unsigned in_rate,
+                                 float *out, const float *in, size_t frames )
+{
+    const unsigned channels = f->channels, half = f->taps / 2;
+    const unsigned out_rate = f->out_rate;
+    size_t done = 0;
+
+    if( in_rate / out_rate >= POLYPHASE_RATIO_MAX )
+        in_rate = out_rate * POLYPHASE_RATIO_MAX - 1;
+
+    /* Design the filter anew, if the cutoff (when downsampling) is more than
+     * 5% off, as for a playback rate change. The clock drift is smaller. */
+    const uint64_t cur = __MAX( in_rate, out_rate );
+    const uint64_t ref = __MAX( f->design_rate, out_rate );
+    if( cur * 20 > ref * 21 || cur * 21 < ref * 20 )
+        Design( f, in_rate );
+
+    const unsigned step = in_rate / out_rate, step_frac = in_rate % out_rate;
+
+    for( ;; )
+    {
+        /* Compute the outputs with all their input samples in the buffer */
+        while( f->pos + half < f->avail )
+        {
+            const float *h = GetPhase( f );
+            const float *x = &f->buf[f->pos + 1 - half];
+
+            for( unsigned c = 0; c < channels; c++ )
+                out[c] = f->dot( h, &x[c * f->size], f->taps );
+            out += channels;
+            done++;
+
+            f->pos += step;
+            f->frac += step_frac;
+            if( f->frac >= out_rate )
+            {
+                f->frac -= out_rate;
+                f->pos++;
+            }
+        }
+
+        /* Drop the input samples before the first tap of the next output */
+        const size_t drop = __MIN( f->pos + 1 - half, f->avail );
+        if( drop > 0 )
+        {
+            for( unsigned c = 0; c < channels; c++ )
+            {
+                float *plane = &f->buf[c * f->size];
+                memmove( plane, plane + drop,
+                         (f->avail - drop) * sizeof(float) );
+            }
+            f->avail -= drop;
+            f->pos -= drop;
+        }
+
+        if( frames == 0 )
+            break;
+
+        /* Deinterleave more input */
+        const size_t count = __MIN( frames, f->size - f->avail );
+        for( unsigned c = 0; c < channels; c++ )
+        {
+            float *plane = &f->buf[c * f->size + f->avail];
+
+            if( in != NULL )
+                for( size_t i = 0; i < count; i++ )
+                    plane[i] = in[i * channels + c];
+            else
+                memset( plane, 0, count * sizeof(float) );
+        }
+        if( in != NULL )
+            in += count * channels;
+        frames -= count;
+        f->avail += count;
+    }
+    return done;
+}
+
+#ifdef POLYPHASE_TEST
+#include <stdio.h>
+#include <unistd.h>
+
+/* Sine, of amplitude 0.5, sampled at the positions pos (in input samples) */
+static double Sine( double freq, unsigned rate, double pos )
+{
+    return .5 * sin( 2. * M_PI * freq * pos / rate );
+}
+
+/* Interleaved sine, one frequency per channel */
+static float *SineSignal( unsigned channels, unsigned rate, size_t frames,
+                          double freq )
+{
+    float *p = malloc( frames * channels * sizeof(float) );
+
+    assert( p != NULL );
+    for( size_t i = 0; i < frames; i++ )
+        for( unsigned c = 0; c < channels; c++ )
+            p[i * channels + c] = Sine( freq * (1. + .25 * c), rate, i );
+    return p;
+}
+
+/* THD+N in dB, as the residual of a least squares fit of a sine of the given
+ * frequency on the first channel, skipping the start and the end */
+static double ThdN( const float *out, unsigned channels, size_t frames,
+                    double freq, unsigned rate )
+{
+    const size_t skip = frames / 16;
+    double ss = 0., sc = 0., cc = 0., ys = 0., yc = 0., yy = 0.;
+
+    for( size_t i = skip; i < frames - skip; i++ )
+    {
+        const double s = sin( 2. * M_PI * freq * i / rate );
+        const double c = cos( 2. * M_PI * freq * i / rate );
+        const double y = out[i * channels];
+
+        ss += s * s; sc += s * c; cc += c * c;
+        ys += y * s; yc += y * c; yy += y * y;
+    }
+
+    const double det = ss * cc - sc * sc;
+    const double a = (ys * cc - yc * sc) / det;
+    const double b = (yc * ss - ys * sc) / det;
+    const double fit = a * ys + b * yc; /* energy of the fitted sine */
+    const double res = yy - fit;
+
+    return 10. * log10( (res > 0. ? res : 1e-30) / fit );
+}
+
+static size_t Run( polyphase_filter_t *f, unsigned in_rate, float *out,
+                        const float *in, size_t frames, size_t block )
+{
+    size_t done = 0;
+
+    for( size_t i = 0; i < frames; i += block )
+    {
+        const size_t count = __MIN( block, frames - i );
+        done += polyphase_filter_Process( f, in_rate, &out[done * 2],
+                                          &in[i * 2], count );
+    }
+    return done;
+}
+
+static const struct
+{
+    unsigned in_rate, out_rate;
+} tests[] = {
+    { 44100, 48000 }, { 48000, 44100 }, { 96000, 48000 }, { 22050, 48000 },
+};
+
+static const char *const quality_names[] = { "fast", "medium", "high" };
+
+#ifndef POLYPHASE_BENCH
+/* Maximum THD+N of each quality preset, at 997 Hz */
+static const double thdn_max[] = { -65., -85., -115. };
+
+/* Resamples a sine, checks its THD+N and that the kernel matches the C one */
+static void Test( const char *kernel, unsigned quality, unsigned in_rate,
+                  unsigned out_rate )
+{
+    const double freq = 997.;
+    const size_t frames = in_rate / 2;
+    float *in = SineSignal( 2, in_rate, frames, freq );
+    polyphase_filter_t *ref = polyphase_filter_New( 2, in_rate, out_rate,
+                                                    quality, "c" );
+    polyphase_filter_t *f = polyphase_filter_New( 2, in_rate, out_rate,
+                                                  quality, kernel );
+
+    assert( ref != NULL && f != NULL );
+    const size_t max = polyphase_filter_GetMaxOutput( f, in_rate, frames );
+    float *out = malloc( max * 2 * sizeof(float) );
+    float *out_ref = malloc( max * 2 * sizeof(float) );
+    assert( out != NULL && out_ref != NULL );
+
+    /* Blocks of various sizes, to check the continuity */
+    const size_t n = Run( f, in_rate, out, in, frames, 1013 );
+    const size_t n_ref = Run( ref, in_rate, out_ref, in, frames, 480 );
+    const size_t expected = frames * (uint64_t)out_rate / in_rate;
+
+    assert( n == n_ref );
+    assert( n <= max );
+    assert( n + polyphase_filter_GetLatency( f ) * out_rate / in_rate + 2
+            >= expected );
+
+    float diff = 0.f;
+    for( size_t i = 0; i < n * 2; i++ )
+        diff = __MAX( diff, fabsf( out[i] - out_ref[i] ) );
+
+    const double thdn = ThdN( out, 2, n, freq, out_rate );
+    printf( "%-4s %-6s %5u -> %5u Hz: THD+N %7.1f dB, %g from C\n", kernel,
+            quality_names[quality], in_rate, out_rate, thdn, diff );
+    assert( diff < 1e-5f );
+    assert( thdn < thdn_max[quality] );
+
+    free( out_ref );
+    free( out );
+    polyphase_filter_Delete( f );
+    polyphase_filter_Delete( ref );
+    free( in );
+}
+
+/* Changes the input rate by up to 0.5% every block, as for the clock drift,
+ * and checks that the output follows the exact positions in the input, with
+ * no glitch at the changes. */
+static void TestDrift( const char *kernel, unsigned quality )
+{
+    const unsigned rate = 48000, block = 1024;
+    const double freq = 997.;
+    const size_t frames = 4 * rate;
+    float *in = SineSignal( 2, rate, frames, freq );
+    polyphase_filter_t *f = polyphase_filter_New( 2, rate, rate, quality,
+                                                  kernel );
+    assert( f != NULL );
+
+    const size_t max = polyphase_filter_GetMaxOutput( f, rate / 2, block );
+    float *out = malloc( max * 2 * sizeof(float) );
+    assert( out != NULL );
+
+    double pos = 0., err_max = 0.;
+    int adjust = 0, dir = 1;
+    size_t total = 0;
+
+    for( size_t i = 0; i + block <= frames; i += block )
+    {
+        /* Like aout_FiltersAdjustResampling() */
+        adjust += dir * 12;
+        if( adjust >= 240 || adjust <= -240 )
+            dir = -dir;
+
+        const unsigned in_rate = rate + adjust;
+        const size_t n = polyphase_filter_Process( f, in_rate, out, &in[i * 2],
+                                                   block );
+        assert( n <= max );
+
+        for( size_t j = 0; j < n; j++ )
+        {
+            if( total + j >= 4 * block )
+                err_max = __MAX( err_max,
+                                 fabs( out[j * 2] - Sine( freq, rate, pos ) ) );
+            pos += (double)in_rate / rate;
+        }
+        total += n;
+    }
+
+    const double err_db = 20. * log10( err_max / .5 );
+    printf( "%-4s %-6s drift +-0.5%%: %zu frames, peak error %7.1f dB\n",
+            kernel, quality_names[quality], total, err_db );
+    assert( err_db < thdn_max[quality] + 10. );
+
+    free( out );
+    polyphase_filter_Delete( f );
+    free( in );
+}
+#else
+# include "bandlimited.c"
+
+/* Runs the previous bandlimited resampler, as its module */
+static block_t *Bandlimited( unsigned in_rate, unsigned out_rate,
+                             const float *in, size_t frames, size_t block,
+                             vlc_tick_t *time )
+{
+    filter_t *filter = (vlc_object_create)( NULL, sizeof(*filter) );
+    assert( filter != NULL );
+
+    es_format_Init( &filter->fmt_in, AUDIO_ES, VLC_CODEC_FL32 );
+    filter->fmt_in.audio.i_format = VLC_CODEC_FL32;
+    filter->fmt_in.audio.i_rate = in_rate;
+    filter->fmt_in.audio.i_physical_channels = AOUT_CHANS_STEREO;
+    aout_FormatPrepare( &filter->fmt_in.audio );
+    filter->fmt_out = filter->fmt_in;
+    filter->fmt_out.audio.i_rate = out_rate;
+    assert( OpenFilter( VLC_OBJECT(filter) ) == VLC_SUCCESS );
+
+    block_t *chain = NULL;
+    vlc_tick_t start = vlc_tick_now();
+    for( size_t i = 0; i < frames; i += block )
+    {
+        const size_t count = __MIN( block, frames - i );
+        block_t *b = block_Alloc( count * 2 * sizeof(float) );
+
+        assert( b != NULL );
+        memcpy( b->p_buffer, &in[i * 2], count * 2 * sizeof(float) );
+        b->i_nb_samples = count;
+        b->i_pts = VLC_TICK_0 + vlc_tick_from_samples( i, in_rate );
+        block_ChainAppend( &chain, Resample( filter, b ) );
+    }
+    *time = vlc_tick_now() - start;
+
+    CloseFilter( VLC_OBJECT(filter) );
+    vlc_object_delete( filter );
+    return block_ChainGather( chain );
+}
+
+static void Bench( unsigned in_rate, unsigned out_rate )
+{
+    const double freq = 997.;
+    const size_t frames = 10 * in_rate, block = 1024;
+    float *in = SineSignal( 2, in_rate, frames, freq );
+    vlc_tick_t time;
+
+    block_t *b = Bandlimited( in_rate, out_rate, in, frames, block, &time );
+    assert( b != NULL );
+    printf( "%-11s %5u -> %5u Hz: %6.3f%% of a CPU, THD+N %7.1f dB\n",
+            "bandlimited", in_rate, out_rate,
+            100. * US_FROM_VLC_TICK( time ) / 10e6,
+            ThdN( (const float *)b->p_buffer, 2, b->i_buffer / 8,
+                  freq, out_rate ) );
+    block_Release( b );
+
+    for( size_t k = 0; k < ARRAY_SIZE(kernels); k++ )
+    {
+        if( !vlc_CPU_CheckKernels( kernels[k].name ) )
+            continue;
+
+        for( unsigned q = 0; q <= POLYPHASE_QUALITY_MAX; q++ )
+        {
+            polyphase_filter_t *f = polyphase_filter_New( 2, in_rate,
+                                                          out_rate, q,
+                                                          kernels[k].name );
+            assert( f != NULL );
+            float *out = malloc( polyphase_filter_GetMaxOutput( f, in_rate,
+                                                                frames )
+                                 * 2 * sizeof(float) );
+            assert( out != NULL );
+
+            time = vlc_tick_now();
+            size_t n = Run( f, in_rate, out, in, frames, block );
+            time = vlc_tick_now() - time;
+
+            printf( "%-4s %-6s %5u -> %5u Hz: %6.3f%% of a CPU, "
+                    "THD+N %7.1f dB\n", kernels[k].name, quality_names[q],
+                    in_rate, out_rate, 100. * US_FROM_VLC_TICK( time ) / 10e6,
+                    ThdN( out, 2, n, freq, out_rate ) );
+            free( out );
+            polyphase_filter_Delete( f );
+        }
+    }
+    free( in );
+}
+#endif
+
+int main( void )
+{
+#ifndef POLYPHASE_BENCH
+    alarm( 60 );
+
+    for( size_t k = 0; k < ARRAY_SIZE(kernels); k++ )
+    {
+        if( !vlc_CPU_CheckKernels( kernels[k].name ) )
+        {
+            fprintf( stderr, "WARNING: could not test %s\n",
+                     kernels[k].name );
+            continue;
+        }
+
+        for( unsigned q = 0; q <= POLYPHASE_QUALITY_MAX; q++ )
+        {
+            for( size_t i = 0; i < ARRAY_SIZE(tests); i++ )
+                Test( kernels[k].name, q, tests[i].in_rate,
+                      tests[i].out_rate );
+            TestDrift( kernels[k].name, q );
+        }
+    }
+#else
+    for( size_t i = 0; i < ARRAY_SIZE(tests); i++ )
+        Bench( tests[i].in_rate, tests[i].out_rate );
+#endif
+    return 0;
+}
+#endif
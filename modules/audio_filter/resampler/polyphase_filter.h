@@ -0,0 +1,86 @@
+/*****************************************************************************
+ * polyphase_filter.h : vectorized polyphase resampling filter
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_AUDIO_FILTER_POLYPHASE_FILTER_H
+#define VLC_AUDIO_FILTER_POLYPHASE_FILTER_H
+
+/** Quality presets, from fastest to best */
+enum
+{
+    POLYPHASE_FAST,
+    POLYPHASE_MEDIUM,
+    POLYPHASE_HIGH,
+};
+#define POLYPHASE_QUALITY_MAX POLYPHASE_HIGH
+
+/** Highest supported ratio of the input rate to the output rate */
+#define POLYPHASE_RATIO_MAX 64
+
+/**
+ * Kaiser windowed sinc resampler of interleaved float samples.
+ *
+ * The filter is tabulated for a number of fractional positions (phases). Each
+ * output sample is the dot product of the input with the filter, interpolated
+ * linearly from the two nearest phases. The channels are deinterleaved, so
+ * that the dot products run over contiguous samples, with SIMD vectors.
+ *
+ * The input rate can change between calls without discontinuity: the position
+ * in the input is kept exactly, as a fraction of the output rate. Small
+ * changes, as for the clock drift, only change the step between the output
+ * samples. The filter cutoff is designed anew if the input rate gets far from
+ * the one it was designed for.
+ */
+typedef struct polyphase_filter polyphase_filter_t;
+
+/**
+ * \param quality one of the quality presets
+ * \param kernel "any" for the fastest kernel available, or the name of a
+ * specific one ("c", "sse2", "avx", "neon")
+ * \return the filter, or NULL on error or if the kernel is not available
+ */
+polyphase_filter_t *polyphase_filter_New( unsigned channels, unsigned in_rate,
+                                          unsigned out_rate, unsigned quality,
+                                          const char *kernel );
+void polyphase_filter_Delete( polyphase_filter_t * );
+
+/** Returns the name of the kernel used by the filter */
+const char *polyphase_filter_Kernel( const polyphase_filter_t * );
+
+/** Returns the number of input frames held back by the filter */
+unsigned polyphase_filter_GetLatency( const polyphase_filter_t * );
+
+/** Returns the most output frames that frames input frames can yield */
+size_t polyphase_filter_GetMaxOutput( const polyphase_filter_t *,
+                                      unsigned in_rate, size_t frames );
+
+/**
+ * Resamples frames of interleaved samples.
+ *
+ * \param in_rate current input rate
+ * \param in input samples, or NULL for silence
+ * \return the number of output frames
+ */
+size_t polyphase_filter_Process( polyphase_filter_t *, unsigned in_rate,
+                                 float *out, const float *in, size_t frames );
+
+/** Clears the filter history */
+void polyphase_filter_Reset( polyphase_filter_t * );
+
+#endif
@@ -35,7 +35,8 @@
 #include <vlc_modules.h>
 
 #include <string.h> /* for memset */
-#include <limits.h> /* form INT_MIN */
+
+#include "scaletempo_search.h"
 
 /*****************************************************************************
  * Module descriptor
@@ -55,6 +56,10 @@ static block_t *DoPitchWork( filter_t *, block_t * );
 # define MODULES_SHORTNAME N_("Scaletempo")
 #endif
 
+static const char *const search_mode_list[] = { "simd", "fft", "c" };
+static const char *const search_mode_list_text[] = {
+    N_("Direct, vectorized"), N_("FFT"), N_("Direct, scalar") };
+
 vlc_module_begin ()
     set_description( MODULE_DESC )
     set_shortname( MODULES_SHORTNAME )
@@ -68,6 +73,9 @@ vlc_module_begin ()
         N_("Overlap Length"), N_("Percentage of stride to overlap"), true )
     add_integer_with_range( "scaletempo-search", 14, 0, 200,
         N_("Search Length"), N_("Length in milliseconds to search for best overlap position"), true )
+    add_string( "scaletempo-search-mode", "simd",
+        N_("Search Mode"), N_("Correlate each position to search, or all at once using FFTs, which is faster for long searches without SIMD"), true )
+        change_string_list( search_mode_list, search_mode_list_text )
 #ifdef PITCH_SHIFTER
     add_float_with_range( "pitch-shift", 0, -12, 12,
         N_("Pitch Shift"), N_("Pitch shift in semitones."), false )
@@ -126,8 +134,7 @@ typedef struct
     void    (*output_overlap)( filter_t *p_filter, void *p_out_buf, unsigned bytes_off );
     /* best overlap */
     unsigned  frames_search;
-    void     *buf_pre_corr;
-    void     *table_window;
+    scaletempo_search_t *search;
     unsigned(*best_overlap_offset)( filter_t *p_filter );
 #ifdef PITCH_SHIFTER
     /* pitch */
@@ -142,35 +149,10 @@ typedef struct
 static unsigned best_overlap_offset_float( filter_t *p_filter )
 {
     filter_sys_t *p = p_filter->p_sys;
-    float *pw, *po, *ppc, *search_start;
-    float best_corr = INT_MIN;
-    unsigned best_off = 0;
-    unsigned i, off;
-
-    pw  = p->table_window;
-    po  = p->buf_overlap;
-    po += p->samples_per_frame;
-    ppc = p->buf_pre_corr;
-    for( i = p->samples_per_frame; i < p->samples_overlap; i++ ) {
-      *ppc++ = *pw++ * *po++;
-    }
-
-    search_start = (float *)p->buf_queue + p->samples_per_frame;
-    for( off = 0; off < p->frames_search; off++ ) {
-      float corr = 0;
-      float *ps = search_start;
-      ppc = p->buf_pre_corr;
-      for( i = p->samples_per_frame; i < p->samples_overlap; i++ ) {
-        corr += *ppc++ * *ps++;
-      }
-      if( corr > best_corr ) {
-        best_corr = corr;
-        best_off  = off;
-      }
-      search_start += p->samples_per_frame;
-    }
 
-    return best_off * p->bytes_per_frame;
+    return scaletempo_search_Find( p->search, p->buf_overlap,
+                                   (float *)p->buf_queue )
+           * p->bytes_per_frame;
 }
 
 /*****************************************************************************
@@ -339,18 +321,13 @@ static int reinit_buffers( filter_t *p_filter )
     }
     else
     {
-        unsigned bytes_pre_corr = ( p->samples_overlap - p->samples_per_frame ) * 4; /* sizeof (int32|float) */
-        p->buf_pre_corr = malloc( bytes_pre_corr );
-        p->table_window = malloc( bytes_pre_corr );
-        if( ! p->buf_pre_corr || ! p->table_window )
+        char *mode = var_InheritString( p_filter, "scaletempo-search-mode" );
+        p->search = scaletempo_search_New( p->samples_per_frame,
+                                           frames_overlap, p->frames_search,
+                                           mode ? mode : "simd" );
+        free( mode );
+        if( ! p->search )
             return VLC_ENOMEM;
-        float *pw = p->table_window;
-        for( i = 1; i<frames_overlap; i++ )
-        {
-            float v = i * ( frames_overlap - i );
-            for( j = 0; j < p->samples_per_frame; j++ )
-                *pw++ = v;
-        }
         p->best_overlap_offset = best_overlap_offset_float;
     }
 
@@ -381,13 +358,14 @@ static int reinit_buffers( filter_t *p_filter )
     p->frames_stride_scaled = p->bytes_stride_scaled / p->bytes_per_frame;
 
     msg_Dbg( VLC_OBJECT(p_filter),
-             "%.3f scale, %.3f stride_in, %i stride_out, %i standing, %i overlap, %i search, %i queue, %s mode",
+             "%.3f scale, %.3f stride_in, %i stride_out, %i standing, %i overlap, %i search (%s), %i queue, %s mode",
              p->scale,
              p->frames_stride_scaled,
              (int)( p->bytes_stride / p->bytes_per_frame ),
              (int)( p->bytes_standing / p->bytes_per_frame ),
              (int)( p->bytes_overlap / p->bytes_per_frame ),
              p->frames_search,
+             p->search ? scaletempo_search_Kernel( p->search ) : "none",
              (int)( p->bytes_queue_max / p->bytes_per_frame ),
              "fl32");
 
@@ -428,8 +406,7 @@ static int Open( vlc_object_t *p_this )
     p_sys->buf_queue      = NULL;
     p_sys->buf_overlap    = NULL;
     p_sys->table_blend    = NULL;
-    p_sys->buf_pre_corr   = NULL;
-    p_sys->table_window   = NULL;
+    p_sys->search         = NULL;
     p_sys->bytes_overlap  = 0;
     p_sys->bytes_queued   = 0;
     p_sys->bytes_to_slide = 0;
@@ -525,8 +502,8 @@ static void Close( vlc_object_t *p_this )
     free( p_sys->buf_queue );
     free( p_sys->buf_overlap );
     free( p_sys->table_blend );
-    free( p_sys->buf_pre_corr );
-    free( p_sys->table_window );
+    if( p_sys->search )
+        scaletempo_search_Delete( p_sys->search );
     free( p_sys );
 }
 
@@ -0,0 +1,630 @@
+/*****************************************************************************
+ * scaletempo_search.c : best overlap position search for scaletempo
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef SCALETEMPO_TEST
+# undef NDEBUG
+#endif
+
+#include <assert.h>
+#include <limits.h>
+#include <math.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+
+#include "scaletempo_search.h"
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+#endif
+#ifdef __ARM_NEON
+# include <arm_neon.h>
+#endif
+
+#define SEARCH_ALIGN 32
+
+/* Number of positions found by the FFTs which are checked directly: the
+ * FFTs round differently, and could swap positions which correlate almost
+ * as well. */
+#define SEARCH_FFT_CANDIDATES 4
+
+typedef float (*search_dot_t)( const float *, const float *, unsigned );
+
+struct scaletempo_search
+{
+    unsigned channels;
+    unsigned frames_overlap;
+    unsigned frames_search;
+    unsigned samples; /* correlated samples, without the first frame */
+    search_dot_t dot;
+    const char *kernel_name;
+
+    float *window;   /* [samples] */
+    float *pre_corr; /* [samples], the windowed overlap */
+
+    /* FFT mode */
+    unsigned fft_size;
+    unsigned *fft_bitrev; /* [fft_size] */
+    float *fft_cos;       /* [fft_size / 2] */
+    float *fft_sin;       /* [fft_size / 2] */
+    float *fft_re;        /* [fft_size] */
+    float *fft_im;        /* [fft_size] */
+    float *acc_re;        /* [fft_size] */
+    float *acc_im;        /* [fft_size] */
+};
+
+/*****************************************************************************
+ * Dot products of the windowed overlap, which is aligned, and the input
+ *****************************************************************************/
+static float DotC( const float *a, const float *b, unsigned n )
+{
+    float corr = 0;
+    for( unsigned i = 0; i < n; i++ )
+        corr += a[i] * b[i];
+    return corr;
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+__attribute__ ((__target__ ("sse2")))
+static float DotSSE2( const float *a, const float *b, unsigned n )
+{
+    __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+    __m128 s2 = _mm_setzero_ps(), s3 = _mm_setzero_ps();
+    unsigned i = 0;
+
+    /* Independent sums, to hide the latency of the additions */
+    for( ; i + 16 <= n; i += 16 )
+    {
+        s0 = _mm_add_ps( s0, _mm_mul_ps( _mm_load_ps( &a[i] ),
+                                         _mm_loadu_ps( &b[i] ) ) );
+        s1 = _mm_add_ps( s1, _mm_mul_ps( _mm_load_ps( &a[i + 4] ),
+                                         _mm_loadu_ps( &b[i + 4] ) ) );
+        s2 = _mm_add_ps( s2, _mm_mul_ps( _mm_load_ps( &a[i + 8] ),
+                                         _mm_loadu_ps( &b[i + 8] ) ) );
+        s3 = _mm_add_ps( s3, _mm_mul_ps( _mm_load_ps( &a[i + 12] ),
+                                         _mm_loadu_ps( &b[i + 12] ) ) );
+    }
+    for( ; i + 4 <= n; i += 4 )
+        s0 = _mm_add_ps( s0, _mm_mul_ps( _mm_load_ps( &a[i] ),
+                                         _mm_loadu_ps( &b[i] ) ) );
+    s0 = _mm_add_ps( _mm_add_ps( s0, s1 ), _mm_add_ps( s2, s3 ) );
+
+    float sums[4];
+    _mm_storeu_ps( sums, s0 );
+    float corr = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+    for( ; i < n; i++ )
+        corr += a[i] * b[i];
+    return corr;
+}
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+__attribute__ ((__target__ ("avx")))
+static float DotAVX( const float *a, const float *b, unsigned n )
+{
+    __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+    __m256 s2 = _mm256_setzero_ps(), s3 = _mm256_setzero_ps();
+    unsigned i = 0;
+
+    for( ; i + 32 <= n; i += 32 )
+    {
+        s0 = _mm256_add_ps( s0, _mm256_mul_ps( _mm256_load_ps( &a[i] ),
+                                               _mm256_loadu_ps( &b[i] ) ) );
+        s1 = _mm256_add_ps( s1, _mm256_mul_ps( _mm256_load_ps( &a[i + 8] ),
+                                               _mm256_loadu_ps( &b[i + 8] ) ) );
+        s2 = _mm256_add_ps( s2, _mm256_mul_ps( _mm256_load_ps( &a[i + 16] ),
+                                               _mm256_loadu_ps( &b[i + 16] ) ) );
+        s3 = _mm256_add_ps( s3, _mm256_mul_ps( _mm256_load_ps( &a[i + 24] ),
+                                               _mm256_loadu_ps( &b[i + 24] ) ) );
+    }
+    for( ; i + 8 <= n; i += 8 )
+        s0 = _mm256_add_ps( s0, _mm256_mul_ps( _mm256_load_ps( &a[i] ),
+                                               _mm256_loadu_ps( &b[i] ) ) );
+    s0 = _mm256_add_ps( _mm256_add_ps( s0, s1 ), _mm256_add_ps( s2, s3 ) );
+
+    float sums[8];
+    _mm256_storeu_ps( sums, s0 );
+    float corr = ((sums[0] + sums[1]) + (sums[2] + sums[3]))
+               + ((sums[4] + sums[5]) + (sums[6] + sums[7]));
+    for( ; i < n; i++ )
+        corr += a[i] * b[i];
+    return corr;
+}
+#endif
+
+#ifdef __ARM_NEON
+static float DotNEON( const float *a, const float *b, unsigned n )
+{
+    float32x4_t s0 = vdupq_n_f32( 0.f ), s1 = vdupq_n_f32( 0.f );
+    float32x4_t s2 = vdupq_n_f32( 0.f ), s3 = vdupq_n_f32( 0.f );
+    unsigned i = 0;
+
+    for( ; i + 16 <= n; i += 16 )
+    {
+        s0 = vaddq_f32( s0, vmulq_f32( vld1q_f32( &a[i] ),
+                                       vld1q_f32( &b[i] ) ) );
+        s1 = vaddq_f32( s1, vmulq_f32( vld1q_f32( &a[i + 4] ),
+                                       vld1q_f32( &b[i + 4] ) ) );
+        s2 = vaddq_f32( s2, vmulq_f32( vld1q_f32( &a[i + 8] ),
+                                       vld1q_f32( &b[i + 8] ) ) );
+        s3 = vaddq_f32( s3, vmulq_f32( vld1q_f32( &a[i + 12] ),
+                                       vld1q_f32( &b[i + 12] ) ) );
+    }
+    for( ; i + 4 <= n; i += 4 )
+        s0 = vaddq_f32( s0, vmulq_f32( vld1q_f32( &a[i] ),
+                                       vld1q_f32( &b[i] ) ) );
+    s0 = vaddq_f32( vaddq_f32( s0, s1 ), vaddq_f32( s2, s3 ) );
+
+    float sums[4];
+    vst1q_f32( sums, s0 );
+    float corr = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+    for( ; i < n; i++ )
+        corr += a[i] * b[i];
+    return corr;
+}
+#endif
+
+static const struct
+{
+    const char *name;
+    search_dot_t dot;
+} kernels[] = {
+#ifdef HAVE_AVX2_INTRINSICS
+    { "avx", DotAVX },
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+    { "sse2", DotSSE2 },
+#endif
+#ifdef __ARM_NEON
+    { "neon", DotNEON },
+#endif
+    { "c", DotC },
+};
+
+/*****************************************************************************
+ * Radix-2 complex FFT, in place
+ *****************************************************************************/
+static int FFTInit( scaletempo_search_t *s, unsigned min_size )
+{
+    unsigned bits = 1;
+    while( (1u << bits) < min_size )
+        bits++;
+
+    const unsigned n = 1u << bits;
+    s->fft_size = n;
+    s->fft_bitrev = vlc_alloc( n, sizeof(*s->fft_bitrev) );
+    s->fft_cos = vlc_CPU_AllocFloats( n / 2, SEARCH_ALIGN );
+    s->fft_sin = vlc_CPU_AllocFloats( n / 2, SEARCH_ALIGN );
+    s->fft_re = vlc_CPU_AllocFloats( n, SEARCH_ALIGN );
+    s->fft_im = vlc_CPU_AllocFloats( n, SEARCH_ALIGN );
+    s->acc_re = vlc_CPU_AllocFloats( n, SEARCH_ALIGN );
+    s->acc_im = vlc_CPU_AllocFloats( n, SEARCH_ALIGN );
+    if( !s->fft_bitrev || !s->fft_cos || !s->fft_sin || !s->fft_re
+     || !s->fft_im || !s->acc_re || !s->acc_im )
+        return VLC_ENOMEM;
+
+    for( unsigned i = 0; i < n; i++ )
+    {
+        unsigned r = 0;
+        for( unsigned b = 0; b < bits; b++ )
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+        s->fft_bitrev[i] = r;
+    }
+    for( unsigned i = 0; i < n / 2; i++ )
+    {
+        s->fft_cos[i] = cos( 2. * M_PI * i / n );
+        s->fft_sin[i] = -sin( 2. * M_PI * i / n );
+    }
+    return VLC_SUCCESS;
+}
+
+static void FFT( const scaletempo_search_t *s, float *re, float *im )
+{
+    const unsigned n = s->fft_size;
+
+    for( unsigned i = 0; i < n; i++ )
+    {
+        const unsigned j = s->fft_bitrev[i];
+        if( i < j )
+        {
+            float t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+
+    for( unsigned half = 1, step = n / 2; half < n; half *= 2, step /= 2 )
+        for( unsigned i = 0; i < n; i += 2 * half )
+            for( unsigned j = 0; j < half; j++ )
+            {
+                const float wr = s->fft_cos[j * step];
+                const float wi = s->fft_sin[j * step];
+                const unsigned k = i + j, l = k + half;
+                const float tr = re[l] * wr - im[l] * wi;
+                const float ti = re[l] * wi + im[l] * wr;
+
+                re[l] = re[k] - tr;
+                im[l] = im[k] - ti;
+                re[k] += tr;
+                im[k] += ti;
+            }
+}
+
+/*****************************************************************************
+ * Search
+ *****************************************************************************/
+scaletempo_search_t *scaletempo_search_New( unsigned channels,
+                                            unsigned frames_overlap,
+                                            unsigned frames_search,
+                                            const char *mode )
+{
+    const bool fft = !strcmp( mode, "fft" );
+    const bool any = fft || !strcmp( mode, "simd" );
+    size_t k;
+
+    assert( channels > 0 && frames_overlap > 1 && frames_search > 0 );
+    for( k = 0; k < ARRAY_SIZE(kernels); k++ )
+        if( (any || !strcmp( mode, kernels[k].name ))
+         && vlc_CPU_CheckKernels( kernels[k].name ) )
+            break;
+    if( k == ARRAY_SIZE(kernels) )
+        return NULL;
+
+    scaletempo_search_t *s = calloc( 1, sizeof(*s) );
+    if( unlikely(s == NULL) )
+        return NULL;
+
+    s->channels = channels;
+    s->frames_overlap = frames_overlap;
+    s->frames_search = frames_search;
+    s->samples = (frames_overlap - 1) * channels;
+    s->dot = kernels[k].dot;
+    s->kernel_name = fft ? "fft" : kernels[k].name;
+
+    s->window = vlc_CPU_AllocFloats( s->samples, SEARCH_ALIGN );
+    s->pre_corr = vlc_CPU_AllocFloats( s->samples, SEARCH_ALIGN );
+    if( !s->window || !s->pre_corr )
+        goto error;
+
+    float *pw = s->window;
+    for( unsigned i = 1; i < frames_overlap; i++ )
+    {
+        float v = i * ( frames_overlap - i );
+        for( unsigned j = 0; j < channels; j++ )
+            *pw++ = v;
+    }
+
+    /* No wrapping of the correlation: the input is the overlap minus one
+     * frame, plus the search positions */
+    if( fft && FFTInit( s, frames_overlap - 1 + frames_search ) )
+        goto error;
+
+    return s;
+
+error:
+    scaletempo_search_Delete( s );
+    return NULL;
+}
+
+void scaletempo_search_Delete( scaletempo_search_t *s )
+{
+    aligned_free( s->acc_im );
+    aligned_free( s->acc_re );
+    aligned_free( s->fft_im );
+    aligned_free( s->fft_re );
+    aligned_free( s->fft_sin );
+    aligned_free( s->fft_cos );
+    free( s->fft_bitrev );
+    aligned_free( s->pre_corr );
+    aligned_free( s->window );
+    free( s );
+}
+
+const char *scaletempo_search_Kernel( const scaletempo_search_t *s )
+{
+    return s->kernel_name;
+}
+
+static unsigned FindDirect( scaletempo_search_t *s, const float *search_start )
+{
+    float best_corr = INT_MIN;
+    unsigned best_off = 0;
+
+    for( unsigned off = 0; off < s->frames_search; off++ )
+    {
+        float corr = s->dot( s->pre_corr, search_start, s->samples );
+        if( corr > best_corr )
+        {
+            best_corr = corr;
+            best_off  = off;
+        }
+        search_start += s->channels;
+    }
+    return best_off;
+}
+
+/* Correlates all the positions at once, as the sum over the channels of the
+ * products of the spectra of the overlap and of the input. */
+static unsigned FindFFT( scaletempo_search_t *s, const float *search_start )
+{
+    const unsigned n = s->fft_size;
+    const unsigned channels = s->channels;
+    const unsigned frames_pre = s->frames_overlap - 1;
+    const unsigned frames_in = frames_pre - 1 + s->frames_search;
+    float *re = s->fft_re, *im = s->fft_im;
+
+    memset( s->acc_re, 0, n * sizeof(float) );
+    memset( s->acc_im, 0, n * sizeof(float) );
+
+    for( unsigned c = 0; c < channels; c++ )
+    {
+        /* The overlap in the real part, the input in the imaginary part */
+        for( unsigned i = 0; i < n; i++ )
+        {
+            re[i] = i < frames_pre ? s->pre_corr[i * channels + c] : 0.f;
+            im[i] = i < frames_in ? search_start[i * channels + c] : 0.f;
+        }
+        FFT( s, re, im );
+
+        for( unsigned i = 0; i < n; i++ )
+        {
+            const unsigned m = (n - i) & (n - 1);
+            /* Spectra of the overlap (p) and of the input (q), times 2 */
+            const float pr = re[i] + re[m], pi = im[i] - im[m];
+            const float qr = im[i] + im[m], qi = re[m] - re[i];
+
+            s->acc_re[i] += pr * qr + pi * qi;
+            s->acc_im[i] += pr * qi - pi * qr;
+        }
+    }
+
+    /* Inverse FFT, as the conjugate of the FFT of the conjugate */
+    for( unsigned i = 0; i < n; i++ )
+    {
+        re[i] = s->acc_re[i];
+        im[i] = -s->acc_im[i];
+    }
+    FFT( s, re, im );
+
+    unsigned cand[SEARCH_FFT_CANDIDATES];
+    unsigned count = 0;
+    for( unsigned off = 0; off < s->frames_search; off++ )
+    {
+        unsigned i = count;
+        if( count < SEARCH_FFT_CANDIDATES )
+            count++;
+        else if( re[off] <= re[cand[count - 1]] )
+            continue;
+        else
+            i--;
+        for( ; i > 0 && re[off] > re[cand[i - 1]]; i-- )
+            cand[i] = cand[i - 1];
+        cand[i] = off;
+    }
+
+    /* Check the best candidates directly */
+    float best_corr = INT_MIN;
+    unsigned best_off = 0;
+    for( unsigned i = 0; i < count; i++ )
+    {
+        const unsigned off = cand[i];
+        float corr = s->dot( s->pre_corr, &search_start[off * channels],
+                             s->samples );
+        if( corr > best_corr || (corr == best_corr && off < best_off) )
+        {
+            best_corr = corr;
+            best_off  = off;
+        }
+    }
+    return best_off;
+}
+
+unsigned scaletempo_search_Find( scaletempo_search_t *s, const float *overlap,
+                                 const float *queue )
+{
+    /* The first frame is skipped, as its window is zero */
+    overlap += s->channels;
+    for( unsigned i = 0; i < s->samples; i++ )
+        s->pre_corr[i] = s->window[i] * overlap[i];
+
+    const float *search_start = queue + s->channels;
+    return s->fft_size ? FindFFT( s, search_start )
+                       : FindDirect( s, search_start );
+}
+
+#ifdef SCALETEMPO_TEST
+#include <stdio.h>
+#include <unistd.h>
+
+/* Some tones and noise, different on each channel */
+static float *Signal( unsigned channels, unsigned frames, unsigned rate )
+{
+    float *p = malloc( frames * channels * sizeof(float) );
+    unsigned seed = channels;
+
+    assert( p != NULL );
+    for( unsigned i = 0; i < frames; i++ )
+        for( unsigned c = 0; c < channels; c++ )
+        {
+            const double t = (double)i / rate;
+            seed = seed * 1103515245 + 12345;
+            p[i * channels + c] = 0.4f * sin( 2. * M_PI * (220. + 50. * c) * t )
+                                + 0.2f * sin( 2. * M_PI * 1375. * t + c )
+                                + 0.2f * ((float)((seed >> 8) & 0xffff)
+                                          / 32768.f - 1.f);
+        }
+    return p;
+}
+
+static unsigned Params( unsigned rate, unsigned ms_search,
+                        unsigned *frames_overlap )
+{
+    /* Default stride and overlap of the filter */
+    const unsigned frames_stride = 30 * rate / 1000;
+
+    *frames_overlap = frames_stride * 0.2;
+    return ms_search * rate / 1000;
+}
+
+#ifndef SCALETEMPO_BENCH
+/* Sum of the products, and norm of the input, in double precision */
+static double Corr( const scaletempo_search_t *s, const float *queue,
+                    unsigned off, double *norm )
+{
+    const float *in = &queue[(off + 1) * s->channels];
+    double corr = 0., energy = 0., in_energy = 0.;
+
+    for( unsigned i = 0; i < s->samples; i++ )
+    {
+        corr += (double)s->pre_corr[i] * in[i];
+        energy += (double)s->pre_corr[i] * s->pre_corr[i];
+        in_energy += (double)in[i] * in[i];
+    }
+    *norm = sqrt( energy * in_energy );
+    return corr;
+}
+
+/* Compares the positions chosen in a simulated playback at 1.5x and 2x
+ * with those of the C kernel, which is the previous implementation. */
+static void Test( const char *mode, unsigned channels, unsigned rate,
+                  unsigned ms_search )
+{
+    unsigned frames_overlap;
+    const unsigned frames_search = Params( rate, ms_search, &frames_overlap );
+    const unsigned frames = 2 * rate;
+    float *signal = Signal( channels, frames, rate );
+    scaletempo_search_t *ref = scaletempo_search_New( channels, frames_overlap,
+                                                      frames_search, "c" );
+    scaletempo_search_t *s = scaletempo_search_New( channels, frames_overlap,
+                                                    frames_search, mode );
+    unsigned tests = 0, same = 0;
+
+    assert( ref != NULL && s != NULL );
+    for( double scale = 1.5; scale <= 2.; scale += .5 )
+    {
+        const unsigned frames_stride = 30 * rate / 1000;
+        const unsigned frames_max = frames_stride + frames_overlap
+                                  + frames_search;
+
+        for( unsigned pos = 0; pos + frames_max * 2 < frames;
+             pos += frames_stride * scale )
+        {
+            /* The overlap comes from the end of the previous stride */
+            const float *overlap = &signal[pos * channels];
+            const float *queue = &signal[(pos + frames_stride / 3)
+                                         * channels];
+            const unsigned ref_off = scaletempo_search_Find( ref, overlap,
+                                                             queue );
+            const unsigned off = scaletempo_search_Find( s, overlap, queue );
+            double norm, ref_norm;
+            const double corr = Corr( ref, queue, off, &norm );
+            const double ref_corr = Corr( ref, queue, ref_off, &ref_norm );
+
+            assert( off < frames_search );
+            /* Another position can only be chosen if it is as good */
+            assert( corr >= ref_corr - 1e-5 * ref_norm );
+            same += off == ref_off;
+            tests++;
+        }
+    }
+    printf( "%-4s %u ch %3u kHz search %2u ms: %u/%u same positions\n",
+            mode, channels, rate / 1000, ms_search, same, tests );
+    assert( same * 100 >= tests * 95 );
+
+    scaletempo_search_Delete( s );
+    scaletempo_search_Delete( ref );
+    free( signal );
+}
+#else
+static void Bench( const char *mode, unsigned channels, unsigned rate,
+                   unsigned ms_search )
+{
+    unsigned frames_overlap;
+    const unsigned frames_search = Params( rate, ms_search, &frames_overlap );
+    const unsigned loops = 500;
+    float *signal = Signal( channels, frames_overlap + frames_search + 1,
+                            rate );
+    scaletempo_search_t *s = scaletempo_search_New( channels, frames_overlap,
+                                                    frames_search, mode );
+    unsigned sum = 0;
+
+    assert( s != NULL );
+    vlc_tick_t time = vlc_tick_now();
+    for( unsigned i = 0; i < loops; i++ )
+        sum += scaletempo_search_Find( s, signal, signal );
+    time = vlc_tick_now() - time;
+
+    /* One search is done for each stride of 30 ms of output */
+    const double us = (double)US_FROM_VLC_TICK( time ) / loops;
+    printf( "%-4s %u ch %3u kHz search %2u ms: %8.1f us per stride, "
+            "%5.2f%% of a CPU (%u)\n", mode, channels, rate / 1000,
+            ms_search, us, us / 300., sum % 10 );
+
+    scaletempo_search_Delete( s );
+    free( signal );
+}
+#endif
+
+int main( void )
+{
+    static const unsigned channels[] = { 1, 2, 6, 8 };
+#ifndef SCALETEMPO_BENCH
+    static const unsigned rates[] = { 44100, 48000 };
+#else
+    static const unsigned rates[] = { 48000, 96000 };
+#endif
+    static const unsigned searches[] = { 14, 40 };
+    const char *modes[ARRAY_SIZE(kernels) + 1];
+    size_t mode_count = 0;
+
+#ifndef SCALETEMPO_BENCH
+    alarm( 60 );
+#endif
+
+    for( size_t k = 0; k < ARRAY_SIZE(kernels); k++ )
+    {
+        if( !vlc_CPU_CheckKernels( kernels[k].name ) )
+        {
+            fprintf( stderr, "WARNING: could not test %s\n",
+                     kernels[k].name );
+            continue;
+        }
+        modes[mode_count++] = kernels[k].name;
+    }
+    modes[mode_count++] = "fft";
+
+    for( size_t m = 0; m < mode_count; m++ )
+        for( size_t c = 0; c < ARRAY_SIZE(channels); c++ )
+            for( size_t r = 0; r < ARRAY_SIZE(rates); r++ )
+                for( size_t i = 0; i < ARRAY_SIZE(searches); i++ )
+#ifndef SCALETEMPO_BENCH
+                    Test( modes[m], channels[c], rates[r], searches[i] );
+#else
+                    Bench( modes[m], channels[c], rates[r], searches[i] );
+#endif
+    return 0;
+}
+#endif
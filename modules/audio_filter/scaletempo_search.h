@@ -0,0 +1,59 @@
+/*****************************************************************************
+ * scaletempo_search.h : best overlap position search for scaletempo
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_AUDIO_FILTER_SCALETEMPO_SEARCH_H
+#define VLC_AUDIO_FILTER_SCALETEMPO_SEARCH_H
+
+/**
+ * Finds the position of the input which correlates best with the overlap,
+ * that is the end of the previous stride, weighted by a window.
+ *
+ * The correlation is computed either directly for each position, with a
+ * scalar or a vectorized kernel, or for all positions at once with FFTs,
+ * the best candidates being then checked directly.
+ */
+typedef struct scaletempo_search scaletempo_search_t;
+
+/**
+ * \param frames_overlap frames of the overlap, the first one is ignored
+ * \param frames_search number of positions to search
+ * \param mode "simd" for the fastest direct kernel available, "fft", or
+ * the name of a specific direct kernel ("c", "sse2", "avx", "neon")
+ * \return the search, or NULL on error or if the kernel is not available
+ */
+scaletempo_search_t *scaletempo_search_New( unsigned channels,
+                                            unsigned frames_overlap,
+                                            unsigned frames_search,
+                                            const char *mode );
+void scaletempo_search_Delete( scaletempo_search_t * );
+
+/** Returns the name of the kernel used by the search */
+const char *scaletempo_search_Kernel( const scaletempo_search_t * );
+
+/**
+ * Returns the best position, in frames.
+ *
+ * \param overlap frames_overlap frames of interleaved samples
+ * \param queue frames_search + frames_overlap frames of interleaved samples
+ */
+unsigned scaletempo_search_Find( scaletempo_search_t *, const float *overlap,
+                                 const float *queue );
+
+#endif
@@ -34,6 +34,8 @@
 #include <vlc_aout.h>
 #include <vlc_aout_volume.h>
 
+#include "audio_filter/converter/pcm_kernels.h"
+
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
@@ -59,9 +61,10 @@ static void FilterFL32( audio_volume_t *p_volume, block_t *p_buffer,
     if( f_multiplier == 1.f )
         return; /* nothing to do */
 
+    const pcm_kernels_t *kernels = pcm_kernels_Get( "any" );
     float *p = (float *)p_buffer->p_buffer;
-    for( size_t i = p_buffer->i_buffer / sizeof(*p); i > 0; i-- )
-        *(p++) *= f_multiplier;
+    kernels->amplify_fl32( p, p, p_buffer->i_buffer / sizeof(*p),
+                           f_multiplier );
 
     (void) p_volume;
 }
@@ -69,13 +72,13 @@ static void FilterFL32( audio_volume_t *p_volume, block_t *p_buffer,
 static void FilterFL64( audio_volume_t *p_volume, block_t *p_buffer,
                         float f_multiplier )
 {
-    double *p = (double *)p_buffer->p_buffer;
-    double mult = f_multiplier;
-    if( mult == 1. )
+    if( f_multiplier == 1.f )
         return; /* nothing to do */
 
-    for( size_t i = p_buffer->i_buffer / sizeof(*p); i > 0; i-- )
-        *(p++) *= mult;
+    const pcm_kernels_t *kernels = pcm_kernels_Get( "any" );
+    double *p = (double *)p_buffer->p_buffer;
+    kernels->amplify_fl64( p, p, p_buffer->i_buffer / sizeof(*p),
+                           f_multiplier );
 
     (void) p_volume;
 }
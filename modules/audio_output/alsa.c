@@ -29,6 +29,8 @@
 #endif
 
 #include <assert.h>
+#include <errno.h>
+#include <stdatomic.h>
 
 #include <vlc_common.h>
 #include <vlc_plugin.h>
@@ -39,6 +41,8 @@
 #include <alsa/asoundlib.h>
 #include <alsa/version.h>
 
+#include "audio_output/ring.h"
+
 /** Private data for an ALSA PCM playback stream */
 typedef struct
 {
@@ -51,6 +55,15 @@ typedef struct
     bool soft_mute;
     float soft_gain;
     char *device;
+
+    /* Pull mode, through memory mapping */
+    aout_ring_t *ring; /**< Frames to render, NULL in push mode */
+    vlc_thread_t thread;
+    atomic_bool running;
+    snd_pcm_uframes_t period_size;
+    /* Reported by TimeGetMmap(), the output thread does not log */
+    atomic_uint xruns; /**< Device buffer underruns */
+    atomic_int error; /**< Unrecoverable error of the output thread */
 } aout_sys_t;
 
 enum {
@@ -83,6 +96,16 @@ static const char *const channels_text[] = {
     N_("Surround 5.0"), N_("Surround 5.1"), N_("Surround 7.1"),
 };
 
+#define MMAP_TEXT N_("Low latency pull mode")
+#define MMAP_LONGTEXT N_("Render the audio from a real-time thread, " \
+    "writing directly into the memory mapped device buffer, " \
+    "for lower and more stable latency. " \
+    "This parameter is ignored when digital pass-through is active.")
+
+#define MMAP_BUFFER_TEXT N_("Pull mode device buffer (ms)")
+#define MMAP_BUFFER_LONGTEXT N_("Duration of the device buffer in pull mode. " \
+    "Shorter buffers reduce the latency, but need more CPU wake-ups.")
+
 #define PASSTHROUGH_TEXT N_("Audio passthrough mode")
 static const int passthrough_modes[] = {
     PASSTHROUGH_NONE, PASSTHROUGH_SPDIF, PASSTHROUGH_HDMI,
@@ -105,6 +128,9 @@ vlc_module_begin ()
     add_integer("alsa-passthrough", PASSTHROUGH_NONE, PASSTHROUGH_TEXT,
                 PASSTHROUGH_TEXT, false)
         change_integer_list(passthrough_modes, passthrough_modes_text)
+    add_bool("alsa-mmap", false, MMAP_TEXT, MMAP_LONGTEXT, true)
+    add_integer_with_range("alsa-mmap-buffer", 10, 2, 1000,
+                           MMAP_BUFFER_TEXT, MMAP_BUFFER_LONGTEXT, true)
     add_sw_gain ()
     set_capability( "audio output", 150 )
     set_callbacks( Open, Close )
@@ -296,6 +322,12 @@ static void Pause (audio_output_t *, bool, vlc_tick_t);
 static void PauseDummy (audio_output_t *, bool, vlc_tick_t);
 static void Flush (audio_output_t *);
 static void Drain (audio_output_t *);
+static int TimeGetMmap (audio_output_t *, vlc_tick_t *);
+static void PlayMmap (audio_output_t *, block_t *, vlc_tick_t);
+static void PauseMmap (audio_output_t *, bool, vlc_tick_t);
+static void FlushMmap (audio_output_t *);
+static void DrainMmap (audio_output_t *);
+static void *MmapThread (void *);
 
 /** Initializes an ALSA playback stream */
 static int Start (audio_output_t *aout, audio_sample_format_t *restrict fmt)
@@ -447,12 +479,28 @@ static int Start (audio_output_t *aout, audio_sample_format_t *restrict fmt)
         goto error;
     }
 
-    val = snd_pcm_hw_params_set_access (pcm, hw,
-                                        SND_PCM_ACCESS_RW_INTERLEAVED);
-    if (val)
+    bool mmap = passthrough == PASSTHROUGH_NONE
+             && var_InheritBool (aout, "alsa-mmap");
+    if (mmap)
     {
-        msg_Err (aout, "cannot set access mode: %s", snd_strerror (val));
-        goto error;
+        val = snd_pcm_hw_params_set_access (pcm, hw,
+                                            SND_PCM_ACCESS_MMAP_INTERLEAVED);
+        if (val)
+        {
+            msg_Warn (aout, "cannot map device buffer: %s",
+                      snd_strerror (val));
+            mmap = false;
+        }
+    }
+    if (!mmap)
+    {
+        val = snd_pcm_hw_params_set_access (pcm, hw,
+                                            SND_PCM_ACCESS_RW_INTERLEAVED);
+        if (val)
+        {
+            msg_Err (aout, "cannot set access mode: %s", snd_strerror (val));
+            goto error;
+        }
     }
 
     /* Set sample format */
@@ -523,17 +571,31 @@ static int Start (audio_output_t *aout, audio_sample_format_t *restrict fmt)
     }
     sys->rate = fmt->i_rate;
 
-#if 1 /* work-around for period-long latency outputs (e.g. PulseAudio): */
-    param = AOUT_MIN_PREPARE_TIME;
-    val = snd_pcm_hw_params_set_period_time_near (pcm, hw, &param, NULL);
-    if (val)
-    {
-        msg_Err (aout, "cannot set period: %s", snd_strerror (val));
-        goto error;
+    if (mmap)
+    {   /* Keep the device buffer short: the ring holds the advance. */
+        param = var_InheritInteger (aout, "alsa-mmap-buffer") * 1000 / 2;
+        val = snd_pcm_hw_params_set_period_time_near (pcm, hw, &param, NULL);
+        if (val)
+        {
+            msg_Err (aout, "cannot set period: %s", snd_strerror (val));
+            goto error;
+        }
+        param *= 2;
     }
+    else
+    {
+#if 1 /* work-around for period-long latency outputs (e.g. PulseAudio): */
+        param = AOUT_MIN_PREPARE_TIME;
+        val = snd_pcm_hw_params_set_period_time_near (pcm, hw, &param, NULL);
+        if (val)
+        {
+            msg_Err (aout, "cannot set period: %s", snd_strerror (val));
+            goto error;
+        }
 #endif
+        param = AOUT_MAX_ADVANCE_TIME;
+    }
     /* Set buffer size */
-    param = AOUT_MAX_ADVANCE_TIME;
     val = snd_pcm_hw_params_set_buffer_time_near (pcm, hw, &param, NULL);
     if (val)
     {
@@ -567,6 +629,16 @@ static int Start (audio_output_t *aout, audio_sample_format_t *restrict fmt)
     }
     Dump (aout, "final HW setup:\n", snd_pcm_hw_params_dump, hw);
 
+    if (mmap)
+    {
+        val = snd_pcm_hw_params_get_period_size (hw, &sys->period_size, NULL);
+        if (val)
+        {
+            msg_Err (aout, "cannot get period size: %s", snd_strerror (val));
+            goto error;
+        }
+    }
+
     /* Get Initial software parameters */
     snd_pcm_sw_params_t *sw;
 
@@ -574,6 +646,17 @@ static int Start (audio_output_t *aout, audio_sample_format_t *restrict fmt)
     snd_pcm_sw_params_current (pcm, sw);
     Dump (aout, "initial software parameters:\n", snd_pcm_sw_params_dump, sw);
 
+    if (mmap)
+    {   /* Wake the output thread up once per period */
+        val = snd_pcm_sw_params_set_avail_min (pcm, sw, sys->period_size);
+        if (val < 0)
+        {
+            msg_Err (aout, "unable to set minimum available frames (%s)",
+                     snd_strerror (val));
+            goto error;
+        }
+    }
+
     /* START REVISIT */
     //snd_pcm_sw_params_set_avail_min( pcm, sw, i_period_size );
     // FIXME: useful?
@@ -611,13 +694,51 @@ static int Start (audio_output_t *aout, audio_sample_format_t *restrict fmt)
     }
     fmt->channel_type = AUDIO_CHANNEL_TYPE_BITMAP;
     sys->format = fmt->i_format;
+    sys->ring = NULL;
 
-    if (snd_pcm_hw_params_can_pause (hw))
-        aout->pause = Pause;
+    if (mmap)
+    {
+        const size_t frame_size = snd_pcm_frames_to_bytes (pcm, 1);
+        const uint8_t silence = (pcm_format == SND_PCM_FORMAT_U8) ? 0x80 : 0;
+
+        sys->ring = aout_ring_New (frame_size,
+                                   samples_from_vlc_tick(AOUT_MAX_ADVANCE_TIME,
+                                                         sys->rate), silence);
+        if (unlikely(sys->ring == NULL))
+            goto error;
+
+        atomic_init (&sys->running, true);
+        atomic_init (&sys->xruns, 0);
+        atomic_init (&sys->error, 0);
+        if (vlc_clone (&sys->thread, MmapThread, aout,
+                       VLC_THREAD_PRIORITY_OUTPUT))
+        {
+            aout_ring_Delete (sys->ring);
+            goto error;
+        }
+        msg_Dbg (aout, "pull mode with %lu frames periods",
+                 (unsigned long)sys->period_size);
+
+        aout->time_get = TimeGetMmap;
+        aout->play = PlayMmap;
+        aout->pause = PauseMmap;
+        aout->flush = FlushMmap;
+        aout->drain = DrainMmap;
+    }
     else
     {
-        aout->pause = PauseDummy;
-        msg_Warn (aout, "device cannot be paused");
+        aout->time_get = TimeGet;
+        aout->play = Play;
+        aout->flush = Flush;
+        aout->drain = Drain;
+
+        if (snd_pcm_hw_params_can_pause (hw))
+            aout->pause = Pause;
+        else
+        {
+            aout->pause = PauseDummy;
+            msg_Warn (aout, "device cannot be paused");
+        }
     }
     aout_SoftVolumeStart (aout);
     return 0;
@@ -627,6 +748,108 @@ error:
     return VLC_EGENERIC;
 }
 
+/**
+ * Recovers from a device error in pull mode.
+ * \return 0, or the error if the stream cannot be recovered
+ */
+static int MmapRecover (aout_sys_t *sys, int err)
+{
+    if (err == -EPIPE)
+        atomic_fetch_add_explicit (&sys->xruns, 1, memory_order_relaxed);
+
+    return snd_pcm_recover (sys->pcm, err, 1);
+}
+
+/**
+ * Pulls frames from the ring into the memory mapped device buffer.
+ */
+static int MmapFill (aout_sys_t *sys, snd_pcm_uframes_t avail)
+{
+    snd_pcm_t *pcm = sys->pcm;
+
+    while (avail > 0)
+    {
+        const snd_pcm_channel_area_t *areas;
+        snd_pcm_uframes_t offset, frames = avail;
+
+        int val = snd_pcm_mmap_begin (pcm, &areas, &offset, &frames);
+        if (val < 0)
+            return val;
+
+        /* Interleaved access: all channels share the first area */
+        uint8_t *buf = (uint8_t *)areas[0].addr
+                     + (areas[0].first + offset * areas[0].step) / 8;
+
+        aout_ring_Read (sys->ring, buf, frames);
+
+        snd_pcm_sframes_t done = snd_pcm_mmap_commit (pcm, offset, frames);
+        if (done < 0)
+            return done;
+        if ((snd_pcm_uframes_t)done != frames)
+            return -EPIPE;
+        avail -= frames;
+    }
+    return 0;
+}
+
+/**
+ * Real-time output thread of the pull mode.
+ */
+static void *MmapThread (void *data)
+{
+    audio_output_t *aout = data;
+    aout_sys_t *sys = aout->sys;
+    snd_pcm_t *pcm = sys->pcm;
+    /* Wake up at least every two periods to check for termination */
+    const int timeout = 1 + MS_FROM_VLC_TICK(2 *
+                        vlc_tick_from_samples(sys->period_size, sys->rate));
+    int err = 0;
+
+    while (atomic_load_explicit (&sys->running, memory_order_relaxed))
+    {
+        snd_pcm_sframes_t avail = snd_pcm_avail_update (pcm);
+        if (avail < 0)
+        {
+            if ((err = MmapRecover (sys, avail)) != 0)
+                break;
+            continue;
+        }
+
+        if ((snd_pcm_uframes_t)avail < sys->period_size)
+        {
+            if (snd_pcm_state (pcm) == SND_PCM_STATE_PREPARED)
+            {   /* Device buffer filled: start playing */
+                int val = snd_pcm_start (pcm);
+                if (val < 0 && (err = MmapRecover (sys, val)) != 0)
+                    break;
+            }
+
+            int val = snd_pcm_wait (pcm, timeout);
+            if (val < 0 && (err = MmapRecover (sys, val)) != 0)
+                break;
+            continue;
+        }
+
+        int val = MmapFill (sys, avail);
+        if (val < 0)
+        {
+            if ((err = MmapRecover (sys, val)) != 0)
+                break;
+            continue;
+        }
+
+        snd_pcm_sframes_t delay;
+        if (snd_pcm_delay (pcm, &delay) == 0)
+            aout_ring_ReportLatency (sys->ring, (delay > 0) ? delay : 0,
+                                     vlc_tick_now ());
+    }
+
+    /* The device is no longer used by this thread */
+    if (err != 0)
+        atomic_store_explicit (&sys->error, err, memory_order_release);
+    return NULL;
+}
+
 static int TimeGet (audio_output_t *aout, vlc_tick_t *restrict delay)
 {
     aout_sys_t *sys = aout->sys;
@@ -736,6 +959,85 @@ static void Drain (audio_output_t *aout)
     snd_pcm_prepare (pcm);
 }
 
+static int TimeGetMmap (audio_output_t *aout, vlc_tick_t *restrict delay)
+{
+    aout_sys_t *sys = aout->sys;
+    size_t frames;
+
+    unsigned underruns = aout_ring_GetUnderruns (sys->ring, &frames);
+    if (underruns > 0)
+        msg_Warn (aout, "%u underrun(s), %zu frames of silence", underruns,
+                  frames);
+
+    unsigned xruns = atomic_exchange_explicit (&sys->xruns, 0,
+                                               memory_order_relaxed);
+    if (xruns > 0)
+        msg_Warn (aout, "%u device buffer underrun(s)", xruns);
+
+    int err = atomic_exchange_explicit (&sys->error, 0, memory_order_acquire);
+    if (err != 0)
+    {
+        msg_Err (aout, "cannot recover playback stream: %s",
+                 snd_strerror (err));
+        DumpDeviceStatus (aout, sys->pcm);
+    }
+
+    *delay = aout_ring_GetDelay (sys->ring, sys->rate);
+    return 0;
+}
+
+/**
+ * Queues one audio buffer for the output thread.
+ */
+static void PlayMmap (audio_output_t *aout, block_t *block, vlc_tick_t date)
+{
+    aout_sys_t *sys = aout->sys;
+
+    if (sys->chans_to_reorder != 0)
+        aout_ChannelReorder(block->p_buffer, block->i_buffer,
+                           sys->chans_to_reorder, sys->chans_table, sys->format);
+
+    const size_t frame_size = snd_pcm_frames_to_bytes (sys->pcm, 1);
+    size_t done = 0;
+
+    for (;;)
+    {
+        done += aout_ring_Write (sys->ring, block->p_buffer + done * frame_size,
+                                 block->i_nb_samples - done);
+        if (done >= block->i_nb_samples)
+            break;
+
+        /* Ring full: wait for the output thread to render the remainder */
+        vlc_tick_sleep (vlc_tick_from_samples (block->i_nb_samples - done,
+                                               sys->rate));
+    }
+    block_Release (block);
+    (void) date;
+}
+
+static void PauseMmap (audio_output_t *aout, bool pause, vlc_tick_t date)
+{
+    aout_sys_t *sys = aout->sys;
+
+    aout_ring_Pause (sys->ring, pause);
+    (void) date;
+}
+
+static void FlushMmap (audio_output_t *aout)
+{
+    aout_sys_t *sys = aout->sys;
+
+    aout_ring_Flush (sys->ring);
+}
+
+static void DrainMmap (audio_output_t *aout)
+{
+    aout_sys_t *sys = aout->sys;
+
+    aout_ring_Drain (sys->ring);
+    vlc_tick_sleep (aout_ring_GetDelay (sys->ring, sys->rate));
+}
+
 /**
  * Releases the audio output.
  */
@@ -744,6 +1046,13 @@ static void Stop (audio_output_t *aout)
     aout_sys_t *sys = aout->sys;
     snd_pcm_t *pcm = sys->pcm;
 
+    if (sys->ring != NULL)
+    {
+        atomic_store_explicit (&sys->running, false, memory_order_relaxed);
+        vlc_join (sys->thread, NULL);
+        aout_ring_Delete (sys->ring);
+    }
+
     snd_pcm_drop (pcm);
     snd_pcm_close (pcm);
 }
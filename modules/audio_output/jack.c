@@ -37,11 +37,12 @@
 #include <vlc_aout.h>
 
 #include <jack/jack.h>
-#include <jack/ringbuffer.h>
 
 #include <stdio.h>
 #include <unistd.h>                                      /* write(), close() */
 
+#include "audio_output/ring.h"
+
 typedef jack_default_audio_sample_t jack_sample_t;
 
 /*****************************************************************************
@@ -52,7 +53,7 @@ typedef jack_default_audio_sample_t jack_sample_t;
  *****************************************************************************/
 typedef struct
 {
-    jack_ringbuffer_t *p_jack_ringbuffer;
+    aout_ring_t    *p_ring;
     jack_client_t  *p_jack_client;
     jack_port_t   **p_jack_ports;
     jack_sample_t **p_jack_buffers;
@@ -72,6 +73,7 @@ static void Close        ( vlc_object_t * );
 static void Play         ( audio_output_t * p_aout, block_t *, vlc_tick_t );
 static void Pause        ( audio_output_t *aout, bool paused, vlc_tick_t date );
 static void Flush        ( audio_output_t *p_aout );
+static void Drain        ( audio_output_t *p_aout );
 static int  TimeGet      ( audio_output_t *, vlc_tick_t * );
 static int  Process      ( jack_nframes_t i_frames, void *p_arg );
 static int  GraphChange  ( void *p_arg );
@@ -124,6 +126,7 @@ static int Start( audio_output_t *p_aout, audio_sample_format_t *restrict fmt )
         return VLC_EGENERIC;
 
     p_sys->latency = 0;
+    p_sys->p_ring = NULL;
     p_sys->paused = VLC_TICK_INVALID;
 
     /* Connect to the JACK server */
@@ -157,6 +160,7 @@ static int Start( audio_output_t *p_aout, audio_sample_format_t *restrict fmt )
     p_aout->play = Play;
     p_aout->pause = Pause;
     p_aout->flush = Flush;
+    p_aout->drain = Drain;
     p_aout->time_get = TimeGet;
     aout_SoftVolumeStart( p_aout );
 
@@ -179,21 +183,15 @@ static int Start( audio_output_t *p_aout, audio_sample_format_t *restrict fmt )
         goto error_out;
     }
 
-    const size_t buf_sz =
-        samples_from_vlc_tick(AOUT_MAX_ADVANCE_TIME, fmt->i_rate * fmt->i_bytes_per_frame);
-    p_sys->p_jack_ringbuffer = jack_ringbuffer_create( buf_sz );
-
-    if( p_sys->p_jack_ringbuffer == NULL )
+    p_sys->p_ring = aout_ring_New( fmt->i_bytes_per_frame,
+                        samples_from_vlc_tick( AOUT_MAX_ADVANCE_TIME,
+                                               fmt->i_rate ), 0 );
+    if( p_sys->p_ring == NULL )
     {
         status = VLC_ENOMEM;
         goto error_out;
     }
 
-    if( jack_ringbuffer_mlock( p_sys->p_jack_ringbuffer ))
-    {
-        msg_Warn( p_aout, "failed to lock JACK ringbuffer in memory" );
-    }
-
     /* Create the output ports */
     for( i = 0; i < p_sys->i_channels; i++ )
     {
@@ -272,8 +270,8 @@ error_out:
             jack_deactivate( p_sys->p_jack_client );
             jack_client_close( p_sys->p_jack_client );
         }
-        if( p_sys->p_jack_ringbuffer )
-            jack_ringbuffer_free( p_sys->p_jack_ringbuffer );
+        if( p_sys->p_ring )
+            aout_ring_Delete( p_sys->p_ring );
 
         free( p_sys->p_jack_ports );
         free( p_sys->p_jack_buffers );
@@ -285,28 +283,13 @@ error_out:
 static void Play(audio_output_t * p_aout, block_t * p_block, vlc_tick_t date)
 {
     aout_sys_t *p_sys = p_aout->sys;
-    jack_ringbuffer_t *rb = p_sys->p_jack_ringbuffer;
-    const size_t bytes_per_frame = p_sys->i_channels * sizeof(jack_sample_t);
-
-    while (p_block->i_buffer > 0) {
+    const size_t written = aout_ring_Write( p_sys->p_ring, p_block->p_buffer,
+                                            p_block->i_nb_samples );
 
-        /* move data to buffer */
-        const size_t write_space = jack_ringbuffer_write_space(rb);
-        const size_t bytes = p_block->i_buffer < write_space ?
-            p_block->i_buffer : write_space;
-
-        /* If our audio thread is not reading fast enough */
-        if( unlikely( bytes == 0 ) ) {
-            msg_Warn( p_aout, "%"PRIuPTR " frames of audio dropped",
-                    p_block->i_buffer /  bytes_per_frame );
-            break;
-        }
-
-        jack_ringbuffer_write( rb, (const char *) p_block->p_buffer, bytes );
-
-        p_block->p_buffer += bytes;
-        p_block->i_buffer -= bytes;
-    }
+    /* If our audio thread is not reading fast enough */
+    if( unlikely( written < p_block->i_nb_samples ) )
+        msg_Warn( p_aout, "%zu frames of audio dropped",
+                  p_block->i_nb_samples - written );
 
     block_Release(p_block);
     (void) date;
@@ -326,75 +309,95 @@ static void Pause(audio_output_t *aout, bool paused, vlc_tick_t date)
         msg_Dbg(aout, "resuming after %"PRId64" us", date);
         sys->paused = VLC_TICK_INVALID;
     }
+    aout_ring_Pause( sys->p_ring, paused );
 }
 
 static void Flush(audio_output_t *p_aout)
 {
     aout_sys_t * p_sys = p_aout->sys;
-    jack_ringbuffer_t *rb = p_sys->p_jack_ringbuffer;
 
-    /* reset ringbuffer read and write pointers */
-    jack_ringbuffer_reset(rb);
+    aout_ring_Flush( p_sys->p_ring );
+}
+
+static void Drain(audio_output_t *p_aout)
+{
+    aout_sys_t * p_sys = p_aout->sys;
+
+    /* Running out of samples is now the end of the stream, not an underrun */
+    aout_ring_Drain( p_sys->p_ring );
+    vlc_tick_sleep( aout_ring_GetDelay( p_sys->p_ring, p_sys->i_rate ) );
 }
 
 static int TimeGet(audio_output_t *p_aout, vlc_tick_t *delay)
 {
     aout_sys_t * p_sys = p_aout->sys;
-    jack_ringbuffer_t *rb = p_sys->p_jack_ringbuffer;
-    const size_t bytes_per_frame = p_sys->i_channels * sizeof(jack_sample_t);
+    size_t frames;
+    unsigned underruns = aout_ring_GetUnderruns( p_sys->p_ring, &frames );
 
-    *delay = p_sys->latency +
-            vlc_tick_from_samples(jack_ringbuffer_read_space(rb) / bytes_per_frame,
-                                  p_sys->i_rate);
+    if( underruns > 0 )
+        msg_Warn( p_aout, "%u underrun(s), %zu frames of silence played",
+                  underruns, frames );
 
+    *delay = aout_ring_GetDelay( p_sys->p_ring, p_sys->i_rate );
     return 0;
 }
 
 /*****************************************************************************
  * Process: callback for JACK
+ *****************************************************************************
+ * Pulls the samples from the ring, without locking nor waiting.
  *****************************************************************************/
 int Process( jack_nframes_t i_frames, void *p_arg )
 {
-    unsigned int i, j, frames_from_rb = 0;
-    size_t bytes_read = 0;
-    size_t frames_read;
     audio_output_t *p_aout = (audio_output_t*) p_arg;
     aout_sys_t *p_sys = p_aout->sys;
-
-    /* Get the next audio data buffer unless paused */
-
-    if( p_sys->paused == VLC_TICK_INVALID )
-        frames_from_rb = i_frames;
+    const unsigned i_channels = p_sys->i_channels;
+    const vlc_tick_t cycle_start = vlc_tick_now() - vlc_tick_from_samples(
+        jack_frames_since_cycle_start( p_sys->p_jack_client ), p_sys->i_rate );
+    jack_nframes_t i_done = 0;
 
     /* Get the JACK buffers to write to */
-    for( i = 0; i < p_sys->i_channels; i++ )
+    for( unsigned i = 0; i < i_channels; i++ )
     {
         p_sys->p_jack_buffers[i] = jack_port_get_buffer( p_sys->p_jack_ports[i],
                                                          i_frames );
     }
 
-    /* Copy in the audio data */
-    for( j = 0; j < frames_from_rb; j++ )
+    /* Deinterleave the audio data, nothing if paused */
+    while( i_done < i_frames )
     {
-        for( i = 0; i < p_sys->i_channels; i++ )
+        const void *p_data;
+        size_t i_count = aout_ring_Peek( p_sys->p_ring, &p_data,
+                                         i_frames - i_done );
+        if( i_count == 0 )
+            break;
+
+        for( unsigned i = 0; i < i_channels; i++ )
         {
-            jack_sample_t *p_dst = p_sys->p_jack_buffers[i] + j;
-            bytes_read += jack_ringbuffer_read( p_sys->p_jack_ringbuffer,
-                    (char *) p_dst, sizeof(jack_sample_t) );
+            const jack_sample_t *p_src = (const jack_sample_t *)p_data + i;
+            jack_sample_t *p_dst = p_sys->p_jack_buffers[i] + i_done;
+
+            for( size_t j = 0; j < i_count; j++ )
+                p_dst[j] = p_src[j * i_channels];
         }
+        aout_ring_Consume( p_sys->p_ring, i_count );
+        i_done += i_count;
     }
 
     /* Fill any remaining buffer with silence */
-    frames_read = (bytes_read / sizeof(jack_sample_t)) / p_sys->i_channels;
-    if( frames_read < i_frames )
+    if( i_done < i_frames )
     {
-        for( i = 0; i < p_sys->i_channels; i++ )
+        for( unsigned i = 0; i < i_channels; i++ )
         {
-            memset( p_sys->p_jack_buffers[i] + frames_read, 0,
-                    sizeof( jack_sample_t ) * (i_frames - frames_read) );
+            memset( p_sys->p_jack_buffers[i] + i_done, 0,
+                    sizeof( jack_sample_t ) * (i_frames - i_done) );
         }
+        aout_ring_Underrun( p_sys->p_ring, i_frames - i_done );
     }
 
+    /* The samples of this cycle are played after the latency of the ports */
+    aout_ring_ReportLatency( p_sys->p_ring, p_sys->latency + i_frames,
+                             cycle_start );
     return 0;
 }
 
@@ -446,7 +449,7 @@ static void Stop( audio_output_t *p_aout )
     }
     free( p_sys->p_jack_ports );
     free( p_sys->p_jack_buffers );
-    jack_ringbuffer_free( p_sys->p_jack_ringbuffer );
+    aout_ring_Delete( p_sys->p_ring );
 }
 
 static int Open(vlc_object_t *obj)
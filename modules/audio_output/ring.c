@@ -0,0 +1,495 @@
+/*****************************************************************************
+ * ring.c: lock-free audio ring for pull model audio outputs
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef AOUT_RING_TEST
+# undef NDEBUG
+#endif
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+
+#include "ring.h"
+
+struct aout_ring
+{
+    uint8_t *buffer;
+    size_t frame_size;
+    size_t capacity; /* frames, a power of two */
+    uint8_t silence;
+
+    /* Positions in frames since the creation, wrapping around */
+    atomic_size_t write; /* written by the producer only */
+    atomic_size_t read;  /* written by the consumer only */
+    atomic_size_t flush; /* frames before are discarded, by the producer */
+
+    atomic_bool paused;
+    atomic_bool drained;
+
+    /* Underruns since the last aout_ring_GetUnderruns() */
+    atomic_uint underruns;
+    atomic_size_t underrun_frames;
+    bool dry; /* the consumer ran out of frames, consumer only */
+
+    /* Latency of the device, written by the consumer under a sequence count:
+     * odd while the values are being updated */
+    atomic_uint latency_seq;
+    atomic_size_t latency_frames;
+    atomic_int_least64_t latency_date;
+};
+
+aout_ring_t *aout_ring_New(size_t frame_size, size_t frames, uint8_t silence)
+{
+    size_t capacity = 1;
+
+    assert(frame_size > 0);
+    while (capacity < frames)
+    {
+        if (capacity > SIZE_MAX / 2 / frame_size)
+            return NULL;
+        capacity *= 2;
+    }
+
+    aout_ring_t *ring = malloc(sizeof (*ring));
+    if (unlikely(ring == NULL))
+        return NULL;
+
+    ring->buffer = malloc(capacity * frame_size);
+    if (unlikely(ring->buffer == NULL))
+    {
+        free(ring);
+        return NULL;
+    }
+
+    /* Touch the pages now rather than in the real-time consumer */
+    memset(ring->buffer, silence, capacity * frame_size);
+
+    ring->frame_size = frame_size;
+    ring->capacity = capacity;
+    ring->silence = silence;
+    atomic_init(&ring->write, 0);
+    atomic_init(&ring->read, 0);
+    atomic_init(&ring->flush, 0);
+    atomic_init(&ring->paused, false);
+    atomic_init(&ring->drained, true);
+    atomic_init(&ring->underruns, 0);
+    atomic_init(&ring->underrun_frames, 0);
+    ring->dry = false;
+    atomic_init(&ring->latency_seq, 0);
+    atomic_init(&ring->latency_frames, 0);
+    atomic_init(&ring->latency_date, VLC_TICK_INVALID);
+    return ring;
+}
+
+void aout_ring_Delete(aout_ring_t *ring)
+{
+    free(ring->buffer);
+    free(ring);
+}
+
+/* Returns whether position a is after position b */
+static inline bool After(size_t a, size_t b)
+{
+    return a - b - 1 < SIZE_MAX / 2;
+}
+
+size_t aout_ring_Write(aout_ring_t *ring, const void *data, size_t frames)
+{
+    const size_t write = atomic_load_explicit(&ring->write,
+                                              memory_order_relaxed);
+    /* The frames discarded by a flush are only overwritten once the consumer
+     * has skipped them, as it may still be reading them. */
+    const size_t read = atomic_load_explicit(&ring->read,
+                                             memory_order_acquire);
+    const size_t space = ring->capacity - (write - read);
+
+    if (frames > space)
+        frames = space;
+
+    const size_t offset = write & (ring->capacity - 1);
+    const size_t first = __MIN(frames, ring->capacity - offset);
+
+    memcpy(ring->buffer + offset * ring->frame_size, data,
+           first * ring->frame_size);
+    memcpy(ring->buffer, (const uint8_t *)data + first * ring->frame_size,
+           (frames - first) * ring->frame_size);
+
+    atomic_store_explicit(&ring->write, write + frames, memory_order_release);
+    if (frames > 0)
+        atomic_store_explicit(&ring->drained, false, memory_order_relaxed);
+    return frames;
+}
+
+void aout_ring_Flush(aout_ring_t *ring)
+{
+    const size_t write = atomic_load_explicit(&ring->write,
+                                              memory_order_relaxed);
+
+    atomic_store_explicit(&ring->drained, true, memory_order_relaxed);
+    atomic_store_explicit(&ring->flush, write, memory_order_release);
+}
+
+void aout_ring_Drain(aout_ring_t *ring)
+{
+    atomic_store_explicit(&ring->drained, true, memory_order_relaxed);
+}
+
+void aout_ring_Pause(aout_ring_t *ring, bool paused)
+{
+    atomic_store_explicit(&ring->paused, paused, memory_order_relaxed);
+}
+
+size_t aout_ring_GetQueued(aout_ring_t *ring)
+{
+    const size_t write = atomic_load_explicit(&ring->write,
+                                              memory_order_relaxed);
+    const size_t flush = atomic_load_explicit(&ring->flush,
+                                              memory_order_relaxed);
+    size_t read = atomic_load_explicit(&ring->read, memory_order_relaxed);
+
+    if (After(flush, read))
+        read = flush;
+    return write - read;
+}
+
+vlc_tick_t aout_ring_GetDelay(aout_ring_t *ring, unsigned rate)
+{
+    const size_t queued = aout_ring_GetQueued(ring);
+    unsigned seq;
+    size_t frames;
+    vlc_tick_t date;
+
+    do
+    {
+        seq = atomic_load_explicit(&ring->latency_seq, memory_order_acquire);
+        frames = atomic_load_explicit(&ring->latency_frames,
+                                      memory_order_relaxed);
+        date = atomic_load_explicit(&ring->latency_date, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+    }
+    while ((seq & 1)
+        || seq != atomic_load_explicit(&ring->latency_seq,
+                                       memory_order_relaxed));
+
+    vlc_tick_t delay = vlc_tick_from_samples(queued, rate);
+
+    if (date != VLC_TICK_INVALID)
+    {
+        /* Frames rendered by the device since the report */
+        const vlc_tick_t device = vlc_tick_from_samples(frames, rate)
+                                - (vlc_tick_now() - date);
+        if (device > 0)
+            delay += device;
+    }
+    return delay;
+}
+
+unsigned aout_ring_GetUnderruns(aout_ring_t *ring, size_t *frames)
+{
+    *frames = atomic_exchange_explicit(&ring->underrun_frames, 0,
+                                       memory_order_relaxed);
+    return atomic_exchange_explicit(&ring->underruns, 0,
+                                    memory_order_relaxed);
+}
+
+size_t aout_ring_Peek(aout_ring_t *ring, const void **data, size_t max)
+{
+    if (atomic_load_explicit(&ring->paused, memory_order_relaxed))
+        return 0;
+
+    size_t read = atomic_load_explicit(&ring->read, memory_order_relaxed);
+    const size_t flush = atomic_load_explicit(&ring->flush,
+                                              memory_order_acquire);
+
+    if (After(flush, read))
+    {   /* Skip the flushed frames */
+        read = flush;
+        atomic_store_explicit(&ring->read, read, memory_order_release);
+    }
+
+    const size_t write = atomic_load_explicit(&ring->write,
+                                              memory_order_acquire);
+    const size_t offset = read & (ring->capacity - 1);
+    size_t frames = write - read;
+
+    if (frames > ring->capacity - offset)
+        frames = ring->capacity - offset;
+    if (frames > max)
+        frames = max;
+
+    *data = ring->buffer + offset * ring->frame_size;
+    return frames;
+}
+
+void aout_ring_Consume(aout_ring_t *ring, size_t frames)
+{
+    const size_t read = atomic_load_explicit(&ring->read,
+                                             memory_order_relaxed);
+
+    if (frames == 0)
+        return;
+    ring->dry = false;
+    atomic_store_explicit(&ring->read, read + frames, memory_order_release);
+}
+
+void aout_ring_Underrun(aout_ring_t *ring, size_t frames)
+{
+    if (frames == 0
+     || atomic_load_explicit(&ring->paused, memory_order_relaxed)
+     || atomic_load_explicit(&ring->drained, memory_order_relaxed))
+        return;
+
+    /* Count once per run out of frames */
+    if (!ring->dry)
+    {
+        ring->dry = true;
+        atomic_fetch_add_explicit(&ring->underruns, 1, memory_order_relaxed);
+    }
+    atomic_fetch_add_explicit(&ring->underrun_frames, frames,
+                              memory_order_relaxed);
+}
+
+size_t aout_ring_Read(aout_ring_t *ring, void *data, size_t frames)
+{
+    uint8_t *p = data;
+    size_t total = 0;
+
+    while (total < frames)
+    {
+        const void *src;
+        const size_t count = aout_ring_Peek(ring, &src, frames - total);
+
+        if (count == 0)
+            break;
+        memcpy(p, src, count * ring->frame_size);
+        aout_ring_Consume(ring, count);
+        p += count * ring->frame_size;
+        total += count;
+    }
+
+    memset(p, ring->silence, (frames - total) * ring->frame_size);
+    aout_ring_Underrun(ring, frames - total);
+    return total;
+}
+
+void aout_ring_ReportLatency(aout_ring_t *ring, size_t frames, vlc_tick_t date)
+{
+    const unsigned seq = atomic_load_explicit(&ring->latency_seq,
+                                              memory_order_relaxed);
+
+    atomic_store_explicit(&ring->latency_seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&ring->latency_frames, frames, memory_order_relaxed);
+    atomic_store_explicit(&ring->latency_date, date, memory_order_relaxed);
+    atomic_store_explicit(&ring->latency_seq, seq + 2, memory_order_release);
+}
+
+#ifdef AOUT_RING_TEST
+#include <stdio.h>
+#include <unistd.h>
+
+#define TEST_FRAMES 4000000
+
+static void TestSequence(void)
+{
+    aout_ring_t *ring = aout_ring_New(sizeof (uint32_t), 1000, 0);
+    uint32_t in[1500], out[1500];
+    uint32_t next = 0, expected = 0;
+
+    assert(ring != NULL);
+    for (unsigned i = 0; i < 1500; i++)
+        in[i] = i;
+
+    /* The capacity is rounded up to a power of two */
+    assert(aout_ring_Write(ring, in, 1500) == 1024);
+    assert(aout_ring_GetQueued(ring) == 1024);
+    next = 1024;
+
+    for (unsigned round = 0; round < 1000; round++)
+    {
+        const size_t count = 1 + (round * 37) % 700;
+        const size_t read = aout_ring_Read(ring, out, count);
+
+        for (size_t i = 0; i < read; i++)
+            assert(out[i] == expected++);
+
+        size_t written = 0;
+        for (unsigned i = 0; i < 1500; i++)
+            in[i] = next + i;
+        written = aout_ring_Write(ring, in, count);
+        assert(written <= count);
+        next += written;
+        assert(aout_ring_GetQueued(ring) == next - expected);
+    }
+    aout_ring_Delete(ring);
+}
+
+static void TestFlushUnderrun(void)
+{
+    aout_ring_t *ring = aout_ring_New(sizeof (int16_t), 64, 0);
+    int16_t in[64], out[64];
+    size_t frames;
+
+    for (unsigned i = 0; i < 64; i++)
+        in[i] = i + 1;
+
+    /* No underrun before the stream started */
+    assert(aout_ring_Read(ring, out, 16) == 0);
+    assert(aout_ring_GetUnderruns(ring, &frames) == 0 && frames == 0);
+
+    /* Flushed frames are skipped, the next ones are kept */
+    assert(aout_ring_Write(ring, in, 40) == 40);
+    aout_ring_Flush(ring);
+    assert(aout_ring_GetQueued(ring) == 0);
+    assert(aout_ring_Write(ring, in + 40, 10) == 10);
+    assert(aout_ring_GetQueued(ring) == 10);
+    assert(aout_ring_Read(ring, out, 16) == 10);
+    assert(out[0] == 41 && out[9] == 50 && out[10] == 0 && out[15] == 0);
+
+    /* One underrun per run out of frames */
+    assert(aout_ring_GetUnderruns(ring, &frames) == 1 && frames == 6);
+    assert(aout_ring_Read(ring, out, 16) == 0);
+    assert(aout_ring_GetUnderruns(ring, &frames) == 0 && frames == 16);
+
+    /* Neither paused nor drained is an underrun */
+    assert(aout_ring_Write(ring, in, 8) == 8);
+    aout_ring_Pause(ring, true);
+    assert(aout_ring_Read(ring, out, 16) == 0);
+    aout_ring_Pause(ring, false);
+    aout_ring_Drain(ring);
+    assert(aout_ring_Read(ring, out, 16) == 8);
+    assert(aout_ring_GetUnderruns(ring, &frames) == 0 && frames == 0);
+
+    /* Delay of the queued frames and of the device */
+    assert(aout_ring_Write(ring, in, 48) == 48);
+    assert(aout_ring_GetDelay(ring, 48000) == VLC_TICK_FROM_MS(1));
+    aout_ring_ReportLatency(ring, 480, vlc_tick_now());
+    vlc_tick_t delay = aout_ring_GetDelay(ring, 48000);
+    assert(delay > VLC_TICK_FROM_MS(5) && delay <= VLC_TICK_FROM_MS(11));
+    aout_ring_ReportLatency(ring, 480, vlc_tick_now() - VLC_TICK_FROM_SEC(1));
+    assert(aout_ring_GetDelay(ring, 48000) == VLC_TICK_FROM_MS(1));
+
+    aout_ring_Delete(ring);
+}
+
+struct test_consumer
+{
+    aout_ring_t *ring;
+    vlc_sem_t written;
+    vlc_sem_t room;
+    atomic_bool stop;
+    bool flushing;
+    uint64_t frames;
+};
+
+static void *Consumer(void *data)
+{
+    struct test_consumer *c = data;
+    uint32_t out[333];
+    uint32_t last = 0;
+    unsigned seed = 1;
+
+    while (!atomic_load(&c->stop) || aout_ring_GetQueued(c->ring) > 0)
+    {
+        seed = seed * 1103515245 + 12345;
+
+        const size_t count = 1 + (seed >> 8) % 333;
+        const size_t read = aout_ring_Read(c->ring, out, count);
+
+        /* The frames are in order, and none is lost without a flush */
+        for (size_t i = 0; i < read; i++)
+        {
+            assert(c->flushing ? out[i] > last : out[i] == last + 1);
+            last = out[i];
+        }
+        c->frames += read;
+        /* Reading may also free space by skipping flushed frames */
+        vlc_sem_post(&c->room);
+        if (read == 0)
+            vlc_sem_wait(&c->written);
+    }
+    return NULL;
+}
+
+static void TestThreads(bool flushing)
+{
+    struct test_consumer c = {
+        .ring = aout_ring_New(sizeof (uint32_t), 4096, 0),
+        .flushing = flushing,
+        .frames = 0,
+    };
+    vlc_thread_t th;
+    uint32_t in[777];
+    uint32_t next = 1;
+    unsigned seed = 2;
+
+    assert(c.ring != NULL);
+    vlc_sem_init(&c.written, 0);
+    vlc_sem_init(&c.room, 0);
+    atomic_init(&c.stop, false);
+    assert(vlc_clone(&th, Consumer, &c, VLC_THREAD_PRIORITY_LOW) == 0);
+
+    while (next < TEST_FRAMES)
+    {
+        seed = seed * 1103515245 + 12345;
+
+        const size_t count = 1 + (seed >> 8) % 777;
+        for (size_t i = 0; i < count; i++)
+            in[i] = next + i;
+        const size_t written = aout_ring_Write(c.ring, in, count);
+        if (written > 0)
+            vlc_sem_post(&c.written);
+        else
+            vlc_sem_wait(&c.room);
+        next += written;
+
+        if (flushing && (seed >> 16) % 1024 == 0)
+            aout_ring_Flush(c.ring);
+    }
+    atomic_store(&c.stop, true);
+    vlc_sem_post(&c.written);
+    vlc_join(th, NULL);
+
+    printf("%s: %"PRIu64" of %"PRIu32" frames read\n",
+           flushing ? "with flushes" : "without flushes", c.frames, next - 1);
+    if (!flushing)
+        assert(c.frames == next - 1);
+    vlc_sem_destroy(&c.room);
+    vlc_sem_destroy(&c.written);
+    aout_ring_Delete(c.ring);
+}
+
+int main(void)
+{
+    alarm(30);
+    TestSequence();
+    TestFlushUnderrun();
+    TestThreads(false);
+    TestThreads(true);
+    return 0;
+}
+#endif
@@ -0,0 +1,116 @@
+/*****************************************************************************
+ * ring.h: lock-free audio ring for pull model audio outputs
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_AOUT_RING_H
+#define VLC_AOUT_RING_H
+
+/**
+ * Single producer, single consumer ring of audio frames.
+ *
+ * The producer is the audio output thread, from the play, pause, flush,
+ * drain and time_get callbacks. The consumer is the real-time callback or
+ * thread of the audio output, which pulls the frames to render: the consumer
+ * functions never lock, wait nor allocate.
+ *
+ * The consumer accounts for the underruns, and reports the frames it already
+ * handed to the device, so that the producer gets the exact delay.
+ */
+typedef struct aout_ring aout_ring_t;
+
+/**
+ * \param frame_size bytes per frame
+ * \param frames minimum capacity, in frames
+ * \param silence byte value of silent samples
+ * \return the ring, or NULL on error
+ */
+aout_ring_t *aout_ring_New(size_t frame_size, size_t frames, uint8_t silence);
+void aout_ring_Delete(aout_ring_t *);
+
+/* Producer side */
+
+/**
+ * Queues frames.
+ *
+ * \return the number of frames queued, less than requested if full
+ */
+size_t aout_ring_Write(aout_ring_t *, const void *data, size_t frames);
+
+/** Discards the queued frames */
+void aout_ring_Flush(aout_ring_t *);
+
+/** Marks the end of the stream: running out of frames is no longer an
+ * underrun, until the next write */
+void aout_ring_Drain(aout_ring_t *);
+
+/** Makes the consumer render silence, without pulling frames */
+void aout_ring_Pause(aout_ring_t *, bool paused);
+
+/** Returns the number of queued frames */
+size_t aout_ring_GetQueued(aout_ring_t *);
+
+/**
+ * Gets the delay until the next written frame is rendered: the queued
+ * frames, and the frames handed to the device but not rendered yet, as last
+ * reported by the consumer, minus the time elapsed since.
+ */
+vlc_tick_t aout_ring_GetDelay(aout_ring_t *, unsigned rate);
+
+/**
+ * Gets the underruns since the last call.
+ *
+ * \param frames frames of silence rendered instead of audio [OUT]
+ * \return the number of underruns
+ */
+unsigned aout_ring_GetUnderruns(aout_ring_t *, size_t *frames);
+
+/* Consumer side */
+
+/**
+ * Gets the next contiguous frames.
+ *
+ * \param data pointer to the frames [OUT]
+ * \param max maximum number of frames
+ * \return the number of frames available at data, 0 if empty or paused
+ */
+size_t aout_ring_Peek(aout_ring_t *, const void **data, size_t max);
+
+/** Releases frames returned by aout_ring_Peek() */
+void aout_ring_Consume(aout_ring_t *, size_t frames);
+
+/** Accounts for frames of silence rendered for lack of frames, unless
+ * paused or drained */
+void aout_ring_Underrun(aout_ring_t *, size_t frames);
+
+/**
+ * Copies frames, padding with silence and accounting for the underrun if
+ * the ring runs out of frames.
+ *
+ * \return the number of frames pulled from the ring
+ */
+size_t aout_ring_Read(aout_ring_t *, void *data, size_t frames);
+
+/**
+ * Reports the frames handed to the device and not rendered yet.
+ *
+ * \param date time of the measure
+ */
+void aout_ring_ReportLatency(aout_ring_t *, size_t frames, vlc_tick_t date);
+
+#endif
@@ -113,7 +113,8 @@ int ffmpeg_OpenCodec( decoder_t *p_dec, AVCodecContext *, const AVCodec * );
 #define HW_LONGTEXT N_("This allows hardware decoding when available.")
 
 #define THREADS_TEXT N_( "Threads" )
-#define THREADS_LONGTEXT N_( "Number of threads used for decoding, 0 meaning auto" )
+#define THREADS_LONGTEXT N_( "Number of threads used for decoding, 0 meaning " \
+    "a share of the decoding threads (--dec-threads)" )
 
 /*
  * Encoder options
@@ -1187,8 +1187,8 @@ static block_t *EncodeVideo( encoder_t *p_enc, picture_t *p_pict )
             p_sys->frame->linesize[i_plane] = p_pict->p[i_plane].i_pitch;
         }
 
-        /* Let libavcodec select the frame type */
-        frame->pict_type = 0;
+        /* Let libavcodec select the frame type, unless a key frame is due */
+        frame->pict_type = p_pict->b_keyframe ? AV_PICTURE_TYPE_I : 0;
 
         frame->repeat_pict = p_pict->i_nb_fields - 2;
         frame->interlaced_frame = !p_pict->b_progressive;
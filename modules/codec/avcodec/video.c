@@ -76,6 +76,7 @@ typedef struct
     bool b_show_corrupted;
     bool b_from_preroll;
     enum AVDiscard i_skip_frame;
+    enum AVDiscard i_skip_loop_filter;
 
     struct frame_info_s frame_info[FRAME_INFO_DEPTH];
 
@@ -90,6 +91,9 @@ typedef struct
     int64_t i_last_output_frame;
     vlc_tick_t i_last_late_delay;
 
+    /* threads granted by the decoding threads budget */
+    decoder_threads_t *threads;
+
     /* for direct rendering */
     bool        b_direct_rendering;
     atomic_bool b_dr_failure;
@@ -565,6 +569,7 @@ int InitVideoDec( vlc_object_t *obj )
     else if( i_val == 2 ) p_context->skip_loop_filter = AVDISCARD_BIDIR;
     else if( i_val == 1 ) p_context->skip_loop_filter = AVDISCARD_NONREF;
     else p_context->skip_loop_filter = AVDISCARD_DEFAULT;
+    p_sys->i_skip_loop_filter = p_context->skip_loop_filter;
 
     if( var_CreateGetBool( p_dec, "avcodec-fast" ) )
         p_context->flags2 |= AV_CODEC_FLAG2_FAST;
@@ -613,7 +618,8 @@ int InitVideoDec( vlc_object_t *obj )
     p_context->reordered_opaque = 0;
 
     int i_thread_count = var_InheritInteger( p_dec, "avcodec-threads" );
-    if( i_thread_count <= 0 )
+    const bool b_thread_budget = i_thread_count <= 0;
+    if( b_thread_budget )
     {
         i_thread_count = vlc_GetCPUCount();
         if( i_thread_count > 1 )
@@ -627,6 +633,15 @@ int InitVideoDec( vlc_object_t *obj )
 #endif
     }
     i_thread_count = __MIN( i_thread_count, p_codec->id == AV_CODEC_ID_HEVC ? 32 : 16 );
+    /* Share the CPUs with the other decoders, unless told otherwise */
+    p_sys->threads = NULL;
+    if( b_thread_budget )
+    {
+        unsigned i_granted;
+        p_sys->threads = decoder_RequestThreads( p_dec, i_thread_count,
+                                                 &i_granted );
+        i_thread_count = i_granted;
+    }
     msg_Dbg( p_dec, "allowing %d thread(s) for decoding", i_thread_count );
     p_context->thread_count = i_thread_count;
     p_context->thread_safe_callbacks = true;
@@ -686,6 +701,7 @@ int InitVideoDec( vlc_object_t *obj )
     /* ***** Open the codec ***** */
     if( OpenVideoCodec( p_dec ) < 0 )
     {
+        decoder_ReleaseThreads( p_dec, p_sys->threads );
         vlc_sem_destroy( &p_sys->sem_mt );
         free( p_sys );
         avcodec_free_context( &p_context );
@@ -731,6 +747,31 @@ static void Flush( decoder_t *p_dec )
     decoder_AbortPictures( p_dec, false );
 }
 
+/* Skips the decoding steps the core asks for, because of late pictures */
+static void ApplySkipLevel( decoder_t *p_dec, AVCodecContext *p_context )
+{
+    enum AVDiscard skip_frame = AVDISCARD_DEFAULT;
+
+    switch( decoder_GetSkipLevel( p_dec ) )
+    {
+        case DECODER_SKIP_NONE:
+            return;
+        case DECODER_SKIP_LOOP_FILTER:
+            break;
+        case DECODER_SKIP_NONREF:
+            skip_frame = AVDISCARD_NONREF;
+            break;
+        case DECODER_SKIP_BIDIR:
+            skip_frame = AVDISCARD_BIDIR;
+            break;
+        case DECODER_SKIP_NONKEY:
+            skip_frame = AVDISCARD_NONKEY;
+            break;
+    }
+    p_context->skip_loop_filter = AVDISCARD_ALL;
+    p_context->skip_frame = __MAX( p_context->skip_frame, skip_frame );
+}
+
 static block_t * filter_earlydropped_blocks( decoder_t *p_dec, block_t *block )
 {
     decoder_sys_t *p_sys = p_dec->p_sys;
@@ -1034,11 +1075,15 @@ static int DecodeBlock( decoder_t *p_dec, block_t **pp_block )
     if( p_sys->b_hurry_up )
     {
         p_context->skip_frame = p_sys->i_skip_frame;
+        p_context->skip_loop_filter = p_sys->i_skip_loop_filter;
 
         /* Check also if we should/can drop the block and move to next block
             as trying to catchup the speed*/
         if( p_dec->b_frame_drop_allowed )
+        {
             p_block = filter_earlydropped_blocks( p_dec, p_block );
+            ApplySkipLevel( p_dec, p_context );
+        }
     }
 
     if( !b_need_output_picture || p_sys->framedrop == FRAMEDROP_NONREF )
@@ -1383,6 +1428,7 @@ void EndVideoDec( vlc_object_t *obj )
     if( p_sys->p_va )
         vlc_va_Delete( p_sys->p_va, &hwaccel_context );
 
+    decoder_ReleaseThreads( p_dec, p_sys->threads );
     vlc_sem_destroy( &p_sys->sem_mt );
     free( p_sys );
 }
@@ -1739,6 +1739,8 @@ static int updateStatistics( intf_thread_t *p_intf, input_item_t *p_item )
             p_item->p_stats->i_displayed_pictures );
     msg_rc(_("| frames lost      :    %5"PRIi64),
             p_item->p_stats->i_lost_pictures );
+    msg_rc(_("| decoding time    : %8.3f s"),
+            secf_from_vlc_tick(p_item->p_stats->i_video_cpu_time) );
     msg_rc("|");
     /* Audio*/
     msg_rc("%s", _("+-[Audio Decoding]"));
@@ -1748,6 +1750,8 @@ static int updateStatistics( intf_thread_t *p_intf, input_item_t *p_item )
             p_item->p_stats->i_played_abuffers );
     msg_rc(_("| buffers lost     :    %5"PRIi64),
             p_item->p_stats->i_lost_abuffers );
+    msg_rc(_("| decoding time    : %8.3f s"),
+            secf_from_vlc_tick(p_item->p_stats->i_audio_cpu_time) );
     msg_rc("|");
     msg_rc( "+----[ end of statistical info ]" );
     vlc_mutex_unlock( &p_item->lock );
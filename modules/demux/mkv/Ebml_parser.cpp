@@ -37,7 +37,8 @@ EbmlParser::EbmlParser( EbmlStream *es, EbmlElement *el_start, demux_t *p_demux
     m_got( NULL ),
     mi_user_level( 1 ),
     mb_keep( false ),
-    mb_dummy( var_InheritBool( p_demux, "mkv-use-dummy" ) )
+    mb_dummy( var_InheritBool( p_demux, "mkv-use-dummy" ) ),
+    mb_fast_read( false )
 {
     memset( m_el, 0, sizeof( *m_el ) * M_EL_MAXSIZE);
     m_el[0] = el_start;
@@ -81,6 +82,7 @@ void EbmlParser::Up( void )
 
 void EbmlParser::Down( void )
 {
+    mb_fast_read = false;
     mi_user_level++;
     mi_level++;
 }
@@ -110,6 +112,7 @@ void EbmlParser::Reset( demux_t *p_demux )
     }
     this->p_demux = p_demux;
     mi_user_level = mi_level = 1;
+    mb_fast_read = false;
     // a little faster and cleaner
     m_es->I_O().setFilePointer( static_cast<EbmlMaster*>(m_el[0])->GetDataStart() );
 }
@@ -160,7 +163,15 @@ next:
         i_max_read = UINT64_MAX;
     else if (!p_prev)
     {
-        i_max_read = m_el[mi_level-1]->GetSize();
+        if( mb_fast_read )
+        {
+            /* GetSimpleBlock() consumed the previous children already */
+            uint64 i_pos = m_es->I_O().getFilePointer();
+            i_max_read = m_el[mi_level-1]->GetEndPosition() > i_pos ?
+                         m_el[mi_level-1]->GetEndPosition() - i_pos : 0;
+        }
+        else
+            i_max_read = m_el[mi_level-1]->GetSize();
         if (i_max_read == 0)
         {
             /* check if the parent still has data to read */
@@ -193,6 +204,8 @@ next:
         }
     }
 
+    mb_fast_read = false;
+
     if (do_read)
     {
         // If the parent is a segment, use the segment context when creating children
@@ -335,6 +348,190 @@ next:
     return m_el[mi_level];
 }
 
+/* Read an EBML variable size integer, returns its length or 0 on error */
+static size_t ReadVint( const uint8_t *p_buf, size_t i_buf, uint64_t *pi_value )
+{
+    if( i_buf == 0 || p_buf[0] == 0 )
+        return 0;
+
+    size_t i_len = 1;
+    while( !( p_buf[0] & ( 0x80 >> ( i_len - 1 ) ) ) )
+        i_len++;
+    if( i_len > i_buf )
+        return 0;
+
+    uint64_t i_value = p_buf[0] & ( 0xff >> i_len );
+    for( size_t i = 1; i < i_len; i++ )
+        i_value = ( i_value << 8 ) | p_buf[i];
+
+    *pi_value = i_value;
+    return i_len;
+}
+
+/* Parse the SimpleBlock header and lacing, filling the frames of p_sblock */
+static bool ParseSimpleBlock( mkv_simpleblock_t *p_sblock )
+{
+    const uint8_t *p_buf = p_sblock->p_data->p_buffer;
+    size_t i_buf = p_sblock->p_data->i_buffer;
+    uint64_t i_track;
+
+    size_t i_len = ReadVint( p_buf, i_buf, &i_track );
+    if( i_len == 0 || i_buf < i_len + 3 || i_track > UINT_MAX )
+        return false;
+
+    p_sblock->i_track          = i_track;
+    p_sblock->i_local_timecode = (int16_t)GetWBE( &p_buf[i_len] );
+
+    const uint8_t i_flags = p_buf[i_len + 2];
+    p_sblock->b_keyframe    = i_flags & 0x80;
+    p_sblock->b_discardable = i_flags & 0x01;
+
+    size_t i_pos = i_len + 3;
+
+    if( ( i_flags & 0x06 ) == 0x00 ) /* no lacing */
+    {
+        p_sblock->i_frames = 1;
+        p_sblock->pi_frame_offset[0] = i_pos;
+        p_sblock->pi_frame_size[0] = i_buf - i_pos;
+        return true;
+    }
+
+    if( i_pos >= i_buf )
+        return false;
+    const unsigned i_frames = p_buf[i_pos++] + 1;
+    size_t *pi_size = p_sblock->pi_frame_size;
+    size_t i_laced = 0;
+
+    switch( i_flags & 0x06 )
+    {
+        case 0x02: /* Xiph */
+            for( unsigned i = 0; i < i_frames - 1; i++ )
+            {
+                pi_size[i] = 0;
+                do
+                {
+                    if( i_pos >= i_buf )
+                        return false;
+                    pi_size[i] += p_buf[i_pos];
+                } while( p_buf[i_pos++] == 0xff );
+                i_laced += pi_size[i];
+            }
+            break;
+
+        case 0x04: /* fixed */
+            if( ( i_buf - i_pos ) % i_frames )
+                return false;
+            for( unsigned i = 0; i < i_frames - 1; i++ )
+                pi_size[i] = ( i_buf - i_pos ) / i_frames;
+            i_laced = ( i_buf - i_pos ) / i_frames * ( i_frames - 1 );
+            break;
+
+        case 0x06: /* EBML */
+        {
+            uint64_t i_value;
+            int64_t i_size = 0;
+            for( unsigned i = 0; i < i_frames - 1; i++ )
+            {
+                i_len = ReadVint( &p_buf[i_pos], i_buf - i_pos, &i_value );
+                if( i_len == 0 )
+                    return false;
+                i_pos += i_len;
+
+                if( i == 0 )
+                    i_size = i_value;
+                else /* signed difference with the previous frame */
+                    i_size += (int64_t)i_value - ( ( INT64_C(1) << ( 7 * i_len - 1 ) ) - 1 );
+
+                if( i_size < 0 || (uint64_t)i_size > i_buf )
+                    return false;
+                pi_size[i] = i_size;
+                i_laced += i_size;
+            }
+            break;
+        }
+    }
+
+    if( i_pos > i_buf || i_laced > i_buf - i_pos )
+        return false;
+    pi_size[i_frames - 1] = i_buf - i_pos - i_laced;
+
+    for( unsigned i = 0; i < i_frames; i++ )
+    {
+        p_sblock->pi_frame_offset[i] = i_pos;
+        i_pos += pi_size[i];
+    }
+    p_sblock->i_frames = i_frames;
+    return true;
+}
+
+bool EbmlParser::GetSimpleBlock( mkv_simpleblock_t *p_sblock )
+{
+    if( mi_user_level != mi_level || m_got || mi_level < 1 )
+        return false;
+
+    vlc_stream_io_callback *io_callback = dynamic_cast<vlc_stream_io_callback *>(&m_es->I_O());
+    if( io_callback == NULL || io_callback->IsEOF() )
+        return false;
+    stream_t *s = io_callback->GetStream();
+
+    EbmlElement *p_prev = m_el[mi_level];
+    EbmlElement *p_parent = m_el[mi_level - 1];
+    if( p_prev )
+    {
+        if( !p_prev->IsFiniteSize() )
+            return false;
+        p_prev->SkipData( *m_es, EBML_CONTEXT(p_prev) );
+    }
+
+    /* SimpleBlock ID (0xA3) followed by its coded size */
+    const uint8_t *p_peek;
+    ssize_t i_peek = vlc_stream_Peek( s, &p_peek, 9 );
+    if( i_peek < 2 || p_peek[0] != 0xA3 )
+        return false;
+
+    uint64_t i_size;
+    size_t i_len = ReadVint( &p_peek[1], i_peek - 1, &i_size );
+    if( i_len == 0 || i_size == ( UINT64_C(1) << ( 7 * i_len ) ) - 1 /* unknown size */ ||
+        i_size < 4 || i_size > SIZE_MAX - 1 - i_len )
+        return false;
+
+    const uint64_t i_position = vlc_stream_Tell( s );
+    const size_t i_element = 1 + i_len + i_size;
+    if( p_parent->IsFiniteSize() &&
+        ( i_position < p_parent->GetDataStart() ||
+          i_position + i_element > p_parent->GetEndPosition() ) )
+        return false;
+
+    block_t *p_data = vlc_stream_Block( s, i_element );
+    if( p_data == NULL || p_data->i_buffer != i_element )
+    {
+        if( p_data )
+            block_Release( p_data );
+        io_callback->setFilePointer( i_position );
+        return false;
+    }
+    p_data->p_buffer += 1 + i_len;
+    p_data->i_buffer -= 1 + i_len;
+
+    /* the previous element is done, the next Get() resumes from here */
+    if( p_prev && !mb_keep )
+        delete p_prev;
+    mb_keep = false;
+    m_el[mi_level] = NULL;
+    mb_fast_read = true;
+
+    p_sblock->reset();
+    p_sblock->p_data = p_data;
+    p_sblock->i_position = i_position;
+    if( !ParseSimpleBlock( p_sblock ) )
+    {
+        msg_Warn( p_demux, "MKV/Ebml Parser: invalid SimpleBlock at %" PRIu64 "... skipping it",
+                  i_position );
+        p_sblock->reset();
+    }
+    return true;
+}
+
 bool EbmlParser::IsTopPresent( EbmlElement *el ) const
 {
     for( int i = 0; i < mi_level; i++ )
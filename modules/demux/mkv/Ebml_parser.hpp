@@ -43,6 +43,10 @@ class EbmlParser
     void Down( void );
     void Reset( demux_t *p_demux );
     EbmlElement *Get( bool allow_overshoot = true );
+    /* Cluster level fast path: read the next element if it is a
+     * SimpleBlock, without allocating a libebml element. Returns false
+     * if the element must go through Get() instead. */
+    bool        GetSimpleBlock( mkv_simpleblock_t * );
     void        Keep( void );
     void        Unkeep( void );
 
@@ -65,6 +69,8 @@ class EbmlParser
     bool         mb_keep;
     /* Allow dummy/unknown EBML elements */
     bool         mb_dummy;
+    /* Children were read by GetSimpleBlock() since the last Get() */
+    bool         mb_fast_read;
 };
 
 } // namespace
@@ -915,6 +915,16 @@ mkv_track_t * matroska_segment_c::FindTrackByBlock(
     return track_it->second.get();
 }
 
+mkv_track_t * matroska_segment_c::FindTrackByBlock( const mkv_simpleblock_t & sblock )
+{
+    tracks_map_t::iterator track_it = tracks.find( sblock.i_track );
+
+    if (track_it == tracks.end())
+        return NULL;
+
+    return track_it->second.get();
+}
+
 void matroska_segment_c::ComputeTrackPriority()
 {
     bool b_has_default_video = false;
@@ -1166,10 +1176,12 @@ void matroska_segment_c::ESDestroy( )
     }
 }
 
-int matroska_segment_c::BlockGet( KaxBlock * & pp_block, KaxSimpleBlock * & pp_simpleblock, bool *pb_key_picture, bool *pb_discardable_picture, int64_t *pi_duration )
+int matroska_segment_c::BlockGet( KaxBlock * & pp_block, KaxSimpleBlock * & pp_simpleblock, mkv_simpleblock_t *p_sblock, bool *pb_key_picture, bool *pb_discardable_picture, int64_t *pi_duration )
 {
     pp_simpleblock = NULL;
     pp_block = NULL;
+    if( p_sblock != NULL )
+        p_sblock->reset();
 
     *pb_key_picture         = true;
     *pb_discardable_picture = false;
@@ -1327,6 +1339,30 @@ int matroska_segment_c::BlockGet( KaxBlock * & pp_block, KaxSimpleBlock * & pp_s
         EbmlElement *el = NULL;
         int         i_level;
 
+        /* SimpleBlocks of the current cluster don't need libebml */
+        if( p_sblock != NULL && cluster != NULL && payload.b_cluster_timecode &&
+            pp_block == NULL && ep.GetLevel() == 2 && ep.IsTopPresent( cluster ) &&
+            ep.GetSimpleBlock( p_sblock ) )
+        {
+            if( p_sblock->p_data == NULL )
+                continue;
+
+            if( FindTrackByBlock( *p_sblock ) == NULL )
+            {
+                p_sblock->reset();
+                continue;
+            }
+
+            p_sblock->i_global_timecode = cluster->GetBlockGlobalTimecode( p_sblock->i_local_timecode );
+            if( p_sblock->b_keyframe )
+                _seeker.add_seekpoint( p_sblock->i_track,
+                    SegmentSeeker::Seekpoint( p_sblock->i_position, VLC_TICK_FROM_NS(p_sblock->i_global_timecode) ) );
+
+            *pb_key_picture         = p_sblock->b_keyframe;
+            *pb_discardable_picture = p_sblock->b_discardable;
+            return VLC_SUCCESS;
+        }
+
         if( pp_simpleblock != NULL || ((el = ep.Get()) == NULL && pp_block != NULL) )
         {
             /* Check blocks validity to protect againts broken files */
@@ -145,9 +145,10 @@ public:
 
     bool Seek( demux_t &, vlc_tick_t i_mk_date, vlc_tick_t i_mk_time_offset, bool b_accurate );
 
-    int BlockGet( KaxBlock * &, KaxSimpleBlock * &, bool *, bool *, int64_t *);
+    int BlockGet( KaxBlock * &, KaxSimpleBlock * &, mkv_simpleblock_t *, bool *, bool *, int64_t *);
 
     mkv_track_t * FindTrackByBlock(const KaxBlock *, const KaxSimpleBlock * );
+    mkv_track_t * FindTrackByBlock(const mkv_simpleblock_t & );
 
     bool ESCreate( );
     void ESDestroy( );
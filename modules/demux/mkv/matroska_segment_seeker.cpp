@@ -349,24 +349,35 @@ SegmentSeeker::index_unsearched_range( matroska_segment_c& ms, Range search_area
     {
         KaxBlock * block;
         KaxSimpleBlock * simpleblock;
+        mkv_simpleblock_t sblock;
 
         bool     b_key_picture;
         bool     b_discardable_picture;
         int64_t  i_block_duration;
         track_id_t track_id;
+        bool     b_valid_track;
 
-        if( ms.BlockGet( block, simpleblock, &b_key_picture, &b_discardable_picture, &i_block_duration ) )
+        if( ms.BlockGet( block, simpleblock, &sblock, &b_key_picture, &b_discardable_picture, &i_block_duration ) )
             break;
 
-        KaxInternalBlock& internal_block = simpleblock
-            ? static_cast<KaxInternalBlock&>( *simpleblock )
-            : static_cast<KaxInternalBlock&>( *block );
-
-        block_pos = internal_block.GetElementPosition();
-        block_pts = VLC_TICK_FROM_NS(internal_block.GlobalTimecode());
-        track_id  = internal_block.TrackNum();
-
-        bool const b_valid_track = ms.FindTrackByBlock( block, simpleblock ) != NULL;
+        if( sblock.p_data != NULL )
+        {
+            block_pos = sblock.i_position;
+            block_pts = VLC_TICK_FROM_NS(sblock.i_global_timecode);
+            track_id  = sblock.i_track;
+            b_valid_track = ms.FindTrackByBlock( sblock ) != NULL;
+        }
+        else
+        {
+            KaxInternalBlock& internal_block = simpleblock
+                ? static_cast<KaxInternalBlock&>( *simpleblock )
+                : static_cast<KaxInternalBlock&>( *block );
+
+            block_pos = internal_block.GetElementPosition();
+            block_pts = VLC_TICK_FROM_NS(internal_block.GlobalTimecode());
+            track_id  = internal_block.TrackNum();
+            b_valid_track = ms.FindTrackByBlock( block, simpleblock ) != NULL;
+        }
 
         delete block;
 
@@ -509,21 +509,81 @@ static int Seek( demux_t *p_demux, vlc_tick_t i_mk_date, double f_percent, virtu
     return p_vsegment->Seek( *p_demux, i_mk_date, p_vchapter, b_precise ) ? VLC_SUCCESS : VLC_EGENERIC;
 }
 
-/* Needed by matroska_segment::Seek() and Seek */
-void BlockDecode( demux_t *p_demux, KaxBlock *block, KaxSimpleBlock *simpleblock,
-                  vlc_tick_t i_pts, int64_t i_duration, bool b_key_picture,
-                  bool b_discardable_picture )
+/* Frames of a libebml (Simple)Block */
+class InternalBlockFrames
 {
-    demux_sys_t *p_sys = (demux_sys_t *)p_demux->p_sys;
-    matroska_segment_c *p_segment = p_sys->p_current_vsegment->CurrentSegment();
+public:
+    InternalBlockFrames( KaxInternalBlock & block )
+        :internal_block( block )
+        ,frame_size( 0 )
+        ,block_size( block.GetSize() )
+    {}
 
-    KaxInternalBlock& internal_block = simpleblock
-        ? static_cast<KaxInternalBlock&>( *simpleblock )
-        : static_cast<KaxInternalBlock&>( *block );
+    unsigned int count() const { return internal_block.NumberFrames(); }
 
-    if( !p_segment ) return;
+    bool get( unsigned int i_frame, uint8_t **pp_data, size_t *pi_data )
+    {
+        DataBuffer *data = &internal_block.GetBuffer(i_frame);
+
+        frame_size += data->Size();
+        if( !data->Buffer() || data->Size() > frame_size || frame_size > block_size  )
+            return false;
+
+        *pp_data = data->Buffer();
+        *pi_data = data->Size();
+        return true;
+    }
+
+    block_t *take( unsigned int ) { return NULL; }
+
+private:
+    KaxInternalBlock & internal_block;
+    size_t frame_size;
+    size_t block_size;
+};
+
+/* Frames of a SimpleBlock read by the cluster fast path */
+class SimpleBlockFrames
+{
+public:
+    SimpleBlockFrames( mkv_simpleblock_t & sblock ) :sblock( sblock ) {}
+
+    unsigned int count() const { return sblock.i_frames; }
+
+    bool get( unsigned int i_frame, uint8_t **pp_data, size_t *pi_data )
+    {
+        if( sblock.p_data == NULL )
+            return false;
+        *pp_data = sblock.p_data->p_buffer + sblock.pi_frame_offset[i_frame];
+        *pi_data = sblock.pi_frame_size[i_frame];
+        return true;
+    }
+
+    /* the last frame can use the element payload directly */
+    block_t *take( unsigned int i_frame )
+    {
+        if( i_frame + 1 != sblock.i_frames || sblock.p_data == NULL )
+            return NULL;
+
+        block_t *p_block = sblock.p_data;
+        sblock.p_data = NULL;
+        p_block->p_buffer += sblock.pi_frame_offset[i_frame];
+        p_block->i_buffer  = sblock.pi_frame_size[i_frame];
+        return p_block;
+    }
+
+private:
+    mkv_simpleblock_t & sblock;
+};
+
+template<class Frames>
+static void BlockDecodeFrames( demux_t *p_demux, matroska_segment_c *p_segment,
+                               mkv_track_t *p_track, Frames & frames,
+                               vlc_tick_t i_pts, int64_t i_duration, bool b_key_picture,
+                               bool b_discardable_picture )
+{
+    demux_sys_t *p_sys = (demux_sys_t *)p_demux->p_sys;
 
-    mkv_track_t *p_track = p_segment->FindTrackByBlock( block, simpleblock );
     if( p_track == NULL )
     {
         msg_Err( p_demux, "invalid track number" );
@@ -553,17 +613,15 @@ void BlockDecode( demux_t *p_demux, KaxBlock *block, KaxSimpleBlock *simpleblock
         }
     }
 
-    size_t frame_size = 0;
-    size_t block_size = internal_block.GetSize();
-    const unsigned i_number_frames = internal_block.NumberFrames();
+    const unsigned i_number_frames = frames.count();
 
     for( unsigned int i_frame = 0; i_frame < i_number_frames; i_frame++ )
     {
         block_t *p_block;
-        DataBuffer *data = &internal_block.GetBuffer(i_frame);
+        uint8_t *p_data;
+        size_t   i_data;
 
-        frame_size += data->Size();
-        if( !data->Buffer() || data->Size() > frame_size || frame_size > block_size  )
+        if( !frames.get( i_frame, &p_data, &i_data ) )
         {
             msg_Warn( p_demux, "Cannot read frame (too long or no frame)" );
             break;
@@ -573,11 +631,15 @@ void BlockDecode( demux_t *p_demux, KaxBlock *block, KaxSimpleBlock *simpleblock
         if( track.i_compression_type == MATROSKA_COMPRESSION_HEADER &&
             track.p_compression_data != NULL &&
             track.i_encoding_scope & MATROSKA_ENCODING_SCOPE_ALL_FRAMES )
-            p_block = MemToBlock( data->Buffer(), data->Size(), track.p_compression_data->GetSize() + extra_data );
+            p_block = MemToBlock( p_data, i_data, track.p_compression_data->GetSize() + extra_data );
         else if( unlikely( track.fmt.i_codec == VLC_CODEC_WAVPACK ) )
-            p_block = packetize_wavpack( track, data->Buffer(), data->Size() );
+            p_block = packetize_wavpack( track, p_data, i_data );
         else
-            p_block = MemToBlock( data->Buffer(), data->Size(), extra_data );
+        {
+            p_block = extra_data == 0 ? frames.take( i_frame ) : NULL;
+            if( p_block == NULL )
+                p_block = MemToBlock( p_data, i_data, extra_data );
+        }
 
         if( p_block == NULL )
         {
@@ -705,6 +767,39 @@ void BlockDecode( demux_t *p_demux, KaxBlock *block, KaxSimpleBlock *simpleblock
     }
 }
 
+/* Needed by matroska_segment::Seek() and Seek */
+void BlockDecode( demux_t *p_demux, KaxBlock *block, KaxSimpleBlock *simpleblock,
+                  vlc_tick_t i_pts, int64_t i_duration, bool b_key_picture,
+                  bool b_discardable_picture )
+{
+    demux_sys_t *p_sys = (demux_sys_t *)p_demux->p_sys;
+    matroska_segment_c *p_segment = p_sys->p_current_vsegment->CurrentSegment();
+
+    KaxInternalBlock& internal_block = simpleblock
+        ? static_cast<KaxInternalBlock&>( *simpleblock )
+        : static_cast<KaxInternalBlock&>( *block );
+
+    if( !p_segment ) return;
+
+    InternalBlockFrames frames( internal_block );
+    BlockDecodeFrames( p_demux, p_segment, p_segment->FindTrackByBlock( block, simpleblock ),
+                       frames, i_pts, i_duration, b_key_picture, b_discardable_picture );
+}
+
+void BlockDecode( demux_t *p_demux, mkv_simpleblock_t &sblock,
+                  vlc_tick_t i_pts, int64_t i_duration, bool b_key_picture,
+                  bool b_discardable_picture )
+{
+    demux_sys_t *p_sys = (demux_sys_t *)p_demux->p_sys;
+    matroska_segment_c *p_segment = p_sys->p_current_vsegment->CurrentSegment();
+
+    if( !p_segment ) return;
+
+    SimpleBlockFrames frames( sblock );
+    BlockDecodeFrames( p_demux, p_segment, p_segment->FindTrackByBlock( sblock ),
+                       frames, i_pts, i_duration, b_key_picture, b_discardable_picture );
+}
+
 /*****************************************************************************
  * Demux: reads and demuxes data packets
  *****************************************************************************
@@ -731,11 +826,12 @@ static int Demux( demux_t *p_demux)
 
     KaxBlock *block;
     KaxSimpleBlock *simpleblock;
+    mkv_simpleblock_t sblock;
     int64_t i_block_duration = 0;
     bool b_key_picture;
     bool b_discardable_picture;
 
-    if( p_segment->BlockGet( block, simpleblock, &b_key_picture, &b_discardable_picture, &i_block_duration ) )
+    if( p_segment->BlockGet( block, simpleblock, &sblock, &b_key_picture, &b_discardable_picture, &i_block_duration ) )
     {
         if ( p_vsegment->CurrentEdition() && p_vsegment->CurrentEdition()->b_ordered )
         {
@@ -756,12 +852,28 @@ static int Demux( demux_t *p_demux)
         return VLC_DEMUXER_EOF;
     }
 
-    KaxInternalBlock& internal_block = block
-        ? static_cast<KaxInternalBlock&>( *block )
-        : static_cast<KaxInternalBlock&>( *simpleblock );
+    uint64_t i_block_fpos;
+    int64_t  i_block_timecode;
+
+    if( sblock.p_data != NULL )
+    {
+        i_block_fpos     = sblock.i_position;
+        i_block_timecode = sblock.i_global_timecode;
+    }
+    else
+    {
+        KaxInternalBlock& internal_block = block
+            ? static_cast<KaxInternalBlock&>( *block )
+            : static_cast<KaxInternalBlock&>( *simpleblock );
+
+        i_block_fpos     = internal_block.GetElementPosition();
+        i_block_timecode = internal_block.GlobalTimecode();
+    }
 
     {
-        mkv_track_t *p_track = p_segment->FindTrackByBlock( block, simpleblock );
+        mkv_track_t *p_track = sblock.p_data != NULL
+                             ? p_segment->FindTrackByBlock( sblock )
+                             : p_segment->FindTrackByBlock( block, simpleblock );
 
         if( p_track == NULL )
         {
@@ -775,9 +887,7 @@ static int Demux( demux_t *p_demux)
 
         if( track.i_skip_until_fpos != std::numeric_limits<uint64_t>::max() ) {
 
-            uint64_t block_fpos = internal_block.GetElementPosition();
-
-            if ( track.i_skip_until_fpos > block_fpos )
+            if ( track.i_skip_until_fpos > i_block_fpos )
             {
                 delete block;
                 return VLC_DEMUXER_SUCCESS; // this block shall be ignored
@@ -822,7 +932,7 @@ static int Demux( demux_t *p_demux)
     /* set pts */
     {
         p_sys->i_pts = p_sys->i_mk_chapter_time + VLC_TICK_0;
-        p_sys->i_pts += VLC_TICK_FROM_NS(internal_block.GlobalTimecode());
+        p_sys->i_pts += VLC_TICK_FROM_NS(i_block_timecode);
     }
 
     if ( p_vsegment->CurrentEdition() &&
@@ -834,7 +944,10 @@ static int Demux( demux_t *p_demux)
         return VLC_DEMUXER_EOF;
     }
 
-    BlockDecode( p_demux, block, simpleblock, p_sys->i_pts, i_block_duration, b_key_picture, b_discardable_picture );
+    if( sblock.p_data != NULL )
+        BlockDecode( p_demux, sblock, p_sys->i_pts, i_block_duration, b_key_picture, b_discardable_picture );
+    else
+        BlockDecode( p_demux, block, simpleblock, p_sys->i_pts, i_block_duration, b_key_picture, b_discardable_picture );
 
     delete block;
 
@@ -118,9 +118,42 @@ enum
 
 using namespace LIBMATROSKA_NAMESPACE;
 
+#define MKV_MAX_LACED_FRAMES 256
+
+/* SimpleBlock read by the cluster fast path (EbmlParser::GetSimpleBlock)
+ * without allocating a libebml element: the element payload is kept in a
+ * single block_t and the (laced) frames are referenced inside it */
+struct mkv_simpleblock_t
+{
+    mkv_simpleblock_t() : p_data( NULL ) {}
+    ~mkv_simpleblock_t() { reset(); }
+
+    void reset()
+    {
+        if( p_data != NULL )
+            block_Release( p_data );
+        p_data = NULL;
+    }
+
+    block_t      *p_data;
+    uint64_t     i_position;        /* file position of the element */
+    unsigned int i_track;
+    int16_t      i_local_timecode;  /* relative to the cluster timecode */
+    int64_t      i_global_timecode; /* set by BlockGet(), in ns */
+    bool         b_keyframe;
+    bool         b_discardable;
+
+    unsigned int i_frames;
+    size_t       pi_frame_offset[MKV_MAX_LACED_FRAMES];
+    size_t       pi_frame_size[MKV_MAX_LACED_FRAMES];
+};
+
 void BlockDecode( demux_t *p_demux, KaxBlock *block, KaxSimpleBlock *simpleblock,
                   vlc_tick_t i_pts, vlc_tick_t i_duration, bool b_key_picture,
                   bool b_discardable_picture );
+void BlockDecode( demux_t *p_demux, mkv_simpleblock_t &sblock,
+                  vlc_tick_t i_pts, vlc_tick_t i_duration, bool b_key_picture,
+                  bool b_discardable_picture );
 
 class attachment_c
 {
@@ -56,6 +56,7 @@ class vlc_stream_io_callback: public IOCallback
     }
 
     bool IsEOF() const { return mb_eof; }
+    stream_t *GetStream() const { return s; }
 
     virtual uint32   read            ( void *p_buffer, size_t i_size);
     virtual void     setFilePointer  ( int64_t i_offset, seek_mode mode = seek_beginning );
@@ -36,11 +36,14 @@
 #include <vlc_codecs.h>
 #include <vlc_input.h>
 
+#include <limits.h>
+
 #include "../../packetizer/a52.h"
 #include "../../packetizer/dts_header.h"
 #include "../meta_engine/ID3Tag.h"
 #include "../meta_engine/ID3Text.h"
 #include "../meta_engine/ID3Meta.h"
+#include "seekindex.h"
 
 /*****************************************************************************
  * Module descriptor
@@ -53,6 +56,11 @@ static void Close    ( vlc_object_t * );
 #define FPS_LONGTEXT N_("This is the frame rate used as a fallback when " \
     "playing MPEG video elementary streams.")
 
+#define INDEX_TEXT N_("Index frames")
+#define INDEX_LONGTEXT N_("Scan local variable bitrate MPEG audio and AAC " \
+    "files without seek table in the background to build an index of " \
+    "their frames, making seeking and duration exact.")
+
 vlc_module_begin ()
     set_category( CAT_INPUT )
     set_subcategory( SUBCAT_INPUT_DEMUX )
@@ -67,6 +75,7 @@ vlc_module_begin ()
                   "eac3",
                   "dts",
                   "mlp", "thd" )
+    add_bool( "es-index", true, INDEX_TEXT, INDEX_LONGTEXT, true )
 
     add_submodule()
     set_description( N_("MPEG-4 video" ) )
@@ -146,6 +155,7 @@ typedef struct
     bool        b_big_endian;
     bool        b_estimate_bitrate;
     int         i_bitrate_avg;  /* extracted from Xing header */
+    bool        b_cbr;          /* seeking from the bitrate is exact */
 
     bool b_initial_sync_failed;
 
@@ -171,14 +181,31 @@ typedef struct
     float rgf_replay_peak[AUDIO_REPLAY_GAIN_MAX];
 
     sync_table_t mllt;
+
+    /* Xing or VBRI table, offsets at regular time intervals */
+    struct
+    {
+        uint64_t  *pi_pos;
+        unsigned   i_count;
+        vlc_tick_t i_step;
+    } toc;
+
     struct
     {
         size_t i_count;
         size_t i_current;
         chap_entry_t *p_entry;
     } chapters;
+
+    seekindex_t *p_index;
 } demux_sys_t;
 
+typedef struct
+{
+    vlc_fourcc_t i_codec;
+    uint64_t     i_stream_offset;
+} es_index_cfg_t;
+
 static int MpgaProbe( demux_t *p_demux, uint64_t *pi_offset );
 static int MpgaInit( demux_t *p_demux );
 
@@ -198,6 +225,8 @@ static int MlpInit( demux_t *p_demux );
 
 static bool Parse( demux_t *p_demux, block_t **pp_output );
 static uint64_t SeekByMlltTable( demux_t *p_demux, vlc_tick_t *pi_time );
+static uint64_t SeekByToc( demux_t *p_demux, vlc_tick_t *pi_time );
+static int IndexScan( seekindex_t *, stream_t *, const void * );
 
 static const codec_t p_codecs[] = {
     { VLC_CODEC_MP4A, false, "mp4 audio",  AacProbe,  AacInit },
@@ -261,6 +290,7 @@ static int OpenCommon( demux_t *p_demux,
     p_sys->p_packetizer = demux_PacketizerNew( p_demux, &fmt, p_sys->codec.psz_name );
     if( !p_sys->p_packetizer )
     {
+        free( p_sys->toc.pi_pos );
         free( p_sys );
         return VLC_EGENERIC;
     }
@@ -288,6 +318,28 @@ static int OpenCommon( demux_t *p_demux,
             break;
     }
 
+    /* Only scan when the file doesn't tell where its frames are */
+    if( i_cat == AUDIO_ES && !p_sys->b_cbr && !p_sys->mllt.p_bits &&
+        !p_sys->toc.i_count && var_InheritBool( p_demux, "es-index" ) )
+    {
+        switch( p_sys->codec.i_codec )
+        {
+            case VLC_CODEC_MPGA:
+            case VLC_CODEC_MP4A:
+            {
+                const es_index_cfg_t cfg = {
+                    .i_codec = p_sys->codec.i_codec,
+                    .i_stream_offset = p_sys->i_stream_offset,
+                };
+                p_sys->p_index = seekindex_Open( p_demux, "es", IndexScan,
+                                                 &cfg, sizeof(cfg) );
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
     return VLC_SUCCESS;
 }
 static int OpenAudio( vlc_object_t *p_this )
@@ -420,6 +472,9 @@ static void Close( vlc_object_t * p_this )
     TAB_CLEAN( p_sys->chapters.i_count, p_sys->chapters.p_entry );
     if( p_sys->mllt.p_bits )
         free( p_sys->mllt.p_bits );
+    free( p_sys->toc.pi_pos );
+    if( p_sys->p_index )
+        seekindex_Release( p_sys->p_index );
     demux_PacketizerDestroy( p_sys->p_packetizer );
     free( p_sys );
 }
@@ -467,6 +522,12 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
             va_list ap;
             int i_ret;
 
+            if( p_sys->p_index && seekindex_IsReady( p_sys->p_index ) )
+            {
+                *va_arg( args, vlc_tick_t * ) = seekindex_GetLength( p_sys->p_index );
+                return VLC_SUCCESS;
+            }
+
             va_copy ( ap, args );
             i_ret = demux_vaControlHelper( p_demux->s, p_sys->i_stream_offset,
                                     -1, p_sys->i_bitrate_avg, 1, i_query, ap );
@@ -494,12 +555,27 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
         }
 
         case DEMUX_SET_TIME:
+            if( p_sys->p_index && seekindex_IsReady( p_sys->p_index ) )
+            {
+                seekindex_entry_t entry;
+                if( seekindex_Lookup( p_sys->p_index, va_arg(args, vlc_tick_t),
+                                      &entry ) != VLC_SUCCESS )
+                    return VLC_EGENERIC;
+                return MovetoTimePos( p_demux, entry.i_time,
+                                      entry.i_pos - p_sys->i_stream_offset );
+            }
             if( p_sys->mllt.p_bits )
             {
                 vlc_tick_t i_time = va_arg(args, vlc_tick_t);
                 uint64_t i_pos = SeekByMlltTable( p_demux, &i_time );
                 return MovetoTimePos( p_demux, i_time, i_pos );
             }
+            if( p_sys->toc.i_count )
+            {
+                vlc_tick_t i_time = va_arg(args, vlc_tick_t);
+                uint64_t i_pos = SeekByToc( p_demux, &i_time );
+                return MovetoTimePos( p_demux, i_time, i_pos );
+            }
             /* FIXME TODO: implement a high precision seek (with mp3 parsing)
              * needed for multi-input */
             break;
@@ -912,6 +988,47 @@ static int MpgaGetFrameSamples( uint32_t h )
     }
 }
 
+/* Returns the frame size, or 0 if unknown (free format) */
+static int MpgaGetFrameSize( uint32_t h, unsigned *pi_rate )
+{
+    static const uint16_t ppi_bitrate[2][3][15] =
+    {
+        { /* MPEG-1 */
+            { 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448 },
+            { 0, 32, 48, 56,  64,  80,  96, 112, 128, 160, 192, 224, 256, 320, 384 },
+            { 0, 32, 40, 48,  56,  64,  80,  96, 112, 128, 160, 192, 224, 256, 320 },
+        },
+        { /* MPEG-2 and 2.5 */
+            { 0, 32, 48, 56,  64,  80,  96, 112, 128, 144, 160, 176, 192, 224, 256 },
+            { 0,  8, 16, 24,  32,  40,  48,  56,  64,  80,  96, 112, 128, 144, 160 },
+            { 0,  8, 16, 24,  32,  40,  48,  56,  64,  80,  96, 112, 128, 144, 160 },
+        },
+    };
+    static const uint16_t pi_samplerate[3] = { 44100, 48000, 32000 };
+
+    const unsigned i_version = MPGA_VERSION( h );
+    const unsigned i_layer = 3 - ((h >> 17) & 0x03);
+    const unsigned i_bitrate = ppi_bitrate[i_version][i_layer][(h >> 12) & 0x0F];
+    const unsigned i_padding = (h >> 9) & 0x01;
+    unsigned i_rate = pi_samplerate[(h >> 10) & 0x03] >> i_version;
+    if( ((h >> 19) & 0x03) == 0 ) /* MPEG-2.5 */
+        i_rate >>= 1;
+
+    *pi_rate = i_rate;
+    if( i_bitrate == 0 )
+        return 0;
+
+    switch( i_layer )
+    {
+    case 0:
+        return ( 12000 * i_bitrate / i_rate + i_padding ) * 4;
+    case 1:
+        return 144000 * i_bitrate / i_rate + i_padding;
+    default:
+        return ( i_version ? 72000 : 144000 ) * i_bitrate / i_rate + i_padding;
+    }
+}
+
 static int MpgaProbe( demux_t *p_demux, uint64_t *pi_offset )
 {
     const uint16_t rgi_twocc[] = { WAVE_FORMAT_MPEG, WAVE_FORMAT_MPEGLAYER3, WAVE_FORMAT_UNKNOWN };
@@ -1037,6 +1154,17 @@ static uint64_t SeekByMlltTable( demux_t *p_demux, vlc_tick_t *pi_time )
     return p_cur->i_pos;
 }
 
+static uint64_t SeekByToc( demux_t *p_demux, vlc_tick_t *pi_time )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    unsigned i = *pi_time > 0 ? *pi_time / p_sys->toc.i_step : 0;
+
+    if( i >= p_sys->toc.i_count )
+        i = p_sys->toc.i_count - 1;
+    *pi_time = i * p_sys->toc.i_step;
+    return p_sys->toc.pi_pos[i];
+}
+
 static int ID3TAG_Parse_Handler( uint32_t i_tag, const uint8_t *p_payload, size_t i_payload, void *p_priv )
 {
     demux_t *p_demux = (demux_t *) p_priv;
@@ -1152,6 +1280,55 @@ static int ID3Parse( demux_t *p_demux,
     return VLC_SUCCESS;
 }
 
+/* Fraunhofer VBRI header, with a table of frame groups sizes */
+static void MpgaVbriParse( demux_t *p_demux, uint32_t header,
+                           const uint8_t *p_vbri, int i_vbri )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    const uint32_t i_bytes = GetDWBE( &p_vbri[10] );
+    const uint32_t i_frames = GetDWBE( &p_vbri[14] );
+    const unsigned i_entries = GetWBE( &p_vbri[18] );
+    const unsigned i_scale = GetWBE( &p_vbri[20] );
+    const unsigned i_entry_size = GetWBE( &p_vbri[22] );
+    const unsigned i_entry_frames = GetWBE( &p_vbri[24] );
+    unsigned i_rate;
+
+    MpgaGetFrameSize( header, &i_rate );
+    if( i_bytes == 0 || i_frames == 0 || i_frames > INT_MAX ||
+        i_bytes > INT_MAX || i_rate == 0 )
+        return;
+
+    p_sys->xing.i_frames = i_frames;
+    p_sys->xing.i_bytes = i_bytes;
+    p_sys->xing.i_frame_samples = MpgaGetFrameSamples( header );
+    msg_Dbg( p_demux, "vbri header present (%u bytes, %u frames, %u entries)",
+             i_bytes, i_frames, i_entries );
+
+    p_vbri += 26;
+    i_vbri -= 26;
+    if( i_entries == 0 || i_entry_frames == 0 || i_entry_size == 0 ||
+        i_entry_size > 4 || (unsigned)i_vbri < i_entries * i_entry_size )
+        return;
+
+    p_sys->toc.pi_pos = vlc_alloc( i_entries + 1, sizeof(uint64_t) );
+    if( !p_sys->toc.pi_pos )
+        return;
+    p_sys->toc.pi_pos[0] = 0;
+    for( unsigned i = 0; i < i_entries; i++ )
+    {
+        uint32_t i_size = 0;
+        for( unsigned j = 0; j < i_entry_size; j++ )
+            i_size = (i_size << 8) | *p_vbri++;
+        p_sys->toc.pi_pos[i + 1] = p_sys->toc.pi_pos[i] +
+                                   (uint64_t)i_size * i_scale;
+    }
+    p_sys->toc.i_count = i_entries + 1;
+    p_sys->toc.i_step = vlc_tick_from_samples( (uint64_t)i_entry_frames *
+                                               p_sys->xing.i_frame_samples,
+                                               i_rate );
+}
+
 static int MpgaInit( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
@@ -1183,10 +1360,22 @@ static int MpgaInit( demux_t *p_demux )
     else
         i_skip = MPGA_MODE( header ) != 3 ? 21 : 13;
 
-    if( i_skip + 8 >= i_xing || memcmp( &p_xing[i_skip], "Xing", 4 ) )
+    /* VBRI header, always after 32 bytes of side info */
+    if( i_xing >= 4 + 32 + 26 && !memcmp( &p_xing[4 + 32], "VBRI", 4 ) )
+    {
+        MpgaVbriParse( p_demux, header, &p_xing[4 + 32], i_xing - 4 - 32 );
+        return VLC_SUCCESS;
+    }
+
+    /* LAME writes Info instead of Xing in CBR files */
+    if( i_skip + 8 >= i_xing )
+        return VLC_SUCCESS;
+    p_sys->b_cbr = !memcmp( &p_xing[i_skip], "Info", 4 );
+    if( !p_sys->b_cbr && memcmp( &p_xing[i_skip], "Xing", 4 ) )
         return VLC_SUCCESS;
 
     const uint32_t i_flags = GetDWBE( &p_xing[i_skip+4] );
+    const uint8_t *p_toc = NULL;
 
     MpgaXingSkip( &p_xing, &i_xing, i_skip + 8 );
 
@@ -1194,8 +1383,12 @@ static int MpgaInit( demux_t *p_demux )
         p_sys->xing.i_frames = MpgaXingGetDWBE( &p_xing, &i_xing, 0 );
     if( i_flags&0x02 )
         p_sys->xing.i_bytes = MpgaXingGetDWBE( &p_xing, &i_xing, 0 );
-    if( i_flags&0x04 ) /* TODO Support XING TOC to improve seeking accuracy */
+    if( i_flags&0x04 )
+    {
+        if( i_xing >= 100 )
+            p_toc = p_xing;
         MpgaXingSkip( &p_xing, &i_xing, 100 );
+    }
     if( i_flags&0x08 )
     {
         /* FIXME: doesn't return the right bitrage average, at least
@@ -1212,6 +1405,27 @@ static int MpgaInit( demux_t *p_demux )
                  "(%d bytes, %d frames, %d samples/frame)",
                  p_sys->xing.i_bytes, p_sys->xing.i_frames,
                  p_sys->xing.i_frame_samples );
+
+        /* Offsets in 1/256 of the size, at each percent of the length */
+        unsigned i_rate;
+        MpgaGetFrameSize( header, &i_rate );
+        if( p_toc && !p_sys->b_cbr && i_rate > 0 &&
+            (p_sys->toc.pi_pos = vlc_alloc( 100, sizeof(uint64_t) )) )
+        {
+            for( unsigned i = 0; i < 100; i++ )
+                p_sys->toc.pi_pos[i] = (uint64_t)p_toc[i] *
+                                       p_sys->xing.i_bytes / 256;
+            p_sys->toc.i_count = 100;
+            p_sys->toc.i_step = vlc_tick_from_samples(
+                (uint64_t)p_sys->xing.i_frames * p_sys->xing.i_frame_samples,
+                i_rate ) / 100;
+            if( p_sys->toc.i_step == 0 )
+            {
+                free( p_sys->toc.pi_pos );
+                p_sys->toc.pi_pos = NULL;
+                p_sys->toc.i_count = 0;
+            }
+        }
     }
 
     if( i_xing >= 20 && memcmp( p_xing, "LAME", 4 ) == 0)
@@ -1286,6 +1500,12 @@ static int AacInit( demux_t *p_demux )
     p_sys->i_packet_size = 4096;
     p_sys->i_original = VLC_FOURCC('H','E','A','D');
 
+    /* ADTS signals VBR with a full buffer fullness */
+    const uint8_t *p_peek;
+    if( vlc_stream_Peek( p_demux->s, &p_peek, 7 ) == 7 &&
+        p_peek[0] == 0xFF && (p_peek[1] & 0xF6) == 0xF0 )
+        p_sys->b_cbr = ( ((p_peek[5] & 0x1F) << 6) | (p_peek[6] >> 2) ) != 0x7FF;
+
     return VLC_SUCCESS;
 }
 
@@ -1472,3 +1692,126 @@ static int VideoInit( demux_t *p_demux )
 
     return VLC_SUCCESS;
 }
+
+/*****************************************************************************
+ * Frames index
+ *****************************************************************************/
+#define INDEX_HEADER_SIZE 7
+#define INDEX_MAX_RESYNC  (64 * 1024)
+
+/* Returns the frame size, 0 if not a frame header,
+ * or -1 if the frame size can't be known */
+static int IndexFrameHeader( const es_index_cfg_t *cfg, const uint8_t *p_peek,
+                             unsigned *pi_samples, unsigned *pi_rate )
+{
+    switch( cfg->i_codec )
+    {
+        case VLC_CODEC_MPGA:
+        {
+            if( !MpgaCheckSync( p_peek ) )
+                return 0;
+            const uint32_t h = GetDWBE( p_peek );
+            *pi_samples = MpgaGetFrameSamples( h );
+            const int i_size = MpgaGetFrameSize( h, pi_rate );
+            return i_size > 0 ? i_size : -1;
+        }
+
+        case VLC_CODEC_MP4A:
+        {
+            static const unsigned pi_samplerate[12] = {
+                96000, 88200, 64000, 48000, 44100, 32000,
+                24000, 22050, 16000, 12000, 11025, 8000,
+            };
+            /* ADTS */
+            if( p_peek[0] != 0xFF || (p_peek[1] & 0xF6) != 0xF0 ||
+                ((p_peek[2] >> 2) & 0x0F) >= 12 )
+                return 0;
+            const int i_size = ((p_peek[3] & 0x03) << 11) | (p_peek[4] << 3) |
+                               (p_peek[5] >> 5);
+            if( i_size < 7 )
+                return 0;
+            *pi_rate = pi_samplerate[(p_peek[2] >> 2) & 0x0F];
+            *pi_samples = 1024 * ((p_peek[6] & 0x03) + 1);
+            return i_size;
+        }
+
+        default:
+            return 0;
+    }
+}
+
+static int IndexScan( seekindex_t *p_index, stream_t *s, const void *p_cfg )
+{
+    const es_index_cfg_t *cfg = p_cfg;
+    uint64_t i_pos = cfg->i_stream_offset;
+    unsigned i_resync = 0;
+    bool b_synced = false;
+    int i_ret = VLC_SUCCESS;
+    date_t date;
+
+    date_Init( &date, 1, 1 );
+    date_Set( &date, VLC_TICK_0 );
+
+    if( vlc_stream_Seek( s, i_pos ) != VLC_SUCCESS )
+        return VLC_EGENERIC;
+
+    while( !seekindex_Canceled( p_index ) )
+    {
+        const uint8_t *p_peek;
+        if( vlc_stream_Peek( s, &p_peek, INDEX_HEADER_SIZE ) < INDEX_HEADER_SIZE )
+            break;
+
+        unsigned i_samples = 0, i_rate = 0;
+        int i_size = IndexFrameHeader( cfg, p_peek, &i_samples, &i_rate );
+        if( i_size < 0 )
+        {
+            i_ret = VLC_EGENERIC;
+            break;
+        }
+
+        /* After a loss of sync, also check the next frame header */
+        if( i_size > 0 && i_rate > 0 && !b_synced )
+        {
+            unsigned i_dummy;
+            ssize_t i_peek = vlc_stream_Peek( s, &p_peek, i_size + INDEX_HEADER_SIZE );
+            if( i_peek == i_size ||
+                ( i_peek == i_size + INDEX_HEADER_SIZE &&
+                  IndexFrameHeader( cfg, &p_peek[i_size], &i_dummy, &i_dummy ) != 0 ) )
+                b_synced = true;
+        }
+
+        if( i_size <= 0 || i_rate == 0 || !b_synced )
+        {
+            /* Garbage or trailing tags */
+            b_synced = false;
+            if( ++i_resync > INDEX_MAX_RESYNC )
+            {
+                i_ret = VLC_EGENERIC;
+                break;
+            }
+            if( vlc_stream_Read( s, NULL, 1 ) != 1 )
+                break;
+            i_pos++;
+            continue;
+        }
+        i_resync = 0;
+
+        if( date.i_divider_num != i_rate )
+        {
+            const vlc_tick_t i_time = date_Get( &date );
+            date_Init( &date, i_rate, 1 );
+            date_Set( &date, i_time );
+        }
+
+        seekindex_Append( p_index, date_Get( &date ) - VLC_TICK_0, i_pos );
+
+        if( vlc_stream_Read( s, NULL, i_size ) != i_size )
+            break;
+        i_pos += i_size;
+        date_Increment( &date, i_samples );
+    }
+
+    seekindex_SetLength( p_index, date_Get( &date ) - VLC_TICK_0 );
+
+    return seekindex_Canceled( p_index ) ? VLC_EGENERIC : i_ret;
+}
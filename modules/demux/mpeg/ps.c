@@ -34,9 +34,9 @@
 
 #include "pes.h"
 #include "ps.h"
+#include "seekindex.h"
 
 /* TODO:
- *  - re-add pre-scanning.
  *  - ...
  */
 
@@ -45,6 +45,10 @@
     "to calculate position and duration. However sometimes this might not " \
     "be usable. Disable this option to calculate from the bitrate instead." )
 
+#define INDEX_TEXT N_("Index timestamps")
+#define INDEX_LONGTEXT N_("Scan local files in the background to build an " \
+    "index of their timestamps, making seeking and duration exact.")
+
 #define PS_PACKET_PROBE 3
 #define CDXA_HEADER_SIZE 44
 #define CDXA_SECTOR_SIZE 2352
@@ -69,6 +73,7 @@ vlc_module_begin ()
     add_bool( "ps-trust-timestamps", true, TIME_TEXT,
                  TIME_LONGTEXT, true )
         change_safe ()
+    add_bool( "ps-index", true, INDEX_TEXT, INDEX_LONGTEXT, true )
 
     add_submodule ()
     set_description( N_("MPEG-PS demuxer") )
@@ -113,13 +118,24 @@ typedef struct
     int         current_title;
     int         current_seekpoint;
     unsigned    updates;
+
+    seekindex_t *p_index;
+    vlc_tick_t  i_index_time; /* of the last pack, as in the index */
+    vlc_tick_t  i_index_scr;
 } demux_sys_t;
 
+typedef struct
+{
+    int         format;
+    uint64_t    i_start_byte;
+} ps_index_cfg_t;
+
 static int Demux  ( demux_t *p_demux );
 static int Control( demux_t *p_demux, int i_query, va_list args );
 
 static int      ps_pkt_resynch( stream_t *, int, bool );
 static block_t *ps_pkt_read   ( stream_t * );
+static int      IndexScan( seekindex_t *, stream_t *, const void * );
 
 /*****************************************************************************
  * Open
@@ -229,6 +245,9 @@ static int OpenCommon( vlc_object_t *p_this, bool b_force )
     p_sys->current_title = 0;
     p_sys->current_seekpoint = 0;
     p_sys->updates = 0;
+    p_sys->p_index = NULL;
+    p_sys->i_index_time = 0;
+    p_sys->i_index_scr = VLC_TICK_INVALID;
 
     vlc_stream_Control( p_demux->s, STREAM_CAN_SEEK, &p_sys->b_seekable );
 
@@ -237,6 +256,16 @@ static int OpenCommon( vlc_object_t *p_this, bool b_force )
 
     /* TODO prescanning of ES */
 
+    if( p_sys->b_seekable && var_InheritBool( p_demux, "ps-index" ) &&
+        var_InheritBool( p_demux, "ps-trust-timestamps" ) )
+    {
+        const ps_index_cfg_t cfg = {
+            .format = format,
+            .i_start_byte = i_skip,
+        };
+        p_sys->p_index = seekindex_Open( p_demux, "ps", IndexScan, &cfg, sizeof(cfg) );
+    }
+
     return VLC_SUCCESS;
 }
 
@@ -271,6 +300,9 @@ static void Close( vlc_object_t *p_this )
 
     ps_psm_destroy( &p_sys->psm );
 
+    if( p_sys->p_index )
+        seekindex_Release( p_sys->p_index );
+
     free( p_sys );
 }
 
@@ -398,6 +430,26 @@ static void NotifyDiscontinuity( ps_track_t *p_tk, es_out_t *out )
     }
 }
 
+/* Follows the pack SCRs the way the index scan does, so that the time
+ * matches the index one, discontinuities included */
+static void IndexSCR( demux_sys_t *p_sys, vlc_tick_t i_scr )
+{
+    if( p_sys->i_index_time == VLC_TICK_INVALID )
+        return;
+    if( p_sys->i_index_scr != VLC_TICK_INVALID &&
+        i_scr >= p_sys->i_index_scr &&
+        i_scr - p_sys->i_index_scr <= VLC_TICK_FROM_SEC(1) )
+        p_sys->i_index_time += i_scr - p_sys->i_index_scr;
+    p_sys->i_index_scr = i_scr;
+}
+
+/* Restarts following the SCRs after a seek, from the closest index entry */
+static void IndexSeeked( demux_sys_t *p_sys, vlc_tick_t i_time )
+{
+    p_sys->i_index_time = i_time;
+    p_sys->i_index_scr = VLC_TICK_INVALID;
+}
+
 static void CheckPCR( demux_sys_t *p_sys, es_out_t *out, vlc_tick_t i_scr )
 {
     if( p_sys->i_scr != VLC_TICK_INVALID &&
@@ -466,6 +518,8 @@ static int Demux( demux_t *p_demux )
                 p_sys->i_first_scr = p_sys->i_pack_scr;
             CheckPCR( p_sys, p_demux->out, p_sys->i_pack_scr );
             p_sys->i_scr = p_sys->i_pack_scr;
+            if( p_sys->p_index )
+                IndexSCR( p_sys, p_sys->i_pack_scr );
             p_sys->i_lastpack_byte = vlc_stream_Tell( p_demux->s );
             if( !p_sys->b_have_pack ) p_sys->b_have_pack = true;
             /* done later on to work around bad vcd/svcd streams */
@@ -722,12 +776,28 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
             i_ret = vlc_stream_Seek( p_demux->s, i64 );
             if( i_ret == VLC_SUCCESS )
             {
+                if( p_sys->p_index )
+                {
+                    seekindex_entry_t entry;
+                    if( seekindex_IsReady( p_sys->p_index ) &&
+                        seekindex_LookupPos( p_sys->p_index, i64, &entry ) == VLC_SUCCESS )
+                        IndexSeeked( p_sys, entry.i_time );
+                    else
+                        IndexSeeked( p_sys, VLC_TICK_INVALID );
+                }
                 NotifyDiscontinuity( p_sys->tk, p_demux->out );
                 return i_ret;
             }
             break;
 
         case DEMUX_GET_TIME:
+            if( p_sys->p_index && seekindex_IsReady( p_sys->p_index ) &&
+                p_sys->i_index_time != VLC_TICK_INVALID &&
+                p_sys->i_index_scr != VLC_TICK_INVALID )
+            {
+                *va_arg( args, vlc_tick_t * ) = p_sys->i_index_time;
+                return VLC_SUCCESS;
+            }
             if( p_sys->i_time_track_index >= 0 && p_sys->i_current_pts != VLC_TICK_INVALID )
             {
                 *va_arg( args, vlc_tick_t * ) = p_sys->i_current_pts - p_sys->tk[p_sys->i_time_track_index].i_first_pts;
@@ -749,7 +819,12 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
             break;
 
         case DEMUX_GET_LENGTH:
-            if( p_sys->i_length > VLC_TICK_0 )
+            if( p_sys->p_index && seekindex_IsReady( p_sys->p_index ) )
+            {
+                *va_arg( args, vlc_tick_t * ) = seekindex_GetLength( p_sys->p_index );
+                return VLC_SUCCESS;
+            }
+            else if( p_sys->i_length > VLC_TICK_0 )
             {
                 *va_arg( args, vlc_tick_t * ) = p_sys->i_length;
                 return VLC_SUCCESS;
@@ -765,6 +840,19 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         case DEMUX_SET_TIME:
         {
+            if( p_sys->p_index && seekindex_IsReady( p_sys->p_index ) )
+            {
+                seekindex_entry_t entry;
+                vlc_tick_t i_time = va_arg( args, vlc_tick_t );
+                if( seekindex_Lookup( p_sys->p_index, i_time, &entry ) != VLC_SUCCESS ||
+                    vlc_stream_Seek( p_demux->s, entry.i_pos ) != VLC_SUCCESS )
+                    return VLC_EGENERIC;
+                p_sys->i_current_pts = VLC_TICK_INVALID;
+                p_sys->i_scr = VLC_TICK_INVALID;
+                IndexSeeked( p_sys, entry.i_time );
+                NotifyDiscontinuity( p_sys->tk, p_demux->out );
+                return VLC_SUCCESS;
+            }
             if( p_sys->i_time_track_index >= 0 && p_sys->i_current_pts != VLC_TICK_INVALID &&
                 p_sys->i_length > VLC_TICK_0)
             {
@@ -923,3 +1011,67 @@ static block_t *ps_pkt_read( stream_t *s )
 
     return NULL;
 }
+
+/* IndexScan: builds the SCR to pack offset index of the whole stream
+ *  Times are relative to the first SCR, and SCR discontinuities
+ *  are folded so that they keep increasing. IndexSCR() must follow
+ *  the same rules.
+ */
+static int IndexScan( seekindex_t *p_index, stream_t *s, const void *p_cfg )
+{
+    const ps_index_cfg_t *cfg = p_cfg;
+    vlc_tick_t i_first = VLC_TICK_INVALID;
+    vlc_tick_t i_last = VLC_TICK_INVALID;
+    vlc_tick_t i_offset = 0;
+
+    if( vlc_stream_Seek( s, cfg->i_start_byte ) != VLC_SUCCESS )
+        return VLC_EGENERIC;
+
+    while( !seekindex_Canceled( p_index ) )
+    {
+        int i_ret = ps_pkt_resynch( s, cfg->format, i_first == VLC_TICK_INVALID );
+        if( i_ret < 0 )
+            break;
+        else if( i_ret == 0 )
+            continue;
+
+        const uint64_t i_pos = vlc_stream_Tell( s );
+        const uint8_t *p_peek;
+        ssize_t i_peek = vlc_stream_Peek( s, &p_peek, 14 );
+        if( i_peek < 4 )
+            break;
+
+        if( p_peek[3] != PS_STREAM_ID_PACK_HEADER )
+        {
+            /* Skip PES payloads, resynch copes with unsized packets */
+            int i_size = ps_pkt_size( p_peek, i_peek );
+            if( i_size <= 6 )
+                i_size = 4;
+            if( vlc_stream_Read( s, NULL, i_size ) != i_size )
+                break;
+            continue;
+        }
+
+        block_t *p_pkt = ps_pkt_read( s );
+        if( p_pkt == NULL )
+            break;
+
+        vlc_tick_t i_scr; int i_mux_rate;
+        if( !ps_pkt_parse_pack( p_pkt, &i_scr, &i_mux_rate ) )
+        {
+            if( i_first == VLC_TICK_INVALID )
+                i_first = i_last = i_scr;
+            else if( i_scr < i_last || i_scr - i_last > VLC_TICK_FROM_SEC(1) )
+                i_offset += i_last - i_scr;
+            i_last = i_scr;
+
+            const vlc_tick_t i_time = i_scr - i_first + i_offset;
+            seekindex_Append( p_index, i_time, i_pos );
+            seekindex_SetLength( p_index, i_time );
+        }
+        block_Release( p_pkt );
+    }
+
+    return seekindex_Canceled( p_index ) || i_first == VLC_TICK_INVALID ?
+           VLC_EGENERIC : VLC_SUCCESS;
+}
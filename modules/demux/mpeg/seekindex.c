@@ -0,0 +1,367 @@
+/*****************************************************************************
+ * seekindex.c: background timestamp index for MPEG demuxers
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_atomic.h>
+#include <vlc_interrupt.h>
+#include <vlc_fs.h>
+#include <vlc_url.h>
+
+#include <assert.h>
+#include <sys/stat.h>
+
+#include "seekindex.h"
+
+#define SEEKINDEX_CACHE_MAX 8 /* unused complete indexes kept */
+
+enum
+{
+    SEEKINDEX_SCANNING = 0,
+    SEEKINDEX_READY,
+    SEEKINDEX_FAILED,
+};
+
+struct seekindex_t
+{
+    seekindex_t *p_next;
+    unsigned     i_refs;
+    char        *psz_url;
+    const char  *psz_kind;
+    uint64_t     i_size;
+    time_t       i_mtime;
+
+    seekindex_scan_cb pf_scan;
+    void        *p_cfg;
+
+    /* written by the scan only, read-only once ready */
+    seekindex_entry_t *p_entries;
+    size_t       i_entries;
+    size_t       i_alloc;
+    vlc_tick_t   i_length;
+
+    atomic_int   state;
+    vlc_object_t *p_obj;
+    vlc_interrupt_t *p_interrupt; /* NULL if scanned by the preparser */
+    vlc_thread_t thread;
+};
+
+static struct
+{
+    vlc_mutex_t  lock;
+    seekindex_t *p_first;
+} cache = { VLC_STATIC_MUTEX, NULL };
+
+static void Delete( seekindex_t *p_index )
+{
+    if( p_index->p_interrupt )
+    {
+        vlc_join( p_index->thread, NULL );
+        vlc_interrupt_destroy( p_index->p_interrupt );
+    }
+    free( p_index->p_entries );
+    free( p_index->p_cfg );
+    free( p_index->psz_url );
+    free( p_index );
+}
+
+static void Scan( seekindex_t *p_index )
+{
+    int i_state = SEEKINDEX_FAILED;
+
+    stream_t *s = vlc_stream_NewURL( p_index->p_obj, p_index->psz_url );
+    if( s )
+    {
+        if( p_index->pf_scan( p_index, s, p_index->p_cfg ) == VLC_SUCCESS &&
+            p_index->i_entries > 0 )
+        {
+            i_state = SEEKINDEX_READY;
+            msg_Dbg( p_index->p_obj, "%s index ready, %zu entries, length %"PRId64"ms",
+                     p_index->psz_kind, p_index->i_entries,
+                     MS_FROM_VLC_TICK(p_index->i_length) );
+        }
+        vlc_stream_Delete( s );
+    }
+    atomic_store_explicit( &p_index->state, i_state, memory_order_release );
+}
+
+static void *Run( void *data )
+{
+    seekindex_t *p_index = data;
+
+    vlc_interrupt_set( p_index->p_interrupt );
+    Scan( p_index );
+    return NULL;
+}
+
+/* Only the unused complete indexes are left once all demuxers are closed */
+__attribute__((destructor))
+static void seekindex_Unload( void )
+{
+    while( cache.p_first )
+    {
+        seekindex_t *p_index = cache.p_first;
+        cache.p_first = p_index->p_next;
+        assert( p_index->i_refs == 0 );
+        Delete( p_index );
+    }
+}
+
+/* Modification time of a local file, so that an index is not reused once
+ * the file is rewritten with the same size */
+static int GetMTime( const char *psz_url, time_t *pi_mtime )
+{
+    char *psz_path = vlc_uri2path( psz_url );
+    if( psz_path == NULL )
+        return VLC_EGENERIC;
+
+    struct stat st;
+    int i_ret = vlc_stat( psz_path, &st );
+    free( psz_path );
+    if( i_ret )
+        return VLC_EGENERIC;
+    *pi_mtime = st.st_mtime;
+    return VLC_SUCCESS;
+}
+
+seekindex_t * seekindex_Open( demux_t *p_demux, const char *psz_kind,
+                              seekindex_scan_cb pf_scan, const void *p_cfg, size_t i_cfg )
+{
+    uint64_t i_size;
+    time_t i_mtime;
+    bool b_fastseek = false;
+
+    if( p_demux->psz_url == NULL ||
+        vlc_stream_GetSize( p_demux->s, &i_size ) != VLC_SUCCESS || i_size == 0 )
+        return NULL;
+
+    /* Don't read remote files twice */
+    vlc_stream_Control( p_demux->s, STREAM_CAN_FASTSEEK, &b_fastseek );
+    if( !b_fastseek || GetMTime( p_demux->psz_url, &i_mtime ) )
+        return NULL;
+
+    vlc_mutex_lock( &cache.lock );
+    for( seekindex_t *p_index = cache.p_first; p_index; p_index = p_index->p_next )
+    {
+        if( p_index->i_size == i_size && p_index->i_mtime == i_mtime &&
+            p_index->psz_kind == psz_kind && !strcmp( p_index->psz_url, p_demux->psz_url ) &&
+            atomic_load( &p_index->state ) != SEEKINDEX_FAILED )
+        {
+            p_index->i_refs++;
+            vlc_mutex_unlock( &cache.lock );
+            return p_index;
+        }
+    }
+
+    seekindex_t *p_index = calloc( 1, sizeof(*p_index) );
+    if( !p_index )
+        goto error;
+    p_index->i_refs = 1;
+    p_index->psz_kind = psz_kind;
+    p_index->i_size = i_size;
+    p_index->i_mtime = i_mtime;
+    p_index->pf_scan = pf_scan;
+    p_index->i_length = VLC_TICK_INVALID;
+    /* The scan can outlive the demuxer which started it */
+    p_index->p_obj = VLC_OBJECT(vlc_object_instance(p_demux));
+    atomic_init( &p_index->state, SEEKINDEX_SCANNING );
+    p_index->psz_url = strdup( p_demux->psz_url );
+    p_index->p_cfg = malloc( i_cfg );
+    if( p_index->p_cfg )
+        memcpy( p_index->p_cfg, p_cfg, i_cfg );
+    if( !p_index->psz_url || !p_index->p_cfg )
+        goto error_free;
+
+    if( p_demux->b_preparsing )
+    {
+        /* The playlist needs the exact duration: scan now, from the
+         * preparser thread, which can interrupt it */
+        vlc_mutex_unlock( &cache.lock );
+        Scan( p_index );
+        if( !seekindex_IsReady( p_index ) )
+        {
+            free( p_index->p_cfg );
+            free( p_index->psz_url );
+            free( p_index );
+            return NULL;
+        }
+        vlc_mutex_lock( &cache.lock );
+    }
+    else
+    {
+        p_index->p_interrupt = vlc_interrupt_create();
+        if( !p_index->p_interrupt )
+            goto error_free;
+        if( vlc_clone( &p_index->thread, Run, p_index, VLC_THREAD_PRIORITY_LOW ) )
+        {
+            vlc_interrupt_destroy( p_index->p_interrupt );
+            goto error_free;
+        }
+    }
+
+    p_index->p_next = cache.p_first;
+    cache.p_first = p_index;
+    vlc_mutex_unlock( &cache.lock );
+
+    return p_index;
+
+error_free:
+    free( p_index->p_cfg );
+    free( p_index->psz_url );
+    free( p_index );
+
+error:
+    vlc_mutex_unlock( &cache.lock );
+    return NULL;
+}
+
+void seekindex_Release( seekindex_t *p_index )
+{
+    seekindex_t *p_delete = NULL;
+
+    vlc_mutex_lock( &cache.lock );
+    assert( p_index->i_refs > 0 );
+    if( --p_index->i_refs == 0 )
+    {
+        if( atomic_load( &p_index->state ) != SEEKINDEX_READY )
+        {
+            /* Unused and incomplete: cancel the scan */
+            p_delete = p_index;
+        }
+        else
+        {
+            /* Keep the most recently used ones */
+            unsigned i_unused = 0;
+            for( seekindex_t *p = cache.p_first; p; p = p->p_next )
+            {
+                if( p->i_refs == 0 && ++i_unused > SEEKINDEX_CACHE_MAX )
+                {
+                    p_delete = p;
+                    break;
+                }
+            }
+        }
+
+        if( p_delete )
+        {
+            for( seekindex_t **pp = &cache.p_first; *pp; pp = &(*pp)->p_next )
+            {
+                if( *pp == p_delete )
+                {
+                    *pp = p_delete->p_next;
+                    break;
+                }
+            }
+        }
+    }
+    vlc_mutex_unlock( &cache.lock );
+
+    if( p_delete )
+    {
+        if( p_delete->p_interrupt )
+            vlc_interrupt_kill( p_delete->p_interrupt );
+        Delete( p_delete );
+    }
+}
+
+bool seekindex_IsReady( seekindex_t *p_index )
+{
+    return atomic_load_explicit( &p_index->state, memory_order_acquire ) == SEEKINDEX_READY;
+}
+
+vlc_tick_t seekindex_GetLength( seekindex_t *p_index )
+{
+    assert( seekindex_IsReady( p_index ) );
+    return p_index->i_length;
+}
+
+int seekindex_Lookup( seekindex_t *p_index, vlc_tick_t i_time, seekindex_entry_t *p_entry )
+{
+    assert( seekindex_IsReady( p_index ) );
+
+    size_t i_low = 0, i_high = p_index->i_entries;
+    while( i_high - i_low > 1 )
+    {
+        const size_t i_mid = (i_low + i_high) / 2;
+        if( p_index->p_entries[i_mid].i_time <= i_time )
+            i_low = i_mid;
+        else
+            i_high = i_mid;
+    }
+    *p_entry = p_index->p_entries[i_low];
+    return VLC_SUCCESS;
+}
+
+int seekindex_LookupPos( seekindex_t *p_index, uint64_t i_pos, seekindex_entry_t *p_entry )
+{
+    assert( seekindex_IsReady( p_index ) );
+
+    size_t i_low = 0, i_high = p_index->i_entries;
+    while( i_high - i_low > 1 )
+    {
+        const size_t i_mid = (i_low + i_high) / 2;
+        if( p_index->p_entries[i_mid].i_pos <= i_pos )
+            i_low = i_mid;
+        else
+            i_high = i_mid;
+    }
+    *p_entry = p_index->p_entries[i_low];
+    return VLC_SUCCESS;
+}
+
+void seekindex_Append( seekindex_t *p_index, vlc_tick_t i_time, uint64_t i_pos )
+{
+    if( p_index->i_entries > 0 )
+    {
+        const seekindex_entry_t *p_last = &p_index->p_entries[p_index->i_entries - 1];
+        if( i_time < p_last->i_time + SEEKINDEX_INTERVAL || i_pos <= p_last->i_pos )
+            return;
+    }
+
+    if( p_index->i_entries == p_index->i_alloc )
+    {
+        size_t i_alloc = p_index->i_alloc ? p_index->i_alloc * 2 : 1024;
+        seekindex_entry_t *p_realloc = realloc( p_index->p_entries,
+                                                i_alloc * sizeof(*p_realloc) );
+        if( !p_realloc )
+            return;
+        p_index->p_entries = p_realloc;
+        p_index->i_alloc = i_alloc;
+    }
+
+    p_index->p_entries[p_index->i_entries++] = (seekindex_entry_t) {
+        .i_time = i_time, .i_pos = i_pos
+    };
+}
+
+void seekindex_SetLength( seekindex_t *p_index, vlc_tick_t i_length )
+{
+    p_index->i_length = i_length;
+}
+
+bool seekindex_Canceled( seekindex_t *p_index )
+{
+    VLC_UNUSED(p_index);
+    return vlc_killed();
+}
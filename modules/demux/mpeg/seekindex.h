@@ -0,0 +1,63 @@
+/*****************************************************************************
+ * seekindex.h: background timestamp index for MPEG demuxers
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef VLC_MPEG_SEEKINDEX_H
+#define VLC_MPEG_SEEKINDEX_H
+
+/* Time to byte offset index of a whole file, built by a scan callback
+ * reading a second stream handle of the same URL from a background thread
+ * (or from the preparser thread).
+ * Only local files are indexed, and indexes are shared per URL, kind,
+ * size and modification time: playing a file again reuses its index. The
+ * index can only be queried once ready, and is read-only then. */
+
+#define SEEKINDEX_INTERVAL VLC_TICK_FROM_MS(100) /* minimal entries spacing */
+
+typedef struct seekindex_t seekindex_t;
+
+typedef struct
+{
+    vlc_tick_t i_time; /* from the start of the file */
+    uint64_t   i_pos;
+} seekindex_entry_t;
+
+/* Scans the whole stream, returns VLC_SUCCESS if the index is complete */
+typedef int (*seekindex_scan_cb)( seekindex_t *, stream_t *, const void *p_cfg );
+
+/* Returns the shared index of the demuxed file, starting its scan if
+ * needed, or NULL if it can't be indexed. When preparsing, the scan is done
+ * before returning, so that the playlist gets the exact duration, and the
+ * index is kept for the playback. p_cfg is copied for the scan callback. */
+seekindex_t * seekindex_Open( demux_t *, const char *psz_kind,
+                              seekindex_scan_cb, const void *p_cfg, size_t i_cfg );
+void seekindex_Release( seekindex_t * );
+
+bool       seekindex_IsReady( seekindex_t * );
+vlc_tick_t seekindex_GetLength( seekindex_t * );
+/* Last entry at or before i_time */
+int        seekindex_Lookup( seekindex_t *, vlc_tick_t i_time, seekindex_entry_t * );
+/* Last entry at or before byte i_pos */
+int        seekindex_LookupPos( seekindex_t *, uint64_t i_pos, seekindex_entry_t * );
+
+/* Scan callback side */
+void seekindex_Append( seekindex_t *, vlc_tick_t i_time, uint64_t i_pos );
+void seekindex_SetLength( seekindex_t *, vlc_tick_t i_length );
+bool seekindex_Canceled( seekindex_t * );
+
+#endif
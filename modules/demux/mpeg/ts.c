@@ -41,6 +41,7 @@
 #include "ts_psi.h"
 #include "ts_si.h"
 #include "ts_psip.h"
+#include "ts_si_worker.h"
 
 #include "ts_hotfixes.h"
 #include "ts_sl.h"
@@ -394,6 +395,8 @@ static int Open( vlc_object_t *p_this )
     p_sys->stream = p_demux->s;
 
     p_sys->b_broken_charset = false;
+    p_sys->p_si_worker = NULL;
+    p_sys->b_si_sync = p_demux->b_preparsing;
 
     ts_pid_list_Init( &p_sys->pids );
 
@@ -556,6 +559,9 @@ static void Close( vlc_object_t *p_this )
     demux_t     *p_demux = (demux_t*)p_this;
     demux_sys_t *p_sys = p_demux->p_sys;
 
+    if( p_sys->p_si_worker )
+        ts_si_worker_Delete( p_sys->p_si_worker );
+
     PIDRelease( p_demux, GetPID(p_sys, 0) );
 
     vlc_mutex_lock( &p_sys->csa_lock );
@@ -629,6 +635,9 @@ static int Demux( demux_t *p_demux )
         GetPID(p_sys, 0)->u.p_pat->b_generated = true;
     }
 
+    if( p_sys->p_si_worker )
+        ts_si_worker_Complete( p_sys->p_si_worker, p_demux );
+
     /* We read at most 100 TS packet or until a frame is completed */
     for( unsigned i_pkt = 0; i_pkt < p_sys->i_ts_read; i_pkt++ )
     {
@@ -2816,6 +2825,19 @@ void TsChangeStandard( demux_sys_t *p_sys, ts_standards_e v )
     p_sys->standard = v;
 }
 
+ts_si_worker_t * GetSIWorker( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    /* Most streams have no EIT: the thread is only started when needed */
+    if( !p_sys->p_si_worker && !p_sys->b_si_sync )
+    {
+        p_sys->p_si_worker = ts_si_worker_New( VLC_OBJECT(p_demux) );
+        p_sys->b_si_sync = p_sys->p_si_worker == NULL;
+    }
+    return p_sys->p_si_worker;
+}
+
 bool ProgramIsSelected( demux_sys_t *p_sys, uint16_t i_pgrm )
 {
     if( p_sys->seltype == PROGRAM_ALL )
@@ -24,6 +24,7 @@
     typedef struct arib_instance_t arib_instance_t;
 #endif
 typedef struct csa_t csa_t;
+typedef struct ts_si_worker_t ts_si_worker_t;
 
 #define TS_USER_PMT_NUMBER (0)
 
@@ -115,6 +116,8 @@ struct demux_sys_t
     time_t      i_network_time;
     time_t      i_network_time_update; /* for network time interpolation */
     bool        b_broken_charset; /* True if broken encoding is used in EPG/SDT */
+    ts_si_worker_t *p_si_worker; /* EPG conversions, see GetSIWorker() */
+    bool        b_si_sync; /* EPG conversions run on the demux thread */
 
     /* Selected programs */
     enum
@@ -146,6 +149,10 @@ void TsChangeStandard( demux_sys_t *, ts_standards_e );
 
 bool ProgramIsSelected( demux_sys_t *, uint16_t i_pgrm );
 
+/* Worker for the EPG conversions, started on the first EIT, NULL if they run
+ * on the demux thread */
+ts_si_worker_t * GetSIWorker( demux_t *p_demux );
+
 void UpdatePESFilters( demux_t *p_demux, bool b_all );
 
 int ProbeStart( demux_t *p_demux, int i_program );
@@ -172,7 +172,10 @@ static void PATCallBack( void *data, dvbpsi_pat_t *p_dvbpsipat )
         if( !b_existing || pmtpid->u.p_pmt->i_number != p_program->i_number )
         {
             if( b_existing && pmtpid->u.p_pmt->i_number != p_program->i_number )
+            {
                 dvbpsi_pmt_detach(pmtpid->u.p_pmt->handle);
+                ts_psi_cache_Reset( &pmtpid->u.p_pmt->cache );
+            }
 
             if( !dvbpsi_pmt_attach( pmtpid->u.p_pmt->handle, p_program->i_number, PMTCallBack, p_demux ) )
                 msg_Err( p_demux, "PATCallback failed attaching PMTCallback to program %d",
@@ -2288,7 +2291,7 @@ bool ts_psi_PAT_Attach( ts_pid_t *patpid, void *cbdata )
 void ts_psi_Packet_Push( ts_pid_t *p_pid, const uint8_t *p_pktbuffer )
 {
     if( p_pid->type == TYPE_PAT )
-        dvbpsi_packet_push( p_pid->u.p_pat->handle, (uint8_t *) p_pktbuffer );
+        ts_psi_cache_Push( &p_pid->u.p_pat->cache, p_pid->u.p_pat->handle, p_pktbuffer );
     else if( p_pid->type == TYPE_PMT )
-        dvbpsi_packet_push( p_pid->u.p_pmt->handle, (uint8_t *) p_pktbuffer );
+        ts_psi_cache_Push( &p_pid->u.p_pmt->cache, p_pid->u.p_pmt->handle, p_pktbuffer );
 }
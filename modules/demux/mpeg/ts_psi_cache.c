@@ -0,0 +1,349 @@
+/*****************************************************************************
+ * ts_psi_cache.c: TS Demux PSI sections cache
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+
+#ifndef _DVBPSI_DVBPSI_H_
+ #include <dvbpsi/dvbpsi.h>
+#endif
+#ifndef _DVBPSI_DEMUX_H_
+ #include <dvbpsi/demux.h>
+#endif
+#include "ts_psi_cache.h"
+
+#define CACHE_MIN_SIZE 64
+
+struct ts_psi_cache_entry_t
+{
+    uint32_t i_key; /* table_id, extension, section_number */
+    uint32_t i_crc;
+    uint8_t  i_version; /* 0xFF when unused */
+};
+
+static inline uint32_t SectionKey( const uint8_t *p_section )
+{
+    /* table_id, table_id_extension, section_number */
+    return ( (uint32_t)p_section[0] << 24 ) | ( p_section[3] << 16 ) |
+           ( p_section[4] << 8 ) | p_section[6];
+}
+
+static inline uint8_t SectionVersion( const uint8_t *p_section )
+{
+    return ( p_section[5] >> 1 ) & 0x1F;
+}
+
+static inline size_t EntryHash( uint32_t i_key, size_t i_size )
+{
+    return ( i_key * UINT32_C(0x9E3779B1) ) & ( i_size - 1 );
+}
+
+void ts_psi_cache_Init( ts_psi_cache_t *p_cache, bool b_demux )
+{
+    p_cache->p_entries = NULL;
+    p_cache->i_size = 0;
+    p_cache->i_count = 0;
+    p_cache->i_hits = 0;
+    p_cache->i_misses = 0;
+    p_cache->b_demux = b_demux;
+    p_cache->i_cc = 0xFF;
+    p_cache->i_pushed_cc = 0xFF;
+    p_cache->b_discontinuity = false;
+    p_cache->b_skipping = false;
+    p_cache->section.b_open = false;
+}
+
+void ts_psi_cache_Clean( ts_psi_cache_t *p_cache )
+{
+    free( p_cache->p_entries );
+    p_cache->p_entries = NULL;
+    p_cache->i_size = 0;
+    p_cache->i_count = 0;
+}
+
+void ts_psi_cache_Reset( ts_psi_cache_t *p_cache )
+{
+    for( size_t i = 0; i < p_cache->i_size; i++ )
+        p_cache->p_entries[i].i_version = 0xFF;
+    p_cache->i_count = 0;
+}
+
+static ts_psi_cache_entry_t *Find( ts_psi_cache_entry_t *p_entries, size_t i_size,
+                                   uint32_t i_key )
+{
+    for( size_t i = EntryHash( i_key, i_size );; i = ( i + 1 ) & ( i_size - 1 ) )
+    {
+        ts_psi_cache_entry_t *p_entry = &p_entries[i];
+        if( p_entry->i_version == 0xFF || p_entry->i_key == i_key )
+            return p_entry;
+    }
+}
+
+static const ts_psi_cache_entry_t *Lookup( ts_psi_cache_t *p_cache,
+                                           uint32_t i_key, uint8_t i_version )
+{
+    if( p_cache->i_size == 0 )
+        return NULL;
+    const ts_psi_cache_entry_t *p_entry = Find( p_cache->p_entries, p_cache->i_size, i_key );
+    return p_entry->i_version == i_version ? p_entry : NULL;
+}
+
+static void Store( ts_psi_cache_t *p_cache, uint32_t i_key, uint8_t i_version,
+                   uint32_t i_crc )
+{
+    /* keep the load factor under 1/2 */
+    if( ( p_cache->i_count + 1 ) * 2 > p_cache->i_size )
+    {
+        const size_t i_size = p_cache->i_size ? p_cache->i_size * 2 : CACHE_MIN_SIZE;
+        ts_psi_cache_entry_t *p_entries = vlc_alloc( i_size, sizeof(*p_entries) );
+        if( unlikely(p_entries == NULL) )
+            return;
+        for( size_t i = 0; i < i_size; i++ )
+            p_entries[i].i_version = 0xFF;
+        for( size_t i = 0; i < p_cache->i_size; i++ )
+        {
+            const ts_psi_cache_entry_t *p_old = &p_cache->p_entries[i];
+            if( p_old->i_version != 0xFF )
+                *Find( p_entries, i_size, p_old->i_key ) = *p_old;
+        }
+        free( p_cache->p_entries );
+        p_cache->p_entries = p_entries;
+        p_cache->i_size = i_size;
+    }
+
+    ts_psi_cache_entry_t *p_entry = Find( p_cache->p_entries, p_cache->i_size, i_key );
+    if( p_entry->i_version == 0xFF )
+        p_cache->i_count++;
+    p_entry->i_key = i_key;
+    p_entry->i_crc = i_crc;
+    p_entry->i_version = i_version;
+}
+
+/* Whether a table decoder gets the sections of this table */
+static bool HasDecoder( const ts_psi_cache_t *p_cache, dvbpsi_t *p_handle,
+                        uint32_t i_key )
+{
+    if( !dvbpsi_decoder_present( p_handle ) )
+        return false;
+    if( !p_cache->b_demux )
+        return true;
+    return dvbpsi_demuxGetSubDec( (dvbpsi_demux_t *) p_handle->p_decoder,
+                                  i_key >> 24, ( i_key >> 8 ) & 0xFFFF ) != NULL;
+}
+
+static inline uint32_t CRCByte( uint32_t i_crc, uint8_t i_byte )
+{
+    i_crc ^= (uint32_t)i_byte << 24;
+    for( int j = 0; j < 8; j++ )
+        i_crc = ( i_crc & 0x80000000 ) ? ( i_crc << 1 ) ^ 0x04c11db7 : i_crc << 1;
+    return i_crc;
+}
+
+static void SectionComplete( ts_psi_cache_t *p_cache, dvbpsi_t *p_handle )
+{
+    const uint8_t *p_header = p_cache->section.header;
+
+    /* Only long syntax sections have a version and a CRC */
+    if( ( p_header[1] & 0x80 ) == 0 || p_cache->section.i_size < 12 )
+        return;
+
+    const uint32_t i_key = SectionKey( p_header );
+    const uint8_t i_version = SectionVersion( p_header );
+    if( Lookup( p_cache, i_key, i_version ) )
+        return;
+
+    p_cache->i_misses++;
+    /* libdvbpsi already gave it to the table decoder, if valid */
+    if( p_cache->section.i_crc == 0 && HasDecoder( p_cache, p_handle, i_key ) )
+        Store( p_cache, i_key, i_version, p_cache->section.i_last );
+}
+
+/* Follows the bytes of the section gathered by libdvbpsi.
+ * Returns the number of bytes belonging to the section. */
+static size_t SectionFeed( ts_psi_cache_t *p_cache, dvbpsi_t *p_handle,
+                           const uint8_t *p, size_t i_size )
+{
+    for( size_t i = 0; i < i_size; i++ )
+    {
+        p_cache->section.i_crc = CRCByte( p_cache->section.i_crc, p[i] );
+        p_cache->section.i_last = ( p_cache->section.i_last << 8 ) | p[i];
+        if( p_cache->section.i_done < ARRAY_SIZE(p_cache->section.header) )
+            p_cache->section.header[p_cache->section.i_done] = p[i];
+
+        if( ++p_cache->section.i_done == 3 )
+            p_cache->section.i_size = 3 + ( ( ( p_cache->section.header[1] & 0x0F ) << 8 ) |
+                                            p_cache->section.header[2] );
+        if( p_cache->section.i_done >= 3 &&
+            p_cache->section.i_done == p_cache->section.i_size )
+        {
+            p_cache->section.b_open = false;
+            SectionComplete( p_cache, p_handle );
+            return i + 1;
+        }
+    }
+    return i_size;
+}
+
+static void Forward( ts_psi_cache_t *p_cache, dvbpsi_t *p_handle, const uint8_t *p_pkt )
+{
+    uint8_t pkt[188];
+    memcpy( pkt, p_pkt, 188 );
+
+    /* Keep libdvbpsi continuity check on the pushed packets only, and skip
+     * one value to signal a real discontinuity */
+    if( p_cache->i_pushed_cc <= 0x0F )
+    {
+        p_cache->i_pushed_cc += p_cache->b_discontinuity ? 2 : 1;
+        p_cache->i_pushed_cc &= 0x0F;
+        pkt[3] = ( pkt[3] & 0xF0 ) | p_cache->i_pushed_cc;
+    }
+    else p_cache->i_pushed_cc = pkt[3] & 0x0F;
+    p_cache->b_discontinuity = false;
+
+    dvbpsi_packet_push( p_handle, pkt );
+}
+
+/* Whether the sections starting in a packet are all known to their table
+ * decoder. Sets the number of sections and if the last one continues in
+ * the next packets. */
+static bool PacketIsKnown( ts_psi_cache_t *p_cache, dvbpsi_t *p_handle,
+                           const uint8_t *p, size_t i_left,
+                           unsigned *pi_sections, bool *pb_open )
+{
+    *pi_sections = 0;
+    *pb_open = false;
+
+    while( i_left > 0 && p[0] != 0xFF )
+    {
+        if( i_left < 8 || ( p[1] & 0x80 ) == 0 )
+            return false;
+        const size_t i_size = 3 + ( ( ( p[1] & 0x0F ) << 8 ) | p[2] );
+        if( i_size < 12 )
+            return false;
+
+        const uint32_t i_key = SectionKey( p );
+        const ts_psi_cache_entry_t *p_entry = Lookup( p_cache, i_key, SectionVersion( p ) );
+        if( p_entry == NULL || !HasDecoder( p_cache, p_handle, i_key ) )
+            return false;
+        (*pi_sections)++;
+
+        if( i_size > i_left )
+        {
+            *pb_open = true;
+            return true;
+        }
+        if( p_entry->i_crc != GetDWBE( &p[i_size - 4] ) )
+            return false;
+
+        p += i_size;
+        i_left -= i_size;
+    }
+    return true;
+}
+
+void ts_psi_cache_Push( ts_psi_cache_t *p_cache, dvbpsi_t *p_handle,
+                        const uint8_t *p_pkt )
+{
+    /* Packets without payload carry nothing for the table decoders */
+    if( ( p_pkt[3] & 0x10 ) == 0 )
+        return;
+
+    const uint8_t i_cc = p_pkt[3] & 0x0F;
+    if( p_cache->i_cc <= 0x0F )
+    {
+        if( i_cc == p_cache->i_cc )
+            return; /* duplicate */
+        if( i_cc != ( ( p_cache->i_cc + 1 ) & 0x0F ) )
+        {
+            /* libdvbpsi will drop what the table decoders gathered */
+            ts_psi_cache_Reset( p_cache );
+            p_cache->b_discontinuity = true;
+            p_cache->b_skipping = false;
+            p_cache->section.b_open = false;
+        }
+    }
+    p_cache->i_cc = i_cc;
+
+    size_t i_skip = 4;
+    if( p_pkt[3] & 0x20 )
+        i_skip += 1 + p_pkt[4];
+    if( i_skip >= 188 )
+        return;
+    const uint8_t *p = &p_pkt[i_skip];
+    size_t i_left = 188 - i_skip;
+
+    if( ( p_pkt[1] & 0x40 ) == 0 )
+    {
+        if( p_cache->b_skipping )
+            return;
+        Forward( p_cache, p_handle, p_pkt );
+        if( p_cache->section.b_open )
+            SectionFeed( p_cache, p_handle, p, i_left );
+        return;
+    }
+
+    const size_t i_pointer = p[0];
+    p++;
+    i_left--;
+    if( i_pointer > i_left )
+    {
+        Forward( p_cache, p_handle, p_pkt );
+        p_cache->b_skipping = false;
+        p_cache->section.b_open = false;
+        return;
+    }
+
+    /* Drop the packet if libdvbpsi does not need the end of its current
+     * section, and already had all the sections starting in it */
+    unsigned i_sections;
+    bool b_open;
+    if( !p_cache->section.b_open &&
+        PacketIsKnown( p_cache, p_handle, &p[i_pointer], i_left - i_pointer,
+                       &i_sections, &b_open ) )
+    {
+        p_cache->i_hits += i_sections;
+        p_cache->b_skipping = b_open;
+        return;
+    }
+
+    Forward( p_cache, p_handle, p_pkt );
+    p_cache->b_skipping = false;
+
+    if( p_cache->section.b_open )
+    {
+        SectionFeed( p_cache, p_handle, p, i_pointer );
+        p_cache->section.b_open = false;
+    }
+    p += i_pointer;
+    i_left -= i_pointer;
+
+    while( i_left > 0 && p[0] != 0xFF )
+    {
+        p_cache->section.b_open = true;
+        p_cache->section.i_done = 0;
+        p_cache->section.i_crc = 0xffffffff;
+        p_cache->section.i_last = 0;
+
+        const size_t i_used = SectionFeed( p_cache, p_handle, p, i_left );
+        p += i_used;
+        i_left -= i_used;
+    }
+}
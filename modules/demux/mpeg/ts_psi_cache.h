@@ -0,0 +1,68 @@
+/*****************************************************************************
+ * ts_psi_cache.h: TS Demux PSI sections cache
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+#ifndef VLC_TS_PSI_CACHE_H
+#define VLC_TS_PSI_CACHE_H
+
+/* Remembers the sections (table_id, extension, version, section_number and
+ * CRC) already given to a table decoder on a PID, so the packets only
+ * carrying their repetitions never reach libdvbpsi. Only sections with the
+ * long syntax (and a CRC) are cached.
+ * Dropped packets are hidden from libdvbpsi by renumbering the continuity
+ * counter of the pushed ones. */
+
+typedef struct ts_psi_cache_entry_t ts_psi_cache_entry_t;
+
+typedef struct
+{
+    ts_psi_cache_entry_t *p_entries;
+    size_t   i_size;  /* power of 2 */
+    size_t   i_count;
+    uint64_t i_hits;
+    uint64_t i_misses;
+    bool     b_demux; /* handle decoder is a dvbpsi demux */
+
+    uint8_t  i_cc;          /* last continuity counter on the PID, 0xFF if none */
+    uint8_t  i_pushed_cc;   /* last continuity counter given to libdvbpsi */
+    bool     b_discontinuity; /* to signal with the next pushed packet */
+    bool     b_skipping;    /* dropping the remaining packets of a known section */
+
+    /* section being gathered by libdvbpsi */
+    struct
+    {
+        bool     b_open;
+        size_t   i_size; /* once the 3 first bytes are known */
+        size_t   i_done;
+        uint32_t i_crc;
+        uint32_t i_last; /* last 4 bytes, the CRC field once complete */
+        uint8_t  header[8];
+    } section;
+} ts_psi_cache_t;
+
+void ts_psi_cache_Init( ts_psi_cache_t *, bool b_demux );
+void ts_psi_cache_Clean( ts_psi_cache_t * );
+
+/* Forgets the cached sections. Must be called when the handle table
+ * decoders are detached or replaced. */
+void ts_psi_cache_Reset( ts_psi_cache_t * );
+
+/* Pushes a TS packet to the handle decoder, unless it only carries
+ * already decoded sections */
+void ts_psi_cache_Push( ts_psi_cache_t *, dvbpsi_t *, const uint8_t *p_pkt );
+
+#endif
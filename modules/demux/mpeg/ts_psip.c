@@ -50,6 +50,7 @@
 #include "ts_scte.h"
 
 #include "ts_psip.h"
+#include "ts_si_worker.h"
 
 #include "../codec/atsc_a65.h"
 #include "../codec/scte18.h"
@@ -88,7 +89,7 @@ struct ts_psip_context_t
 void ts_psip_Packet_Push( ts_pid_t *p_pid, const uint8_t *p_pktbuffer )
 {
     if( p_pid->u.p_psip->handle->p_decoder && likely(p_pid->type == TYPE_PSIP) )
-        dvbpsi_packet_push( p_pid->u.p_psip->handle, (uint8_t *) p_pktbuffer );
+        ts_psi_cache_Push( &p_pid->u.p_psip->cache, p_pid->u.p_psip->handle, p_pktbuffer );
 }
 
 ts_psip_context_t * ts_psip_context_New()
@@ -314,20 +315,21 @@ static const char * ATSC_A53_get_service_type( uint8_t i_type )
     } while(0);
 #endif
 
-static vlc_epg_event_t * ATSC_CreateVLCEPGEvent( demux_t *p_demux, ts_psip_context_t *p_basectx,
+static vlc_epg_event_t * ATSC_CreateVLCEPGEvent( demux_t *p_demux, atsc_a65_handle_t *p_a65,
+                                                 time_t i_gps_utc_offset,
                                                  const dvbpsi_atsc_eit_event_t *p_evt,
-                                                 const dvbpsi_atsc_ett_t *p_ett )
+                                                 const uint8_t *p_etm_data, size_t i_etm_length )
 {
 #ifndef ATSC_DEBUG_EIT
     VLC_UNUSED(p_demux);
 #endif
-    char *psz_title = atsc_a65_Decode_multiple_string( p_basectx->p_a65,
+    char *psz_title = atsc_a65_Decode_multiple_string( p_a65,
                                                        p_evt->i_title, p_evt->i_title_length );
     char *psz_shortdesc_text = NULL;
     char *psz_longdesc_text = NULL;
     vlc_epg_event_t *p_epgevt = NULL;
 
-    time_t i_start = atsc_a65_GPSTimeToEpoch( p_evt->i_start_time, p_basectx->p_stt->i_gps_utc_offset );
+    time_t i_start = atsc_a65_GPSTimeToEpoch( p_evt->i_start_time, i_gps_utc_offset );
     EIT_DEBUG_TIMESHIFT( i_start );
 
     for( const dvbpsi_descriptor_t *p_dr = p_evt->p_first_descriptor;
@@ -355,7 +357,7 @@ static vlc_epg_event_t * ATSC_CreateVLCEPGEvent( demux_t *p_demux, ts_psip_conte
 
                     if( unlikely(psz_shortdesc_text) )
                         free( psz_shortdesc_text );
-                    psz_shortdesc_text = atsc_a65_Decode_multiple_string( p_basectx->p_a65, p_data, desclen );
+                    psz_shortdesc_text = atsc_a65_Decode_multiple_string( p_a65, p_data, desclen );
                     if( psz_shortdesc_text ) /* Only keep first for now */
                         break;
                     p_data += desclen;
@@ -368,11 +370,8 @@ static vlc_epg_event_t * ATSC_CreateVLCEPGEvent( demux_t *p_demux, ts_psip_conte
     }
 
     /* Try to match ETT */
-    if( p_ett )
-    {
-        psz_longdesc_text = atsc_a65_Decode_multiple_string( p_basectx->p_a65,
-                                                             p_ett->p_etm_data, p_ett->i_etm_length );
-    }
+    if( p_etm_data )
+        psz_longdesc_text = atsc_a65_Decode_multiple_string( p_a65, p_etm_data, i_etm_length );
 
     if( i_start != VLC_TICK_INVALID && psz_title )
     {
@@ -395,13 +394,14 @@ static vlc_epg_event_t * ATSC_CreateVLCEPGEvent( demux_t *p_demux, ts_psip_conte
     return p_epgevt;
 }
 
-static time_t ATSC_AddVLCEPGEvent( demux_t *p_demux, ts_psip_context_t *p_basectx,
+static time_t ATSC_AddVLCEPGEvent( demux_t *p_demux, atsc_a65_handle_t *p_a65,
+                                   time_t i_gps_utc_offset,
                                    const dvbpsi_atsc_eit_event_t *p_event,
-                                   const dvbpsi_atsc_ett_t *p_ett,
+                                   const uint8_t *p_etm_data, size_t i_etm_length,
                                    vlc_epg_t *p_epg )
 {
-    vlc_epg_event_t *p_evt = ATSC_CreateVLCEPGEvent( p_demux, p_basectx,
-                                                     p_event, p_ett );
+    vlc_epg_event_t *p_evt = ATSC_CreateVLCEPGEvent( p_demux, p_a65, i_gps_utc_offset,
+                                                     p_event, p_etm_data, i_etm_length );
     if( p_evt )
     {
         if( vlc_epg_AddEvent( p_epg, p_evt ) )
@@ -411,6 +411,162 @@ static time_t ATSC_AddVLCEPGEvent( demux_t *p_demux, ts_psip_context_t *p_basect
     return VLC_TICK_INVALID;
 }
 
+/* EIT to EPG conversion, run from the SI worker when available. The
+ * matching ETT texts are copied as the ETT context can change meanwhile. */
+typedef struct
+{
+    ts_si_work_t       work;
+    demux_t           *p_demux;
+    ts_pid_t          *p_eit_pid;
+    dvbpsi_atsc_eit_t *p_eit;
+    uint16_t           i_table_type;
+    uint16_t           i_program_number;
+    atsc_a65_handle_t *p_a65; /* when run on the demux thread */
+    time_t             i_gps_utc_offset;
+    time_t             i_current_time;
+    struct
+    {
+        uint8_t *p_data;
+        size_t   i_length;
+    } *p_etms; /* per event, NULL data if no ETT matched */
+    size_t             i_etms;
+    vlc_epg_t         *p_epg;
+} atsc_eit_work_t;
+
+static void ATSC_EITWorkRun( ts_si_work_t *p_work, ts_si_worker_t *p_worker )
+{
+    atsc_eit_work_t *p_eitwork = container_of( p_work, atsc_eit_work_t, work );
+    const dvbpsi_atsc_eit_t *p_eit = p_eitwork->p_eit;
+
+    /* Use PID for segmenting our EPG tables updates. 1 EIT/PID transmits 3 hours,
+     * with a max of 16 days over 128 EIT/PID. Unlike DVD, table ID is here fixed.
+     * see ATSC A/65 5.0 */
+    vlc_epg_t *p_epg = vlc_epg_New( p_eitwork->i_table_type - ATSC_TABLE_TYPE_EIT_0,
+                                    p_eitwork->i_program_number );
+    if( !p_epg )
+        return;
+
+    /* Use first table as present/following (not split like DVB) */
+    p_epg->b_present = (p_eitwork->i_table_type == ATSC_TABLE_TYPE_EIT_0);
+
+    /* Shared by all the EIT, to avoid iconv reopens */
+    atsc_a65_handle_t *p_a65 = p_worker ? ts_si_worker_GetA65( p_worker )
+                                        : p_eitwork->p_a65;
+    if( !p_a65 )
+    {
+        vlc_epg_Delete( p_epg );
+        return;
+    }
+
+    time_t i_current_event_start_time = 0;
+    size_t i_event = 0;
+    for( const dvbpsi_atsc_eit_event_t *p_evt = p_eit->p_first_event;
+                                        p_evt ; p_evt = p_evt->p_next, i_event++ )
+    {
+        /* Add Event to EPG based on EIT / available ETT */
+        time_t i_start = ATSC_AddVLCEPGEvent( p_eitwork->p_demux, p_a65,
+                                              p_eitwork->i_gps_utc_offset, p_evt,
+                                              p_eitwork->p_etms[i_event].p_data,
+                                              p_eitwork->p_etms[i_event].i_length,
+                                              p_epg );
+
+        /* Try to find current event */
+        if( i_start <= p_eitwork->i_current_time &&
+            i_start + p_evt->i_length_seconds > p_eitwork->i_current_time )
+            i_current_event_start_time = i_start;
+    }
+
+    /* Update epg current time from system time ( required for pruning ) */
+    if( p_epg->b_present && i_current_event_start_time )
+        vlc_epg_SetCurrent( p_epg, i_current_event_start_time );
+
+    p_eitwork->p_epg = p_epg;
+}
+
+static void ATSC_EITWorkComplete( demux_t *p_demux, ts_si_work_t *p_work )
+{
+    atsc_eit_work_t *p_eitwork = container_of( p_work, atsc_eit_work_t, work );
+    demux_sys_t *p_sys = p_demux->p_sys;
+    ts_pid_t *p_eit_pid = p_eitwork->p_eit_pid;
+    ts_pid_t *p_base_pid = GetPID(p_sys, ATSC_BASE_PID);
+
+    /* EIT pid could have been released or reassigned by a new MGT */
+    if( p_eit_pid->type != TYPE_PSIP ||
+        p_eit_pid->u.p_psip->p_ctx->i_tabletype != p_eitwork->i_table_type ||
+        p_base_pid->type != TYPE_PSIP )
+        return;
+
+    ts_psip_context_t *p_basectx = p_base_pid->u.p_psip->p_ctx;
+    vlc_epg_t *p_epg = p_eitwork->p_epg;
+
+    if( p_epg )
+    {
+        if( p_epg->b_present && p_epg->p_current )
+        {
+            ts_pat_t *p_pat = ts_pid_Get(&p_sys->pids, 0)->u.p_pat;
+            ts_pmt_t *p_pmt = ts_pat_Get_pmt(p_pat, p_eitwork->i_program_number);
+            if(p_pmt)
+            {
+                p_pmt->eit.i_event_start = p_epg->p_current->i_start;
+                p_pmt->eit.i_event_length = p_epg->p_current->i_duration;
+            }
+        }
+
+        if( p_epg->i_event > 0 )
+            es_out_Control( p_demux->out, ES_OUT_SET_GROUP_EPG,
+                            (int)p_eitwork->i_program_number, p_epg );
+    }
+
+    /* Catch up with ETT received while converting */
+    const ts_pid_t *pid_sibling_ett = NULL;
+    if( p_basectx->p_mgt && p_basectx->p_stt &&
+        (p_basectx->p_a65 || (p_basectx->p_a65 = atsc_a65_handle_New( NULL ))) )
+        pid_sibling_ett = ATSC_GetSiblingxTTPID( &p_sys->pids, p_basectx->p_mgt,
+                                                 p_eit_pid->u.p_psip );
+    if( pid_sibling_ett && pid_sibling_ett->type == TYPE_PSIP )
+    {
+        const dvbpsi_atsc_eit_t *p_eit = p_eitwork->p_eit;
+        size_t i_event = 0;
+        for( const dvbpsi_atsc_eit_event_t *p_event = p_eit->p_first_event;
+                                            p_event ; p_event = p_event->p_next, i_event++ )
+        {
+            if( p_eitwork->p_etms[i_event].p_data )
+                continue;
+            const dvbpsi_atsc_ett_t *p_ett =
+                    ATSC_ETTFindByETMId( pid_sibling_ett->u.p_psip->p_ctx,
+                                         toETMId( p_eit->i_source_id, p_event->i_event_id ),
+                                         p_eit->i_version );
+            if( !p_ett )
+                continue;
+            vlc_epg_event_t *p_evt = ATSC_CreateVLCEPGEvent( p_demux, p_basectx->p_a65,
+                                                             p_basectx->p_stt->i_gps_utc_offset,
+                                                             p_event, p_ett->p_etm_data,
+                                                             p_ett->i_etm_length );
+            if( likely(p_evt) )
+            {
+                es_out_Control( p_demux->out, ES_OUT_SET_GROUP_EPG_EVENT,
+                                (int)p_eitwork->i_program_number, p_evt );
+                vlc_epg_event_Delete( p_evt );
+            }
+        }
+    }
+
+    ATSC_EITInsert( p_eit_pid->u.p_psip->p_ctx, p_eitwork->p_eit );
+    p_eitwork->p_eit = NULL;
+}
+
+static void ATSC_EITWorkDelete( ts_si_work_t *p_work )
+{
+    atsc_eit_work_t *p_eitwork = container_of( p_work, atsc_eit_work_t, work );
+    for( size_t i=0; i<p_eitwork->i_etms; i++ )
+        free( p_eitwork->p_etms[i].p_data );
+    free( p_eitwork->p_etms );
+    if( p_eitwork->p_epg )
+        vlc_epg_Delete( p_eitwork->p_epg );
+    if( p_eitwork->p_eit )
+        dvbpsi_atsc_DeleteEIT( p_eitwork->p_eit );
+    free( p_eitwork );
+}
 
 static void ATSC_EIT_Callback( void *p_pid, dvbpsi_atsc_eit_t* p_eit )
 {
@@ -443,72 +599,80 @@ static void ATSC_EIT_Callback( void *p_pid, dvbpsi_atsc_eit_t* p_eit )
         return;
     }
 
-    const ts_pid_t *pid_sibling_ett = ATSC_GetSiblingxTTPID( &p_sys->pids, p_basectx->p_mgt,
-                                                     p_eit_pid->u.p_psip );
-
-    /* Get System Time for finding and setting current event */
-    time_t i_current_time = atsc_a65_GPSTimeToEpoch( p_basectx->p_stt->i_system_time,
-                                                     p_basectx->p_stt->i_gps_utc_offset );
-    EIT_DEBUG_TIMESHIFT( i_current_time );
-
-    const uint16_t i_table_type = p_eit_pid->u.p_psip->p_ctx->i_tabletype;
-    assert(i_table_type);
-
-    /* Use PID for segmenting our EPG tables updates. 1 EIT/PID transmits 3 hours,
-     * with a max of 16 days over 128 EIT/PID. Unlike DVD, table ID is here fixed.
-     * see ATSC A/65 5.0 */
-    vlc_epg_t *p_epg = vlc_epg_New( i_table_type - ATSC_TABLE_TYPE_EIT_0,
-                                    i_program_number );
-    if( !p_epg )
+    atsc_eit_work_t *p_eitwork = malloc( sizeof(*p_eitwork) );
+    if( unlikely(!p_eitwork) )
     {
         dvbpsi_atsc_DeleteEIT( p_eit );
         return;
     }
+    p_eitwork->work.pf_run = ATSC_EITWorkRun;
+    p_eitwork->work.pf_complete = ATSC_EITWorkComplete;
+    p_eitwork->work.pf_delete = ATSC_EITWorkDelete;
+    p_eitwork->p_demux = p_demux;
+    p_eitwork->p_eit_pid = p_eit_pid;
+    p_eitwork->p_eit = p_eit;
+    p_eitwork->i_table_type = p_eit_pid->u.p_psip->p_ctx->i_tabletype;
+    assert(p_eitwork->i_table_type);
+    p_eitwork->i_program_number = i_program_number;
+    p_eitwork->p_a65 = NULL;
+    p_eitwork->i_gps_utc_offset = p_basectx->p_stt->i_gps_utc_offset;
+    p_eitwork->p_epg = NULL;
 
-    /* Use first table as present/following (not split like DVB) */
-    p_epg->b_present = (i_table_type == ATSC_TABLE_TYPE_EIT_0);
-
-    if( !p_basectx->p_a65 && !(p_basectx->p_a65 = atsc_a65_handle_New( NULL )) )
-        goto end;
+    /* Get System Time for finding and setting current event */
+    p_eitwork->i_current_time = atsc_a65_GPSTimeToEpoch( p_basectx->p_stt->i_system_time,
+                                                         p_basectx->p_stt->i_gps_utc_offset );
+    EIT_DEBUG_TIMESHIFT( p_eitwork->i_current_time );
 
-    time_t i_current_event_start_time = 0;
+    p_eitwork->i_etms = 0;
     for( const dvbpsi_atsc_eit_event_t *p_evt = p_eit->p_first_event;
                                         p_evt ; p_evt = p_evt->p_next )
+        p_eitwork->i_etms++;
+    p_eitwork->p_etms = calloc( p_eitwork->i_etms ? p_eitwork->i_etms : 1,
+                                sizeof(*p_eitwork->p_etms) );
+    if( unlikely(!p_eitwork->p_etms) )
     {
-        /* Try to match ETT */
-        const dvbpsi_atsc_ett_t *p_ett = NULL;
-        if( pid_sibling_ett )
-            p_ett = ATSC_ETTFindByETMId( pid_sibling_ett->u.p_psip->p_ctx,
-                                         toETMId( p_eit->i_source_id, p_evt->i_event_id ),
-                                         p_eit->i_version );
-
-        /* Add Event to EPG based on EIT / available ETT */
-        time_t i_start = ATSC_AddVLCEPGEvent( p_demux, p_basectx, p_evt, p_ett, p_epg );
-
-        /* Try to find current event */
-        if( i_start <= i_current_time && i_start + p_evt->i_length_seconds > i_current_time )
-            i_current_event_start_time = i_start;
+        p_eitwork->i_etms = 0;
+        ATSC_EITWorkDelete( &p_eitwork->work );
+        return;
     }
 
-    /* Update epg current time from system time ( required for pruning ) */
-    if( p_epg->b_present && i_current_event_start_time )
+    const ts_pid_t *pid_sibling_ett = ATSC_GetSiblingxTTPID( &p_sys->pids, p_basectx->p_mgt,
+                                                     p_eit_pid->u.p_psip );
+    if( pid_sibling_ett )
     {
-        vlc_epg_SetCurrent( p_epg, i_current_event_start_time );
-        ts_pat_t *p_pat = ts_pid_Get(&p_sys->pids, 0)->u.p_pat;
-        ts_pmt_t *p_pmt = ts_pat_Get_pmt(p_pat, i_program_number);
-        if(p_pmt)
+        size_t i_event = 0;
+        for( const dvbpsi_atsc_eit_event_t *p_evt = p_eit->p_first_event;
+                                            p_evt ; p_evt = p_evt->p_next, i_event++ )
         {
-            p_pmt->eit.i_event_start = p_epg->p_current->i_start;
-            p_pmt->eit.i_event_length = p_epg->p_current->i_duration;
+            /* Try to match ETT */
+            const dvbpsi_atsc_ett_t *p_ett =
+                    ATSC_ETTFindByETMId( pid_sibling_ett->u.p_psip->p_ctx,
+                                         toETMId( p_eit->i_source_id, p_evt->i_event_id ),
+                                         p_eit->i_version );
+            if( p_ett && p_ett->i_etm_length &&
+                (p_eitwork->p_etms[i_event].p_data = malloc( p_ett->i_etm_length )) )
+            {
+                memcpy( p_eitwork->p_etms[i_event].p_data, p_ett->p_etm_data,
+                        p_ett->i_etm_length );
+                p_eitwork->p_etms[i_event].i_length = p_ett->i_etm_length;
+            }
         }
     }
 
-    if( p_epg->i_event > 0 )
-        es_out_Control( p_demux->out, ES_OUT_SET_GROUP_EPG, (int)i_program_number, p_epg );
-
-end:
-    vlc_epg_Delete( p_epg );
-    ATSC_EITInsert( p_eit_pid->u.p_psip->p_ctx, p_eit );
+    ts_si_worker_t *p_worker = GetSIWorker( p_demux );
+    if( p_worker )
+    {
+        ts_si_worker_Push( p_worker, &p_eitwork->work );
+    }
+    else
+    {
+        if( !p_basectx->p_a65 )
+            p_basectx->p_a65 = atsc_a65_handle_New( NULL );
+        p_eitwork->p_a65 = p_basectx->p_a65;
+        ATSC_EITWorkRun( &p_eitwork->work, NULL );
+        ATSC_EITWorkComplete( p_demux, &p_eitwork->work );
+        ATSC_EITWorkDelete( &p_eitwork->work );
+    }
 }
 
 static void ATSC_ETT_Callback( void *p_pid, dvbpsi_atsc_ett_t *p_ett )
@@ -555,7 +719,12 @@ static void ATSC_ETT_Callback( void *p_pid, dvbpsi_atsc_ett_t *p_ett )
 #ifdef ATSC_DEBUG_EIT
                     msg_Dbg( p_demux, "Should update EIT %x (matched EIT)", p_event->i_event_id );
 #endif
-                    vlc_epg_event_t *p_evt = ATSC_CreateVLCEPGEvent( p_demux, p_basectx, p_event, p_ett );
+                    vlc_epg_event_t *p_evt = NULL;
+                    if( p_basectx->p_a65 || (p_basectx->p_a65 = atsc_a65_handle_New( NULL )) )
+                        p_evt = ATSC_CreateVLCEPGEvent( p_demux, p_basectx->p_a65,
+                                                        p_basectx->p_stt->i_gps_utc_offset,
+                                                        p_event, p_ett->p_etm_data,
+                                                        p_ett->i_etm_length );
                     if( likely(p_evt) )
                     {
                         es_out_Control( p_demux->out, ES_OUT_SET_GROUP_EPG_EVENT,
@@ -709,6 +878,7 @@ static void ATSC_MGT_Callback( void *p_cb_basepid, dvbpsi_atsc_mgt_t* p_mgt )
         {
             dvbpsi_DetachDemuxSubDecoder( p_dvbpsi_demux, p_subdec );
             dvbpsi_DeleteDemuxSubDecoder( p_subdec );
+            ts_psi_cache_Reset( &p_mgtpsip->cache );
         }
     }
 
@@ -41,6 +41,7 @@
 #include "ts_si.h"
 #include "ts_arib.h"
 #include "ts_decoders.h"
+#include "ts_si_worker.h"
 
 #include "ts_pid.h"
 #include "ts_streams_private.h"
@@ -75,17 +76,17 @@ void ts_si_Packet_Push( ts_pid_t *p_pid, const uint8_t *p_pktbuffer )
 {
     if( likely(p_pid->type == TYPE_SI) &&
         dvbpsi_decoder_present( p_pid->u.p_si->handle ) )
-        dvbpsi_packet_push( p_pid->u.p_si->handle, (uint8_t *) p_pktbuffer );
+        ts_psi_cache_Push( &p_pid->u.p_si->cache, p_pid->u.p_si->handle, p_pktbuffer );
 }
 
-static char *EITConvertToUTF8( demux_t *p_demux,
+static char *EITConvertToUTF8( demux_t *p_demux, ts_standards_e standard,
                                const unsigned char *psz_instring,
                                size_t i_length,
                                bool b_broken )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
 #ifdef HAVE_ARIBB24
-    if( p_sys->standard == TS_STANDARD_ARIB )
+    if( standard == TS_STANDARD_ARIB )
     {
         if ( !p_sys->arib.p_instance )
             p_sys->arib.p_instance = arib_instance_new( p_demux );
@@ -112,6 +113,7 @@ static char *EITConvertToUTF8( demux_t *p_demux,
     }
 #else
     VLC_UNUSED(p_sys);
+    VLC_UNUSED(standard);
 #endif
     /* Deal with no longer broken providers (no switch byte
       but sending ISO_8859-1 instead of ISO_6937) without
@@ -251,11 +253,11 @@ static void SDTCallBack( demux_t *p_demux, dvbpsi_sdt_t *p_sdt )
 
                 /* FIXME: Digital+ ES also uses ISO8859-1 */
 
-                str1 = EITConvertToUTF8(p_demux,
+                str1 = EITConvertToUTF8(p_demux, p_sys->standard,
                                         pD->i_service_provider_name,
                                         pD->i_service_provider_name_length,
                                         p_sys->b_broken_charset );
-                str2 = EITConvertToUTF8(p_demux,
+                str2 = EITConvertToUTF8(p_demux, p_sys->standard,
                                         pD->i_service_name,
                                         pD->i_service_name_length,
                                         p_sys->b_broken_charset );
@@ -402,10 +404,28 @@ static void TDTCallBack( demux_t *p_demux, dvbpsi_tot_t *p_tdt )
     es_out_Control( p_demux->out, ES_OUT_SET_EPG_TIME, (int64_t) p_sys->i_network_time );
 }
 
-static void EITExtractDrDescItems( demux_t *p_demux, const dvbpsi_extended_event_dr_t *pE,
+/* EIT conversion settings, copied from the demux when converting from
+ * the SI worker */
+typedef struct
+{
+    demux_t       *p_demux;
+    ts_standards_e standard;
+    bool           b_broken_charset;
+    time_t         i_network_time;
+} eit_conv_t;
+
+static inline char *EITConvToUTF8( const eit_conv_t *p_conv,
+                                   const unsigned char *psz_instring,
+                                   size_t i_length )
+{
+    return EITConvertToUTF8( p_conv->p_demux, p_conv->standard,
+                             psz_instring, i_length, p_conv->b_broken_charset );
+}
+
+static void EITExtractDrDescItems( const eit_conv_t *p_conv, const dvbpsi_extended_event_dr_t *pE,
                                    vlc_epg_event_t *p_evt )
 {
-    demux_sys_t *p_sys = p_demux->p_sys;
+    demux_t *p_demux = p_conv->p_demux;
 
     if( pE->i_entry_count )
     {
@@ -435,10 +455,9 @@ static void EITExtractDrDescItems( demux_t *p_demux, const dvbpsi_extended_event
                 }
                 p_evt->description_items = p_realloc;
 
-                psz_key = EITConvertToUTF8( p_demux,
-                                            pE->i_item_description[i],
-                                            pE->i_item_description_length[i],
-                                            p_sys->b_broken_charset );
+                psz_key = EITConvToUTF8( p_conv,
+                                         pE->i_item_description[i],
+                                         pE->i_item_description_length[i] );
                 if( !psz_key )
                 {
                     ppsz_prev = NULL;
@@ -448,9 +467,7 @@ static void EITExtractDrDescItems( demux_t *p_demux, const dvbpsi_extended_event
             else if( ppsz_prev == NULL )
                 continue;
 
-            char *psz_itm = EITConvertToUTF8( p_demux,
-                                              pE->i_item[i], pE->i_item_length[i],
-                                              p_sys->b_broken_charset );
+            char *psz_itm = EITConvToUTF8( p_conv, pE->i_item[i], pE->i_item_length[i] );
             if( !psz_itm )
             {
                 free( psz_key );
@@ -482,39 +499,22 @@ static void EITExtractDrDescItems( demux_t *p_demux, const dvbpsi_extended_event
     }
 }
 
-static void EITCallBack( demux_t *p_demux, dvbpsi_eit_t *p_eit )
+/* Converts the EIT events to a VLC EPG, does not use the demux state */
+static vlc_epg_t * EITConvert( const eit_conv_t *p_conv, const dvbpsi_eit_t *p_eit )
 {
-    demux_sys_t        *p_sys = p_demux->p_sys;
+    demux_t *p_demux = p_conv->p_demux;
     const dvbpsi_eit_event_t *p_evt;
     uint64_t i_runevt = 0;
     uint64_t i_fallbackevt = 0;
     vlc_epg_t *p_epg;
 
-    msg_Dbg( p_demux, "EITCallBack called" );
-    if( !p_eit->b_current_next )
-    {
-        dvbpsi_eit_delete( p_eit );
-        return;
-    }
-
-    msg_Dbg( p_demux, "new EIT service_id=%"PRIu16" version=%"PRIu8" current_next=%d "
-             "ts_id=%"PRIu16" network_id=%"PRIu16" segment_last_section_number=%"PRIu8" "
-             "last_table_id=%"PRIu8,
-             p_eit->i_extension,
-             p_eit->i_version, p_eit->b_current_next,
-             p_eit->i_ts_id, p_eit->i_network_id,
-             p_eit->i_segment_last_section_number, p_eit->i_last_table_id );
-
     /* Use table ID for segmenting our EPG tables updates. 1 table id has 256 sections which
      * represents 8 segements of 32 sections each. Thus a max of 24 hours per table ID
      * (Should be even better with tableid+segmentid compound if dvbpsi would export segment id)
      * see TS 101 211, 4.1.4.2.1 */
     p_epg = vlc_epg_New( p_eit->i_table_id, p_eit->i_extension );
     if( !p_epg )
-    {
-        dvbpsi_eit_delete( p_eit );
-        return;
-    }
+        return NULL;
 
     for( p_evt = p_eit->p_first_event; p_evt; p_evt = p_evt->p_next )
     {
@@ -527,7 +527,7 @@ static void EITCallBack( demux_t *p_demux, dvbpsi_eit_t *p_eit )
         i_duration = EITConvertDuration( p_evt->i_duration );
 
         /* We have to fix ARIB-B10 as all timestamps are JST */
-        if( p_sys->standard == TS_STANDARD_ARIB )
+        if( p_conv->standard == TS_STANDARD_ARIB )
         {
             /* See comments on TDT callback */
             i_start += 9 * 3600;
@@ -567,14 +567,10 @@ static void EITCallBack( demux_t *p_demux, dvbpsi_eit_t *p_eit )
                 {
                     char **ppsz = &p_epgevt->psz_name;
                     free( *ppsz );
-                    *ppsz = EITConvertToUTF8( p_demux,
-                                              pE->i_event_name, pE->i_event_name_length,
-                                              p_sys->b_broken_charset );
+                    *ppsz = EITConvToUTF8( p_conv, pE->i_event_name, pE->i_event_name_length );
                     ppsz = &p_epgevt->psz_short_description;
                     free( *ppsz );
-                    *ppsz = EITConvertToUTF8( p_demux,
-                                              pE->i_text, pE->i_text_length,
-                                              p_sys->b_broken_charset );
+                    *ppsz = EITConvToUTF8( p_conv, pE->i_text, pE->i_text_length );
                     msg_Dbg( p_demux, "    - short event lang=%3.3s '%s' : '%s'",
                              pE->i_iso_639_code, p_epgevt->psz_name, *ppsz );
                 }
@@ -592,9 +588,7 @@ static void EITCallBack( demux_t *p_demux, dvbpsi_eit_t *p_eit )
 
                     if( pE->i_text_length > 0 )
                     {
-                        char *psz_text = EITConvertToUTF8( p_demux,
-                                                           pE->i_text, pE->i_text_length,
-                                                           p_sys->b_broken_charset );
+                        char *psz_text = EITConvToUTF8( p_conv, pE->i_text, pE->i_text_length );
                         if( psz_text )
                         {
                             msg_Dbg( p_demux, "       - text='%s'", psz_text );
@@ -617,7 +611,7 @@ static void EITCallBack( demux_t *p_demux, dvbpsi_eit_t *p_eit )
                         }
                     }
 
-                    EITExtractDrDescItems( p_demux, pE, p_epgevt );
+                    EITExtractDrDescItems( p_conv, pE, p_epgevt );
                 }
             }
                 break;
@@ -659,8 +653,8 @@ static void EITCallBack( demux_t *p_demux, dvbpsi_eit_t *p_eit )
             case TS_SI_RUNSTATUS_UNDEFINED:
             {
                 if( i_fallbackevt == 0 &&
-                    i_start <= p_sys->i_network_time &&
-                    p_sys->i_network_time < i_start + i_duration )
+                    i_start <= p_conv->i_network_time &&
+                    p_conv->i_network_time < i_start + i_duration )
                     i_fallbackevt = i_start;
                 break;
             }
@@ -673,22 +667,114 @@ static void EITCallBack( demux_t *p_demux, dvbpsi_eit_t *p_eit )
     if( i_runevt || i_fallbackevt )
         vlc_epg_SetCurrent( p_epg, (i_runevt) ? i_runevt : i_fallbackevt );
 
+    return p_epg;
+}
+
+static void EITSendEPG( demux_t *p_demux, vlc_epg_t *p_epg,
+                        uint8_t i_table_id, uint16_t i_extension )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
     if( p_epg->i_event > 0 )
     {
         if( p_epg->b_present && p_epg->p_current )
         {
             ts_pat_t *p_pat = ts_pid_Get(&p_sys->pids, 0)->u.p_pat;
-            ts_pmt_t *p_pmt = ts_pat_Get_pmt(p_pat, p_eit->i_extension);
+            ts_pmt_t *p_pmt = ts_pat_Get_pmt(p_pat, i_extension);
             if(p_pmt)
             {
                 p_pmt->eit.i_event_start = p_epg->p_current->i_start;
                 p_pmt->eit.i_event_length = p_epg->p_current->i_duration;
             }
         }
-        p_epg->b_present = (p_eit->i_table_id == 0x4e);
-        es_out_Control( p_demux->out, ES_OUT_SET_GROUP_EPG, p_eit->i_extension, p_epg );
+        p_epg->b_present = (i_table_id == 0x4e);
+        es_out_Control( p_demux->out, ES_OUT_SET_GROUP_EPG, i_extension, p_epg );
+    }
+}
+
+typedef struct
+{
+    ts_si_work_t  work;
+    eit_conv_t    conv;
+    dvbpsi_eit_t *p_eit;
+    vlc_epg_t    *p_epg;
+} eit_work_t;
+
+static void EITWorkRun( ts_si_work_t *p_work, ts_si_worker_t *p_worker )
+{
+    VLC_UNUSED( p_worker );
+    eit_work_t *p_eitwork = container_of( p_work, eit_work_t, work );
+    p_eitwork->p_epg = EITConvert( &p_eitwork->conv, p_eitwork->p_eit );
+}
+
+static void EITWorkComplete( demux_t *p_demux, ts_si_work_t *p_work )
+{
+    eit_work_t *p_eitwork = container_of( p_work, eit_work_t, work );
+    if( p_eitwork->p_epg )
+        EITSendEPG( p_demux, p_eitwork->p_epg,
+                    p_eitwork->p_eit->i_table_id, p_eitwork->p_eit->i_extension );
+}
+
+static void EITWorkDelete( ts_si_work_t *p_work )
+{
+    eit_work_t *p_eitwork = container_of( p_work, eit_work_t, work );
+    if( p_eitwork->p_epg )
+        vlc_epg_Delete( p_eitwork->p_epg );
+    dvbpsi_eit_delete( p_eitwork->p_eit );
+    free( p_eitwork );
+}
+
+static void EITCallBack( demux_t *p_demux, dvbpsi_eit_t *p_eit )
+{
+    demux_sys_t        *p_sys = p_demux->p_sys;
+
+    msg_Dbg( p_demux, "EITCallBack called" );
+    if( !p_eit->b_current_next )
+    {
+        dvbpsi_eit_delete( p_eit );
+        return;
+    }
+
+    msg_Dbg( p_demux, "new EIT service_id=%"PRIu16" version=%"PRIu8" current_next=%d "
+             "ts_id=%"PRIu16" network_id=%"PRIu16" segment_last_section_number=%"PRIu8" "
+             "last_table_id=%"PRIu8,
+             p_eit->i_extension,
+             p_eit->i_version, p_eit->b_current_next,
+             p_eit->i_ts_id, p_eit->i_network_id,
+             p_eit->i_segment_last_section_number, p_eit->i_last_table_id );
+
+    const eit_conv_t conv = {
+        .p_demux = p_demux,
+        .standard = p_sys->standard,
+        .b_broken_charset = p_sys->b_broken_charset,
+        .i_network_time = p_sys->i_network_time,
+    };
+
+    /* ARIB conversion uses the demux aribb24 instance */
+    ts_si_worker_t *p_worker = conv.standard != TS_STANDARD_ARIB
+                             ? GetSIWorker( p_demux ) : NULL;
+    if( p_worker )
+    {
+        eit_work_t *p_eitwork = malloc( sizeof(*p_eitwork) );
+        if( likely(p_eitwork) )
+        {
+            p_eitwork->work.pf_run = EITWorkRun;
+            p_eitwork->work.pf_complete = EITWorkComplete;
+            p_eitwork->work.pf_delete = EITWorkDelete;
+            p_eitwork->conv = conv;
+            p_eitwork->p_eit = p_eit;
+            p_eitwork->p_epg = NULL;
+            ts_si_worker_Push( p_worker, &p_eitwork->work );
+            return;
+        }
+    }
+
+    vlc_epg_t *p_epg = EITConvert( &conv, p_eit );
+    if( p_epg )
+    {
+        EITSendEPG( p_demux, p_epg, p_eit->i_table_id, p_eit->i_extension );
+        vlc_epg_Delete( p_epg );
     }
-    vlc_epg_Delete( p_epg );
 
     dvbpsi_eit_delete( p_eit );
 }
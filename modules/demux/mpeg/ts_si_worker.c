@@ -0,0 +1,170 @@
+/*****************************************************************************
+ * ts_si_worker.c : TS demux SI tables asynchronous processing
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_atomic.h>
+
+#include "ts_si_worker.h"
+
+#include "../codec/atsc_a65.h"
+
+struct ts_si_worker_t
+{
+    vlc_thread_t  thread;
+    vlc_mutex_t   lock;
+    vlc_cond_t    wait;
+    bool          b_exit;
+    atomic_bool   b_done;
+
+    ts_si_work_t  *p_pending;
+    ts_si_work_t **pp_pending_last;
+    ts_si_work_t  *p_done;
+    ts_si_work_t **pp_done_last;
+
+    atsc_a65_handle_t *p_a65; /* worker thread */
+};
+
+static void WorkChainDelete( ts_si_work_t *p_work )
+{
+    while( p_work )
+    {
+        ts_si_work_t *p_next = p_work->p_next;
+        p_work->pf_delete( p_work );
+        p_work = p_next;
+    }
+}
+
+static void *Run( void *data )
+{
+    ts_si_worker_t *p_worker = data;
+
+    vlc_mutex_lock( &p_worker->lock );
+    for( ;; )
+    {
+        while( !p_worker->b_exit && p_worker->p_pending == NULL )
+            vlc_cond_wait( &p_worker->wait, &p_worker->lock );
+        if( p_worker->b_exit )
+            break;
+
+        ts_si_work_t *p_work = p_worker->p_pending;
+        p_worker->p_pending = p_work->p_next;
+        if( p_worker->p_pending == NULL )
+            p_worker->pp_pending_last = &p_worker->p_pending;
+        p_work->p_next = NULL;
+        vlc_mutex_unlock( &p_worker->lock );
+
+        p_work->pf_run( p_work, p_worker );
+
+        vlc_mutex_lock( &p_worker->lock );
+        *p_worker->pp_done_last = p_work;
+        p_worker->pp_done_last = &p_work->p_next;
+        atomic_store_explicit( &p_worker->b_done, true, memory_order_release );
+    }
+    vlc_mutex_unlock( &p_worker->lock );
+
+    return NULL;
+}
+
+ts_si_worker_t * ts_si_worker_New( vlc_object_t *p_obj )
+{
+    ts_si_worker_t *p_worker = malloc( sizeof(*p_worker) );
+    if( !p_worker )
+        return NULL;
+
+    vlc_mutex_init( &p_worker->lock );
+    vlc_cond_init( &p_worker->wait );
+    p_worker->b_exit = false;
+    atomic_init( &p_worker->b_done, false );
+    p_worker->p_pending = NULL;
+    p_worker->pp_pending_last = &p_worker->p_pending;
+    p_worker->p_done = NULL;
+    p_worker->pp_done_last = &p_worker->p_done;
+    p_worker->p_a65 = NULL;
+
+    if( vlc_clone( &p_worker->thread, Run, p_worker, VLC_THREAD_PRIORITY_LOW ) )
+    {
+        msg_Warn( p_obj, "cannot start SI worker thread" );
+        vlc_cond_destroy( &p_worker->wait );
+        vlc_mutex_destroy( &p_worker->lock );
+        free( p_worker );
+        return NULL;
+    }
+
+    return p_worker;
+}
+
+void ts_si_worker_Delete( ts_si_worker_t *p_worker )
+{
+    vlc_mutex_lock( &p_worker->lock );
+    p_worker->b_exit = true;
+    vlc_cond_signal( &p_worker->wait );
+    vlc_mutex_unlock( &p_worker->lock );
+
+    vlc_join( p_worker->thread, NULL );
+
+    WorkChainDelete( p_worker->p_pending );
+    WorkChainDelete( p_worker->p_done );
+    if( p_worker->p_a65 )
+        atsc_a65_handle_Release( p_worker->p_a65 );
+    vlc_cond_destroy( &p_worker->wait );
+    vlc_mutex_destroy( &p_worker->lock );
+    free( p_worker );
+}
+
+void ts_si_worker_Push( ts_si_worker_t *p_worker, ts_si_work_t *p_work )
+{
+    p_work->p_next = NULL;
+    vlc_mutex_lock( &p_worker->lock );
+    *p_worker->pp_pending_last = p_work;
+    p_worker->pp_pending_last = &p_work->p_next;
+    vlc_cond_signal( &p_worker->wait );
+    vlc_mutex_unlock( &p_worker->lock );
+}
+
+void ts_si_worker_Complete( ts_si_worker_t *p_worker, demux_t *p_demux )
+{
+    if( !atomic_load_explicit( &p_worker->b_done, memory_order_acquire ) )
+        return;
+
+    vlc_mutex_lock( &p_worker->lock );
+    ts_si_work_t *p_work = p_worker->p_done;
+    p_worker->p_done = NULL;
+    p_worker->pp_done_last = &p_worker->p_done;
+    atomic_store_explicit( &p_worker->b_done, false, memory_order_relaxed );
+    vlc_mutex_unlock( &p_worker->lock );
+
+    while( p_work )
+    {
+        ts_si_work_t *p_next = p_work->p_next;
+        p_work->pf_complete( p_demux, p_work );
+        p_work->pf_delete( p_work );
+        p_work = p_next;
+    }
+}
+
+atsc_a65_handle_t * ts_si_worker_GetA65( ts_si_worker_t *p_worker )
+{
+    /* Keeps the iconv opened across the works */
+    if( !p_worker->p_a65 )
+        p_worker->p_a65 = atsc_a65_handle_New( NULL );
+    return p_worker->p_a65;
+}
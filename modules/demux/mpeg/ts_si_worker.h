@@ -0,0 +1,50 @@
+/*****************************************************************************
+ * ts_si_worker.h : TS demux SI tables asynchronous processing
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+#ifndef VLC_TS_SI_WORKER_H
+#define VLC_TS_SI_WORKER_H
+
+/* Runs the expensive part of tables processing (EPG text conversions)
+ * outside of the demux thread. Works are run in order, then completed in
+ * the same order from the demux thread, where es_out and the pids can be
+ * used. Works must not reference demux state from pf_run. */
+
+typedef struct ts_si_work_t ts_si_work_t;
+typedef struct ts_si_worker_t ts_si_worker_t;
+typedef struct atsc_a65_handle_t atsc_a65_handle_t;
+
+struct ts_si_work_t
+{
+    ts_si_work_t *p_next;
+    void (*pf_run)( ts_si_work_t *, ts_si_worker_t * ); /* worker thread */
+    void (*pf_complete)( demux_t *, ts_si_work_t * ); /* demux thread */
+    void (*pf_delete)( ts_si_work_t * );
+};
+
+ts_si_worker_t * ts_si_worker_New( vlc_object_t * );
+/* Drops pending works without completing them */
+void ts_si_worker_Delete( ts_si_worker_t * );
+
+void ts_si_worker_Push( ts_si_worker_t *, ts_si_work_t * );
+/* Completes all works done so far */
+void ts_si_worker_Complete( ts_si_worker_t *, demux_t * );
+
+/* ATSC text decoder shared by the works, only for pf_run, NULL on error */
+atsc_a65_handle_t * ts_si_worker_GetA65( ts_si_worker_t * );
+
+#endif
@@ -57,6 +57,14 @@ static inline bool handle_Init( demux_t *p_demux, dvbpsi_t **handle )
     return true;
 }
 
+static void cache_Clean( demux_t *p_demux, ts_psi_cache_t *p_cache )
+{
+    if( p_cache->i_hits )
+        msg_Dbg( p_demux, "PSI cache: %"PRIu64" sections skipped, %"PRIu64" decoded",
+                 p_cache->i_hits, p_cache->i_misses );
+    ts_psi_cache_Clean( p_cache );
+}
+
 ts_pat_t *ts_pat_New( demux_t *p_demux )
 {
     ts_pat_t *pat = malloc( sizeof( ts_pat_t ) );
@@ -73,6 +81,7 @@ ts_pat_t *ts_pat_New( demux_t *p_demux )
     pat->i_ts_id    = -1;
     pat->b_generated = false;
     ARRAY_INIT( pat->programs );
+    ts_psi_cache_Init( &pat->cache, false );
 
     return pat;
 }
@@ -82,6 +91,7 @@ void ts_pat_Del( demux_t *p_demux, ts_pat_t *pat )
     if( dvbpsi_decoder_present( pat->handle ) )
         dvbpsi_pat_detach( pat->handle );
     dvbpsi_delete( pat->handle );
+    cache_Clean( p_demux, &pat->cache );
     for( int i=0; i<pat->programs.i_size; i++ )
         PIDRelease( p_demux, pat->programs.p_elems[i] );
     ARRAY_RESET( pat->programs );
@@ -113,6 +123,7 @@ ts_pmt_t *ts_pmt_New( demux_t *p_demux )
     }
 
     ARRAY_INIT( pmt->e_streams );
+    ts_psi_cache_Init( &pmt->cache, false );
 
     pmt->i_version  = -1;
     pmt->i_number   = -1;
@@ -150,6 +161,7 @@ void ts_pmt_Del( demux_t *p_demux, ts_pmt_t *pmt )
     if( dvbpsi_decoder_present( pmt->handle ) )
         dvbpsi_pmt_detach( pmt->handle );
     dvbpsi_delete( pmt->handle );
+    cache_Clean( p_demux, &pmt->cache );
     for( int i=0; i<pmt->e_streams.i_size; i++ )
         PIDRelease( p_demux, pmt->e_streams.p_elems[i] );
     ARRAY_RESET( pmt->e_streams );
@@ -333,6 +345,7 @@ ts_si_t *ts_si_New( demux_t *p_demux )
     si->eitpid = NULL;
     si->tdtpid = NULL;
     si->cdtpid = NULL;
+    ts_psi_cache_Init( &si->cache, true );
 
     return si;
 }
@@ -342,6 +355,7 @@ void ts_si_Del( demux_t *p_demux, ts_si_t *si )
     if( dvbpsi_decoder_present( si->handle ) )
         dvbpsi_DetachDemux( si->handle );
     dvbpsi_delete( si->handle );
+    cache_Clean( p_demux, &si->cache );
     if( si->eitpid )
         PIDRelease( p_demux, si->eitpid );
     if( si->tdtpid )
@@ -363,6 +377,7 @@ void ts_psip_Del( demux_t *p_demux, ts_psip_t *psip )
         ATSC_Detach_Dvbpsi_Decoders( psip->handle );
         dvbpsi_delete( psip->handle );
     }
+    cache_Clean( p_demux, &psip->cache );
 
     for( int i=0; i<psip->eit.i_size; i++ )
         PIDRelease( p_demux, psip->eit.p_elems[i] );
@@ -384,6 +399,7 @@ ts_psip_t *ts_psip_New( demux_t *p_demux )
     }
 
     ARRAY_INIT( psip->eit );
+    ts_psi_cache_Init( &psip->cache, true );
     psip->i_version  = -1;
     psip->p_eas_es = NULL;
     psip->p_ctx = ts_psip_context_New();
@@ -24,6 +24,7 @@ typedef struct ts_sections_processor_t ts_sections_processor_t;
 
 #include "mpeg4_iod.h"
 #include "timestamps.h"
+#include "ts_psi_cache.h"
 
 #include <vlc_common.h>
 #include <vlc_es.h>
@@ -34,6 +35,7 @@ struct ts_pat_t
     int             i_ts_id;
     bool            b_generated;
     dvbpsi_t       *handle;
+    ts_psi_cache_t  cache;
     DECL_ARRAY(ts_pid_t *) programs;
 
 };
@@ -41,6 +43,7 @@ struct ts_pat_t
 struct ts_pmt_t
 {
     dvbpsi_t       *handle;
+    ts_psi_cache_t  cache;
     int             i_version;
     int             i_number;
     int             i_pid_pcr;
@@ -145,6 +148,7 @@ typedef struct ts_si_context_t ts_si_context_t;
 struct ts_si_t
 {
     dvbpsi_t *handle;
+    ts_psi_cache_t cache;
     int       i_version;
     /* Track successfully set pid */
     ts_pid_t *eitpid;
@@ -157,6 +161,7 @@ typedef struct ts_psip_context_t ts_psip_context_t;
 struct ts_psip_t
 {
     dvbpsi_t       *handle;
+    ts_psi_cache_t  cache;
     int             i_version;
     ts_es_t    *p_eas_es;
     ts_psip_context_t *p_ctx;
@@ -806,6 +806,8 @@ static int DrawStats(intf_thread_t *intf, input_thread_t *p_input)
                 p_stats->i_displayed_pictures);
         MainBoxWrite(sys, l++, _("| frames lost      :    %5"PRIi64),
                 p_stats->i_lost_pictures);
+        MainBoxWrite(sys, l++, _("| decoding time    : %8.3f s"),
+                secf_from_vlc_tick(p_stats->i_video_cpu_time));
     }
     /* Audio*/
     if (i_audio) {
@@ -818,6 +820,8 @@ static int DrawStats(intf_thread_t *intf, input_thread_t *p_input)
                 p_stats->i_played_abuffers);
         MainBoxWrite(sys, l++, _("| buffers lost     :    %5"PRIi64),
                 p_stats->i_lost_abuffers);
+        MainBoxWrite(sys, l++, _("| decoding time    : %8.3f s"),
+                secf_from_vlc_tick(p_stats->i_audio_cpu_time));
     }
     if (sys->color) color_set(C_DEFAULT, NULL);
 
@@ -0,0 +1,393 @@
+/*****************************************************************************
+ * cbr.c: constant bitrate TS packet scheduler
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+
+#include "cbr.h"
+
+#define CBR_PCR_FREQ    INT64_C(27000000)
+#define CBR_PACKET_BITS (188 * 8)
+/* Nominal dates further than this from the packet slots restart the clock */
+#define CBR_RESYNC_DELAY VLC_TICK_FROM_SEC(1)
+
+typedef struct
+{
+    uint16_t   i_pid;
+    int64_t    i_leak_rate;  /* bits/s */
+    int64_t    i_fullness;   /* bits * CLOCK_FREQ */
+    vlc_tick_t i_date;       /* date of i_fullness */
+} cbr_buffer_t;
+
+struct cbr_t
+{
+    int64_t      i_rate;
+    vlc_tick_t   i_pcr_interval;
+
+    /* output clock */
+    bool         b_started;
+    vlc_tick_t   i_origin;       /* date of slot 0 */
+    int64_t      i_pcr_origin;   /* PCR of slot 0, 27MHz */
+    uint64_t     i_slot;         /* next slot */
+    bool         b_discontinuity;
+
+    /* PCR */
+    uint16_t     i_pcr_pid;
+    int          i_pcr_cc;       /* -1 until a packet of the PID is sent */
+    bool         b_pcr_sent;
+    uint64_t     i_pcr_slot;     /* slot of the last PCR */
+
+    size_t       i_buffers;
+    cbr_buffer_t *p_buffers;
+
+    cbr_stats_t  stats;
+};
+
+static inline uint16_t PacketPID( const block_t *p_ts )
+{
+    return ( ( p_ts->p_buffer[1] & 0x1f ) << 8 ) | p_ts->p_buffer[2];
+}
+
+/* a * b / c without overflowing the intermediate product */
+static inline uint64_t MulDiv( uint64_t a, uint64_t b, uint64_t c )
+{
+    return ( a / c ) * b + ( a % c ) * b / c;
+}
+
+static vlc_tick_t SlotDate( const cbr_t *p_cbr, uint64_t i_slot )
+{
+    return p_cbr->i_origin + MulDiv( i_slot, CBR_PACKET_BITS * CLOCK_FREQ,
+                                     p_cbr->i_rate );
+}
+
+static int64_t SlotPCR( const cbr_t *p_cbr, uint64_t i_slot )
+{
+    return p_cbr->i_pcr_origin + MulDiv( i_slot, CBR_PACKET_BITS * CBR_PCR_FREQ,
+                                         p_cbr->i_rate );
+}
+
+cbr_t *cbr_New( int64_t i_rate, vlc_tick_t i_pcr_interval )
+{
+    if( i_rate < CBR_PACKET_BITS )
+        return NULL;
+
+    cbr_t *p_cbr = calloc( 1, sizeof(*p_cbr) );
+    if( unlikely(p_cbr == NULL) )
+        return NULL;
+
+    p_cbr->i_rate = i_rate;
+    p_cbr->i_pcr_interval = i_pcr_interval;
+    p_cbr->i_pcr_pid = 0x1fff;
+    p_cbr->i_pcr_cc = -1;
+    return p_cbr;
+}
+
+void cbr_Delete( cbr_t *p_cbr )
+{
+    free( p_cbr->p_buffers );
+    free( p_cbr );
+}
+
+static cbr_buffer_t *FindBuffer( cbr_t *p_cbr, uint16_t i_pid )
+{
+    for( size_t i = 0; i < p_cbr->i_buffers; i++ )
+        if( p_cbr->p_buffers[i].i_pid == i_pid )
+            return &p_cbr->p_buffers[i];
+    return NULL;
+}
+
+int cbr_SetBuffer( cbr_t *p_cbr, uint16_t i_pid, int64_t i_leak_rate )
+{
+    cbr_buffer_t *p_buffer = FindBuffer( p_cbr, i_pid );
+
+    if( i_leak_rate <= 0 )
+    {
+        if( p_buffer != NULL )
+            *p_buffer = p_cbr->p_buffers[--p_cbr->i_buffers];
+        return VLC_SUCCESS;
+    }
+
+    if( p_buffer == NULL )
+    {
+        p_buffer = realloc( p_cbr->p_buffers,
+                            ( p_cbr->i_buffers + 1 ) * sizeof(*p_buffer) );
+        if( unlikely(p_buffer == NULL) )
+            return VLC_ENOMEM;
+        p_cbr->p_buffers = p_buffer;
+        p_buffer = &p_cbr->p_buffers[p_cbr->i_buffers++];
+        p_buffer->i_pid = i_pid;
+        p_buffer->i_fullness = 0;
+        p_buffer->i_date = VLC_TICK_INVALID;
+    }
+    p_buffer->i_leak_rate = i_leak_rate;
+    return VLC_SUCCESS;
+}
+
+void cbr_SetPCRPID( cbr_t *p_cbr, uint16_t i_pid )
+{
+    if( p_cbr->i_pcr_pid != i_pid )
+    {
+        p_cbr->i_pcr_pid = i_pid;
+        p_cbr->i_pcr_cc = -1;
+    }
+}
+
+void cbr_GetStats( const cbr_t *p_cbr, cbr_stats_t *p_stats )
+{
+    *p_stats = p_cbr->stats;
+}
+
+/* Drain the transport buffer up to i_date, and tell if a packet fits */
+static bool BufferAccepts( cbr_buffer_t *p_buffer, vlc_tick_t i_date )
+{
+    if( p_buffer->i_date != VLC_TICK_INVALID && i_date > p_buffer->i_date )
+    {
+        p_buffer->i_fullness -= p_buffer->i_leak_rate * ( i_date - p_buffer->i_date );
+        if( p_buffer->i_fullness < 0 )
+            p_buffer->i_fullness = 0;
+    }
+    p_buffer->i_date = i_date;
+
+    return p_buffer->i_fullness + CBR_PACKET_BITS * CLOCK_FREQ
+            <= (int64_t)CBR_TB_SIZE * 8 * CLOCK_FREQ;
+}
+
+static void WritePCR( cbr_t *p_cbr, block_t *p_ts, uint64_t i_slot )
+{
+    const int64_t i_pcr = SlotPCR( p_cbr, i_slot );
+    const int64_t i_base = ( i_pcr / 300 ) & INT64_C(0x1ffffffff);
+    const int i_ext = i_pcr % 300;
+
+    p_ts->p_buffer[6]  = ( i_base >> 25 )&0xff;
+    p_ts->p_buffer[7]  = ( i_base >> 17 )&0xff;
+    p_ts->p_buffer[8]  = ( i_base >> 9  )&0xff;
+    p_ts->p_buffer[9]  = ( i_base >> 1  )&0xff;
+    p_ts->p_buffer[10] = ( ( i_base << 7 )&0x80 ) | 0x7e | ( i_ext >> 8 );
+    p_ts->p_buffer[11] = i_ext & 0xff;
+
+    if( p_cbr->b_discontinuity )
+    {
+        p_ts->p_buffer[5] |= 0x80; /* discontinuity_indicator */
+        p_cbr->b_discontinuity = false;
+    }
+
+    /* PCR against the ideal delivery date of the packet */
+    const int64_t i_ideal = p_cbr->i_pcr_origin +
+        ( SlotDate( p_cbr, i_slot ) - p_cbr->i_origin ) * CBR_PCR_FREQ / CLOCK_FREQ;
+    const int64_t i_error = i_pcr > i_ideal ? i_pcr - i_ideal : i_ideal - i_pcr;
+    if( i_error > p_cbr->stats.i_pcr_error_max )
+        p_cbr->stats.i_pcr_error_max = i_error;
+
+    if( p_cbr->b_pcr_sent )
+    {
+        const vlc_tick_t i_interval = SlotDate( p_cbr, i_slot ) -
+                                      SlotDate( p_cbr, p_cbr->i_pcr_slot );
+        if( i_interval > p_cbr->stats.i_pcr_interval_max )
+            p_cbr->stats.i_pcr_interval_max = i_interval;
+    }
+    p_cbr->b_pcr_sent = true;
+    p_cbr->i_pcr_slot = i_slot;
+    p_cbr->stats.i_pcr_packets++;
+}
+
+static block_t *NewPCRPacket( const cbr_t *p_cbr )
+{
+    block_t *p_ts = block_Alloc( 188 );
+    if( likely(p_ts) )
+    {
+        p_ts->p_buffer[0] = 0x47;
+        p_ts->p_buffer[1] = ( p_cbr->i_pcr_pid >> 8 )&0x1f;
+        p_ts->p_buffer[2] = p_cbr->i_pcr_pid & 0xff;
+        /* adaptation field only: the continuity counter is not incremented */
+        p_ts->p_buffer[3] = 0x20 | p_cbr->i_pcr_cc;
+        p_ts->p_buffer[4] = 183;
+        p_ts->p_buffer[5] = 1 << 4; /* PCR_flag */
+        memset( &p_ts->p_buffer[12], 0xff, 176 );
+        p_ts->i_flags |= BLOCK_FLAG_CLOCK;
+    }
+    return p_ts;
+}
+
+static block_t *NewNullPacket( void )
+{
+    block_t *p_ts = block_Alloc( 188 );
+    if( likely(p_ts) )
+    {
+        p_ts->p_buffer[0] = 0x47;
+        p_ts->p_buffer[1] = 0x1f;
+        p_ts->p_buffer[2] = 0xff;
+        p_ts->p_buffer[3] = 0x10;
+        memset( &p_ts->p_buffer[4], 0xff, 184 );
+    }
+    return p_ts;
+}
+
+/* Tell if the next PCR must be sent no later than i_slot */
+static bool PCRDue( const cbr_t *p_cbr, uint64_t i_slot )
+{
+    return p_cbr->i_pcr_cc >= 0 && p_cbr->i_pcr_interval > 0 &&
+           ( !p_cbr->b_pcr_sent ||
+             SlotDate( p_cbr, i_slot + 1 ) - SlotDate( p_cbr, p_cbr->i_pcr_slot )
+               > p_cbr->i_pcr_interval );
+}
+
+static block_t *PCROnly( cbr_t *p_cbr, uint64_t i_slot )
+{
+    /* the PCR packet enters the transport buffer of its PID too */
+    cbr_buffer_t *p_buffer = FindBuffer( p_cbr, p_cbr->i_pcr_pid );
+    if( p_buffer != NULL && !BufferAccepts( p_buffer, SlotDate( p_cbr, i_slot ) ) )
+        return NULL;
+
+    block_t *p_ts = NewPCRPacket( p_cbr );
+    if( likely(p_ts) )
+    {
+        if( p_buffer != NULL )
+            p_buffer->i_fullness += CBR_PACKET_BITS * CLOCK_FREQ;
+        WritePCR( p_cbr, p_ts, i_slot );
+        p_cbr->stats.i_pcr_only_packets++;
+    }
+    return p_ts;
+}
+
+static void Restart( cbr_t *p_cbr, vlc_tick_t i_date, vlc_tick_t i_pcr_origin )
+{
+    p_cbr->i_origin = i_date;
+    p_cbr->i_pcr_origin = ( i_date - i_pcr_origin ) * CBR_PCR_FREQ / CLOCK_FREQ;
+    p_cbr->i_slot = 0;
+    p_cbr->b_pcr_sent = false;
+    for( size_t i = 0; i < p_cbr->i_buffers; i++ )
+    {
+        p_cbr->p_buffers[i].i_fullness = 0;
+        p_cbr->p_buffers[i].i_date = VLC_TICK_INVALID;
+    }
+}
+
+block_t *cbr_Mux( cbr_t *p_cbr, block_t *p_chain, vlc_tick_t i_start,
+                  vlc_tick_t i_length, vlc_tick_t i_pcr_origin )
+{
+    block_t *p_out = NULL;
+    block_t **pp_last = &p_out;
+
+    size_t i_count = 0;
+    for( block_t *p = p_chain; p != NULL; p = p->p_next )
+        i_count++;
+    if( i_count == 0 )
+        return NULL;
+    if( i_length < 0 )
+        i_length = 0;
+
+    if( !p_cbr->b_started )
+    {
+        Restart( p_cbr, i_start, i_pcr_origin );
+        p_cbr->b_started = true;
+    }
+    else
+    {
+        const vlc_tick_t i_next = SlotDate( p_cbr, p_cbr->i_slot );
+        if( i_start > i_next + CBR_RESYNC_DELAY ||
+            i_start + CBR_RESYNC_DELAY < i_next )
+        {
+            /* timestamp jump, or a rate too low for the input */
+            Restart( p_cbr, i_start, i_pcr_origin );
+            p_cbr->b_discontinuity = true;
+            p_cbr->stats.i_resyncs++;
+        }
+    }
+
+    const vlc_tick_t i_slot_length = SlotDate( p_cbr, 1 ) - SlotDate( p_cbr, 0 );
+
+    for( size_t i = 0; p_chain != NULL; )
+    {
+        const uint64_t i_slot = p_cbr->i_slot++;
+        const vlc_tick_t i_date = SlotDate( p_cbr, i_slot );
+        const vlc_tick_t i_nominal = i_start + i_length * i / i_count;
+        block_t *p_ts = NULL;
+
+        /* PCR packets of the ES take precedence over PCR only ones */
+        if( PCRDue( p_cbr, i_slot ) &&
+            ( i_nominal > i_date || !( p_chain->i_flags & BLOCK_FLAG_CLOCK ) ||
+              PacketPID( p_chain ) != p_cbr->i_pcr_pid ) )
+            p_ts = PCROnly( p_cbr, i_slot );
+
+        if( p_ts == NULL && i_nominal <= i_date )
+        {
+            cbr_buffer_t *p_buffer = FindBuffer( p_cbr, PacketPID( p_chain ) );
+
+            if( p_buffer == NULL || BufferAccepts( p_buffer, i_date ) )
+            {
+                p_ts = p_chain;
+                p_chain = p_chain->p_next;
+                p_ts->p_next = NULL;
+                i++;
+
+                if( p_buffer != NULL )
+                {
+                    p_buffer->i_fullness += CBR_PACKET_BITS * CLOCK_FREQ;
+                    const int i_bytes = p_buffer->i_fullness / ( 8 * CLOCK_FREQ );
+                    if( i_bytes > p_cbr->stats.i_tb_max )
+                        p_cbr->stats.i_tb_max = i_bytes;
+                }
+
+                const vlc_tick_t i_late = i_date - i_nominal;
+                if( i_late > i_slot_length )
+                {
+                    p_cbr->stats.i_late_packets++;
+                    if( i_late > p_cbr->stats.i_late_max )
+                        p_cbr->stats.i_late_max = i_late;
+                }
+
+                if( PacketPID( p_ts ) == p_cbr->i_pcr_pid )
+                    p_cbr->i_pcr_cc = p_ts->p_buffer[3] & 0x0f;
+
+                if( ( p_ts->i_flags & BLOCK_FLAG_CLOCK ) &&
+                    ( p_ts->p_buffer[3] & 0x20 ) && p_ts->p_buffer[4] >= 7 &&
+                    ( p_ts->p_buffer[5] & 0x10 ) )
+                {
+                    /* The packet data can be shared with other outputs */
+                    p_ts = block_Unshare( p_ts );
+                    if( likely(p_ts != NULL) )
+                        WritePCR( p_cbr, p_ts, i_slot );
+                }
+            }
+            else
+                p_cbr->stats.i_tb_stalls++;
+        }
+
+        if( p_ts == NULL )
+        {
+            if( ( p_ts = NewNullPacket() ) == NULL )
+                continue;
+            p_cbr->stats.i_null_packets++;
+        }
+
+        p_ts->i_dts = i_date;
+        p_ts->i_length = i_slot_length;
+        p_cbr->stats.i_packets++;
+
+        *pp_last = p_ts;
+        pp_last = &p_ts->p_next;
+    }
+
+    return p_out;
+}
@@ -0,0 +1,67 @@
+/*****************************************************************************
+ * cbr.h: constant bitrate TS packet scheduler
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_MPEG_CBR_H_
+#define VLC_MPEG_CBR_H_
+
+/* The scheduler sends one 188 bytes packet every slot of a constant rate
+ * output. Packets are not sent before their nominal date nor while the
+ * T-STD transport buffer of their PID would overflow: such slots, as well
+ * as the ones left empty, are filled with null packets or with adaptation
+ * field only PCR packets when the PCR interval is reached. PCR values are
+ * derived from the packet position in the output, so they are exact. */
+
+#define CBR_TB_SIZE 512 /* bytes, T-STD transport buffer */
+
+typedef struct
+{
+    uint64_t   i_packets;          /* total packets sent */
+    uint64_t   i_null_packets;     /* stuffing packets sent */
+    uint64_t   i_pcr_packets;      /* packets carrying a PCR */
+    uint64_t   i_pcr_only_packets; /* adaptation field only PCR packets */
+    vlc_tick_t i_pcr_interval_max;
+    int64_t    i_pcr_error_max;    /* PCR vs delivery date, 27MHz ticks */
+    uint64_t   i_late_packets;     /* packets sent after their nominal date */
+    vlc_tick_t i_late_max;
+    uint64_t   i_tb_stalls;        /* slots waiting for a transport buffer */
+    int        i_tb_max;           /* highest transport buffer fullness, bytes */
+    unsigned   i_resyncs;
+} cbr_stats_t;
+
+typedef struct cbr_t cbr_t;
+
+cbr_t *cbr_New( int64_t i_rate, vlc_tick_t i_pcr_interval );
+void   cbr_Delete( cbr_t * );
+
+/* Declare the T-STD transport buffer leak rate (Rx, bits/s) of a PID,
+ * a rate of 0 removes it. PIDs without buffer are not constrained. */
+int    cbr_SetBuffer( cbr_t *, uint16_t i_pid, int64_t i_leak_rate );
+void   cbr_SetPCRPID( cbr_t *, uint16_t i_pid );
+
+/* Schedule a chain of TS packets whose nominal dates spread over
+ * [i_start, i_start + i_length]. Returns the chain to send, with null
+ * packets inserted, i_dts set to the delivery date and PCR written in
+ * packets flagged with BLOCK_FLAG_CLOCK, relative to i_pcr_origin. */
+block_t *cbr_Mux( cbr_t *, block_t *p_chain, vlc_tick_t i_start,
+                  vlc_tick_t i_length, vlc_tick_t i_pcr_origin );
+
+void   cbr_GetStats( const cbr_t *, cbr_stats_t * );
+
+#endif
@@ -45,6 +45,7 @@
 #include "bits.h"
 #include "pes.h"
 #include "csa.h"
+#include "cbr.h"
 #include "tsutil.h"
 #include "streams.h"
 
@@ -187,6 +188,20 @@ static const char *const ts_standards_list_text[] =
     "The encryption routines subtract the TS-header from the value before " \
     "encrypting." )
 
+#define MUXRATE_TEXT N_("Mux rate (bits/s)")
+#define MUXRATE_LONGTEXT N_("Output a constant bitrate stream: packets are " \
+  "sent at a constant interval, with null packets filling the unused " \
+  "bandwidth, and the PCRs are computed from the packet positions. " \
+  "0 outputs a variable bitrate stream.")
+
+#define OUTPUTS_TEXT N_("Additional outputs")
+#define OUTPUTS_LONGTEXT N_("Send the same programs to other outputs, " \
+  "sharing the PES packetization of this muxer but with their own PID " \
+  "mapping, PSI tables and optional constant bitrate. Syntax is " \
+  "access{dst=...,pid-offset=...,tsid=...,netid=...,mux-rate=...}, " \
+  "outputs being separated by ':'. For example: " \
+  "udp{dst=239.0.0.2:1234,pid-offset=1000,tsid=2,mux-rate=8000000}.")
+
 #define SOUT_CFG_PREFIX "sout-ts-"
 #define MAX_PMT 64       /* Maximum number of programs. FIXME: I just chose an arbitrary number. Where is the maximum in the spec? */
 #define MAX_PMT_PID 64       /* Maximum pids in each pmt.  FIXME: I just chose an arbitrary number. Where is the maximum in the spec? */
@@ -229,6 +244,8 @@ vlc_module_begin ()
     add_integer( SOUT_CFG_PREFIX "bmin", 0, BMIN_TEXT, BMIN_LONGTEXT, true)
     add_integer( SOUT_CFG_PREFIX "bmax", 0, BMAX_TEXT, BMAX_LONGTEXT, true)
     add_integer( SOUT_CFG_PREFIX "dts-delay", 400, DTS_TEXT, DTS_LONGTEXT, true)
+    add_integer( SOUT_CFG_PREFIX "mux-rate", 0, MUXRATE_TEXT, MUXRATE_LONGTEXT, true)
+        change_integer_range( 0, INT64_MAX )
 
     add_bool( SOUT_CFG_PREFIX "crypt-audio", true, ACRYPT_TEXT, ACRYPT_LONGTEXT, true)
     add_bool( SOUT_CFG_PREFIX "crypt-video", true, VCRYPT_TEXT, VCRYPT_LONGTEXT, true)
@@ -237,6 +254,8 @@ vlc_module_begin ()
     add_string( SOUT_CFG_PREFIX "csa-use", "1",  CU_TEXT,   CU_LONGTEXT,   true)
     add_integer(SOUT_CFG_PREFIX "csa-pkt", 188,  CPKT_TEXT, CPKT_LONGTEXT, true)
 
+    add_string( SOUT_CFG_PREFIX "outputs", NULL, OUTPUTS_TEXT, OUTPUTS_LONGTEXT, true )
+
     set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -249,7 +268,7 @@ static const char *const ppsz_sout_options[] = {
     "netid", "sdtdesc",
     "es-id-pid", "shaping", "pcr", "bmin", "bmax", "use-key-frames",
     "dts-delay", "csa-ck", "csa2-ck", "csa-use", "csa-pkt", "crypt-audio", "crypt-video",
-    "muxpmt", "program-pmt", "alignment",
+    "muxpmt", "program-pmt", "alignment", "outputs", "mux-rate",
     NULL
 };
 
@@ -340,6 +359,24 @@ typedef struct
     pes_state_t  state;
 } sout_input_sys_t;
 
+/* Output variant: gets every TS packet of the main output, so that PES
+ * packetization happens only once. The packets are shared when the PIDs are
+ * not remapped, and copied otherwise. */
+typedef struct
+{
+    sout_access_out_t   *p_access;
+    int                 i_pid_offset;
+    int                 i_tsid;
+    int64_t             i_mux_rate; /* 0 if VBR */
+    cbr_t               *p_cbr;
+
+    tsmux_stream_t      pat;
+    tsmux_stream_t      pmt[MAX_PMT];
+    sdt_psi_t           sdt;
+
+    sout_buffer_chain_t chain_ts;
+} ts_variant_t;
+
 typedef struct
 {
     sout_input_t    *p_pcr_input;
@@ -381,10 +418,17 @@ typedef struct
 
     vlc_tick_t      i_pcr;  /* last PCR emited */
 
+    int64_t         i_mux_rate; /* 0 if VBR */
+    cbr_t           *p_cbr;
+
     csa_t           *csa;
     int             i_csa_pkt_size;
     bool            b_crypt_audio;
     bool            b_crypt_video;
+
+    size_t          i_variants;
+    ts_variant_t    *variants;
+    bool            b_share_packets; /* a variant keeps the PIDs */
 } sout_mux_sys_t;
 
 
@@ -473,12 +517,20 @@ static int Mux      ( sout_mux_t * );
 
 static block_t *FixPES( sout_mux_t *p_mux, block_fifo_t *p_fifo );
 static block_t *Add_ADTS( block_t *, const es_format_t * );
-static void TSSchedule  ( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
+static void TSSchedule  ( sout_mux_t *p_mux, ts_variant_t *p_variant,
+                          sout_buffer_chain_t *p_chain_ts,
+                          vlc_tick_t i_pcr_length, vlc_tick_t i_pcr_dts );
+static void TSDate      ( sout_mux_t *p_mux, ts_variant_t *p_variant,
+                          sout_buffer_chain_t *p_chain_ts,
                           vlc_tick_t i_pcr_length, vlc_tick_t i_pcr_dts );
-static void TSDate      ( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
+static void TSSend      ( sout_mux_t *p_mux, ts_variant_t *p_variant,
+                          sout_buffer_chain_t *p_chain_ts,
                           vlc_tick_t i_pcr_length, vlc_tick_t i_pcr_dts );
 static void GetPAT( sout_mux_t *p_mux, sout_buffer_chain_t *c );
 static void GetPMT( sout_mux_t *p_mux, sout_buffer_chain_t *c );
+static void GetPSI( sout_mux_t *p_mux, sout_buffer_chain_t *c );
+static void GetVariantPSI( sout_mux_t *p_mux, ts_variant_t *p_variant );
+static void VariantsAppend( sout_mux_sys_t *p_sys, const block_t *p_ts );
 
 static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream, bool b_pcr );
 static void TSSetPCR( block_t *p_ts, vlc_tick_t i_dts );
@@ -538,6 +590,100 @@ static csa_t *csaSetup( vlc_object_t *p_this )
 /*****************************************************************************
  * Open:
  *****************************************************************************/
+/* Remap a PID of the main output, reserved PIDs are kept */
+static uint16_t VariantPID( const ts_variant_t *p_variant, uint16_t i_pid )
+{
+    if( i_pid < 0x20 || i_pid == 0x1fff )
+        return i_pid;
+    return 0x20 + ( i_pid - 0x20 + p_variant->i_pid_offset ) % ( 0x1fff - 0x20 );
+}
+
+static void OpenVariant( sout_mux_t *p_mux, const char *psz_access,
+                         const config_chain_t *p_cfg )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    const char *psz_dst = NULL;
+    ts_variant_t variant;
+
+    memset( &variant, 0, sizeof(variant) );
+    variant.i_tsid = p_sys->i_tsid;
+    variant.sdt.i_netid = p_sys->sdt.i_netid;
+    variant.sdt.ts.i_pid = p_sys->sdt.ts.i_pid;
+
+    for( ; p_cfg != NULL; p_cfg = p_cfg->p_next )
+    {
+        const char *psz_value = p_cfg->psz_value ? p_cfg->psz_value : "";
+
+        if( !strcmp( p_cfg->psz_name, "dst" ) )
+            psz_dst = psz_value;
+        else if( !strcmp( p_cfg->psz_name, "pid-offset" ) )
+            variant.i_pid_offset = strtol( psz_value, NULL, 0 );
+        else if( !strcmp( p_cfg->psz_name, "tsid" ) )
+            variant.i_tsid = strtol( psz_value, NULL, 0 ) & 0xffff;
+        else if( !strcmp( p_cfg->psz_name, "netid" ) )
+            variant.sdt.i_netid = strtol( psz_value, NULL, 0 ) & 0xffff;
+        else if( !strcmp( p_cfg->psz_name, "mux-rate" ) )
+            variant.i_mux_rate = strtoll( psz_value, NULL, 0 );
+        else
+            msg_Warn( p_mux, "unknown output option %s", p_cfg->psz_name );
+    }
+
+    if( psz_dst == NULL )
+    {
+        msg_Err( p_mux, "output %s has no destination", psz_access );
+        return;
+    }
+    if( variant.i_pid_offset < 0 )
+        variant.i_pid_offset = 0;
+    variant.i_pid_offset %= 0x1fff - 0x20;
+
+    ts_variant_t *p_variants = realloc( p_sys->variants,
+                                        ( p_sys->i_variants + 1 ) * sizeof(*p_variants) );
+    if( unlikely(p_variants == NULL) )
+        return;
+    p_sys->variants = p_variants;
+
+    variant.p_access = sout_AccessOutNew( p_mux, psz_access, psz_dst );
+    if( variant.p_access == NULL )
+    {
+        msg_Err( p_mux, "cannot create output %s://%s", psz_access, psz_dst );
+        return;
+    }
+
+    if( variant.i_mux_rate > 0 )
+    {
+        variant.p_cbr = cbr_New( variant.i_mux_rate, p_sys->i_pcr_delay );
+        if( variant.p_cbr == NULL )
+            msg_Warn( p_mux, "invalid mux rate %"PRId64" for %s://%s",
+                      variant.i_mux_rate, psz_access, psz_dst );
+    }
+
+    for( unsigned i = 0; i < p_sys->i_num_pmt; i++ )
+        variant.pmt[i].i_pid = VariantPID( &variant, p_sys->pmt[i].i_pid );
+
+    /* The SDT strings are the variant's own */
+    for( int i = 0; i < MAX_SDT_DESC; i++ )
+    {
+        const char *psz_provider = p_sys->sdt.desc[i].psz_provider;
+        const char *psz_service_name = p_sys->sdt.desc[i].psz_service_name;
+        if( psz_provider )
+            variant.sdt.desc[i].psz_provider = strdup( psz_provider );
+        if( psz_service_name )
+            variant.sdt.desc[i].psz_service_name = strdup( psz_service_name );
+    }
+
+    if( variant.i_pid_offset == 0 )
+        p_sys->b_share_packets = true;
+
+    msg_Dbg( p_mux, "adding output %s://%s pid-offset=%d tsid=%d mux-rate=%"PRId64,
+             psz_access, psz_dst, variant.i_pid_offset, variant.i_tsid,
+             variant.i_mux_rate );
+
+    p_sys->variants[p_sys->i_variants] = variant;
+    BufferChainInit( &p_sys->variants[p_sys->i_variants].chain_ts );
+    p_sys->i_variants++;
+}
+
 static int Open( vlc_object_t *p_this )
 {
     sout_mux_t          *p_mux =(sout_mux_t*)p_this;
@@ -740,8 +886,41 @@ static int Open( vlc_object_t *p_this )
 
     p_sys->b_use_key_frames = var_GetBool( p_mux, SOUT_CFG_PREFIX "use-key-frames" );
 
+    p_sys->i_mux_rate = var_GetInteger( p_mux, SOUT_CFG_PREFIX "mux-rate" );
+    if( p_sys->i_mux_rate > 0 )
+    {
+        p_sys->p_cbr = cbr_New( p_sys->i_mux_rate, p_sys->i_pcr_delay );
+        if( p_sys->p_cbr == NULL )
+        {
+            msg_Err( p_mux, "invalid mux rate (%"PRId64"), using VBR",
+                     p_sys->i_mux_rate );
+            p_sys->i_mux_rate = 0;
+        }
+        else
+            msg_Dbg( p_mux, "constant bitrate %"PRId64" bits/s",
+                     p_sys->i_mux_rate );
+    }
+
     p_mux->p_sys        = p_sys;
 
+    char *psz_outputs = var_GetNonEmptyString( p_mux, SOUT_CFG_PREFIX "outputs" );
+    for( char *psz = psz_outputs; psz && *psz; )
+    {
+        char *psz_access;
+        config_chain_t *p_cfg;
+        char *psz_next = config_ChainCreate( &psz_access, &p_cfg, psz );
+
+        if( psz_access )
+            OpenVariant( p_mux, psz_access, p_cfg );
+        free( psz_access );
+        config_ChainDestroy( p_cfg );
+
+        if( psz != psz_outputs )
+            free( psz );
+        psz = psz_next;
+    }
+    free( psz_outputs );
+
     p_sys->csa = csaSetup(p_this);
 
     p_mux->pf_control   = Control;
@@ -755,11 +934,51 @@ static int Open( vlc_object_t *p_this )
 /*****************************************************************************
  * Close:
  *****************************************************************************/
+static void CBRStats( sout_mux_t *p_mux, const cbr_t *p_cbr )
+{
+    cbr_stats_t stats;
+
+    cbr_GetStats( p_cbr, &stats );
+    msg_Dbg( p_mux, "cbr: %"PRIu64" packets, %"PRIu64" null, %"PRIu64" pcr "
+             "(%"PRIu64" adaptation only), max pcr interval %"PRId64"ms, "
+             "max pcr error %"PRId64"/27MHz",
+             stats.i_packets, stats.i_null_packets, stats.i_pcr_packets,
+             stats.i_pcr_only_packets, MS_FROM_VLC_TICK(stats.i_pcr_interval_max),
+             stats.i_pcr_error_max );
+    msg_Dbg( p_mux, "cbr: max transport buffer %d bytes, %"PRIu64" stalls, "
+             "%"PRIu64" late packets (max %"PRId64"ms), %u resyncs",
+             stats.i_tb_max, stats.i_tb_stalls, stats.i_late_packets,
+             MS_FROM_VLC_TICK(stats.i_late_max), stats.i_resyncs );
+}
+
 static void Close( vlc_object_t * p_this )
 {
     sout_mux_t          *p_mux = (sout_mux_t*)p_this;
     sout_mux_sys_t      *p_sys = p_mux->p_sys;
 
+    if( p_sys->p_cbr )
+    {
+        CBRStats( p_mux, p_sys->p_cbr );
+        cbr_Delete( p_sys->p_cbr );
+    }
+
+    for( size_t i = 0; i < p_sys->i_variants; i++ )
+    {
+        BufferChainClean( &p_sys->variants[i].chain_ts );
+        sout_AccessOutDelete( p_sys->variants[i].p_access );
+        if( p_sys->variants[i].p_cbr )
+        {
+            CBRStats( p_mux, p_sys->variants[i].p_cbr );
+            cbr_Delete( p_sys->variants[i].p_cbr );
+        }
+        for( int j = 0; j < MAX_SDT_DESC; j++ )
+        {
+            free( p_sys->variants[i].sdt.desc[j].psz_service_name );
+            free( p_sys->variants[i].sdt.desc[j].psz_provider );
+        }
+    }
+    free( p_sys->variants );
+
     if( p_sys->p_dvbpsi )
         dvbpsi_delete( p_sys->p_dvbpsi );
 
@@ -1160,6 +1379,10 @@ static block_t *Encap_J2K( block_t *p_data, const es_format_t *p_fmt )
     }
     else
     {
+        /* The header is written over the data of the skipped boxes */
+        p_data = block_Unshare( p_data );
+        if( unlikely(!p_data) )
+            return NULL;
         p_data->p_buffer += (i_offset - 38);
         p_data->i_buffer -= (i_offset - 38);
     }
@@ -1494,8 +1717,7 @@ static bool MuxStreams(sout_mux_t *p_mux )
     BufferChainInit( &chain_ts );
     /* append PAT/PMT  -> FIXME with big pcr delay it won't have enough pat/pmt */
     bool pat_was_previous = true; //This is to prevent unnecessary double PAT/PMT insertions
-    GetPAT( p_mux, &chain_ts );
-    GetPMT( p_mux, &chain_ts );
+    GetPSI( p_mux, &chain_ts );
     int i_packet_pos = 0;
     i_packet_count += chain_ts.i_depth;
     /* msg_Dbg( p_mux, "estimated pck=%d", i_packet_count ); */
@@ -1561,22 +1783,37 @@ static bool MuxStreams(sout_mux_t *p_mux )
             if( likely( !pat_was_previous ) )
             {
                 int startcount = chain_ts.i_depth;
-                GetPAT( p_mux, &chain_ts );
-                GetPMT( p_mux, &chain_ts );
+                int pi_variant_startcount[p_sys->i_variants + 1];
+                for( size_t i = 0; i < p_sys->i_variants; i++ )
+                    pi_variant_startcount[i] = p_sys->variants[i].chain_ts.i_depth;
+
+                GetPSI( p_mux, &chain_ts );
                 SetHeader( &chain_ts, startcount );
+                for( size_t i = 0; i < p_sys->i_variants; i++ )
+                    SetHeader( &p_sys->variants[i].chain_ts, pi_variant_startcount[i] );
                 i_packet_count += (chain_ts.i_depth - startcount );
             } else {
                 SetHeader( &chain_ts, 0); //We just inserted pat/pmt,so just flag it instead of adding new one
+                for( size_t i = 0; i < p_sys->i_variants; i++ )
+                    SetHeader( &p_sys->variants[i].chain_ts, 0 );
             }
         }
         pat_was_previous = false;
 
         /* */
+        if( p_sys->b_share_packets )
+            p_ts = block_Shareable( p_ts );
+        VariantsAppend( p_sys, p_ts );
         BufferChainAppend( &chain_ts, p_ts );
     }
 
     /* 4: date and send */
-    TSSchedule( p_mux, &chain_ts, i_pcr_length, i_pcr_dts );
+    TSSend( p_mux, NULL, &chain_ts, i_pcr_length, i_pcr_dts );
+    for( size_t i = 0; i < p_sys->i_variants; i++ )
+    {
+        ts_variant_t *p_variant = &p_sys->variants[i];
+        TSSend( p_mux, p_variant, &p_variant->chain_ts, i_pcr_length, i_pcr_dts );
+    }
     return false;
 }
 
@@ -1711,7 +1948,8 @@ static block_t *Add_ADTS( block_t *p_data, const es_format_t *p_fmt )
     return p_new_block;
 }
 
-static void TSSchedule( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
+static void TSSchedule( sout_mux_t *p_mux, ts_variant_t *p_variant,
+                        sout_buffer_chain_t *p_chain_ts,
                         vlc_tick_t i_pcr_length, vlc_tick_t i_pcr_dts )
 {
     sout_mux_sys_t  *p_sys = p_mux->p_sys;
@@ -1756,21 +1994,118 @@ static void TSSchedule( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
                  i_cut_dts - i_pcr_dts, i_pcr_length, new_chain.i_depth,
                  p_chain_ts->i_depth );
         if ( new_chain.i_depth )
-            TSDate( p_mux, &new_chain, i_cut_dts - i_pcr_dts, i_pcr_dts );
+            TSDate( p_mux, p_variant, &new_chain, i_cut_dts - i_pcr_dts, i_pcr_dts );
         if ( p_chain_ts->i_depth )
-            TSSchedule( p_mux, p_chain_ts, i_pcr_dts + i_pcr_length - i_cut_dts,
-                        i_cut_dts );
+            TSSchedule( p_mux, p_variant, p_chain_ts,
+                        i_pcr_dts + i_pcr_length - i_cut_dts, i_cut_dts );
         return;
     }
 
     if ( new_chain.i_depth )
-        TSDate( p_mux, &new_chain, i_pcr_length, i_pcr_dts );
+        TSDate( p_mux, p_variant, &new_chain, i_pcr_length, i_pcr_dts );
+}
+
+static void TSWrite( sout_mux_t *p_mux, sout_access_out_t *p_access,
+                     block_t *p_ts )
+{
+    sout_mux_sys_t  *p_sys = p_mux->p_sys;
+
+    if( p_ts->i_flags & BLOCK_FLAG_SCRAMBLED )
+    {
+        p_ts = block_Unshare( p_ts );
+        if( unlikely(p_ts == NULL) )
+            return;
+        vlc_mutex_lock( &p_sys->csa_lock );
+        csa_Encrypt( p_sys->csa, p_ts->p_buffer, p_sys->i_csa_pkt_size );
+        vlc_mutex_unlock( &p_sys->csa_lock );
+    }
+
+    /* latency */
+    p_ts->i_dts += p_sys->i_shaping_delay * 3 / 2;
+
+    sout_AccessOutWrite( p_access, p_ts );
 }
 
-static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
+/* T-STD transport buffer leak rates (Rx) */
+static void CBRSetBuffers( sout_mux_t *p_mux, const ts_variant_t *p_variant,
+                           cbr_t *p_cbr, int64_t i_mux_rate )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+#define PID(pid) ( p_variant ? VariantPID( p_variant, (pid) ) : (pid) )
+    const int64_t i_rx_sys = 1000000;
+
+    cbr_SetBuffer( p_cbr, 0x00, i_rx_sys );
+    cbr_SetBuffer( p_cbr, PID(p_sys->sdt.ts.i_pid), i_rx_sys );
+    for( unsigned i = 0; i < p_sys->i_num_pmt; i++ )
+        cbr_SetBuffer( p_cbr, PID(p_sys->pmt[i].i_pid), i_rx_sys );
+
+    for( int i = 0; i < p_mux->i_nb_inputs; i++ )
+    {
+        const es_format_t *p_fmt = p_mux->pp_inputs[i]->p_fmt;
+        const sout_input_sys_t *p_stream = p_mux->pp_inputs[i]->p_sys;
+        int64_t i_rx;
+
+        switch( p_fmt->i_cat )
+        {
+            case VIDEO_ES:
+                /* 1.2 Rmax, bounded by the mux rate when unknown */
+                i_rx = p_fmt->i_bitrate ? (int64_t)p_fmt->i_bitrate * 6 / 5
+                                        : i_mux_rate;
+                break;
+            case AUDIO_ES:
+                i_rx = 2000000;
+                break;
+            default:
+                i_rx = 0; /* unconstrained */
+                break;
+        }
+        cbr_SetBuffer( p_cbr, PID(p_stream->ts.i_pid), i_rx );
+    }
+
+    cbr_SetPCRPID( p_cbr,
+                   PID(((sout_input_sys_t *)p_sys->p_pcr_input->p_sys)->ts.i_pid) );
+#undef PID
+}
+
+/* Send the packets of a shaping period, at constant or variable bitrate */
+static void TSSend( sout_mux_t *p_mux, ts_variant_t *p_variant,
+                    sout_buffer_chain_t *p_chain_ts,
+                    vlc_tick_t i_pcr_length, vlc_tick_t i_pcr_dts )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    cbr_t *p_cbr = p_variant ? p_variant->p_cbr : p_sys->p_cbr;
+
+    if( p_cbr == NULL )
+    {
+        TSSchedule( p_mux, p_variant, p_chain_ts, i_pcr_length, i_pcr_dts );
+        return;
+    }
+
+    sout_access_out_t *p_access = p_variant ? p_variant->p_access : p_mux->p_access;
+
+    CBRSetBuffers( p_mux, p_variant, p_cbr,
+                   p_variant ? p_variant->i_mux_rate : p_sys->i_mux_rate );
+
+    block_t *p_ts = cbr_Mux( p_cbr, p_chain_ts->p_first, i_pcr_dts,
+                             i_pcr_length, p_sys->first_dts );
+    BufferChainInit( p_chain_ts );
+
+    while( p_ts != NULL )
+    {
+        block_t *p_next = p_ts->p_next;
+        p_ts->p_next = NULL;
+        TSWrite( p_mux, p_access, p_ts );
+        p_ts = p_next;
+    }
+}
+
+static void TSDate( sout_mux_t *p_mux, ts_variant_t *p_variant,
+                    sout_buffer_chain_t *p_chain_ts,
                     vlc_tick_t i_pcr_length, vlc_tick_t i_pcr_dts )
 {
     sout_mux_sys_t  *p_sys = p_mux->p_sys;
+    sout_access_out_t *p_access = p_variant ? p_variant->p_access : p_mux->p_access;
+
     int i_packet_count = p_chain_ts->i_depth;
 
     if ( likely(i_pcr_length / 1000 > 0) )
@@ -1804,19 +2139,13 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
         if( p_ts->i_flags & BLOCK_FLAG_CLOCK )
         {
             /* msg_Dbg( p_mux, "pcr=%lld ms", p_ts->i_dts / 1000 ); */
+            p_ts = block_Unshare( p_ts );
+            if( unlikely(p_ts == NULL) )
+                continue;
             TSSetPCR( p_ts, p_ts->i_dts - p_sys->first_dts );
         }
-        if( p_ts->i_flags & BLOCK_FLAG_SCRAMBLED )
-        {
-            vlc_mutex_lock( &p_sys->csa_lock );
-            csa_Encrypt( p_sys->csa, p_ts->p_buffer, p_sys->i_csa_pkt_size );
-            vlc_mutex_unlock( &p_sys->csa_lock );
-        }
-
-        /* latency */
-        p_ts->i_dts += p_sys->i_shaping_delay * 3 / 2;
 
-        sout_AccessOutWrite( p_mux->p_access, p_ts );
+        TSWrite( p_mux, p_access, p_ts );
     }
 }
 
@@ -1976,3 +2305,86 @@ static void GetPMT( sout_mux_t *p_mux, sout_buffer_chain_t *c )
               p_sys->i_num_pmt, p_sys->pmt, p_sys->i_pmt_program_number,
               p_mux->i_nb_inputs, mappeds );
 }
+
+static void GetPSI( sout_mux_t *p_mux, sout_buffer_chain_t *c )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+
+    GetPAT( p_mux, c );
+    GetPMT( p_mux, c );
+
+    for( size_t i = 0; i < p_sys->i_variants; i++ )
+        GetVariantPSI( p_mux, &p_sys->variants[i] );
+}
+
+static void GetVariantPSI( sout_mux_t *p_mux, ts_variant_t *p_variant )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    pes_mapped_stream_t mappeds[p_mux->i_nb_inputs];
+    tsmux_stream_t ts[p_mux->i_nb_inputs];
+
+    BuildPAT( p_sys->p_dvbpsi,
+              &p_variant->chain_ts, (PEStoTSCallback)BufferChainAppend,
+              p_variant->i_tsid, p_sys->i_pat_version_number,
+              &p_variant->pat,
+              p_sys->i_num_pmt, p_variant->pmt, p_sys->i_pmt_program_number );
+
+    for (int i_stream = 0; i_stream < p_mux->i_nb_inputs; i_stream++ )
+    {
+        sout_input_t *p_input = p_mux->pp_inputs[i_stream];
+        sout_input_sys_t *p_stream = (sout_input_sys_t*)p_input->p_sys;
+
+        int i_pidinput = p_input->p_fmt->i_id;
+        pmt_map_t *p_usepid = bsearch( &i_pidinput, p_sys->pmtmap,
+                                       p_sys->i_pmtslots, sizeof(pmt_map_t), intcompare );
+
+        ts[i_stream] = p_stream->ts;
+        ts[i_stream].i_pid = VariantPID( p_variant, p_stream->ts.i_pid );
+
+        mappeds[i_stream].i_mapped_prog = p_usepid ? p_usepid->i_prog : 0;
+        mappeds[i_stream].fmt = p_input->p_fmt;
+        mappeds[i_stream].pes = &p_stream->pes;
+        mappeds[i_stream].ts = &ts[i_stream];
+    }
+
+    BuildPMT( p_sys->p_dvbpsi, VLC_OBJECT(p_mux), p_sys->standard,
+              &p_variant->chain_ts, (PEStoTSCallback)BufferChainAppend,
+              p_variant->i_tsid, p_sys->i_pmt_version_number,
+              VariantPID( p_variant,
+                          ((sout_input_sys_t *)p_sys->p_pcr_input->p_sys)->ts.i_pid ),
+              &p_variant->sdt,
+              p_sys->i_num_pmt, p_variant->pmt, p_sys->i_pmt_program_number,
+              p_mux->i_nb_inputs, mappeds );
+}
+
+/* Queue an ES packet of the main output to every variant. Packets with the
+ * same PID share their data, which is then only modified after
+ * block_Unshare(). */
+static void VariantsAppend( sout_mux_sys_t *p_sys, const block_t *p_ts )
+{
+    const uint16_t i_pid = ( ( p_ts->p_buffer[1] & 0x1f ) << 8 ) | p_ts->p_buffer[2];
+
+    for( size_t i = 0; i < p_sys->i_variants; i++ )
+    {
+        ts_variant_t *p_variant = &p_sys->variants[i];
+        const uint16_t i_new_pid = VariantPID( p_variant, i_pid );
+        block_t *p_copy;
+
+        if( i_new_pid == i_pid )
+        {
+            p_copy = block_Share( p_ts );
+            if( unlikely(p_copy == NULL) )
+                continue;
+        }
+        else
+        {
+            p_copy = block_Duplicate( p_ts );
+            if( unlikely(p_copy == NULL) )
+                continue;
+            p_copy->p_buffer[1] = ( p_copy->p_buffer[1] & 0xe0 ) | ( i_new_pid >> 8 );
+            p_copy->p_buffer[2] = i_new_pid & 0xff;
+        }
+
+        BufferChainAppend( &p_variant->chain_ts, p_copy );
+    }
+}
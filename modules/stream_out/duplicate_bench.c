@@ -0,0 +1,126 @@
+/*****************************************************************************
+ * duplicate_bench.c: benchmark of the duplicate stream output fan-out
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_tick.h>
+
+/* Send() of the duplicate stream output, with the payload copied for each
+ * output (as block_Duplicate() did) or shared. Each output then either only
+ * reads the data, or prepends a header like most muxers, which copies shared
+ * data. */
+enum
+{
+    FANOUT_COPY,
+    FANOUT_SHARE,
+};
+
+static block_t *Output(block_t *block, bool prepend)
+{
+    if (prepend)
+    {
+        block = block_Realloc(block, 14, block->i_buffer);
+        if (block != NULL)
+            memset(block->p_buffer, 0x47, 14);
+    }
+    return block;
+}
+
+static void Send(block_t *block, unsigned outputs, int mode, bool prepend,
+                 block_t **out)
+{
+    if (mode == FANOUT_SHARE && outputs > 1)
+        block = block_Shareable(block);
+
+    for (unsigned i = 0; i < outputs - 1; i++)
+    {
+        block_t *dup = (mode == FANOUT_SHARE) ? block_Share(block)
+                                              : block_Duplicate(block);
+        if (dup != NULL)
+            out[i] = Output(dup, prepend);
+    }
+    out[outputs - 1] = Output(block, prepend);
+}
+
+/* Nanoseconds per input block */
+static double Bench(size_t size, unsigned outputs, int mode, bool prepend)
+{
+    const unsigned count = (256 << 20) / size / outputs + 1;
+    block_t *out[16];
+    vlc_tick_t total = 0;
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        block_t *block = block_Alloc(size);
+        if (unlikely(block == NULL))
+            abort();
+        memset(block->p_buffer, i, size);
+
+        memset(out, 0, sizeof (out));
+        vlc_tick_t start = vlc_tick_now();
+        Send(block, outputs, mode, prepend, out);
+        total += vlc_tick_now() - start;
+
+        /* The outputs run later, from other threads */
+        for (unsigned j = 0; j < outputs; j++)
+            if (out[j] != NULL)
+                block_Release(out[j]);
+    }
+    return 1000. * total / count;
+}
+
+int main(void)
+{
+    /* UDP input of MPEG-TS, and whole frames of 40 Mbit/s video at 25 fps */
+    static const size_t sizes[] = { 7 * 188, 200000 };
+    static const unsigned fanouts[] = { 1, 4, 16 };
+    const double bitrate = 40e6;
+
+    for (size_t s = 0; s < ARRAY_SIZE(sizes); s++)
+    {
+        const double rate = bitrate / 8. / sizes[s];
+
+        printf("%zu bytes blocks (CPU %% at %.0f Mbit/s):\n", sizes[s],
+               bitrate / 1e6);
+        for (int prepend = 0; prepend < 2; prepend++)
+        {
+            printf(" %s\n", prepend ? "outputs prepending a header"
+                                    : "outputs reading the data");
+            for (size_t f = 0; f < ARRAY_SIZE(fanouts); f++)
+            {
+                const unsigned n = fanouts[f];
+                double copy = Bench(sizes[s], n, FANOUT_COPY, prepend);
+                double share = Bench(sizes[s], n, FANOUT_SHARE, prepend);
+
+                printf("  %2u output%s: copy %9.0f ns (%6.3f%%),"
+                       " shared %9.0f ns (%6.3f%%)\n", n, n > 1 ? "s" : " ",
+                       copy, copy * rate * 1e-7, share, share * rate * 1e-7);
+            }
+        }
+    }
+    return 0;
+}
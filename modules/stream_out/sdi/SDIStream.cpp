@@ -238,6 +238,10 @@ int AbstractDecodedStream::Send(block_t *p_block)
 
      if(!p_owner->b_error)
     {
+        /* Decoders may modify their input in place */
+        if(p_block && !(p_block = block_Unshare(p_block)))
+            return VLC_ENOMEM;
+
         int ret = p_decoder->pf_decode(p_decoder, p_block);
         switch(ret)
         {
@@ -44,6 +44,7 @@ typedef struct
                 unsigned int i_count;
                 int          i_priority;
                 uint32_t     pool_size;
+                bool         b_async; /* encoder thread even if i_count is 0 */
             } threads;
         } video;
         struct
@@ -35,6 +35,7 @@
 #include <vlc_plugin.h>
 #include <vlc_sout.h>
 #include <vlc_spu.h>
+#include <vlc_charset.h>
 
 #include "transcode.h"
 
@@ -75,6 +76,17 @@
 #define MAXHEIGHT_TEXT N_("Maximum video height")
 #define MAXHEIGHT_LONGTEXT N_( \
     "Maximum output video height." )
+#define RENDITION_TEXT N_("Video rendition")
+#define RENDITION_LONGTEXT N_( \
+    "Additional encoding of the video, decoded and filtered only once, " \
+    "in the form {vb=800,width=640}. It takes the venc, vcodec, vb, scale, " \
+    "width, height, maxwidth, maxheight and id (ES id of the output) " \
+    "options. Repeat it for each rendition of an adaptive streaming ladder." )
+#define KEYINT_TEXT N_("Key frame interval")
+#define KEYINT_LONGTEXT N_( \
+    "Seconds between the key frames forced at the same pictures in all the " \
+    "video encodings, so that their segments line up. It defaults to 2 " \
+    "seconds with renditions, and to the encoder choice otherwise." )
 #define VFILTER_TEXT N_("Video filter")
 #define VFILTER_LONGTEXT N_( \
     "Video filters will be applied to the video streams (after overlays " \
@@ -177,6 +189,10 @@ vlc_module_begin ()
                  MAXHEIGHT_LONGTEXT, true )
     add_module_list(SOUT_CFG_PREFIX "vfilter", "video filter", NULL,
                     VFILTER_TEXT, VFILTER_LONGTEXT)
+    add_string( SOUT_CFG_PREFIX "rendition", NULL, RENDITION_TEXT,
+                RENDITION_LONGTEXT, true )
+    add_float( SOUT_CFG_PREFIX "keyint", 0, KEYINT_TEXT,
+               KEYINT_LONGTEXT, true )
 
     set_section( N_("Audio"), NULL )
     add_module(SOUT_CFG_PREFIX "aenc", "encoder", NULL,
@@ -224,7 +240,7 @@ static const char *const ppsz_sout_options[] = {
     "deinterlace-module", "threads", "aenc", "acodec", "ab", "alang",
     "afilter", "samplerate", "channels", "senc", "scodec", "soverlay",
     "sfilter", "high-priority", "maxwidth", "maxheight", "pool-size",
-    NULL
+    "rendition", "keyint", NULL
 };
 
 /*****************************************************************************
@@ -332,6 +348,78 @@ static void SetVideoEncoderConfig( sout_stream_t *p_stream, transcode_encoder_co
         p_cfg->video.threads.i_priority = VLC_THREAD_PRIORITY_VIDEO;
 }
 
+static void SetRenditionConfig( sout_stream_t *p_stream,
+                                const transcode_encoder_config_t *p_main,
+                                const char *psz_opts,
+                                transcode_rendition_config_t *p_rendition )
+{
+    transcode_encoder_config_t *p_cfg = &p_rendition->enc_cfg;
+
+    /* Same encoder and frame rate as the main video, but not the size */
+    transcode_encoder_config_init( p_cfg );
+    p_cfg->i_codec = p_main->i_codec;
+    p_cfg->video = p_main->video;
+    p_cfg->video.f_scale = 0;
+    p_cfg->video.i_width = p_cfg->video.i_height = 0;
+    p_cfg->video.i_maxwidth = p_cfg->video.i_maxheight = 0;
+    p_cfg->video.threads.b_async = true;
+    p_rendition->i_id = 0;
+
+    config_chain_t *p_opts = NULL;
+    config_ChainParseOptions( &p_opts, psz_opts );
+    for( config_chain_t *p = p_opts; p != NULL; p = p->p_next )
+    {
+        const char *psz_value = p->psz_value ? p->psz_value : "";
+
+        if( !strcmp( p->psz_name, "venc" ) )
+        {
+            free( p_cfg->psz_name );
+            config_ChainDestroy( p_cfg->p_config_chain );
+            free( config_ChainCreate( &p_cfg->psz_name,
+                                      &p_cfg->p_config_chain, psz_value ) );
+        }
+        else if( !strcmp( p->psz_name, "vcodec" ) )
+        {
+            char fcc[5] = "    \0";
+            memcpy( fcc, psz_value, __MIN( strlen( psz_value ), 4 ) );
+            p_cfg->i_codec = vlc_fourcc_GetCodecFromString( VIDEO_ES, fcc );
+        }
+        else if( !strcmp( p->psz_name, "vb" ) )
+        {
+            p_cfg->video.i_bitrate = atoi( psz_value );
+            if( p_cfg->video.i_bitrate < 16000 )
+                p_cfg->video.i_bitrate *= 1000;
+        }
+        else if( !strcmp( p->psz_name, "scale" ) )
+            p_cfg->video.f_scale = us_atof( psz_value );
+        else if( !strcmp( p->psz_name, "width" ) )
+            p_cfg->video.i_width = atoi( psz_value );
+        else if( !strcmp( p->psz_name, "height" ) )
+            p_cfg->video.i_height = atoi( psz_value );
+        else if( !strcmp( p->psz_name, "maxwidth" ) )
+            p_cfg->video.i_maxwidth = atoi( psz_value );
+        else if( !strcmp( p->psz_name, "maxheight" ) )
+            p_cfg->video.i_maxheight = atoi( psz_value );
+        else if( !strcmp( p->psz_name, "id" ) )
+            p_rendition->i_id = atoi( psz_value );
+        else
+            msg_Warn( p_stream, "rendition option %s is unknown", p->psz_name );
+    }
+    config_ChainDestroy( p_opts );
+
+    /* Inherit the main encoder module and its options */
+    if( p_cfg->psz_name == NULL && p_main->psz_name != NULL )
+    {
+        p_cfg->psz_name = strdup( p_main->psz_name );
+        p_cfg->p_config_chain = config_ChainDuplicate( p_main->p_config_chain );
+    }
+
+    msg_Dbg( p_stream, "rendition video=%4.4s %dx%d scaling: %f %dkb/s",
+             (char *)&p_cfg->i_codec, p_cfg->video.i_width,
+             p_cfg->video.i_height, p_cfg->video.f_scale,
+             p_cfg->video.i_bitrate / 1000 );
+}
+
 static void SetSPUEncoderConfig( sout_stream_t *p_stream, transcode_encoder_config_t *p_cfg )
 {
     char *psz_string = var_GetString( p_stream, SOUT_CFG_PREFIX "senc" );
@@ -435,6 +523,32 @@ static int Open( vlc_object_t *p_this )
     else
         free( psz_string );
 
+    /* Video renditions, the option can be repeated */
+    if( p_sys->venc_cfg.i_codec )
+    {
+        for( config_chain_t *p_cfg = p_stream->p_cfg; p_cfg != NULL;
+             p_cfg = p_cfg->p_next )
+        {
+            if( strcmp( p_cfg->psz_name, "rendition" ) ||
+                p_cfg->psz_value == NULL )
+                continue;
+
+            transcode_rendition_config_t *p_renditions =
+                realloc( p_sys->p_renditions,
+                         (p_sys->i_renditions + 1) * sizeof(*p_renditions) );
+            if( unlikely(p_renditions == NULL) )
+                break;
+            p_sys->p_renditions = p_renditions;
+            SetRenditionConfig( p_stream, &p_sys->venc_cfg, p_cfg->psz_value,
+                                &p_renditions[p_sys->i_renditions++] );
+        }
+    }
+
+    p_sys->i_key_interval =
+        vlc_tick_from_sec( var_GetFloat( p_stream, SOUT_CFG_PREFIX "keyint" ) );
+    if( p_sys->i_key_interval <= 0 && p_sys->i_renditions > 0 )
+        p_sys->i_key_interval = VLC_TICK_FROM_SEC(2);
+
     if( var_GetBool( p_stream, SOUT_CFG_PREFIX "deinterlace" ) )
     {
         psz_string = var_GetString( p_stream,
@@ -483,6 +597,9 @@ static void Close( vlc_object_t * p_this )
 
     transcode_encoder_config_clean( &p_sys->venc_cfg );
     sout_filters_config_clean( &p_sys->vfilters_cfg );
+    for( int i = 0; i < p_sys->i_renditions; i++ )
+        transcode_encoder_config_clean( &p_sys->p_renditions[i].enc_cfg );
+    free( p_sys->p_renditions );
 
     transcode_encoder_config_clean( &p_sys->aenc_cfg );
     sout_filters_config_clean( &p_sys->afilters_cfg );
@@ -713,6 +830,14 @@ static int Send( sout_stream_t *p_stream, void *_id, block_t *p_buffer )
             goto error;
     }
 
+    /* Decoders may modify their input in place */
+    if( p_buffer != NULL )
+    {
+        p_buffer = block_Unshare( p_buffer );
+        if( unlikely(p_buffer == NULL) )
+            return VLC_ENOMEM;
+    }
+
     int i_ret;
     switch( id->p_decoder->fmt_in.i_cat )
     {
@@ -38,6 +38,13 @@ void sout_filters_config_clean( sout_filters_config_t *p_cfg )
     free( p_cfg->video.psz_spu_sources );
 }
 
+/* Another encoding of the transcoded video, at its own size and bitrate */
+typedef struct
+{
+    transcode_encoder_config_t enc_cfg;
+    int             i_id; /**< ES id of the output, 0 to derive it */
+} transcode_rendition_config_t;
+
 typedef struct sout_stream_id_sys_t sout_stream_id_sys_t;
 
 typedef struct
@@ -53,6 +60,9 @@ typedef struct
     /* Video */
     transcode_encoder_config_t venc_cfg;
     sout_filters_config_t vfilters_cfg;
+    int                   i_renditions;
+    transcode_rendition_config_t *p_renditions;
+    vlc_tick_t            i_key_interval;
 
     /* SPU */
     transcode_encoder_config_t senc_cfg;
@@ -65,6 +75,15 @@ typedef struct
 
 struct aout_filters;
 
+typedef struct
+{
+    const transcode_rendition_config_t *p_cfg;
+    transcode_encoder_t *encoder;
+    filter_chain_t  *p_chain; /**< Scaling from the parent pictures */
+    int             i_parent; /**< Rendition scaled from, -1 for the main one */
+    void            *downstream_id;
+} transcode_rendition_t;
+
 struct sout_stream_id_sys_t
 {
     bool            b_transcode;
@@ -123,6 +142,9 @@ struct sout_stream_id_sys_t
              filter_t        *p_spu_blender;
              spu_t           *p_spu;
              video_format_t  fmt_input_video;
+             transcode_rendition_t *p_renditions;
+             int             i_renditions;
+             vlc_tick_t      i_next_key; /**< Date of the next forced key frame */
          };
          struct
          {
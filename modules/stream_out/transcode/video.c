@@ -134,6 +134,56 @@ static picture_t *transcode_dequeue_all_pics( sout_stream_id_sys_t *id )
     return p_pics;
 }
 
+/* The renditions encoders are tested like the main one, and they are only
+ * opened with the first picture. One failing is left out of the output. */
+static void transcode_video_renditions_init( sout_stream_t *p_stream,
+                                             sout_stream_id_sys_t *id )
+{
+    const sout_stream_sys_t *p_sys = p_stream->p_sys;
+
+    id->p_renditions = NULL;
+    id->i_renditions = 0;
+    id->i_next_key = VLC_TICK_INVALID;
+    if( p_sys->i_renditions == 0 )
+        return;
+
+    id->p_renditions = vlc_alloc( p_sys->i_renditions,
+                                  sizeof(*id->p_renditions) );
+    if( unlikely(id->p_renditions == NULL) )
+        return;
+
+    for( int i = 0; i < p_sys->i_renditions; i++ )
+    {
+        const transcode_rendition_config_t *p_cfg = &p_sys->p_renditions[i];
+        es_format_t fmt_in;
+        es_format_Init( &fmt_in, VIDEO_ES, 0 );
+
+        if( transcode_encoder_test( VLC_OBJECT(p_stream), &p_cfg->enc_cfg,
+                                    &id->p_decoder->fmt_in,
+                                    id->p_decoder->fmt_out.i_codec,
+                                    &fmt_in ) )
+        {
+            msg_Err( p_stream, "cannot encode rendition %d", i );
+            es_format_Clean( &fmt_in );
+            continue;
+        }
+
+        transcode_encoder_t *p_enc =
+            transcode_encoder_new( VLC_OBJECT(p_stream), &fmt_in );
+        es_format_Clean( &fmt_in );
+        if( !p_enc )
+            continue;
+
+        transcode_rendition_t *p_rendition =
+            &id->p_renditions[id->i_renditions++];
+        p_rendition->p_cfg = p_cfg;
+        p_rendition->encoder = p_enc;
+        p_rendition->p_chain = NULL;
+        p_rendition->i_parent = -1;
+        p_rendition->downstream_id = NULL;
+    }
+}
+
 int transcode_video_init( sout_stream_t *p_stream, const es_format_t *p_fmt,
                           sout_stream_id_sys_t *id )
 {
@@ -220,6 +270,8 @@ int transcode_video_init( sout_stream_t *p_stream, const es_format_t *p_fmt,
 
     es_format_Clean( &encoder_tested_fmt_in );
 
+    transcode_video_renditions_init( p_stream, id );
+
     return VLC_SUCCESS;
 }
 
@@ -241,8 +293,10 @@ static void transcode_video_filter_init( sout_stream_t *p_stream,
         .video = &transcode_filter_video_cbs,
         .sys = id,
     };
+    const unsigned i_pipeline = var_InheritInteger( p_stream, "video-filter-pipeline" );
     id->p_f_chain = filter_chain_NewVideo( p_stream, false, &owner );
     filter_chain_Reset( id->p_f_chain, p_src, p_src );
+    filter_chain_SetPipelined( id->p_f_chain, i_pipeline, NULL, NULL );
 
     /* Deinterlace */
     if( p_cfg->video.psz_deinterlace != NULL )
@@ -271,6 +325,7 @@ static void transcode_video_filter_init( sout_stream_t *p_stream,
     {
         id->p_uf_chain = filter_chain_NewVideo( p_stream, true, &owner );
         filter_chain_Reset( id->p_uf_chain, p_src, p_dst );
+        filter_chain_SetPipelined( id->p_uf_chain, i_pipeline, NULL, NULL );
         if( p_src->video.i_chroma != p_dst->video.i_chroma )
         {
             filter_chain_AppendConverter( id->p_uf_chain, p_src, p_dst );
@@ -308,12 +363,23 @@ static int conversion_video_filter_append( sout_stream_id_sys_t *id,
 void transcode_video_clean( sout_stream_t *p_stream,
                                    sout_stream_id_sys_t *id )
 {
-    VLC_UNUSED(p_stream);
-
     /* Close encoder */
     transcode_encoder_close( id->encoder );
     transcode_encoder_delete( id->encoder );
 
+    for( int i = 0; i < id->i_renditions; i++ )
+    {
+        transcode_rendition_t *p_rendition = &id->p_renditions[i];
+
+        transcode_encoder_close( p_rendition->encoder );
+        transcode_encoder_delete( p_rendition->encoder );
+        if( p_rendition->p_chain )
+            filter_chain_Delete( p_rendition->p_chain );
+        if( p_rendition->downstream_id )
+            sout_StreamIdDel( p_stream->p_next, p_rendition->downstream_id );
+    }
+    free( id->p_renditions );
+
     video_format_Clean( &id->fmt_input_video );
     es_format_Clean( &id->decoder_out );
 
@@ -419,12 +485,286 @@ static void tag_last_block_with_flag( block_t **out, int i_flag )
     }
 }
 
+/* Scales from the smallest of the main and previous renditions pictures that
+ * is at least as large, so that a ladder is scaled down step by step. */
+static int transcode_rendition_parent( sout_stream_id_sys_t *id, int i )
+{
+    const video_format_t *p_dst =
+        &transcode_encoder_format_in( id->p_renditions[i].encoder )->video;
+    const video_format_t *p_best =
+        &transcode_encoder_format_in( id->encoder )->video;
+    int i_parent = -1;
+
+    for( int j = 0; j < i; j++ )
+    {
+        const transcode_rendition_t *p_rendition = &id->p_renditions[j];
+        if( !transcode_encoder_opened( p_rendition->encoder ) )
+            continue;
+
+        const video_format_t *p_src =
+            &transcode_encoder_format_in( p_rendition->encoder )->video;
+        if( p_src->i_width < p_dst->i_width ||
+            p_src->i_height < p_dst->i_height )
+            continue;
+        if( p_best->i_width >= p_dst->i_width &&
+            p_best->i_height >= p_dst->i_height &&
+            p_src->i_width * p_src->i_height >=
+            p_best->i_width * p_best->i_height )
+            continue;
+        p_best = p_src;
+        i_parent = j;
+    }
+    return i_parent;
+}
+
+static void transcode_video_renditions_configure( sout_stream_t *p_stream,
+                                                  sout_stream_id_sys_t *id,
+                                                  const video_format_t *p_src )
+{
+    for( int i = 0; i < id->i_renditions; i++ )
+        transcode_encoder_video_configure( VLC_OBJECT(p_stream),
+                                           &id->p_decoder->fmt_in.video,
+                                           &id->p_decoder->fmt_out.video,
+                                           &id->p_renditions[i].p_cfg->enc_cfg,
+                                           p_src,
+                                           id->p_renditions[i].encoder );
+}
+
+/* Closes a rendition that cannot be output, the others go on without it */
+static void transcode_rendition_disable( sout_stream_t *p_stream,
+                                         transcode_rendition_t *p_rendition,
+                                         int i )
+{
+    msg_Warn( p_stream, "rendition %d disabled", i );
+    transcode_encoder_close( p_rendition->encoder );
+    if( p_rendition->p_chain )
+        filter_chain_Delete( p_rendition->p_chain );
+    p_rendition->p_chain = NULL;
+}
+
+/* Opens the missing renditions encoders, and rebuilds all the scaling chains
+ * since the source pictures can have changed along with the main encoder. */
+static void transcode_video_renditions_open( sout_stream_t *p_stream,
+                                             sout_stream_id_sys_t *id )
+{
+    filter_owner_t owner = {
+        .video = &transcode_filter_video_cbs,
+        .sys = id,
+    };
+
+    for( int i = 0; i < id->i_renditions; i++ )
+    {
+        transcode_rendition_t *p_rendition = &id->p_renditions[i];
+        const transcode_encoder_config_t *p_cfg = &p_rendition->p_cfg->enc_cfg;
+
+        if( p_rendition->p_chain )
+            filter_chain_Delete( p_rendition->p_chain );
+        p_rendition->p_chain = NULL;
+
+        if( !transcode_encoder_opened( p_rendition->encoder ) &&
+            transcode_encoder_open( p_rendition->encoder, p_cfg ) != VLC_SUCCESS )
+        {
+            msg_Err( p_stream, "cannot find video encoder for rendition %d "
+                               "(module:%s fourcc:%4.4s)", i,
+                               p_cfg->psz_name ? p_cfg->psz_name : "any",
+                               (char *)&p_cfg->i_codec );
+            transcode_rendition_disable( p_stream, p_rendition, i );
+            continue;
+        }
+
+        p_rendition->i_parent = transcode_rendition_parent( id, i );
+
+        const es_format_t *p_src = transcode_encoder_format_in(
+            p_rendition->i_parent >= 0
+                ? id->p_renditions[p_rendition->i_parent].encoder
+                : id->encoder );
+        const es_format_t *p_dst =
+            transcode_encoder_format_in( p_rendition->encoder );
+
+        p_rendition->p_chain = filter_chain_NewVideo( p_stream, false, &owner );
+        if( p_rendition->p_chain )
+            filter_chain_Reset( p_rendition->p_chain, p_src, p_dst );
+        if( !p_rendition->p_chain ||
+            ( ( p_src->video.i_chroma != p_dst->video.i_chroma ||
+                p_src->video.i_width != p_dst->video.i_width ||
+                p_src->video.i_height != p_dst->video.i_height ) &&
+              filter_chain_AppendConverter( p_rendition->p_chain,
+                                            p_src, p_dst ) != VLC_SUCCESS ) )
+        {
+            msg_Err( p_stream, "cannot scale rendition %d", i );
+            transcode_rendition_disable( p_stream, p_rendition, i );
+            continue;
+        }
+
+        msg_Dbg( p_stream, "rendition %d %ux%u, scaled from %s %d", i,
+                 p_dst->video.i_width, p_dst->video.i_height,
+                 p_rendition->i_parent >= 0 ? "rendition" : "main video",
+                 p_rendition->i_parent );
+
+        if( !p_rendition->downstream_id )
+        {
+            /* Another ES of the same program, which can be selected apart */
+            es_format_t fmt;
+            es_format_Copy( &fmt,
+                            transcode_encoder_format_out( p_rendition->encoder ) );
+            fmt.i_id = p_rendition->p_cfg->i_id > 0
+                     ? p_rendition->p_cfg->i_id
+                     : id->p_decoder->fmt_in.i_id + 65536 * (i + 1);
+            fmt.i_group = id->p_decoder->fmt_in.i_group;
+            p_rendition->downstream_id = sout_StreamIdAdd( p_stream->p_next,
+                                                           &fmt );
+            es_format_Clean( &fmt );
+        }
+        if( !p_rendition->downstream_id )
+        {
+            msg_Err( p_stream, "cannot output rendition %d", i );
+            transcode_rendition_disable( p_stream, p_rendition, i );
+        }
+    }
+}
+
+static void transcode_rendition_send( sout_stream_t *p_stream,
+                                      transcode_rendition_t *p_rendition,
+                                      block_t *p_out )
+{
+    if( !p_out )
+        return;
+    /* Left over by the encoder thread of a disabled rendition */
+    if( !p_rendition->downstream_id )
+        block_ChainRelease( p_out );
+    else
+        sout_StreamIdSend( p_stream->p_next, p_rendition->downstream_id, p_out );
+}
+
+/* Encodes the renditions of a picture of the main encoder, each one being
+ * scaled from its parent picture. */
+static void transcode_video_renditions_encode( sout_stream_t *p_stream,
+                                               sout_stream_id_sys_t *id,
+                                               picture_t *p_pic )
+{
+    if( id->i_renditions == 0 )
+        return;
+
+    picture_t *pp_pics[id->i_renditions];
+
+    for( int i = 0; i < id->i_renditions; i++ )
+    {
+        transcode_rendition_t *p_rendition = &id->p_renditions[i];
+        picture_t *p_src = p_rendition->i_parent >= 0
+                         ? pp_pics[p_rendition->i_parent] : p_pic;
+
+        pp_pics[i] = NULL;
+        if( !p_src || !transcode_encoder_opened( p_rendition->encoder ) )
+            continue;
+
+        /* The parent picture is still needed by the other encoders */
+        pp_pics[i] = filter_chain_VideoFilter( p_rendition->p_chain,
+                                               picture_Hold( p_src ) );
+        if( pp_pics[i] )
+            transcode_rendition_send( p_stream, p_rendition,
+                transcode_encoder_encode( p_rendition->encoder, pp_pics[i] ) );
+    }
+
+    for( int i = 0; i < id->i_renditions; i++ )
+        if( pp_pics[i] )
+            picture_Release( pp_pics[i] );
+}
+
+static void transcode_video_renditions_drain( sout_stream_t *p_stream,
+                                              sout_stream_id_sys_t *id,
+                                              bool b_eos )
+{
+    for( int i = 0; i < id->i_renditions; i++ )
+    {
+        transcode_rendition_t *p_rendition = &id->p_renditions[i];
+        block_t *p_out = NULL;
+
+        if( !transcode_encoder_opened( p_rendition->encoder ) )
+            continue;
+
+        if( transcode_encoder_drain( p_rendition->encoder, &p_out ) != VLC_SUCCESS )
+            msg_Warn( p_stream, "Flushing rendition %d failed", i );
+        if( b_eos )
+        {
+            transcode_encoder_close( p_rendition->encoder );
+            tag_last_block_with_flag( &p_out, BLOCK_FLAG_END_OF_SEQUENCE );
+        }
+        transcode_rendition_send( p_stream, p_rendition, p_out );
+    }
+}
+
+/* Forces key frames at the same pictures in all the encodings, on a grid of
+ * dates restarted when the dates jump. */
+static void transcode_video_force_key( sout_stream_t *p_stream,
+                                       sout_stream_id_sys_t *id,
+                                       picture_t *p_pic )
+{
+    const vlc_tick_t i_interval =
+        ((const sout_stream_sys_t *)p_stream->p_sys)->i_key_interval;
+
+    if( i_interval <= 0 || p_pic->date == VLC_TICK_INVALID )
+        return;
+
+    if( id->i_next_key != VLC_TICK_INVALID &&
+        p_pic->date < id->i_next_key &&
+        p_pic->date >= id->i_next_key - i_interval )
+        return;
+
+    p_pic->b_keyframe = true;
+    if( id->i_next_key == VLC_TICK_INVALID ||
+        p_pic->date < id->i_next_key ||
+        p_pic->date >= id->i_next_key + i_interval )
+        id->i_next_key = p_pic->date;
+    id->i_next_key += i_interval;
+}
+
+/* Runs a filter chain, waiting for the pictures in flight when draining */
+static picture_t *transcode_video_filter( filter_chain_t *p_chain,
+                                          picture_t *p_pic, bool b_drain )
+{
+    if( p_pic == NULL && b_drain )
+        return filter_chain_VideoDrain( p_chain );
+    return filter_chain_VideoFilter( p_chain, p_pic );
+}
+
+static void transcode_video_filter_user( sout_stream_t *p_stream,
+                                         sout_stream_id_sys_t *id,
+                                         picture_t *p_in, bool b_drain,
+                                         block_t **out )
+{
+    for ( ;; p_in = NULL /* drain second time */ )
+    {
+        /* Run user specified filter chain */
+        if( id->p_uf_chain )
+            p_in = transcode_video_filter( id->p_uf_chain, p_in, b_drain );
+
+        if( !p_in )
+            break;
+
+        /* Blend subpictures */
+        p_in = RenderSubpictures( p_stream, id, p_in );
+
+        if( p_in )
+        {
+            transcode_video_force_key( p_stream, id, p_in );
+            transcode_video_renditions_encode( p_stream, id, p_in );
+
+            block_t *p_encoded = transcode_encoder_encode( id->encoder, p_in );
+            if( p_encoded )
+                block_ChainAppend( out, p_encoded );
+            picture_Release( p_in );
+        }
+    }
+}
+
 int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                                     block_t *in, block_t **out )
 {
     *out = NULL;
 
     const bool b_eos = in && (in->i_flags & BLOCK_FLAG_END_OF_SEQUENCE);
+    /* Pipelined filter chains must output everything they hold */
+    const bool b_drain = b_eos || in == NULL;
 
     int ret = id->p_decoder->pf_decode( id->p_decoder, in );
     if( ret != VLCDEC_SUCCESS )
@@ -458,6 +798,8 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                                                    id->p_enccfg,
                                                    filtered_video_format( id, p_pic ),
                                                    id->encoder );
+                transcode_video_renditions_configure( p_stream, id,
+                                                      filtered_video_format( id, p_pic ) );
                 /* will be opened below */
             }
             else /* picture format has changed */
@@ -516,6 +858,8 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                                    (char *) &id->p_enccfg->i_codec );
                 goto error;
             }
+
+            transcode_video_renditions_open( p_stream, id );
         }
 
         /* Run the filter and output chains; first with the picture,
@@ -526,32 +870,16 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
         {
             /* Run filter chain */
             if( id->p_f_chain )
-                p_in = filter_chain_VideoFilter( id->p_f_chain, p_in );
+                p_in = transcode_video_filter( id->p_f_chain, p_in, b_drain );
 
             if( !p_in )
                 break;
 
-            for ( ;; p_in = NULL /* drain second time */ )
-            {
-                /* Run user specified filter chain */
-                if( id->p_uf_chain )
-                    p_in = filter_chain_VideoFilter( id->p_uf_chain, p_in );
-
-                if( !p_in )
-                    break;
-
-                /* Blend subpictures */
-                p_in = RenderSubpictures( p_stream, id, p_in );
-
-                if( p_in )
-                {
-                    block_t *p_encoded = transcode_encoder_encode( id->encoder, p_in );
-                    if( p_encoded )
-                        block_ChainAppend( out, p_encoded );
-                    picture_Release( p_in );
-                }
-            }
+            transcode_video_filter_user( p_stream, id, p_in, b_drain, out );
         }
+        /* The user chain can still hold pictures in flight */
+        if( b_drain && id->p_uf_chain )
+            transcode_video_filter_user( p_stream, id, NULL, true, out );
 
         if( b_eos )
         {
@@ -561,6 +889,7 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
             transcode_encoder_close( id->encoder );
             if( b_eos )
                 tag_last_block_with_flag( out, BLOCK_FLAG_END_OF_SEQUENCE );
+            transcode_video_renditions_drain( p_stream, id, true );
         }
 
         continue;
@@ -575,6 +904,9 @@ error:
         /* Pick up any return data the encoder thread wants to output. */
         block_ChainAppend( out, transcode_encoder_get_output_async( id->encoder ) );
     }
+    for( int i = 0; i < id->i_renditions; i++ )
+        transcode_rendition_send( p_stream, &id->p_renditions[i],
+            transcode_encoder_get_output_async( id->p_renditions[i].encoder ) );
 
     /* Drain encoder */
     if( unlikely( !id->b_error && in == NULL ) && transcode_encoder_opened( id->encoder ) )
@@ -584,6 +916,7 @@ error:
             msg_Dbg( p_stream, "Flushing done");
         else
             msg_Warn( p_stream, "Flushing failed");
+        transcode_video_renditions_drain( p_stream, id, false );
     }
 
     if( b_eos )
@@ -0,0 +1,577 @@
+/*****************************************************************************
+ * glyph_cache.c : Glyph and shaped runs cache
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/** \ingroup freetype
+ * @{
+ * \file
+ * Glyph and shaped runs cache
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_filter.h>
+#include <vlc_list.h>
+
+#include "glyph_cache.h"
+
+#define HASH_MIN_SIZE 256
+
+enum
+{
+    ENTRY_OUTLINES = 0,
+    ENTRY_BITMAP,
+    ENTRY_RUN,
+    ENTRY_TYPES
+};
+
+typedef struct glyph_cache_entry_t glyph_cache_entry_t;
+
+struct glyph_cache_entry_t
+{
+    struct vlc_list      node;      /**< LRU order, most recent first */
+    glyph_cache_entry_t *p_next;    /**< hash bucket chain */
+    uint32_t             i_hash;
+    uint8_t              i_type;
+    size_t               i_size;    /**< accounted memory */
+
+    union
+    {
+        struct
+        {
+            glyph_cache_key_t key;
+            FT_Glyph  p_glyph;
+            FT_Glyph  p_outline;
+            FT_Vector advance;
+        } outlines;
+        struct
+        {
+            glyph_cache_key_t key;
+            bool      b_outline;
+            uint8_t   i_subpixel_x;
+            uint8_t   i_subpixel_y;
+            FT_Glyph  p_bitmap;
+        } bitmap;
+        struct
+        {
+            FT_Face   p_face;
+            uint32_t  i_script;
+            uint32_t  i_direction;
+            size_t    i_text;
+            uni_char_t *p_text;
+            unsigned  i_glyphs;
+            glyph_cache_run_glyph_t *p_glyphs;
+        } run;
+    };
+};
+
+struct glyph_cache_t
+{
+    glyph_cache_entry_t **pp_buckets;
+    size_t           i_buckets;
+    size_t           i_entries;
+    struct vlc_list  lru;
+
+    size_t           i_size;
+    size_t           i_max_size;
+
+    struct
+    {
+        uint64_t i_hits;
+        uint64_t i_misses;
+    } stats[ENTRY_TYPES];
+    uint64_t         i_evictions;
+};
+
+/*****************************************************************************
+ * Hashing
+ *****************************************************************************/
+static inline uint32_t HashMix( uint32_t h, uint32_t v )
+{
+    h ^= v;
+    return h * UINT32_C(0x01000193);
+}
+
+static inline uint32_t HashPointer( uint32_t h, const void *p )
+{
+    uintptr_t v = (uintptr_t) p;
+    h = HashMix( h, (uint32_t) v );
+#if UINTPTR_MAX > UINT32_MAX
+    h = HashMix( h, (uint32_t) (v >> 32) );
+#endif
+    return h;
+}
+
+static uint32_t HashKey( uint8_t i_type, const glyph_cache_key_t *p_key )
+{
+    uint32_t h = HashMix( UINT32_C(0x811c9dc5), i_type );
+    h = HashPointer( h, p_key->p_face );
+    h = HashMix( h, p_key->i_glyph_index );
+    h = HashMix( h, p_key->i_flags );
+    return HashMix( h, (uint32_t) p_key->i_outline_radius );
+}
+
+static uint32_t HashRun( FT_Face p_face, uint32_t i_script, uint32_t i_direction,
+                         const uni_char_t *p_text, size_t i_text )
+{
+    uint32_t h = HashMix( UINT32_C(0x811c9dc5), ENTRY_RUN );
+    h = HashPointer( h, p_face );
+    h = HashMix( h, i_script );
+    h = HashMix( h, i_direction );
+    for( size_t i = 0; i < i_text; i++ )
+        h = HashMix( h, p_text[i] );
+    return h;
+}
+
+static inline bool KeyEquals( const glyph_cache_key_t *a, const glyph_cache_key_t *b )
+{
+    return a->p_face == b->p_face && a->i_glyph_index == b->i_glyph_index &&
+           a->i_flags == b->i_flags && a->i_outline_radius == b->i_outline_radius;
+}
+
+/*****************************************************************************
+ * Memory accounting
+ *****************************************************************************/
+static size_t GlyphSize( FT_Glyph p_glyph )
+{
+    if( !p_glyph )
+        return 0;
+
+    switch( p_glyph->format )
+    {
+        case FT_GLYPH_FORMAT_OUTLINE:
+        {
+            const FT_Outline *p_outline = &((FT_OutlineGlyph) p_glyph)->outline;
+            return sizeof( FT_OutlineGlyphRec ) +
+                   p_outline->n_points * ( sizeof( FT_Vector ) + 1 ) +
+                   p_outline->n_contours * sizeof( short );
+        }
+        case FT_GLYPH_FORMAT_BITMAP:
+        {
+            const FT_Bitmap *p_bitmap = &((FT_BitmapGlyph) p_glyph)->bitmap;
+            return sizeof( FT_BitmapGlyphRec ) +
+                   p_bitmap->rows * (size_t) abs( p_bitmap->pitch );
+        }
+        default:
+            return sizeof( FT_GlyphRec );
+    }
+}
+
+/*****************************************************************************
+ * Entries
+ *****************************************************************************/
+static void EntryDelete( glyph_cache_entry_t *p_entry )
+{
+    switch( p_entry->i_type )
+    {
+        case ENTRY_OUTLINES:
+            FT_Done_Glyph( p_entry->outlines.p_glyph );
+            if( p_entry->outlines.p_outline )
+                FT_Done_Glyph( p_entry->outlines.p_outline );
+            break;
+        case ENTRY_BITMAP:
+            FT_Done_Glyph( p_entry->bitmap.p_bitmap );
+            break;
+        case ENTRY_RUN:
+            free( p_entry->run.p_text );
+            free( p_entry->run.p_glyphs );
+            break;
+    }
+    free( p_entry );
+}
+
+static void Unlink( glyph_cache_t *p_cache, glyph_cache_entry_t *p_entry )
+{
+    glyph_cache_entry_t **pp = &p_cache->pp_buckets[p_entry->i_hash & (p_cache->i_buckets - 1)];
+    while( *pp != p_entry )
+        pp = &(*pp)->p_next;
+    *pp = p_entry->p_next;
+
+    vlc_list_remove( &p_entry->node );
+    p_cache->i_entries--;
+    p_cache->i_size -= p_entry->i_size;
+}
+
+static void Evict( glyph_cache_t *p_cache, size_t i_needed )
+{
+    while( p_cache->i_size + i_needed > p_cache->i_max_size &&
+           !vlc_list_is_empty( &p_cache->lru ) )
+    {
+        glyph_cache_entry_t *p_entry =
+            vlc_list_last_entry_or_null( &p_cache->lru, glyph_cache_entry_t, node );
+        Unlink( p_cache, p_entry );
+        EntryDelete( p_entry );
+        p_cache->i_evictions++;
+    }
+}
+
+static void Grow( glyph_cache_t *p_cache )
+{
+    if( p_cache->i_entries < p_cache->i_buckets )
+        return;
+
+    const size_t i_buckets = p_cache->i_buckets * 2;
+    glyph_cache_entry_t **pp_buckets = calloc( i_buckets, sizeof( *pp_buckets ) );
+    if( unlikely( !pp_buckets ) )
+        return;
+
+    for( size_t i = 0; i < p_cache->i_buckets; i++ )
+    {
+        for( glyph_cache_entry_t *p_entry = p_cache->pp_buckets[i]; p_entry; )
+        {
+            glyph_cache_entry_t *p_next = p_entry->p_next;
+            glyph_cache_entry_t **pp = &pp_buckets[p_entry->i_hash & (i_buckets - 1)];
+            p_entry->p_next = *pp;
+            *pp = p_entry;
+            p_entry = p_next;
+        }
+    }
+    free( p_cache->pp_buckets );
+    p_cache->pp_buckets = pp_buckets;
+    p_cache->i_buckets = i_buckets;
+}
+
+/* Takes ownership of the entry, which is deleted if it doesn't fit */
+static void Insert( glyph_cache_t *p_cache, glyph_cache_entry_t *p_entry )
+{
+    if( p_entry->i_size > p_cache->i_max_size / 4 )
+    {
+        EntryDelete( p_entry );
+        return;
+    }
+
+    Evict( p_cache, p_entry->i_size );
+    Grow( p_cache );
+
+    glyph_cache_entry_t **pp = &p_cache->pp_buckets[p_entry->i_hash & (p_cache->i_buckets - 1)];
+    p_entry->p_next = *pp;
+    *pp = p_entry;
+
+    vlc_list_prepend( &p_entry->node, &p_cache->lru );
+    p_cache->i_entries++;
+    p_cache->i_size += p_entry->i_size;
+}
+
+static void Touch( glyph_cache_t *p_cache, glyph_cache_entry_t *p_entry )
+{
+    vlc_list_remove( &p_entry->node );
+    vlc_list_prepend( &p_entry->node, &p_cache->lru );
+    p_cache->stats[p_entry->i_type].i_hits++;
+}
+
+static glyph_cache_entry_t *EntryNew( uint8_t i_type, uint32_t i_hash )
+{
+    glyph_cache_entry_t *p_entry = calloc( 1, sizeof( *p_entry ) );
+    if( unlikely( !p_entry ) )
+        return NULL;
+    p_entry->i_type = i_type;
+    p_entry->i_hash = i_hash;
+    p_entry->i_size = sizeof( *p_entry );
+    return p_entry;
+}
+
+/*****************************************************************************
+ * Public API
+ *****************************************************************************/
+glyph_cache_t *GlyphCache_New( size_t i_max_size )
+{
+    glyph_cache_t *p_cache = calloc( 1, sizeof( *p_cache ) );
+    if( unlikely( !p_cache ) )
+        return NULL;
+
+    p_cache->pp_buckets = calloc( HASH_MIN_SIZE, sizeof( *p_cache->pp_buckets ) );
+    if( unlikely( !p_cache->pp_buckets ) )
+    {
+        free( p_cache );
+        return NULL;
+    }
+    p_cache->i_buckets = HASH_MIN_SIZE;
+    p_cache->i_max_size = i_max_size;
+    vlc_list_init( &p_cache->lru );
+
+    return p_cache;
+}
+
+void GlyphCache_Delete( glyph_cache_t *p_cache, vlc_object_t *p_obj )
+{
+    static const char *const ppsz_types[ENTRY_TYPES] = {
+        "outlines", "bitmaps", "shaped runs"
+    };
+
+    if( !p_cache )
+        return;
+
+    for( int i = 0; i < ENTRY_TYPES; i++ )
+    {
+        const uint64_t i_total = p_cache->stats[i].i_hits + p_cache->stats[i].i_misses;
+        if( i_total )
+            msg_Dbg( p_obj, "glyph cache: %s %"PRIu64" hits, %"PRIu64" misses (%.1f%%)",
+                     ppsz_types[i], p_cache->stats[i].i_hits, p_cache->stats[i].i_misses,
+                     100.0 * p_cache->stats[i].i_hits / i_total );
+    }
+    msg_Dbg( p_obj, "glyph cache: %zu entries, %zu/%zu bytes, %"PRIu64" evictions",
+             p_cache->i_entries, p_cache->i_size, p_cache->i_max_size,
+             p_cache->i_evictions );
+
+    glyph_cache_entry_t *p_entry;
+    vlc_list_foreach( p_entry, &p_cache->lru, node )
+        EntryDelete( p_entry );
+    free( p_cache->pp_buckets );
+    free( p_cache );
+}
+
+static glyph_cache_entry_t *FindGlyph( glyph_cache_t *p_cache, uint8_t i_type,
+                                       const glyph_cache_key_t *p_key, uint32_t i_hash,
+                                       bool b_outline, uint8_t i_subpixel_x,
+                                       uint8_t i_subpixel_y )
+{
+    for( glyph_cache_entry_t *p_entry = p_cache->pp_buckets[i_hash & (p_cache->i_buckets - 1)];
+         p_entry; p_entry = p_entry->p_next )
+    {
+        if( p_entry->i_hash != i_hash || p_entry->i_type != i_type )
+            continue;
+        if( i_type == ENTRY_OUTLINES )
+        {
+            if( KeyEquals( &p_entry->outlines.key, p_key ) )
+                return p_entry;
+        }
+        else if( KeyEquals( &p_entry->bitmap.key, p_key ) &&
+                 p_entry->bitmap.b_outline == b_outline &&
+                 p_entry->bitmap.i_subpixel_x == i_subpixel_x &&
+                 p_entry->bitmap.i_subpixel_y == i_subpixel_y )
+            return p_entry;
+    }
+    return NULL;
+}
+
+int GlyphCache_GetOutlines( glyph_cache_t *p_cache, const glyph_cache_key_t *p_key,
+                            FT_Glyph *pp_glyph, FT_Glyph *pp_outline,
+                            FT_Vector *p_advance )
+{
+    if( !p_cache || !p_key->p_face )
+        return VLC_EGENERIC;
+
+    glyph_cache_entry_t *p_entry =
+        FindGlyph( p_cache, ENTRY_OUTLINES, p_key,
+                   HashKey( ENTRY_OUTLINES, p_key ), false, 0, 0 );
+    if( !p_entry )
+    {
+        p_cache->stats[ENTRY_OUTLINES].i_misses++;
+        return VLC_EGENERIC;
+    }
+
+    *pp_outline = NULL;
+    if( FT_Glyph_Copy( p_entry->outlines.p_glyph, pp_glyph ) )
+        return VLC_EGENERIC;
+    if( p_entry->outlines.p_outline &&
+        FT_Glyph_Copy( p_entry->outlines.p_outline, pp_outline ) )
+    {
+        FT_Done_Glyph( *pp_glyph );
+        return VLC_EGENERIC;
+    }
+    *p_advance = p_entry->outlines.advance;
+
+    Touch( p_cache, p_entry );
+    return VLC_SUCCESS;
+}
+
+void GlyphCache_PutOutlines( glyph_cache_t *p_cache, const glyph_cache_key_t *p_key,
+                             FT_Glyph p_glyph, FT_Glyph p_outline,
+                             const FT_Vector *p_advance )
+{
+    if( !p_cache || !p_key->p_face )
+        return;
+
+    glyph_cache_entry_t *p_entry = EntryNew( ENTRY_OUTLINES,
+                                             HashKey( ENTRY_OUTLINES, p_key ) );
+    if( !p_entry )
+        return;
+
+    p_entry->outlines.key = *p_key;
+    p_entry->outlines.advance = *p_advance;
+    if( FT_Glyph_Copy( p_glyph, &p_entry->outlines.p_glyph ) )
+    {
+        free( p_entry );
+        return;
+    }
+    if( p_outline && FT_Glyph_Copy( p_outline, &p_entry->outlines.p_outline ) )
+    {
+        FT_Done_Glyph( p_entry->outlines.p_glyph );
+        free( p_entry );
+        return;
+    }
+    p_entry->i_size += GlyphSize( p_entry->outlines.p_glyph ) +
+                       GlyphSize( p_entry->outlines.p_outline );
+
+    Insert( p_cache, p_entry );
+}
+
+int GlyphCache_Render( glyph_cache_t *p_cache, const glyph_cache_key_t *p_key,
+                       bool b_outline, FT_Glyph p_glyph,
+                       const FT_Vector *p_pen, FT_Glyph *pp_bitmap )
+{
+    /* Embedded bitmaps are not positioned by FreeType either */
+    if( p_glyph->format == FT_GLYPH_FORMAT_BITMAP )
+        return FT_Glyph_Copy( p_glyph, pp_bitmap ) ? VLC_EGENERIC : VLC_SUCCESS;
+
+    if( !p_cache || !p_key->p_face )
+    {
+        FT_Glyph p_bitmap = p_glyph;
+        if( FT_Glyph_To_Bitmap( &p_bitmap, FT_RENDER_MODE_NORMAL,
+                                (FT_Vector *) p_pen, 0 ) )
+            return VLC_EGENERIC;
+        *pp_bitmap = p_bitmap;
+        return VLC_SUCCESS;
+    }
+
+    /* Render at the subpixel position, and move by whole pixels */
+    const int i_step = 64 / GLYPH_CACHE_SUBPIXELS;
+    const uint8_t i_subpixel_x = ( p_pen->x & 63 ) / i_step;
+    const uint8_t i_subpixel_y = ( p_pen->y & 63 ) / i_step;
+    const uint32_t i_hash = HashMix( HashMix( HashMix( HashKey( ENTRY_BITMAP, p_key ),
+                                                       b_outline ),
+                                              i_subpixel_x ),
+                                     i_subpixel_y );
+
+    glyph_cache_entry_t *p_entry =
+        FindGlyph( p_cache, ENTRY_BITMAP, p_key, i_hash,
+                   b_outline, i_subpixel_x, i_subpixel_y );
+    if( p_entry )
+    {
+        if( FT_Glyph_Copy( p_entry->bitmap.p_bitmap, pp_bitmap ) )
+            return VLC_EGENERIC;
+        Touch( p_cache, p_entry );
+    }
+    else
+    {
+        p_cache->stats[ENTRY_BITMAP].i_misses++;
+
+        FT_Vector origin = { .x = i_subpixel_x * i_step, .y = i_subpixel_y * i_step };
+        FT_Glyph p_bitmap = p_glyph;
+        if( FT_Glyph_To_Bitmap( &p_bitmap, FT_RENDER_MODE_NORMAL, &origin, 0 ) )
+            return VLC_EGENERIC;
+
+        p_entry = EntryNew( ENTRY_BITMAP, i_hash );
+        if( !p_entry || FT_Glyph_Copy( p_bitmap, pp_bitmap ) )
+        {
+            free( p_entry );
+            *pp_bitmap = p_bitmap;
+        }
+        else
+        {
+            p_entry->bitmap.key = *p_key;
+            p_entry->bitmap.b_outline = b_outline;
+            p_entry->bitmap.i_subpixel_x = i_subpixel_x;
+            p_entry->bitmap.i_subpixel_y = i_subpixel_y;
+            p_entry->bitmap.p_bitmap = p_bitmap;
+            p_entry->i_size += GlyphSize( p_bitmap );
+            Insert( p_cache, p_entry );
+        }
+    }
+
+    FT_BitmapGlyph p_bitmap_glyph = (FT_BitmapGlyph) *pp_bitmap;
+    p_bitmap_glyph->left += FT_FLOOR( p_pen->x );
+    p_bitmap_glyph->top  += FT_FLOOR( p_pen->y );
+    return VLC_SUCCESS;
+}
+
+static glyph_cache_entry_t *FindRun( glyph_cache_t *p_cache, uint32_t i_hash,
+                                     FT_Face p_face, uint32_t i_script,
+                                     uint32_t i_direction,
+                                     const uni_char_t *p_text, size_t i_text )
+{
+    for( glyph_cache_entry_t *p_entry = p_cache->pp_buckets[i_hash & (p_cache->i_buckets - 1)];
+         p_entry; p_entry = p_entry->p_next )
+    {
+        if( p_entry->i_hash == i_hash && p_entry->i_type == ENTRY_RUN &&
+            p_entry->run.p_face == p_face &&
+            p_entry->run.i_script == i_script &&
+            p_entry->run.i_direction == i_direction &&
+            p_entry->run.i_text == i_text &&
+            !memcmp( p_entry->run.p_text, p_text, i_text * sizeof( *p_text ) ) )
+            return p_entry;
+    }
+    return NULL;
+}
+
+int GlyphCache_GetRun( glyph_cache_t *p_cache, FT_Face p_face,
+                       uint32_t i_script, uint32_t i_direction,
+                       const uni_char_t *p_text, size_t i_text,
+                       glyph_cache_run_glyph_t **pp_glyphs, unsigned *pi_glyphs )
+{
+    if( !p_cache )
+        return VLC_EGENERIC;
+
+    const uint32_t i_hash = HashRun( p_face, i_script, i_direction, p_text, i_text );
+    glyph_cache_entry_t *p_entry =
+        FindRun( p_cache, i_hash, p_face, i_script, i_direction, p_text, i_text );
+    if( !p_entry )
+    {
+        p_cache->stats[ENTRY_RUN].i_misses++;
+        return VLC_EGENERIC;
+    }
+
+    glyph_cache_run_glyph_t *p_glyphs = vlc_alloc( p_entry->run.i_glyphs,
+                                                   sizeof( *p_glyphs ) );
+    if( unlikely( !p_glyphs ) )
+        return VLC_EGENERIC;
+    memcpy( p_glyphs, p_entry->run.p_glyphs, p_entry->run.i_glyphs * sizeof( *p_glyphs ) );
+    *pp_glyphs = p_glyphs;
+    *pi_glyphs = p_entry->run.i_glyphs;
+
+    Touch( p_cache, p_entry );
+    return VLC_SUCCESS;
+}
+
+void GlyphCache_PutRun( glyph_cache_t *p_cache, FT_Face p_face,
+                        uint32_t i_script, uint32_t i_direction,
+                        const uni_char_t *p_text, size_t i_text,
+                        const glyph_cache_run_glyph_t *p_glyphs, unsigned i_glyphs )
+{
+    if( !p_cache || i_text == 0 || i_glyphs == 0 )
+        return;
+
+    glyph_cache_entry_t *p_entry =
+        EntryNew( ENTRY_RUN, HashRun( p_face, i_script, i_direction, p_text, i_text ) );
+    if( !p_entry )
+        return;
+
+    p_entry->run.p_face = p_face;
+    p_entry->run.i_script = i_script;
+    p_entry->run.i_direction = i_direction;
+    p_entry->run.i_text = i_text;
+    p_entry->run.i_glyphs = i_glyphs;
+    p_entry->run.p_text = vlc_alloc( i_text, sizeof( *p_text ) );
+    p_entry->run.p_glyphs = vlc_alloc( i_glyphs, sizeof( *p_glyphs ) );
+    if( unlikely( !p_entry->run.p_text || !p_entry->run.p_glyphs ) )
+    {
+        EntryDelete( p_entry );
+        return;
+    }
+    memcpy( p_entry->run.p_text, p_text, i_text * sizeof( *p_text ) );
+    memcpy( p_entry->run.p_glyphs, p_glyphs, i_glyphs * sizeof( *p_glyphs ) );
+    p_entry->i_size += i_text * sizeof( *p_text ) + i_glyphs * sizeof( *p_glyphs );
+
+    Insert( p_cache, p_entry );
+}
+
+/** @} */
@@ -0,0 +1,103 @@
+/*****************************************************************************
+ * glyph_cache.h : Glyph and shaped runs cache
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_FREETYPE_GLYPH_CACHE_H
+#define VLC_FREETYPE_GLYPH_CACHE_H
+
+/** \ingroup freetype
+ * @{
+ * \file
+ * Least recently used cache of loaded glyphs, rasterized glyphs and shaped
+ * runs, sharing a single memory budget.
+ *
+ * Faces are owned by the face_map and live as long as the filter, and
+ * have a fixed size, so that a face pointer identifies both the font and
+ * its size.
+ */
+
+#include "freetype.h"
+
+/** Number of cached subpixel positions, per pixel and per axis */
+#define GLYPH_CACHE_SUBPIXELS 4
+
+typedef struct glyph_cache_t glyph_cache_t;
+
+typedef struct
+{
+    FT_Face  p_face;           /**< NULL if the glyph is not cacheable */
+    unsigned i_glyph_index;
+    unsigned i_flags;          /**< emulated styles, GLYPH_CACHE_* */
+    FT_Fixed i_outline_radius; /**< stroker radius, 0 without outline */
+} glyph_cache_key_t;
+
+#define GLYPH_CACHE_BOLD    (1 << 0)
+#define GLYPH_CACHE_ITALIC  (1 << 1)
+
+/** Glyph of a shaped run, in HarfBuzz terms */
+typedef struct
+{
+    unsigned i_glyph_index;
+    unsigned i_cluster;
+    int      i_x_offset;
+    int      i_y_offset;
+    int      i_x_advance;
+    int      i_y_advance;
+} glyph_cache_run_glyph_t;
+
+glyph_cache_t *GlyphCache_New( size_t i_max_size );
+void GlyphCache_Delete( glyph_cache_t *, vlc_object_t * );
+
+/**
+ * Get copies of a loaded glyph and of its stroked outline, if any.
+ * Returns VLC_EGENERIC on miss.
+ */
+int GlyphCache_GetOutlines( glyph_cache_t *, const glyph_cache_key_t *,
+                            FT_Glyph *pp_glyph, FT_Glyph *pp_outline,
+                            FT_Vector *p_advance );
+void GlyphCache_PutOutlines( glyph_cache_t *, const glyph_cache_key_t *,
+                             FT_Glyph p_glyph, FT_Glyph p_outline,
+                             const FT_Vector *p_advance );
+
+/**
+ * Renders a glyph like FT_Glyph_To_Bitmap() would, without destroying it.
+ * The source is \p p_glyph, or its stroked outline if \p b_outline.
+ * With a cache, the subpixel position of the pen is rounded down to
+ * 1/GLYPH_CACHE_SUBPIXELS pixel.
+ */
+int GlyphCache_Render( glyph_cache_t *, const glyph_cache_key_t *,
+                       bool b_outline, FT_Glyph p_glyph,
+                       const FT_Vector *p_pen, FT_Glyph *pp_bitmap );
+
+/**
+ * Get a copy of a shaped run, to be freed by the caller.
+ * Returns VLC_EGENERIC on miss.
+ */
+int GlyphCache_GetRun( glyph_cache_t *, FT_Face p_face,
+                       uint32_t i_script, uint32_t i_direction,
+                       const uni_char_t *p_text, size_t i_text,
+                       glyph_cache_run_glyph_t **pp_glyphs, unsigned *pi_glyphs );
+void GlyphCache_PutRun( glyph_cache_t *, FT_Face p_face,
+                        uint32_t i_script, uint32_t i_direction,
+                        const uni_char_t *p_text, size_t i_text,
+                        const glyph_cache_run_glyph_t *p_glyphs, unsigned i_glyphs );
+
+/** @} */
+
+#endif
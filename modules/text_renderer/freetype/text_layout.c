@@ -64,6 +64,7 @@
 #include "freetype.h"
 #include "text_layout.h"
 #include "platform_fonts.h"
+#include "glyph_cache.h"
 
 #include <stdlib.h>
 
@@ -107,10 +108,7 @@ typedef struct run_desc_t
 #ifdef HAVE_HARFBUZZ
     hb_script_t                 script;
     hb_direction_t              direction;
-    hb_font_t                  *p_hb_font;
-    hb_buffer_t                *p_buffer;
-    hb_glyph_info_t            *p_glyph_infos;
-    hb_glyph_position_t        *p_glyph_positions;
+    glyph_cache_run_glyph_t    *p_glyphs;
     unsigned int                i_glyph_count;
 #endif
 
@@ -131,6 +129,7 @@ typedef struct glyph_bitmaps_t
     int      i_y_offset;
     int      i_x_advance;
     int      i_y_advance;
+    glyph_cache_key_t cache_key;
 } glyph_bitmaps_t;
 
 typedef struct paragraph_t
@@ -732,6 +731,76 @@ static int ItemizeParagraph( filter_t *p_filter, paragraph_t *p_paragraph )
 }
 
 #ifdef HAVE_HARFBUZZ
+/**
+ * Shape a single run using HarfBuzz, filling its glyphs
+ */
+static int ShapeRunHarfBuzz( filter_t *p_filter, run_desc_t *p_run, FT_Face p_face,
+                             const uni_char_t *p_text, size_t i_text )
+{
+    int i_ret = VLC_EGENERIC;
+
+    hb_font_t *p_hb_font = hb_ft_font_create( p_face, 0 );
+    if( !p_hb_font )
+    {
+        msg_Err( p_filter,
+                 "ShapeParagraphHarfBuzz(): hb_ft_font_create() error" );
+        return VLC_EGENERIC;
+    }
+
+    hb_buffer_t *p_buffer = hb_buffer_create();
+    if( !p_buffer )
+    {
+        msg_Err( p_filter,
+                 "ShapeParagraphHarfBuzz(): hb_buffer_create() error" );
+        goto end;
+    }
+
+    hb_buffer_set_direction( p_buffer, p_run->direction );
+    hb_buffer_set_script( p_buffer, p_run->script );
+#ifdef __OS2__
+    hb_buffer_add_utf16( p_buffer, p_text, i_text, 0, i_text );
+#else
+    hb_buffer_add_utf32( p_buffer, p_text, i_text, 0, i_text );
+#endif
+    hb_shape( p_hb_font, p_buffer, 0, 0 );
+
+    unsigned int i_count;
+    const hb_glyph_info_t *p_infos =
+        hb_buffer_get_glyph_infos( p_buffer, &i_count );
+    const hb_glyph_position_t *p_positions =
+        hb_buffer_get_glyph_positions( p_buffer, &i_count );
+
+    p_run->i_glyph_count = 0;
+    if( i_count > 0 )
+    {
+        p_run->p_glyphs = vlc_alloc( i_count, sizeof( *p_run->p_glyphs ) );
+        if( !p_run->p_glyphs )
+        {
+            i_ret = VLC_ENOMEM;
+            goto end;
+        }
+        for( unsigned int i = 0; i < i_count; ++i )
+        {
+            p_run->p_glyphs[ i ] = (glyph_cache_run_glyph_t) {
+                .i_glyph_index = p_infos[ i ].codepoint,
+                .i_cluster = p_infos[ i ].cluster,
+                .i_x_offset = p_positions[ i ].x_offset,
+                .i_y_offset = p_positions[ i ].y_offset,
+                .i_x_advance = p_positions[ i ].x_advance,
+                .i_y_advance = p_positions[ i ].y_advance,
+            };
+        }
+        p_run->i_glyph_count = i_count;
+    }
+    i_ret = VLC_SUCCESS;
+
+end:
+    if( p_buffer )
+        hb_buffer_destroy( p_buffer );
+    hb_font_destroy( p_hb_font );
+    return i_ret;
+}
+
 /**
  * Shape an itemized paragraph using HarfBuzz.
  * This is where the glyphs of complex scripts get their positions
@@ -785,41 +854,20 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
         else
             p_face = p_run->p_face;
 
-        p_run->p_hb_font = hb_ft_font_create( p_face, 0 );
-        if( !p_run->p_hb_font )
-        {
-            msg_Err( p_filter,
-                     "ShapeParagraphHarfBuzz(): hb_ft_font_create() error" );
-            goto error;
-        }
+        const uni_char_t *p_text = p_paragraph->p_code_points + p_run->i_start_offset;
+        const size_t i_text = p_run->i_end_offset - p_run->i_start_offset;
 
-        p_run->p_buffer = hb_buffer_create();
-        if( !p_run->p_buffer )
+        if( GlyphCache_GetRun( p_sys->p_glyph_cache, p_face,
+                               p_run->script, p_run->direction, p_text, i_text,
+                               &p_run->p_glyphs, &p_run->i_glyph_count ) )
         {
-            msg_Err( p_filter,
-                     "ShapeParagraphHarfBuzz(): hb_buffer_create() error" );
-            goto error;
+            if( ShapeRunHarfBuzz( p_filter, p_run, p_face, p_text, i_text ) )
+                goto error;
+            GlyphCache_PutRun( p_sys->p_glyph_cache, p_face,
+                               p_run->script, p_run->direction, p_text, i_text,
+                               p_run->p_glyphs, p_run->i_glyph_count );
         }
 
-        hb_buffer_set_direction( p_run->p_buffer, p_run->direction );
-        hb_buffer_set_script( p_run->p_buffer, p_run->script );
-#ifdef __OS2__
-        hb_buffer_add_utf16( p_run->p_buffer,
-                             p_paragraph->p_code_points + p_run->i_start_offset,
-                             p_run->i_end_offset - p_run->i_start_offset, 0,
-                             p_run->i_end_offset - p_run->i_start_offset );
-#else
-        hb_buffer_add_utf32( p_run->p_buffer,
-                             p_paragraph->p_code_points + p_run->i_start_offset,
-                             p_run->i_end_offset - p_run->i_start_offset, 0,
-                             p_run->i_end_offset - p_run->i_start_offset );
-#endif
-        hb_shape( p_run->p_hb_font, p_run->p_buffer, 0, 0 );
-        p_run->p_glyph_infos =
-            hb_buffer_get_glyph_infos( p_run->p_buffer, &p_run->i_glyph_count );
-        p_run->p_glyph_positions =
-            hb_buffer_get_glyph_positions( p_run->p_buffer, &p_run->i_glyph_count );
-
         if( p_run->i_glyph_count <= 0 )
         {
             msg_Err( p_filter,
@@ -850,8 +898,7 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
     for( int i = 0; i < p_paragraph->i_runs_count; ++i )
     {
         run_desc_t *p_run = p_paragraph->p_runs + i;
-        hb_glyph_info_t *p_infos = p_run->p_glyph_infos;
-        hb_glyph_position_t *p_positions = p_run->p_glyph_positions;
+        const glyph_cache_run_glyph_t *p_glyphs = p_run->p_glyphs;
         for( unsigned int j = 0; j < p_run->i_glyph_count; ++j )
         {
             /*
@@ -864,11 +911,11 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
             int i_run_index = p_run->direction == HB_DIRECTION_LTR ?
                     j : p_run->i_glyph_count - 1 - j;
             int i_source_index =
-                    p_infos[ i_run_index ].cluster + p_run->i_start_offset;
+                    p_glyphs[ i_run_index ].i_cluster + p_run->i_start_offset;
 
             p_new_paragraph->p_code_points[ i_index ] = 0;
             p_new_paragraph->pi_glyph_indices[ i_index ] =
-                p_infos[ i_run_index ].codepoint;
+                p_glyphs[ i_run_index ].i_glyph_index;
             p_new_paragraph->p_scripts[ i_index ] =
                 p_paragraph->p_scripts[ i_source_index ];
             p_new_paragraph->p_types[ i_index ] =
@@ -883,13 +930,13 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
             p_new_paragraph->pi_karaoke_bar[ i_index ] =
                 p_paragraph->pi_karaoke_bar[ i_source_index ];
             p_new_paragraph->p_glyph_bitmaps[ i_index ].i_x_offset =
-                p_positions[ i_run_index ].x_offset;
+                p_glyphs[ i_run_index ].i_x_offset;
             p_new_paragraph->p_glyph_bitmaps[ i_index ].i_y_offset =
-                p_positions[ i_run_index ].y_offset;
+                p_glyphs[ i_run_index ].i_y_offset;
             p_new_paragraph->p_glyph_bitmaps[ i_index ].i_x_advance =
-                p_positions[ i_run_index ].x_advance;
+                p_glyphs[ i_run_index ].i_x_advance;
             p_new_paragraph->p_glyph_bitmaps[ i_index ].i_y_advance =
-                p_positions[ i_run_index ].y_advance;
+                p_glyphs[ i_run_index ].i_y_advance;
 
             ++i_index;
         }
@@ -899,10 +946,7 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
     }
 
     for( int i = 0; i < p_paragraph->i_runs_count; ++i )
-    {
-        hb_font_destroy( p_paragraph->p_runs[ i ].p_hb_font );
-        hb_buffer_destroy( p_paragraph->p_runs[ i ].p_buffer );
-    }
+        free( p_paragraph->p_runs[ i ].p_glyphs );
     FreeParagraph( *p_old_paragraph );
     *p_old_paragraph = p_new_paragraph;
 
@@ -910,12 +954,7 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
 
 error:
     for( int i = 0; i < p_paragraph->i_runs_count; ++i )
-    {
-        if( p_paragraph->p_runs[ i ].p_hb_font )
-            hb_font_destroy( p_paragraph->p_runs[ i ].p_hb_font );
-        if( p_paragraph->p_runs[ i ].p_buffer )
-            hb_buffer_destroy( p_paragraph->p_runs[ i ].p_buffer );
-    }
+        free( p_paragraph->p_runs[ i ].p_glyphs );
 
     if( p_new_paragraph )
         FreeParagraph( p_new_paragraph );
@@ -1056,6 +1095,14 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
         else
             p_face = p_run->p_face;
 
+        glyph_cache_key_t cache_key = { .p_face = p_face };
+        if( ( p_style->i_style_flags & STYLE_BOLD )
+              && !( p_face->style_flags & FT_STYLE_FLAG_BOLD ) )
+            cache_key.i_flags |= GLYPH_CACHE_BOLD;
+        if( ( p_style->i_style_flags & STYLE_ITALIC )
+              && !( p_face->style_flags & FT_STYLE_FLAG_ITALIC ) )
+            cache_key.i_flags |= GLYPH_CACHE_ITALIC;
+
         if( p_sys->p_stroker && (p_style->i_style_flags & STYLE_OUTLINE) )
         {
             double f_outline_thickness =
@@ -1066,6 +1113,7 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
                             i_radius,
                             FT_STROKER_LINECAP_ROUND,
                             FT_STROKER_LINEJOIN_ROUND, 0 );
+            cache_key.i_outline_radius = i_radius;
         }
 
         for( int j = p_run->i_start_offset; j < p_run->i_end_offset; ++j )
@@ -1118,39 +1166,52 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
                     SKIP_GLYPH( p_bitmaps )
             }
 
-            if( FT_Load_Glyph( p_face, i_glyph_index,
-                               FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT )
-             && FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_DEFAULT ) )
-                SKIP_GLYPH( p_bitmaps )
+            cache_key.i_glyph_index = i_glyph_index;
+            p_bitmaps->cache_key = cache_key;
+
+            FT_Vector advance;
+            if( GlyphCache_GetOutlines( p_sys->p_glyph_cache, &cache_key,
+                                        &p_bitmaps->p_glyph, &p_bitmaps->p_outline,
+                                        &advance ) )
+            {
+                if( FT_Load_Glyph( p_face, i_glyph_index,
+                                   FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT )
+                 && FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_DEFAULT ) )
+                    SKIP_GLYPH( p_bitmaps )
 
-            if( ( p_style->i_style_flags & STYLE_BOLD )
-                  && !( p_face->style_flags & FT_STYLE_FLAG_BOLD ) )
-                FT_GlyphSlot_Embolden( p_face->glyph );
-            if( ( p_style->i_style_flags & STYLE_ITALIC )
-                  && !( p_face->style_flags & FT_STYLE_FLAG_ITALIC ) )
-                FT_GlyphSlot_Oblique( p_face->glyph );
+                if( cache_key.i_flags & GLYPH_CACHE_BOLD )
+                    FT_GlyphSlot_Embolden( p_face->glyph );
+                if( cache_key.i_flags & GLYPH_CACHE_ITALIC )
+                    FT_GlyphSlot_Oblique( p_face->glyph );
 
-            if( FT_Get_Glyph( p_face->glyph, &p_bitmaps->p_glyph ) )
-                SKIP_GLYPH( p_bitmaps )
+                if( FT_Get_Glyph( p_face->glyph, &p_bitmaps->p_glyph ) )
+                    SKIP_GLYPH( p_bitmaps )
 
-#undef SKIP_GLYPH
+                p_bitmaps->p_outline = 0;
+                if( p_sys->p_stroker && (p_style->i_style_flags & STYLE_OUTLINE) )
+                {
+                    p_bitmaps->p_outline = p_bitmaps->p_glyph;
+                    if( FT_Glyph_StrokeBorder( &p_bitmaps->p_outline,
+                                               p_sys->p_stroker, 0, 0 ) )
+                        p_bitmaps->p_outline = 0;
+                }
 
-            if( p_sys->p_stroker && (p_style->i_style_flags & STYLE_OUTLINE) )
-            {
-                p_bitmaps->p_outline = p_bitmaps->p_glyph;
-                if( FT_Glyph_StrokeBorder( &p_bitmaps->p_outline,
-                                           p_sys->p_stroker, 0, 0 ) )
-                    p_bitmaps->p_outline = 0;
+                advance = p_face->glyph->advance;
+                GlyphCache_PutOutlines( p_sys->p_glyph_cache, &cache_key,
+                                        p_bitmaps->p_glyph, p_bitmaps->p_outline,
+                                        &advance );
             }
 
+#undef SKIP_GLYPH
+
             if( p_style->i_shadow_alpha != STYLE_ALPHA_TRANSPARENT )
                 p_bitmaps->p_shadow = p_bitmaps->p_outline ?
                                       p_bitmaps->p_outline : p_bitmaps->p_glyph;
 
             if( b_overwrite_advance )
             {
-                p_bitmaps->i_x_advance = p_face->glyph->advance.x;
-                p_bitmaps->i_y_advance = p_face->glyph->advance.y;
+                p_bitmaps->i_x_advance = advance.x;
+                p_bitmaps->i_y_advance = advance.y;
             }
 
             unsigned i_x_advance = FT_FLOOR( abs( p_bitmaps->i_x_advance ) );
@@ -1255,10 +1316,16 @@ static int LayoutLine( filter_t *p_filter,
             .y = pen_new.y + p_sys->f_shadow_vector_y * ( i_font_size << 6 )
         };
 
+        /* The shadow is a copy of the outline or glyph bitmap, rendered
+         * first as these are replaced with their bitmaps */
+        glyph_cache_t *p_cache = p_sys->p_glyph_cache;
+        const glyph_cache_key_t *p_key = &p_bitmaps->cache_key;
         if( p_bitmaps->p_shadow )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_shadow, FT_RENDER_MODE_NORMAL,
-                                    &pen_shadow, 0 ) )
+            if( GlyphCache_Render( p_cache, p_key,
+                                   p_bitmaps->p_shadow == p_bitmaps->p_outline,
+                                   p_bitmaps->p_shadow, &pen_shadow,
+                                   &p_bitmaps->p_shadow ) )
                 p_bitmaps->p_shadow = 0;
             else
                 FT_Glyph_Get_CBox( p_bitmaps->p_shadow, ft_glyph_bbox_pixels,
@@ -1266,8 +1333,9 @@ static int LayoutLine( filter_t *p_filter,
         }
         if( p_bitmaps->p_glyph )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_glyph, FT_RENDER_MODE_NORMAL,
-                                    &pen_new, 1 ) )
+            FT_Glyph p_source = p_bitmaps->p_glyph;
+            if( GlyphCache_Render( p_cache, p_key, false, p_source, &pen_new,
+                                   &p_bitmaps->p_glyph ) )
             {
                 FT_Done_Glyph( p_bitmaps->p_glyph );
                 if( p_bitmaps->p_outline )
@@ -1277,20 +1345,22 @@ static int LayoutLine( filter_t *p_filter,
                 continue;
             }
             else
+            {
+                FT_Done_Glyph( p_source );
                 FT_Glyph_Get_CBox( p_bitmaps->p_glyph, ft_glyph_bbox_pixels,
                                    &p_bitmaps->glyph_bbox );
+            }
         }
         if( p_bitmaps->p_outline )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_outline, FT_RENDER_MODE_NORMAL,
-                                    &pen_new, 1 ) )
-            {
-                FT_Done_Glyph( p_bitmaps->p_outline );
+            FT_Glyph p_source = p_bitmaps->p_outline;
+            if( GlyphCache_Render( p_cache, p_key, true, p_source, &pen_new,
+                                   &p_bitmaps->p_outline ) )
                 p_bitmaps->p_outline = 0;
-            }
             else
                 FT_Glyph_Get_CBox( p_bitmaps->p_outline, ft_glyph_bbox_pixels,
                                    &p_bitmaps->outline_bbox );
+            FT_Done_Glyph( p_source );
         }
 
         FixGlyph( p_bitmaps->p_glyph, &p_bitmaps->glyph_bbox,
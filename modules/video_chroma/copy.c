@@ -35,6 +35,30 @@
 #include <assert.h>
 
 #include "copy.h"
+
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+# define COPY_AVX2 __attribute__ ((__target__ ("avx2")))
+#endif
+#ifdef __ARM_NEON
+# include <arm_neon.h>
+# define COPY_NEON
+#endif
+
+#ifdef COPY_TEST
+/* Kernels allowed by the test or the benchmark */
+enum
+{
+    COPY_KERNEL_SSE  = 0x1,
+    COPY_KERNEL_AVX2 = 0x2,
+    COPY_KERNEL_NEON = 0x4,
+};
+static unsigned copy_kernels = ~0u;
+# define COPY_KERNEL(k) ((copy_kernels & COPY_KERNEL_##k) != 0)
+#else
+# define COPY_KERNEL(k) (true)
+#endif
+
 static void CopyPlane(uint8_t *dst, size_t dst_pitch,
                       const uint8_t *src, size_t src_pitch,
                       unsigned height, int bitshift);
@@ -612,6 +636,358 @@ static void SSE_Copy420_P_to_SP(picture_t *dst, const uint8_t *src[static 3],
 #undef COPY64
 #endif /* CAN_COMPILE_SSE2 */
 
+/* Row kernels of the AVX2 and NEON copies. They read the source directly,
+ * without going through the cache buffer: full 64-byte lines are loaded at
+ * once, which is what write-combining memory needs. Widths are in bytes. */
+typedef struct
+{
+    void (*copy_plane)(uint8_t *dst, size_t dst_pitch,
+                       const uint8_t *src, size_t src_pitch,
+                       unsigned height, int bitshift);
+    void (*split_uv)(uint8_t *dstu, size_t dstu_pitch,
+                     uint8_t *dstv, size_t dstv_pitch,
+                     const uint8_t *src, size_t src_pitch,
+                     unsigned width, unsigned height,
+                     uint8_t pixel_size, int bitshift);
+    void (*interleave_uv)(uint8_t *dst, size_t dst_pitch,
+                          const uint8_t *srcu, size_t srcu_pitch,
+                          const uint8_t *srcv, size_t srcv_pitch,
+                          unsigned width, unsigned height,
+                          uint8_t pixel_size, int bitshift);
+} copy_simd_t;
+
+static inline uint16_t Shift16(uint16_t v, int bitshift)
+{
+    return bitshift >= 0 ? v >> bitshift : v << -bitshift;
+}
+
+/* Copies the samples from x on, that the vector loops left */
+static void SplitUVTail(uint8_t *dstu, uint8_t *dstv, const uint8_t *src,
+                        unsigned x, unsigned width, uint8_t pixel_size,
+                        int bitshift)
+{
+    if (pixel_size == 1)
+        for (; x < width; x++) {
+            dstu[x] = src[2*x+0];
+            dstv[x] = src[2*x+1];
+        }
+    else
+        for (; x + 1 < width; x += 2) {
+            *(uint16_t *)&dstu[x] = Shift16(*(const uint16_t *)&src[2*x+0], bitshift);
+            *(uint16_t *)&dstv[x] = Shift16(*(const uint16_t *)&src[2*x+2], bitshift);
+        }
+}
+
+static void InterleaveUVTail(uint8_t *dst, const uint8_t *srcu,
+                             const uint8_t *srcv, unsigned x, unsigned width,
+                             uint8_t pixel_size, int bitshift)
+{
+    if (pixel_size == 1)
+        for (; x < width; x++) {
+            dst[2*x+0] = srcu[x];
+            dst[2*x+1] = srcv[x];
+        }
+    else
+        for (; x + 1 < width; x += 2) {
+            *(uint16_t *)&dst[2*x+0] = Shift16(*(const uint16_t *)&srcu[x], bitshift);
+            *(uint16_t *)&dst[2*x+2] = Shift16(*(const uint16_t *)&srcv[x], bitshift);
+        }
+}
+
+#ifdef COPY_AVX2
+/* Streaming loads are only possible from aligned addresses */
+# define AVX2_LOAD(p, stream) ((stream) \
+    ? _mm256_stream_load_si256((const __m256i *)(p)) \
+    : _mm256_loadu_si256((const __m256i *)(p)))
+/* Shifting 16-bit samples by 0 leaves them (and 8-bit ones) untouched */
+# define AVX2_SHIFT(v) \
+    _mm256_sll_epi16(_mm256_srl_epi16(v, shiftr), shiftl)
+
+COPY_AVX2
+static void AVX2_CopyPlane(uint8_t *dst, size_t dst_pitch,
+                           const uint8_t *src, size_t src_pitch,
+                           unsigned height, int bitshift)
+{
+    const size_t copy_pitch = __MIN(src_pitch, dst_pitch);
+    const __m128i shiftr = _mm_cvtsi32_si128(__MAX(bitshift, 0));
+    const __m128i shiftl = _mm_cvtsi32_si128(__MAX(-bitshift, 0));
+
+    _mm_mfence();
+    for (unsigned y = 0; y < height; y++) {
+        const bool stream = ((uintptr_t)src & 31) == 0;
+        size_t x = 0;
+
+        for (; x + 63 < copy_pitch; x += 64) {
+            __m256i a = AVX2_LOAD(&src[x], stream);
+            __m256i b = AVX2_LOAD(&src[x + 32], stream);
+            _mm256_storeu_si256((__m256i *)&dst[x], AVX2_SHIFT(a));
+            _mm256_storeu_si256((__m256i *)&dst[x + 32], AVX2_SHIFT(b));
+        }
+        if (x < copy_pitch)
+            CopyPlane(&dst[x], dst_pitch - x, &src[x], src_pitch - x, 1,
+                      bitshift);
+        src += src_pitch;
+        dst += dst_pitch;
+    }
+    _mm_mfence();
+}
+
+COPY_AVX2
+static void AVX2_SplitUV(uint8_t *dstu, size_t dstu_pitch,
+                         uint8_t *dstv, size_t dstv_pitch,
+                         const uint8_t *src, size_t src_pitch,
+                         unsigned width, unsigned height,
+                         uint8_t pixel_size, int bitshift)
+{
+    const __m128i shiftr = _mm_cvtsi32_si128(__MAX(bitshift, 0));
+    const __m128i shiftl = _mm_cvtsi32_si128(__MAX(-bitshift, 0));
+    /* Gathers the U then the V samples of each 128-bit lane */
+    const __m256i shuffle = pixel_size == 1
+        ? _mm256_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15,
+                           0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15)
+        : _mm256_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15,
+                           0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15);
+
+    _mm_mfence();
+    for (unsigned y = 0; y < height; y++) {
+        const bool stream = ((uintptr_t)src & 31) == 0;
+        unsigned x = 0;
+
+        for (; x + 31 < width; x += 32) {
+            __m256i a = AVX2_SHIFT(AVX2_LOAD(&src[2*x], stream));
+            __m256i b = AVX2_SHIFT(AVX2_LOAD(&src[2*x + 32], stream));
+            /* U in the low lane, V in the high lane */
+            a = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(a, shuffle), 0xD8);
+            b = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(b, shuffle), 0xD8);
+            _mm256_storeu_si256((__m256i *)&dstu[x],
+                                _mm256_permute2x128_si256(a, b, 0x20));
+            _mm256_storeu_si256((__m256i *)&dstv[x],
+                                _mm256_permute2x128_si256(a, b, 0x31));
+        }
+        SplitUVTail(dstu, dstv, src, x, width, pixel_size, bitshift);
+        src  += src_pitch;
+        dstu += dstu_pitch;
+        dstv += dstv_pitch;
+    }
+    _mm_mfence();
+}
+
+COPY_AVX2
+static void AVX2_InterleaveUV(uint8_t *dst, size_t dst_pitch,
+                              const uint8_t *srcu, size_t srcu_pitch,
+                              const uint8_t *srcv, size_t srcv_pitch,
+                              unsigned width, unsigned height,
+                              uint8_t pixel_size, int bitshift)
+{
+    const __m128i shiftr = _mm_cvtsi32_si128(__MAX(bitshift, 0));
+    const __m128i shiftl = _mm_cvtsi32_si128(__MAX(-bitshift, 0));
+
+    for (unsigned y = 0; y < height; y++) {
+        unsigned x = 0;
+
+        for (; x + 31 < width; x += 32) {
+            __m256i u = AVX2_SHIFT(_mm256_loadu_si256((const __m256i *)&srcu[x]));
+            __m256i v = AVX2_SHIFT(_mm256_loadu_si256((const __m256i *)&srcv[x]));
+            __m256i lo, hi;
+            if (pixel_size == 1) {
+                lo = _mm256_unpacklo_epi8(u, v);
+                hi = _mm256_unpackhi_epi8(u, v);
+            } else {
+                lo = _mm256_unpacklo_epi16(u, v);
+                hi = _mm256_unpackhi_epi16(u, v);
+            }
+            /* The unpacks work within 128-bit lanes */
+            _mm256_storeu_si256((__m256i *)&dst[2*x],
+                                _mm256_permute2x128_si256(lo, hi, 0x20));
+            _mm256_storeu_si256((__m256i *)&dst[2*x + 32],
+                                _mm256_permute2x128_si256(lo, hi, 0x31));
+        }
+        InterleaveUVTail(dst, srcu, srcv, x, width, pixel_size, bitshift);
+        srcu += srcu_pitch;
+        srcv += srcv_pitch;
+        dst  += dst_pitch;
+    }
+}
+# undef AVX2_SHIFT
+# undef AVX2_LOAD
+
+static const copy_simd_t avx2_simd = {
+    AVX2_CopyPlane, AVX2_SplitUV, AVX2_InterleaveUV,
+};
+#endif
+
+#ifdef COPY_NEON
+/* Left shifts by negative counts are right shifts */
+# define NEON_SHIFT(v) \
+    vreinterpretq_u8_u16(vshlq_u16(vreinterpretq_u16_u8(v), shift))
+
+static void NEON_CopyPlane(uint8_t *dst, size_t dst_pitch,
+                           const uint8_t *src, size_t src_pitch,
+                           unsigned height, int bitshift)
+{
+    const size_t copy_pitch = __MIN(src_pitch, dst_pitch);
+    const int16x8_t shift = vdupq_n_s16(-bitshift);
+
+    for (unsigned y = 0; y < height; y++) {
+        size_t x = 0;
+
+        for (; x + 63 < copy_pitch; x += 64) {
+            const uint8x16_t a = vld1q_u8(&src[x]);
+            const uint8x16_t b = vld1q_u8(&src[x + 16]);
+            const uint8x16_t c = vld1q_u8(&src[x + 32]);
+            const uint8x16_t d = vld1q_u8(&src[x + 48]);
+            vst1q_u8(&dst[x], NEON_SHIFT(a));
+            vst1q_u8(&dst[x + 16], NEON_SHIFT(b));
+            vst1q_u8(&dst[x + 32], NEON_SHIFT(c));
+            vst1q_u8(&dst[x + 48], NEON_SHIFT(d));
+        }
+        if (x < copy_pitch)
+            CopyPlane(&dst[x], dst_pitch - x, &src[x], src_pitch - x, 1,
+                      bitshift);
+        src += src_pitch;
+        dst += dst_pitch;
+    }
+}
+
+static void NEON_SplitUV(uint8_t *dstu, size_t dstu_pitch,
+                         uint8_t *dstv, size_t dstv_pitch,
+                         const uint8_t *src, size_t src_pitch,
+                         unsigned width, unsigned height,
+                         uint8_t pixel_size, int bitshift)
+{
+    const int16x8_t shift = vdupq_n_s16(-bitshift);
+
+    for (unsigned y = 0; y < height; y++) {
+        unsigned x = 0;
+
+        if (pixel_size == 1)
+            for (; x + 15 < width; x += 16) {
+                const uint8x16x2_t v = vld2q_u8(&src[2*x]);
+                vst1q_u8(&dstu[x], v.val[0]);
+                vst1q_u8(&dstv[x], v.val[1]);
+            }
+        else
+            for (; x + 15 < width; x += 16) {
+                const uint16x8x2_t v = vld2q_u16((const uint16_t *)&src[2*x]);
+                vst1q_u16((uint16_t *)&dstu[x], vshlq_u16(v.val[0], shift));
+                vst1q_u16((uint16_t *)&dstv[x], vshlq_u16(v.val[1], shift));
+            }
+        SplitUVTail(dstu, dstv, src, x, width, pixel_size, bitshift);
+        src  += src_pitch;
+        dstu += dstu_pitch;
+        dstv += dstv_pitch;
+    }
+}
+
+static void NEON_InterleaveUV(uint8_t *dst, size_t dst_pitch,
+                              const uint8_t *srcu, size_t srcu_pitch,
+                              const uint8_t *srcv, size_t srcv_pitch,
+                              unsigned width, unsigned height,
+                              uint8_t pixel_size, int bitshift)
+{
+    const int16x8_t shift = vdupq_n_s16(-bitshift);
+
+    for (unsigned y = 0; y < height; y++) {
+        unsigned x = 0;
+
+        if (pixel_size == 1)
+            for (; x + 15 < width; x += 16) {
+                const uint8x16x2_t v = { { vld1q_u8(&srcu[x]),
+                                           vld1q_u8(&srcv[x]) } };
+                vst2q_u8(&dst[2*x], v);
+            }
+        else
+            for (; x + 15 < width; x += 16) {
+                const uint16x8x2_t v = { {
+                    vshlq_u16(vld1q_u16((const uint16_t *)&srcu[x]), shift),
+                    vshlq_u16(vld1q_u16((const uint16_t *)&srcv[x]), shift) } };
+                vst2q_u16((uint16_t *)&dst[2*x], v);
+            }
+        InterleaveUVTail(dst, srcu, srcv, x, width, pixel_size, bitshift);
+        srcu += srcu_pitch;
+        srcv += srcv_pitch;
+        dst  += dst_pitch;
+    }
+}
+# undef NEON_SHIFT
+
+static const copy_simd_t neon_simd = {
+    NEON_CopyPlane, NEON_SplitUV, NEON_InterleaveUV,
+};
+#endif
+
+static const copy_simd_t *GetSimd(void)
+{
+#ifdef COPY_AVX2
+    if (COPY_KERNEL(AVX2) && vlc_CPU_AVX2())
+        return &avx2_simd;
+#endif
+#ifdef COPY_NEON
+    if (COPY_KERNEL(NEON) && vlc_CPU_ARM_NEON())
+        return &neon_simd;
+#endif
+    return NULL;
+}
+
+static void Simd_Copy420_P_to_P(const copy_simd_t *simd, picture_t *dst,
+                                const uint8_t *src[static 3],
+                                const size_t src_pitch[static 3],
+                                unsigned height)
+{
+    for (unsigned n = 0; n < 3; n++) {
+        const unsigned d = n > 0 ? 2 : 1;
+        simd->copy_plane(dst->p[n].p_pixels, dst->p[n].i_pitch,
+                         src[n], src_pitch[n], (height+d-1)/d, 0);
+    }
+}
+
+static void Simd_Copy420_SP_to_SP(const copy_simd_t *simd, picture_t *dst,
+                                  const uint8_t *src[static 2],
+                                  const size_t src_pitch[static 2],
+                                  unsigned height)
+{
+    simd->copy_plane(dst->p[0].p_pixels, dst->p[0].i_pitch,
+                     src[0], src_pitch[0], height, 0);
+    simd->copy_plane(dst->p[1].p_pixels, dst->p[1].i_pitch,
+                     src[1], src_pitch[1], (height+1) / 2, 0);
+}
+
+static void Simd_Copy420_SP_to_P(const copy_simd_t *simd, picture_t *dst,
+                                 const uint8_t *src[static 2],
+                                 const size_t src_pitch[static 2],
+                                 unsigned height, uint8_t pixel_size,
+                                 int bitshift)
+{
+    const size_t copy_pitch = __MIN(__MIN(src_pitch[1] / 2,
+                                          (size_t)dst->p[1].i_pitch),
+                                    (size_t)dst->p[2].i_pitch);
+
+    simd->copy_plane(dst->p[0].p_pixels, dst->p[0].i_pitch,
+                     src[0], src_pitch[0], height, bitshift);
+    simd->split_uv(dst->p[1].p_pixels, dst->p[1].i_pitch,
+                   dst->p[2].p_pixels, dst->p[2].i_pitch,
+                   src[1], src_pitch[1], copy_pitch, (height+1) / 2,
+                   pixel_size, bitshift);
+}
+
+static void Simd_Copy420_P_to_SP(const copy_simd_t *simd, picture_t *dst,
+                                 const uint8_t *src[static 3],
+                                 const size_t src_pitch[static 3],
+                                 unsigned height, uint8_t pixel_size,
+                                 int bitshift)
+{
+    const size_t copy_pitch = __MIN(__MIN(src_pitch[U_PLANE],
+                                          src_pitch[V_PLANE]),
+                                    (size_t)dst->p[1].i_pitch / 2);
+
+    simd->copy_plane(dst->p[0].p_pixels, dst->p[0].i_pitch,
+                     src[0], src_pitch[0], height, bitshift);
+    simd->interleave_uv(dst->p[1].p_pixels, dst->p[1].i_pitch,
+                        src[U_PLANE], src_pitch[U_PLANE],
+                        src[V_PLANE], src_pitch[V_PLANE],
+                        copy_pitch, (height+1) / 2, pixel_size, bitshift);
+}
+
 static void CopyPlane(uint8_t *dst, size_t dst_pitch,
                       const uint8_t *src, size_t src_pitch,
                       unsigned height, int bitshift)
@@ -651,8 +1027,12 @@ void CopyPacked(picture_t *dst, const uint8_t *src, const size_t src_pitch,
     assert(src); assert(src_pitch);
     assert(height);
 
+    const copy_simd_t *simd = GetSimd();
+    if (simd)
+        return simd->copy_plane(dst->p[0].p_pixels, dst->p[0].i_pitch,
+                                src, src_pitch, height, 0);
 #ifdef CAN_COMPILE_SSE2
-    if (vlc_CPU_SSE4_1())
+    if (COPY_KERNEL(SSE) && vlc_CPU_SSE4_1())
         return SSE_CopyPlane(dst->p[0].p_pixels, dst->p[0].i_pitch, src, src_pitch,
                              cache->buffer, cache->size, height, 0);
 #else
@@ -667,8 +1047,11 @@ void Copy420_SP_to_SP(picture_t *dst, const uint8_t *src[static 2],
                       const copy_cache_t *cache)
 {
     ASSERT_2PLANES;
+    const copy_simd_t *simd = GetSimd();
+    if (simd)
+        return Simd_Copy420_SP_to_SP(simd, dst, src, src_pitch, height);
 #ifdef CAN_COMPILE_SSE2
-    if (vlc_CPU_SSE2())
+    if (COPY_KERNEL(SSE) && vlc_CPU_SSE2())
         return SSE_Copy420_SP_to_SP(dst, src, src_pitch, height, cache);
 #else
     (void) cache;
@@ -744,8 +1127,11 @@ void Copy420_SP_to_P(picture_t *dst, const uint8_t *src[static 2],
                      const copy_cache_t *cache)
 {
     ASSERT_2PLANES;
+    const copy_simd_t *simd = GetSimd();
+    if (simd)
+        return Simd_Copy420_SP_to_P(simd, dst, src, src_pitch, height, 1, 0);
 #ifdef CAN_COMPILE_SSE2
-    if (vlc_CPU_SSE2())
+    if (COPY_KERNEL(SSE) && vlc_CPU_SSE2())
         return SSE_Copy420_SP_to_P(dst, src, src_pitch, height, 1, 0, cache);
 #else
     VLC_UNUSED(cache);
@@ -765,8 +1151,12 @@ void Copy420_16_SP_to_P(picture_t *dst, const uint8_t *src[static 2],
     ASSERT_2PLANES;
     assert(bitshift >= -6 && bitshift <= 6 && (bitshift % 2 == 0));
 
+    const copy_simd_t *simd = GetSimd();
+    if (simd)
+        return Simd_Copy420_SP_to_P(simd, dst, src, src_pitch, height, 2,
+                                    bitshift);
 #ifdef CAN_COMPILE_SSE3
-    if (vlc_CPU_SSSE3())
+    if (COPY_KERNEL(SSE) && vlc_CPU_SSSE3())
         return SSE_Copy420_SP_to_P(dst, src, src_pitch, height, 2, bitshift, cache);
 #else
     VLC_UNUSED(cache);
@@ -820,8 +1210,11 @@ void Copy420_P_to_SP(picture_t *dst, const uint8_t *src[static 3],
                      const copy_cache_t *cache)
 {
     ASSERT_3PLANES;
+    const copy_simd_t *simd = GetSimd();
+    if (simd)
+        return Simd_Copy420_P_to_SP(simd, dst, src, src_pitch, height, 1, 0);
 #ifdef CAN_COMPILE_SSE2
-    if (vlc_CPU_SSE2())
+    if (COPY_KERNEL(SSE) && vlc_CPU_SSE2())
         return SSE_Copy420_P_to_SP(dst, src, src_pitch, height, 1, 0, cache);
 #else
     (void) cache;
@@ -851,8 +1244,12 @@ void Copy420_16_P_to_SP(picture_t *dst, const uint8_t *src[static 3],
 {
     ASSERT_3PLANES;
     assert(bitshift >= -6 && bitshift <= 6 && (bitshift % 2 == 0));
+    const copy_simd_t *simd = GetSimd();
+    if (simd)
+        return Simd_Copy420_P_to_SP(simd, dst, src, src_pitch, height, 2,
+                                    bitshift);
 #ifdef CAN_COMPILE_SSE2
-    if (vlc_CPU_SSSE3())
+    if (COPY_KERNEL(SSE) && vlc_CPU_SSSE3())
         return SSE_Copy420_P_to_SP(dst, src, src_pitch, height, 2, bitshift, cache);
 #else
     (void) cache;
@@ -885,8 +1282,11 @@ void Copy420_P_to_P(picture_t *dst, const uint8_t *src[static 3],
                     const copy_cache_t *cache)
 {
     ASSERT_3PLANES;
+    const copy_simd_t *simd = GetSimd();
+    if (simd)
+        return Simd_Copy420_P_to_P(simd, dst, src, src_pitch, height);
 #ifdef CAN_COMPILE_SSE2
-    if (vlc_CPU_SSE2())
+    if (COPY_KERNEL(SSE) && vlc_CPU_SSE2())
         return SSE_Copy420_P_to_P(dst, src, src_pitch, height, cache);
 #else
     (void) cache;
@@ -1105,68 +1505,116 @@ static picture_t *pic_new_unaligned(const video_format_t *fmt)
     return picture_NewFromResource(fmt, &rsc);
 }
 
-int main(void)
+struct test_kernel
 {
-    alarm(10);
+    const char *name;
+    unsigned mask;
+};
 
+static const struct test_kernel kernels[] = {
 #ifndef COPY_TEST_NOOPTIM
-    if (!vlc_CPU_SSE2())
+# ifdef COPY_AVX2
+    { "avx2", COPY_KERNEL_AVX2 },
+# endif
+# ifdef COPY_NEON
+    { "neon", COPY_KERNEL_NEON },
+# endif
+# ifdef CAN_COMPILE_SSE2
+    { "sse", COPY_KERNEL_SSE },
+# endif
+#endif
+    { "c", 0 },
+};
+#define NB_KERNELS ARRAY_SIZE(kernels)
+
+static bool kernel_available(const struct test_kernel *kernel)
+{
+    switch (kernel->mask)
     {
-        fprintf(stderr, "WARNING: could not test SSE\n");
-        return 77;
+#ifdef COPY_AVX2
+        case COPY_KERNEL_AVX2:
+            return vlc_CPU_AVX2();
+#endif
+#ifdef COPY_NEON
+        case COPY_KERNEL_NEON:
+            return vlc_CPU_ARM_NEON();
+#endif
+#ifdef CAN_COMPILE_SSE2
+        case COPY_KERNEL_SSE:
+            return vlc_CPU_SSE2();
+#endif
+        default:
+            return true;
     }
+}
+
+#ifdef COPY_BENCH
+static const struct test_size bench_sizes[] = {
+    { 1280, 720, 1280, 720 },
+    { 1920, 1088, 1920, 1080 },
+    { 3840, 2160, 3840, 2160 },
+};
+#define NB_BENCH_SIZES ARRAY_SIZE(bench_sizes)
+#define BENCH_LOOPS 200
 #endif
 
-    for (size_t i = 0; i < NB_CONVS; ++i)
+/* Runs a conversion for every size, checking (or timing) the result */
+static void run_conv(const struct test_conv *conv,
+                     const struct test_kernel *kernel,
+                     const struct test_size *test_sizes, size_t nb_sizes,
+                     unsigned loops)
+{
+    for (size_t j = 0; j < nb_sizes; ++j)
     {
-        const struct test_conv *conv = &convs[i];
-
-        for (size_t j = 0; j < NB_SIZES; ++j)
+        const struct test_size *size = &test_sizes[j];
+
+        const vlc_chroma_description_t *src_dsc =
+            vlc_fourcc_GetChromaDescription(conv->src_chroma);
+        assert(src_dsc);
+
+        video_format_t fmt;
+        video_format_Init(&fmt, 0);
+        video_format_Setup(&fmt, conv->src_chroma,
+                           size->i_width, size->i_height,
+                           size->i_visible_width, size->i_visible_height,
+                           1, 1);
+        picture_t *src = pic_new_unaligned(&fmt);
+        assert(src);
+        piccheck(src, src_dsc, true);
+
+        copy_cache_t cache;
+        int ret = CopyInitCache(&cache, src->format.i_width
+                                * src_dsc->pixel_size);
+        assert(ret == VLC_SUCCESS);
+
+        for (size_t f = 0; conv->dsts[f].chroma != 0; ++f)
         {
-            const struct test_size *size = &sizes[j];
-
-            const vlc_chroma_description_t *src_dsc =
-                vlc_fourcc_GetChromaDescription(conv->src_chroma);
-            assert(src_dsc);
-
-            video_format_t fmt;
-            video_format_Init(&fmt, 0);
-            video_format_Setup(&fmt, conv->src_chroma,
-                               size->i_width, size->i_height,
-                               size->i_visible_width, size->i_visible_height,
-                               1, 1);
-            picture_t *src = pic_new_unaligned(&fmt);
-            assert(src);
-            piccheck(src, src_dsc, true);
-
-            copy_cache_t cache;
-            int ret = CopyInitCache(&cache, src->format.i_width
-                                    * src_dsc->pixel_size);
-            assert(ret == VLC_SUCCESS);
-
-            for (size_t f = 0; conv->dsts[f].chroma != 0; ++f)
-            {
-                const struct test_dst *test_dst= &conv->dsts[f];
-
-                const vlc_chroma_description_t *dst_dsc =
-                    vlc_fourcc_GetChromaDescription(test_dst->chroma);
-                assert(dst_dsc);
-                fmt.i_chroma = test_dst->chroma;
-                picture_t *dst = picture_NewFromFormat(&fmt);
-                assert(dst);
-
-                const uint8_t * src_planes[3] = { src->p[Y_PLANE].p_pixels,
-                                                  src->p[U_PLANE].p_pixels,
-                                                  src->p[V_PLANE].p_pixels };
-                const size_t    src_pitches[3] = { src->p[Y_PLANE].i_pitch,
-                                                   src->p[U_PLANE].i_pitch,
-                                                   src->p[V_PLANE].i_pitch };
-
-                fprintf(stderr, "testing: %u x %u (vis: %u x %u) %4.4s -> %4.4s\n",
+            const struct test_dst *test_dst= &conv->dsts[f];
+
+            const vlc_chroma_description_t *dst_dsc =
+                vlc_fourcc_GetChromaDescription(test_dst->chroma);
+            assert(dst_dsc);
+            fmt.i_chroma = test_dst->chroma;
+            picture_t *dst = picture_NewFromFormat(&fmt);
+            assert(dst);
+
+            const uint8_t * src_planes[3] = { src->p[Y_PLANE].p_pixels,
+                                              src->p[U_PLANE].p_pixels,
+                                              src->p[V_PLANE].p_pixels };
+            const size_t    src_pitches[3] = { src->p[Y_PLANE].i_pitch,
+                                               src->p[U_PLANE].i_pitch,
+                                               src->p[V_PLANE].i_pitch };
+
+            if (loops == 0)
+                fprintf(stderr, "testing: %u x %u (vis: %u x %u) %4.4s -> %4.4s (%s)\n",
                         size->i_width, size->i_height,
                         size->i_visible_width, size->i_visible_height,
                         (const char *) &src->format.i_chroma,
-                        (const char *) &dst->format.i_chroma);
+                        (const char *) &dst->format.i_chroma, kernel->name);
+
+            vlc_tick_t time = vlc_tick_now();
+            for (unsigned i = 0; i < __MAX(loops, 1); i++)
+            {
                 if (test_dst->bitshift == 0)
                     test_dst->conv(dst, src_planes, src_pitches,
                                    src->format.i_visible_height, &cache);
@@ -1174,12 +1622,61 @@ int main(void)
                     test_dst->conv16(dst, src_planes, src_pitches,
                                    src->format.i_visible_height, test_dst->bitshift,
                                    &cache);
-                piccheck(dst, dst_dsc, false);
-                picture_Release(dst);
             }
-            picture_Release(src);
-            CopyCleanCache(&cache);
+            time = vlc_tick_now() - time;
+            piccheck(dst, dst_dsc, false);
+
+            if (loops > 0)
+            {
+                /* Bytes read from the source, as for a surface readback */
+                uint64_t bytes = 0;
+                for (int i = 0; i < src->i_planes; i++)
+                    bytes += (uint64_t)src->p[i].i_pitch * src->p[i].i_lines;
+                printf("%4.4s -> %4.4s %ux%u %-4s: %6.2f GB/s\n",
+                       (const char *) &src->format.i_chroma,
+                       (const char *) &dst->format.i_chroma,
+                       size->i_visible_width, size->i_visible_height,
+                       kernel->name,
+                       (double) bytes * loops / 1e9 / secf_from_vlc_tick(__MAX(time, 1)));
+            }
+            picture_Release(dst);
         }
+        picture_Release(src);
+        CopyCleanCache(&cache);
+    }
+}
+
+int main(void)
+{
+#ifndef COPY_BENCH
+    alarm(30);
+#endif
+
+#if !defined(COPY_TEST_NOOPTIM) && !defined(COPY_BENCH)
+    if (!vlc_CPU_SSE2())
+    {
+        fprintf(stderr, "WARNING: could not test SSE\n");
+        return 77;
+    }
+#endif
+
+    for (size_t k = 0; k < NB_KERNELS; ++k)
+    {
+        const struct test_kernel *kernel = &kernels[k];
+        if (!kernel_available(kernel))
+        {
+            fprintf(stderr, "WARNING: could not test %s\n", kernel->name);
+            continue;
+        }
+        copy_kernels = kernel->mask;
+
+        for (size_t i = 0; i < NB_CONVS; ++i)
+#ifdef COPY_BENCH
+            run_conv(&convs[i], kernel, bench_sizes, NB_BENCH_SIZES,
+                     BENCH_LOOPS);
+#else
+            run_conv(&convs[i], kernel, sizes, NB_SIZES, 0);
+#endif
     }
     return 0;
 }
@@ -28,6 +28,7 @@
 # include "config.h"
 #endif
 #include <assert.h>
+#include <stdatomic.h>
 
 #include <vlc_common.h>
 #include <vlc_plugin.h>
@@ -81,6 +82,31 @@ vlc_module_end ()
  * Local prototypes
  ****************************************************************************/
 
+/**
+ * Parameters of a conversion context.
+ */
+typedef struct
+{
+    int i_src_width, i_src_height, i_src_fmt;
+    int i_dst_width, i_dst_height, i_dst_fmt;
+    int i_flags;
+} sws_key_t;
+
+/* Maximum number of bands converted in parallel */
+#define SLICES_MAX (16)
+
+/**
+ * Conversion context of a band of the pictures.
+ */
+typedef struct
+{
+    sws_key_t key;
+    struct SwsContext *ctx;
+} sws_slice_t;
+
+/* Period of the conversion time reports */
+#define STATS_PERIOD VLC_TICK_FROM_SEC(5)
+
 /**
  * Internal swscale filter structure.
  */
@@ -94,8 +120,24 @@ typedef struct
     const vlc_chroma_description_t *desc_in;
     const vlc_chroma_description_t *desc_out;
 
+    sws_key_t key;
+    sws_key_t keyA;
     struct SwsContext *ctx;
     struct SwsContext *ctxA;
+
+    /* Slice threading, only without vertical scaling */
+    bool b_slices;
+    unsigned i_slice_align;
+    sws_slice_t slices[SLICES_MAX];
+
+    struct
+    {
+        vlc_tick_t start;
+        vlc_tick_t total;
+        vlc_tick_t max;
+        unsigned count;
+    } stats;
+
     picture_t *p_src_a;
     picture_t *p_dst_a;
     int i_extend_factor;
@@ -130,6 +172,9 @@ static int GetParameters( ScalerConfiguration *,
 
 static int GetSwsCpuMask(void);
 
+static struct SwsContext *GetContext( const sws_key_t * );
+static void PutContext( const sws_key_t *, struct SwsContext * );
+
 /* SwScaler point resize quality seems really bad, let our scale module do it
  * (change it to true to try) */
 #define ALLOW_YUVP (false)
@@ -220,6 +265,117 @@ static void CloseScaler( vlc_object_t *p_this )
     free( p_sys );
 }
 
+/*****************************************************************************
+ * Context cache
+ *****************************************************************************
+ * Creating a conversion context computes the scaling coefficients and can
+ * take several milliseconds. Contexts released by a filter are kept for the
+ * next filter (or the next format) with the same parameters, so that filter
+ * chain resets do not rebuild them. No custom SwsFilter is ever set, so a
+ * context only depends on its key.
+ *****************************************************************************/
+#define CACHE_MAX (16)
+
+typedef struct sws_cached
+{
+    struct sws_cached *p_next;
+    sws_key_t key;
+    struct SwsContext *ctx;
+} sws_cached_t;
+
+static struct
+{
+    vlc_mutex_t lock;
+    sws_cached_t *p_first; /* most recently released first */
+    unsigned i_count;
+} cache = { VLC_STATIC_MUTEX, NULL, 0 };
+
+static bool KeyEqual( const sws_key_t *a, const sws_key_t *b )
+{
+    return a->i_src_width == b->i_src_width &&
+           a->i_src_height == b->i_src_height &&
+           a->i_src_fmt == b->i_src_fmt &&
+           a->i_dst_width == b->i_dst_width &&
+           a->i_dst_height == b->i_dst_height &&
+           a->i_dst_fmt == b->i_dst_fmt &&
+           a->i_flags == b->i_flags;
+}
+
+static struct SwsContext *GetContext( const sws_key_t *p_key )
+{
+    vlc_mutex_lock( &cache.lock );
+    for( sws_cached_t **pp = &cache.p_first; *pp != NULL; pp = &(*pp)->p_next )
+    {
+        sws_cached_t *p_cached = *pp;
+        if( KeyEqual( &p_cached->key, p_key ) )
+        {
+            struct SwsContext *ctx = p_cached->ctx;
+
+            *pp = p_cached->p_next;
+            cache.i_count--;
+            vlc_mutex_unlock( &cache.lock );
+            free( p_cached );
+            return ctx;
+        }
+    }
+    vlc_mutex_unlock( &cache.lock );
+
+    return sws_getContext( p_key->i_src_width, p_key->i_src_height,
+                           p_key->i_src_fmt,
+                           p_key->i_dst_width, p_key->i_dst_height,
+                           p_key->i_dst_fmt,
+                           p_key->i_flags, NULL, NULL, 0 );
+}
+
+static void PutContext( const sws_key_t *p_key, struct SwsContext *ctx )
+{
+    sws_cached_t *p_cached = malloc( sizeof(*p_cached) );
+    if( unlikely(p_cached == NULL) )
+    {
+        sws_freeContext( ctx );
+        return;
+    }
+    p_cached->key = *p_key;
+    p_cached->ctx = ctx;
+
+    vlc_mutex_lock( &cache.lock );
+    p_cached->p_next = cache.p_first;
+    cache.p_first = p_cached;
+
+    /* Evict the least recently released context */
+    sws_cached_t *p_evicted = NULL;
+    if( ++cache.i_count > CACHE_MAX )
+    {
+        sws_cached_t **pp = &cache.p_first;
+        while( (*pp)->p_next != NULL )
+            pp = &(*pp)->p_next;
+        p_evicted = *pp;
+        *pp = NULL;
+        cache.i_count--;
+    }
+    vlc_mutex_unlock( &cache.lock );
+
+    if( p_evicted )
+    {
+        sws_freeContext( p_evicted->ctx );
+        free( p_evicted );
+    }
+}
+
+/* Only the released contexts are left once all the filters are closed */
+__attribute__((destructor))
+static void CacheUnload( void )
+{
+    while( cache.p_first )
+    {
+        sws_cached_t *p_cached = cache.p_first;
+        cache.p_first = p_cached->p_next;
+        sws_freeContext( p_cached->ctx );
+        free( p_cached );
+    }
+    cache.i_count = 0;
+}
+
 /*****************************************************************************
  * Helpers
  *****************************************************************************/
@@ -399,14 +555,17 @@ static int Init( filter_t *p_filter )
     const unsigned i_fmto_visible_width = p_fmto->i_visible_width * p_sys->i_extend_factor;
     for( int n = 0; n < (cfg.b_has_a ? 2 : 1); n++ )
     {
-        const int i_fmti = n == 0 ? cfg.i_fmti : AV_PIX_FMT_GRAY8;
-        const int i_fmto = n == 0 ? cfg.i_fmto : AV_PIX_FMT_GRAY8;
-        struct SwsContext *ctx;
+        sws_key_t *p_key = n == 0 ? &p_sys->key : &p_sys->keyA;
+
+        p_key->i_src_width  = i_fmti_visible_width;
+        p_key->i_src_height = p_fmti->i_visible_height;
+        p_key->i_src_fmt    = n == 0 ? cfg.i_fmti : AV_PIX_FMT_GRAY8;
+        p_key->i_dst_width  = i_fmto_visible_width;
+        p_key->i_dst_height = p_fmto->i_visible_height;
+        p_key->i_dst_fmt    = n == 0 ? cfg.i_fmto : AV_PIX_FMT_GRAY8;
+        p_key->i_flags      = cfg.i_sws_flags | p_sys->i_cpu_mask;
 
-        ctx = sws_getContext( i_fmti_visible_width, p_fmti->i_visible_height, i_fmti,
-                              i_fmto_visible_width, p_fmto->i_visible_height, i_fmto,
-                              cfg.i_sws_flags | p_sys->i_cpu_mask,
-                              p_sys->p_filter, NULL, 0 );
+        struct SwsContext *ctx = GetContext( p_key );
         if( n == 0 )
             p_sys->ctx = ctx;
         else
@@ -464,6 +623,22 @@ static int Init( filter_t *p_filter )
     p_sys->b_swap_uvi = cfg.b_swap_uvi;
     p_sys->b_swap_uvo = cfg.b_swap_uvo;
 
+    /* Without vertical scaling, the bands of the pictures can be converted
+     * independently. The bands start on chroma lines of both formats.
+     * With vertical scaling, the taps of the scaler read the rows around
+     * the source rows of a band, and the output rows of a band do not start
+     * on source rows: the bands would not give the same picture. */
+    p_sys->b_slices = !cfg.b_copy && p_sys->i_extend_factor == 1 &&
+                      p_fmti->i_visible_height == p_fmto->i_visible_height &&
+                      p_fmti->i_chroma != VLC_CODEC_RGBP;
+    p_sys->i_slice_align = 1;
+    for( unsigned i = 0; i < p_sys->desc_in->plane_count; i++ )
+        p_sys->i_slice_align = __MAX( p_sys->i_slice_align,
+                                      p_sys->desc_in->p[i].h.den );
+    for( unsigned i = 0; i < p_sys->desc_out->plane_count; i++ )
+        p_sys->i_slice_align = __MAX( p_sys->i_slice_align,
+                                      p_sys->desc_out->p[i].h.den );
+
     return VLC_SUCCESS;
 }
 
@@ -482,10 +657,17 @@ static void Clean( filter_t *p_filter )
         picture_Release( p_sys->p_dst_a );
 
     if( p_sys->ctxA )
-        sws_freeContext( p_sys->ctxA );
+        PutContext( &p_sys->keyA, p_sys->ctxA );
 
     if( p_sys->ctx )
-        sws_freeContext( p_sys->ctx );
+        PutContext( &p_sys->key, p_sys->ctx );
+
+    for( unsigned i = 0; i < SLICES_MAX; i++ )
+    {
+        if( p_sys->slices[i].ctx )
+            PutContext( &p_sys->slices[i].key, p_sys->slices[i].ctx );
+        p_sys->slices[i].ctx = NULL;
+    }
 
     /* We have to set it to null has we call be called again :( */
     p_sys->ctx = NULL;
@@ -500,7 +682,7 @@ static void GetPixels( uint8_t *pp_pixel[4], int pi_pitch[4],
                        const vlc_chroma_description_t *desc,
                        const video_format_t *fmt,
                        const picture_t *p_picture, unsigned planes,
-                       bool b_swap_uv )
+                       bool b_swap_uv, unsigned i_y )
 {
     unsigned i = 0;
 
@@ -517,7 +699,7 @@ static void GetPixels( uint8_t *pp_pixel[4], int pi_pitch[4],
         pp_pixel[i] = p->p_pixels
             + (((fmt->i_x_offset * desc->p[i].w.num) / desc->p[i].w.den)
                 * p->i_pixel_pitch)
-            + (((fmt->i_y_offset * desc->p[i].h.num) / desc->p[i].h.den)
+            + ((((fmt->i_y_offset + i_y) * desc->p[i].h.num) / desc->p[i].h.den)
                 * p->i_pitch);
         pi_pitch[i] = p->i_pitch;
     }
@@ -584,8 +766,9 @@ static void SwapUV( picture_t *p_dst, const picture_t *p_src )
 }
 
 static void Convert( filter_t *p_filter, struct SwsContext *ctx,
-                     picture_t *p_dst, picture_t *p_src, int i_height,
-                     int i_plane_count, bool b_swap_uvi, bool b_swap_uvo )
+                     picture_t *p_dst, picture_t *p_src, unsigned i_y,
+                     int i_height, int i_plane_count,
+                     bool b_swap_uvi, bool b_swap_uvo )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
     uint8_t palette[AVPALETTE_SIZE];
@@ -594,7 +777,7 @@ static void Convert( filter_t *p_filter, struct SwsContext *ctx,
     int src_stride[4], dst_stride[4];
 
     GetPixels( src, src_stride, p_sys->desc_in, &p_filter->fmt_in.video,
-               p_src, i_plane_count, b_swap_uvi );
+               p_src, i_plane_count, b_swap_uvi, i_y );
     if( p_filter->fmt_in.video.i_chroma == VLC_CODEC_RGBP )
     {
         memset( palette, 0, sizeof(palette) );
@@ -606,7 +789,7 @@ static void Convert( filter_t *p_filter, struct SwsContext *ctx,
     }
 
     GetPixels( dst, dst_stride, p_sys->desc_out, &p_filter->fmt_out.video,
-               p_dst, i_plane_count, b_swap_uvo );
+               p_dst, i_plane_count, b_swap_uvo, i_y );
 
     for (size_t i = 0; i < ARRAY_SIZE(src); i++)
         csrc[i] = src[i];
@@ -620,6 +803,78 @@ static void Convert( filter_t *p_filter, struct SwsContext *ctx,
 #endif
 }
 
+typedef struct
+{
+    picture_t *p_dst;
+    picture_t *p_src;
+    int i_plane_count;
+    atomic_bool b_error; /* a band could not be converted */
+} sws_frame_t;
+
+/* Converts a band of the picture with the context of the band */
+static void ConvertSlice( filter_t *p_filter, const filter_slice_t *p_slice,
+                          void *p_data )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    sws_frame_t *p_frame = p_data;
+    const int i_height = p_slice->y_end - p_slice->y_start;
+    struct SwsContext *ctx = p_sys->ctx;
+
+    if( i_height != p_sys->key.i_src_height )
+    {
+        /* Only this band uses this slot, no locking needed */
+        sws_slice_t *p_band = &p_sys->slices[p_slice->index];
+
+        if( p_band->ctx && p_band->key.i_src_height != i_height )
+        {
+            PutContext( &p_band->key, p_band->ctx );
+            p_band->ctx = NULL;
+        }
+        if( !p_band->ctx )
+        {
+            p_band->key = p_sys->key;
+            p_band->key.i_src_height = i_height;
+            p_band->key.i_dst_height = i_height;
+            p_band->ctx = GetContext( &p_band->key );
+            if( !p_band->ctx )
+            {
+                atomic_store( &p_frame->b_error, true );
+                return;
+            }
+        }
+        ctx = p_band->ctx;
+    }
+
+    Convert( p_filter, ctx, p_frame->p_dst, p_frame->p_src, p_slice->y_start,
+             i_height, p_frame->i_plane_count,
+             p_sys->b_swap_uvi, p_sys->b_swap_uvo );
+}
+
+static void UpdateStats( filter_t *p_filter, vlc_tick_t duration )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const vlc_tick_t now = vlc_tick_now();
+
+    if( p_sys->stats.count == 0 )
+        p_sys->stats.start = now - duration;
+    p_sys->stats.count++;
+    p_sys->stats.total += duration;
+    if( duration > p_sys->stats.max )
+        p_sys->stats.max = duration;
+
+    if( now - p_sys->stats.start >= STATS_PERIOD )
+    {
+        msg_Dbg( p_filter, "%u pictures converted, %.2f/%.2f ms per picture "
+                 "(avg/max)", p_sys->stats.count,
+                 MS_FROM_VLC_TICK( (double)p_sys->stats.total )
+                     / p_sys->stats.count,
+                 MS_FROM_VLC_TICK( (double)p_sys->stats.max ) );
+        p_sys->stats.count = 0;
+        p_sys->stats.total = 0;
+        p_sys->stats.max = 0;
+    }
+}
+
 /****************************************************************************
  * Filter: the whole thing
  ****************************************************************************
@@ -648,6 +903,7 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
     }
 
     /* */
+    const vlc_tick_t start = vlc_tick_now();
     picture_t *p_src = p_pic;
     picture_t *p_dst = p_pic_dst;
     if( p_sys->i_extend_factor != 1 )
@@ -667,8 +923,32 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
         /* Even if alpha is unused, swscale expects the pointer to be set */
         const int n_planes = !p_sys->ctxA && (p_src->i_planes == 4 ||
                              p_dst->i_planes == 4) ? 4 : 3;
-        Convert( p_filter, p_sys->ctx, p_dst, p_src, p_fmti->i_visible_height,
-                 n_planes, p_sys->b_swap_uvi, p_sys->b_swap_uvo );
+        if( p_sys->b_slices )
+        {
+            sws_frame_t frame = {
+                .p_dst = p_dst, .p_src = p_src, .i_plane_count = n_planes,
+            };
+            atomic_init( &frame.b_error, false );
+            /* Use bigger bands rather than more contexts than slots */
+            const unsigned i_height = p_fmti->i_visible_height;
+            const unsigned i_align = p_sys->i_slice_align;
+            const unsigned i_band = (i_height + SLICES_MAX - 1) / SLICES_MAX;
+            filter_RunSlices( p_filter, i_height,
+                              __MAX( (i_band + i_align - 1) / i_align * i_align,
+                                     i_align ),
+                              0, ConvertSlice, &frame );
+            if( atomic_load( &frame.b_error ) )
+            {
+                msg_Err( p_filter, "cannot get the context of a band" );
+                picture_Release( p_pic_dst );
+                picture_Release( p_pic );
+                return NULL;
+            }
+        }
+        else
+            Convert( p_filter, p_sys->ctx, p_dst, p_src, 0,
+                     p_fmti->i_visible_height, n_planes,
+                     p_sys->b_swap_uvi, p_sys->b_swap_uvo );
     }
     if( p_sys->ctxA )
     {
@@ -680,7 +960,7 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
         else
             plane_CopyPixels( p_sys->p_src_a->p, p_src->p+A_PLANE );
 
-        Convert( p_filter, p_sys->ctxA, p_sys->p_dst_a, p_sys->p_src_a,
+        Convert( p_filter, p_sys->ctxA, p_sys->p_dst_a, p_sys->p_src_a, 0,
                  p_fmti->i_visible_height, 1, false, false );
         if( p_fmto->i_chroma == VLC_CODEC_RGBA || p_fmto->i_chroma == VLC_CODEC_BGRA )
             InjectA( p_dst, p_sys->p_dst_a, OFFSET_A );
@@ -704,6 +984,7 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
     {
         picture_CopyPixels( p_pic_dst, p_dst );
     }
+    UpdateStats( p_filter, vlc_tick_now() - start );
 
     picture_CopyProperties( p_pic_dst, p_pic );
     picture_Release( p_pic );
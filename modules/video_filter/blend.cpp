@@ -27,23 +27,51 @@
 # include "config.h"
 #endif
 
+#ifdef BLEND_TEST
+# undef NDEBUG
+#endif
+
+#include <assert.h>
+
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
 #include <vlc_picture.h>
+#include <vlc_cpu.h>
 #include "filter_picture.h"
 
+#ifdef HAVE_SSE2_INTRINSICS
+# include <immintrin.h>
+# define BLEND_SSE4_1 __attribute__ ((__target__ ("sse4.1")))
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+# define BLEND_AVX2 __attribute__ ((__target__ ("avx2")))
+#endif
+#ifdef __ARM_NEON
+# include <arm_neon.h>
+# define BLEND_NEON
+#endif
+
+#ifndef BLEND_TEST
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
 static int  Open (vlc_object_t *);
 static void Close(vlc_object_t *);
 
+#define KERNEL_TEXT N_("Blending kernels")
+#define KERNEL_LONGTEXT N_("Row blending kernels, for benchmarking: " \
+    "any, none, c, sse4.1, avx2 or neon.")
+
 vlc_module_begin()
     set_description(N_("Video pictures blending"))
     set_capability("video blending", 100)
+    add_string("blend-kernel", "any", KERNEL_TEXT, KERNEL_LONGTEXT, true)
+        change_private()
     set_callbacks(Open, Close)
 vlc_module_end()
+#endif
 
 static inline unsigned div255(unsigned v)
 {
@@ -80,6 +108,18 @@ public:
     {
         return fmt;
     }
+    const picture_t *getPicture() const
+    {
+        return picture;
+    }
+    unsigned getX() const
+    {
+        return x;
+    }
+    unsigned getY() const
+    {
+        return y;
+    }
     bool isFull(unsigned) const
     {
         return true;
@@ -152,7 +192,7 @@ private:
     uint8_t *data[4];
 };
 
-template <bool swap_uv>
+template <typename pixel, bool swap_uv>
 class CPictureYUVSemiPlanar : public CPicture {
 public:
     CPictureYUVSemiPlanar(const CPicture &cfg) : CPicture(cfg)
@@ -188,12 +228,12 @@ public:
             data[1] += picture->p[1].i_pitch;
     }
 private:
-    uint8_t *getPointer(unsigned plane, unsigned dx) const
+    pixel *getPointer(unsigned plane, unsigned dx) const
     {
         if (plane == 0)
-            return &data[plane][x + dx];
+            return (pixel*)&data[plane][(x + dx) * sizeof(pixel)];
         else
-            return &data[plane][(x + dx) / 2 * 2];
+            return (pixel*)&data[plane][(x + dx) / 2 * 2 * sizeof(pixel)];
     }
     uint8_t *data[2];
 };
@@ -393,8 +433,9 @@ typedef CPictureYUVPlanar<uint8_t,  4,4, false, false> CPictureI410_8;
 
 typedef CPictureYUVPlanar<uint8_t,  4,1, false, false> CPictureI411_8;
 
-typedef CPictureYUVSemiPlanar<false>                   CPictureNV12;
-typedef CPictureYUVSemiPlanar<true>                    CPictureNV21;
+typedef CPictureYUVSemiPlanar<uint8_t,  false>         CPictureNV12;
+typedef CPictureYUVSemiPlanar<uint8_t,  true>          CPictureNV21;
+typedef CPictureYUVSemiPlanar<uint16_t, false>         CPictureP010;
 
 typedef CPictureYUVPlanar<uint8_t,  2,2, false, true>  CPictureYV12;
 typedef CPictureYUVPlanar<uint8_t,  2,2, false, false> CPictureI420_8;
@@ -437,6 +478,17 @@ typedef convertBits< 9, 8> convert8To9Bits;
 typedef convertBits<10, 8> convert8To10Bits;
 typedef convertBits<16, 8> convert8To16Bits;
 
+template <unsigned shift>
+struct convertShiftLeft {
+    convertShiftLeft(const video_format_t *, const video_format_t *) {}
+    void operator()(CPixel &p)
+    {
+        p.i <<= shift;
+        p.j <<= shift;
+        p.k <<= shift;
+    }
+};
+
 struct convertRgbToYuv8 {
     convertRgbToYuv8(const video_format_t *, const video_format_t *) {}
     void operator()(CPixel &p)
@@ -527,6 +579,9 @@ private:
     G g;
 };
 
+/* P010 has 10 bits samples in the most significant bits */
+typedef compose<convertShiftLeft<6>, convert8To10Bits> convert8ToP010;
+
 } // namespace
 
 template <class TDst, class TSrc, class TConvert>
@@ -558,6 +613,848 @@ void Blend(const CPicture &dst_data, const CPicture &src_data,
     }
 }
 
+/*****************************************************************************
+ * Row kernels
+ *
+ * The most common blends are done by rows of staged pixels: the source is
+ * converted to planar YUV, with its alpha premultiplied by the global
+ * alpha, and chroma is picked from the pixels at even positions. Only a
+ * few kernels need to be vectorized then, and they give the same results
+ * as the per pixel templates.
+ *****************************************************************************/
+#define BLEND_CHUNK 512 /* pixels staged at once */
+
+namespace {
+
+struct blend_kernels_t {
+    const char *name;
+    bool (*is_available)(void);
+    /* ae = div255(alpha * a), returns false if everything is transparent */
+    bool (*alpha)(uint8_t *ae, const uint8_t *a, unsigned n, unsigned alpha);
+    /* RGBA to planar YUV as rgb_to_yuv(), and ae as above */
+    bool (*rgba)(uint8_t *y, uint8_t *u, uint8_t *v, uint8_t *ae,
+                 const uint8_t *rgba, unsigned n, unsigned alpha);
+    /* dst = merge(dst, src, ae) */
+    void (*merge8)(uint8_t *dst, const uint8_t *src, const uint8_t *ae,
+                   unsigned n);
+    void (*merge16)(uint16_t *dst, const uint16_t *src, const uint8_t *ae,
+                    unsigned n);
+    /* RGBA onto 32 bits RGB, with the R, G and B bytes of dst at off[] */
+    void (*rgbx)(uint8_t *dst, const uint8_t *rgba, unsigned n,
+                 unsigned alpha, const int off[3]);
+};
+
+} // namespace
+
+static bool IsAvailableC(void)
+{
+    return true;
+}
+
+static bool AlphaC(uint8_t *ae, const uint8_t *a, unsigned n, unsigned alpha)
+{
+    unsigned any = 0;
+    for (unsigned i = 0; i < n; i++) {
+        ae[i] = div255(alpha * a[i]);
+        any |= ae[i];
+    }
+    return any != 0;
+}
+
+static bool RgbaC(uint8_t *y, uint8_t *u, uint8_t *v, uint8_t *ae,
+                  const uint8_t *rgba, unsigned n, unsigned alpha)
+{
+    unsigned any = 0;
+    for (unsigned i = 0; i < n; i++, rgba += 4) {
+        rgb_to_yuv(&y[i], &u[i], &v[i], rgba[0], rgba[1], rgba[2]);
+        ae[i] = div255(alpha * rgba[3]);
+        any |= ae[i];
+    }
+    return any != 0;
+}
+
+template <typename T>
+static void MergeC(T *dst, const T *src, const uint8_t *ae, unsigned n)
+{
+    for (unsigned i = 0; i < n; i++) {
+        if (ae[i] > 0)
+            merge(&dst[i], src[i], ae[i]);
+    }
+}
+
+static void RgbxC(uint8_t *dst, const uint8_t *rgba, unsigned n,
+                  unsigned alpha, const int off[3])
+{
+    for (unsigned i = 0; i < n; i++, dst += 4, rgba += 4) {
+        const unsigned a = div255(alpha * rgba[3]);
+        if (a <= 0)
+            continue;
+        merge(&dst[off[0]], rgba[0], a);
+        merge(&dst[off[1]], rgba[1], a);
+        merge(&dst[off[2]], rgba[2], a);
+    }
+}
+
+static const blend_kernels_t kernels_c = {
+    "c", IsAvailableC, AlphaC, RgbaC, MergeC<uint8_t>, MergeC<uint16_t>, RgbxC,
+};
+
+#if defined(BLEND_SSE4_1) || defined(BLEND_AVX2)
+/* Byte shuffles of RGBA pixels to the dst layout, and of their alpha to the
+ * R, G and B bytes, for 4 pixels */
+static void RgbxShuffles(uint8_t color[16], uint8_t alpha[16], const int off[3])
+{
+    for (unsigned i = 0; i < 16; i++)
+        color[i] = alpha[i] = 0x80; /* zero, with a zero alpha */
+    for (unsigned p = 0; p < 4; p++) {
+        for (unsigned c = 0; c < 3; c++) {
+            color[4 * p + off[c]] = 4 * p + c;
+            alpha[4 * p + off[c]] = 4 * p + 3;
+        }
+    }
+}
+#endif
+
+#ifdef BLEND_SSE4_1
+static bool IsAvailableSSE4_1(void)
+{
+    return vlc_CPU_SSE4_1();
+}
+
+/* div255() on 16 bits lanes */
+BLEND_SSE4_1
+static inline __m128i Div255SSE4_1(__m128i t)
+{
+    t = _mm_add_epi16(t, _mm_srli_epi16(t, 8));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_set1_epi16(1)), 8);
+}
+
+/* merge() on 16 bits lanes, for 8 bits samples */
+BLEND_SSE4_1
+static inline __m128i MergeSSE4_1(__m128i d, __m128i s, __m128i a)
+{
+    const __m128i ia = _mm_sub_epi16(_mm_set1_epi16(255), a);
+    return Div255SSE4_1(_mm_add_epi16(_mm_mullo_epi16(d, ia),
+                                      _mm_mullo_epi16(s, a)));
+}
+
+/* div255() on 32 bits lanes */
+BLEND_SSE4_1
+static inline __m128i Div255x32SSE4_1(__m128i t)
+{
+    t = _mm_add_epi32(t, _mm_srli_epi32(t, 8));
+    return _mm_srli_epi32(_mm_add_epi32(t, _mm_set1_epi32(1)), 8);
+}
+
+/* merge() of 16 bits samples, which is not exact with a null alpha */
+BLEND_SSE4_1
+static inline __m128i Merge16SSE4_1(__m128i d, __m128i s, __m128i a)
+{
+    const __m128i ia = _mm_sub_epi16(_mm_set1_epi16(255), a);
+    const __m128i dl = _mm_mullo_epi16(d, ia), dh = _mm_mulhi_epu16(d, ia);
+    const __m128i sl = _mm_mullo_epi16(s, a),  sh = _mm_mulhi_epu16(s, a);
+    __m128i lo = _mm_add_epi32(_mm_unpacklo_epi16(dl, dh),
+                               _mm_unpacklo_epi16(sl, sh));
+    __m128i hi = _mm_add_epi32(_mm_unpackhi_epi16(dl, dh),
+                               _mm_unpackhi_epi16(sl, sh));
+    return _mm_blendv_epi8(_mm_packus_epi32(Div255x32SSE4_1(lo), Div255x32SSE4_1(hi)),
+                           d, _mm_cmpeq_epi16(a, _mm_setzero_si128()));
+}
+
+BLEND_SSE4_1
+static inline __m128i AlphaSSE4_1(__m128i a, __m128i alpha)
+{
+    const __m128i zero = _mm_setzero_si128();
+    return _mm_packus_epi16(
+        Div255SSE4_1(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), alpha)),
+        Div255SSE4_1(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), alpha)));
+}
+
+BLEND_SSE4_1
+static bool AlphaSSE4_1(uint8_t *ae, const uint8_t *a, unsigned n, unsigned alpha)
+{
+    const __m128i va = _mm_set1_epi16(alpha);
+    __m128i any = _mm_setzero_si128();
+    unsigned i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = AlphaSSE4_1(_mm_loadu_si128((const __m128i *)&a[i]), va);
+        any = _mm_or_si128(any, x);
+        _mm_storeu_si128((__m128i *)&ae[i], x);
+    }
+    return AlphaC(&ae[i], &a[i], n - i, alpha) || !_mm_testz_si128(any, any);
+}
+
+/* 8 RGBA pixels to 16 bits lanes */
+BLEND_SSE4_1
+static inline void UnpackRgbaSSE4_1(const uint8_t *rgba, __m128i *r,
+                                    __m128i *g, __m128i *b, __m128i *a)
+{
+    const __m128i mask = _mm_set1_epi32(0xff);
+    const __m128i p0 = _mm_loadu_si128((const __m128i *)&rgba[0]);
+    const __m128i p1 = _mm_loadu_si128((const __m128i *)&rgba[16]);
+    *r = _mm_packus_epi32(_mm_and_si128(p0, mask), _mm_and_si128(p1, mask));
+    *g = _mm_packus_epi32(_mm_and_si128(_mm_srli_epi32(p0, 8), mask),
+                          _mm_and_si128(_mm_srli_epi32(p1, 8), mask));
+    *b = _mm_packus_epi32(_mm_and_si128(_mm_srli_epi32(p0, 16), mask),
+                          _mm_and_si128(_mm_srli_epi32(p1, 16), mask));
+    *a = _mm_packus_epi32(_mm_srli_epi32(p0, 24), _mm_srli_epi32(p1, 24));
+}
+
+/* rgb_to_yuv(), the intermediate sums fit in 16 bits */
+BLEND_SSE4_1
+static inline void RgbToYuvSSE4_1(__m128i r, __m128i g, __m128i b,
+                                  __m128i *y, __m128i *u, __m128i *v)
+{
+#define DOT(cr, cg, cb) \
+    _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(cr)), \
+                                _mm_mullo_epi16(g, _mm_set1_epi16(cg))), \
+                  _mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(cb)), \
+                                _mm_set1_epi16(128)))
+    *y = _mm_add_epi16(_mm_srli_epi16(DOT( 66, 129,  25), 8), _mm_set1_epi16(16));
+    *u = _mm_add_epi16(_mm_srai_epi16(DOT(-38, -74, 112), 8), _mm_set1_epi16(128));
+    *v = _mm_add_epi16(_mm_srai_epi16(DOT(112, -94, -18), 8), _mm_set1_epi16(128));
+#undef DOT
+}
+
+BLEND_SSE4_1
+static bool RgbaSSE4_1(uint8_t *y, uint8_t *u, uint8_t *v, uint8_t *ae,
+                       const uint8_t *rgba, unsigned n, unsigned alpha)
+{
+    const __m128i va = _mm_set1_epi16(alpha);
+    __m128i any = _mm_setzero_si128();
+    unsigned i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i r[2], g[2], b[2], a[2];
+        for (unsigned h = 0; h < 2; h++) {
+            UnpackRgbaSSE4_1(&rgba[4 * (i + 8 * h)], &r[h], &g[h], &b[h], &a[h]);
+            a[h] = Div255SSE4_1(_mm_mullo_epi16(a[h], va));
+        }
+        const __m128i x = _mm_packus_epi16(a[0], a[1]);
+        _mm_storeu_si128((__m128i *)&ae[i], x);
+        if (_mm_testz_si128(x, x))
+            continue; /* transparent */
+        any = _mm_or_si128(any, x);
+
+        __m128i vy[2], vu[2], vv[2];
+        for (unsigned h = 0; h < 2; h++)
+            RgbToYuvSSE4_1(r[h], g[h], b[h], &vy[h], &vu[h], &vv[h]);
+        _mm_storeu_si128((__m128i *)&y[i], _mm_packus_epi16(vy[0], vy[1]));
+        _mm_storeu_si128((__m128i *)&u[i], _mm_packus_epi16(vu[0], vu[1]));
+        _mm_storeu_si128((__m128i *)&v[i], _mm_packus_epi16(vv[0], vv[1]));
+    }
+    return RgbaC(&y[i], &u[i], &v[i], &ae[i], &rgba[4 * i], n - i, alpha)
+        || !_mm_testz_si128(any, any);
+}
+
+BLEND_SSE4_1
+static void Merge8SSE4_1(uint8_t *dst, const uint8_t *src, const uint8_t *ae,
+                         unsigned n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    unsigned i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i a = _mm_loadu_si128((const __m128i *)&ae[i]);
+        if (_mm_testz_si128(a, a))
+            continue; /* transparent */
+        const __m128i d = _mm_loadu_si128((const __m128i *)&dst[i]);
+        const __m128i s = _mm_loadu_si128((const __m128i *)&src[i]);
+        const __m128i lo = MergeSSE4_1(_mm_unpacklo_epi8(d, zero),
+                                       _mm_unpacklo_epi8(s, zero),
+                                       _mm_unpacklo_epi8(a, zero));
+        const __m128i hi = MergeSSE4_1(_mm_unpackhi_epi8(d, zero),
+                                       _mm_unpackhi_epi8(s, zero),
+                                       _mm_unpackhi_epi8(a, zero));
+        _mm_storeu_si128((__m128i *)&dst[i], _mm_packus_epi16(lo, hi));
+    }
+    MergeC(&dst[i], &src[i], &ae[i], n - i);
+}
+
+BLEND_SSE4_1
+static void Merge16SSE4_1(uint16_t *dst, const uint16_t *src, const uint8_t *ae,
+                          unsigned n)
+{
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m128i a = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)&ae[i]));
+        if (_mm_testz_si128(a, a))
+            continue; /* transparent */
+        const __m128i d = _mm_loadu_si128((const __m128i *)&dst[i]);
+        const __m128i s = _mm_loadu_si128((const __m128i *)&src[i]);
+        _mm_storeu_si128((__m128i *)&dst[i], Merge16SSE4_1(d, s, a));
+    }
+    MergeC(&dst[i], &src[i], &ae[i], n - i);
+}
+
+BLEND_SSE4_1
+static void RgbxSSE4_1(uint8_t *dst, const uint8_t *rgba, unsigned n,
+                       unsigned alpha, const int off[3])
+{
+    uint8_t color[16], alpha_bytes[16];
+    RgbxShuffles(color, alpha_bytes, off);
+    const __m128i sc = _mm_loadu_si128((const __m128i *)color);
+    const __m128i sa = _mm_loadu_si128((const __m128i *)alpha_bytes);
+    const __m128i va = _mm_set1_epi16(alpha);
+    const __m128i zero = _mm_setzero_si128();
+    unsigned i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i s = _mm_loadu_si128((const __m128i *)&rgba[4 * i]);
+        __m128i a = _mm_shuffle_epi8(s, sa);
+        if (_mm_testz_si128(a, a))
+            continue; /* transparent */
+        a = AlphaSSE4_1(a, va);
+        const __m128i c = _mm_shuffle_epi8(s, sc);
+        const __m128i d = _mm_loadu_si128((const __m128i *)&dst[4 * i]);
+        const __m128i lo = MergeSSE4_1(_mm_unpacklo_epi8(d, zero),
+                                       _mm_unpacklo_epi8(c, zero),
+                                       _mm_unpacklo_epi8(a, zero));
+        const __m128i hi = MergeSSE4_1(_mm_unpackhi_epi8(d, zero),
+                                       _mm_unpackhi_epi8(c, zero),
+                                       _mm_unpackhi_epi8(a, zero));
+        _mm_storeu_si128((__m128i *)&dst[4 * i], _mm_packus_epi16(lo, hi));
+    }
+    RgbxC(&dst[4 * i], &rgba[4 * i], n - i, alpha, off);
+}
+
+static const blend_kernels_t kernels_sse4_1 = {
+    "sse4.1", IsAvailableSSE4_1, AlphaSSE4_1, RgbaSSE4_1,
+    Merge8SSE4_1, Merge16SSE4_1, RgbxSSE4_1,
+};
+#endif
+
+#ifdef BLEND_AVX2
+static bool IsAvailableAVX2(void)
+{
+    return vlc_CPU_AVX2();
+}
+
+/* The 128 bits lanes are unpacked and packed back the same way, so that
+ * the pixels order is kept without permutations */
+BLEND_AVX2
+static inline __m256i Div255AVX2(__m256i t)
+{
+    t = _mm256_add_epi16(t, _mm256_srli_epi16(t, 8));
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_set1_epi16(1)), 8);
+}
+
+BLEND_AVX2
+static inline __m256i MergeAVX2(__m256i d, __m256i s, __m256i a)
+{
+    const __m256i ia = _mm256_sub_epi16(_mm256_set1_epi16(255), a);
+    return Div255AVX2(_mm256_add_epi16(_mm256_mullo_epi16(d, ia),
+                                       _mm256_mullo_epi16(s, a)));
+}
+
+BLEND_AVX2
+static inline __m256i Div255x32AVX2(__m256i t)
+{
+    t = _mm256_add_epi32(t, _mm256_srli_epi32(t, 8));
+    return _mm256_srli_epi32(_mm256_add_epi32(t, _mm256_set1_epi32(1)), 8);
+}
+
+BLEND_AVX2
+static inline __m256i Merge16AVX2(__m256i d, __m256i s, __m256i a)
+{
+    const __m256i ia = _mm256_sub_epi16(_mm256_set1_epi16(255), a);
+    const __m256i dl = _mm256_mullo_epi16(d, ia), dh = _mm256_mulhi_epu16(d, ia);
+    const __m256i sl = _mm256_mullo_epi16(s, a),  sh = _mm256_mulhi_epu16(s, a);
+    __m256i lo = _mm256_add_epi32(_mm256_unpacklo_epi16(dl, dh),
+                                  _mm256_unpacklo_epi16(sl, sh));
+    __m256i hi = _mm256_add_epi32(_mm256_unpackhi_epi16(dl, dh),
+                                  _mm256_unpackhi_epi16(sl, sh));
+    return _mm256_blendv_epi8(_mm256_packus_epi32(Div255x32AVX2(lo), Div255x32AVX2(hi)),
+                              d, _mm256_cmpeq_epi16(a, _mm256_setzero_si256()));
+}
+
+BLEND_AVX2
+static inline __m256i AlphaAVX2(__m256i a, __m256i alpha)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    return _mm256_packus_epi16(
+        Div255AVX2(_mm256_mullo_epi16(_mm256_unpacklo_epi8(a, zero), alpha)),
+        Div255AVX2(_mm256_mullo_epi16(_mm256_unpackhi_epi8(a, zero), alpha)));
+}
+
+BLEND_AVX2
+static bool AlphaAVX2(uint8_t *ae, const uint8_t *a, unsigned n, unsigned alpha)
+{
+    const __m256i va = _mm256_set1_epi16(alpha);
+    __m256i any = _mm256_setzero_si256();
+    unsigned i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = AlphaAVX2(_mm256_loadu_si256((const __m256i *)&a[i]), va);
+        any = _mm256_or_si256(any, x);
+        _mm256_storeu_si256((__m256i *)&ae[i], x);
+    }
+    return AlphaC(&ae[i], &a[i], n - i, alpha) || !_mm256_testz_si256(any, any);
+}
+
+/* 16 RGBA pixels to 16 bits lanes, in the 0-3 8-11 4-7 12-15 order */
+BLEND_AVX2
+static inline void UnpackRgbaAVX2(const uint8_t *rgba, __m256i *r,
+                                  __m256i *g, __m256i *b, __m256i *a)
+{
+    const __m256i mask = _mm256_set1_epi32(0xff);
+    const __m256i p0 = _mm256_loadu_si256((const __m256i *)&rgba[0]);
+    const __m256i p1 = _mm256_loadu_si256((const __m256i *)&rgba[32]);
+    *r = _mm256_packus_epi32(_mm256_and_si256(p0, mask),
+                             _mm256_and_si256(p1, mask));
+    *g = _mm256_packus_epi32(_mm256_and_si256(_mm256_srli_epi32(p0, 8), mask),
+                             _mm256_and_si256(_mm256_srli_epi32(p1, 8), mask));
+    *b = _mm256_packus_epi32(_mm256_and_si256(_mm256_srli_epi32(p0, 16), mask),
+                             _mm256_and_si256(_mm256_srli_epi32(p1, 16), mask));
+    *a = _mm256_packus_epi32(_mm256_srli_epi32(p0, 24),
+                             _mm256_srli_epi32(p1, 24));
+}
+
+BLEND_AVX2
+static inline void RgbToYuvAVX2(__m256i r, __m256i g, __m256i b,
+                                __m256i *y, __m256i *u, __m256i *v)
+{
+#define DOT(cr, cg, cb) \
+    _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(r, _mm256_set1_epi16(cr)), \
+                                      _mm256_mullo_epi16(g, _mm256_set1_epi16(cg))), \
+                     _mm256_add_epi16(_mm256_mullo_epi16(b, _mm256_set1_epi16(cb)), \
+                                      _mm256_set1_epi16(128)))
+    *y = _mm256_add_epi16(_mm256_srli_epi16(DOT( 66, 129,  25), 8), _mm256_set1_epi16(16));
+    *u = _mm256_add_epi16(_mm256_srai_epi16(DOT(-38, -74, 112), 8), _mm256_set1_epi16(128));
+    *v = _mm256_add_epi16(_mm256_srai_epi16(DOT(112, -94, -18), 8), _mm256_set1_epi16(128));
+#undef DOT
+}
+
+/* Packs 2 vectors from UnpackRgbaAVX2() to 32 pixels in order */
+BLEND_AVX2
+static inline __m256i PackRgbaAVX2(__m256i lo, __m256i hi)
+{
+    return _mm256_permutevar8x32_epi32(_mm256_packus_epi16(lo, hi),
+                                       _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+}
+
+BLEND_AVX2
+static bool RgbaAVX2(uint8_t *y, uint8_t *u, uint8_t *v, uint8_t *ae,
+                     const uint8_t *rgba, unsigned n, unsigned alpha)
+{
+    const __m256i va = _mm256_set1_epi16(alpha);
+    __m256i any = _mm256_setzero_si256();
+    unsigned i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i r[2], g[2], b[2], a[2];
+        for (unsigned h = 0; h < 2; h++) {
+            UnpackRgbaAVX2(&rgba[4 * (i + 16 * h)], &r[h], &g[h], &b[h], &a[h]);
+            a[h] = Div255AVX2(_mm256_mullo_epi16(a[h], va));
+        }
+        const __m256i x = PackRgbaAVX2(a[0], a[1]);
+        _mm256_storeu_si256((__m256i *)&ae[i], x);
+        if (_mm256_testz_si256(x, x))
+            continue; /* transparent */
+        any = _mm256_or_si256(any, x);
+
+        __m256i vy[2], vu[2], vv[2];
+        for (unsigned h = 0; h < 2; h++)
+            RgbToYuvAVX2(r[h], g[h], b[h], &vy[h], &vu[h], &vv[h]);
+        _mm256_storeu_si256((__m256i *)&y[i], PackRgbaAVX2(vy[0], vy[1]));
+        _mm256_storeu_si256((__m256i *)&u[i], PackRgbaAVX2(vu[0], vu[1]));
+        _mm256_storeu_si256((__m256i *)&v[i], PackRgbaAVX2(vv[0], vv[1]));
+    }
+    return RgbaC(&y[i], &u[i], &v[i], &ae[i], &rgba[4 * i], n - i, alpha)
+        || !_mm256_testz_si256(any, any);
+}
+
+BLEND_AVX2
+static void Merge8AVX2(uint8_t *dst, const uint8_t *src, const uint8_t *ae,
+                       unsigned n)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    unsigned i = 0;
+    for (; i + 32 <= n; i += 32) {
+        const __m256i a = _mm256_loadu_si256((const __m256i *)&ae[i]);
+        if (_mm256_testz_si256(a, a))
+            continue; /* transparent */
+        const __m256i d = _mm256_loadu_si256((const __m256i *)&dst[i]);
+        const __m256i s = _mm256_loadu_si256((const __m256i *)&src[i]);
+        const __m256i lo = MergeAVX2(_mm256_unpacklo_epi8(d, zero),
+                                     _mm256_unpacklo_epi8(s, zero),
+                                     _mm256_unpacklo_epi8(a, zero));
+        const __m256i hi = MergeAVX2(_mm256_unpackhi_epi8(d, zero),
+                                     _mm256_unpackhi_epi8(s, zero),
+                                     _mm256_unpackhi_epi8(a, zero));
+        _mm256_storeu_si256((__m256i *)&dst[i], _mm256_packus_epi16(lo, hi));
+    }
+    MergeC(&dst[i], &src[i], &ae[i], n - i);
+}
+
+BLEND_AVX2
+static void Merge16AVX2(uint16_t *dst, const uint16_t *src, const uint8_t *ae,
+                        unsigned n)
+{
+    unsigned i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m256i a = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)&ae[i]));
+        if (_mm256_testz_si256(a, a))
+            continue; /* transparent */
+        const __m256i d = _mm256_loadu_si256((const __m256i *)&dst[i]);
+        const __m256i s = _mm256_loadu_si256((const __m256i *)&src[i]);
+        _mm256_storeu_si256((__m256i *)&dst[i], Merge16AVX2(d, s, a));
+    }
+    MergeC(&dst[i], &src[i], &ae[i], n - i);
+}
+
+BLEND_AVX2
+static void RgbxAVX2(uint8_t *dst, const uint8_t *rgba, unsigned n,
+                     unsigned alpha, const int off[3])
+{
+    uint8_t color[16], alpha_bytes[16];
+    RgbxShuffles(color, alpha_bytes, off);
+    const __m256i sc = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)color));
+    const __m256i sa = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)alpha_bytes));
+    const __m256i va = _mm256_set1_epi16(alpha);
+    const __m256i zero = _mm256_setzero_si256();
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i s = _mm256_loadu_si256((const __m256i *)&rgba[4 * i]);
+        __m256i a = _mm256_shuffle_epi8(s, sa);
+        if (_mm256_testz_si256(a, a))
+            continue; /* transparent */
+        a = AlphaAVX2(a, va);
+        const __m256i c = _mm256_shuffle_epi8(s, sc);
+        const __m256i d = _mm256_loadu_si256((const __m256i *)&dst[4 * i]);
+        const __m256i lo = MergeAVX2(_mm256_unpacklo_epi8(d, zero),
+                                     _mm256_unpacklo_epi8(c, zero),
+                                     _mm256_unpacklo_epi8(a, zero));
+        const __m256i hi = MergeAVX2(_mm256_unpackhi_epi8(d, zero),
+                                     _mm256_unpackhi_epi8(c, zero),
+                                     _mm256_unpackhi_epi8(a, zero));
+        _mm256_storeu_si256((__m256i *)&dst[4 * i], _mm256_packus_epi16(lo, hi));
+    }
+    RgbxC(&dst[4 * i], &rgba[4 * i], n - i, alpha, off);
+}
+
+static const blend_kernels_t kernels_avx2 = {
+    "avx2", IsAvailableAVX2, AlphaAVX2, RgbaAVX2,
+    Merge8AVX2, Merge16AVX2, RgbxAVX2,
+};
+#endif
+
+#ifdef BLEND_NEON
+static bool IsAvailableNEON(void)
+{
+    return vlc_CPU_ARM_NEON();
+}
+
+static inline uint8x8_t Div255NEON(uint16x8_t t)
+{
+    t = vaddq_u16(t, vshrq_n_u16(t, 8));
+    return vshrn_n_u16(vaddq_u16(t, vdupq_n_u16(1)), 8);
+}
+
+static inline uint8x16_t MergeNEON(uint8x16_t d, uint8x16_t s, uint8x16_t a)
+{
+    const uint8x16_t ia = vmvnq_u8(a);
+    const uint16x8_t lo = vmlal_u8(vmull_u8(vget_low_u8(d), vget_low_u8(ia)),
+                                   vget_low_u8(s), vget_low_u8(a));
+    const uint16x8_t hi = vmlal_u8(vmull_u8(vget_high_u8(d), vget_high_u8(ia)),
+                                   vget_high_u8(s), vget_high_u8(a));
+    return vcombine_u8(Div255NEON(lo), Div255NEON(hi));
+}
+
+static inline uint16x4_t Div255x32NEON(uint32x4_t t)
+{
+    t = vaddq_u32(t, vshrq_n_u32(t, 8));
+    return vshrn_n_u32(vaddq_u32(t, vdupq_n_u32(1)), 8);
+}
+
+static inline uint8x16_t AlphaNEON(uint8x16_t a, uint8x8_t alpha)
+{
+    return vcombine_u8(Div255NEON(vmull_u8(vget_low_u8(a), alpha)),
+                       Div255NEON(vmull_u8(vget_high_u8(a), alpha)));
+}
+
+static inline bool IsZeroNEON(uint8x16_t v)
+{
+    const uint64x2_t v64 = vreinterpretq_u64_u8(v);
+    return (vgetq_lane_u64(v64, 0) | vgetq_lane_u64(v64, 1)) == 0;
+}
+
+static bool AlphaNEON(uint8_t *ae, const uint8_t *a, unsigned n, unsigned alpha)
+{
+    const uint8x8_t va = vdup_n_u8(alpha);
+    uint8x16_t any = vdupq_n_u8(0);
+    unsigned i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const uint8x16_t x = AlphaNEON(vld1q_u8(&a[i]), va);
+        any = vorrq_u8(any, x);
+        vst1q_u8(&ae[i], x);
+    }
+    return AlphaC(&ae[i], &a[i], n - i, alpha) || !IsZeroNEON(any);
+}
+
+/* rgb_to_yuv() of 8 pixels, the intermediate sums wrap around in 16 bits */
+static inline void RgbToYuvNEON(uint8x8_t r, uint8x8_t g, uint8x8_t b,
+                                uint8x8_t *y, uint8x8_t *u, uint8x8_t *v)
+{
+    const uint16x8_t round = vdupq_n_u16(128);
+    uint16x8_t t;
+
+    t = vmlal_u8(vmlal_u8(vmull_u8(r, vdup_n_u8(66)), g, vdup_n_u8(129)),
+                 b, vdup_n_u8(25));
+    *y = vadd_u8(vshrn_n_u16(vaddq_u16(t, round), 8), vdup_n_u8(16));
+
+    t = vmlsl_u8(vmlsl_u8(vmull_u8(b, vdup_n_u8(112)), r, vdup_n_u8(38)),
+                 g, vdup_n_u8(74));
+    t = vaddq_u16(t, round);
+    *u = vadd_u8(vreinterpret_u8_s8(vmovn_s16(vshrq_n_s16(vreinterpretq_s16_u16(t), 8))),
+                 vdup_n_u8(128));
+
+    t = vmlsl_u8(vmlsl_u8(vmull_u8(r, vdup_n_u8(112)), g, vdup_n_u8(94)),
+                 b, vdup_n_u8(18));
+    t = vaddq_u16(t, round);
+    *v = vadd_u8(vreinterpret_u8_s8(vmovn_s16(vshrq_n_s16(vreinterpretq_s16_u16(t), 8))),
+                 vdup_n_u8(128));
+}
+
+static bool RgbaNEON(uint8_t *y, uint8_t *u, uint8_t *v, uint8_t *ae,
+                     const uint8_t *rgba, unsigned n, unsigned alpha)
+{
+    const uint8x8_t va = vdup_n_u8(alpha);
+    uint8x16_t any = vdupq_n_u8(0);
+    unsigned i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const uint8x16x4_t s = vld4q_u8(&rgba[4 * i]);
+        const uint8x16_t x = AlphaNEON(s.val[3], va);
+        vst1q_u8(&ae[i], x);
+        if (IsZeroNEON(x))
+            continue; /* transparent */
+        any = vorrq_u8(any, x);
+
+        uint8x8_t vy[2], vu[2], vv[2];
+        RgbToYuvNEON(vget_low_u8(s.val[0]), vget_low_u8(s.val[1]),
+                     vget_low_u8(s.val[2]), &vy[0], &vu[0], &vv[0]);
+        RgbToYuvNEON(vget_high_u8(s.val[0]), vget_high_u8(s.val[1]),
+                     vget_high_u8(s.val[2]), &vy[1], &vu[1], &vv[1]);
+        vst1q_u8(&y[i], vcombine_u8(vy[0], vy[1]));
+        vst1q_u8(&u[i], vcombine_u8(vu[0], vu[1]));
+        vst1q_u8(&v[i], vcombine_u8(vv[0], vv[1]));
+    }
+    return RgbaC(&y[i], &u[i], &v[i], &ae[i], &rgba[4 * i], n - i, alpha)
+        || !IsZeroNEON(any);
+}
+
+static void Merge8NEON(uint8_t *dst, const uint8_t *src, const uint8_t *ae,
+                       unsigned n)
+{
+    unsigned i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const uint8x16_t a = vld1q_u8(&ae[i]);
+        if (IsZeroNEON(a))
+            continue; /* transparent */
+        vst1q_u8(&dst[i], MergeNEON(vld1q_u8(&dst[i]), vld1q_u8(&src[i]), a));
+    }
+    MergeC(&dst[i], &src[i], &ae[i], n - i);
+}
+
+static void Merge16NEON(uint16_t *dst, const uint16_t *src, const uint8_t *ae,
+                        unsigned n)
+{
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const uint8x8_t a8 = vld1_u8(&ae[i]);
+        if (vget_lane_u64(vreinterpret_u64_u8(a8), 0) == 0)
+            continue; /* transparent */
+        const uint16x8_t a = vmovl_u8(a8);
+        const uint16x8_t ia = vsubq_u16(vdupq_n_u16(255), a);
+        const uint16x8_t d = vld1q_u16(&dst[i]);
+        const uint16x8_t s = vld1q_u16(&src[i]);
+        const uint32x4_t lo = vmlal_u16(vmull_u16(vget_low_u16(d), vget_low_u16(ia)),
+                                        vget_low_u16(s), vget_low_u16(a));
+        const uint32x4_t hi = vmlal_u16(vmull_u16(vget_high_u16(d), vget_high_u16(ia)),
+                                        vget_high_u16(s), vget_high_u16(a));
+        /* merge() is not exact with a null alpha on 16 bits */
+        vst1q_u16(&dst[i], vbslq_u16(vceqq_u16(a, vdupq_n_u16(0)), d,
+                                     vcombine_u16(Div255x32NEON(lo), Div255x32NEON(hi))));
+    }
+    MergeC(&dst[i], &src[i], &ae[i], n - i);
+}
+
+static void RgbxNEON(uint8_t *dst, const uint8_t *rgba, unsigned n,
+                     unsigned alpha, const int off[3])
+{
+    const uint8x8_t va = vdup_n_u8(alpha);
+    unsigned i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const uint8x16x4_t s = vld4q_u8(&rgba[4 * i]);
+        const uint8x16_t a = AlphaNEON(s.val[3], va);
+        if (IsZeroNEON(a))
+            continue; /* transparent */
+        uint8x16x4_t d = vld4q_u8(&dst[4 * i]);
+        for (unsigned c = 0; c < 3; c++)
+            d.val[off[c]] = MergeNEON(d.val[off[c]], s.val[c], a);
+        vst4q_u8(&dst[4 * i], d);
+    }
+    RgbxC(&dst[4 * i], &rgba[4 * i], n - i, alpha, off);
+}
+
+static const blend_kernels_t kernels_neon = {
+    "neon", IsAvailableNEON, AlphaNEON, RgbaNEON,
+    Merge8NEON, Merge16NEON, RgbxNEON,
+};
+#endif
+
+/* By order of preference */
+static const blend_kernels_t *const kernels[] = {
+#ifdef BLEND_AVX2
+    &kernels_avx2,
+#endif
+#ifdef BLEND_SSE4_1
+    &kernels_sse4_1,
+#endif
+#ifdef BLEND_NEON
+    &kernels_neon,
+#endif
+    &kernels_c,
+};
+
+static const blend_kernels_t *GetKernels(const char *name)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(kernels); i++) {
+        if (!kernels[i]->is_available())
+            continue;
+        if (!strcmp(name, "any") || !strcmp(name, kernels[i]->name))
+            return kernels[i];
+    }
+    return NULL;
+}
+
+enum {
+    ROWS_I420,
+    ROWS_NV12,
+    ROWS_P010,
+};
+
+static inline uint16_t ToP010(unsigned v)
+{
+    return (v * 1023 / 255) << 6;
+}
+
+template <unsigned layout, bool swap_uv>
+void BlendRows(const blend_kernels_t *k,
+               const CPicture &dst_data, const CPicture &src_data,
+               unsigned width, unsigned height, int alpha)
+{
+    const picture_t *dst = dst_data.getPicture();
+    const picture_t *src = src_data.getPicture();
+    const bool src_rgba = src_data.getFormat()->i_chroma == VLC_CODEC_RGBA;
+    const unsigned sx = src_data.getX(), sy = src_data.getY();
+    const unsigned dx = dst_data.getX(), dy = dst_data.getY();
+    const unsigned u_plane = layout == ROWS_I420 && swap_uv ? 2 : 1;
+    const unsigned v_plane = layout == ROWS_I420 && swap_uv ? 1 : 2;
+
+    uint8_t ty[BLEND_CHUNK], tu[BLEND_CHUNK], tv[BLEND_CHUNK], ae[BLEND_CHUNK];
+    uint8_t cu[BLEND_CHUNK], cv[BLEND_CHUNK], ca[BLEND_CHUNK];
+    uint16_t t16[BLEND_CHUNK];
+
+    for (unsigned y = 0; y < height; y++) {
+        const unsigned ys = sy + y, yd = dy + y;
+        uint8_t *dst_y = &dst->p[0].p_pixels[yd * dst->p[0].i_pitch];
+        uint8_t *dst_u = &dst->p[u_plane].p_pixels[yd / 2 * dst->p[u_plane].i_pitch];
+        uint8_t *dst_v = NULL;
+        if (layout == ROWS_I420)
+            dst_v = &dst->p[v_plane].p_pixels[yd / 2 * dst->p[v_plane].i_pitch];
+
+        for (unsigned x = 0; x < width; x += BLEND_CHUNK) {
+            const unsigned n = __MIN(BLEND_CHUNK, width - x);
+            const uint8_t *py, *pu, *pv;
+
+            if (src_rgba) {
+                const uint8_t *rgba = &src->p[0].p_pixels[ys * src->p[0].i_pitch
+                                                          + (sx + x) * 4];
+                if (!k->rgba(ty, tu, tv, ae, rgba, n, alpha))
+                    continue; /* transparent */
+                py = ty;
+                pu = tu;
+                pv = tv;
+            } else {
+                const size_t offset = sx + x;
+                if (!k->alpha(ae, &src->p[3].p_pixels[ys * src->p[3].i_pitch + offset],
+                              n, alpha))
+                    continue; /* transparent */
+                py = &src->p[0].p_pixels[ys * src->p[0].i_pitch + offset];
+                pu = &src->p[1].p_pixels[ys * src->p[1].i_pitch + offset];
+                pv = &src->p[2].p_pixels[ys * src->p[2].i_pitch + offset];
+            }
+
+            const unsigned xd = dx + x;
+            if (layout == ROWS_P010) {
+                for (unsigned i = 0; i < n; i++)
+                    t16[i] = ToP010(py[i]);
+                k->merge16((uint16_t *)dst_y + xd, t16, ae, n);
+            } else {
+                k->merge8(dst_y + xd, py, ae, n);
+            }
+
+            if ((yd % 2) != 0)
+                continue;
+
+            /* Chroma samples from the pixels at even positions */
+            const unsigned first = xd % 2;
+            const unsigned m = (n - first + 1) / 2;
+            const unsigned xc = (xd + first) / 2;
+            switch (layout) {
+            case ROWS_I420:
+                for (unsigned i = 0; i < m; i++) {
+                    cu[i] = pu[first + 2 * i];
+                    cv[i] = pv[first + 2 * i];
+                    ca[i] = ae[first + 2 * i];
+                }
+                k->merge8(dst_u + xc, cu, ca, m);
+                k->merge8(dst_v + xc, cv, ca, m);
+                break;
+            case ROWS_NV12:
+                for (unsigned i = 0; i < m; i++) {
+                    cu[2 * i +  swap_uv] = pu[first + 2 * i];
+                    cu[2 * i + !swap_uv] = pv[first + 2 * i];
+                    ca[2 * i] = ca[2 * i + 1] = ae[first + 2 * i];
+                }
+                k->merge8(dst_u + 2 * xc, cu, ca, 2 * m);
+                break;
+            case ROWS_P010:
+                for (unsigned i = 0; i < m; i++) {
+                    t16[2 * i]     = ToP010(pu[first + 2 * i]);
+                    t16[2 * i + 1] = ToP010(pv[first + 2 * i]);
+                    ca[2 * i] = ca[2 * i + 1] = ae[first + 2 * i];
+                }
+                k->merge16((uint16_t *)dst_u + 2 * xc, t16, ca, 2 * m);
+                break;
+            }
+        }
+    }
+}
+
+static void BlendRowsRGB32(const blend_kernels_t *k,
+                           const CPicture &dst_data, const CPicture &src_data,
+                           unsigned width, unsigned height, int alpha)
+{
+    const picture_t *dst = dst_data.getPicture();
+    const picture_t *src = src_data.getPicture();
+    int off[3];
+
+    if (GetPackedRgbIndexes(dst_data.getFormat(), &off[0], &off[1], &off[2]) != VLC_SUCCESS) {
+        off[0] = 0;
+        off[1] = 1;
+        off[2] = 2;
+    }
+
+    for (unsigned y = 0; y < height; y++) {
+        k->rgbx(&dst->p[0].p_pixels[(dst_data.getY() + y) * dst->p[0].i_pitch
+                                    + dst_data.getX() * 4],
+                &src->p[0].p_pixels[(src_data.getY() + y) * src->p[0].i_pitch
+                                    + src_data.getX() * 4],
+                width, alpha, off);
+    }
+}
+
+typedef void (*blend_rows_t)(const blend_kernels_t *,
+                             const CPicture &dst_data, const CPicture &src_data,
+                             unsigned width, unsigned height, int alpha);
+
 typedef void (*blend_function_t)(const CPicture &dst_data, const CPicture &src_data,
                                  unsigned width, unsigned height, int alpha);
 
@@ -594,6 +1491,9 @@ static const struct {
     YUV(VLC_CODEC_YV12,     CPictureYV12,     convertNone),
     YUV(VLC_CODEC_NV12,     CPictureNV12,     convertNone),
     YUV(VLC_CODEC_NV21,     CPictureNV21,     convertNone),
+#ifndef WORDS_BIGENDIAN
+    YUV(VLC_CODEC_P010,     CPictureP010,     convert8ToP010),
+#endif
     YUV(VLC_CODEC_J420,     CPictureI420_8,   convertNone),
     YUV(VLC_CODEC_I420,     CPictureI420_8,   convertNone),
 #ifdef WORDS_BIGENDIAN
@@ -637,15 +1537,40 @@ static const struct {
 #undef YUV
 };
 
+static const struct {
+    vlc_fourcc_t dst;
+    vlc_fourcc_t src;
+    blend_rows_t blend;
+} rows_blends[] = {
+#define YUV(csp, rows) \
+    { csp, VLC_CODEC_YUVA, rows }, \
+    { csp, VLC_CODEC_RGBA, rows }
+
+    YUV(VLC_CODEC_I420, (BlendRows<ROWS_I420, false>)),
+    YUV(VLC_CODEC_J420, (BlendRows<ROWS_I420, false>)),
+    YUV(VLC_CODEC_YV12, (BlendRows<ROWS_I420, true>)),
+    YUV(VLC_CODEC_NV12, (BlendRows<ROWS_NV12, false>)),
+    YUV(VLC_CODEC_NV21, (BlendRows<ROWS_NV12, true>)),
+#ifndef WORDS_BIGENDIAN
+    YUV(VLC_CODEC_P010, (BlendRows<ROWS_P010, false>)),
+#endif
+    { VLC_CODEC_RGB32, VLC_CODEC_RGBA, BlendRowsRGB32 },
+
+#undef YUV
+};
+
 struct filter_sys_t {
-    filter_sys_t() : blend(NULL)
+    filter_sys_t() : blend(NULL), blend_rows(NULL), kernels(NULL)
     {
     }
     blend_function_t blend;
+    blend_rows_t blend_rows;
+    const blend_kernels_t *kernels;
 };
 
 } // namespace
 
+#ifndef BLEND_TEST
 /**
  * It blends 2 picture together.
  */
@@ -671,13 +1596,16 @@ static void Blend(filter_t *filter,
     video_format_FixRgb(&filter->fmt_out.video);
     video_format_FixRgb(&filter->fmt_in.video);
 
-    sys->blend(CPicture(dst, &filter->fmt_out.video,
-                        filter->fmt_out.video.i_x_offset + x_offset,
-                        filter->fmt_out.video.i_y_offset + y_offset),
-               CPicture(src, &filter->fmt_in.video,
-                        filter->fmt_in.video.i_x_offset,
-                        filter->fmt_in.video.i_y_offset),
-               width, height, alpha);
+    const CPicture dst_data(dst, &filter->fmt_out.video,
+                            filter->fmt_out.video.i_x_offset + x_offset,
+                            filter->fmt_out.video.i_y_offset + y_offset);
+    const CPicture src_data(src, &filter->fmt_in.video,
+                            filter->fmt_in.video.i_x_offset,
+                            filter->fmt_in.video.i_y_offset);
+    if (sys->blend_rows)
+        sys->blend_rows(sys->kernels, dst_data, src_data, width, height, alpha);
+    else
+        sys->blend(dst_data, src_data, width, height, alpha);
 }
 
 static int Open(vlc_object_t *object)
@@ -699,6 +1627,24 @@ static int Open(vlc_object_t *object)
         return VLC_EGENERIC;
     }
 
+    char *kernel = var_InheritString(filter, "blend-kernel");
+    if (kernel == NULL || strcmp(kernel, "none")) {
+        sys->kernels = GetKernels(kernel ? kernel : "any");
+        if (!sys->kernels) {
+            msg_Err(filter, "%s blending kernels not available", kernel);
+            free(kernel);
+            delete sys;
+            return VLC_EGENERIC;
+        }
+        for (size_t i = 0; i < ARRAY_SIZE(rows_blends); i++) {
+            if (rows_blends[i].src == src && rows_blends[i].dst == dst)
+                sys->blend_rows = rows_blends[i].blend;
+        }
+        if (sys->blend_rows)
+            msg_Dbg(filter, "using %s blending kernels", sys->kernels->name);
+    }
+    free(kernel);
+
     filter->pf_video_blend = Blend;
     filter->p_sys          = sys;
     return VLC_SUCCESS;
@@ -711,3 +1657,177 @@ static void Close(vlc_object_t *object)
     delete p_sys;
 }
 
+#else
+/*****************************************************************************
+ * Test: the row kernels must blend exactly like the per pixel templates
+ *****************************************************************************/
+#include <stdio.h>
+#include <unistd.h>
+
+namespace {
+
+struct blend_test_t {
+    vlc_fourcc_t dst;
+    vlc_fourcc_t src;
+    uint32_t     rmask, gmask, bmask; /* of RGB32 */
+};
+
+} // namespace
+
+static const blend_test_t tests[] = {
+    { VLC_CODEC_I420,  VLC_CODEC_YUVA, 0, 0, 0 },
+    { VLC_CODEC_I420,  VLC_CODEC_RGBA, 0, 0, 0 },
+    { VLC_CODEC_YV12,  VLC_CODEC_YUVA, 0, 0, 0 },
+    { VLC_CODEC_NV12,  VLC_CODEC_YUVA, 0, 0, 0 },
+    { VLC_CODEC_NV12,  VLC_CODEC_RGBA, 0, 0, 0 },
+    { VLC_CODEC_NV21,  VLC_CODEC_YUVA, 0, 0, 0 },
+#ifndef WORDS_BIGENDIAN
+    { VLC_CODEC_P010,  VLC_CODEC_YUVA, 0, 0, 0 },
+    { VLC_CODEC_P010,  VLC_CODEC_RGBA, 0, 0, 0 },
+#endif
+    { VLC_CODEC_RGB32, VLC_CODEC_RGBA, 0xff0000, 0xff00, 0xff },
+    { VLC_CODEC_RGB32, VLC_CODEC_RGBA, 0xff, 0xff00, 0xff0000 },
+};
+
+static uint32_t Random(uint32_t *seed)
+{
+    *seed = *seed * 1103515245 + 12345;
+    return *seed >> 8;
+}
+
+static void InitFormat(video_format_t *fmt, vlc_fourcc_t chroma,
+                       unsigned width, unsigned height, unsigned x, unsigned y)
+{
+    video_format_Init(fmt, chroma);
+    fmt->i_width  = x + width;
+    fmt->i_height = y + height;
+    fmt->i_x_offset = x;
+    fmt->i_y_offset = y;
+    fmt->i_visible_width  = width;
+    fmt->i_visible_height = height;
+    fmt->i_sar_num = fmt->i_sar_den = 1;
+}
+
+static void Fill(picture_t *pic, uint32_t *seed)
+{
+    for (int i = 0; i < pic->i_planes; i++) {
+        const plane_t *p = &pic->p[i];
+        for (int j = 0; j < p->i_lines * p->i_pitch; j++)
+            p->p_pixels[j] = Random(seed);
+    }
+}
+
+/* Runs of transparent, opaque and random alpha, longer than the vectors,
+ * and fully transparent rows */
+static void FillAlpha(picture_t *pic, uint32_t *seed)
+{
+    const bool rgba = pic->format.i_chroma == VLC_CODEC_RGBA;
+    const plane_t *p = &pic->p[rgba ? 0 : 3];
+    const unsigned step = rgba ? 4 : 1;
+
+    for (int y = 0; y < p->i_lines; y++) {
+        uint8_t *a = &p->p_pixels[y * p->i_pitch + (rgba ? 3 : 0)];
+        unsigned mode = 0;
+
+        for (unsigned x = 0; x < p->i_pitch / step; x++) {
+            if (x % 71 == 0)
+                mode = y % 4 == 1 ? 0 : Random(seed) % 4;
+            const uint8_t r = Random(seed);
+            switch (mode) {
+            case 0:
+                a[x * step] = 0;
+                break;
+            case 1:
+                a[x * step] = 255;
+                break;
+            case 2:
+                a[x * step] = r;
+                break;
+            default:
+                a[x * step] = r & 1 ? r : 0;
+            }
+        }
+    }
+}
+
+static void Test(const blend_kernels_t *k, const blend_test_t *t, int alpha,
+                 uint32_t seed)
+{
+    blend_function_t blend = NULL;
+    blend_rows_t blend_rows = NULL;
+
+    for (size_t i = 0; i < ARRAY_SIZE(blends); i++) {
+        if (blends[i].src == t->src && blends[i].dst == t->dst)
+            blend = blends[i].blend;
+    }
+    for (size_t i = 0; i < ARRAY_SIZE(rows_blends); i++) {
+        if (rows_blends[i].src == t->src && rows_blends[i].dst == t->dst)
+            blend_rows = rows_blends[i].blend;
+    }
+    assert(blend != NULL && blend_rows != NULL);
+
+    /* Odd sizes and offsets, over more than 2 chunks */
+    const unsigned width = 2 * BLEND_CHUNK + 19, height = 9;
+    video_format_t src_fmt, dst_fmt;
+
+    InitFormat(&src_fmt, t->src, width, height, 1, 1);
+    InitFormat(&dst_fmt, t->dst, width + 8, height + 8, 3, 2);
+    dst_fmt.i_rmask = t->rmask;
+    dst_fmt.i_gmask = t->gmask;
+    dst_fmt.i_bmask = t->bmask;
+    video_format_FixRgb(&dst_fmt);
+
+    picture_t *src = picture_NewFromFormat(&src_fmt);
+    picture_t *ref = picture_NewFromFormat(&dst_fmt);
+    picture_t *out = picture_NewFromFormat(&dst_fmt);
+    assert(src != NULL && ref != NULL && out != NULL);
+
+    Fill(src, &seed);
+    FillAlpha(src, &seed);
+    Fill(ref, &seed);
+    for (int i = 0; i < ref->i_planes; i++)
+        memcpy(out->p[i].p_pixels, ref->p[i].p_pixels,
+               ref->p[i].i_lines * ref->p[i].i_pitch);
+
+    const CPicture src_data(src, &src_fmt, src_fmt.i_x_offset,
+                            src_fmt.i_y_offset);
+    for (unsigned dy = 0; dy < 2; dy++) {
+        for (unsigned dx = 0; dx < 2; dx++) {
+            const unsigned x = dst_fmt.i_x_offset + dx;
+            const unsigned y = dst_fmt.i_y_offset + dy;
+
+            blend(CPicture(ref, &dst_fmt, x, y), src_data, width, height, alpha);
+            blend_rows(k, CPicture(out, &dst_fmt, x, y), src_data,
+                       width, height, alpha);
+            for (int i = 0; i < ref->i_planes; i++)
+                assert(!memcmp(out->p[i].p_pixels, ref->p[i].p_pixels,
+                               ref->p[i].i_lines * ref->p[i].i_pitch));
+        }
+    }
+
+    picture_Release(out);
+    picture_Release(ref);
+    picture_Release(src);
+}
+
+int main(void)
+{
+    static const char *const names[] = { "c", "sse4.1", "avx2", "neon" };
+    static const int alphas[] = { 255, 128, 1 };
+
+    alarm(30);
+
+    for (size_t n = 0; n < ARRAY_SIZE(names); n++) {
+        const blend_kernels_t *k = GetKernels(names[n]);
+        if (k == NULL) {
+            fprintf(stderr, "WARNING: could not test %s\n", names[n]);
+            continue;
+        }
+
+        for (size_t i = 0; i < ARRAY_SIZE(tests); i++)
+            for (size_t j = 0; j < ARRAY_SIZE(alphas); j++)
+                Test(k, &tests[i], alphas[j], i * ARRAY_SIZE(alphas) + j + 1);
+    }
+    return 0;
+}
+#endif
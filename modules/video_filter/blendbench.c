@@ -223,30 +223,25 @@ static void Destroy( vlc_object_t *p_this )
 }
 
 /*****************************************************************************
- * Render: displays previously rendered output
+ * Bench: blends the images with the given kernels of the blend module
  *****************************************************************************/
-static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+static int Bench( filter_t *p_filter, const char *psz_kernel, vlc_tick_t *p_time )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
     filter_t *p_blend;
 
-    if( p_sys->b_done )
-        return p_pic;
-
     p_blend = vlc_object_create( p_filter, sizeof(filter_t) );
     if( !p_blend )
-    {
-        picture_Release( p_pic );
-        return NULL;
-    }
+        return VLC_ENOMEM;
+    var_Create( p_blend, "blend-kernel", VLC_VAR_STRING );
+    var_SetString( p_blend, "blend-kernel", psz_kernel );
     p_blend->fmt_out.video = p_sys->p_base_image->format;
     p_blend->fmt_in.video = p_sys->p_blend_image->format;
     p_blend->p_module = module_need( p_blend, "video blending", NULL, false );
     if( !p_blend->p_module )
     {
-        picture_Release( p_pic );
         vlc_object_delete(p_blend);
-        return NULL;
+        return VLC_EGENERIC;
     }
 
     vlc_tick_t time = vlc_tick_now();
@@ -256,19 +251,54 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
                                  p_sys->p_base_image, p_sys->p_blend_image,
                                  0, 0, p_sys->i_alpha );
     }
-    time = vlc_tick_now() - time;
-
-    msg_Info( p_filter, "Blended %d images in %f sec", p_sys->i_loops,
-              secf_from_vlc_tick(time) );
-    msg_Info( p_filter, "Speed is: %f images/second, %f pixels/second",
-              (float) p_sys->i_loops / time * CLOCK_FREQ,
-              (float) p_sys->i_loops / time * CLOCK_FREQ *
-                  p_sys->p_blend_image->p[Y_PLANE].i_visible_pitch *
-                  p_sys->p_blend_image->p[Y_PLANE].i_visible_lines );
+    *p_time = vlc_tick_now() - time;
 
     module_unneed( p_blend, p_blend->p_module );
 
     vlc_object_delete(p_blend);
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Render: displays previously rendered output
+ *****************************************************************************/
+static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    /* "any" is the default, "none" the per pixel blending */
+    static const char *const ppsz_kernels[] = {
+        "any", "none", "c", "sse4.1", "avx2", "neon",
+    };
+    const video_format_t *p_fmt = &p_sys->p_blend_image->format;
+    const float f_pixels = p_fmt->i_visible_width * p_fmt->i_visible_height;
+
+    if( p_sys->b_done )
+        return p_pic;
+
+    for( size_t i = 0; i < ARRAY_SIZE(ppsz_kernels); i++ )
+    {
+        vlc_tick_t time;
+        if( Bench( p_filter, ppsz_kernels[i], &time ) != VLC_SUCCESS )
+        {
+            if( i == 0 )
+            {
+                picture_Release( p_pic );
+                return NULL;
+            }
+            msg_Dbg( p_filter, "%s blending kernels not available",
+                     ppsz_kernels[i] );
+            continue;
+        }
+        if( time <= 0 )
+            time = 1;
+
+        msg_Info( p_filter, "%s: blended %d images in %f sec", ppsz_kernels[i],
+                  p_sys->i_loops, secf_from_vlc_tick(time) );
+        msg_Info( p_filter, "%s: speed is %f images/second, %f Mpixels/second",
+                  ppsz_kernels[i],
+                  (float) p_sys->i_loops / time * CLOCK_FREQ,
+                  (float) p_sys->i_loops / time * CLOCK_FREQ * f_pixels / 1e6f );
+    }
 
     p_sys->b_done = true;
     return p_pic;
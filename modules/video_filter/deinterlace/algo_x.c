@@ -33,6 +33,7 @@
 #include <vlc_common.h>
 #include <vlc_cpu.h>
 #include <vlc_picture.h>
+#include <vlc_filter.h>
 
 #include "deinterlace.h" /* filter_sys_t */
 
@@ -511,63 +512,85 @@ static inline void XDeintBand8x8MMXEXT( uint8_t *dst, int i_dst,
  * Public functions
  *****************************************************************************/
 
-int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+typedef struct
 {
-    VLC_UNUSED(p_filter);
+    picture_t *p_outpic;
+    picture_t *p_pic;
     int i_plane;
+} x_plane_t;
+
+/* Renders the 8 lines blocks of a band of a plane */
+static void RenderXSlice( filter_t *p_filter, const filter_slice_t *p_slice,
+                          void *p_data )
+{
+    VLC_UNUSED(p_filter);
+    const x_plane_t *p_plane = p_data;
+    const plane_t *p_dstp = &p_plane->p_outpic->p[p_plane->i_plane];
+    const plane_t *p_srcp = &p_plane->p_pic->p[p_plane->i_plane];
 #if defined (CAN_COMPILE_MMXEXT)
     const bool mmxext = vlc_CPU_MMXEXT();
 #endif
 
-    /* Copy image and skip lines */
-    for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
-    {
-        const int i_mby = ( p_outpic->p[i_plane].i_visible_lines + 7 )/8 - 1;
-        const int i_mbx = p_outpic->p[i_plane].i_visible_pitch/8;
+    const int i_mby = ( p_dstp->i_visible_lines + 7 )/8 - 1;
+    const int i_mbx = p_dstp->i_visible_pitch/8;
 
-        const int i_mody = p_outpic->p[i_plane].i_visible_lines - 8*i_mby;
-        const int i_modx = p_outpic->p[i_plane].i_visible_pitch - 8*i_mbx;
+    const int i_mody = p_dstp->i_visible_lines - 8*i_mby;
+    const int i_modx = p_dstp->i_visible_pitch - 8*i_mbx;
 
-        const int i_dst = p_outpic->p[i_plane].i_pitch;
-        const int i_src = p_pic->p[i_plane].i_pitch;
+    const int i_dst = p_dstp->i_pitch;
+    const int i_src = p_srcp->i_pitch;
 
-        int y, x;
+    const int i_last = __MIN( (int)p_slice->y_end/8, i_mby );
+    int y, x;
 
-        for( y = 0; y < i_mby; y++ )
-        {
-            uint8_t *dst = &p_outpic->p[i_plane].p_pixels[8*y*i_dst];
-            uint8_t *src = &p_pic->p[i_plane].p_pixels[8*y*i_src];
+    for( y = p_slice->y_start/8; y < i_last; y++ )
+    {
+        uint8_t *dst = &p_dstp->p_pixels[8*y*i_dst];
+        uint8_t *src = &p_srcp->p_pixels[8*y*i_src];
 
 #ifdef CAN_COMPILE_MMXEXT
-            if( mmxext )
-                XDeintBand8x8MMXEXT( dst, i_dst, src, i_src, i_mbx, i_modx );
-            else
+        if( mmxext )
+            XDeintBand8x8MMXEXT( dst, i_dst, src, i_src, i_mbx, i_modx );
+        else
 #endif
-                XDeintBand8x8C( dst, i_dst, src, i_src, i_mbx, i_modx );
-        }
-
-        /* Last line (C only)*/
-        if( i_mody )
-        {
-            uint8_t *dst = &p_outpic->p[i_plane].p_pixels[8*y*i_dst];
-            uint8_t *src = &p_pic->p[i_plane].p_pixels[8*y*i_src];
+            XDeintBand8x8C( dst, i_dst, src, i_src, i_mbx, i_modx );
+    }
 
-            for( x = 0; x < i_mbx; x++ )
-            {
-                XDeintNxN( dst, i_dst, src, i_src, 8, i_mody );
+    /* Last line (C only)*/
+    if( i_mody && p_slice->y_end == (unsigned)p_dstp->i_visible_lines )
+    {
+        uint8_t *dst = &p_dstp->p_pixels[8*y*i_dst];
+        uint8_t *src = &p_srcp->p_pixels[8*y*i_src];
 
-                dst += 8;
-                src += 8;
-            }
+        for( x = 0; x < i_mbx; x++ )
+        {
+            XDeintNxN( dst, i_dst, src, i_src, 8, i_mody );
 
-            if( i_modx )
-                XDeintNxN( dst, i_dst, src, i_src, i_modx, i_mody );
+            dst += 8;
+            src += 8;
         }
+
+        if( i_modx )
+            XDeintNxN( dst, i_dst, src, i_src, i_modx, i_mody );
     }
 
 #ifdef CAN_COMPILE_MMXEXT
     if( mmxext )
         emms();
 #endif
+}
+
+int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+{
+    /* Copy image and skip lines */
+    for( int i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
+    {
+        x_plane_t plane = {
+            .p_outpic = p_outpic, .p_pic = p_pic, .i_plane = i_plane,
+        };
+        /* Blocks read up to 2 lines below them */
+        filter_RunSlices( p_filter, p_outpic->p[i_plane].i_visible_lines,
+                          8, 2, RenderXSlice, &plane );
+    }
     return VLC_SUCCESS;
 }
@@ -25,6 +25,10 @@
 #   include "config.h"
 #endif
 
+#ifdef DEINTERLACE_TEST
+# undef NDEBUG
+#endif
+
 #include <stdint.h>
 #include <assert.h>
 
@@ -46,6 +50,108 @@
    Necessary preprocessor macros are defined in common.h. */
 #include "yadif.h"
 
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+# define YADIF_AVX2 __attribute__ ((__target__ ("avx2")))
+
+# define YADIF_BITS 8
+# include "yadif_avx2.h"
+# undef YADIF_BITS
+# define YADIF_BITS 16
+# include "yadif_avx2.h"
+# undef YADIF_BITS
+#endif
+
+yadif_line_t YadifGetLine( const char *psz_kernel, unsigned pixel_size )
+{
+    const bool b_any = !strcmp( psz_kernel, "any" );
+
+#ifdef HAVE_AVX2_INTRINSICS
+    if( ( b_any || !strcmp( psz_kernel, "avx2" ) ) && vlc_CPU_AVX2() )
+        return pixel_size == 1 ? yadif_filter_line_avx2
+                               : yadif_filter_line_avx2_16bit;
+#endif
+    /* There are no older SIMD versions for 16-bit pixels */
+    if( pixel_size == 2 )
+        return b_any || !strcmp( psz_kernel, "c" ) ? yadif_filter_line_c_16bit
+                                                   : NULL;
+
+#if defined(HAVE_X86ASM)
+    if( ( b_any || !strcmp( psz_kernel, "ssse3" ) ) && vlc_CPU_SSSE3() )
+        return vlcpriv_yadif_filter_line_ssse3;
+    if( ( b_any || !strcmp( psz_kernel, "sse2" ) ) && vlc_CPU_SSE2() )
+        return vlcpriv_yadif_filter_line_sse2;
+#if defined(__i386__)
+    if( b_any && vlc_CPU_MMXEXT() )
+        return vlcpriv_yadif_filter_line_mmxext;
+#endif
+#endif
+    return b_any || !strcmp( psz_kernel, "c" ) ? yadif_filter_line_c : NULL;
+}
+
+#ifndef DEINTERLACE_TEST
+typedef struct
+{
+    yadif_line_t filter;
+    unsigned pixel_size;
+    const plane_t *prevp;
+    const plane_t *curp;
+    const plane_t *nextp;
+    plane_t *dstp;
+    int i_field;
+    int yadif_parity;
+} yadif_plane_t;
+
+static void RenderYadifSlice( filter_t *p_filter, const filter_slice_t *p_slice,
+                              void *p_data )
+{
+    VLC_UNUSED(p_filter);
+    const yadif_plane_t *p_plane = p_data;
+    const plane_t *prevp = p_plane->prevp;
+    const plane_t *curp  = p_plane->curp;
+    const plane_t *nextp = p_plane->nextp;
+    plane_t *dstp        = p_plane->dstp;
+    const int i_field      = p_plane->i_field;
+    const int yadif_parity = p_plane->yadif_parity;
+
+    const int y_end = __MIN( (int)p_slice->y_end, dstp->i_visible_lines - 1 );
+    for( int y = __MAX( (int)p_slice->y_start, 1 ); y < y_end; y++ )
+    {
+        if( (y % 2) == i_field  ||  yadif_parity == 2 )
+        {
+            memcpy( &dstp->p_pixels[y * dstp->i_pitch],
+                        &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
+        }
+        else
+        {
+            int mode;
+            /* Spatial checks only when enough data */
+            mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
+
+            assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
+            p_plane->filter( &dstp->p_pixels[y * dstp->i_pitch],
+                    &prevp->p_pixels[y * prevp->i_pitch],
+                    &curp->p_pixels[y * curp->i_pitch],
+                    &nextp->p_pixels[y * nextp->i_pitch],
+                    dstp->i_visible_pitch / p_plane->pixel_size,
+                    y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
+                    y  - 1  ?  -curp->i_pitch : curp->i_pitch,
+                    yadif_parity,
+                    mode );
+        }
+
+        /* We duplicate the first and last lines */
+        if( y == 1 )
+            memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
+                       &dstp->p_pixels[ y    * dstp->i_pitch],
+                       dstp->i_pitch);
+        else if( y == dstp->i_visible_lines - 2 )
+            memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
+                       &dstp->p_pixels[ y    * dstp->i_pitch],
+                       dstp->i_pitch);
+    }
+}
+
 int RenderYadifSingle( filter_t *p_filter, picture_t *p_dst, picture_t *p_src )
 {
     return RenderYadif( p_filter, p_dst, p_src, 0, 0 );
@@ -108,70 +214,18 @@ int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
     /* Filter if we have all the pictures we need */
     if( p_prev && p_cur && p_next )
     {
-        /* */
-        void (*filter)(uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next,
-                       int w, int prefs, int mrefs, int parity, int mode);
-
-#if defined(HAVE_X86ASM)
-        if( vlc_CPU_SSSE3() )
-            filter = vlcpriv_yadif_filter_line_ssse3;
-        else
-        if( vlc_CPU_SSE2() )
-            filter = vlcpriv_yadif_filter_line_sse2;
-        else
-#if defined(__i386__)
-        if( vlc_CPU_MMXEXT() )
-            filter = vlcpriv_yadif_filter_line_mmxext;
-        else
-#endif
-#endif
-            filter = yadif_filter_line_c;
-
-        if( p_sys->chroma->pixel_size == 2 )
-            filter = yadif_filter_line_c_16bit;
-
         for( int n = 0; n < p_dst->i_planes; n++ )
         {
-            const plane_t *prevp = &p_prev->p[n];
-            const plane_t *curp  = &p_cur->p[n];
-            const plane_t *nextp = &p_next->p[n];
-            plane_t *dstp        = &p_dst->p[n];
-
-            for( int y = 1; y < dstp->i_visible_lines - 1; y++ )
-            {
-                if( (y % 2) == i_field  ||  yadif_parity == 2 )
-                {
-                    memcpy( &dstp->p_pixels[y * dstp->i_pitch],
-                                &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
-                }
-                else
-                {
-                    int mode;
-                    /* Spatial checks only when enough data */
-                    mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
-
-                    assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
-                    filter( &dstp->p_pixels[y * dstp->i_pitch],
-                            &prevp->p_pixels[y * prevp->i_pitch],
-                            &curp->p_pixels[y * curp->i_pitch],
-                            &nextp->p_pixels[y * nextp->i_pitch],
-                            dstp->i_visible_pitch,
-                            y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
-                            y  - 1  ?  -curp->i_pitch : curp->i_pitch,
-                            yadif_parity,
-                            mode );
-                }
-
-                /* We duplicate the first and last lines */
-                if( y == 1 )
-                    memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-                else if( y == dstp->i_visible_lines - 2 )
-                    memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-            }
+            yadif_plane_t plane = {
+                .filter = p_sys->pf_yadif_line,
+                .pixel_size = p_sys->chroma->pixel_size,
+                .prevp = &p_prev->p[n], .curp = &p_cur->p[n],
+                .nextp = &p_next->p[n], .dstp = &p_dst->p[n],
+                .i_field = i_field, .yadif_parity = yadif_parity,
+            };
+            /* Lines are interpolated from the 2 lines above and below */
+            filter_RunSlices( p_filter, p_dst->p[n].i_visible_lines, 2, 2,
+                              RenderYadifSlice, &plane );
         }
 
         p_sys->context.i_frame_offset = 1; /* p_cur will be rendered at next frame, too */
@@ -194,3 +248,141 @@ int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
         return VLC_EGENERIC;
     }
 }
+#else
+/*****************************************************************************
+ * Test: the SIMD line filters must match the C ones
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "merge.h"
+
+#define TEST_PAD 8 /* pixels read around the line by the filters */
+
+static uint32_t Random(uint32_t *seed)
+{
+    *seed = *seed * 1103515245 + 12345;
+    return *seed >> 8;
+}
+
+/* Fills 5 lines, the filtered one in the middle, with noise of the given
+ * depth, with smooth areas so that all the spatial checks get exercised */
+static void Fill(uint8_t *buf, size_t size, unsigned pixel_size,
+                 unsigned depth, uint32_t *seed)
+{
+    const unsigned max = (1u << depth) - 1;
+    unsigned v = Random(seed) & max;
+
+    for (size_t i = 0; i < size; i += pixel_size)
+    {
+        if (Random(seed) % 4 == 0)
+            v = Random(seed) & max;
+        else
+            v = (v + Random(seed) % 5) & max;
+
+        if (pixel_size == 2)
+        {
+            uint16_t w = v;
+            memcpy(&buf[i], &w, 2);
+        }
+        else
+            buf[i] = v;
+    }
+}
+
+static void TestYadif(const char *kernel, unsigned pixel_size,
+                      unsigned depth)
+{
+    yadif_line_t simd = YadifGetLine(kernel, pixel_size);
+    yadif_line_t ref = YadifGetLine("c", pixel_size);
+
+    if (simd == NULL)
+    {
+        fprintf(stderr, "WARNING: could not test %s (%u-bit)\n",
+                kernel, depth);
+        return;
+    }
+    assert(ref != NULL);
+
+    uint32_t seed = depth;
+
+    for (int w = 1; w <= 75; w++)
+    {
+        const size_t pitch = (w + 2 * TEST_PAD) * pixel_size;
+        const size_t size = 5 * pitch;
+        const size_t offset = 2 * pitch + TEST_PAD * pixel_size;
+        uint8_t *planes = malloc(3 * size);
+        uint8_t *dst = malloc(2 * w * pixel_size);
+        assert(planes != NULL && dst != NULL);
+
+        for (int parity = 0; parity < 2; parity++)
+            for (int mode = 0; mode <= 2; mode += 2)
+            {
+                Fill(planes, 3 * size, pixel_size, depth, &seed);
+
+                uint8_t *prev = planes + offset;
+                uint8_t *cur = prev + size;
+                uint8_t *next = cur + size;
+
+                ref(dst, prev, cur, next, w, pitch, -(int)pitch,
+                    parity, mode);
+                simd(dst + w * pixel_size, prev, cur, next, w, pitch,
+                     -(int)pitch, parity, mode);
+                if (memcmp(dst, dst + w * pixel_size, w * pixel_size))
+                {
+                    fprintf(stderr, "%s yadif (%u-bit) differs from C: "
+                            "width %d, parity %d, mode %d\n", kernel, depth,
+                            w, parity, mode);
+                    abort();
+                }
+            }
+
+        free(dst);
+        free(planes);
+    }
+}
+
+static void TestMerge(const char *name, void (*simd)(void *, const void *,
+                                                     const void *, size_t),
+                      void (*ref)(void *, const void *, const void *, size_t))
+{
+    uint32_t seed = 1;
+    uint8_t s1[256], s2[256], dst[2][256];
+
+    for (size_t bytes = 0; bytes <= sizeof (s1); bytes += 2)
+    {
+        Fill(s1, sizeof (s1), 1, 8, &seed);
+        Fill(s2, sizeof (s2), 1, 8, &seed);
+        memset(dst, 0, sizeof (dst));
+
+        ref(dst[0], s1, s2, bytes);
+        simd(dst[1], s1, s2, bytes);
+        if (memcmp(dst[0], dst[1], sizeof (dst[0])))
+        {
+            fprintf(stderr, "%s differs from C: %zu bytes\n", name, bytes);
+            abort();
+        }
+    }
+}
+
+int main(void)
+{
+    alarm(30);
+
+    TestYadif("avx2", 1, 8);
+    TestYadif("avx2", 2, 10);
+    TestYadif("avx2", 2, 16);
+
+#ifdef HAVE_AVX2_INTRINSICS
+    if (vlc_CPU_AVX2())
+    {
+        TestMerge("Merge8BitAVX2", Merge8BitAVX2, Merge8BitGeneric);
+        TestMerge("Merge16BitAVX2", Merge16BitAVX2, Merge16BitGeneric);
+    }
+    else
+#endif
+        fprintf(stderr, "WARNING: could not test %s\n", "Merge*BitAVX2");
+    return 0;
+}
+#endif
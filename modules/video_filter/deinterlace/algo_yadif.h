@@ -34,6 +34,11 @@
 struct filter_t;
 struct picture_t;
 
+/** Filters a line of the interpolated field, see yadif.h */
+typedef void (*yadif_line_t)( uint8_t *dst, uint8_t *prev, uint8_t *cur,
+                              uint8_t *next, int w, int prefs, int mrefs,
+                              int parity, int mode );
+
 /*****************************************************************************
  * Functions
  *****************************************************************************/
@@ -90,4 +95,14 @@ int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
  */
 int RenderYadifSingle( filter_t *p_filter, picture_t *p_dst, picture_t *p_src );
 
+/**
+ * Selects the Yadif line filtering routine.
+ *
+ * @param psz_kernel "any" for the fastest available routine; "c", "sse2",
+ *                   "ssse3" or "avx2" to force one, for benchmarking.
+ * @param pixel_size Size of the pixels in bytes, 1 or 2.
+ * @return The routine, or NULL if the requested one is not available.
+ */
+yadif_line_t YadifGetLine( const char *psz_kernel, unsigned pixel_size );
+
 #endif
@@ -294,6 +294,10 @@ static void Close( vlc_object_t *p_this );
                                     "in the Phosphor framerate doubler. "\
                                     "Default: Low.")
 
+#define KERNEL_TEXT N_("Deinterlacing kernels")
+#define KERNEL_LONGTEXT N_("Merge and Yadif line routines, for " \
+                           "benchmarking: any, c, sse2, ssse3 or avx2.")
+
 vlc_module_begin ()
     set_description( N_("Deinterlacing video filter") )
     set_shortname( N_("Deinterlace" ))
@@ -313,6 +317,9 @@ vlc_module_begin ()
                 PHOSPHOR_DIMMER_LONGTEXT, true )
         change_integer_list( phosphor_dimmer_list, phosphor_dimmer_list_text )
         change_safe ()
+    add_string( "deinterlace-kernel", "any", KERNEL_TEXT, KERNEL_LONGTEXT,
+                true )
+        change_private ()
     add_shortcut( "deinterlace" )
     set_callbacks( Open, Close )
 vlc_module_end ()
@@ -483,60 +490,64 @@ int Mouse( filter_t *p_filter,
 
 
 /*****************************************************************************
- * Open
+ * SetKernels: select the merge and Yadif line routines
  *****************************************************************************/
 
-int Open( vlc_object_t *p_this )
+/**
+ * Selects the merge and Yadif line routines.
+ *
+ * "any" selects the fastest available ones. The other values of the private
+ * "deinterlace-kernel" option force an instruction set, for benchmarking.
+ *
+ * @param p_filter The filter instance.
+ * @param psz_kernel "any", "c", "sse2", "ssse3" or "avx2".
+ * @param pixel_size Size of the pixels in bytes, 1 or 2.
+ * @retval VLC_SUCCESS All ok.
+ * @retval VLC_EGENERIC The requested routines are not available.
+ */
+static int SetKernels( filter_t *p_filter, const char *psz_kernel,
+                       unsigned pixel_size )
 {
-    filter_t *p_filter = (filter_t*)p_this;
-    filter_sys_t *p_sys;
+    filter_sys_t *p_sys = p_filter->p_sys;
 
-    const vlc_fourcc_t fourcc = p_filter->fmt_in.video.i_chroma;
-    const vlc_chroma_description_t *chroma = vlc_fourcc_GetChromaDescription( fourcc );
-    if( chroma == NULL || chroma->pixel_size > 2 )
-    {
-notsupp:
-        msg_Dbg( p_filter, "unsupported chroma %4.4s", (char*)&fourcc );
-        return VLC_EGENERIC;
-    }
+    p_sys->pf_yadif_line = YadifGetLine( psz_kernel, pixel_size );
+#if defined(__i386__) || defined(__x86_64__)
+    p_sys->pf_end_merge = NULL;
+#endif
 
-    unsigned pixel_size = chroma->pixel_size;
-    bool packed = false;
-    if( chroma->plane_count != 3 )
+    if( strcmp( psz_kernel, "any" ) )
     {
-        packed = true;
-        switch( fourcc )
+        p_sys->pf_merge = NULL;
+        if( !strcmp( psz_kernel, "c" ) )
+            p_sys->pf_merge = pixel_size == 1 ? Merge8BitGeneric
+                                              : Merge16BitGeneric;
+#if defined(HAVE_AVX2_INTRINSICS)
+        else if( !strcmp( psz_kernel, "avx2" ) && vlc_CPU_AVX2() )
+            p_sys->pf_merge = pixel_size == 1 ? Merge8BitAVX2 : Merge16BitAVX2;
+#endif
+#if defined(CAN_COMPILE_SSE2)
+        else if( ( !strcmp( psz_kernel, "sse2" ) ||
+                   !strcmp( psz_kernel, "ssse3" ) ) && vlc_CPU_SSE2() )
         {
-            case VLC_CODEC_YUYV:
-            case VLC_CODEC_UYVY:
-            case VLC_CODEC_YVYU:
-            case VLC_CODEC_VYUY:
-            case VLC_CODEC_NV12:
-            case VLC_CODEC_NV21:
-                pixel_size = 1;
-                break;
-            default:
-                goto notsupp;
+            p_sys->pf_merge = pixel_size == 1 ? Merge8BitSSE2 : Merge16BitSSE2;
+            p_sys->pf_end_merge = EndMMX;
         }
+#endif
+        if( p_sys->pf_merge == NULL || p_sys->pf_yadif_line == NULL )
+        {
+            msg_Err( p_filter, "%s deinterlacing kernels not available",
+                     psz_kernel );
+            return VLC_EGENERIC;
+        }
+        msg_Dbg( p_filter, "using %s deinterlacing kernels", psz_kernel );
+        return VLC_SUCCESS;
     }
-    assert( vlc_fourcc_IsYUV( fourcc ) );
-
-    /* */
-    p_sys = p_filter->p_sys = malloc( sizeof( *p_sys ) );
-    if( !p_sys )
-        return VLC_ENOMEM;
-
-    p_sys->chroma = chroma;
-
-    InitDeinterlacingContext( &p_sys->context );
-
-    config_ChainParse( p_filter, FILTER_CFG_PREFIX, ppsz_filter_options,
-                       p_filter->p_cfg );
-    char *psz_mode = var_InheritString( p_filter, FILTER_CFG_PREFIX "mode" );
-    SetFilterMethod( p_filter, psz_mode, packed );
-
-    IVTCClearState( p_filter );
 
+#if defined(HAVE_AVX2_INTRINSICS)
+    if( vlc_CPU_AVX2() )
+        p_sys->pf_merge = pixel_size == 1 ? Merge8BitAVX2 : Merge16BitAVX2;
+    else
+#endif
 #if defined(CAN_COMPILE_C_ALTIVEC)
     if( pixel_size == 1 && vlc_CPU_ALTIVEC() )
         p_sys->pf_merge = MergeAltivec;
@@ -586,9 +597,74 @@ notsupp:
 #endif
     {
         p_sys->pf_merge = pixel_size == 1 ? Merge8BitGeneric : Merge16BitGeneric;
-#if defined(__i386__) || defined(__x86_64__)
-        p_sys->pf_end_merge = NULL;
-#endif
+    }
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Open
+ *****************************************************************************/
+
+int Open( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t*)p_this;
+    filter_sys_t *p_sys;
+
+    const vlc_fourcc_t fourcc = p_filter->fmt_in.video.i_chroma;
+    const vlc_chroma_description_t *chroma = vlc_fourcc_GetChromaDescription( fourcc );
+    if( chroma == NULL || chroma->pixel_size > 2 )
+    {
+notsupp:
+        msg_Dbg( p_filter, "unsupported chroma %4.4s", (char*)&fourcc );
+        return VLC_EGENERIC;
+    }
+
+    unsigned pixel_size = chroma->pixel_size;
+    bool packed = false;
+    if( chroma->plane_count != 3 )
+    {
+        packed = true;
+        switch( fourcc )
+        {
+            case VLC_CODEC_YUYV:
+            case VLC_CODEC_UYVY:
+            case VLC_CODEC_YVYU:
+            case VLC_CODEC_VYUY:
+            case VLC_CODEC_NV12:
+            case VLC_CODEC_NV21:
+                pixel_size = 1;
+                break;
+            default:
+                goto notsupp;
+        }
+    }
+    assert( vlc_fourcc_IsYUV( fourcc ) );
+
+    /* */
+    p_sys = p_filter->p_sys = malloc( sizeof( *p_sys ) );
+    if( !p_sys )
+        return VLC_ENOMEM;
+
+    p_sys->chroma = chroma;
+
+    InitDeinterlacingContext( &p_sys->context );
+
+    config_ChainParse( p_filter, FILTER_CFG_PREFIX, ppsz_filter_options,
+                       p_filter->p_cfg );
+    char *psz_mode = var_InheritString( p_filter, FILTER_CFG_PREFIX "mode" );
+    SetFilterMethod( p_filter, psz_mode, packed );
+
+    IVTCClearState( p_filter );
+
+    char *psz_kernel = var_InheritString( p_filter, "deinterlace-kernel" );
+    int i_ret = SetKernels( p_filter, psz_kernel ? psz_kernel : "any",
+                            pixel_size );
+    free( psz_kernel );
+    if( i_ret != VLC_SUCCESS )
+    {
+        free( psz_mode );
+        free( p_sys );
+        return i_ret;
     }
 
     /* */
@@ -74,6 +74,8 @@ typedef struct
     /** Merge finalization routine for SSE */
     void (*pf_end_merge) ( void );
 #endif
+    /** Yadif line routine: C, SSE2, SSSE3, AVX2, ... */
+    yadif_line_t pf_yadif_line;
 
     struct deinterlace_ctx   context;
 
@@ -156,6 +156,10 @@ void Merge8BitSSE2( void *, const void *, const void *, size_t );
  */
 void Merge16BitSSE2( void *, const void *, const void *, size_t );
 #endif
+#if defined(HAVE_AVX2_INTRINSICS)
+void Merge8BitAVX2( void *, const void *, const void *, size_t );
+void Merge16BitAVX2( void *, const void *, const void *, size_t );
+#endif
 
 #if defined(CAN_COMPILE_ARM)
 /**
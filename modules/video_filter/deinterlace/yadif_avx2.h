@@ -0,0 +1,152 @@
+/*****************************************************************************
+ * yadif_avx2.h : AVX2 Yadif line filter for the VLC deinterlacer
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* This file is included by algo_yadif.c once per pixel size, with
+ * YADIF_BITS set to 8 or 16. It implements the FILTER macro of yadif.h,
+ * bit-exactly, on pixels widened to 16-bit (resp. 32-bit) lanes, so that
+ * the spatial scores cannot overflow. */
+
+#if YADIF_BITS == 8
+# define yadif_pixel_t uint8_t
+# define YADIF_STEP 16
+# define YADIF_OP(op) _mm256_##op##_epi16
+# define YADIF_LOAD(p) \
+    _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(p)))
+# define YADIF_STORE(p, v) \
+    _mm_storeu_si128((__m128i *)(p), _mm256_castsi256_si128( \
+        _mm256_permute4x64_epi64(_mm256_packus_epi16(v, v), 0xD8)))
+# define YADIF_LINE   yadif_filter_line_avx2
+# define YADIF_LINE_C yadif_filter_line_c
+#else
+# define yadif_pixel_t uint16_t
+# define YADIF_STEP 8
+# define YADIF_OP(op) _mm256_##op##_epi32
+# define YADIF_LOAD(p) \
+    _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(p)))
+# define YADIF_STORE(p, v) \
+    _mm_storeu_si128((__m128i *)(p), _mm256_castsi256_si128( \
+        _mm256_permute4x64_epi64(_mm256_packus_epi32(v, v), 0xD8)))
+# define YADIF_LINE   yadif_filter_line_avx2_16bit
+# define YADIF_LINE_C yadif_filter_line_c_16bit
+#endif
+
+/* Lets the spatial prediction from the (j) direction win if it scores
+ * better, for the lanes enabled in the mask */
+#define YADIF_CHECK(mask, j) \
+    do { \
+        __m256i score = YADIF_OP(add)(YADIF_OP(add)( \
+            YADIF_OP(abs)(YADIF_OP(sub)(M((j)-1), P(-1-(j)))), \
+            YADIF_OP(abs)(YADIF_OP(sub)(M(j), P(-(j))))), \
+            YADIF_OP(abs)(YADIF_OP(sub)(M((j)+1), P(1-(j))))); \
+        mask = _mm256_and_si256(mask, YADIF_OP(cmpgt)(spatial_score, score)); \
+        spatial_score = _mm256_blendv_epi8(spatial_score, score, mask); \
+        spatial_pred = _mm256_blendv_epi8(spatial_pred, \
+            YADIF_OP(srai)(YADIF_OP(add)(M(j), P(-(j))), 1), mask); \
+    } while (0)
+
+YADIF_AVX2
+static void YADIF_LINE(uint8_t *dst8, uint8_t *prev8, uint8_t *cur8,
+                       uint8_t *next8, int w, int prefs, int mrefs,
+                       int parity, int mode)
+{
+    yadif_pixel_t *dst  = (yadif_pixel_t *)dst8;
+    yadif_pixel_t *prev = (yadif_pixel_t *)prev8;
+    yadif_pixel_t *cur  = (yadif_pixel_t *)cur8;
+    yadif_pixel_t *next = (yadif_pixel_t *)next8;
+    yadif_pixel_t *prev2 = parity ? prev : cur;
+    yadif_pixel_t *next2 = parity ? cur  : next;
+    const int p = prefs / (int)sizeof(yadif_pixel_t);
+    const int m = mrefs / (int)sizeof(yadif_pixel_t);
+    const __m256i all = _mm256_set1_epi8(-1);
+    const __m256i one = YADIF_OP(set1)(1);
+    int x;
+
+#define M(k) YADIF_LOAD(&cur[x + m + (k)])
+#define P(k) YADIF_LOAD(&cur[x + p + (k)])
+    for (x = 0; x + YADIF_STEP <= w; x += YADIF_STEP) {
+        __m256i c  = M(0);
+        __m256i e  = P(0);
+        __m256i p2 = YADIF_LOAD(&prev2[x]);
+        __m256i n2 = YADIF_LOAD(&next2[x]);
+        __m256i d  = YADIF_OP(srai)(YADIF_OP(add)(p2, n2), 1);
+
+        __m256i temporal_diff0 = YADIF_OP(abs)(YADIF_OP(sub)(p2, n2));
+        __m256i temporal_diff1 = YADIF_OP(srai)(YADIF_OP(add)(
+            YADIF_OP(abs)(YADIF_OP(sub)(YADIF_LOAD(&prev[x + m]), c)),
+            YADIF_OP(abs)(YADIF_OP(sub)(YADIF_LOAD(&prev[x + p]), e))), 1);
+        __m256i temporal_diff2 = YADIF_OP(srai)(YADIF_OP(add)(
+            YADIF_OP(abs)(YADIF_OP(sub)(YADIF_LOAD(&next[x + m]), c)),
+            YADIF_OP(abs)(YADIF_OP(sub)(YADIF_LOAD(&next[x + p]), e))), 1);
+        __m256i diff = YADIF_OP(max)(YADIF_OP(max)(
+            YADIF_OP(srai)(temporal_diff0, 1), temporal_diff1), temporal_diff2);
+
+        __m256i spatial_pred = YADIF_OP(srai)(YADIF_OP(add)(c, e), 1);
+        __m256i spatial_score = YADIF_OP(sub)(YADIF_OP(add)(YADIF_OP(add)(
+            YADIF_OP(abs)(YADIF_OP(sub)(M(-1), P(-1))),
+            YADIF_OP(abs)(YADIF_OP(sub)(c, e))),
+            YADIF_OP(abs)(YADIF_OP(sub)(M(1), P(1)))), one);
+
+        /* The second checks only run if the first ones succeeded */
+        __m256i mask = all;
+        YADIF_CHECK(mask, -1);
+        YADIF_CHECK(mask, -2);
+        mask = all;
+        YADIF_CHECK(mask, 1);
+        YADIF_CHECK(mask, 2);
+
+        if (mode < 2) {
+            __m256i b = YADIF_OP(srai)(YADIF_OP(add)(
+                YADIF_LOAD(&prev2[x + 2 * m]), YADIF_LOAD(&next2[x + 2 * m])), 1);
+            __m256i f = YADIF_OP(srai)(YADIF_OP(add)(
+                YADIF_LOAD(&prev2[x + 2 * p]), YADIF_LOAD(&next2[x + 2 * p])), 1);
+            __m256i de = YADIF_OP(sub)(d, e);
+            __m256i dc = YADIF_OP(sub)(d, c);
+            __m256i bc = YADIF_OP(sub)(b, c);
+            __m256i fe = YADIF_OP(sub)(f, e);
+            __m256i max = YADIF_OP(max)(YADIF_OP(max)(de, dc), YADIF_OP(min)(bc, fe));
+            __m256i min = YADIF_OP(min)(YADIF_OP(min)(de, dc), YADIF_OP(max)(bc, fe));
+
+            diff = YADIF_OP(max)(YADIF_OP(max)(diff, min),
+                                 YADIF_OP(sub)(_mm256_setzero_si256(), max));
+        }
+
+        /* diff is never negative, so this is the clipping of yadif.h */
+        spatial_pred = YADIF_OP(min)(YADIF_OP(max)(spatial_pred,
+                                                   YADIF_OP(sub)(d, diff)),
+                                     YADIF_OP(add)(d, diff));
+        YADIF_STORE(&dst[x], spatial_pred);
+    }
+#undef M
+#undef P
+
+    if (x < w)
+        YADIF_LINE_C((uint8_t *)&dst[x], (uint8_t *)&prev[x],
+                     (uint8_t *)&cur[x], (uint8_t *)&next[x],
+                     w - x, prefs, mrefs, parity, mode);
+}
+
+#undef YADIF_CHECK
+#undef YADIF_LINE_C
+#undef YADIF_LINE
+#undef YADIF_STORE
+#undef YADIF_LOAD
+#undef YADIF_OP
+#undef YADIF_STEP
+#undef yadif_pixel_t
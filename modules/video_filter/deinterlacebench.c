@@ -0,0 +1,307 @@
+/*****************************************************************************
+ * deinterlacebench.c : deinterlacing benchmark plugin for vlc
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_modules.h>
+
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+
+/*****************************************************************************
+ * Local prototypes
+ *****************************************************************************/
+static int Create( vlc_object_t * );
+static void Destroy( vlc_object_t * );
+
+static picture_t *Filter( filter_t *, picture_t * );
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+
+#define LOOPS_TEXT N_("Number of frames to deinterlace")
+#define LOOPS_LONGTEXT N_("The number of frames deinterlaced for each " \
+                          "size and kernel")
+
+#define MODE_TEXT N_("Deinterlace method")
+#define MODE_LONGTEXT N_("Deinterlace method to benchmark")
+
+#define CHROMA_TEXT N_("Chroma of the frames")
+#define CHROMA_LONGTEXT N_("Chroma of the deinterlaced frames")
+
+#define CFG_PREFIX "deinterlacebench-"
+
+vlc_module_begin ()
+    set_description( N_("Deinterlacing benchmark filter") )
+    set_shortname( N_("Deinterlacebench" ))
+    set_category( CAT_VIDEO )
+    set_subcategory( SUBCAT_VIDEO_VFILTER )
+    set_capability( "video filter", 0 )
+
+    set_section( N_("Benchmarking"), NULL )
+    add_integer( CFG_PREFIX "loops", 200, LOOPS_TEXT,
+                 LOOPS_LONGTEXT, false )
+    add_string( CFG_PREFIX "mode", "yadif", MODE_TEXT,
+                MODE_LONGTEXT, false )
+    add_string( CFG_PREFIX "chroma", "I420", CHROMA_TEXT,
+                CHROMA_LONGTEXT, false )
+
+    set_callbacks( Create, Destroy )
+vlc_module_end ()
+
+static const char *const ppsz_filter_options[] = {
+    "loops", "mode", "chroma", NULL
+};
+
+/*****************************************************************************
+ * filter_sys_t: filter method descriptor
+ *****************************************************************************/
+typedef struct
+{
+    bool b_done;
+    int i_loops;
+    char *psz_mode;
+    vlc_fourcc_t i_chroma;
+} filter_sys_t;
+
+/*****************************************************************************
+ * Create: allocates video thread output method
+ *****************************************************************************/
+static int Create( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    filter_sys_t *p_sys;
+    char *psz_temp;
+
+    /* Allocate structure */
+    p_filter->p_sys = malloc( sizeof( filter_sys_t ) );
+    if( p_filter->p_sys == NULL )
+        return VLC_ENOMEM;
+
+    p_sys = p_filter->p_sys;
+    p_sys->b_done = false;
+
+    p_filter->pf_video_filter = Filter;
+
+    /* needed to get options passed in transcode using the
+     * deinterlacebench{name=value} syntax */
+    config_ChainParse( p_filter, CFG_PREFIX, ppsz_filter_options,
+                       p_filter->p_cfg );
+
+    p_sys->i_loops = var_CreateGetIntegerCommand( p_filter,
+                                                  CFG_PREFIX "loops" );
+    p_sys->psz_mode = var_CreateGetStringCommand( p_filter,
+                                                  CFG_PREFIX "mode" );
+    psz_temp = var_CreateGetStringCommand( p_filter, CFG_PREFIX "chroma" );
+    p_sys->i_chroma = !psz_temp || strlen( psz_temp ) != 4 ? 0 :
+        VLC_FOURCC( psz_temp[0], psz_temp[1], psz_temp[2], psz_temp[3] );
+    free( psz_temp );
+
+    if( p_sys->psz_mode == NULL ||
+        vlc_fourcc_GetChromaDescription( p_sys->i_chroma ) == NULL )
+    {
+        msg_Err( p_filter, "invalid deinterlacing mode or chroma" );
+        free( p_sys->psz_mode );
+        free( p_sys );
+        return VLC_EGENERIC;
+    }
+
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Destroy: destroy video thread output method
+ *****************************************************************************/
+static void Destroy( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    free( p_sys->psz_mode );
+    free( p_sys );
+}
+
+/*****************************************************************************
+ * Bench: deinterlaces frames with the given kernels of the deinterlacer
+ *****************************************************************************/
+static picture_t *NewPicture( filter_t *p_deinterlace )
+{
+    return picture_NewFromFormat( &p_deinterlace->fmt_out.video );
+}
+
+static const struct filter_video_callbacks bench_cbs =
+{
+    .buffer_new = NewPicture,
+};
+
+/* Fills a frame with noise, for the interpolation to do some work */
+static void FillPicture( picture_t *p_pic, unsigned i_seed )
+{
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        plane_t *p = &p_pic->p[i];
+        for( int y = 0; y < p->i_lines; y++ )
+            for( int x = 0; x < p->i_pitch; x++ )
+            {
+                i_seed = i_seed * 1103515245 + 12345;
+                p->p_pixels[y * p->i_pitch + x] = i_seed >> 16;
+            }
+    }
+}
+
+static int Bench( filter_t *p_filter, const char *psz_kernel,
+                  unsigned i_width, unsigned i_height, vlc_tick_t *p_time )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    picture_t *pp_frames[2];
+    filter_t *p_deinterlace;
+    int i_ret = VLC_SUCCESS;
+
+    video_format_t fmt;
+    video_format_Init( &fmt, p_sys->i_chroma );
+    video_format_Setup( &fmt, p_sys->i_chroma, i_width, i_height,
+                        i_width, i_height, 1, 1 );
+
+    for( int i = 0; i < 2; i++ )
+    {
+        pp_frames[i] = picture_NewFromFormat( &fmt );
+        if( !pp_frames[i] )
+        {
+            if( i > 0 )
+                picture_Release( pp_frames[0] );
+            return VLC_ENOMEM;
+        }
+        FillPicture( pp_frames[i], i + 1 );
+        pp_frames[i]->b_progressive = false;
+        pp_frames[i]->b_top_field_first = true;
+        pp_frames[i]->i_nb_fields = 2;
+    }
+
+    p_deinterlace = vlc_object_create( p_filter, sizeof(filter_t) );
+    if( !p_deinterlace )
+    {
+        i_ret = VLC_ENOMEM;
+        goto end;
+    }
+    var_Create( p_deinterlace, "deinterlace-kernel", VLC_VAR_STRING );
+    var_SetString( p_deinterlace, "deinterlace-kernel", psz_kernel );
+    var_Create( p_deinterlace, "sout-deinterlace-mode", VLC_VAR_STRING );
+    var_SetString( p_deinterlace, "sout-deinterlace-mode", p_sys->psz_mode );
+    es_format_Init( &p_deinterlace->fmt_in, VIDEO_ES, p_sys->i_chroma );
+    p_deinterlace->fmt_in.video = fmt;
+    es_format_Copy( &p_deinterlace->fmt_out, &p_deinterlace->fmt_in );
+    p_deinterlace->b_allow_fmt_out_change = true;
+    p_deinterlace->owner.video = &bench_cbs;
+    p_deinterlace->p_module = module_need( p_deinterlace, "video filter",
+                                           "deinterlace", true );
+    if( !p_deinterlace->p_module )
+    {
+        vlc_object_delete(p_deinterlace);
+        i_ret = VLC_EGENERIC;
+        goto end;
+    }
+
+    vlc_tick_t time = vlc_tick_now();
+    for( int i_iter = 0; i_iter < p_sys->i_loops; ++i_iter )
+    {
+        picture_t *p_pic = picture_Clone( pp_frames[i_iter & 1] );
+        if( !p_pic )
+            break;
+        p_pic->date = VLC_TICK_0 + i_iter * VLC_TICK_FROM_MS(40);
+
+        p_pic = p_deinterlace->pf_video_filter( p_deinterlace, p_pic );
+        while( p_pic )
+        {
+            picture_t *p_next = p_pic->p_next;
+            picture_Release( p_pic );
+            p_pic = p_next;
+        }
+    }
+    *p_time = vlc_tick_now() - time;
+
+    module_unneed( p_deinterlace, p_deinterlace->p_module );
+    es_format_Clean( &p_deinterlace->fmt_in );
+    es_format_Clean( &p_deinterlace->fmt_out );
+    vlc_object_delete(p_deinterlace);
+
+end:
+    picture_Release( pp_frames[0] );
+    picture_Release( pp_frames[1] );
+    return i_ret;
+}
+
+/*****************************************************************************
+ * Render: displays previously rendered output
+ *****************************************************************************/
+static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    /* "any" is the default: the fastest available kernels */
+    static const char *const ppsz_kernels[] = {
+        "any", "c", "sse2", "ssse3", "avx2",
+    };
+    static const struct { unsigned i_width, i_height; } sizes[] = {
+        { 1920, 1080 }, { 3840, 2160 },
+    };
+
+    if( p_sys->b_done )
+        return p_pic;
+
+    for( size_t j = 0; j < ARRAY_SIZE(sizes); j++ )
+    {
+        for( size_t i = 0; i < ARRAY_SIZE(ppsz_kernels); i++ )
+        {
+            vlc_tick_t time;
+            if( Bench( p_filter, ppsz_kernels[i], sizes[j].i_width,
+                       sizes[j].i_height, &time ) != VLC_SUCCESS )
+            {
+                if( i == 0 )
+                {
+                    picture_Release( p_pic );
+                    return NULL;
+                }
+                msg_Dbg( p_filter, "%s deinterlacing kernels not available",
+                         ppsz_kernels[i] );
+                continue;
+            }
+            if( time <= 0 )
+                time = 1;
+
+            msg_Info( p_filter, "%s %ux%ui: deinterlaced %d frames in %f sec",
+                      ppsz_kernels[i], sizes[j].i_width, sizes[j].i_height,
+                      p_sys->i_loops, secf_from_vlc_tick(time) );
+            msg_Info( p_filter, "%s %ux%ui: speed is %f frames/second",
+                      ppsz_kernels[i], sizes[j].i_width, sizes[j].i_height,
+                      (float) p_sys->i_loops / time * CLOCK_FREQ );
+        }
+    }
+
+    p_sys->b_done = true;
+    return p_pic;
+}
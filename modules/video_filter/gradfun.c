@@ -108,6 +108,9 @@ typedef struct
     int              radius;
     const vlc_chroma_description_t *chroma;
     struct vf_priv_s cfg;
+    /* blur buffers of each band, allocated on first use */
+    uint16_t         *buf[FILTER_SLICES_MAX];
+    size_t           buf_size;
 } filter_sys_t;
 
 static int Open(vlc_object_t *object)
@@ -131,12 +134,14 @@ static int Open(vlc_object_t *object)
     sys->radius   = var_CreateGetIntegerCommand(filter, CFG_PREFIX "radius");
     var_AddCallback(filter, CFG_PREFIX "strength", Callback, NULL);
     var_AddCallback(filter, CFG_PREFIX "radius",   Callback, NULL);
-    sys->cfg.buf = NULL;
+
+    for (unsigned i = 0; i < FILTER_SLICES_MAX; i++)
+        sys->buf[i] = NULL;
+    sys->buf_size = 0;
 
     struct vf_priv_s *cfg = &sys->cfg;
     cfg->thresh      = 0.0;
     cfg->radius      = 0;
-    cfg->buf         = NULL;
 
 #if HAVE_SSE2 && HAVE_6REGS
     if (vlc_CPU_SSE2())
@@ -168,11 +173,45 @@ static void Close(vlc_object_t *object)
 
     var_DelCallback(filter, CFG_PREFIX "radius",   Callback, NULL);
     var_DelCallback(filter, CFG_PREFIX "strength", Callback, NULL);
-    aligned_free(sys->cfg.buf);
+    for (unsigned i = 0; i < FILTER_SLICES_MAX; i++)
+        aligned_free(sys->buf[i]);
     vlc_mutex_destroy(&sys->lock);
     free(sys);
 }
 
+typedef struct
+{
+    struct vf_priv_s *cfg;
+    plane_t          *dstp;
+    const plane_t    *srcp;
+    int              w, h, r;
+} gradfun_plane_t;
+
+static void FilterSlice(filter_t *filter, const filter_slice_t *slice,
+                        void *opaque)
+{
+    filter_sys_t *sys = filter->p_sys;
+    const gradfun_plane_t *plane = opaque;
+
+    /* Each band needs its own blur buffer, only its band writes the slot */
+    uint16_t *buffer = sys->buf[slice->index];
+    if (!buffer)
+        buffer = sys->buf[slice->index] =
+            aligned_alloc(16, sys->buf_size * sizeof(*buffer));
+    if (!buffer) {
+        msg_Warn(filter, "cannot allocate blur buffer");
+        for (unsigned y = slice->y_start; y < slice->y_end; y++)
+            memcpy(&plane->dstp->p_pixels[y * plane->dstp->i_pitch],
+                   &plane->srcp->p_pixels[y * plane->srcp->i_pitch],
+                   plane->w);
+        return;
+    }
+    filter_plane(plane->cfg, buffer,
+                 plane->dstp->p_pixels, plane->srcp->p_pixels,
+                 plane->w, plane->h, plane->dstp->i_pitch, plane->srcp->i_pitch,
+                 plane->r, slice->y_start, slice->y_end);
+}
+
 static picture_t *Filter(filter_t *filter, picture_t *src)
 {
     filter_sys_t *sys = filter->p_sys;
@@ -192,11 +231,7 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
     struct vf_priv_s *cfg = &sys->cfg;
 
     cfg->thresh = (1 << 15) / strength;
-    if (cfg->radius != radius) {
-        cfg->radius = radius;
-        cfg->buf    = aligned_alloc(16,
-                                   (((fmt->i_width + 15) & ~15) * (cfg->radius + 1) / 2 + 32) * sizeof(*cfg->buf));
-    }
+    cfg->radius = radius;
 
     for (int i = 0; i < dst->i_planes; i++) {
         const plane_t *srcp = &src->p[i];
@@ -208,9 +243,20 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
         int r = (cfg->radius  * chroma->p[i].w.num / chroma->p[i].w.den +
                  cfg->radius  * chroma->p[i].h.num / chroma->p[i].h.den) / 2;
         r = VLC_CLIP((r + 1) & ~1, RADIUS_MIN, RADIUS_MAX);
-        if (__MIN(w, h) > 2 * r && cfg->buf) {
-            filter_plane(cfg, dstp->p_pixels, srcp->p_pixels,
-                         w, h, dstp->i_pitch, srcp->i_pitch, r);
+        if (__MIN(w, h) > 2 * r) {
+            const size_t size = GRADFUN_BUFFER_SIZE(w, r);
+            if (size > sys->buf_size) {
+                for (unsigned b = 0; b < FILTER_SLICES_MAX; b++) {
+                    aligned_free(sys->buf[b]);
+                    sys->buf[b] = NULL;
+                }
+                sys->buf_size = size;
+            }
+
+            gradfun_plane_t plane = {
+                .cfg = cfg, .dstp = dstp, .srcp = srcp, .w = w, .h = h, .r = r,
+            };
+            filter_RunSlices(filter, h, 2, r, FilterSlice, &plane);
         } else {
             plane_CopyPixels(dstp, srcp);
         }
@@ -31,7 +31,6 @@
 struct vf_priv_s {
     int thresh;
     int radius;
-    uint16_t *buf;
     void (*filter_line)(uint8_t *dst, uint8_t *src, uint16_t *dc,
                         int width, int thresh, const uint16_t *dithers);
     void (*blur_line)(uint16_t *dc, uint16_t *buf, uint16_t *buf1,
@@ -222,16 +221,34 @@ static void blur_line_sse2(uint16_t *dc, uint16_t *buf, uint16_t *buf1,
 }
 #endif // HAVE_6REGS && HAVE_SSE2
 
-static void filter_plane(struct vf_priv_s *ctx, uint8_t *dst, uint8_t *src,
-                         int width, int height, int dstride, int sstride, int r)
+/* Filters the rows y_start to y_end of a plane. The blur is started r rows
+ * before the first one, in a buffer of GRADFUN_BUFFER_SIZE(width, r), so that
+ * the output does not depend on how the plane is split in bands. */
+#define GRADFUN_BUFFER_SIZE(width, r) \
+    ((((width) + 15) & ~15) * ((r) + 1) / 2 + 32)
+
+#define FILTER_LINE(y) \
+    if (y0+(y) >= y_start && y0+(y) < y_end) \
+        ctx->filter_line(dst+(y)*dstride, src+(y)*sstride, dc-r/2, width, thresh, dither[(y)&7])
+
+static void filter_plane(struct vf_priv_s *ctx, uint16_t *buffer,
+                         uint8_t *dst, uint8_t *src,
+                         int width, int height, int dstride, int sstride, int r,
+                         int y_start, int y_end)
 {
     int bstride = ((width+15)&~15)/2;
     int y;
     uint32_t dc_factor = (1<<21)/(r*r);
-    uint16_t *dc = ctx->buf+16;
-    uint16_t *buf = ctx->buf+bstride+32;
+    uint16_t *dc = buffer+16;
+    uint16_t *buf = buffer+bstride+32;
     int thresh = ctx->thresh;
 
+    /* keep the same dithering pattern and row pairs as the whole plane */
+    int y0 = VLC_CLIP(y_start-r, 0, height-2*r-1) & ~7;
+    height = __MIN(__MAX(y_end+r, y0+2*r+2), height) - y0;
+    src += y0*sstride;
+    dst += y0*dstride;
+
     memset(dc, 0, (bstride+16)*sizeof(*buf));
     for (y=0; y<r; y++)
         ctx->blur_line(dc, buf+y*bstride, buf+(y-1)*bstride, src+2*y*sstride, sstride, width/2);
@@ -255,12 +272,12 @@ static void filter_plane(struct vf_priv_s *ctx, uint8_t *dst, uint8_t *src,
         }
         if (y == r) {
             for (y=0; y<r; y++)
-                ctx->filter_line(dst+y*dstride, src+y*sstride, dc-r/2, width, thresh, dither[y&7]);
+                FILTER_LINE(y);
         }
-        ctx->filter_line(dst+y*dstride, src+y*sstride, dc-r/2, width, thresh, dither[y&7]);
+        FILTER_LINE(y);
         if (++y >= height) break;
-        ctx->filter_line(dst+y*dstride, src+y*sstride, dc-r/2, width, thresh, dither[y&7]);
+        FILTER_LINE(y);
         if (++y >= height) break;
     }
 }
-
+#undef FILTER_LINE
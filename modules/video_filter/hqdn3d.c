@@ -104,12 +104,10 @@ static int Open(vlc_object_t *this)
 {
     filter_t *filter = (filter_t *)this;
     filter_sys_t *sys;
-    struct vf_priv_s *cfg;
     const video_format_t *fmt_in  = &filter->fmt_in.video;
     const video_format_t *fmt_out = &filter->fmt_out.video;
     const vlc_fourcc_t fourcc_in  = fmt_in->i_chroma;
     const vlc_fourcc_t fourcc_out = fmt_out->i_chroma;
-    int wmax = 0;
 
     const vlc_chroma_description_t *chroma =
             vlc_fourcc_GetChromaDescription(fourcc_in);
@@ -128,20 +126,12 @@ static int Open(vlc_object_t *this)
     if (!sys) {
         return VLC_ENOMEM;
     }
-    cfg = &sys->cfg;
-
     sys->chroma = chroma;
 
     for (int i = 0; i < 3; ++i) {
         sys->w[i] = fmt_in->i_width  * chroma->p[i].w.num / chroma->p[i].w.den;
-        if (sys->w[i] > wmax) wmax = sys->w[i];
         sys->h[i] = fmt_out->i_height * chroma->p[i].h.num / chroma->p[i].h.den;
     }
-    cfg->Line = malloc(wmax*sizeof(unsigned int));
-    if (!cfg->Line) {
-        free(sys);
-        return VLC_ENOMEM;
-    }
 
     config_ChainParse(filter, FILTER_PREFIX, filter_options,
                       filter->p_cfg);
@@ -184,10 +174,60 @@ static void Close(vlc_object_t *this)
     for (int i = 0; i < 3; ++i) {
         free(cfg->Frame[i]);
     }
-    free(cfg->Line);
     free(sys);
 }
 
+/*****************************************************************************
+ * FilterSlice
+ *****************************************************************************/
+/* The planes are filtered in blocks of fixed height, whatever the number of
+ * bands, so that the output does not depend on the number of threads. The
+ * vertical filter of a block starts a few lines above it, as it has no upper
+ * neighbor otherwise. */
+#define BLOCK_LINES  64
+#define WARMUP_LINES 16
+
+typedef struct
+{
+    filter_sys_t  *sys;
+    const plane_t *src;
+    plane_t       *dst;
+    int           i_plane;
+} hqdn3d_plane_t;
+
+static void FilterSlice(filter_t *filter, const filter_slice_t *slice,
+                        void *opaque)
+{
+    const hqdn3d_plane_t *plane = opaque;
+    filter_sys_t *sys = plane->sys;
+    struct vf_priv_s *cfg = &sys->cfg;
+    const int i = plane->i_plane;
+    int *spat = cfg->Coefs[i == 0 ? 0 : 2];
+    int *temp = cfg->Coefs[i == 0 ? 1 : 3];
+
+    unsigned int *line = vlc_alloc(sys->w[i], sizeof(*line));
+    if (unlikely(!line)) {
+        msg_Warn(filter, "cannot allocate line buffer");
+        for (unsigned y = slice->y_start; y < slice->y_end; y++)
+            memcpy(&plane->dst->p_pixels[y * plane->dst->i_pitch],
+                   &plane->src->p_pixels[y * plane->src->i_pitch],
+                   sys->w[i]);
+        return;
+    }
+
+    /* The bands start on blocks */
+    for (unsigned y = slice->y_start; y < slice->y_end; y += BLOCK_LINES) {
+        unsigned y_end = __MIN(y + BLOCK_LINES, slice->y_end);
+        unsigned y_read = y > WARMUP_LINES ? y - WARMUP_LINES : 0;
+
+        deNoise(plane->src->p_pixels, plane->dst->p_pixels,
+                line, cfg->Frame[i], sys->w[i], y_read, y, y_end,
+                plane->src->i_pitch, plane->dst->i_pitch,
+                spat, spat, temp);
+    }
+    free(line);
+}
+
 /*****************************************************************************
  * Filter
  *****************************************************************************/
@@ -220,30 +260,23 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
     }
     vlc_mutex_unlock( &sys->coefs_mutex );
 
-    deNoise(src->p[0].p_pixels, dst->p[0].p_pixels,
-            cfg->Line, &cfg->Frame[0], sys->w[0], sys->h[0],
-            src->p[0].i_pitch, dst->p[0].i_pitch,
-            cfg->Coefs[0],
-            cfg->Coefs[0],
-            cfg->Coefs[1]);
-    deNoise(src->p[1].p_pixels, dst->p[1].p_pixels,
-            cfg->Line, &cfg->Frame[1], sys->w[1], sys->h[1],
-            src->p[1].i_pitch, dst->p[1].i_pitch,
-            cfg->Coefs[2],
-            cfg->Coefs[2],
-            cfg->Coefs[3]);
-    deNoise(src->p[2].p_pixels, dst->p[2].p_pixels,
-            cfg->Line, &cfg->Frame[2], sys->w[2], sys->h[2],
-            src->p[2].i_pitch, dst->p[2].i_pitch,
-            cfg->Coefs[2],
-            cfg->Coefs[2],
-            cfg->Coefs[3]);
-
-    if(unlikely(!cfg->Frame[0] || !cfg->Frame[1] || !cfg->Frame[2]))
-    {
-        picture_Release( src );
-        picture_Release( dst );
-        return NULL;
+    for (int i = 0; i < 3; ++i) {
+        if (!cfg->Frame[i]) {
+            cfg->Frame[i] = malloc(sys->w[i] * sys->h[i] * sizeof(unsigned short));
+            if (unlikely(!cfg->Frame[i])) {
+                picture_Release( src );
+                picture_Release( dst );
+                return NULL;
+            }
+            deNoiseInit(src->p[i].p_pixels, cfg->Frame[i],
+                        sys->w[i], sys->h[i], src->p[i].i_pitch);
+        }
+
+        hqdn3d_plane_t plane = {
+            .sys = sys, .src = &src->p[i], .dst = &dst->p[i], .i_plane = i,
+        };
+        filter_RunSlices(filter, sys->h[i], BLOCK_LINES, WARMUP_LINES,
+                         FilterSlice, &plane);
     }
 
     return CopyInfoAndRelease(dst, src);
@@ -32,7 +32,6 @@
 
 struct vf_priv_s {
         int Coefs[4][512*16];
-        unsigned int *Line;
         unsigned short *Frame[3];
 };
 
@@ -67,29 +66,64 @@ static void deNoiseTemporal(
     }
 }
 
+/* Runs the spatial filter over the lines YRead to YStart, so that the lines
+ * of a band do not start without top neighbor. The result is only an
+ * approximation of the whole frame filtering, which has no upper bound. */
+static void deNoiseWarmUp(
+                    unsigned char *Frame,        // mpi->planes[x]
+                    unsigned int *LineAnt,       // width bytes
+                    int W, int YRead, int YStart, int sStride,
+                    int *Horizontal, int *Vertical)
+{
+    unsigned int PixelAnt;
+    long sLineOffs = YRead * sStride;
+
+    /* First line has no top neighbor, only left. */
+    LineAnt[0] = PixelAnt = Frame[sLineOffs]<<16;
+    for (long X = 1; X < W; X++)
+        LineAnt[X] = PixelAnt = LowPassMul(PixelAnt, Frame[sLineOffs+X]<<16, Horizontal);
+
+    for (long Y = YRead + 1; Y < YStart; Y++){
+        sLineOffs += sStride;
+        PixelAnt = Frame[sLineOffs]<<16;
+        LineAnt[0] = LowPassMul(LineAnt[0], PixelAnt, Vertical);
+        for (long X = 1; X < W; X++){
+            PixelAnt = LowPassMul(PixelAnt, Frame[sLineOffs+X]<<16, Horizontal);
+            LineAnt[X] = LowPassMul(LineAnt[X], PixelAnt, Vertical);
+        }
+    }
+}
+
 static void deNoiseSpacial(
                     unsigned char *Frame,        // mpi->planes[x]
                     unsigned char *FrameDest,    // dmpi->planes[x]
                     unsigned int *LineAnt,       // vf->priv->Line (width bytes)
-                    int W, int H, int sStride, int dStride,
+                    int W, int YRead, int YStart, int YEnd,
+                    int sStride, int dStride,
                     int *Horizontal, int *Vertical)
 {
-    long sLineOffs = 0, dLineOffs = 0;
+    long sLineOffs = YStart * sStride, dLineOffs = YStart * dStride;
     unsigned int PixelAnt;
     unsigned int PixelDst;
 
-    /* First pixel has no left nor top neighbor. */
-    PixelDst = LineAnt[0] = PixelAnt = Frame[0]<<16;
-    FrameDest[0]= ((PixelDst+0x10007FFF)>>16);
+    if (YRead < YStart) {
+        deNoiseWarmUp(Frame, LineAnt, W, YRead, YStart, sStride,
+                      Horizontal, Vertical);
+    } else {
+        /* First pixel has no left nor top neighbor. */
+        PixelDst = LineAnt[0] = PixelAnt = Frame[sLineOffs]<<16;
+        FrameDest[dLineOffs]= ((PixelDst+0x10007FFF)>>16);
 
-    /* First line has no top neighbor, only left. */
-    for (long X = 1; X < W; X++){
-        PixelDst = LineAnt[X] = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
-        FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
+        /* First line has no top neighbor, only left. */
+        for (long X = 1; X < W; X++){
+            PixelDst = LineAnt[X] = LowPassMul(PixelAnt, Frame[sLineOffs+X]<<16, Horizontal);
+            FrameDest[dLineOffs+X]= ((PixelDst+0x10007FFF)>>16);
+        }
+        YStart++;
+        sLineOffs += sStride, dLineOffs += dStride;
     }
 
-    for (long Y = 1; Y < H; Y++){
-        sLineOffs += sStride, dLineOffs += dStride;
+    for (long Y = YStart; Y < YEnd; Y++){
         /* First pixel on each line doesn't have previous pixel */
         PixelAnt = Frame[sLineOffs]<<16;
         PixelDst = LineAnt[0] = LowPassMul(LineAnt[0], PixelAnt, Vertical);
@@ -101,61 +135,74 @@ static void deNoiseSpacial(
             PixelDst = LineAnt[X] = LowPassMul(LineAnt[X], PixelAnt, Vertical);
             FrameDest[dLineOffs+X]= ((PixelDst+0x10007FFF)>>16);
         }
+        sLineOffs += sStride, dLineOffs += dStride;
     }
 }
 
+static void deNoiseInit(unsigned char *Frame,        // mpi->planes[x]
+                        unsigned short *FrameAnt,
+                        int W, int H, int sStride)
+{
+    for (long Y = 0; Y < H; Y++){
+        unsigned short* dst=&FrameAnt[Y*W];
+        unsigned char* src=Frame+Y*sStride;
+        for (long X = 0; X < W; X++) dst[X]=src[X]<<8;
+    }
+}
+
+/* Filters the lines YStart to YEnd of a plane, starting the vertical filter
+ * at the line YRead. FrameAnt must have been set up with deNoiseInit(). */
 static void deNoise(unsigned char *Frame,        // mpi->planes[x]
                     unsigned char *FrameDest,    // dmpi->planes[x]
-                    unsigned int *LineAnt,      // vf->priv->Line (width bytes)
-                    unsigned short **FrameAntPtr,
-                    int W, int H, int sStride, int dStride,
+                    unsigned int *LineAnt,      // width bytes
+                    unsigned short *FrameAnt,
+                    int W, int YRead, int YStart, int YEnd,
+                    int sStride, int dStride,
                     int *Horizontal, int *Vertical, int *Temporal)
 {
-    long sLineOffs = 0, dLineOffs = 0;
+    long sLineOffs = YStart * sStride, dLineOffs = YStart * dStride;
     unsigned int PixelAnt;
     unsigned int PixelDst;
-    unsigned short* FrameAnt=(*FrameAntPtr);
-
-    if(!FrameAnt){
-        (*FrameAntPtr)=FrameAnt=malloc(W*H*sizeof(unsigned short));
-        if(!FrameAnt)
-            return;
-        for (long Y = 0; Y < H; Y++){
-            unsigned short* dst=&FrameAnt[Y*W];
-            unsigned char* src=Frame+Y*sStride;
-            for (long X = 0; X < W; X++) dst[X]=src[X]<<8;
-        }
-    }
 
     if(!Horizontal[0] && !Vertical[0]){
-        deNoiseTemporal(Frame, FrameDest, FrameAnt,
-                        W, H, sStride, dStride, Temporal);
+        deNoiseTemporal(Frame + sLineOffs, FrameDest + dLineOffs,
+                        FrameAnt + YStart * W,
+                        W, YEnd - YStart, sStride, dStride, Temporal);
         return;
     }
     if(!Temporal[0]){
         deNoiseSpacial(Frame, FrameDest, LineAnt,
-                       W, H, sStride, dStride, Horizontal, Vertical);
+                       W, YRead, YStart, YEnd, sStride, dStride,
+                       Horizontal, Vertical);
         return;
     }
 
-    /* First pixel has no left nor top neighbor. Only previous frame */
-    LineAnt[0] = PixelAnt = Frame[0]<<16;
-    PixelDst = LowPassMul(FrameAnt[0]<<8, PixelAnt, Temporal);
-    FrameAnt[0] = ((PixelDst+0x1000007F)>>8);
-    FrameDest[0]= ((PixelDst+0x10007FFF)>>16);
-
-    /* First line has no top neighbor. Only left one for each pixel and
-     * last frame */
-    for (long X = 1; X < W; X++){
-        LineAnt[X] = PixelAnt = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
-        PixelDst = LowPassMul(FrameAnt[X]<<8, PixelAnt, Temporal);
-        FrameAnt[X] = ((PixelDst+0x1000007F)>>8);
-        FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
+    if (YRead < YStart) {
+        deNoiseWarmUp(Frame, LineAnt, W, YRead, YStart, sStride,
+                      Horizontal, Vertical);
+    } else {
+        unsigned short* LinePrev=&FrameAnt[YStart*W];
+
+        /* First pixel has no left nor top neighbor. Only previous frame */
+        LineAnt[0] = PixelAnt = Frame[sLineOffs]<<16;
+        PixelDst = LowPassMul(LinePrev[0]<<8, PixelAnt, Temporal);
+        LinePrev[0] = ((PixelDst+0x1000007F)>>8);
+        FrameDest[dLineOffs]= ((PixelDst+0x10007FFF)>>16);
+
+        /* First line has no top neighbor. Only left one for each pixel and
+         * last frame */
+        for (long X = 1; X < W; X++){
+            LineAnt[X] = PixelAnt = LowPassMul(PixelAnt, Frame[sLineOffs+X]<<16, Horizontal);
+            PixelDst = LowPassMul(LinePrev[X]<<8, PixelAnt, Temporal);
+            LinePrev[X] = ((PixelDst+0x1000007F)>>8);
+            FrameDest[dLineOffs+X]= ((PixelDst+0x10007FFF)>>16);
+        }
+        YStart++;
+        sLineOffs += sStride, dLineOffs += dStride;
     }
 
-    for (long Y = 1; Y < H; Y++){
+    for (long Y = YStart; Y < YEnd; Y++){
         unsigned short* LinePrev=&FrameAnt[Y*W];
-        sLineOffs += sStride, dLineOffs += dStride;
         /* First pixel on each line doesn't have previous pixel */
         PixelAnt = Frame[sLineOffs]<<16;
         LineAnt[0] = LowPassMul(LineAnt[0], PixelAnt, Vertical);
@@ -171,6 +218,7 @@ static void deNoise(unsigned char *Frame,        // mpi->planes[x]
             LinePrev[X] = ((PixelDst+0x1000007F)>>8);
             FrameDest[dLineOffs+X]= ((PixelDst+0x10007FFF)>>16);
         }
+        sLineOffs += sStride, dLineOffs += dStride;
     }
 }
 
@@ -33,6 +33,7 @@
 #include <vlc_opengl.h>
 #include <vlc_filter.h>
 #include <vlc_rand.h>
+#include <vlc_spectrum.h>
 
 #ifdef __APPLE__
 # include <OpenGL/gl.h>
@@ -42,8 +43,7 @@
 
 #include <math.h>
 
-#include "visual/fft.h"
-#include "visual/window.h"
+#define FFT_BUFFER_SIZE 512
 
 
 /*****************************************************************************
@@ -83,8 +83,6 @@ typedef struct
     /* Audio data */
     unsigned i_channels;
     block_fifo_t    *fifo;
-    unsigned i_prev_nb_samples;
-    int16_t *p_prev_s16_buff;
 
     /* Opengl */
     vlc_gl_t *gl;
@@ -92,8 +90,8 @@ typedef struct
     float f_rotationAngle;
     float f_rotationIncrement;
 
-    /* FFT window parameters */
-    window_param wind_param;
+    /* Spectrum analysis, shared with the other visualizations */
+    vlc_spectrum_t *spectrum;
 } filter_sys_t;
 
 
@@ -125,19 +123,26 @@ static int Open(vlc_object_t * p_this)
 
     /* Create the object for the thread */
     p_sys->i_channels = aout_FormatNbChannels(&p_filter->fmt_in.audio);
-    p_sys->i_prev_nb_samples = 0;
-    p_sys->p_prev_s16_buff = NULL;
 
     p_sys->f_rotationAngle = 0;
     p_sys->f_rotationIncrement = ROTATION_INCREMENT;
 
-    /* Fetch the FFT window parameters */
-    window_get_param( VLC_OBJECT( p_filter ), &p_sys->wind_param );
+    /* Get the spectrum analysis of the audio output */
+    struct vlc_spectrum_cfg spectrum_cfg;
+    vlc_spectrum_GetConfig(VLC_OBJECT(p_filter), FFT_BUFFER_SIZE,
+                           &spectrum_cfg);
+    p_sys->spectrum = vlc_spectrum_Hold(vlc_object_parent(p_filter),
+                                        &spectrum_cfg);
+    if (p_sys->spectrum == NULL)
+        goto error;
 
     /* Create the FIFO for the audio data. */
     p_sys->fifo = block_FifoNew();
     if (p_sys->fifo == NULL)
+    {
+        vlc_spectrum_Release(p_sys->spectrum);
         goto error;
+    }
 
     /* Create the openGL provider */
     vout_window_cfg_t cfg = {
@@ -149,13 +154,19 @@ static int Open(vlc_object_t * p_this)
     if (p_sys->gl == NULL)
     {
         block_FifoRelease(p_sys->fifo);
+        vlc_spectrum_Release(p_sys->spectrum);
         goto error;
     }
 
     /* Create the thread */
     if (vlc_clone(&p_sys->thread, Thread, p_filter,
                   VLC_THREAD_PRIORITY_VIDEO))
+    {
+        vlc_gl_surface_Destroy(p_sys->gl);
+        block_FifoRelease(p_sys->fifo);
+        vlc_spectrum_Release(p_sys->spectrum);
         goto error;
+    }
 
     p_filter->fmt_in.audio.i_format = VLC_CODEC_FL32;
     p_filter->fmt_out.audio = p_filter->fmt_in.audio;
@@ -185,7 +196,7 @@ static void Close(vlc_object_t *p_this)
     /* Free the ressources */
     vlc_gl_surface_Destroy(p_sys->gl);
     block_FifoRelease(p_sys->fifo);
-    free(p_sys->p_prev_s16_buff);
+    vlc_spectrum_Release(p_sys->spectrum);
     free(p_sys);
 }
 
@@ -375,79 +386,20 @@ static void *Thread( void *p_data )
         const unsigned xscale[] = {0,1,2,3,4,5,6,7,8,11,15,20,27,
                                    36,47,62,82,107,141,184,255};
 
-        fft_state *p_state = NULL; /* internal FFT data */
-        DEFINE_WIND_CONTEXT(wind_ctx); /* internal window data */
-
         unsigned i, j;
-        float p_output[FFT_BUFFER_SIZE];           /* Raw FFT Result  */
-        int16_t p_buffer1[FFT_BUFFER_SIZE];        /* Buffer on which we perform
-                                                      the FFT (first channel) */
-        int16_t p_dest[FFT_BUFFER_SIZE];           /* Adapted FFT result */
-        float *p_buffl = (float*)block->p_buffer;  /* Original buffer */
-
-        int16_t  *p_buffs;                         /* int16_t converted buffer */
-        int16_t  *p_s16_buff;                      /* int16_t converted buffer */
-
-        if (!block->i_nb_samples) {
-            msg_Err(p_filter, "no samples yet");
-            goto release;
-        }
-
-        /* Allocate the buffer only if the number of samples change */
-        if (block->i_nb_samples != p_sys->i_prev_nb_samples)
-        {
-            free(p_sys->p_prev_s16_buff);
-            p_sys->p_prev_s16_buff = malloc(block->i_nb_samples *
-                                            p_sys->i_channels *
-                                            sizeof(int16_t));
-            if (!p_sys->p_prev_s16_buff)
-                goto release;
-            p_sys->i_prev_nb_samples = block->i_nb_samples;
-        }
-        p_buffs = p_s16_buff = p_sys->p_prev_s16_buff;
+        float p_output[FFT_BUFFER_SIZE / 2 + 1];   /* Raw FFT Result  */
+        int16_t p_dest[FFT_BUFFER_SIZE / 2 + 1];   /* Adapted FFT result */
 
-        /* Convert the buffer to int16_t
-           Pasted from float32tos16.c */
-        for (i = block->i_nb_samples * p_sys->i_channels; i--;)
+        if (vlc_spectrum_Compute(p_sys->spectrum, block, p_sys->i_channels,
+                                 p_output) != VLC_SUCCESS)
         {
-            union {float f; int32_t i;} u;
-
-            u.f = *p_buffl + 384.f;
-            if (u.i > 0x43c07fff)
-                *p_buffs = 32767;
-            else if (u.i < 0x43bf8000)
-                *p_buffs = -32768;
-            else
-                *p_buffs = u.i - 0x43c00000;
-
-            p_buffl++; p_buffs++;
-        }
-        p_state = visual_fft_init();
-        if (!p_state)
-        {
-            msg_Err(p_filter,"unable to initialize FFT transform");
-            goto release;
-        }
-        if (!window_init(FFT_BUFFER_SIZE, &p_sys->wind_param, &wind_ctx))
-        {
-            msg_Err(p_filter,"unable to initialize FFT window");
+            msg_Err(p_filter, "no samples yet");
             goto release;
         }
-        p_buffs = p_s16_buff;
-        for (i = 0 ; i < FFT_BUFFER_SIZE; i++)
-        {
-            p_output[i] = 0;
-            p_buffer1[i] = *p_buffs;
-
-            p_buffs += p_sys->i_channels;
-            if (p_buffs >= &p_s16_buff[block->i_nb_samples * p_sys->i_channels])
-                p_buffs = p_s16_buff;
-        }
-        window_scale_in_place (p_buffer1, &wind_ctx);
-        fft_perform (p_buffer1, p_output, p_state);
 
-        for (i = 0; i< FFT_BUFFER_SIZE; ++i)
-            p_dest[i] = p_output[i] *  (2 ^ 16)
+        /* Scale of the power spectrum of 16-bits samples */
+        for (i = 0; i <= FFT_BUFFER_SIZE / 2; ++i)
+            p_dest[i] = p_output[i] * (32768.f * 32768.f) * (2 ^ 16)
                         / ((FFT_BUFFER_SIZE / 2 * 32768) ^ 2);
 
         for (i = 0 ; i < NB_BANDS; i++)
@@ -491,8 +443,6 @@ static void *Thread( void *p_data )
         vlc_gl_Swap(gl);
 
 release:
-        window_close(&wind_ctx);
-        fft_close(p_state);
         vlc_gl_ReleaseCurrent(gl);
         block_Release(block);
         vlc_restorecancel(canc);
@@ -0,0 +1,525 @@
+/*****************************************************************************
+ * loudness.c: EBU R128 loudness measurement
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_aout.h>
+#include <vlc_cpu.h>
+#include <vlc_loudness.h>
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+#endif
+#ifdef __ARM_NEON
+# include <arm_neon.h>
+#endif
+
+/* The frames are deinterleaved in chunks, with the channels padded to the
+ * width of the vectors, and the K-weighting filters run over each chunk
+ * with the channels in the lanes of the vectors. The sums of squares are
+ * gathered per 100 ms sub-block, 4 sub-blocks making a gating block. */
+
+#define LOUDNESS_WIDTH_MAX 8   /* floats in the widest vector */
+#define LOUDNESS_ALIGN     32
+#define LOUDNESS_CHUNK     64  /* frames deinterleaved at once */
+
+#define LOUDNESS_SUBBLOCKS 30  /* 3 s, for the short-term loudness */
+
+/* Histogram of the gated blocks, by 0.1 LU from the absolute gate */
+#define LOUDNESS_GATE      (-70.)
+#define LOUDNESS_BINS      800
+#define LOUDNESS_BIN_LU    .1
+
+/* The filters state is flushed to zero below this level (about -600 dB), so
+ * that silence does not fall into denormals */
+#define LOUDNESS_DENORMAL  1e-30f
+
+typedef void (*loudness_kernel_t)(const float *restrict coeffs,
+                                  float *restrict state,
+                                  const float *restrict buf,
+                                  float *restrict acc, unsigned lanes,
+                                  unsigned frames);
+
+struct vlc_loudness
+{
+    vlc_fourcc_t format;
+    unsigned channels;
+    unsigned lanes; /* channels, rounded up to the kernel width */
+    loudness_kernel_t kernel;
+
+    float *coeffs; /* [2 stages][b0, b1, b2, a1, a2][LOUDNESS_WIDTH_MAX] */
+    float *state;  /* [x1, x2, y1, y2, z1, z2][lanes] */
+    float *buf;    /* [LOUDNESS_CHUNK][lanes] */
+    float *acc;    /* [lanes], sums of squares of a chunk */
+    double *power; /* [lanes], sums of squares of the sub-block */
+    float *weights; /* [channels] */
+    float peak;
+
+    unsigned sub_frames; /* frames per sub-block */
+    unsigned sub_pos;    /* frames in the current sub-block */
+    uint64_t sub_count;  /* complete sub-blocks */
+    double sub[LOUDNESS_SUBBLOCKS]; /* mean squares of the last sub-blocks */
+
+    uint64_t bin_count[LOUDNESS_BINS];
+    double bin_energy[LOUDNESS_BINS];
+};
+
+/* Two cascaded biquads: the high shelf, then the high pass, whose input
+ * history is the output history of the first stage. The squares of the
+ * output are added to the accumulators. */
+#define LOUDNESS_KERNEL(name, attr, width, vec, load, store, add, sub, mul) \
+attr \
+static void name(const float *restrict c, float *restrict state, \
+                 const float *restrict buf, float *restrict acc, \
+                 unsigned lanes, unsigned frames) \
+{ \
+    const vec b0 = load(&c[0 * LOUDNESS_WIDTH_MAX]); \
+    const vec b1 = load(&c[1 * LOUDNESS_WIDTH_MAX]); \
+    const vec b2 = load(&c[2 * LOUDNESS_WIDTH_MAX]); \
+    const vec a1 = load(&c[3 * LOUDNESS_WIDTH_MAX]); \
+    const vec a2 = load(&c[4 * LOUDNESS_WIDTH_MAX]); \
+    const vec d0 = load(&c[5 * LOUDNESS_WIDTH_MAX]); \
+    const vec d1 = load(&c[6 * LOUDNESS_WIDTH_MAX]); \
+    const vec d2 = load(&c[7 * LOUDNESS_WIDTH_MAX]); \
+    const vec e1 = load(&c[8 * LOUDNESS_WIDTH_MAX]); \
+    const vec e2 = load(&c[9 * LOUDNESS_WIDTH_MAX]); \
+\
+    for (unsigned g = 0; g < lanes; g += width) \
+    { \
+        vec x1 = load(&state[0 * lanes + g]); \
+        vec x2 = load(&state[1 * lanes + g]); \
+        vec y1 = load(&state[2 * lanes + g]); \
+        vec y2 = load(&state[3 * lanes + g]); \
+        vec z1 = load(&state[4 * lanes + g]); \
+        vec z2 = load(&state[5 * lanes + g]); \
+        vec sum = load(&acc[g]); \
+\
+        for (unsigned i = 0; i < frames; i++) \
+        { \
+            const vec x = load(&buf[i * lanes + g]); \
+            vec y, z; \
+\
+            y = mul(x, b0); \
+            y = add(y, mul(x1, b1)); \
+            y = add(y, mul(x2, b2)); \
+            y = sub(y, mul(y2, a2)); \
+            y = sub(y, mul(y1, a1)); \
+\
+            z = mul(y, d0); \
+            z = add(z, mul(y1, d1)); \
+            z = add(z, mul(y2, d2)); \
+            z = sub(z, mul(z2, e2)); \
+            z = sub(z, mul(z1, e1)); \
+\
+            sum = add(sum, mul(z, z)); \
+            x2 = x1; \
+            x1 = x; \
+            y2 = y1; \
+            y1 = y; \
+            z2 = z1; \
+            z1 = z; \
+        } \
+\
+        store(&state[0 * lanes + g], x1); \
+        store(&state[1 * lanes + g], x2); \
+        store(&state[2 * lanes + g], y1); \
+        store(&state[3 * lanes + g], y2); \
+        store(&state[4 * lanes + g], z1); \
+        store(&state[5 * lanes + g], z2); \
+        store(&acc[g], sum); \
+    } \
+}
+
+#define LOUDNESS_C_ADD(a, b) ((a) + (b))
+#define LOUDNESS_C_SUB(a, b) ((a) - (b))
+#define LOUDNESS_C_MUL(a, b) ((a) * (b))
+#define LOUDNESS_C_LOAD(p) (*(p))
+#define LOUDNESS_C_STORE(p, v) (*(p) = (v))
+LOUDNESS_KERNEL(KernelC, , 1, float, LOUDNESS_C_LOAD, LOUDNESS_C_STORE,
+                LOUDNESS_C_ADD, LOUDNESS_C_SUB, LOUDNESS_C_MUL)
+
+#ifdef HAVE_SSE2_INTRINSICS
+LOUDNESS_KERNEL(KernelSSE2, __attribute__ ((__target__ ("sse2"))), 4, __m128,
+                _mm_load_ps, _mm_store_ps, _mm_add_ps, _mm_sub_ps,
+                _mm_mul_ps)
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+LOUDNESS_KERNEL(KernelAVX, __attribute__ ((__target__ ("avx"))), 8, __m256,
+                _mm256_load_ps, _mm256_store_ps, _mm256_add_ps,
+                _mm256_sub_ps, _mm256_mul_ps)
+#endif
+
+#ifdef __ARM_NEON
+LOUDNESS_KERNEL(KernelNEON, , 4, float32x4_t, vld1q_f32, vst1q_f32,
+                vaddq_f32, vsubq_f32, vmulq_f32)
+#endif
+
+/* By order of preference */
+static const struct
+{
+    const char *name;
+    unsigned width;
+    loudness_kernel_t kernel;
+} kernels[] = {
+#ifdef HAVE_AVX2_INTRINSICS
+    { "avx", 8, KernelAVX },
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+    { "sse2", 4, KernelSSE2 },
+#endif
+#ifdef __ARM_NEON
+    { "neon", 4, KernelNEON },
+#endif
+    { "c", 1, KernelC },
+};
+
+/* K-weighting filters, as designed for any sample rate by the bilinear
+ * transform of the analog prototypes of BS.1770 */
+static void SetCoeffs(float *c, unsigned rate)
+{
+    double k = tan(M_PI * 1681.974450955533 / rate);
+    double q = 0.7071752369554196;
+    const double vh = pow(10., 3.999843853973347 / 20.);
+    const double vb = pow(vh, 0.4996667741545416);
+    double a0 = 1. + k / q + k * k;
+    const double shelf[5] = {
+        (vh + vb * k / q + k * k) / a0,
+        2. * (k * k - vh) / a0,
+        (vh - vb * k / q + k * k) / a0,
+        2. * (k * k - 1.) / a0,
+        (1. - k / q + k * k) / a0,
+    };
+
+    k = tan(M_PI * 38.13547087602444 / rate);
+    q = 0.5003270373238773;
+    a0 = 1. + k / q + k * k;
+    const double highpass[5] = {
+        1., -2., 1.,
+        2. * (k * k - 1.) / a0,
+        (1. - k / q + k * k) / a0,
+    };
+
+    for (unsigned i = 0; i < 5; i++)
+        for (unsigned l = 0; l < LOUDNESS_WIDTH_MAX; l++)
+        {
+            c[i * LOUDNESS_WIDTH_MAX + l] = shelf[i];
+            c[(5 + i) * LOUDNESS_WIDTH_MAX + l] = highpass[i];
+        }
+}
+
+vlc_loudness_t *vlc_loudness_New(const audio_sample_format_t *fmt)
+{
+    switch (fmt->i_format)
+    {
+        case VLC_CODEC_FL32:
+        case VLC_CODEC_FL64:
+        case VLC_CODEC_S32N:
+        case VLC_CODEC_S16N:
+        case VLC_CODEC_U8:
+            break;
+        default:
+            return NULL;
+    }
+    if (fmt->i_channels == 0 || fmt->i_rate < 100)
+        return NULL;
+
+    vlc_loudness_t *meter = calloc(1, sizeof (*meter));
+    if (unlikely(meter == NULL))
+        return NULL;
+
+    size_t k = 0;
+    while (!vlc_CPU_CheckKernels(kernels[k].name))
+        k++;
+    meter->kernel = kernels[k].kernel;
+    const unsigned width = kernels[k].width;
+
+    meter->format = fmt->i_format;
+    meter->channels = fmt->i_channels;
+    meter->lanes = (fmt->i_channels + width - 1) / width * width;
+    meter->sub_frames = (fmt->i_rate + 5) / 10;
+
+    meter->coeffs = vlc_CPU_AllocFloats(10 * LOUDNESS_WIDTH_MAX,
+                                        LOUDNESS_ALIGN);
+    meter->state = vlc_CPU_AllocFloats(6 * meter->lanes, LOUDNESS_ALIGN);
+    /* Zeroed: the padding lanes stay silent */
+    meter->buf = vlc_CPU_AllocFloats(LOUDNESS_CHUNK * meter->lanes,
+                                     LOUDNESS_ALIGN);
+    meter->acc = vlc_CPU_AllocFloats(meter->lanes, LOUDNESS_ALIGN);
+    meter->power = vlc_alloc(meter->lanes, sizeof (*meter->power));
+    meter->weights = vlc_alloc(meter->channels, sizeof (*meter->weights));
+    if (unlikely(meter->coeffs == NULL || meter->state == NULL
+              || meter->buf == NULL || meter->acc == NULL
+              || meter->power == NULL || meter->weights == NULL))
+    {
+        vlc_loudness_Delete(meter);
+        return NULL;
+    }
+
+    SetCoeffs(meter->coeffs, fmt->i_rate);
+
+    /* The channels are in the VLC order of their physical positions */
+    for (unsigned i = 0; i < meter->channels; i++)
+        meter->weights[i] = 1.f;
+    if (fmt->channel_type == AUDIO_CHANNEL_TYPE_BITMAP)
+    {
+        unsigned i = 0;
+
+        for (unsigned j = 0; j < AOUT_CHAN_MAX && i < meter->channels; j++)
+        {
+            const uint32_t chan = pi_vlc_chan_order_wg4[j];
+
+            if (!(fmt->i_physical_channels & chan))
+                continue;
+            if (chan == AOUT_CHAN_LFE)
+                meter->weights[i] = 0.f;
+            else if (chan & (AOUT_CHANS_MIDDLE | AOUT_CHANS_REAR
+                           | AOUT_CHAN_REARCENTER))
+                meter->weights[i] = 1.41f;
+            i++;
+        }
+    }
+
+    vlc_loudness_Reset(meter);
+    return meter;
+}
+
+void vlc_loudness_Delete(vlc_loudness_t *meter)
+{
+    free(meter->weights);
+    free(meter->power);
+    free(meter->acc);
+    free(meter->buf);
+    free(meter->state);
+    free(meter->coeffs);
+    free(meter);
+}
+
+void vlc_loudness_Reset(vlc_loudness_t *meter)
+{
+    memset(meter->state, 0, 6 * meter->lanes * sizeof (float));
+    memset(meter->acc, 0, meter->lanes * sizeof (float));
+    for (unsigned l = 0; l < meter->lanes; l++)
+        meter->power[l] = 0.;
+    meter->peak = 0.f;
+    meter->sub_pos = 0;
+    meter->sub_count = 0;
+    memset(meter->bin_count, 0, sizeof (meter->bin_count));
+    for (unsigned i = 0; i < LOUDNESS_BINS; i++)
+        meter->bin_energy[i] = 0.;
+}
+
+static float Deinterleave(vlc_loudness_t *meter, const void *samples,
+                          unsigned frames)
+{
+    const unsigned channels = meter->channels, lanes = meter->lanes;
+    float *restrict buf = meter->buf;
+    float peak = 0.f;
+
+#define DEINTERLEAVE(type, expr) \
+    do { \
+        const type *in = samples; \
+        for (unsigned i = 0; i < frames; i++) \
+            for (unsigned c = 0; c < channels; c++) \
+            { \
+                const type v = in[i * channels + c]; \
+                const float f = (expr); \
+                buf[i * lanes + c] = f; \
+                peak = fmaxf(peak, fabsf(f)); \
+            } \
+    } while (0)
+
+    switch (meter->format)
+    {
+        case VLC_CODEC_FL32:
+            DEINTERLEAVE(float, v);
+            break;
+        case VLC_CODEC_FL64:
+            DEINTERLEAVE(double, v);
+            break;
+        case VLC_CODEC_S32N:
+            DEINTERLEAVE(int32_t, v * (1.f / 2147483648.f));
+            break;
+        case VLC_CODEC_S16N:
+            DEINTERLEAVE(int16_t, v * (1.f / 32768.f));
+            break;
+        case VLC_CODEC_U8:
+            DEINTERLEAVE(uint8_t, (v - 128) * (1.f / 128.f));
+            break;
+        default:
+            vlc_assert_unreachable();
+    }
+#undef DEINTERLEAVE
+    return peak;
+}
+
+static double EnergyToLoudness(double energy)
+{
+    return -0.691 + 10. * log10(energy);
+}
+
+/* Counts a gating block, if above the absolute gate */
+static void AddBlock(vlc_loudness_t *meter, double energy)
+{
+    if (!(energy > 0.))
+        return;
+
+    const double loudness = EnergyToLoudness(energy);
+    if (loudness <= LOUDNESS_GATE)
+        return;
+
+    unsigned bin = (loudness - LOUDNESS_GATE) / LOUDNESS_BIN_LU;
+    if (bin >= LOUDNESS_BINS)
+        bin = LOUDNESS_BINS - 1;
+    meter->bin_count[bin]++;
+    meter->bin_energy[bin] += energy;
+}
+
+static void EndSubBlock(vlc_loudness_t *meter)
+{
+    double energy = 0.;
+
+    for (unsigned c = 0; c < meter->channels; c++)
+    {
+        energy += meter->weights[c] * meter->power[c];
+        meter->power[c] = 0.;
+    }
+
+    meter->sub[meter->sub_count % LOUDNESS_SUBBLOCKS] =
+        energy / meter->sub_frames;
+    meter->sub_count++;
+    meter->sub_pos = 0;
+
+    if (meter->sub_count >= 4)
+    {
+        double block = 0.;
+
+        for (unsigned i = 1; i <= 4; i++)
+            block += meter->sub[(meter->sub_count - i) % LOUDNESS_SUBBLOCKS];
+        AddBlock(meter, block / 4.);
+    }
+}
+
+void vlc_loudness_Process(vlc_loudness_t *meter, const void *samples,
+                          size_t frames)
+{
+    const size_t framesize = meter->channels
+                           * aout_BitsPerSample(meter->format) / 8;
+    const uint8_t *in = samples;
+
+    while (frames > 0)
+    {
+        unsigned count = meter->sub_frames - meter->sub_pos;
+        if (count > LOUDNESS_CHUNK)
+            count = LOUDNESS_CHUNK;
+        if (count > frames)
+            count = frames;
+
+        meter->peak = fmaxf(meter->peak, Deinterleave(meter, in, count));
+        meter->kernel(meter->coeffs, meter->state, meter->buf, meter->acc,
+                      meter->lanes, count);
+
+        for (unsigned l = 0; l < meter->lanes; l++)
+        {
+            meter->power[l] += meter->acc[l];
+            meter->acc[l] = 0.f;
+        }
+        for (unsigned i = 0; i < 6 * meter->lanes; i++)
+            if (fabsf(meter->state[i]) < LOUDNESS_DENORMAL)
+                meter->state[i] = 0.f;
+
+        in += count * framesize;
+        frames -= count;
+        meter->sub_pos += count;
+        if (meter->sub_pos == meter->sub_frames)
+            EndSubBlock(meter);
+    }
+}
+
+double vlc_loudness_GetIntegrated(const vlc_loudness_t *meter)
+{
+    uint64_t count = 0;
+    double energy = 0.;
+
+    for (unsigned i = 0; i < LOUDNESS_BINS; i++)
+    {
+        count += meter->bin_count[i];
+        energy += meter->bin_energy[i];
+    }
+    if (count == 0)
+        return -INFINITY;
+
+    /* Relative gate, to the bin */
+    const double gate = EnergyToLoudness(energy / count) - 10.;
+    unsigned first = 0;
+    if (gate > LOUDNESS_GATE)
+        first = (gate - LOUDNESS_GATE) / LOUDNESS_BIN_LU;
+
+    count = 0;
+    energy = 0.;
+    for (unsigned i = first; i < LOUDNESS_BINS; i++)
+    {
+        count += meter->bin_count[i];
+        energy += meter->bin_energy[i];
+    }
+    assert(count > 0);
+    return EnergyToLoudness(energy / count);
+}
+
+static double GetLast(const vlc_loudness_t *meter, unsigned count)
+{
+    if (meter->sub_count < count)
+        count = meter->sub_count;
+    if (count == 0)
+        return -INFINITY;
+
+    double energy = 0.;
+    for (unsigned i = 1; i <= count; i++)
+        energy += meter->sub[(meter->sub_count - i) % LOUDNESS_SUBBLOCKS];
+    return energy > 0. ? EnergyToLoudness(energy / count) : -INFINITY;
+}
+
+double vlc_loudness_GetMomentary(const vlc_loudness_t *meter)
+{
+    if (meter->sub_count < 4)
+        return -INFINITY;
+    return GetLast(meter, 4);
+}
+
+double vlc_loudness_GetShortTerm(const vlc_loudness_t *meter)
+{
+    return GetLast(meter, LOUDNESS_SUBBLOCKS);
+}
+
+float vlc_loudness_GetPeak(const vlc_loudness_t *meter)
+{
+    return meter->peak;
+}
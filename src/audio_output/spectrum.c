@@ -0,0 +1,342 @@
+/*****************************************************************************
+ * spectrum.c: shared spectrum analysis of audio blocks
+ *****************************************************************************
+ * Copyright (C) 2014 Ronald Wright
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_configuration.h>
+#include <vlc_fft.h>
+#include <vlc_list.h>
+#include <vlc_spectrum.h>
+
+/* Spectra kept per analysis: enough for the users of a block to catch up
+ * with the first one, as the visualizations run in their own threads */
+#define SPECTRUM_CACHE 8
+
+struct vlc_spectrum_entry
+{
+    vlc_tick_t pts;
+    unsigned samples;
+    unsigned channels;
+    float *power;
+};
+
+struct vlc_spectrum
+{
+    struct vlc_list node;
+    vlc_object_t *owner;
+    struct vlc_spectrum_cfg cfg;
+    unsigned refs; /* protected by the registry lock */
+
+    vlc_mutex_t lock;
+    vlc_fft_t *fft;
+    float *window; /* NULL for no window */
+    float *in, *re, *im;
+    struct vlc_spectrum_entry cache[SPECTRUM_CACHE];
+    unsigned next; /* oldest cache entry */
+};
+
+static vlc_mutex_t registry_lock = VLC_STATIC_MUTEX;
+static struct vlc_list registry = VLC_LIST_INITIALIZER(&registry);
+
+static const char *const window_names[] = {
+    "none", "hann", "flattop", "blackmanharris", "kaiser",
+};
+
+/* Flat top window coefficients */
+#define FT_A0 1.000f
+#define FT_A1 1.930f
+#define FT_A2 1.290f
+#define FT_A3 0.388f
+#define FT_A4 0.028f
+
+/* Blackman-Harris window coefficients */
+#define BH_A0 0.35875f
+#define BH_A1 0.48829f
+#define BH_A2 0.14128f
+#define BH_A3 0.01168f
+
+/*
+ * The modified Bessel function I0(x).  See Chapter 6 of the "Numerical Recipes
+ * in C: The Art of Scientific Computing" book at
+ * http://www.aip.de/groups/soe/local/numres/bookcpdf/c6-6.pdf
+ */
+static float bessi0(float x)
+{
+    float ax, ans;
+    double y; /* Accumulate polynomials in double precision. */
+    if ((ax = fabsf(x)) < 3.75f) /* Polynomial fit. */
+    {
+        y = x / 3.75;
+        y *= y;
+        ans = 1.0 + y * (3.5156229 + y * (3.0899424 + y * (1.2067492
+                  + y * (0.2659732 + y * (0.360768e-1
+                  + y * 0.45813e-2)))));
+    }
+    else
+    {
+        y = 3.75 / ax;
+        ans = (exp(ax) / sqrt(ax)) * (0.39894228 + y * (0.1328592e-1
+            + y * (0.225319e-2 + y * (-0.157565e-2 + y * (0.916281e-2
+            + y * (-0.2057706e-1 + y * (0.2635537e-1 + y * (-0.1647633e-1
+            + y * 0.392377e-2))))))));
+    }
+    return ans;
+}
+
+static float *WindowNew(const struct vlc_spectrum_cfg *cfg)
+{
+    const unsigned n = cfg->size;
+    float *table = vlc_alloc(n, sizeof (*table));
+    if (unlikely(table == NULL))
+        return NULL;
+
+    const float pi_alpha = (float)M_PI * cfg->kaiser_alpha;
+    const float bessi0_pi_alpha = bessi0(pi_alpha);
+
+    for (unsigned i = 0; i < n; i++)
+    {
+        const float x = (float)i / (float)(n - 1);
+        const float phi = 2.f * (float)M_PI * x;
+
+        switch (cfg->window)
+        {
+            case VLC_SPECTRUM_WINDOW_HANN:
+                table[i] = .5f - .5f * cosf(phi);
+                break;
+            case VLC_SPECTRUM_WINDOW_FLATTOP:
+                table[i] = FT_A0 - FT_A1 * cosf(phi) + FT_A2 * cosf(2.f * phi)
+                         - FT_A3 * cosf(3.f * phi) + FT_A4 * cosf(4.f * phi);
+                break;
+            case VLC_SPECTRUM_WINDOW_BLACKMANHARRIS:
+                table[i] = BH_A0 - BH_A1 * cosf(phi) + BH_A2 * cosf(2.f * phi)
+                         - BH_A3 * cosf(3.f * phi);
+                break;
+            case VLC_SPECTRUM_WINDOW_KAISER:
+            {
+                const float t = 2.f * x - 1.f;
+                table[i] = bessi0(pi_alpha * sqrtf(1.f - t * t))
+                         / bessi0_pi_alpha;
+                break;
+            }
+            default:
+                vlc_assert_unreachable();
+        }
+    }
+    return table;
+}
+
+void vlc_spectrum_GetConfig(vlc_object_t *obj, unsigned size,
+                            struct vlc_spectrum_cfg *cfg)
+{
+    cfg->size = size;
+    cfg->window = VLC_SPECTRUM_WINDOW_NONE;
+    cfg->kaiser_alpha = 0.f;
+
+    /* The variables are defined by the visualization plugins */
+    if (config_FindConfig("effect-kaiser-param") != NULL)
+        cfg->kaiser_alpha = var_InheritFloat(obj, "effect-kaiser-param");
+    if (config_FindConfig("effect-fft-window") == NULL)
+        return;
+
+    char *name = var_InheritString(obj, "effect-fft-window");
+    if (name == NULL)
+        return;
+
+    for (size_t i = 0; i < ARRAY_SIZE(window_names); i++)
+        if (!strcasecmp(name, window_names[i]))
+        {
+            cfg->window = i;
+            break;
+        }
+    free(name);
+}
+
+static bool CfgEqual(const struct vlc_spectrum_cfg *a,
+                     const struct vlc_spectrum_cfg *b)
+{
+    return a->size == b->size && a->window == b->window
+        && (a->window != VLC_SPECTRUM_WINDOW_KAISER
+         || a->kaiser_alpha == b->kaiser_alpha);
+}
+
+static void Destroy(vlc_spectrum_t *sp)
+{
+    for (unsigned i = 0; i < SPECTRUM_CACHE; i++)
+        free(sp->cache[i].power);
+    free(sp->im);
+    free(sp->re);
+    free(sp->in);
+    free(sp->window);
+    if (sp->fft != NULL)
+        vlc_fft_Delete(sp->fft);
+    vlc_mutex_destroy(&sp->lock);
+    free(sp);
+}
+
+static vlc_spectrum_t *Create(vlc_object_t *owner,
+                              const struct vlc_spectrum_cfg *cfg)
+{
+    vlc_spectrum_t *sp = calloc(1, sizeof (*sp));
+    if (unlikely(sp == NULL))
+        return NULL;
+
+    sp->owner = owner;
+    sp->cfg = *cfg;
+    sp->refs = 1;
+    vlc_mutex_init(&sp->lock);
+
+    const unsigned bins = cfg->size / 2 + 1;
+
+    sp->fft = vlc_fft_New(cfg->size);
+    sp->in = vlc_alloc(cfg->size, sizeof (float));
+    sp->re = vlc_alloc(bins, sizeof (float));
+    sp->im = vlc_alloc(bins, sizeof (float));
+    if (sp->fft == NULL || sp->in == NULL || sp->re == NULL || sp->im == NULL)
+        goto error;
+
+    if (cfg->window != VLC_SPECTRUM_WINDOW_NONE)
+    {
+        sp->window = WindowNew(cfg);
+        if (sp->window == NULL)
+            goto error;
+    }
+
+    for (unsigned i = 0; i < SPECTRUM_CACHE; i++)
+    {
+        sp->cache[i].pts = VLC_TICK_INVALID;
+        sp->cache[i].power = vlc_alloc(bins, sizeof (float));
+        if (unlikely(sp->cache[i].power == NULL))
+            goto error;
+    }
+    return sp;
+
+error:
+    Destroy(sp);
+    return NULL;
+}
+
+vlc_spectrum_t *vlc_spectrum_Hold(vlc_object_t *owner,
+                                  const struct vlc_spectrum_cfg *cfg)
+{
+    vlc_spectrum_t *sp;
+
+    vlc_mutex_lock(&registry_lock);
+    vlc_list_foreach(sp, &registry, node)
+        if (sp->owner == owner && CfgEqual(&sp->cfg, cfg))
+        {
+            sp->refs++;
+            vlc_mutex_unlock(&registry_lock);
+            return sp;
+        }
+
+    sp = Create(owner, cfg);
+    if (sp != NULL)
+        vlc_list_append(&sp->node, &registry);
+    else
+        msg_Err(owner, "cannot create the %u samples spectrum analysis",
+                cfg->size);
+    vlc_mutex_unlock(&registry_lock);
+    return sp;
+}
+
+void vlc_spectrum_Release(vlc_spectrum_t *sp)
+{
+    vlc_mutex_lock(&registry_lock);
+    assert(sp->refs > 0);
+    if (--sp->refs > 0)
+    {
+        vlc_mutex_unlock(&registry_lock);
+        return;
+    }
+    vlc_list_remove(&sp->node);
+    vlc_mutex_unlock(&registry_lock);
+
+    Destroy(sp);
+}
+
+int vlc_spectrum_Compute(vlc_spectrum_t *sp, const block_t *block,
+                         unsigned channels, float *power)
+{
+    const unsigned size = sp->cfg.size, bins = size / 2 + 1;
+
+    if (block->i_nb_samples == 0 || channels == 0)
+        return VLC_EGENERIC;
+
+    vlc_mutex_lock(&sp->lock);
+
+    if (block->i_pts != VLC_TICK_INVALID)
+        for (unsigned i = 0; i < SPECTRUM_CACHE; i++)
+        {
+            const struct vlc_spectrum_entry *e = &sp->cache[i];
+
+            if (e->pts == block->i_pts && e->samples == block->i_nb_samples
+             && e->channels == channels)
+            {
+                memcpy(power, e->power, bins * sizeof (*power));
+                vlc_mutex_unlock(&sp->lock);
+                return VLC_SUCCESS;
+            }
+        }
+
+    /* First channel, repeated up to the analysis size */
+    const float *samples = (const float *)block->p_buffer;
+    for (unsigned i = 0, j = 0; i < size; i++)
+    {
+        sp->in[i] = samples[j * channels];
+        if (++j == block->i_nb_samples)
+            j = 0;
+    }
+    if (sp->window != NULL)
+        for (unsigned i = 0; i < size; i++)
+            sp->in[i] *= sp->window[i];
+
+    vlc_fft_Real(sp->fft, sp->in, sp->re, sp->im);
+
+    for (unsigned k = 0; k < bins; k++)
+        power[k] = sp->re[k] * sp->re[k] + sp->im[k] * sp->im[k];
+    /* Keep the constant and highest frequency terms in scale with the other
+     * terms */
+    power[0] /= 4.f;
+    power[bins - 1] /= 4.f;
+
+    if (block->i_pts != VLC_TICK_INVALID)
+    {
+        struct vlc_spectrum_entry *e = &sp->cache[sp->next];
+
+        e->pts = block->i_pts;
+        e->samples = block->i_nb_samples;
+        e->channels = channels;
+        memcpy(e->power, power, bins * sizeof (*power));
+        sp->next = (sp->next + 1) % SPECTRUM_CACHE;
+    }
+
+    vlc_mutex_unlock(&sp->lock);
+    return VLC_SUCCESS;
+}
@@ -30,6 +30,7 @@
 #endif
 #include <assert.h>
 #include <stdatomic.h>
+#include <time.h>
 
 #include <vlc_common.h>
 #include <vlc_block.h>
@@ -41,6 +42,7 @@
 #include <vlc_meta.h>
 #include <vlc_dialog.h>
 #include <vlc_modules.h>
+#include <vlc_loudness.h>
 
 #include "audio_output/aout_internal.h"
 #include "stream_output/stream_output.h"
@@ -129,6 +131,23 @@ struct decoder_owner
     atomic_bool drained;
     bool b_idle;
 
+    /* CPU time used by the decoder thread */
+    atomic_uintmax_t cpu_time;
+
+    /* Skip level, driven by the video output lateness. The windows are
+     * updated by the threads queuing pictures, and reset by flushes, under
+     * the owner lock. */
+    struct
+    {
+        atomic_int level; /* enum decoder_skip_level */
+        vlc_tick_t window_start;
+        unsigned   lost;
+        vlc_tick_t late;
+        unsigned   good;  /* consecutive windows without late pictures */
+        unsigned   hold;  /* good windows required to lower the level */
+        bool       lowered;
+    } skip;
+
     /* CC */
 #define MAX_CC_DECODERS 64 /* The es_out only creates one type of es */
     struct
@@ -140,6 +159,9 @@ struct decoder_owner
         sout_packetizer_input_t *p_sout_input;
     } cc;
 
+    /* Loudness scan, instead of the audio output */
+    vlc_loudness_t *loudness;
+
     /* Mouse event */
     vlc_mutex_t     mouse_lock;
     vlc_mouse_event mouse_event;
@@ -150,6 +172,16 @@ struct decoder_owner
  * a bogus PTS and won't be displayed */
 #define DECODER_BOGUS_VIDEO_DELAY                ((vlc_tick_t)(DEFAULT_PTS_DELAY * 30))
 
+/* The skip level is reevaluated once per window: it is raised by one step
+ * if a picture was dropped or late by more than the threshold, and lowered by
+ * one step after "hold" good windows in a row. The hold is doubled each time
+ * the level has to be raised again before coming back to no skipping, so
+ * that it does not oscillate around the capacity of the machine. */
+#define DECODER_SKIP_WINDOW              VLC_TICK_FROM_MS(500)
+#define DECODER_SKIP_LATE_THRESHOLD      VLC_TICK_FROM_MS(20)
+#define DECODER_SKIP_HOLD_MIN            4
+#define DECODER_SKIP_HOLD_MAX            64
+
 /* */
 #define DECODER_SPU_VOUT_WAIT_DURATION   VLC_TICK_FROM_MS(200)
 #define BLOCK_FLAG_CORE_PRIVATE_RELOADED (1 << BLOCK_FLAG_CORE_PRIVATE_SHIFT)
@@ -693,6 +725,13 @@ static float DecoderGetDisplayRate( decoder_t *p_dec )
     return rate;
 }
 
+static enum decoder_skip_level DecoderGetSkipLevel( decoder_t *p_dec )
+{
+    struct decoder_owner *p_owner = dec_get_owner( p_dec );
+
+    return atomic_load_explicit( &p_owner->skip.level, memory_order_relaxed );
+}
+
 /*****************************************************************************
  * Public functions
  *****************************************************************************/
@@ -1045,24 +1084,104 @@ discard:
     picture_Release( p_picture );
 }
 
+static void DecoderResetSkip( struct decoder_owner *p_owner )
+{
+    vlc_mutex_assert( &p_owner->lock );
+    p_owner->skip.window_start = VLC_TICK_INVALID;
+    p_owner->skip.lost = 0;
+    p_owner->skip.late = 0;
+    p_owner->skip.good = 0;
+}
+
+static void DecoderUpdateSkip( struct decoder_owner *p_owner,
+                               unsigned lost, vlc_tick_t late )
+{
+    decoder_t *p_dec = &p_owner->dec;
+    const vlc_tick_t now = vlc_tick_now();
+
+    vlc_mutex_assert( &p_owner->lock );
+
+    if( !p_dec->b_frame_drop_allowed )
+        return;
+
+    if( p_owner->skip.window_start == VLC_TICK_INVALID )
+        p_owner->skip.window_start = now;
+    p_owner->skip.lost += lost;
+    if( late > p_owner->skip.late )
+        p_owner->skip.late = late;
+
+    if( now - p_owner->skip.window_start < DECODER_SKIP_WINDOW )
+        return;
+
+    int level = atomic_load_explicit( &p_owner->skip.level,
+                                      memory_order_relaxed );
+
+    if( p_owner->skip.lost > 0
+     || p_owner->skip.late > DECODER_SKIP_LATE_THRESHOLD )
+    {
+        if( level < DECODER_SKIP_NONKEY )
+        {
+            if( p_owner->skip.lowered )
+            {
+                /* Lowered too early: wait longer next time */
+                p_owner->skip.hold = __MIN( p_owner->skip.hold * 2,
+                                            DECODER_SKIP_HOLD_MAX );
+                p_owner->skip.lowered = false;
+            }
+            level++;
+            msg_Dbg( p_dec, "raising skip level to %d (%u lost, %"PRId64
+                     " ms late)", level, p_owner->skip.lost,
+                     MS_FROM_VLC_TICK(p_owner->skip.late) );
+        }
+        p_owner->skip.good = 0;
+    }
+    else if( ++p_owner->skip.good >= p_owner->skip.hold )
+    {
+        if( level > DECODER_SKIP_NONE )
+        {
+            level--;
+            p_owner->skip.lowered = true;
+            msg_Dbg( p_dec, "lowering skip level to %d", level );
+        }
+        else
+        {
+            /* Stable without skipping: forget the previous oscillations */
+            p_owner->skip.hold = DECODER_SKIP_HOLD_MIN;
+            p_owner->skip.lowered = false;
+        }
+        p_owner->skip.good = 0;
+    }
+
+    atomic_store_explicit( &p_owner->skip.level, level, memory_order_relaxed );
+    p_owner->skip.window_start = now;
+    p_owner->skip.lost = 0;
+    p_owner->skip.late = 0;
+}
+
 static void DecoderUpdateStatVideo( struct decoder_owner *p_owner,
                                     unsigned decoded, unsigned lost )
 {
     input_thread_t *p_input = p_owner->p_input;
     unsigned displayed = 0;
 
-    /* Update ugly stat */
-    if( p_input == NULL )
-        return;
-
     if( p_owner->p_vout != NULL )
     {
         unsigned vout_lost = 0;
+        vlc_tick_t late = 0;
 
-        vout_GetResetStatistic( p_owner->p_vout, &displayed, &vout_lost );
+        vout_GetResetStatistic( p_owner->p_vout, &displayed, &vout_lost,
+                                &late );
+        /* Pictures can be queued by decoder threads while flushing */
+        vlc_mutex_lock( &p_owner->lock );
+        DecoderUpdateSkip( p_owner, vout_lost, late );
+        vlc_mutex_unlock( &p_owner->lock );
         lost += vout_lost;
     }
 
+    /* Update ugly stat */
+    if( p_input == NULL )
+        return;
+
     struct input_stats *stats = input_priv(p_input)->stats;
 
     if( stats != NULL )
@@ -1235,6 +1354,62 @@ static void DecoderQueueAudio( decoder_t *p_dec, block_t *p_aout_buf )
     p_owner->pf_update_stat( p_owner, 1, lost );
 }
 
+static int loudness_update_format( decoder_t *p_dec )
+{
+    struct decoder_owner *p_owner = dec_get_owner( p_dec );
+
+    p_dec->fmt_out.audio.i_format = p_dec->fmt_out.i_codec;
+    if( p_owner->loudness != NULL &&
+        AOUT_FMTS_IDENTICAL( &p_dec->fmt_out.audio, &p_owner->fmt.audio ) )
+        return 0;
+
+    audio_sample_format_t format = p_dec->fmt_out.audio;
+    aout_FormatPrepare( &format );
+
+    /* A format change restarts the measurement */
+    if( p_owner->loudness != NULL )
+        vlc_loudness_Delete( p_owner->loudness );
+    p_owner->loudness = vlc_loudness_New( &format );
+
+    vlc_mutex_lock( &p_owner->lock );
+    DecoderUpdateFormatLocked( p_dec );
+    aout_FormatPrepare( &p_owner->fmt.audio );
+    vlc_mutex_unlock( &p_owner->lock );
+
+    if( p_owner->loudness == NULL )
+    {
+        msg_Err( p_dec, "cannot measure the loudness of %4.4s samples",
+                 (const char *)&format.i_format );
+        return -1;
+    }
+
+    p_dec->fmt_out.audio.i_bytes_per_frame = format.i_bytes_per_frame;
+    p_dec->fmt_out.audio.i_frame_length = format.i_frame_length;
+    return 0;
+}
+
+static void DecoderQueueLoudness( decoder_t *p_dec, block_t *p_audio )
+{
+    struct decoder_owner *p_owner = dec_get_owner( p_dec );
+
+    /* Wait for the end of the buffering, as for the audio output */
+    vlc_mutex_lock( &p_owner->lock );
+    if( p_owner->b_waiting )
+    {
+        p_owner->b_has_data = true;
+        vlc_cond_signal( &p_owner->wait_acknowledge );
+    }
+    DecoderWaitUnblock( p_dec );
+    vlc_mutex_unlock( &p_owner->lock );
+
+    if( p_owner->loudness != NULL )
+        vlc_loudness_Process( p_owner->loudness, p_audio->p_buffer,
+                              p_audio->i_nb_samples );
+    block_Release( p_audio );
+
+    p_owner->pf_update_stat( p_owner, 1, 0 );
+}
+
 static void DecoderPlaySpu( decoder_t *p_dec, subpicture_t *p_subpic )
 {
     struct decoder_owner *p_owner = dec_get_owner( p_dec );
@@ -1476,6 +1651,8 @@ static void DecoderProcessFlush( decoder_t *p_dec )
     {
         if( p_owner->p_vout )
             vout_FlushAll( p_owner->p_vout );
+        /* Flushed pictures must not count as late ones */
+        DecoderResetSkip( p_owner );
     }
     else if( p_dec->fmt_out.i_cat == SPU_ES )
     {
@@ -1564,6 +1741,46 @@ static void OutputChangeDelay( decoder_t *p_dec, vlc_tick_t delay )
  *
  * \param p_dec the decoder
  */
+/* CPU time used by the calling thread, 0 if unknown */
+static vlc_tick_t DecoderGetCPUTime( void )
+{
+#ifdef CLOCK_THREAD_CPUTIME_ID
+    struct timespec ts;
+
+    if( clock_gettime( CLOCK_THREAD_CPUTIME_ID, &ts ) == 0 )
+        return vlc_tick_from_timespec( &ts );
+#endif
+    return 0;
+}
+
+static void DecoderAddCPUTime( struct decoder_owner *p_owner,
+                               vlc_tick_t cpu_time )
+{
+    input_thread_t *p_input = p_owner->p_input;
+
+    atomic_fetch_add_explicit( &p_owner->cpu_time, cpu_time,
+                               memory_order_relaxed );
+
+    if( p_input == NULL || input_priv(p_input)->stats == NULL )
+        return;
+
+    struct input_stats *stats = input_priv(p_input)->stats;
+
+    switch( p_owner->dec.fmt_in.i_cat )
+    {
+        case VIDEO_ES:
+            atomic_fetch_add_explicit(&stats->video_cpu_time, cpu_time,
+                                      memory_order_relaxed);
+            break;
+        case AUDIO_ES:
+            atomic_fetch_add_explicit(&stats->audio_cpu_time, cpu_time,
+                                      memory_order_relaxed);
+            break;
+        default:
+            break;
+    }
+}
+
 static void *DecoderThread( void *p_data )
 {
     decoder_t *p_dec = (decoder_t *)p_data;
@@ -1687,7 +1904,9 @@ static void *DecoderThread( void *p_data )
         vlc_fifo_Unlock( p_owner->p_fifo );
 
         int canc = vlc_savecancel();
+        vlc_tick_t cpu_time = DecoderGetCPUTime();
         DecoderProcess( p_dec, p_block );
+        DecoderAddCPUTime( p_owner, DecoderGetCPUTime() - cpu_time );
 
         if( p_block == NULL && p_dec->fmt_out.i_cat == AUDIO_ES )
         {   /* Draining: the decoder is drained and all decoded buffers are
@@ -1695,6 +1914,13 @@ static void *DecoderThread( void *p_data )
             if( p_owner->p_aout != NULL )
                 aout_DecDrain( p_owner->p_aout );
         }
+        else if( p_block == NULL && p_dec->fmt_out.i_cat == VIDEO_ES )
+        {   /* Likewise, the pictures still in the video filters */
+            vlc_mutex_lock( &p_owner->lock );
+            if( p_owner->p_vout != NULL )
+                vout_Drain( p_owner->p_vout );
+            vlc_mutex_unlock( &p_owner->lock );
+        }
         vlc_restorecancel( canc );
 
         /* TODO? Wait for draining instead of polling. */
@@ -1721,6 +1947,7 @@ static const struct decoder_owner_callbacks dec_video_cbs =
         .queue_cc = DecoderQueueCc,
         .get_display_date = DecoderGetDisplayDate,
         .get_display_rate = DecoderGetDisplayRate,
+        .get_skip_level = DecoderGetSkipLevel,
     },
     .get_attachments = DecoderGetInputAttachments,
 };
@@ -1741,6 +1968,14 @@ static const struct decoder_owner_callbacks dec_audio_cbs =
     },
     .get_attachments = DecoderGetInputAttachments,
 };
+static const struct decoder_owner_callbacks dec_loudness_cbs =
+{
+    .audio = {
+        .format_update = loudness_update_format,
+        .queue = DecoderQueueLoudness,
+    },
+    .get_attachments = DecoderGetInputAttachments,
+};
 static const struct decoder_owner_callbacks dec_spu_cbs =
 {
     .spu = {
@@ -1777,6 +2012,7 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
     p_owner->p_input = p_input;
     p_owner->p_resource = p_resource;
     p_owner->p_aout = NULL;
+    p_owner->loudness = NULL;
     p_owner->p_vout = NULL;
     p_owner->i_spu_channel = 0;
     p_owner->i_spu_order = 0;
@@ -1809,6 +2045,16 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
     p_owner->mouse_event = NULL;
     p_owner->mouse_opaque = NULL;
 
+    atomic_init( &p_owner->cpu_time, 0 );
+
+    atomic_init( &p_owner->skip.level, DECODER_SKIP_NONE );
+    p_owner->skip.window_start = VLC_TICK_INVALID;
+    p_owner->skip.lost = 0;
+    p_owner->skip.late = 0;
+    p_owner->skip.good = 0;
+    p_owner->skip.hold = DECODER_SKIP_HOLD_MIN;
+    p_owner->skip.lowered = false;
+
     es_format_Init( &p_owner->fmt, fmt->i_cat, 0 );
 
     /* decoder fifo */
@@ -1855,7 +2101,10 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
             p_owner->pf_update_stat = DecoderUpdateStatVideo;
             break;
         case AUDIO_ES:
-            p_dec->cbs = &dec_audio_cbs;
+            if( !p_input || !input_priv( p_input )->b_loudness_scan )
+                p_dec->cbs = &dec_audio_cbs;
+            else
+                p_dec->cbs = &dec_loudness_cbs;
             p_owner->pf_update_stat = DecoderUpdateStatAudio;
             break;
         case SPU_ES:
@@ -1915,6 +2164,10 @@ static void DeleteDecoder( decoder_t * p_dec )
 
     msg_Dbg( p_dec, "killing decoder fourcc `%4.4s'",
              (char*)&p_dec->fmt_in.i_codec );
+    vlc_tick_t cpu_time = atomic_load( &p_owner->cpu_time );
+    if( cpu_time > 0 )
+        msg_Dbg( p_dec, "decoding used %.3f s of CPU time",
+                 secf_from_vlc_tick( cpu_time ) );
 
     const enum es_format_category_e i_cat =p_dec->fmt_in.i_cat;
     decoder_Clean( p_dec );
@@ -1941,6 +2194,13 @@ static void DeleteDecoder( decoder_t * p_dec )
                 aout_DecDelete( p_owner->p_aout );
                 input_resource_PutAout( p_owner->p_resource, p_owner->p_aout );
             }
+            if( p_owner->loudness != NULL )
+            {
+                input_SendEventLoudness( p_owner->p_input,
+                    vlc_loudness_GetIntegrated( p_owner->loudness ),
+                    vlc_loudness_GetPeak( p_owner->loudness ) );
+                vlc_loudness_Delete( p_owner->loudness );
+            }
             break;
         case VIDEO_ES: {
             vout_thread_t *vout = p_owner->p_vout;
@@ -2159,6 +2419,11 @@ void input_DecoderDecode( decoder_t *p_dec, block_t *p_block, bool b_do_pace )
 {
     struct decoder_owner *p_owner = dec_get_owner( p_dec );
 
+    /* Decoders and packetizers may modify their input in place */
+    p_block = block_Unshare( p_block );
+    if( unlikely(p_block == NULL) )
+        return;
+
     vlc_fifo_Lock( p_owner->p_fifo );
     if( !b_do_pace )
     {
@@ -2509,6 +2774,13 @@ size_t input_DecoderGetFifoSize( decoder_t *p_dec )
     return block_FifoSize( p_owner->p_fifo );
 }
 
+vlc_tick_t input_DecoderGetCPUTime( decoder_t *p_dec )
+{
+    struct decoder_owner *p_owner = dec_get_owner( p_dec );
+
+    return atomic_load_explicit( &p_owner->cpu_time, memory_order_relaxed );
+}
+
 void input_DecoderSetVoutMouseEvent( decoder_t *dec, vlc_mouse_event mouse_event,
                                     void *user_data )
 {
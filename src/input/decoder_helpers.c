@@ -26,11 +26,14 @@
 # include "config.h"
 #endif
 
+#include <assert.h>
+
 #include <vlc_common.h>
 #include <vlc_codec.h>
 #include <vlc_atomic.h>
 #include <vlc_meta.h>
 #include <vlc_modules.h>
+#include "../libvlc.h"
 
 void decoder_Init( decoder_t *p_dec, const es_format_t *restrict p_fmt )
 {
@@ -74,6 +77,93 @@ void decoder_Destroy( decoder_t *p_dec )
     }
 }
 
+struct decoder_threads_t
+{
+    unsigned count;  /* number of threads the decoder may use */
+    uint64_t weight; /* weight of the decoder in the budget */
+    struct vlc_list node; /* grants of the instance */
+};
+
+static vlc_mutex_t threads_lock = VLC_STATIC_MUTEX;
+
+decoder_threads_t *decoder_RequestThreads( decoder_t *dec, unsigned wanted,
+                                           unsigned *count )
+{
+    libvlc_priv_t *priv = libvlc_priv( vlc_object_instance( dec ) );
+    uint64_t pixels = 1920 * 1080; /* unknown size */
+
+    decoder_threads_t *threads = malloc( sizeof (*threads) );
+    if( unlikely(threads == NULL) )
+    {
+        *count = 1;
+        return NULL;
+    }
+
+    if( dec->fmt_in.i_cat == VIDEO_ES
+     && dec->fmt_in.video.i_width > 0 && dec->fmt_in.video.i_height > 0 )
+        pixels = (uint64_t)dec->fmt_in.video.i_width
+               * dec->fmt_in.video.i_height;
+
+    int64_t priority = var_InheritInteger( dec, "dec-threads-priority" );
+    int64_t budget = var_InheritInteger( dec, "dec-threads" );
+    if( budget <= 0 )
+        budget = vlc_GetCPUCount() + 1;
+
+    threads->weight = pixels * __MAX( priority, 1 );
+
+    vlc_mutex_lock( &threads_lock );
+    uint64_t weight = priv->dec_threads.weight + threads->weight;
+    /* Rounded up, so that a single decoder gets the whole budget */
+    uint64_t share = (budget * threads->weight + weight - 1) / weight;
+
+    /* Threads left, plus the ones granted beyond their new share to the
+     * decoders opened earlier, which would starve this one otherwise */
+    uint64_t left = budget > priv->dec_threads.used
+                  ? budget - priv->dec_threads.used : 0;
+    decoder_threads_t *other;
+    vlc_list_foreach( other, &priv->dec_threads.grants, node )
+    {
+        uint64_t other_share = (budget * other->weight + weight - 1) / weight;
+        if( other->count > other_share )
+            left += other->count - other_share;
+    }
+
+    threads->count = __MIN( wanted, __MIN( share, left ) );
+    if( threads->count == 0 )
+        threads->count = 1;
+    priv->dec_threads.weight = weight;
+    priv->dec_threads.used += threads->count;
+    vlc_list_append( &threads->node, &priv->dec_threads.grants );
+    unsigned used = priv->dec_threads.used;
+    vlc_mutex_unlock( &threads_lock );
+
+    msg_Dbg( dec, "granted %u of %u wanted thread(s), share %"PRIu64", "
+             "%u/%"PRId64" in use", threads->count, wanted, share, used,
+             budget );
+    *count = threads->count;
+    return threads;
+}
+
+void decoder_ReleaseThreads( decoder_t *dec, decoder_threads_t *threads )
+{
+    libvlc_priv_t *priv = libvlc_priv( vlc_object_instance( dec ) );
+
+    if( threads == NULL )
+        return;
+
+    /* The threads and the weight go back to the budget, for the shares of
+     * the next decoders */
+    vlc_mutex_lock( &threads_lock );
+    assert( priv->dec_threads.used >= threads->count );
+    assert( priv->dec_threads.weight >= threads->weight );
+    priv->dec_threads.used -= threads->count;
+    priv->dec_threads.weight -= threads->weight;
+    vlc_list_remove( &threads->node );
+    vlc_mutex_unlock( &threads_lock );
+
+    free( threads );
+}
+
 int decoder_UpdateVideoFormat( decoder_t *dec )
 {
     vlc_assert( dec->fmt_in.i_cat == VIDEO_ES && dec->cbs != NULL );
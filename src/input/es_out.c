@@ -118,6 +118,9 @@ struct es_out_id_t
     decoder_t   *p_dec_record;
     vlc_clock_t *p_clock;
 
+    /* CPU time of the decoder in the info, -1 if not shown */
+    vlc_tick_t  i_cpu_time;
+
     /* Fields for Video with CC */
     struct
     {
@@ -208,6 +211,9 @@ typedef struct
     /* Used only to limit debugging output */
     int         i_prev_stream_level;
 
+    /* Last update of the CPU time of the decoders in the info */
+    vlc_tick_t  i_cpu_time_update;
+
     es_out_t out;
 } es_out_sys_t;
 
@@ -217,6 +223,7 @@ static void         EsOutDel    ( es_out_t *, es_out_id_t * );
 static void         EsOutTerminate( es_out_t * );
 static void         EsOutSelect( es_out_t *, es_out_id_t *es, bool b_force );
 static void         EsOutUpdateInfo( es_out_t *, es_out_id_t *es, const vlc_meta_t * );
+static void         EsOutUpdateCPUTime( es_out_t * );
 static int          EsOutSetRecord(  es_out_t *, bool b_record );
 
 static bool EsIsSelected( es_out_id_t *es );
@@ -362,6 +369,7 @@ es_out_t *input_EsOutNew( input_thread_t *p_input, float rate )
     }
 
     p_sys->i_pause_date = -1;
+    p_sys->i_cpu_time_update = VLC_TICK_INVALID;
 
     p_sys->rate = rate;
 
@@ -1753,6 +1761,7 @@ static es_out_id_t *EsOutAddSlaveLocked( es_out_t *out, const es_format_t *fmt,
     es->p_dec = NULL;
     es->p_dec_record = NULL;
     es->p_clock = NULL;
+    es->i_cpu_time = -1;
     es->cc.type = 0;
     es->cc.i_bitmap = 0;
     es->p_master = p_master;
@@ -1878,6 +1887,7 @@ static void EsOutSelectEs( es_out_t *out, es_out_id_t *es )
     es_out_sys_t *p_sys = container_of(out, es_out_sys_t, out);
     input_thread_t *p_input = p_sys->p_input;
     bool b_thumbnailing = input_priv(p_input)->b_thumbnailing;
+    bool b_loudness_scan = input_priv(p_input)->b_loudness_scan;
 
     if( EsIsSelected( es ) )
     {
@@ -1907,7 +1917,8 @@ static void EsOutSelectEs( es_out_t *out, es_out_id_t *es )
         {
             if( es->fmt.i_cat == VIDEO_ES || es->fmt.i_cat == SPU_ES )
             {
-                if( !var_GetBool( p_input, b_sout ? "sout-video" : "video" ) )
+                if( !var_GetBool( p_input, b_sout ? "sout-video" : "video" )
+                 || b_loudness_scan )
                 {
                     msg_Dbg( p_input, "video is disabled, not selecting ES 0x%x",
                              es->fmt.i_id );
@@ -3011,6 +3022,7 @@ static int EsOutVaControlLocked( es_out_t *out, int i_query, va_list args )
         vlc_tick_t i_length = va_arg( args, vlc_tick_t );
 
         input_SendEventLength( p_sys->p_input, i_length );
+        EsOutUpdateCPUTime( out );
 
         if( !p_sys->b_buffering )
         {
@@ -3719,10 +3731,57 @@ static void EsOutUpdateInfo( es_out_t *out, es_out_id_t *es, const vlc_meta_t *p
     }
     /* */
     input_item_ReplaceInfos( p_item, p_cat );
+    es->i_cpu_time = -1; /* replaced */
     if( !input_priv(p_input)->b_preparsing  )
         input_SendEventMetaInfo( p_input );
 }
 
+/* Shows the CPU time of each decoder in the info of its stream, next to
+ * the total of the input in the statistics */
+static void EsOutUpdateCPUTime( es_out_t *out )
+{
+    es_out_sys_t *p_sys = container_of(out, es_out_sys_t, out);
+    input_thread_t *p_input = p_sys->p_input;
+    input_item_t   *p_item = input_priv(p_input)->p_item;
+    const vlc_tick_t now = vlc_tick_now();
+    bool b_changed = false;
+    es_out_id_t *es;
+
+    if( input_priv(p_input)->b_preparsing )
+        return;
+    /* The statistics are computed more often than the info is read */
+    if( p_sys->i_cpu_time_update != VLC_TICK_INVALID
+     && now - p_sys->i_cpu_time_update < VLC_TICK_FROM_SEC(1) )
+        return;
+    p_sys->i_cpu_time_update = now;
+
+    foreach_es_then_es_slaves( es )
+    {
+        if( !es->p_dec )
+            continue;
+
+        vlc_tick_t i_cpu_time = input_DecoderGetCPUTime( es->p_dec );
+        if( i_cpu_time == es->i_cpu_time )
+            continue;
+
+        char *psz_cat = EsInfoCategoryName( es );
+        if( unlikely( !psz_cat ) )
+            continue;
+        if( input_item_AddInfo( p_item, psz_cat, _("Decoding time"),
+                                "%.3f s",
+                                secf_from_vlc_tick( i_cpu_time ) )
+                                                            == VLC_SUCCESS )
+        {
+            es->i_cpu_time = i_cpu_time;
+            b_changed = true;
+        }
+        free( psz_cat );
+    }
+
+    if( b_changed )
+        input_SendEventMetaInfo( p_input );
+}
+
 static void EsOutDeleteInfoEs( es_out_t *out, es_out_id_t *es )
 {
     es_out_sys_t *p_sys = container_of(out, es_out_sys_t, out);
@@ -3734,6 +3793,7 @@ static void EsOutDeleteInfoEs( es_out_t *out, es_out_id_t *es )
     {
         int ret = input_item_DelInfo( p_item, psz_info_category, NULL );
         free( psz_info_category );
+        es->i_cpu_time = -1;
 
         if( ret == VLC_SUCCESS && !input_priv(p_input)->b_preparsing  )
             input_SendEventMetaInfo( p_input );
@@ -299,6 +299,18 @@ static inline void input_SendEventVout(input_thread_t *p_input,
     });
 }
 
+/*****************************************************************************
+ * Event for decoder.c
+ *****************************************************************************/
+static inline void input_SendEventLoudness(input_thread_t *p_input,
+                                           double integrated, float peak)
+{
+    input_SendEvent(p_input, &(struct vlc_input_event) {
+        .type = INPUT_EVENT_LOUDNESS,
+        .loudness = { integrated, peak },
+    });
+}
+
 /*****************************************************************************
  * Event for control.c/input.c
  *****************************************************************************/
@@ -61,6 +61,7 @@ enum input_create_option {
     INPUT_CREATE_OPTION_NONE,
     INPUT_CREATE_OPTION_PREPARSING,
     INPUT_CREATE_OPTION_THUMBNAILING,
+    INPUT_CREATE_OPTION_LOUDNESS_SCAN,
 };
 
 static  void *Run( void * );
@@ -180,6 +181,15 @@ input_thread_t *input_CreateThumbnailer(vlc_object_t *obj,
                    INPUT_CREATE_OPTION_THUMBNAILING, NULL, NULL );
 }
 
+input_thread_t *input_CreateLoudnessScanner( vlc_object_t *obj,
+                                             input_thread_events_cb events_cb,
+                                             void *events_data,
+                                             input_item_t *item )
+{
+    return Create( obj, events_cb, events_data, item,
+                   INPUT_CREATE_OPTION_LOUDNESS_SCAN, NULL, NULL );
+}
+
 /**
  * Start a input_thread_t created by input_Create.
  *
@@ -305,6 +315,9 @@ static input_thread_t *Create( vlc_object_t *p_parent,
         case INPUT_CREATE_OPTION_THUMBNAILING:
             option_str = "thumbnailing ";
             break;
+        case INPUT_CREATE_OPTION_LOUDNESS_SCAN:
+            option_str = "loudness scanning ";
+            break;
         default:
             option_str = "";
             break;
@@ -320,6 +333,7 @@ static input_thread_t *Create( vlc_object_t *p_parent,
     priv->events_data = events_data;
     priv->b_preparsing = option == INPUT_CREATE_OPTION_PREPARSING;
     priv->b_thumbnailing = option == INPUT_CREATE_OPTION_THUMBNAILING;
+    priv->b_loudness_scan = option == INPUT_CREATE_OPTION_LOUDNESS_SCAN;
     priv->b_can_pace_control = true;
     priv->i_start = 0;
     priv->i_time  = 0;
@@ -337,7 +351,7 @@ static input_thread_t *Create( vlc_object_t *p_parent,
     TAB_INIT( priv->i_attachment, priv->attachment );
     priv->attachment_demux = NULL;
     priv->p_sout   = NULL;
-    priv->b_out_pace_control = priv->b_thumbnailing;
+    priv->b_out_pace_control = priv->b_thumbnailing || priv->b_loudness_scan;
     priv->p_renderer = p_renderer && priv->b_preparsing == false ?
                 vlc_renderer_item_hold( p_renderer ) : NULL;
 
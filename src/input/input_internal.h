@@ -132,6 +132,7 @@ typedef struct input_thread_private_t
     bool        is_stopped;
     bool        b_recording;
     bool        b_thumbnailing;
+    bool        b_loudness_scan;
     float       rate;
 
     /* Playtime configuration and state */
@@ -302,6 +303,16 @@ static inline void input_ControlPushEsHelper( input_thread_t *p_input, int i_typ
 
 bool input_Stopped( input_thread_t * );
 
+/**
+ * Creates an input decoding the audio as fast as possible, to measure its
+ * loudness, which is sent with the INPUT_EVENT_LOUDNESS event when the audio
+ * decoder is deleted. The video and the subtitles are not decoded.
+ */
+input_thread_t *input_CreateLoudnessScanner( vlc_object_t *obj,
+                                             input_thread_events_cb events_cb,
+                                             void *events_data,
+                                             input_item_t *item );
+
 int input_GetAttachments(input_thread_t *input, input_attachment_t ***attachments);
 
 input_attachment_t *input_GetAttachment(input_thread_t *input, const char *name);
@@ -356,6 +367,8 @@ struct input_stats {
     atomic_uintmax_t lost_abuffers;
     atomic_uintmax_t displayed_pictures;
     atomic_uintmax_t lost_pictures;
+    atomic_uintmax_t video_cpu_time;
+    atomic_uintmax_t audio_cpu_time;
 };
 
 struct input_stats *input_stats_Create(void);
@@ -67,6 +67,8 @@ struct input_stats *input_stats_Create(void)
     atomic_init(&stats->lost_abuffers, 0);
     atomic_init(&stats->displayed_pictures, 0);
     atomic_init(&stats->lost_pictures, 0);
+    atomic_init(&stats->video_cpu_time, 0);
+    atomic_init(&stats->audio_cpu_time, 0);
     return stats;
 }
 
@@ -102,6 +104,8 @@ void input_stats_Compute(struct input_stats *stats, input_stats_t *st)
                                                  memory_order_relaxed);
     st->i_lost_abuffers = atomic_load_explicit(&stats->lost_abuffers,
                                                memory_order_relaxed);
+    st->i_audio_cpu_time = atomic_load_explicit(&stats->audio_cpu_time,
+                                                memory_order_relaxed);
 
     /* Vouts */
     st->i_decoded_video = atomic_load_explicit(&stats->decoded_video,
@@ -110,6 +114,8 @@ void input_stats_Compute(struct input_stats *stats, input_stats_t *st)
                                                     memory_order_relaxed);
     st->i_lost_pictures = atomic_load_explicit(&stats->lost_pictures,
                                                memory_order_relaxed);
+    st->i_video_cpu_time = atomic_load_explicit(&stats->video_cpu_time,
+                                                memory_order_relaxed);
 }
 
 /** Update a counter element with new values
@@ -423,6 +423,7 @@ void input_LegacyEvents( input_thread_t *p_input,
         case INPUT_EVENT_VOUT:
         case INPUT_EVENT_SUBITEMS:
         case INPUT_EVENT_THUMBNAIL_READY:
+        case INPUT_EVENT_LOUDNESS:
         case INPUT_EVENT_VBI_PAGE:
         case INPUT_EVENT_VBI_TRANSPARENCY:
         case INPUT_EVENT_SUBS_FPS:
@@ -385,6 +385,18 @@ static const char *const ppsz_pos_descriptions[] =
     "picture quality, for instance deinterlacing, or distort " \
     "the video.")
 
+#define VIDEO_FILTER_PIPELINE_TEXT N_("Video filter pipeline depth")
+#define VIDEO_FILTER_PIPELINE_LONGTEXT N_( \
+    "Run each video filter on its own thread, with up to this number of " \
+    "pictures waiting before each filter. This uses more CPU cores at " \
+    "the cost of latency and memory. 0 runs the filters one after the " \
+    "other on the video output thread.")
+
+#define VIDEO_FILTER_THREADS_TEXT N_("Video filter threads")
+#define VIDEO_FILTER_THREADS_LONGTEXT N_( \
+    "Number of threads processing bands of pictures in parallel, for the " \
+    "video filters supporting it. 0 uses one thread per CPU.")
+
 #define SNAP_PATH_TEXT N_("Video snapshot directory (or filename)")
 #define SNAP_PATH_LONGTEXT N_( \
     "Directory where the video snapshots will be stored.")
@@ -951,6 +963,17 @@ static const char *const ppsz_prefres[] = {
 
 #define DEC_DEV_TEXT N_("Preferred decoder hardware device")
 
+#define DEC_THREADS_TEXT N_("Decoding threads")
+#define DEC_THREADS_LONGTEXT N_( \
+    "Number of decoding threads shared by all the decoders, in proportion " \
+    "to the size of their pictures and their priority. " \
+    "0 uses one thread per CPU, plus one.")
+
+#define DEC_THREADS_PRIORITY_TEXT N_("Decoding threads priority")
+#define DEC_THREADS_PRIORITY_LONGTEXT N_( \
+    "Weight of the decoders of an input in the sharing of the decoding " \
+    "threads, for instance to favor the main view of a mosaic.")
+
 /*****************************************************************************
  * Sout
  ****************************************************************************/
@@ -1161,6 +1184,18 @@ static const char *const ppsz_prefres[] = {
 #define PREPARSE_THREADS_LONGTEXT N_( \
     "Maximum number of threads used to preparse items" )
 
+#define PREPARSE_LOUDNESS_TEXT N_( "Measure the loudness while preparsing" )
+#define PREPARSE_LOUDNESS_LONGTEXT N_( \
+    "Decode the audio of the local files added to the playlist, to measure " \
+    "their loudness (EBU R128), and store it as their ReplayGain track " \
+    "gain, if they have none. The gain is applied with the \"track\" " \
+    "replay gain mode." )
+
+#define PREPARSE_LOUDNESS_THREADS_TEXT N_( "Loudness measurement threads" )
+#define PREPARSE_LOUDNESS_THREADS_LONGTEXT N_( \
+    "Maximum number of threads used to measure the loudness of the " \
+    "preparsed items. The files are measured after their preparsing." )
+
 #define FETCH_ART_THREADS_TEXT N_( "Fetch-art threads" )
 #define FETCH_ART_THREADS_LONGTEXT N_( \
     "Maximum number of threads used to fetch art" )
@@ -1705,6 +1740,12 @@ vlc_module_begin ()
     set_subcategory( SUBCAT_VIDEO_VFILTER )
     add_module_list("video-filter", "video filter", NULL,
                     VIDEO_FILTER_TEXT, VIDEO_FILTER_LONGTEXT)
+    add_integer_with_range( "video-filter-pipeline", 0, 0, 16,
+                            VIDEO_FILTER_PIPELINE_TEXT,
+                            VIDEO_FILTER_PIPELINE_LONGTEXT, true )
+    add_integer_with_range( "video-filter-threads", 0, 0, 32,
+                            VIDEO_FILTER_THREADS_TEXT,
+                            VIDEO_FILTER_THREADS_LONGTEXT, true )
 
 #if 0
     add_string( "pixel-ratio", "1", PIXEL_RATIO_TEXT, PIXEL_RATIO_TEXT )
@@ -1991,6 +2032,12 @@ vlc_module_begin ()
     add_string( "encoder",  NULL, ENCODER_TEXT,
                 ENCODER_LONGTEXT, true )
     add_string( "dec-dev", NULL, DEC_DEV_TEXT, NULL, true )
+    add_integer_with_range( "dec-threads", 0, 0, 256, DEC_THREADS_TEXT,
+                            DEC_THREADS_LONGTEXT, true )
+    add_integer_with_range( "dec-threads-priority", 1, 1, 100,
+                            DEC_THREADS_PRIORITY_TEXT,
+                            DEC_THREADS_PRIORITY_LONGTEXT, true )
+        change_safe()
 
     set_subcategory( SUBCAT_INPUT_ACCESS )
     add_category_hint(N_("Input"), INPUT_CAT_LONGTEXT)
@@ -2167,6 +2214,13 @@ vlc_module_begin ()
     add_integer( "preparse-threads", 1, PREPARSE_THREADS_TEXT,
                  PREPARSE_THREADS_LONGTEXT, false )
 
+    add_bool( "preparse-loudness", false, PREPARSE_LOUDNESS_TEXT,
+              PREPARSE_LOUDNESS_LONGTEXT, false )
+
+    add_integer( "preparse-loudness-threads", 1,
+                 PREPARSE_LOUDNESS_THREADS_TEXT,
+                 PREPARSE_LOUDNESS_THREADS_LONGTEXT, true )
+
     add_integer( "fetch-art-threads", 1, FETCH_ART_THREADS_TEXT,
                  FETCH_ART_THREADS_LONGTEXT, false )
 
@@ -43,6 +43,7 @@
 #include "config/configuration.h"
 #include "preparser/preparser.h"
 #include "media_source/media_source.h"
+#include "misc/picture.h"
 
 #include <stdio.h>                                              /* sprintf() */
 #include <string.h>
@@ -98,6 +99,11 @@ libvlc_int_t * libvlc_InternalCreate( void )
     priv->main_playlist = NULL;
     priv->p_vlm = NULL;
     priv->media_source_provider = NULL;
+    priv->slices = NULL;
+    priv->slices_disabled = false;
+    priv->dec_threads.weight = 0;
+    priv->dec_threads.used = 0;
+    vlc_list_init( &priv->dec_threads.grants );
 
     vlc_ExitInit( &priv->exit );
 
@@ -422,6 +428,9 @@ void libvlc_InternalCleanup( libvlc_int_t *p_libvlc )
     if (priv->main_playlist)
         vlc_playlist_Delete(priv->main_playlist);
 
+    vlc_slices_pool_Delete( p_libvlc );
+    picture_RecyclerFlush( VLC_OBJECT(p_libvlc) );
+
     libvlc_InternalActionsClean( p_libvlc );
 
     /* Save the configuration */
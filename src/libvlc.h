@@ -189,6 +189,14 @@ typedef struct libvlc_priv_t
     vlc_actions_t *actions; ///< Hotkeys handler
     struct vlc_medialibrary_t *p_media_library; ///< Media library instance
     struct vlc_thumbnailer_t *p_thumbnailer; ///< Lazily instantiated media thumbnailer
+    struct vlc_slices_pool *slices; ///< Lazily started filter slices threads
+    bool slices_disabled; ///< Filter slices are processed synchronously
+    struct
+    {
+        uint64_t weight; ///< Sum of the weights of the decoders
+        unsigned used; ///< Threads granted to the decoders
+        struct vlc_list grants; ///< decoder_threads_t of the decoders
+    } dec_threads; ///< Decoding threads budget
 
     /* Exit callback */
     vlc_exit_t       exit;
@@ -209,6 +217,11 @@ int vlc_MetadataRequest(libvlc_int_t *libvlc, input_item_t *item,
                         void *cbs_userdata,
                         int timeout, void *id);
 
+/*
+ * Filter slices threads
+ */
+void vlc_slices_pool_Delete(libvlc_int_t *);
+
 /*
  * Variables stuff
  */
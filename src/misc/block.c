@@ -32,6 +32,7 @@
 #include <fcntl.h>
 
 #include <vlc_common.h>
+#include <vlc_atomic.h>
 #include <vlc_block.h>
 #include <vlc_fs.h>
 
@@ -141,6 +142,111 @@ void block_Release(block_t *block)
     block->cbs->free(block);
 }
 
+/* Reference-counted payload, owning the block that allocated the data */
+struct block_payload
+{
+    atomic_uint refs;
+    block_t *block;
+};
+
+typedef struct
+{
+    block_t self;
+    struct block_payload *payload;
+} block_shared_t;
+
+static void block_shared_Release (block_t *block)
+{
+    block_shared_t *sb = container_of(block, block_shared_t, self);
+    struct block_payload *payload = sb->payload;
+
+    if (atomic_fetch_sub_explicit(&payload->refs, 1,
+                                  memory_order_acq_rel) == 1)
+    {
+        block_Release(payload->block);
+        free(payload);
+    }
+    free(sb);
+}
+
+static const struct vlc_block_callbacks block_shared_cbs =
+{
+    block_shared_Release,
+};
+
+/** Checks whether other blocks refer to the data of a block */
+static bool block_IsShared (const block_t *block)
+{
+    if (block->cbs != &block_shared_cbs)
+        return false;
+
+    const block_shared_t *sb = container_of(block, const block_shared_t, self);
+    return atomic_load_explicit(&sb->payload->refs, memory_order_acquire) > 1;
+}
+
+block_t *block_Shareable (block_t *block)
+{
+    if (block->cbs == &block_shared_cbs)
+        return block;
+
+    struct block_payload *payload = malloc(sizeof (*payload));
+    block_shared_t *sb = malloc(sizeof (*sb));
+    if (unlikely(payload == NULL || sb == NULL))
+    {
+        free(payload);
+        free(sb);
+        return block;
+    }
+
+    atomic_init(&payload->refs, 1);
+    payload->block = block;
+
+    block_Init(&sb->self, &block_shared_cbs, block->p_start, block->i_size);
+    sb->self.p_buffer = block->p_buffer;
+    sb->self.i_buffer = block->i_buffer;
+    BlockMetaCopy(&sb->self, block);
+    sb->payload = payload;
+    block->p_next = NULL;
+    return &sb->self;
+}
+
+block_t *block_Share (const block_t *block)
+{
+    if (block->cbs != &block_shared_cbs)
+        return block_Duplicate(block);
+
+    const block_shared_t *in = container_of(block, const block_shared_t, self);
+    block_shared_t *sb = malloc(sizeof (*sb));
+    if (unlikely(sb == NULL))
+        return NULL;
+
+    block_Init(&sb->self, &block_shared_cbs, block->p_start, block->i_size);
+    sb->self.p_buffer = block->p_buffer;
+    sb->self.i_buffer = block->i_buffer;
+    block_CopyProperties(&sb->self, block);
+    sb->payload = in->payload;
+    atomic_fetch_add_explicit(&sb->payload->refs, 1, memory_order_relaxed);
+    return &sb->self;
+}
+
+block_t *block_Unshare (block_t *block)
+{
+    if (!block_IsShared(block))
+        return block;
+
+    block_t *copy = block_Alloc(block->i_buffer);
+    if (unlikely(copy == NULL))
+    {
+        block_Release(block);
+        return NULL;
+    }
+
+    memcpy(copy->p_buffer, block->p_buffer, block->i_buffer);
+    BlockMetaCopy(copy, block);
+    block_Release(block);
+    return copy;
+}
+
 block_t *block_TryRealloc (block_t *p_block, ssize_t i_prebody, size_t i_body)
 {
     block_Check( p_block );
@@ -174,10 +280,12 @@ block_t *block_TryRealloc (block_t *p_block, ssize_t i_prebody, size_t i_body)
         p_block->i_buffer = i_body;
 
     size_t requested = i_prebody + i_body;
+    /* The data of other blocks must not be overwritten */
+    const bool shared = block_IsShared( p_block );
 
     if( p_block->i_buffer == 0 )
     {   /* Corner case: nothing to preserve */
-        if( requested <= p_block->i_size )
+        if( requested <= p_block->i_size && !shared )
         {   /* Enough room: recycle buffer */
             size_t extra = p_block->i_size - requested;
 
@@ -202,7 +310,8 @@ block_t *block_TryRealloc (block_t *p_block, ssize_t i_prebody, size_t i_body)
     /* Second, reallocate the buffer if we lack space. */
     assert( i_prebody >= 0 );
     if( (size_t)(p_block->p_buffer - p_start) < (size_t)i_prebody
-     || (size_t)(p_end - p_block->p_buffer) < i_body )
+     || (size_t)(p_end - p_block->p_buffer) < i_body
+     || (shared && (i_prebody > 0 || i_body > p_block->i_buffer)) )
     {
         block_t *p_rea = block_Alloc( requested );
         if( p_rea == NULL )
@@ -122,6 +122,7 @@ static void vlc_CPU_init(void)
 
 #if defined( __i386__ ) || defined( __x86_64__ )
      unsigned int i_eax, i_ebx, i_ecx, i_edx;
+     unsigned int i_max;
      bool b_amd;
 
     /* Needed for x86 CPU capabilities detection */
@@ -131,13 +132,13 @@ static void vlc_CPU_init(void)
                    "cpuid\n\t" \
                    "xchgl %%ebx,%1\n\t" \
                    : "=a" (i_eax), "=r" (i_ebx), "=c" (i_ecx), "=d" (i_edx) \
-                   : "a" (reg) \
+                   : "a" (reg), "c" (0) \
                    : "cc");
 # else
 #  define cpuid(reg) \
      asm volatile ("cpuid\n\t" \
                    : "=a" (i_eax), "=b" (i_ebx), "=c" (i_ecx), "=d" (i_edx) \
-                   : "a" (reg) \
+                   : "a" (reg), "c" (0) \
                    : "cc");
 # endif
      /* Check if the OS really supports the requested instructions */
@@ -167,6 +168,7 @@ static void vlc_CPU_init(void)
 
     /* the CPU supports the CPUID instruction - get its level */
     cpuid( 0x00000000 );
+    i_max = i_eax;
 
 # if defined (__i386__) && !defined (__i586__) \
   && !defined (__i686__) && !defined (__pentium4__) \
@@ -207,6 +209,27 @@ static void vlc_CPU_init(void)
             i_capabilities |= VLC_CPU_SSE4_2;
     }
 
+    /* AVX needs the OS to save the YMM registers: test OSXSAVE and AVX,
+     * then the XMM and YMM states in XCR0 */
+    if( ( i_ecx & 0x18000000 ) == 0x18000000 )
+    {
+        unsigned int i_xcr0;
+
+        asm volatile ("xgetbv\n\t" : "=a" (i_xcr0) : "c" (0) : "edx");
+        if( ( i_xcr0 & 0x6 ) == 0x6 )
+        {
+            i_capabilities |= VLC_CPU_AVX;
+
+            /* structured extended features, sub-leaf 0 */
+            if( i_max >= 0x00000007 )
+            {
+                cpuid( 0x00000007 );
+                if( i_ebx & 0x00000020 )
+                    i_capabilities |= VLC_CPU_AVX2;
+            }
+        }
+    }
+
     /* test for additional capabilities */
     cpuid( 0x80000000 );
 
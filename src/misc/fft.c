@@ -0,0 +1,397 @@
+/*****************************************************************************
+ * fft.c: fast Fourier transform of real signals
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+#include <vlc_fft.h>
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+#endif
+#ifdef __ARM_NEON
+# include <arm_neon.h>
+#endif
+
+/* The real signal of N samples is transformed as a complex signal of
+ * M = N / 2 samples, the even samples in the real parts and the odd samples
+ * in the imaginary parts. The complex FFT is a decimation in frequency:
+ * a radix-2 stage if log2(M) is odd, then radix-4 stages. Its output is in
+ * digit-reversed order, which is undone while splitting the spectra of the
+ * even and odd samples. */
+
+typedef void (*fft_stage_t)(float *restrict re, float *restrict im,
+                            const float *restrict tw, unsigned len,
+                            unsigned count);
+
+struct vlc_fft
+{
+    unsigned size; /* N */
+    unsigned half; /* M */
+    bool radix2;   /* first stage */
+    fft_stage_t stage;
+
+    float *tw2;      /* radix-2 twiddles: [cos, sin][M / 2] */
+    float *tw4;      /* radix-4 twiddles, per stage: [w1, w2, w3][cos, sin][len / 4] */
+    unsigned *order; /* [M], position of each frequency */
+    float *split;    /* [cos, sin][M + 1] */
+    float *re, *im;  /* [M] */
+};
+
+/* Radix-4 butterflies of one stage, for the count / len blocks of len
+ * samples: the outputs are multiplied by the twiddles w^j, w^2j, w^3j. */
+static void Stage4C(float *restrict re, float *restrict im,
+                    const float *restrict tw, unsigned len, unsigned count)
+{
+    const unsigned q = len / 4;
+    const float *w1r = tw, *w1i = tw + q, *w2r = tw + 2 * q;
+    const float *w2i = tw + 3 * q, *w3r = tw + 4 * q, *w3i = tw + 5 * q;
+
+    for (unsigned b = 0; b < count; b += len)
+        for (unsigned j = b; j < b + q; j++)
+        {
+            const float a0r = re[j], a0i = im[j];
+            const float a1r = re[j + q], a1i = im[j + q];
+            const float a2r = re[j + 2 * q], a2i = im[j + 2 * q];
+            const float a3r = re[j + 3 * q], a3i = im[j + 3 * q];
+
+            const float t0r = a0r + a2r, t0i = a0i + a2i;
+            const float t1r = a0r - a2r, t1i = a0i - a2i;
+            const float t2r = a1r + a3r, t2i = a1i + a3i;
+            /* -i (a1 - a3) */
+            const float t3r = a1i - a3i, t3i = a3r - a1r;
+
+            const float y1r = t1r + t3r, y1i = t1i + t3i;
+            const float y2r = t0r - t2r, y2i = t0i - t2i;
+            const float y3r = t1r - t3r, y3i = t1i - t3i;
+            const unsigned k = j - b;
+
+            re[j] = t0r + t2r;
+            im[j] = t0i + t2i;
+            re[j + q] = y1r * w1r[k] - y1i * w1i[k];
+            im[j + q] = y1r * w1i[k] + y1i * w1r[k];
+            re[j + 2 * q] = y2r * w2r[k] - y2i * w2i[k];
+            im[j + 2 * q] = y2r * w2i[k] + y2i * w2r[k];
+            re[j + 3 * q] = y3r * w3r[k] - y3i * w3i[k];
+            im[j + 3 * q] = y3r * w3i[k] + y3i * w3r[k];
+        }
+}
+
+/* The last stage has no twiddles */
+static void Stage4Last(float *restrict re, float *restrict im,
+                       unsigned count)
+{
+    for (unsigned j = 0; j < count; j += 4)
+    {
+        const float t0r = re[j] + re[j + 2], t0i = im[j] + im[j + 2];
+        const float t1r = re[j] - re[j + 2], t1i = im[j] - im[j + 2];
+        const float t2r = re[j + 1] + re[j + 3], t2i = im[j + 1] + im[j + 3];
+        const float t3r = im[j + 1] - im[j + 3], t3i = re[j + 3] - re[j + 1];
+
+        re[j] = t0r + t2r;
+        im[j] = t0i + t2i;
+        re[j + 1] = t1r + t3r;
+        im[j + 1] = t1i + t3i;
+        re[j + 2] = t0r - t2r;
+        im[j + 2] = t0i - t2i;
+        re[j + 3] = t1r - t3r;
+        im[j + 3] = t1i - t3i;
+    }
+}
+
+#define FFT_CMUL_RE(ar, ai, br, bi, SUB, MUL) SUB(MUL(ar, br), MUL(ai, bi))
+#define FFT_CMUL_IM(ar, ai, br, bi, ADD, MUL) ADD(MUL(ar, bi), MUL(ai, br))
+
+/* Vectorized butterflies, for the stages with at least 4 butterflies per
+ * block, 4 at a time */
+#define FFT_STAGE4_SIMD(name, attr, vec, load, store, add, sub, mul) \
+attr \
+static void name(float *restrict re, float *restrict im, \
+                 const float *restrict tw, unsigned len, unsigned count) \
+{ \
+    const unsigned q = len / 4; \
+    const float *w1r = tw, *w1i = tw + q, *w2r = tw + 2 * q; \
+    const float *w2i = tw + 3 * q, *w3r = tw + 4 * q, *w3i = tw + 5 * q; \
+\
+    if (q < 4) \
+    { \
+        Stage4C(re, im, tw, len, count); \
+        return; \
+    } \
+\
+    for (unsigned b = 0; b < count; b += len) \
+        for (unsigned k = 0; k < q; k += 4) \
+        { \
+            float *r = &re[b + k], *i = &im[b + k]; \
+            const vec a0r = load(r), a0i = load(i); \
+            const vec a1r = load(r + q), a1i = load(i + q); \
+            const vec a2r = load(r + 2 * q), a2i = load(i + 2 * q); \
+            const vec a3r = load(r + 3 * q), a3i = load(i + 3 * q); \
+\
+            const vec t0r = add(a0r, a2r), t0i = add(a0i, a2i); \
+            const vec t1r = sub(a0r, a2r), t1i = sub(a0i, a2i); \
+            const vec t2r = add(a1r, a3r), t2i = add(a1i, a3i); \
+            const vec t3r = sub(a1i, a3i), t3i = sub(a3r, a1r); \
+\
+            const vec y1r = add(t1r, t3r), y1i = add(t1i, t3i); \
+            const vec y2r = sub(t0r, t2r), y2i = sub(t0i, t2i); \
+            const vec y3r = sub(t1r, t3r), y3i = sub(t1i, t3i); \
+            const vec c1 = load(&w1r[k]), s1 = load(&w1i[k]); \
+            const vec c2 = load(&w2r[k]), s2 = load(&w2i[k]); \
+            const vec c3 = load(&w3r[k]), s3 = load(&w3i[k]); \
+\
+            store(r, add(t0r, t2r)); \
+            store(i, add(t0i, t2i)); \
+            store(r + q, FFT_CMUL_RE(y1r, y1i, c1, s1, sub, mul)); \
+            store(i + q, FFT_CMUL_IM(y1r, y1i, c1, s1, add, mul)); \
+            store(r + 2 * q, FFT_CMUL_RE(y2r, y2i, c2, s2, sub, mul)); \
+            store(i + 2 * q, FFT_CMUL_IM(y2r, y2i, c2, s2, add, mul)); \
+            store(r + 3 * q, FFT_CMUL_RE(y3r, y3i, c3, s3, sub, mul)); \
+            store(i + 3 * q, FFT_CMUL_IM(y3r, y3i, c3, s3, add, mul)); \
+        } \
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+FFT_STAGE4_SIMD(Stage4SSE2, __attribute__ ((__target__ ("sse2"))), __m128,
+                _mm_load_ps, _mm_store_ps, _mm_add_ps, _mm_sub_ps,
+                _mm_mul_ps)
+#endif
+
+#ifdef __ARM_NEON
+FFT_STAGE4_SIMD(Stage4NEON, , float32x4_t, vld1q_f32, vst1q_f32, vaddq_f32,
+                vsubq_f32, vmulq_f32)
+#endif
+
+static void Stage2(float *restrict re, float *restrict im,
+                   const float *restrict tw, unsigned count)
+{
+    const unsigned h = count / 2;
+
+    for (unsigned j = 0; j < h; j++)
+    {
+        const float dr = re[j] - re[j + h], di = im[j] - im[j + h];
+
+        re[j] += re[j + h];
+        im[j] += im[j + h];
+        re[j + h] = dr * tw[j] - di * tw[h + j];
+        im[j + h] = dr * tw[h + j] + di * tw[j];
+    }
+}
+
+vlc_fft_t *vlc_fft_New(unsigned size)
+{
+    if (size < 2 || (size & (size - 1)))
+        return NULL;
+
+    vlc_fft_t *fft = calloc(1, sizeof (*fft));
+    if (unlikely(fft == NULL))
+        return NULL;
+
+    const unsigned m = size / 2;
+    unsigned bits = 0;
+    while ((1u << bits) < m)
+        bits++;
+
+    fft->size = size;
+    fft->half = m;
+    fft->radix2 = bits & 1;
+    fft->stage = Stage4C;
+#ifdef HAVE_SSE2_INTRINSICS
+    if (vlc_CPU_SSE2())
+        fft->stage = Stage4SSE2;
+#endif
+#ifdef __ARM_NEON
+    if (vlc_CPU_ARM_NEON())
+        fft->stage = Stage4NEON;
+#endif
+
+    fft->tw2 = vlc_CPU_AllocFloats(m, 16);
+    fft->tw4 = vlc_CPU_AllocFloats(2 * m, 16);
+    fft->order = vlc_alloc(m, sizeof (*fft->order));
+    fft->split = vlc_CPU_AllocFloats(2 * (m + 1), 16);
+    fft->re = vlc_CPU_AllocFloats(m, 16);
+    fft->im = vlc_CPU_AllocFloats(m, 16);
+    if (!fft->tw2 || !fft->tw4 || !fft->order || !fft->split || !fft->re
+     || !fft->im)
+    {
+        vlc_fft_Delete(fft);
+        return NULL;
+    }
+
+    unsigned len = m;
+    if (fft->radix2)
+    {
+        for (unsigned j = 0; j < m / 2; j++)
+        {
+            fft->tw2[j] = cos(2. * M_PI * j / m);
+            fft->tw2[m / 2 + j] = -sin(2. * M_PI * j / m);
+        }
+        len /= 2;
+    }
+
+    float *tw = fft->tw4;
+    for (; len > 4; len /= 4)
+    {
+        const unsigned q = len / 4;
+
+        for (unsigned w = 1; w <= 3; w++)
+        {
+            for (unsigned j = 0; j < q; j++)
+            {
+                tw[j] = cos(2. * M_PI * w * j / len);
+                tw[q + j] = -sin(2. * M_PI * w * j / len);
+            }
+            tw += 2 * q;
+        }
+    }
+
+    /* Each stage of radix r puts the frequencies k modulo r in r
+     * consecutive blocks */
+    for (unsigned k = 0; k < m; k++)
+    {
+        unsigned pos = 0, rest = k;
+
+        len = m;
+        if (fft->radix2)
+        {
+            len /= 2;
+            pos += (rest % 2) * len;
+            rest /= 2;
+        }
+        for (; len > 1; len /= 4)
+        {
+            pos += (rest % 4) * (len / 4);
+            rest /= 4;
+        }
+        fft->order[k] = pos;
+    }
+
+    for (unsigned k = 0; k <= m; k++)
+    {
+        fft->split[k] = cos(M_PI * k / m);
+        fft->split[m + 1 + k] = -sin(M_PI * k / m);
+    }
+    return fft;
+}
+
+void vlc_fft_Delete(vlc_fft_t *fft)
+{
+    aligned_free(fft->im);
+    aligned_free(fft->re);
+    aligned_free(fft->split);
+    free(fft->order);
+    aligned_free(fft->tw4);
+    aligned_free(fft->tw2);
+    free(fft);
+}
+
+/* Complex FFT of the M samples in re and im, to digit-reversed order */
+static void Transform(vlc_fft_t *fft)
+{
+    const unsigned m = fft->half;
+    float *re = fft->re, *im = fft->im;
+    unsigned len = m;
+
+    if (fft->radix2)
+    {
+        Stage2(re, im, fft->tw2, m);
+        len /= 2;
+    }
+
+    const float *tw = fft->tw4;
+    for (; len > 4; len /= 4)
+    {
+        fft->stage(re, im, tw, len, m);
+        tw += 6 * (len / 4);
+    }
+    if (len == 4)
+        Stage4Last(re, im, m);
+}
+
+void vlc_fft_Real(vlc_fft_t *fft, const float *in, float *out_re,
+                  float *out_im)
+{
+    const unsigned m = fft->half;
+    float *re = fft->re, *im = fft->im;
+
+    for (unsigned i = 0; i < m; i++)
+    {
+        re[i] = in[2 * i];
+        im[i] = in[2 * i + 1];
+    }
+
+    Transform(fft);
+
+    /* Split the spectra of the even (e) and odd (o) samples:
+     * X[k] = E[k] + exp(-2 i pi k / N) O[k] */
+    const float *c = fft->split, *s = fft->split + m + 1;
+    for (unsigned k = 0; k <= m; k++)
+    {
+        const unsigned a = fft->order[k % m], b = fft->order[(m - k) % m];
+        const float evr = .5f * (re[a] + re[b]), evi = .5f * (im[a] - im[b]);
+        const float odr = .5f * (im[a] + im[b]), odi = .5f * (re[b] - re[a]);
+
+        out_re[k] = evr + odr * c[k] - odi * s[k];
+        out_im[k] = evi + odr * s[k] + odi * c[k];
+    }
+}
+
+void vlc_fft_RealInverse(vlc_fft_t *fft, const float *in_re,
+                         const float *in_im, float *out)
+{
+    const unsigned m = fft->half;
+    float *re = fft->re, *im = fft->im;
+    const float scale = .5f / m;
+
+    /* Merge the spectra of the even and odd samples:
+     * E[k] = (X[k] + X*[M - k]) / 2, O[k] = (X[k] - X*[M - k]) / 2 W^-k,
+     * into Z = E + i O, conjugated to get the inverse from the forward
+     * FFT. The scaling is folded in. */
+    const float *c = fft->split, *s = fft->split + m + 1;
+    for (unsigned k = 0; k < m; k++)
+    {
+        const float ar = in_re[k], ai = in_im[k];
+        const float br = in_re[m - k], bi = in_im[m - k];
+        const float er = ar + br, ei = ai - bi;
+        const float dr = ar - br, di = ai + bi;
+        const float odr = dr * c[k] + di * s[k];
+        const float odi = di * c[k] - dr * s[k];
+
+        re[k] = scale * (er - odi);
+        im[k] = -scale * (ei + odr);
+    }
+
+    Transform(fft);
+
+    for (unsigned i = 0; i < m; i++)
+    {
+        const unsigned a = fft->order[i];
+
+        out[2 * i] = re[a];
+        out[2 * i + 1] = -im[a];
+    }
+}
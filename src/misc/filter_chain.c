@@ -32,6 +32,23 @@
 #include <libvlc.h>
 #include <assert.h>
 
+#define FILTER_STATS_PERIOD VLC_TICK_FROM_SEC(5)
+
+typedef struct
+{
+    picture_t *pic;
+    vlc_tick_t date; /**< Queuing date */
+} chained_entry_t;
+
+typedef struct
+{
+    vlc_tick_t start; /**< Start of the current period */
+    unsigned count;
+    vlc_tick_t busy; /**< Time spent in the filter */
+    vlc_tick_t latency; /**< Time from queuing to output */
+    vlc_tick_t latency_max;
+} chained_stats_t;
+
 typedef struct chained_filter_t
 {
     /* Public part of the filter structure */
@@ -40,6 +57,13 @@ typedef struct chained_filter_t
     struct chained_filter_t *prev, *next;
     vlc_mouse_t *mouse;
     picture_t *pending;
+
+    /* Pipelined stage */
+    vlc_mutex_t lock; /**< Serializes the filter with mouse events */
+    vlc_thread_t thread;
+    chained_entry_t *queue; /**< Input queue, pipeline.depth entries */
+    unsigned queue_first, queue_count;
+    chained_stats_t stats;
 } chained_filter_t;
 
 /* Only use this with filter objects from _this_ C module */
@@ -61,12 +85,28 @@ struct filter_chain_t
     bool b_allow_fmt_out_change; /**< Can the output format be changed? */
     const char *filter_cap; /**< Filter modules capability */
     const char *conv_cap; /**< Converter modules capability */
+
+    struct
+    {
+        unsigned depth; /**< Stage queues size, 0 if not pipelined */
+        bool running; /**< Workers are started */
+        bool stopping;
+        unsigned flushes; /**< Flush count, to drop pictures in flight */
+        unsigned busy; /**< Number of workers handling a picture */
+        vlc_mutex_t lock;
+        vlc_cond_t wait;
+        picture_t *output; /**< Pictures for the last filter */
+        picture_t **output_last;
+        void (*wake)(void *); /**< Output callback */
+        void *wake_opaque;
+    } pipeline;
 };
 
 /**
  * Local prototypes
  */
 static void FilterDeletePictures( picture_t * );
+static void FilterChainPipelineStop( filter_chain_t * );
 
 static filter_chain_t *filter_chain_NewInner( const filter_owner_t *callbacks,
     const char *cap, const char *conv_cap, bool fmt_out_change,
@@ -91,6 +131,13 @@ static filter_chain_t *filter_chain_NewInner( const filter_owner_t *callbacks,
     chain->b_allow_fmt_out_change = fmt_out_change;
     chain->filter_cap = cap;
     chain->conv_cap = conv_cap;
+    chain->pipeline.depth = 0;
+    chain->pipeline.running = false;
+    chain->pipeline.flushes = 0;
+    chain->pipeline.busy = 0;
+    chain->pipeline.wake = NULL;
+    vlc_mutex_init( &chain->pipeline.lock );
+    vlc_cond_init( &chain->pipeline.wait );
     return chain;
 }
 
@@ -159,6 +206,8 @@ void filter_chain_Delete( filter_chain_t *p_chain )
     es_format_Clean( &p_chain->fmt_in );
     es_format_Clean( &p_chain->fmt_out );
 
+    vlc_cond_destroy( &p_chain->pipeline.wait );
+    vlc_mutex_destroy( &p_chain->pipeline.lock );
     free( p_chain );
 }
 /**
@@ -192,6 +241,8 @@ static filter_t *filter_chain_AppendInner( filter_chain_t *chain,
     if( unlikely(chained == NULL) )
         return NULL;
 
+    FilterChainPipelineStop( chain );
+
     filter_t *filter = &chained->filter;
 
     if( fmt_in == NULL )
@@ -252,6 +303,8 @@ static filter_t *filter_chain_AppendInner( filter_chain_t *chain,
         vlc_mouse_Init( mouse );
     chained->mouse = mouse;
     chained->pending = NULL;
+    vlc_mutex_init( &chained->lock );
+    chained->queue = NULL;
 
     msg_Dbg( parent, "Filter '%s' (%p) appended to chain",
              (name != NULL) ? name : module_get_name(filter->p_module, false),
@@ -289,6 +342,8 @@ void filter_chain_DeleteFilter( filter_chain_t *chain, filter_t *filter )
     vlc_object_t *obj = chain->callbacks.sys;
     chained_filter_t *chained = (chained_filter_t *)filter;
 
+    FilterChainPipelineStop( chain );
+
     /* Remove it from the chain */
     if( chained->prev != NULL )
         chained->prev->next = chained->next;
@@ -312,6 +367,7 @@ void filter_chain_DeleteFilter( filter_chain_t *chain, filter_t *filter )
     FilterDeletePictures( chained->pending );
 
     free( chained->mouse );
+    vlc_mutex_destroy( &chained->lock );
     es_format_Clean( &filter->fmt_out );
     es_format_Clean( &filter->fmt_in );
 
@@ -414,8 +470,325 @@ static picture_t *FilterChainVideoFilter( chained_filter_t *f, picture_t *p_pic
     return p_pic;
 }
 
+/**
+ * Pipelined chains
+ *
+ * Every filter but the last one runs on its own worker thread, and takes
+ * its input pictures from a bounded queue filled by the previous stage.
+ * The last filter runs on the thread of the chain user, since it gets its
+ * pictures from the chain owner.
+ * All the pipeline state is protected by pipeline.lock.
+ */
+static void FilterStatsReport( chained_filter_t *f, vlc_tick_t now )
+{
+    chained_stats_t *stats = &f->stats;
+    const vlc_tick_t period = now - stats->start;
+
+    if( stats->count > 0 && period > 0 )
+        msg_Dbg( &f->filter, "%u pictures, %.2f fps, latency %.2f/%.2f ms "
+                 "(avg/max), busy %"PRId64"%%",
+                 stats->count, stats->count * (double)CLOCK_FREQ / period,
+                 stats->latency / (stats->count * (double)VLC_TICK_FROM_MS(1)),
+                 stats->latency_max / (double)VLC_TICK_FROM_MS(1),
+                 stats->busy * 100 / period );
+
+    stats->start = now;
+    stats->count = 0;
+    stats->busy = 0;
+    stats->latency = 0;
+    stats->latency_max = 0;
+}
+
+static void FilterStatsAdd( chained_filter_t *f, vlc_tick_t queued,
+                            vlc_tick_t start, vlc_tick_t end )
+{
+    chained_stats_t *stats = &f->stats;
+
+    stats->count++;
+    stats->busy += end - start;
+    stats->latency += end - queued;
+    if( stats->latency_max < end - queued )
+        stats->latency_max = end - queued;
+
+    if( end - stats->start >= FILTER_STATS_PERIOD )
+        FilterStatsReport( f, end );
+}
+
+static void FilterChainPipelineQueue( chained_filter_t *f, picture_t *pic,
+                                      vlc_tick_t date )
+{
+    filter_chain_t *chain = f->filter.owner.sys;
+    const unsigned depth = chain->pipeline.depth;
+
+    assert( f->queue_count < depth );
+    f->queue[(f->queue_first + f->queue_count) % depth] = (chained_entry_t) {
+        .pic = pic, .date = date,
+    };
+    f->queue_count++;
+    vlc_cond_broadcast( &chain->pipeline.wait );
+}
+
+static void *FilterChainPipelineThread( void *data )
+{
+    chained_filter_t *f = data;
+    filter_chain_t *chain = f->filter.owner.sys;
+    filter_t *filter = &f->filter;
+    const unsigned depth = chain->pipeline.depth;
+
+    vlc_mutex_lock( &chain->pipeline.lock );
+    for( ;; )
+    {
+        while( f->queue_count == 0 && !chain->pipeline.stopping )
+            vlc_cond_wait( &chain->pipeline.wait, &chain->pipeline.lock );
+        if( chain->pipeline.stopping )
+            break;
+
+        chained_entry_t entry = f->queue[f->queue_first];
+        f->queue_first = (f->queue_first + 1) % depth;
+        f->queue_count--;
+
+        const unsigned flushes = chain->pipeline.flushes;
+        bool ready = false;
+        chain->pipeline.busy++;
+        vlc_cond_broadcast( &chain->pipeline.wait );
+        vlc_mutex_unlock( &chain->pipeline.lock );
+
+        vlc_tick_t start = vlc_tick_now();
+        vlc_mutex_lock( &f->lock );
+        picture_t *out = filter->pf_video_filter( filter, entry.pic );
+        vlc_mutex_unlock( &f->lock );
+        vlc_tick_t end = vlc_tick_now();
+        FilterStatsAdd( f, entry.date, start, end );
+
+        vlc_mutex_lock( &chain->pipeline.lock );
+        while( out != NULL )
+        {
+            picture_t *next = out->p_next;
+            out->p_next = NULL;
+
+            /* The output of the last stage is not bounded, so that the
+             * pipeline can always be drained */
+            if( f->next != chain->last )
+                while( f->next->queue_count == depth
+                    && chain->pipeline.flushes == flushes
+                    && !chain->pipeline.stopping )
+                    vlc_cond_wait( &chain->pipeline.wait,
+                                   &chain->pipeline.lock );
+
+            if( chain->pipeline.flushes != flushes
+             || chain->pipeline.stopping )
+                picture_Release( out );
+            else if( f->next == chain->last )
+            {
+                *chain->pipeline.output_last = out;
+                chain->pipeline.output_last = &out->p_next;
+                vlc_cond_broadcast( &chain->pipeline.wait );
+                ready = true;
+            }
+            else
+                FilterChainPipelineQueue( f->next, out, end );
+            out = next;
+        }
+        chain->pipeline.busy--;
+        vlc_cond_broadcast( &chain->pipeline.wait );
+
+        if( ready && chain->pipeline.wake != NULL )
+        {
+            vlc_mutex_unlock( &chain->pipeline.lock );
+            chain->pipeline.wake( chain->pipeline.wake_opaque );
+            vlc_mutex_lock( &chain->pipeline.lock );
+        }
+    }
+    vlc_mutex_unlock( &chain->pipeline.lock );
+
+    FilterStatsReport( f, vlc_tick_now() );
+    return NULL;
+}
+
+/* Drops the pictures in flight, must be called with pipeline.lock held */
+static void FilterChainPipelineDrop( filter_chain_t *chain )
+{
+    for( chained_filter_t *f = chain->first; f != chain->last; f = f->next )
+    {
+        for( ; f->queue_count > 0; f->queue_count-- )
+        {
+            picture_Release( f->queue[f->queue_first].pic );
+            f->queue_first = (f->queue_first + 1) % chain->pipeline.depth;
+        }
+    }
+    FilterDeletePictures( chain->pipeline.output );
+    chain->pipeline.output = NULL;
+    chain->pipeline.output_last = &chain->pipeline.output;
+}
+
+static void FilterChainPipelineStop( filter_chain_t *chain )
+{
+    if( !chain->pipeline.running )
+        return;
+
+    vlc_mutex_lock( &chain->pipeline.lock );
+    chain->pipeline.stopping = true;
+    vlc_cond_broadcast( &chain->pipeline.wait );
+    vlc_mutex_unlock( &chain->pipeline.lock );
+
+    for( chained_filter_t *f = chain->first; f != chain->last; f = f->next )
+        vlc_join( f->thread, NULL );
+
+    FilterChainPipelineDrop( chain );
+    for( chained_filter_t *f = chain->first; f != chain->last; f = f->next )
+    {
+        free( f->queue );
+        f->queue = NULL;
+    }
+    FilterStatsReport( chain->last, vlc_tick_now() );
+    chain->pipeline.running = false;
+}
+
+static bool FilterChainPipelineStart( filter_chain_t *chain )
+{
+    if( chain->pipeline.running )
+        return true;
+    if( chain->pipeline.depth == 0 || chain->first == chain->last )
+        return false;
+
+    /* Hardware surfaces can be bound to the thread of their owner */
+    for( chained_filter_t *f = chain->first; f != NULL; f = f->next )
+    {
+        const vlc_chroma_description_t *in =
+            vlc_fourcc_GetChromaDescription( f->filter.fmt_in.video.i_chroma );
+        const vlc_chroma_description_t *out =
+            vlc_fourcc_GetChromaDescription( f->filter.fmt_out.video.i_chroma );
+        if( in == NULL || in->plane_count == 0
+         || out == NULL || out->plane_count == 0 )
+            return false;
+    }
+
+    const vlc_tick_t now = vlc_tick_now();
+    chain->pipeline.stopping = false;
+    chain->pipeline.busy = 0;
+    chain->pipeline.output = NULL;
+    chain->pipeline.output_last = &chain->pipeline.output;
+
+    chained_filter_t *f;
+    for( f = chain->first; f != NULL; f = f->next )
+    {
+        f->queue_first = f->queue_count = 0;
+        FilterStatsReport( f, now ); /* resets the statistics */
+    }
+    for( f = chain->first; f != chain->last; f = f->next )
+    {
+        f->queue = vlc_alloc( chain->pipeline.depth, sizeof(*f->queue) );
+        if( unlikely(f->queue == NULL)
+         || vlc_clone( &f->thread, FilterChainPipelineThread, f,
+                       VLC_THREAD_PRIORITY_VIDEO ) )
+        {
+            free( f->queue );
+            f->queue = NULL;
+            break;
+        }
+    }
+
+    if( f != chain->last )
+    {
+        vlc_object_t *obj = chain->callbacks.sys;
+
+        msg_Err( obj, "cannot start the filter pipeline" );
+        vlc_mutex_lock( &chain->pipeline.lock );
+        chain->pipeline.stopping = true;
+        vlc_cond_broadcast( &chain->pipeline.wait );
+        vlc_mutex_unlock( &chain->pipeline.lock );
+        for( chained_filter_t *g = chain->first; g != f; g = g->next )
+        {
+            vlc_join( g->thread, NULL );
+            free( g->queue );
+            g->queue = NULL;
+        }
+        chain->pipeline.depth = 0;
+        return false;
+    }
+
+    chain->pipeline.running = true;
+    return true;
+}
+
+/* Must be called with pipeline.lock held */
+static bool FilterChainPipelineInFlight( filter_chain_t *chain )
+{
+    if( chain->pipeline.busy > 0 )
+        return true;
+    for( chained_filter_t *f = chain->first; f != chain->last; f = f->next )
+        if( f->queue_count > 0 )
+            return true;
+    return false;
+}
+
+/* Gets the next output picture, waiting for the pictures in flight if
+ * b_wait is true */
+static picture_t *FilterChainPipelineOutput( filter_chain_t *chain, bool b_wait )
+{
+    chained_filter_t *last = chain->last;
+
+    for( ;; )
+    {
+        picture_t *pic = last->pending;
+        if( pic != NULL )
+        {
+            last->pending = pic->p_next;
+            pic->p_next = NULL;
+            return pic;
+        }
+
+        vlc_mutex_lock( &chain->pipeline.lock );
+        while( (pic = chain->pipeline.output) == NULL && b_wait
+            && FilterChainPipelineInFlight( chain ) )
+            vlc_cond_wait( &chain->pipeline.wait, &chain->pipeline.lock );
+        if( pic != NULL )
+        {
+            chain->pipeline.output = pic->p_next;
+            if( chain->pipeline.output == NULL )
+                chain->pipeline.output_last = &chain->pipeline.output;
+            pic->p_next = NULL;
+        }
+        vlc_mutex_unlock( &chain->pipeline.lock );
+
+        if( pic == NULL )
+            return NULL;
+
+        vlc_tick_t start = vlc_tick_now();
+        pic = FilterChainVideoFilter( last, pic );
+        FilterStatsAdd( last, start, start, vlc_tick_now() );
+        if( pic != NULL )
+            return pic;
+    }
+}
+
+void filter_chain_SetPipelined( filter_chain_t *chain, unsigned depth,
+                                void (*wake)(void *), void *opaque )
+{
+    FilterChainPipelineStop( chain );
+    chain->pipeline.depth = depth;
+    chain->pipeline.wake = wake;
+    chain->pipeline.wake_opaque = opaque;
+}
+
 picture_t *filter_chain_VideoFilter( filter_chain_t *p_chain, picture_t *p_pic )
 {
+    if( FilterChainPipelineStart( p_chain ) )
+    {
+        if( p_pic )
+        {
+            chained_filter_t *first = p_chain->first;
+
+            vlc_mutex_lock( &p_chain->pipeline.lock );
+            while( first->queue_count == p_chain->pipeline.depth )
+                vlc_cond_wait( &p_chain->pipeline.wait,
+                               &p_chain->pipeline.lock );
+            FilterChainPipelineQueue( first, p_pic, vlc_tick_now() );
+            vlc_mutex_unlock( &p_chain->pipeline.lock );
+        }
+        return FilterChainPipelineOutput( p_chain, false );
+    }
+
     if( p_pic )
     {
         p_pic = FilterChainVideoFilter( p_chain->first, p_pic );
@@ -437,8 +810,27 @@ picture_t *filter_chain_VideoFilter( filter_chain_t *p_chain, picture_t *p_pic )
     return NULL;
 }
 
+picture_t *filter_chain_VideoDrain( filter_chain_t *p_chain )
+{
+    if( p_chain->pipeline.running )
+        return FilterChainPipelineOutput( p_chain, true );
+    return filter_chain_VideoFilter( p_chain, NULL );
+}
+
 void filter_chain_VideoFlush( filter_chain_t *p_chain )
 {
+    if( p_chain->pipeline.running )
+    {
+        vlc_mutex_lock( &p_chain->pipeline.lock );
+        p_chain->pipeline.flushes++;
+        FilterChainPipelineDrop( p_chain );
+        vlc_cond_broadcast( &p_chain->pipeline.wait );
+        while( p_chain->pipeline.busy > 0 )
+            vlc_cond_wait( &p_chain->pipeline.wait, &p_chain->pipeline.lock );
+        vlc_mutex_unlock( &p_chain->pipeline.lock );
+        /* The workers are idle until the next picture */
+    }
+
     for( chained_filter_t *f = p_chain->first; f != NULL; f = f->next )
     {
         filter_t *p_filter = &f->filter;
@@ -489,9 +881,13 @@ int filter_chain_MouseFilter( filter_chain_t *p_chain, vlc_mouse_t *p_dst, const
         {
             vlc_mouse_t old = *p_mouse;
             vlc_mouse_t filtered;
+            int ret;
 
             *p_mouse = current;
-            if( p_filter->pf_video_mouse( p_filter, &filtered, &old, &current ) )
+            vlc_mutex_lock( &f->lock );
+            ret = p_filter->pf_video_mouse( p_filter, &filtered, &old, &current );
+            vlc_mutex_unlock( &f->lock );
+            if( ret )
                 return VLC_EGENERIC;
             current = filtered;
         }
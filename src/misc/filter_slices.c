@@ -0,0 +1,245 @@
+/*****************************************************************************
+ * filter_slices.c : slice-parallel picture processing for filters
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_filter.h>
+#include "../libvlc.h"
+
+#define SLICES_MAX_THREADS (FILTER_SLICES_MAX - 1) /* and the caller */
+#define SLICES_MIN_ROWS    16 /* smaller bands are not worth a thread */
+
+typedef struct filter_slices_job
+{
+    struct filter_slices_job *next;
+    filter_t *filter;
+    filter_slice_cb cb;
+    void *opaque;
+    unsigned height, band, overlap;
+    unsigned count; /* number of bands */
+    unsigned started; /* bands given to a thread */
+    unsigned done;
+} filter_slices_job_t;
+
+struct vlc_slices_pool
+{
+    vlc_mutex_t lock;
+    vlc_cond_t wait; /* jobs to process, or exiting */
+    vlc_cond_t done; /* bands done */
+    filter_slices_job_t *first; /* jobs with bands not started yet */
+    filter_slices_job_t **last;
+    bool exiting;
+    unsigned count;
+    vlc_thread_t threads[];
+};
+
+static vlc_mutex_t pool_lock = VLC_STATIC_MUTEX;
+
+static void RunBand( filter_slices_job_t *job, unsigned index )
+{
+    filter_slice_t slice = {
+        .index = index,
+        .count = job->count,
+        .y_start = index * job->band,
+    };
+
+    slice.y_end = __MIN( slice.y_start + job->band, job->height );
+    slice.y_read_start = slice.y_start > job->overlap
+                       ? slice.y_start - job->overlap : 0;
+    slice.y_read_end = __MIN( slice.y_end + job->overlap, job->height );
+
+    job->cb( job->filter, &slice, job->opaque );
+}
+
+/* Takes a band of the first job, must be called with the lock held */
+static unsigned TakeBand( struct vlc_slices_pool *pool,
+                          filter_slices_job_t *job )
+{
+    unsigned index = job->started++;
+
+    if( job->started == job->count )
+    {
+        /* Remove the job from the list, the callers are not waiting
+         * behind it anymore */
+        filter_slices_job_t **pp = &pool->first;
+        while( *pp != job )
+            pp = &(*pp)->next;
+        *pp = job->next;
+        if( pool->last == &job->next )
+            pool->last = pp;
+    }
+    return index;
+}
+
+static void *Thread( void *data )
+{
+    struct vlc_slices_pool *pool = data;
+
+    vlc_mutex_lock( &pool->lock );
+    for( ;; )
+    {
+        while( pool->first == NULL && !pool->exiting )
+            vlc_cond_wait( &pool->wait, &pool->lock );
+        if( pool->exiting )
+            break;
+
+        filter_slices_job_t *job = pool->first;
+        unsigned index = TakeBand( pool, job );
+        vlc_mutex_unlock( &pool->lock );
+
+        RunBand( job, index );
+
+        vlc_mutex_lock( &pool->lock );
+        if( ++job->done == job->count )
+            vlc_cond_broadcast( &pool->done );
+    }
+    vlc_mutex_unlock( &pool->lock );
+    return NULL;
+}
+
+static struct vlc_slices_pool *GetPool( filter_t *filter )
+{
+    libvlc_priv_t *priv = libvlc_priv( vlc_object_instance( filter ) );
+    struct vlc_slices_pool *pool;
+
+    vlc_mutex_lock( &pool_lock );
+    pool = priv->slices;
+    if( pool == NULL && !priv->slices_disabled )
+    {
+        /* The calling thread processes bands too */
+        int64_t threads = var_InheritInteger( filter, "video-filter-threads" );
+        if( threads <= 0 )
+            threads = vlc_GetCPUCount();
+        threads = __MIN( threads - 1, SLICES_MAX_THREADS );
+
+        if( threads > 0 )
+            pool = malloc( sizeof(*pool) + threads * sizeof(pool->threads[0]) );
+        if( pool != NULL )
+        {
+            vlc_mutex_init( &pool->lock );
+            vlc_cond_init( &pool->wait );
+            vlc_cond_init( &pool->done );
+            pool->first = NULL;
+            pool->last = &pool->first;
+            pool->exiting = false;
+            for( pool->count = 0; pool->count < threads; pool->count++ )
+                if( vlc_clone( &pool->threads[pool->count], Thread, pool,
+                               VLC_THREAD_PRIORITY_VIDEO ) )
+                    break;
+
+            if( pool->count == 0 )
+            {
+                vlc_cond_destroy( &pool->done );
+                vlc_cond_destroy( &pool->wait );
+                vlc_mutex_destroy( &pool->lock );
+                free( pool );
+                pool = NULL;
+            }
+            else
+                msg_Dbg( filter, "started %u filter slices threads",
+                         pool->count );
+        }
+        priv->slices = pool;
+        priv->slices_disabled = pool == NULL;
+    }
+    vlc_mutex_unlock( &pool_lock );
+    return pool;
+}
+
+void filter_RunSlices( filter_t *filter, unsigned height, unsigned align,
+                       unsigned overlap, filter_slice_cb cb, void *opaque )
+{
+    assert( align > 0 );
+    struct vlc_slices_pool *pool = GetPool( filter );
+    unsigned count = height / __MAX( align, SLICES_MIN_ROWS );
+
+    /* Without threads, the whole picture is processed on the calling thread */
+    count = __MIN( count, pool != NULL ? pool->count + 1 : 1 );
+    if( count <= 1 )
+    {
+        const filter_slice_t slice = {
+            .count = 1, .y_end = height, .y_read_end = height,
+        };
+        cb( filter, &slice, opaque );
+        return;
+    }
+
+    unsigned band = (height + count - 1) / count;
+    band = (band + align - 1) / align * align;
+
+    filter_slices_job_t job = {
+        .next = NULL,
+        .filter = filter,
+        .cb = cb,
+        .opaque = opaque,
+        .height = height,
+        .band = band,
+        .overlap = overlap,
+        .count = (height + band - 1) / band,
+    };
+
+    vlc_mutex_lock( &pool->lock );
+    *pool->last = &job;
+    pool->last = &job.next;
+    vlc_cond_broadcast( &pool->wait );
+
+    while( job.started < job.count )
+    {
+        unsigned index = TakeBand( pool, &job );
+        vlc_mutex_unlock( &pool->lock );
+
+        RunBand( &job, index );
+
+        vlc_mutex_lock( &pool->lock );
+        job.done++;
+    }
+    while( job.done < job.count )
+        vlc_cond_wait( &pool->done, &pool->lock );
+    vlc_mutex_unlock( &pool->lock );
+}
+
+void vlc_slices_pool_Delete( libvlc_int_t *libvlc )
+{
+    libvlc_priv_t *priv = libvlc_priv( libvlc );
+    struct vlc_slices_pool *pool = priv->slices;
+
+    if( pool == NULL )
+        return;
+
+    vlc_mutex_lock( &pool->lock );
+    assert( pool->first == NULL );
+    pool->exiting = true;
+    vlc_cond_broadcast( &pool->wait );
+    vlc_mutex_unlock( &pool->lock );
+
+    for( unsigned i = 0; i < pool->count; i++ )
+        vlc_join( pool->threads[i], NULL );
+
+    vlc_cond_destroy( &pool->done );
+    vlc_cond_destroy( &pool->wait );
+    vlc_mutex_destroy( &pool->lock );
+    free( pool );
+    priv->slices = NULL;
+}
@@ -57,17 +57,6 @@ static void picture_DestroyDummy( picture_t *p_picture )
     (void) p_picture;
 }
 
-/**
- * Destroys a picture allocated with picture_NewFromFormat().
- */
-static void picture_DestroyFromFormat(picture_t *pic)
-{
-    picture_buffer_t *res = pic->p_sys;
-
-    if (res != NULL)
-        picture_Deallocate(res->fd, res->base, res->size);
-}
-
 VLC_WEAK void *picture_Allocate(int *restrict fdp, size_t size)
 {
     assert((size % 64) == 0);
@@ -82,6 +71,179 @@ VLC_WEAK void picture_Deallocate(int fd, void *base, size_t size)
     assert((size % 64) == 0);
 }
 
+/*****************************************************************************
+ * Picture buffers recycler
+ *****************************************************************************
+ * Allocating a picture buffer maps fresh pages, that the kernel zero-fills
+ * one page fault at a time, although the producer overwrites the planes.
+ * Released buffers are kept for a short while and handed to the next picture
+ * of the same size, whatever its owner: the layout of the planes only
+ * depends on the video format. They are all released as soon as no picture
+ * is left in use.
+ *****************************************************************************/
+#define RECYCLER_MAX_SIZE (UINT64_C(256) << 20) /* bytes held */
+#define RECYCLER_MAX_AGE VLC_TICK_FROM_SEC(2)
+
+typedef struct picture_recycled
+{
+    struct picture_recycled *next;
+    vlc_tick_t date;
+    int fd;
+    void *base;
+    size_t size;
+} picture_recycled_t;
+
+static struct
+{
+    vlc_mutex_t lock;
+    picture_recycled_t *first; /* most recently released first */
+    uint64_t held;
+    uint64_t held_max;
+    uint64_t allocations;
+    uint64_t reuses;
+    unsigned live; /* buffers in use by pictures */
+} recycler = { VLC_STATIC_MUTEX, NULL, 0, 0, 0, 0, 0 };
+
+static void picture_RecyclerFree(picture_recycled_t *list)
+{
+    while (list != NULL)
+    {
+        picture_recycled_t *next = list->next;
+
+        picture_Deallocate(list->fd, list->base, list->size);
+        free(list);
+        list = next;
+    }
+}
+
+/**
+ * Detaches the buffers nobody asked for lately, and the oldest ones beyond
+ * the limit (the list is sorted by date), to be freed outside of the lock.
+ */
+static picture_recycled_t *picture_RecyclerExpire(vlc_tick_t now)
+{
+    vlc_mutex_assert(&recycler.lock);
+
+    /* Nobody uses pictures anymore: no need to keep any */
+    const bool keep = recycler.live > 0;
+
+    picture_recycled_t **pp = &recycler.first;
+    uint64_t held = 0;
+    while (keep && *pp != NULL && held + (*pp)->size <= RECYCLER_MAX_SIZE
+        && now - (*pp)->date <= RECYCLER_MAX_AGE)
+    {
+        held += (*pp)->size;
+        pp = &(*pp)->next;
+    }
+    picture_recycled_t *expired = *pp;
+    *pp = NULL;
+    recycler.held = held;
+    return expired;
+}
+
+static void *picture_RecyclerGet(int *restrict fdp, size_t size)
+{
+    void *base = NULL;
+
+    vlc_mutex_lock(&recycler.lock);
+    recycler.allocations++;
+    recycler.live++;
+    for (picture_recycled_t **pp = &recycler.first; *pp != NULL;
+         pp = &(*pp)->next)
+    {
+        picture_recycled_t *buf = *pp;
+
+        if (buf->size == size)
+        {
+            *pp = buf->next;
+            recycler.held -= size;
+            recycler.reuses++;
+            base = buf->base;
+            *fdp = buf->fd;
+            free(buf);
+            break;
+        }
+    }
+    /* Also expire when pictures are only allocated, e.g. when the released
+     * ones all have a different size */
+    picture_recycled_t *expired = picture_RecyclerExpire(vlc_tick_now());
+    vlc_mutex_unlock(&recycler.lock);
+
+    picture_RecyclerFree(expired);
+
+    if (base == NULL)
+    {
+        base = picture_Allocate(fdp, size);
+        if (unlikely(base == NULL))
+        {
+            vlc_mutex_lock(&recycler.lock);
+            recycler.live--;
+            vlc_mutex_unlock(&recycler.lock);
+        }
+    }
+    return base;
+}
+
+static void picture_RecyclerPut(int fd, void *base, size_t size)
+{
+    picture_recycled_t *buf = NULL;
+    if (size <= RECYCLER_MAX_SIZE)
+        buf = malloc(sizeof (*buf));
+    if (likely(buf != NULL))
+    {
+        buf->date = vlc_tick_now();
+        buf->fd = fd;
+        buf->base = base;
+        buf->size = size;
+    }
+
+    vlc_mutex_lock(&recycler.lock);
+    assert(recycler.live > 0);
+    recycler.live--;
+    if (likely(buf != NULL))
+    {
+        buf->next = recycler.first;
+        recycler.first = buf;
+        recycler.held += size;
+        if (recycler.held > recycler.held_max)
+            recycler.held_max = recycler.held;
+    }
+    picture_recycled_t *expired =
+        picture_RecyclerExpire(buf != NULL ? buf->date : vlc_tick_now());
+    vlc_mutex_unlock(&recycler.lock);
+
+    picture_RecyclerFree(expired);
+    if (unlikely(buf == NULL))
+        picture_Deallocate(fd, base, size);
+}
+
+void picture_RecyclerFlush(vlc_object_t *obj)
+{
+    vlc_mutex_lock(&recycler.lock);
+    picture_recycled_t *list = recycler.first;
+
+    if (recycler.allocations > 0)
+        msg_Dbg(obj, "picture buffers: %"PRIu64" of %"PRIu64" allocations "
+                "avoided, up to %"PRIu64" MiB held", recycler.reuses,
+                recycler.allocations, recycler.held_max >> 20);
+    recycler.first = NULL;
+    recycler.held = 0;
+    vlc_mutex_unlock(&recycler.lock);
+
+    picture_RecyclerFree(list);
+}
+
+/**
+ * Destroys a picture allocated with picture_NewFromFormat().
+ */
+static void picture_DestroyFromFormat(picture_t *pic)
+{
+    picture_buffer_t *res = pic->p_sys;
+
+    if (res != NULL)
+        picture_RecyclerPut(res->fd, res->base, res->size);
+}
+
 /*****************************************************************************
  *
  *****************************************************************************/
@@ -94,6 +256,7 @@ void picture_Reset( picture_t *p_picture )
     p_picture->b_progressive = false;
     p_picture->i_nb_fields = 2;
     p_picture->b_top_field_first = false;
+    p_picture->b_keyframe = false;
     PictureDestroyContext( p_picture );
 }
 
@@ -280,7 +443,7 @@ picture_t *picture_NewFromFormat(const video_format_t *restrict fmt)
 
     picture_buffer_t *res = (void *)priv->extra;
 
-    unsigned char *buf = picture_Allocate(&res->fd, pic_size);
+    unsigned char *buf = picture_RecyclerGet(&res->fd, pic_size);
     if (unlikely(buf == NULL))
         goto error;
 
@@ -379,6 +542,7 @@ void picture_CopyProperties( picture_t *p_dst, const picture_t *p_src )
     p_dst->b_progressive = p_src->b_progressive;
     p_dst->i_nb_fields = p_src->i_nb_fields;
     p_dst->b_top_field_first = p_src->b_top_field_first;
+    p_dst->b_keyframe = p_src->b_keyframe;
 }
 
 void picture_CopyPixels( picture_t *p_dst, const picture_t *p_src )
@@ -37,3 +37,9 @@ typedef struct
 
 void *picture_Allocate(int *, size_t);
 void picture_Deallocate(int, void *, size_t);
+
+/**
+ * Releases the picture buffers kept for reuse, and logs how many allocations
+ * they saved.
+ */
+void picture_RecyclerFlush(vlc_object_t *);
@@ -98,8 +98,12 @@ vlc_playlist_Preparse(vlc_playlist_t *playlist, libvlc_int_t *libvlc,
     VLC_UNUSED(input);
     VLC_UNUSED(input_preparser_callbacks);
 #else
+    input_item_meta_request_option_t options = META_REQUEST_OPTION_NONE;
+    if (var_InheritBool(libvlc, "preparse-loudness"))
+        options |= META_REQUEST_OPTION_SCAN_LOUDNESS;
+
     /* vlc_MetadataRequest is not exported */
-    vlc_MetadataRequest(libvlc, input, META_REQUEST_OPTION_NONE,
-                        &input_preparser_callbacks, playlist, -1, NULL);
+    vlc_MetadataRequest(libvlc, input, options, &input_preparser_callbacks,
+                        playlist, -1, NULL);
 #endif
 }
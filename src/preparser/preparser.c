@@ -22,8 +22,13 @@
 # include "config.h"
 #endif
 
+#include <math.h>
+
 #include <vlc_common.h>
 #include <vlc_atomic.h>
+#include <vlc_charset.h>
+#include <vlc_loudness.h>
+#include <vlc_meta.h>
 
 #include "misc/background_worker.h"
 #include "input/input_interface.h"
@@ -36,14 +41,17 @@ struct input_preparser_t
     vlc_object_t* owner;
     input_fetcher_t* fetcher;
     struct background_worker* worker;
+    struct background_worker* loudness_worker;
     atomic_bool deactivated;
 };
 
 typedef struct input_preparser_req_t
 {
     input_item_t *item;
+    input_item_meta_request_option_t options;
     const input_preparser_callbacks_t *cbs;
     void *userdata;
+    void *id;
     vlc_atomic_rc_t rc;
 } input_preparser_req_t;
 
@@ -57,17 +65,31 @@ typedef struct input_preparser_task_t
     atomic_bool done;
 } input_preparser_task_t;
 
+typedef struct input_preparser_loudness_t
+{
+    input_preparser_req_t *req;
+    input_preparser_t* preparser;
+    input_thread_t* input;
+    atomic_int state;
+    atomic_bool done;
+    bool has_loudness;
+    struct vlc_input_event_loudness loudness;
+} input_preparser_loudness_t;
+
 static input_preparser_req_t *ReqCreate(input_item_t *item,
+                                        input_item_meta_request_option_t options,
                                         const input_preparser_callbacks_t *cbs,
-                                        void *userdata)
+                                        void *userdata, void *id)
 {
     input_preparser_req_t *req = malloc(sizeof(*req));
     if (unlikely(!req))
         return NULL;
 
     req->item = item;
+    req->options = options;
     req->cbs = cbs;
     req->userdata = userdata;
+    req->id = id;
     vlc_atomic_rc_init(&req->rc);
 
     input_item_Hold(item);
@@ -116,6 +138,77 @@ static void InputEvent( input_thread_t *input,
     }
 }
 
+static void LoudnessEvent( input_thread_t *input,
+                           const struct vlc_input_event *event, void *task_ )
+{
+    VLC_UNUSED( input );
+    input_preparser_loudness_t* task = task_;
+
+    switch( event->type )
+    {
+        case INPUT_EVENT_STATE:
+            atomic_store( &task->state, event->state );
+            break;
+        case INPUT_EVENT_DEAD:
+            atomic_store( &task->done, true );
+            background_worker_RequestProbe( task->preparser->loudness_worker );
+            break;
+        case INPUT_EVENT_LOUDNESS:
+            /* Read after the input thread is joined */
+            task->has_loudness = true;
+            task->loudness = event->loudness;
+            break;
+        default: ;
+    }
+}
+
+/* Scans the loudness of local files, unless they already have a gain */
+static bool ScanLoudness( input_preparser_req_t *req )
+{
+    input_item_t *item = req->item;
+
+    if( !( req->options & META_REQUEST_OPTION_SCAN_LOUDNESS ) )
+        return false;
+
+    vlc_mutex_lock( &item->lock );
+    bool scan = item->i_type == ITEM_TYPE_FILE && !item->b_net
+             && ( item->p_meta == NULL
+               || vlc_meta_GetExtra( item->p_meta, "REPLAYGAIN_TRACK_GAIN" ) == NULL );
+    vlc_mutex_unlock( &item->lock );
+    return scan;
+}
+
+/* Stores the loudness as ReplayGain 2.0 values */
+static void StoreLoudness( input_item_t *item,
+                           const struct vlc_input_event_loudness *loudness )
+{
+    char *gain, *peak;
+
+    if( !isfinite( loudness->integrated ) )
+        return;
+    if( us_asprintf( &gain, "%.2f dB", VLC_LOUDNESS_REPLAY_GAIN_REFERENCE
+                                       - loudness->integrated ) == -1 )
+        return;
+    if( us_asprintf( &peak, "%.6f", loudness->peak ) == -1 )
+    {
+        free( gain );
+        return;
+    }
+
+    vlc_mutex_lock( &item->lock );
+    if( !item->p_meta )
+        item->p_meta = vlc_meta_New();
+    if( item->p_meta )
+    {
+        vlc_meta_AddExtra( item->p_meta, "REPLAYGAIN_TRACK_GAIN", gain );
+        vlc_meta_AddExtra( item->p_meta, "REPLAYGAIN_TRACK_PEAK", peak );
+    }
+    vlc_mutex_unlock( &item->lock );
+
+    free( peak );
+    free( gain );
+}
+
 static int PreparserOpenInput( void* preparser_, void* req_, void** out )
 {
     input_preparser_t* preparser = preparser_;
@@ -206,6 +299,12 @@ static void PreparserCloseInput( void* preparser_, void* task_ )
     input_Stop( input );
     input_Close( input );
 
+    /* The file may have had a gain in its tags. The scan does not delay the
+     * end of the preparsing: the gain is only read when playing the item. */
+    if( status == ITEM_PREPARSE_DONE && ScanLoudness( req )
+     && !atomic_load( &preparser->deactivated ) )
+        background_worker_Push( preparser->loudness_worker, req, req->id, -1 );
+
     if( preparser->fetcher )
     {
         task->preparse_status = status;
@@ -224,6 +323,64 @@ static void PreparserCloseInput( void* preparser_, void* task_ )
         req->cbs->on_preparse_ended(req->item, status, req->userdata);
 }
 
+static int LoudnessOpenInput( void* preparser_, void* req_, void** out )
+{
+    input_preparser_t* preparser = preparser_;
+    input_preparser_req_t *req = req_;
+    input_preparser_loudness_t* task = malloc( sizeof *task );
+
+    if( unlikely( !task ) )
+        return VLC_ENOMEM;
+
+    atomic_init( &task->state, INIT_S );
+    atomic_init( &task->done, false );
+    task->has_loudness = false;
+    task->preparser = preparser;
+    task->req = req;
+
+    task->input = input_CreateLoudnessScanner( preparser->owner, LoudnessEvent,
+                                               task, req->item );
+    if( !task->input )
+    {
+        free( task );
+        return VLC_EGENERIC;
+    }
+
+    if( input_Start( task->input ) )
+    {
+        input_Close( task->input );
+        free( task );
+        return VLC_EGENERIC;
+    }
+
+    *out = task;
+    return VLC_SUCCESS;
+}
+
+static int LoudnessProbeInput( void* preparser_, void* task_ )
+{
+    input_preparser_loudness_t* task = task_;
+    return atomic_load( &task->done );
+    VLC_UNUSED( preparser_ );
+}
+
+static void LoudnessCloseInput( void* preparser_, void* task_ )
+{
+    input_preparser_loudness_t* task = task_;
+    VLC_UNUSED( preparser_ );
+
+    int state = atomic_load( &task->state );
+
+    input_Stop( task->input );
+    input_Close( task->input );
+
+    /* A partial measurement is not stored */
+    if( state == END_S && task->has_loudness )
+        StoreLoudness( task->req->item, &task->loudness );
+
+    free( task );
+}
+
 static void ReqHoldVoid(void *item) { ReqHold(item); }
 static void ReqReleaseVoid(void *item) { ReqRelease(item); }
 
@@ -241,11 +398,32 @@ input_preparser_t* input_preparser_New( vlc_object_t *parent )
         .pf_hold = ReqHoldVoid
     };
 
+    /* Decoding a whole file takes longer than the preparsing: the scans have
+     * no timeout, and run on their own threads, after the preparsing */
+    struct background_worker_config loudness_conf = {
+        .default_timeout = 0,
+        .max_threads = var_InheritInteger( parent, "preparse-loudness-threads" ),
+        .pf_start = LoudnessOpenInput,
+        .pf_probe = LoudnessProbeInput,
+        .pf_stop = LoudnessCloseInput,
+        .pf_release = ReqReleaseVoid,
+        .pf_hold = ReqHoldVoid
+    };
 
     if( likely( preparser ) )
+    {
         preparser->worker = background_worker_New( preparser, &conf );
+        preparser->loudness_worker = NULL;
+        if( likely( preparser->worker ) )
+        {
+            preparser->loudness_worker =
+                background_worker_New( preparser, &loudness_conf );
+            if( unlikely( !preparser->loudness_worker ) )
+                background_worker_Delete( preparser->worker );
+        }
+    }
 
-    if( unlikely( !preparser || !preparser->worker ) )
+    if( unlikely( !preparser || !preparser->loudness_worker ) )
     {
         free( preparser );
         return NULL;
@@ -289,7 +467,8 @@ void input_preparser_Push( input_preparser_t *preparser,
             return;
     }
 
-    struct input_preparser_req_t *req = ReqCreate(item, cbs, cbs_userdata);
+    struct input_preparser_req_t *req = ReqCreate(item, i_options, cbs,
+                                                  cbs_userdata, id);
 
     if (background_worker_Push(preparser->worker, req, id, timeout))
         if (req->cbs && cbs->on_preparse_ended)
@@ -310,17 +489,20 @@ void input_preparser_fetcher_Push( input_preparser_t *preparser,
 void input_preparser_Cancel( input_preparser_t *preparser, void *id )
 {
     background_worker_Cancel( preparser->worker, id );
+    background_worker_Cancel( preparser->loudness_worker, id );
 }
 
 void input_preparser_Deactivate( input_preparser_t* preparser )
 {
     atomic_store( &preparser->deactivated, true );
     background_worker_Cancel( preparser->worker, NULL );
+    background_worker_Cancel( preparser->loudness_worker, NULL );
 }
 
 void input_preparser_Delete( input_preparser_t *preparser )
 {
     background_worker_Delete( preparser->worker );
+    background_worker_Delete( preparser->loudness_worker );
 
     if( preparser->fetcher )
         input_fetcher_Delete( preparser->fetcher );
@@ -86,11 +86,73 @@ static void test_block (void)
     //assert (block == NULL);
 }
 
+static void test_block_Share (void)
+{
+    block_t *block = block_Alloc (sizeof (text));
+    assert (block != NULL);
+    memcpy (block->p_buffer, text, sizeof (text));
+    block->i_pts = VLC_TICK_0;
+
+    /* Not shareable: the data is copied */
+    block_t *copy = block_Share (block);
+    assert (copy != NULL);
+    assert (copy->p_buffer != block->p_buffer);
+    assert (!memcmp (copy->p_buffer, text, sizeof (text)));
+    block_Release (copy);
+
+    block = block_Shareable (block);
+    assert (block_Shareable (block) == block);
+
+    block_t *dup = block_Share (block);
+    assert (dup != NULL);
+    assert (dup->p_buffer == block->p_buffer);
+    assert (dup->i_buffer == sizeof (text));
+    assert (dup->i_pts == VLC_TICK_0);
+
+    /* Moving the payload start does not affect the other block */
+    dup->p_buffer += 5;
+    dup->i_buffer -= 5;
+    assert (block->i_buffer == sizeof (text));
+
+    /* Prepending copies the data */
+    dup = block_Realloc (dup, 5, dup->i_buffer);
+    assert (dup != NULL);
+    assert (dup->p_buffer != block->p_buffer);
+    memset (dup->p_buffer, 'A', 5);
+    assert (!memcmp (dup->p_buffer + 5, text + 5, sizeof (text) - 5));
+    assert (!memcmp (block->p_buffer, text, sizeof (text)));
+    block_Release (dup);
+
+    /* Writing copies the data while it is shared */
+    dup = block_Share (block);
+    assert (dup != NULL);
+    uint8_t *data = dup->p_buffer;
+    dup = block_Unshare (dup);
+    assert (dup != NULL);
+    assert (dup->p_buffer != data);
+    memset (dup->p_buffer, 'A', dup->i_buffer);
+    assert (!memcmp (block->p_buffer, text, sizeof (text)));
+    block_Release (dup);
+
+    /* The last reference is released first */
+    dup = block_Share (block);
+    assert (dup != NULL);
+    block_Release (block);
+    data = dup->p_buffer;
+    assert (block_Unshare (dup) == dup);
+    dup = block_Realloc (dup, 0, sizeof (text) + 10);
+    assert (dup != NULL);
+    assert (dup->p_buffer == data);
+    assert (!memcmp (dup->p_buffer, text, sizeof (text)));
+    block_Release (dup);
+}
+
 int main (void)
 {
     test_block_File(false);
     test_block_File(true);
     test_block ();
+    test_block_Share ();
     return 0;
 }
 
@@ -0,0 +1,101 @@
+/*****************************************************************************
+ * fft.c: test the FFT of real signals
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_fft.h>
+
+/* Compares with a direct DFT in double precision */
+static void test(unsigned size)
+{
+    vlc_fft_t *fft = vlc_fft_New(size);
+    float *in = malloc(size * sizeof (float));
+    float *re = malloc((size / 2 + 1) * sizeof (float));
+    float *im = malloc((size / 2 + 1) * sizeof (float));
+    unsigned seed = size;
+    double err = 0., energy = 0.;
+
+    assert(fft != NULL && in != NULL && re != NULL && im != NULL);
+    for (unsigned i = 0; i < size; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        in[i] = (float)((seed >> 8) & 0xffff) / 32768.f - 1.f;
+    }
+
+    vlc_fft_Real(fft, in, re, im);
+
+    for (unsigned k = 0; k <= size / 2; k++)
+    {
+        double ref_re = 0., ref_im = 0.;
+
+        for (unsigned i = 0; i < size; i++)
+        {
+            const double phi = -2. * M_PI * (((uint64_t)i * k) % size) / size;
+            ref_re += in[i] * cos(phi);
+            ref_im += in[i] * sin(phi);
+        }
+        err += (re[k] - ref_re) * (re[k] - ref_re)
+             + (im[k] - ref_im) * (im[k] - ref_im);
+        energy += ref_re * ref_re + ref_im * ref_im;
+    }
+
+    printf("size %5u: relative error %g", size, sqrt(err / energy));
+    assert(sqrt(err / energy) < 1e-5);
+
+    /* Round trip */
+    float *out = malloc(size * sizeof (float));
+    assert(out != NULL);
+    vlc_fft_RealInverse(fft, re, im, out);
+
+    err = energy = 0.;
+    for (unsigned i = 0; i < size; i++)
+    {
+        err += (out[i] - in[i]) * (out[i] - in[i]);
+        energy += in[i] * in[i];
+    }
+    printf(", inverse %g\n", sqrt(err / energy));
+    assert(sqrt(err / energy) < 1e-5);
+    free(out);
+
+    free(im);
+    free(re);
+    free(in);
+    vlc_fft_Delete(fft);
+}
+
+int main(void)
+{
+    assert(vlc_fft_New(0) == NULL);
+    assert(vlc_fft_New(1) == NULL);
+    assert(vlc_fft_New(24) == NULL);
+
+    for (unsigned size = 2; size <= 8192; size *= 2)
+        test(size);
+    return 0;
+}
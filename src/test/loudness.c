@@ -0,0 +1,200 @@
+/*****************************************************************************
+ * loudness.c: test the EBU R128 loudness measurement
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_aout.h>
+#include <vlc_loudness.h>
+
+static vlc_loudness_t *Create(vlc_fourcc_t format, unsigned rate,
+                              uint16_t channels)
+{
+    audio_sample_format_t fmt = {
+        .i_format = format,
+        .i_rate = rate,
+        .i_physical_channels = channels,
+        .channel_type = AUDIO_CHANNEL_TYPE_BITMAP,
+    };
+    aout_FormatPrepare(&fmt);
+
+    vlc_loudness_t *meter = vlc_loudness_New(&fmt);
+    assert(meter != NULL);
+    return meter;
+}
+
+/* Measures a 1 kHz sine of the given level in dBFS, on the channels of the
+ * mask, by chunks of the given number of frames */
+static void Sine(vlc_loudness_t *meter, unsigned rate, unsigned channels,
+                 unsigned mask, double level, double seconds, unsigned chunk)
+{
+    const unsigned frames = seconds * rate;
+    const double amp = pow(10., level / 20.);
+    float *buf = malloc(chunk * channels * sizeof (float));
+
+    assert(buf != NULL);
+    for (unsigned i = 0; i < frames; i += chunk)
+    {
+        const unsigned count = __MIN(chunk, frames - i);
+
+        for (unsigned j = 0; j < count; j++)
+        {
+            const float v = amp * sin(2. * M_PI * 1000. * (i + j) / rate);
+
+            for (unsigned c = 0; c < channels; c++)
+                buf[j * channels + c] = (mask >> c) & 1 ? v : 0.f;
+        }
+        vlc_loudness_Process(meter, buf, count);
+    }
+    free(buf);
+}
+
+static void Expect(double value, double expected, double tolerance,
+                   const char *what)
+{
+    printf("%s: %.3f (expected %.1f)\n", what, value, expected);
+    assert(fabs(value - expected) <= tolerance);
+}
+
+/* Test cases of EBU Tech 3341 */
+static void test_stereo(unsigned rate, unsigned chunk)
+{
+    vlc_loudness_t *meter = Create(VLC_CODEC_FL32, rate, AOUT_CHANS_STEREO);
+
+    printf("%u Hz, by %u frames\n", rate, chunk);
+    assert(vlc_loudness_GetIntegrated(meter) == -INFINITY);
+    assert(vlc_loudness_GetMomentary(meter) == -INFINITY);
+
+    Sine(meter, rate, 2, 3, -23., 20., chunk);
+    Expect(vlc_loudness_GetIntegrated(meter), -23., .1, " -23 dBFS");
+    Expect(vlc_loudness_GetMomentary(meter), -23., .1, " momentary");
+    Expect(vlc_loudness_GetShortTerm(meter), -23., .1, " short-term");
+    Expect(20. * log10(vlc_loudness_GetPeak(meter)), -23., .01, " peak");
+
+    vlc_loudness_Reset(meter);
+    Sine(meter, rate, 2, 3, -33., 20., chunk);
+    Expect(vlc_loudness_GetIntegrated(meter), -33., .1, " -33 dBFS");
+
+    /* Relative gate */
+    vlc_loudness_Reset(meter);
+    Sine(meter, rate, 2, 3, -36., 10., chunk);
+    Sine(meter, rate, 2, 3, -23., 60., chunk);
+    Sine(meter, rate, 2, 3, -36., 10., chunk);
+    Expect(vlc_loudness_GetIntegrated(meter), -23., .1, " relative gate");
+
+    /* Absolute gate */
+    vlc_loudness_Reset(meter);
+    Sine(meter, rate, 2, 3, -72., 10., chunk);
+    Sine(meter, rate, 2, 3, -36., 10., chunk);
+    Sine(meter, rate, 2, 3, -23., 60., chunk);
+    Sine(meter, rate, 2, 3, -36., 10., chunk);
+    Sine(meter, rate, 2, 3, -72., 10., chunk);
+    Expect(vlc_loudness_GetIntegrated(meter), -23., .1, " absolute gate");
+
+    /* Below the absolute gate only */
+    vlc_loudness_Reset(meter);
+    Sine(meter, rate, 2, 3, -80., 5., chunk);
+    assert(vlc_loudness_GetIntegrated(meter) == -INFINITY);
+
+    vlc_loudness_Delete(meter);
+}
+
+/* Channel weights: 5.1 in the VLC order L R Ml Mr C LFE */
+static void test_surround(void)
+{
+    const uint16_t chans = AOUT_CHANS_STEREO | AOUT_CHANS_MIDDLE
+                         | AOUT_CHAN_CENTER | AOUT_CHAN_LFE;
+    vlc_loudness_t *meter = Create(VLC_CODEC_FL32, 48000, chans);
+
+    printf("5.1\n");
+    Sine(meter, 48000, 6, 1 << 2, -20., 10., 1024);
+    Expect(vlc_loudness_GetIntegrated(meter),
+           -20. - 10. * log10(2.) + 10. * log10(1.41), .1, " surround");
+
+    vlc_loudness_Reset(meter);
+    Sine(meter, 48000, 6, 1 << 4, -20., 10., 1024);
+    Expect(vlc_loudness_GetIntegrated(meter), -23., .1, " center");
+
+    vlc_loudness_Reset(meter);
+    Sine(meter, 48000, 6, 1 << 5, -20., 10., 1024);
+    assert(vlc_loudness_GetIntegrated(meter) == -INFINITY);
+
+    vlc_loudness_Delete(meter);
+}
+
+/* Integer samples give the same result as floats */
+static void test_s16(void)
+{
+    vlc_loudness_t *fl = Create(VLC_CODEC_FL32, 44100, AOUT_CHANS_STEREO);
+    vlc_loudness_t *s16 = Create(VLC_CODEC_S16N, 44100, AOUT_CHANS_STEREO);
+    int16_t *ibuf = malloc(44100 * 2 * sizeof (*ibuf));
+    float *fbuf = malloc(44100 * 2 * sizeof (*fbuf));
+    unsigned seed = 1;
+
+    assert(ibuf != NULL && fbuf != NULL);
+    for (unsigned i = 0; i < 44100 * 2; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        ibuf[i] = (int16_t)(seed >> 16) / 4;
+        fbuf[i] = ibuf[i] / 32768.f;
+    }
+    for (unsigned i = 0; i < 5; i++)
+    {
+        vlc_loudness_Process(fl, fbuf, 44100);
+        vlc_loudness_Process(s16, ibuf, 44100);
+    }
+
+    printf("s16\n");
+    Expect(vlc_loudness_GetIntegrated(s16), vlc_loudness_GetIntegrated(fl),
+           1e-4, " noise");
+    assert(vlc_loudness_GetPeak(s16) == vlc_loudness_GetPeak(fl));
+
+    free(fbuf);
+    free(ibuf);
+    vlc_loudness_Delete(s16);
+    vlc_loudness_Delete(fl);
+}
+
+int main(void)
+{
+    audio_sample_format_t fmt = {
+        .i_format = VLC_CODEC_S24L,
+        .i_rate = 48000,
+        .i_physical_channels = AOUT_CHANS_STEREO,
+    };
+    aout_FormatPrepare(&fmt);
+    assert(vlc_loudness_New(&fmt) == NULL);
+
+    test_stereo(48000, 4096);
+    test_stereo(44100, 1);
+    test_stereo(44100, 1000);
+    test_stereo(96000, 333);
+    test_surround();
+    test_s16();
+    return 0;
+}
@@ -106,6 +106,26 @@ static void test(bool zombie)
             picture_Release(pics[i]);
 }
 
+static void test_recycle(void)
+{
+    /* Buffers are only kept while other pictures are in use */
+    picture_t *other = picture_NewFromFormat(&fmt);
+    assert(other != NULL);
+
+    picture_t *pic = picture_NewFromFormat(&fmt);
+    assert(pic != NULL);
+
+    void *plane = pic->p[0].p_pixels;
+    picture_Release(pic);
+
+    /* The buffer of a released picture is reused for the same format */
+    pic = picture_NewFromFormat(&fmt);
+    assert(pic != NULL);
+    assert(pic->p[0].p_pixels == plane);
+    picture_Release(pic);
+    picture_Release(other);
+}
+
 int main(void)
 {
     video_format_Setup(&fmt, VLC_CODEC_I420, 320, 200, 320, 200, 1, 1);
@@ -122,6 +142,7 @@ int main(void)
 
     test(false);
     test(true);
+    test_recycle();
 
     return 0;
 }
@@ -24,18 +24,20 @@
 # define LIBVLC_VOUT_STATISTIC_H
 # include <stdatomic.h>
 
-/* NOTE: Both statistics are atomic on their own, so one might be older than
- * the other one. Currently, only one of them is updated at a time, so this
+/* NOTE: All statistics are atomic on their own, so one might be older than
+ * the other ones. Currently, only one of them is updated at a time, so this
  * is a non-issue. */
 typedef struct {
     atomic_uint displayed;
     atomic_uint lost;
+    atomic_llong late; /* worst lateness since the last reset, in ticks */
 } vout_statistic_t;
 
 static inline void vout_statistic_Init(vout_statistic_t *stat)
 {
     atomic_init(&stat->displayed, 0);
     atomic_init(&stat->lost, 0);
+    atomic_init(&stat->late, 0);
 }
 
 static inline void vout_statistic_Clean(vout_statistic_t *stat)
@@ -45,11 +47,13 @@ static inline void vout_statistic_Clean(vout_statistic_t *stat)
 
 static inline void vout_statistic_GetReset(vout_statistic_t *stat,
                                            unsigned *restrict displayed,
-                                           unsigned *restrict lost)
+                                           unsigned *restrict lost,
+                                           vlc_tick_t *restrict late)
 {
     *displayed = atomic_exchange_explicit(&stat->displayed, 0,
                                           memory_order_relaxed);
     *lost = atomic_exchange_explicit(&stat->lost, 0, memory_order_relaxed);
+    *late = atomic_exchange_explicit(&stat->late, 0, memory_order_relaxed);
 }
 
 static inline void vout_statistic_AddDisplayed(vout_statistic_t *stat,
@@ -64,4 +68,15 @@ static inline void vout_statistic_AddLost(vout_statistic_t *stat, int lost)
     atomic_fetch_add_explicit(&stat->lost, lost, memory_order_relaxed);
 }
 
+static inline void vout_statistic_AddLate(vout_statistic_t *stat,
+                                          vlc_tick_t late)
+{
+    long long worst = atomic_load_explicit(&stat->late, memory_order_relaxed);
+
+    while (late > worst
+        && !atomic_compare_exchange_weak_explicit(&stat->late, &worst, late,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed));
+}
+
 #endif
@@ -210,9 +210,9 @@ static void vout_UpdateWindowSize(vout_thread_t *vout)
 
 /* */
 void vout_GetResetStatistic(vout_thread_t *vout, unsigned *restrict displayed,
-                            unsigned *restrict lost)
+                            unsigned *restrict lost, vlc_tick_t *restrict late)
 {
-    vout_statistic_GetReset( &vout->p->statistic, displayed, lost );
+    vout_statistic_GetReset( &vout->p->statistic, displayed, lost, late );
 }
 
 bool vout_IsEmpty(vout_thread_t *vout)
@@ -221,7 +221,13 @@ bool vout_IsEmpty(vout_thread_t *vout)
     if (picture)
         picture_Release(picture);
 
-    return !picture;
+    return !picture && !atomic_load(&vout->p->filter.draining);
+}
+
+void vout_Drain(vout_thread_t *vout)
+{
+    atomic_store(&vout->p->filter.draining, true);
+    vout_control_Wake(&vout->p->control);
 }
 
 void vout_DisplayTitle(vout_thread_t *vout, const char *title)
@@ -678,6 +684,67 @@ static picture_t *VoutVideoFilterStaticNewPicture(filter_t *filter)
     return picture_NewFromFormat(&filter->fmt_out.video);
 }
 
+static void VoutVideoFilterStaticWake(void *opaque)
+{
+    vout_thread_t *vout = opaque;
+
+    /* A picture came out of the pipeline */
+    vout_control_Wake(&vout->p->control);
+}
+
+static void ThreadFilterForget(vout_thread_t *vout)
+{
+    vout_thread_sys_t *sys = vout->p;
+
+    for (size_t i = 0; i < sys->displayed.filtering.size; i++)
+        picture_Release(sys->displayed.filtering.data[i]);
+    vlc_vector_clear(&sys->displayed.filtering);
+}
+
+/* Keeps the decoded pictures given to the static filters, as a pipelined
+ * chain only outputs them later */
+static void ThreadFilterQueue(vout_thread_t *vout, picture_t *decoded)
+{
+    vout_thread_sys_t *sys = vout->p;
+
+    /* Filters can drop pictures */
+    if (sys->displayed.filtering.size >= VOUT_MAX_PICTURES) {
+        picture_Release(sys->displayed.filtering.data[0]);
+        vlc_vector_remove(&sys->displayed.filtering, 0);
+    }
+    if (!vlc_vector_push(&sys->displayed.filtering, decoded))
+        picture_Release(decoded);
+}
+
+/* Updates the displayed state from the decoded picture a filtered picture
+ * comes from, that is the last one not after it */
+static void ThreadFilterOutput(vout_thread_t *vout, const picture_t *filtered)
+{
+    vout_thread_sys_t *sys = vout->p;
+    size_t count = 0;
+
+    if (filtered->date == VLC_TICK_INVALID)
+        count = sys->displayed.filtering.size > 0;
+    else
+        while (count < sys->displayed.filtering.size
+            && sys->displayed.filtering.data[count]->date <= filtered->date)
+            count++;
+    if (count == 0)
+        return;
+
+    picture_t *decoded = sys->displayed.filtering.data[count - 1];
+    for (size_t i = 0; i < count - 1; i++)
+        picture_Release(sys->displayed.filtering.data[i]);
+    vlc_vector_remove_slice(&sys->displayed.filtering, 0, count);
+
+    if (sys->displayed.decoded)
+        picture_Release(sys->displayed.decoded);
+
+    sys->displayed.decoded       = decoded;
+    sys->displayed.timestamp     = decoded->date;
+    sys->displayed.is_interlaced = !decoded->b_progressive;
+}
+
 static void ThreadFilterFlush(vout_thread_t *vout, bool is_locked)
 {
     if (vout->p->displayed.current)
@@ -692,6 +759,8 @@ static void ThreadFilterFlush(vout_thread_t *vout, bool is_locked)
         vlc_mutex_lock(&vout->p->filter.lock);
     filter_chain_VideoFlush(vout->p->filter.chain_static);
     filter_chain_VideoFlush(vout->p->filter.chain_interactive);
+    ThreadFilterForget(vout);
+    atomic_store(&vout->p->filter.draining, false);
     if (!is_locked)
         vlc_mutex_unlock(&vout->p->filter.lock);
 }
@@ -826,7 +895,8 @@ static void ThreadChangeFilters(vout_thread_t *vout,
 /* */
 static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool frame_by_frame)
 {
-    bool is_late_dropped = vout->p->is_late_dropped && !vout->p->pause.is_on && !frame_by_frame;
+    bool is_timed = !vout->p->pause.is_on && !frame_by_frame;
+    bool is_late_dropped = vout->p->is_late_dropped && is_timed;
     vout_thread_sys_t *sys = vout->p;
 
     vlc_mutex_lock(&vout->p->filter.lock);
@@ -842,23 +912,26 @@ static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool fra
             decoded = picture_fifo_Pop(vout->p->decoder_fifo);
 
             if (decoded) {
-                if (is_late_dropped && !decoded->b_force) {
+                if (is_timed && !decoded->b_force) {
                     const vlc_tick_t date = vlc_tick_now();
                     const vlc_tick_t system_pts =
                         vlc_clock_ConvertToSystem(vout->p->clock, date,
                                                   decoded->date, sys->rate);
                     const vlc_tick_t late = date - system_pts;
+                    /* Reported to the decoder, so that it can skip work */
+                    vout_statistic_AddLate(&vout->p->statistic, late);
+
                     vlc_tick_t late_threshold;
                     if (decoded->format.i_frame_rate && decoded->format.i_frame_rate_base)
                         late_threshold = VLC_TICK_FROM_MS(500) * decoded->format.i_frame_rate_base / decoded->format.i_frame_rate;
                     else
                         late_threshold = VOUT_DISPLAY_LATE_THRESHOLD;
-                    if (late > late_threshold) {
+                    if (is_late_dropped && late > late_threshold) {
                         msg_Warn(vout, "picture is too late to be displayed (missing %"PRId64" ms)", MS_FROM_VLC_TICK(late));
                         picture_Release(decoded);
                         vout_statistic_AddLost(&vout->p->statistic, 1);
                         continue;
-                    } else if (late > 0) {
+                    } else if (is_late_dropped && late > 0) {
                         msg_Dbg(vout, "picture might be displayed late (missing %"PRId64" ms)", MS_FROM_VLC_TICK(late));
                     }
                 }
@@ -871,16 +944,21 @@ static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool fra
             break;
         reuse = false;
 
-        if (vout->p->displayed.decoded)
-            picture_Release(vout->p->displayed.decoded);
-
-        vout->p->displayed.decoded       = picture_Hold(decoded);
-        vout->p->displayed.timestamp     = decoded->date;
-        vout->p->displayed.is_interlaced = !decoded->b_progressive;
-
+        ThreadFilterQueue(vout, picture_Hold(decoded));
         picture = filter_chain_VideoFilter(vout->p->filter.chain_static, decoded);
     }
 
+    /* At the end of the stream, wait for the pictures still in the filters
+     * pipeline, if any */
+    if (!picture && atomic_load(&sys->filter.draining)) {
+        picture = filter_chain_VideoDrain(vout->p->filter.chain_static);
+        if (!picture)
+            atomic_store(&sys->filter.draining, false);
+    }
+
+    if (picture)
+        ThreadFilterOutput(vout, picture);
+
     vlc_mutex_unlock(&vout->p->filter.lock);
 
     if (!picture)
@@ -1413,6 +1491,8 @@ static int vout_Start(vout_thread_t *vout, const vout_configuration_t *cfg)
 
     sys->filter.configuration = NULL;
     video_format_Copy(&sys->filter.format, &sys->original);
+    vlc_vector_init(&sys->displayed.filtering);
+    atomic_init(&sys->filter.draining, false);
 
     static const struct filter_video_callbacks static_cbs = {
         .buffer_new = VoutVideoFilterStaticNewPicture,
@@ -1425,6 +1505,9 @@ static int vout_Start(vout_thread_t *vout, const vout_configuration_t *cfg)
         .sys = vout,
     };
     sys->filter.chain_static = filter_chain_NewVideo(vout, true, &owner);
+    filter_chain_SetPipelined(sys->filter.chain_static,
+                              var_InheritInteger(vout, "video-filter-pipeline"),
+                              VoutVideoFilterStaticWake, vout);
 
     owner.video = &interactive_cbs;
     sys->filter.chain_interactive = filter_chain_NewVideo(vout, true, &owner);
@@ -1530,6 +1613,7 @@ static void ThreadStop(vout_thread_t *vout)
     ThreadDelAllFilterCallbacks(vout);
     filter_chain_Delete(vout->p->filter.chain_interactive);
     filter_chain_Delete(vout->p->filter.chain_static);
+    ThreadFilterForget(vout);
     video_format_Clean(&vout->p->filter.format);
     free(vout->p->filter.configuration);
 
@@ -28,6 +28,7 @@
 
 #include <vlc_picture_fifo.h>
 #include <vlc_picture_pool.h>
+#include <vlc_vector.h>
 #include <vlc_vout_display.h>
 #include "vout_wrapper.h"
 #include "statistic.h"
@@ -127,6 +128,8 @@ struct vout_thread_sys_t
         picture_t   *decoded;
         picture_t   *current;
         picture_t   *next;
+        /* Decoded pictures still in the static filters, oldest first */
+        struct VLC_VECTOR(picture_t *) filtering;
     } displayed;
 
     struct {
@@ -162,6 +165,7 @@ struct vout_thread_sys_t
         struct filter_chain_t *chain_static;
         struct filter_chain_t *chain_interactive;
         bool            has_deint;
+        atomic_bool     draining; /**< end of stream, empty the pipeline */
     } filter;
 
     /* */
@@ -304,9 +308,12 @@ void spu_OffsetSubtitleDate( spu_t *p_spu, vlc_tick_t i_duration );
 
 /**
  * This function will return and reset internal statistics.
+ *
+ * \param pi_late the worst display lateness of the pictures dequeued since
+ * the last reset, or a non-positive value if none was late
  */
 void vout_GetResetStatistic( vout_thread_t *p_vout, unsigned *pi_displayed,
-                             unsigned *pi_lost );
+                             unsigned *pi_lost, vlc_tick_t *pi_late );
 
 /*
  * Cancel the vout, if cancel is true, it won't return any pictures after this
@@ -329,6 +336,12 @@ void vout_DisplayTitle( vout_thread_t *p_vout, const char *psz_title );
  */
 bool vout_IsEmpty( vout_thread_t *p_vout );
 
+/**
+ * This function will display the pictures still in the video filters, once
+ * the decoder is drained.
+ */
+void vout_Drain( vout_thread_t *p_vout );
+
 void vout_SetSpuHighlight( vout_thread_t *p_vout, const vlc_spu_highlight_t * );
 
 #endif
@@ -0,0 +1,234 @@
+/*****************************************************************************
+ * cbr.c: TS constant bitrate scheduler and PCR jitter test
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+
+#include "../modules/mux/mpeg/cbr.c"
+
+#define MUX_RATE      INT64_C(4000000)
+#define PCR_INTERVAL  VLC_TICK_FROM_MS(40)
+#define SLICE         VLC_TICK_FROM_MS(100)
+#define VIDEO_PID     0x100
+#define AUDIO_PID     0x101
+#define VIDEO_RX      INT64_C(3600000)
+#define AUDIO_RX      INT64_C(2000000)
+
+static uint8_t cc[0x2000];
+
+static block_t *Packet( uint16_t i_pid, bool b_pcr )
+{
+    block_t *p_ts = block_Alloc( 188 );
+    assert( p_ts );
+    memset( p_ts->p_buffer, 0xAA, 188 );
+    p_ts->p_buffer[0] = 0x47;
+    p_ts->p_buffer[1] = i_pid >> 8;
+    p_ts->p_buffer[2] = i_pid & 0xff;
+    p_ts->p_buffer[3] = ( b_pcr ? 0x30 : 0x10 ) | cc[i_pid];
+    cc[i_pid] = ( cc[i_pid] + 1 ) % 16;
+    if( b_pcr )
+    {
+        p_ts->p_buffer[4] = 7;
+        p_ts->p_buffer[5] = 0x10;
+        memset( &p_ts->p_buffer[6], 0, 6 ); /* filled by the scheduler */
+        p_ts->i_flags |= BLOCK_FLAG_CLOCK;
+    }
+    return p_ts;
+}
+
+/* Offline analyzer state */
+struct analyzer
+{
+    uint64_t   i_packets;
+    uint64_t   i_es_packets;
+    vlc_tick_t i_first_dts;
+    bool       b_pcr;
+    int64_t    i_pcr_first;
+    uint64_t   i_pcr_first_pos;
+    uint64_t   i_pcr_last_pos;
+    int64_t    i_jitter_max;     /* 27MHz ticks */
+    uint64_t   i_pcr_gap_max;    /* packets */
+    int        last_cc[0x2000];
+    double     tb[0x2000];       /* bits */
+    double     tb_max;
+    vlc_tick_t i_tb_date;
+};
+
+static void Analyze( struct analyzer *a, block_t *p_ts )
+{
+    const uint8_t *p = p_ts->p_buffer;
+    const uint16_t i_pid = ( ( p[1] & 0x1f ) << 8 ) | p[2];
+
+    assert( p_ts->i_buffer == 188 && p[0] == 0x47 );
+
+    /* constant packet spacing */
+    if( a->i_packets == 0 )
+        a->i_first_dts = p_ts->i_dts;
+    const vlc_tick_t i_expected = a->i_first_dts +
+        MulDiv( a->i_packets, CBR_PACKET_BITS * CLOCK_FREQ, MUX_RATE );
+    assert( p_ts->i_dts == i_expected );
+
+    /* T-STD transport buffers, leaking between packets */
+    const double dt = (double)( p_ts->i_dts - a->i_tb_date ) / CLOCK_FREQ;
+    a->tb[VIDEO_PID] = __MAX( 0., a->tb[VIDEO_PID] - VIDEO_RX * dt );
+    a->tb[AUDIO_PID] = __MAX( 0., a->tb[AUDIO_PID] - AUDIO_RX * dt );
+    a->i_tb_date = p_ts->i_dts;
+    if( i_pid == VIDEO_PID || i_pid == AUDIO_PID )
+    {
+        a->tb[i_pid] += CBR_PACKET_BITS;
+        a->tb_max = __MAX( a->tb_max, a->tb[i_pid] );
+        /* the analyzer leaks per packet, allow one packet of leak error */
+        assert( a->tb[i_pid] <= CBR_TB_SIZE * 8 + CBR_PACKET_BITS );
+    }
+
+    /* continuity counters */
+    if( i_pid != 0x1fff )
+    {
+        const int i_cc = p[3] & 0x0f;
+        if( p[3] & 0x10 )
+        {
+            if( a->last_cc[i_pid] >= 0 )
+                assert( i_cc == ( a->last_cc[i_pid] + 1 ) % 16 );
+            a->last_cc[i_pid] = i_cc;
+            a->i_es_packets++;
+        }
+        else
+            assert( i_cc == a->last_cc[i_pid] );
+    }
+
+    /* PCR against the packet position */
+    if( ( p[3] & 0x20 ) && p[4] >= 7 && ( p[5] & 0x10 ) )
+    {
+        assert( i_pid == VIDEO_PID );
+        const int64_t i_base = ( (int64_t)p[6] << 25 ) | ( p[7] << 17 ) |
+                               ( p[8] << 9 ) | ( p[9] << 1 ) | ( p[10] >> 7 );
+        const int64_t i_pcr = i_base * 300 + ( ( ( p[10] & 1 ) << 8 ) | p[11] );
+
+        if( !a->b_pcr )
+        {
+            a->b_pcr = true;
+            a->i_pcr_first = i_pcr;
+            a->i_pcr_first_pos = a->i_packets;
+        }
+        else
+        {
+            const uint64_t i_bits = ( a->i_packets - a->i_pcr_first_pos ) * CBR_PACKET_BITS;
+            const int64_t i_ideal = a->i_pcr_first + MulDiv( i_bits, CBR_PCR_FREQ, MUX_RATE );
+            const int64_t i_jitter = llabs( i_pcr - i_ideal );
+            a->i_jitter_max = __MAX( a->i_jitter_max, i_jitter );
+            a->i_pcr_gap_max = __MAX( a->i_pcr_gap_max,
+                                      a->i_packets - a->i_pcr_last_pos );
+        }
+        a->i_pcr_last_pos = a->i_packets;
+    }
+
+    a->i_packets++;
+}
+
+int main( void )
+{
+    cbr_t *p_cbr = cbr_New( MUX_RATE, PCR_INTERVAL );
+    assert( p_cbr );
+    assert( cbr_SetBuffer( p_cbr, VIDEO_PID, VIDEO_RX ) == VLC_SUCCESS );
+    assert( cbr_SetBuffer( p_cbr, AUDIO_PID, AUDIO_RX ) == VLC_SUCCESS );
+    cbr_SetPCRPID( p_cbr, VIDEO_PID );
+
+    struct analyzer a = { .i_packets = 0 };
+    for( int i = 0; i < 0x2000; i++ )
+        a.last_cc[i] = -1;
+
+    const vlc_tick_t i_origin = VLC_TICK_FROM_SEC(1);
+    uint64_t i_sent = 0;
+    unsigned seed = 42;
+
+    for( int i_slice = 0; i_slice < 100; i_slice++ )
+    {
+        const vlc_tick_t i_start = i_origin + i_slice * SLICE;
+        block_t *p_chain = NULL, **pp_last = &p_chain;
+
+        /* VBR input: 0.5 to 3 Mbit/s of video, with a PCR every 70ms
+         * at most, 128 kbit/s of audio */
+        seed = seed * 1103515245 + 12345;
+        const int i_video = 33 + ( seed >> 16 ) % 167;
+        const int i_audio = 9;
+        const int i_total = i_video + i_audio;
+
+        for( int i = 0, v = 0, au = 0; i < i_total; i++ )
+        {
+            block_t *p_ts;
+            if( au < i_audio && i * i_audio >= au * i_total )
+            {
+                p_ts = Packet( AUDIO_PID, false );
+                au++;
+            }
+            else
+            {
+                p_ts = Packet( VIDEO_PID, v % 100 == 0 );
+                v++;
+            }
+            *pp_last = p_ts;
+            pp_last = &p_ts->p_next;
+            i_sent++;
+        }
+
+        block_t *p_out = cbr_Mux( p_cbr, p_chain, i_start, SLICE, i_origin );
+        while( p_out != NULL )
+        {
+            block_t *p_next = p_out->p_next;
+            Analyze( &a, p_out );
+            block_Release( p_out );
+            p_out = p_next;
+        }
+    }
+
+    cbr_stats_t stats;
+    cbr_GetStats( p_cbr, &stats );
+    cbr_Delete( p_cbr );
+
+    const vlc_tick_t i_pcr_interval = MulDiv( a.i_pcr_gap_max,
+                                              CBR_PACKET_BITS * CLOCK_FREQ, MUX_RATE );
+    printf( "packets %"PRIu64" (null %"PRIu64", pcr %"PRIu64" + %"PRIu64" only)\n",
+            stats.i_packets, stats.i_null_packets, stats.i_pcr_packets,
+            stats.i_pcr_only_packets );
+    printf( "pcr jitter max %"PRId64" ticks (engine %"PRId64"), "
+            "interval max %"PRId64" us\n",
+            a.i_jitter_max, stats.i_pcr_error_max, i_pcr_interval );
+    printf( "tb max %d bytes, %"PRIu64" stalls, %"PRIu64" late\n",
+            stats.i_tb_max, stats.i_tb_stalls, stats.i_late_packets );
+
+    assert( a.i_packets == stats.i_packets );
+    assert( a.i_es_packets == i_sent );
+    assert( stats.i_resyncs == 0 );
+    /* PCR values exactly follow the byte position, +-1 for rounding */
+    assert( a.i_jitter_max <= 1 );
+    assert( stats.i_pcr_error_max <= CBR_PCR_FREQ / CLOCK_FREQ );
+    assert( i_pcr_interval <= PCR_INTERVAL );
+    assert( stats.i_tb_max <= CBR_TB_SIZE );
+    assert( stats.i_null_packets > 0 );
+
+    return 0;
+}
@@ -0,0 +1,382 @@
+/*****************************************************************************
+ * variants.c: TS muxer output variants test
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+
+#define MODULE_NAME test_ts_variants
+#define MODULE_STRING "test_ts_variants"
+#undef __PLUGIN__
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_block.h>
+#include <vlc_codec.h>
+#include <vlc_sout.h>
+
+/* One main output, a variant with remapped PIDs and its own tables, and a
+ * constant bitrate variant sharing the packets of the main output */
+#define FRAME_SIZE      1500
+#define KEY_INTERVAL    5
+#define PID_OFFSET      16
+#define REMAP_TSID      7
+#define REMAP_NETID     0x1234
+#define MAIN_NETID      0x100
+
+static const char sout_chain[] =
+    ":sout=#transcode{venc=test_ts_variants_enc,vcodec=h264}"
+    ":std{access=test_ts_variants,dst=main,mux=ts{netid=256,sdtdesc=\"prov,serv\","
+    "outputs=\"test_ts_variants{dst=remap,pid-offset=16,tsid=7,netid=0x1234}"
+    ":test_ts_variants{dst=cbr,mux-rate=4000000}\"}}";
+
+enum { OUT_MAIN, OUT_REMAP, OUT_CBR, OUT_COUNT };
+static const char *const output_names[OUT_COUNT] = { "main", "remap", "cbr" };
+
+static struct
+{
+    vlc_mutex_t lock;
+    block_t    *p_packets[OUT_COUNT];
+    block_t   **pp_last[OUT_COUNT];
+    unsigned    i_frames;
+} state = { .lock = VLC_STATIC_MUTEX };
+
+/*****************************************************************************
+ * Encoder writing frames with a known payload
+ *****************************************************************************/
+static block_t *EncodeVideo( encoder_t *p_enc, picture_t *p_pic )
+{
+    (void)p_enc;
+    if( p_pic == NULL )
+        return NULL;
+
+    vlc_mutex_lock( &state.lock );
+    const unsigned i_frame = state.i_frames++;
+    vlc_mutex_unlock( &state.lock );
+
+    block_t *p_block = block_Alloc( FRAME_SIZE );
+    assert( p_block != NULL );
+    for( size_t i = 0; i < FRAME_SIZE; i++ )
+        p_block->p_buffer[i] = i_frame + i;
+    p_block->i_dts = p_block->i_pts = p_pic->date;
+    if( i_frame % KEY_INTERVAL == 0 )
+        p_block->i_flags |= BLOCK_FLAG_TYPE_I;
+    return p_block;
+}
+
+static int OpenEncoder( vlc_object_t *p_this )
+{
+    encoder_t *p_enc = (encoder_t *)p_this;
+
+    if( p_enc->fmt_out.i_cat != VIDEO_ES ||
+        p_enc->fmt_out.i_codec != VLC_CODEC_H264 )
+        return VLC_EGENERIC;
+
+    p_enc->fmt_in.i_codec = p_enc->fmt_in.video.i_chroma = VLC_CODEC_I420;
+    p_enc->pf_encode_video = EncodeVideo;
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Access output keeping the written packets, without copying them, so that
+ * later changes to shared data are seen
+ *****************************************************************************/
+static ssize_t Write( sout_access_out_t *p_access, block_t *p_chain )
+{
+    const int i_output = (intptr_t)p_access->p_sys;
+    ssize_t i_size = 0;
+
+    vlc_mutex_lock( &state.lock );
+    while( p_chain != NULL )
+    {
+        block_t *p_next = p_chain->p_next;
+        p_chain->p_next = NULL;
+        assert( p_chain->i_buffer == 188 );
+        i_size += p_chain->i_buffer;
+
+        *state.pp_last[i_output] = p_chain;
+        state.pp_last[i_output] = &p_chain->p_next;
+        p_chain = p_next;
+    }
+    vlc_mutex_unlock( &state.lock );
+    return i_size;
+}
+
+static int OpenAccess( vlc_object_t *p_this )
+{
+    sout_access_out_t *p_access = (sout_access_out_t *)p_this;
+
+    for( int i = 0; i < OUT_COUNT; i++ )
+    {
+        if( !strcmp( p_access->psz_path, output_names[i] ) )
+        {
+            p_access->p_sys = (void *)(intptr_t)i;
+            p_access->pf_write = Write;
+            return VLC_SUCCESS;
+        }
+    }
+    return VLC_EGENERIC;
+}
+
+vlc_module_begin()
+    set_description( "TS variants test encoder" )
+    set_capability( "encoder", 0 )
+    set_callbacks( OpenEncoder, NULL )
+    add_shortcut( "test_ts_variants_enc" )
+    add_submodule()
+        set_capability( "sout access", 0 )
+        set_callbacks( OpenAccess, NULL )
+        add_shortcut( "test_ts_variants" )
+vlc_module_end()
+
+/* Registered along with the plugins from the build tree */
+typedef int (*vlc_plugin_cb)(int (*)(void *, void *, int, ...), void *);
+vlc_plugin_cb vlc_static_modules[] = {
+    vlc_entry__test_ts_variants,
+    NULL
+};
+
+/*****************************************************************************
+ * Analysis
+ *****************************************************************************/
+struct output
+{
+    bool        b_cbr;
+    uint16_t    i_tsid;
+    uint16_t    i_pmt_pid;
+    uint16_t    i_pcr_pid;
+    uint16_t    i_es_pid;
+    uint16_t    i_netid;
+    bool        b_sdt_name;
+    unsigned    i_null_packets;
+    unsigned    i_packets;
+    struct
+    {
+        uint8_t *p_data; /* payloads */
+        size_t   i_size;
+        int      last_cc;
+    } pids[0x2000];
+    int64_t     i_pcr_offset; /* PCR against the packet date, 27MHz */
+    bool        b_pcr;
+};
+
+/* Start of the section of a PSI packet, or NULL */
+static const uint8_t *Section( const uint8_t *p )
+{
+    if( !( p[1] & 0x40 ) || !( p[3] & 0x10 ) )
+        return NULL;
+    size_t i_skip = 4;
+    if( p[3] & 0x20 )
+        i_skip += 1 + p[4];
+    i_skip += 1 + p[i_skip];
+    assert( i_skip < 188 );
+    return &p[i_skip];
+}
+
+static void AnalyzePSI( struct output *o, uint16_t i_pid, const uint8_t *p )
+{
+    const uint8_t *s = Section( p );
+    if( s == NULL )
+        return;
+    const uint8_t *p_end = &s[3 + ( GetWBE( &s[1] ) & 0xfff ) - 4];
+
+    if( i_pid == 0x00 )
+    {
+        o->i_tsid = GetWBE( &s[3] );
+        for( const uint8_t *prog = &s[8]; prog + 4 <= p_end; prog += 4 )
+            if( GetWBE( prog ) != 0 )
+                o->i_pmt_pid = GetWBE( &prog[2] ) & 0x1fff;
+    }
+    else if( i_pid == 0x11 && s[0] == 0x42 )
+    {
+        o->i_netid = GetWBE( &s[8] );
+        o->b_sdt_name = memmem( s, p_end - s, "serv", 4 ) != NULL;
+    }
+    else if( i_pid == o->i_pmt_pid && s[0] == 0x02 )
+    {
+        o->i_pcr_pid = GetWBE( &s[8] ) & 0x1fff;
+        const uint8_t *es = &s[12 + ( GetWBE( &s[10] ) & 0xfff )];
+        assert( es[0] == 0x1b ); /* H.264 */
+        o->i_es_pid = GetWBE( &es[1] ) & 0x1fff;
+    }
+}
+
+static void Analyze( struct output *o, const block_t *p_ts )
+{
+    const uint8_t *p = p_ts->p_buffer;
+    const uint16_t i_pid = ( ( p[1] & 0x1f ) << 8 ) | p[2];
+
+    assert( p[0] == 0x47 );
+    o->i_packets++;
+
+    if( i_pid == 0x1fff )
+    {
+        o->i_null_packets++;
+        return;
+    }
+
+    /* continuity, PCR only packets have no payload */
+    const int i_cc = p[3] & 0x0f;
+    if( o->pids[i_pid].last_cc >= 0 )
+        assert( i_cc == ( o->pids[i_pid].last_cc + !!( p[3] & 0x10 ) ) % 16 );
+    o->pids[i_pid].last_cc = i_cc;
+
+    if( i_pid == 0x00 || i_pid == 0x11 || ( i_pid == o->i_pmt_pid && o->i_pmt_pid ) )
+    {
+        AnalyzePSI( o, i_pid, p );
+        return;
+    }
+
+    size_t i_skip = 4;
+    if( p[3] & 0x20 )
+    {
+        i_skip += 1 + p[4];
+        if( p[4] >= 7 && ( p[5] & 0x10 ) )
+        {
+            const int64_t i_base = ( (int64_t)p[6] << 25 ) | ( p[7] << 17 ) |
+                                   ( p[8] << 9 ) | ( p[9] << 1 ) | ( p[10] >> 7 );
+            const int64_t i_pcr = i_base * 300 + ( ( ( p[10] & 1 ) << 8 ) | p[11] );
+            const int64_t i_offset = i_pcr - p_ts->i_dts * 27;
+            if( !o->b_pcr )
+            {
+                o->b_pcr = true;
+                o->i_pcr_offset = i_offset;
+            }
+            /* Variable bitrate outputs set the PCR from the packet date,
+             * a PCR of another output would not match */
+            else if( !o->b_cbr )
+                assert( llabs( i_offset - o->i_pcr_offset ) <= 300 );
+        }
+    }
+    assert( i_skip <= 188 );
+    if( !( p[3] & 0x10 ) )
+        return;
+
+    uint8_t *p_data = realloc( o->pids[i_pid].p_data,
+                               o->pids[i_pid].i_size + 188 - i_skip );
+    assert( p_data != NULL );
+    memcpy( &p_data[o->pids[i_pid].i_size], &p[i_skip], 188 - i_skip );
+    o->pids[i_pid].p_data = p_data;
+    o->pids[i_pid].i_size += 188 - i_skip;
+}
+
+static void on_end( const struct libvlc_event_t *p_ev, void *data )
+{
+    (void)p_ev;
+    vlc_sem_post( data );
+}
+
+static int test_variants( libvlc_instance_t *p_vlc )
+{
+    for( int i = 0; i < OUT_COUNT; i++ )
+        state.pp_last[i] = &state.p_packets[i];
+
+    libvlc_media_t *p_md = libvlc_media_new_location( p_vlc,
+        "mock://video_track_count=1;length=2000000" );
+    assert( p_md != NULL );
+    libvlc_media_add_option( p_md, sout_chain );
+
+    libvlc_media_player_t *p_mp = libvlc_media_player_new_from_media( p_md );
+    assert( p_mp != NULL );
+    libvlc_media_release( p_md );
+
+    vlc_sem_t end;
+    vlc_sem_init( &end, 0 );
+    libvlc_event_manager_t *p_em = libvlc_media_player_event_manager( p_mp );
+    int ret = libvlc_event_attach( p_em, libvlc_MediaPlayerEndReached,
+                                   on_end, &end );
+    assert( ret == 0 );
+
+    ret = libvlc_media_player_play( p_mp );
+    assert( ret == 0 );
+    vlc_sem_wait( &end );
+
+    libvlc_media_player_stop( p_mp );
+    libvlc_media_player_release( p_mp );
+
+    /* The TS muxer needs libdvbpsi */
+    if( state.p_packets[OUT_MAIN] == NULL )
+        return 77;
+
+    struct output *out = calloc( OUT_COUNT, sizeof(*out) );
+    assert( out != NULL );
+    for( int i = 0; i < OUT_COUNT; i++ )
+    {
+        out[i].b_cbr = i == OUT_CBR;
+        for( int j = 0; j < 0x2000; j++ )
+            out[i].pids[j].last_cc = -1;
+        for( block_t *p_ts = state.p_packets[i]; p_ts; p_ts = p_ts->p_next )
+            Analyze( &out[i], p_ts );
+        block_ChainRelease( state.p_packets[i] );
+
+        assert( out[i].i_es_pid != 0 && out[i].i_pcr_pid == out[i].i_es_pid );
+        assert( out[i].b_sdt_name );
+        assert( out[i].b_pcr );
+    }
+    assert( state.i_frames > 2 * KEY_INTERVAL );
+
+    /* Same tables, except the remapped PIDs and ids */
+    assert( out[OUT_REMAP].i_tsid == REMAP_TSID );
+    assert( out[OUT_CBR].i_tsid == out[OUT_MAIN].i_tsid );
+    assert( out[OUT_MAIN].i_netid == MAIN_NETID );
+    assert( out[OUT_REMAP].i_netid == REMAP_NETID );
+    assert( out[OUT_CBR].i_netid == MAIN_NETID );
+    assert( out[OUT_REMAP].i_pmt_pid == out[OUT_MAIN].i_pmt_pid + PID_OFFSET );
+    assert( out[OUT_REMAP].i_es_pid == out[OUT_MAIN].i_es_pid + PID_OFFSET );
+    assert( out[OUT_CBR].i_pmt_pid == out[OUT_MAIN].i_pmt_pid );
+    assert( out[OUT_CBR].i_es_pid == out[OUT_MAIN].i_es_pid );
+
+    /* Packetized once: same ES payloads everywhere */
+    const uint8_t *p_es = out[OUT_MAIN].pids[out[OUT_MAIN].i_es_pid].p_data;
+    const size_t i_es = out[OUT_MAIN].pids[out[OUT_MAIN].i_es_pid].i_size;
+    assert( i_es >= state.i_frames * FRAME_SIZE );
+    for( int i = 1; i < OUT_COUNT; i++ )
+    {
+        assert( out[i].pids[out[i].i_es_pid].i_size == i_es );
+        assert( !memcmp( out[i].pids[out[i].i_es_pid].p_data, p_es, i_es ) );
+    }
+
+    /* Only the constant bitrate output is padded */
+    assert( out[OUT_MAIN].i_null_packets == 0 );
+    assert( out[OUT_REMAP].i_null_packets == 0 );
+    assert( out[OUT_CBR].i_null_packets > 0 );
+    assert( out[OUT_CBR].i_packets > out[OUT_MAIN].i_packets );
+
+    for( int i = 0; i < OUT_COUNT; i++ )
+        for( int j = 0; j < 0x2000; j++ )
+            free( out[i].pids[j].p_data );
+    free( out );
+    return 0;
+}
+
+int main( void )
+{
+    test_init();
+
+    static const char *argv[] = {
+        "-v",
+        "--ignore-config",
+    };
+    libvlc_instance_t *p_vlc = libvlc_new( ARRAY_SIZE(argv), argv );
+    assert( p_vlc != NULL );
+
+    int ret = test_variants( p_vlc );
+
+    libvlc_release( p_vlc );
+    return ret;
+}
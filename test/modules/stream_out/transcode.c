@@ -0,0 +1,297 @@
+/*****************************************************************************
+ * transcode.c: transcode video renditions test
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+
+#define MODULE_NAME test_transcode
+#define MODULE_STRING "test_transcode"
+#undef __PLUGIN__
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_block.h>
+#include <vlc_codec.h>
+#include <vlc_filter.h>
+#include <vlc_sout.h>
+
+/* Source pictures, and a ladder where the renditions 200 and 100 fail,
+ * the first when opening its encoder, the other when adding its output */
+#define SOURCE_WIDTH    640
+#define SOURCE_HEIGHT   480
+#define ENC_REJECTED    200
+#define OUT_REJECTED    100
+#define KEY_INTERVAL    5 /* frames at 25fps */
+#define MAX_OUTPUTS     8
+#define MAX_FRAMES      64
+
+static const char sout_chain[] =
+    ":sout=#transcode{venc=test_transcode_enc,vcodec=h264,keyint=0.2,"
+    "rendition={width=320},rendition={width=200},"
+    "rendition={width=100},rendition={width=160}}:test_transcode_out";
+static const unsigned expected_widths[] = { SOURCE_WIDTH, 320, 160 };
+
+static struct
+{
+    vlc_mutex_t lock;
+    struct
+    {
+        unsigned i_width;
+        unsigned i_height;
+        int      i_id;
+        unsigned i_blocks;
+        vlc_tick_t i_dates[MAX_FRAMES];
+        bool     b_key[MAX_FRAMES];
+    } outputs[MAX_OUTPUTS];
+    unsigned i_outputs;
+    unsigned i_refused;
+} state = { .lock = VLC_STATIC_MUTEX };
+
+/*****************************************************************************
+ * Encoder writing one byte per picture, and flagging key pictures
+ *****************************************************************************/
+static block_t *EncodeVideo( encoder_t *p_enc, picture_t *p_pic )
+{
+    if( p_pic == NULL )
+        return NULL;
+
+    /* Scaled by the rendition chain to the encoder input size */
+    assert( p_pic->format.i_visible_width ==
+            p_enc->fmt_in.video.i_visible_width );
+    assert( p_pic->format.i_visible_height ==
+            p_enc->fmt_in.video.i_visible_height );
+
+    block_t *p_block = block_Alloc( 1 );
+    assert( p_block != NULL );
+    p_block->p_buffer[0] = 0;
+    p_block->i_dts = p_block->i_pts = p_pic->date;
+    if( p_pic->b_keyframe )
+        p_block->i_flags |= BLOCK_FLAG_TYPE_I;
+    return p_block;
+}
+
+static int OpenEncoder( vlc_object_t *p_this )
+{
+    encoder_t *p_enc = (encoder_t *)p_this;
+
+    if( p_enc->fmt_out.i_cat != VIDEO_ES ||
+        p_enc->fmt_out.i_codec != VLC_CODEC_H264 )
+        return VLC_EGENERIC;
+
+    /* The output height is only known when actually opening, after the
+     * encoder test of the rendition */
+    if( p_enc->fmt_out.video.i_height != 0 &&
+        p_enc->fmt_out.video.i_width == ENC_REJECTED )
+        return VLC_EGENERIC;
+
+    p_enc->fmt_in.i_codec = p_enc->fmt_in.video.i_chroma = VLC_CODEC_I420;
+    p_enc->pf_encode_video = EncodeVideo;
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Scaler only allocating pictures of the output size
+ *****************************************************************************/
+static picture_t *Convert( filter_t *p_filter, picture_t *p_pic )
+{
+    picture_t *p_out = filter_NewPicture( p_filter );
+    if( p_out )
+        picture_CopyProperties( p_out, p_pic );
+    picture_Release( p_pic );
+    return p_out;
+}
+
+static int OpenConverter( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+
+    if( p_filter->fmt_in.video.i_chroma != VLC_CODEC_I420 ||
+        p_filter->fmt_out.video.i_chroma != VLC_CODEC_I420 )
+        return VLC_EGENERIC;
+
+    p_filter->pf_video_filter = Convert;
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Stream output recording the ES and their blocks
+ *****************************************************************************/
+static void *Add( sout_stream_t *p_stream, const es_format_t *p_fmt )
+{
+    (void)p_stream;
+    assert( p_fmt->i_cat == VIDEO_ES && p_fmt->i_codec == VLC_CODEC_H264 );
+
+    vlc_mutex_lock( &state.lock );
+    if( p_fmt->video.i_visible_width == OUT_REJECTED )
+    {
+        state.i_refused++;
+        vlc_mutex_unlock( &state.lock );
+        return NULL;
+    }
+
+    assert( state.i_outputs < MAX_OUTPUTS );
+    for( unsigned i = 0; i < state.i_outputs; i++ )
+        assert( state.outputs[i].i_id != p_fmt->i_id );
+
+    unsigned i_output = state.i_outputs++;
+    state.outputs[i_output].i_width = p_fmt->video.i_visible_width;
+    state.outputs[i_output].i_height = p_fmt->video.i_visible_height;
+    state.outputs[i_output].i_id = p_fmt->i_id;
+    state.outputs[i_output].i_blocks = 0;
+    vlc_mutex_unlock( &state.lock );
+
+    return (void *)(uintptr_t)(i_output + 1);
+}
+
+static void Del( sout_stream_t *p_stream, void *id )
+{
+    (void)p_stream; (void)id;
+}
+
+static int Send( sout_stream_t *p_stream, void *id, block_t *p_chain )
+{
+    (void)p_stream;
+    unsigned i_output = (uintptr_t)id - 1;
+
+    vlc_mutex_lock( &state.lock );
+    assert( i_output < state.i_outputs );
+    for( block_t *p_block = p_chain; p_block; p_block = p_block->p_next )
+    {
+        unsigned i = state.outputs[i_output].i_blocks++;
+        if( i < MAX_FRAMES )
+        {
+            state.outputs[i_output].i_dates[i] = p_block->i_dts;
+            state.outputs[i_output].b_key[i] =
+                p_block->i_flags & BLOCK_FLAG_TYPE_I;
+        }
+    }
+    vlc_mutex_unlock( &state.lock );
+
+    block_ChainRelease( p_chain );
+    return VLC_SUCCESS;
+}
+
+static int OpenOutput( vlc_object_t *p_this )
+{
+    sout_stream_t *p_stream = (sout_stream_t *)p_this;
+
+    p_stream->pf_add = Add;
+    p_stream->pf_del = Del;
+    p_stream->pf_send = Send;
+    p_stream->p_sys = NULL;
+    return VLC_SUCCESS;
+}
+
+vlc_module_begin()
+    set_description( "transcode test encoder" )
+    set_capability( "encoder", 0 )
+    set_callbacks( OpenEncoder, NULL )
+    add_shortcut( "test_transcode_enc" )
+    add_submodule()
+        set_capability( "video converter", 10000 )
+        set_callbacks( OpenConverter, NULL )
+    add_submodule()
+        set_capability( "sout stream", 0 )
+        set_callbacks( OpenOutput, NULL )
+        add_shortcut( "test_transcode_out" )
+vlc_module_end()
+
+/* Registered along with the plugins from the build tree */
+typedef int (*vlc_plugin_cb)(int (*)(void *, void *, int, ...), void *);
+vlc_plugin_cb vlc_static_modules[] = {
+    vlc_entry__test_transcode,
+    NULL
+};
+
+/*****************************************************************************
+ * Test
+ *****************************************************************************/
+static void on_end( const struct libvlc_event_t *p_ev, void *data )
+{
+    (void)p_ev;
+    vlc_sem_post( data );
+}
+
+static void test_renditions( libvlc_instance_t *p_vlc )
+{
+    libvlc_media_t *p_md = libvlc_media_new_location( p_vlc,
+        "mock://video_track_count=1;length=2000000" );
+    assert( p_md != NULL );
+    libvlc_media_add_option( p_md, sout_chain );
+
+    libvlc_media_player_t *p_mp = libvlc_media_player_new_from_media( p_md );
+    assert( p_mp != NULL );
+    libvlc_media_release( p_md );
+
+    vlc_sem_t end;
+    vlc_sem_init( &end, 0 );
+    libvlc_event_manager_t *p_em = libvlc_media_player_event_manager( p_mp );
+    int ret = libvlc_event_attach( p_em, libvlc_MediaPlayerEndReached,
+                                   on_end, &end );
+    assert( ret == 0 );
+
+    ret = libvlc_media_player_play( p_mp );
+    assert( ret == 0 );
+    vlc_sem_wait( &end );
+
+    libvlc_media_player_stop( p_mp );
+    libvlc_media_player_release( p_mp );
+
+    /* The failing renditions do not stop the main video and the others */
+    assert( state.i_refused == 1 );
+    assert( state.i_outputs == ARRAY_SIZE(expected_widths) );
+
+    const unsigned i_frames = state.outputs[0].i_blocks;
+    assert( i_frames > 2 * KEY_INTERVAL && i_frames <= MAX_FRAMES );
+
+    for( unsigned i = 0; i < state.i_outputs; i++ )
+    {
+        assert( state.outputs[i].i_width == expected_widths[i] );
+        assert( state.outputs[i].i_height ==
+                expected_widths[i] * SOURCE_HEIGHT / SOURCE_WIDTH );
+
+        /* Every picture is encoded in all the renditions, with key
+         * pictures at the same dates */
+        assert( state.outputs[i].i_blocks == i_frames );
+        for( unsigned j = 0; j < i_frames; j++ )
+        {
+            assert( state.outputs[i].i_dates[j] == state.outputs[0].i_dates[j] );
+            assert( state.outputs[i].b_key[j] == ( j % KEY_INTERVAL == 0 ) );
+        }
+    }
+    /* The renditions are other ES of the main video program */
+    assert( state.outputs[1].i_id != state.outputs[0].i_id );
+}
+
+int main( void )
+{
+    test_init();
+
+    static const char *argv[] = {
+        "-v",
+        "--ignore-config",
+    };
+    libvlc_instance_t *p_vlc = libvlc_new( ARRAY_SIZE(argv), argv );
+    assert( p_vlc != NULL );
+
+    test_renditions( p_vlc );
+
+    libvlc_release( p_vlc );
+    return 0;
+}
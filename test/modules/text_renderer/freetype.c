@@ -0,0 +1,99 @@
+/*****************************************************************************
+ * freetype.c: FreeType text renderer test
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <vlc_filter.h>
+#include <vlc_subpicture.h>
+#include <vlc_text_style.h>
+
+/* Renders the same text twice, to hit the glyph cache if there is one, and
+ * closes the renderer. Returns false if there is no FreeType renderer. */
+static bool test_render( vlc_object_t *p_parent, int64_t i_cache_size )
+{
+    static const vlc_fourcc_t chroma_list[] = {
+        VLC_CODEC_YUVA, VLC_CODEC_RGBA, VLC_CODEC_YUVP, 0
+    };
+
+    filter_t *p_filter = vlc_object_create( p_parent, sizeof(*p_filter) );
+    assert( p_filter != NULL );
+
+    var_Create( p_filter, "freetype-cache-size", VLC_VAR_INTEGER );
+    var_SetInteger( p_filter, "freetype-cache-size", i_cache_size );
+    var_Create( p_filter, "spu-elapsed", VLC_VAR_INTEGER );
+    var_Create( p_filter, "text-rerender", VLC_VAR_BOOL );
+
+    es_format_Init( &p_filter->fmt_in, VIDEO_ES, 0 );
+    es_format_Init( &p_filter->fmt_out, VIDEO_ES, 0 );
+    p_filter->fmt_out.video.i_width =
+    p_filter->fmt_out.video.i_visible_width = 640;
+    p_filter->fmt_out.video.i_height =
+    p_filter->fmt_out.video.i_visible_height = 480;
+
+    p_filter->p_module = module_need( p_filter, "text renderer", "freetype",
+                                      true );
+    if( p_filter->p_module == NULL )
+    {
+        vlc_object_delete( p_filter );
+        return false;
+    }
+
+    for( int i = 0; i < 2; i++ )
+    {
+        video_format_t fmt;
+        video_format_Init( &fmt, VLC_CODEC_TEXT );
+        subpicture_region_t *p_region = subpicture_region_New( &fmt );
+        assert( p_region != NULL );
+        p_region->p_text = text_segment_New( "Glyph cache test" );
+        assert( p_region->p_text != NULL );
+
+        /* Without usable fonts the rendering fails, but must not crash */
+        p_filter->pf_render( p_filter, p_region, p_region, chroma_list );
+        subpicture_region_Delete( p_region );
+    }
+
+    module_unneed( p_filter, p_filter->p_module );
+    vlc_object_delete( p_filter );
+    return true;
+}
+
+int main( void )
+{
+    test_init();
+
+    libvlc_instance_t *p_vlc = libvlc_new( test_defaults_nargs,
+                                           test_defaults_args );
+    assert( p_vlc != NULL );
+    vlc_object_t *p_obj = VLC_OBJECT(p_vlc->p_libvlc_int);
+
+    /* No glyph cache at all */
+    if( !test_render( p_obj, 0 ) )
+    {
+        libvlc_release( p_vlc );
+        return 77; /* skipped */
+    }
+    test_render( p_obj, 8192 );
+
+    libvlc_release( p_vlc );
+    return 0;
+}